@@ -0,0 +1,491 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// cjs-bench: runs the microbenchmarks of the GI call and marshalling paths,
+// and reports how long one operation of each takes, in nanoseconds.
+//
+// The native benchmarks are built in. JS benchmark files register theirs by
+// calling bench(name, func), where func(n) must perform the operation n times;
+// they are named after the file, e.g. "GIMarshalling/int-in" for a benchmark
+// "int-in" in benchGIMarshalling.js.
+//
+// Each benchmark also reports the GC pauses and the toggle queue drain
+// latencies seen while it was sampled, and the peak RSS of the process so far,
+// since wrapper lifecycle problems show up there before they show up as
+// crashes.
+
+#include <config.h>
+
+#include <locale.h>  // for setlocale, LC_ALL
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>  // for strstr
+#include <sys/resource.h>  // for getrusage, RUSAGE_SELF
+
+#include <algorithm>  // for max, min, sort
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <glib-object.h>
+#include <glib.h>
+
+#include <js/Array.h>  // for GetArrayLength
+#include <js/CallArgs.h>
+#include <js/Conversions.h>  // for ToInt32, ToNumber
+#include <js/GCAPI.h>  // for GCDescription, GCProgress, SetGCSliceCallback
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars
+#include <js/Value.h>
+#include <js/ValueArray.h>
+#include <jsapi.h>  // for JS_GetProperty, JSAutoRealm, JS_GetElement
+
+#include "cjs/context-private.h"
+#include "cjs/context.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "gi/toggle.h"
+
+static char* filter = nullptr;
+static int sample_ms = 100;
+static int n_samples = 5;
+static gboolean json_output = false;
+static gboolean native = false;
+
+// clang-format off
+static GOptionEntry entries[] = {
+    { "filter", 'f', 0, G_OPTION_ARG_STRING, &filter,
+        "Only run the benchmarks whose name contains PATTERN", "PATTERN" },
+    { "time", 't', 0, G_OPTION_ARG_INT, &sample_ms,
+        "Run each sample for about MS milliseconds (default: 100)", "MS" },
+    { "samples", 'n', 0, G_OPTION_ARG_INT, &n_samples,
+        "Take N samples of each benchmark (default: 5)", "N" },
+    { "json", 0, 0, G_OPTION_ARG_NONE, &json_output,
+        "Print the results as JSON", nullptr },
+    { "native", 0, 0, G_OPTION_ARG_NONE, &native,
+        "Also run the native benchmarks when given JS files", nullptr },
+    { nullptr }
+};
+// clang-format on
+
+// Defines bench() for the JS benchmark files, and a function for the native
+// benchmark of calling into JS
+static const char bench_prelude[] = R"js(
+globalThis.__benchmarks = [];
+globalThis.bench = function (name, func) {
+    if (typeof func !== 'function')
+        throw new TypeError(`Benchmark ${name} is not a function`);
+    __benchmarks.push({name, func});
+};
+globalThis.__emptyFunction = function () {};
+)js";
+
+// Nearest-rank percentile of @values, 0 if there are none
+static double percentile(std::vector<double> values, double pct) {
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    size_t rank = size_t(pct / 100 * values.size() + 0.5);
+    return values[std::min(std::max(rank, size_t(1)), values.size()) - 1];
+}
+
+struct Distribution {
+    size_t count = 0;
+    double p50 = 0, p99 = 0, max = 0;
+
+    Distribution() = default;
+    explicit Distribution(const std::vector<double>& values)
+        : count(values.size()),
+          p50(percentile(values, 50)),
+          p99(percentile(values, 99)),
+          max(percentile(values, 100)) {}
+};
+
+// GC pauses (major GC slices and nursery collections) and toggle queue drain
+// latencies, in microseconds, seen while sampling the current benchmark
+static struct {
+    bool recording = false;
+    std::vector<double> gc_pauses;
+    std::vector<double> toggle_latencies;
+    std::chrono::steady_clock::time_point slice_begin, nursery_begin;
+} lifecycle;
+
+static JS::GCSliceCallback prev_gc_slice_callback = nullptr;
+static JS::GCNurseryCollectionCallback prev_nursery_callback = nullptr;
+
+static double usec_since(std::chrono::steady_clock::time_point begin) {
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - begin;
+    return elapsed.count();
+}
+
+static void on_gc_slice(JSContext* cx, JS::GCProgress progress,
+                        const JS::GCDescription& desc) {
+    if (progress == JS::GC_SLICE_BEGIN)
+        lifecycle.slice_begin = std::chrono::steady_clock::now();
+    else if (progress == JS::GC_SLICE_END && lifecycle.recording)
+        lifecycle.gc_pauses.push_back(usec_since(lifecycle.slice_begin));
+    if (prev_gc_slice_callback)
+        prev_gc_slice_callback(cx, progress, desc);
+}
+
+static void on_nursery_collection(JSContext* cx,
+                                  JS::GCNurseryProgress progress,
+                                  JS::GCReason reason) {
+    if (progress == JS::GCNurseryProgress::GC_NURSERY_COLLECTION_START)
+        lifecycle.nursery_begin = std::chrono::steady_clock::now();
+    else if (lifecycle.recording)
+        lifecycle.gc_pauses.push_back(usec_since(lifecycle.nursery_begin));
+    if (prev_nursery_callback)
+        prev_nursery_callback(cx, progress, reason);
+}
+
+// High-water mark of the resident set size of the process, in KiB
+static long peak_rss_kib(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss;
+}
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;  // per sample
+    std::vector<double> ns_per_op;
+    Distribution gc_pauses;
+    Distribution toggle_latencies;
+    long peak_rss_kib;
+
+    [[nodiscard]] double median() const {
+        std::vector<double> sorted = ns_per_op;
+        std::sort(sorted.begin(), sorted.end());
+        size_t mid = sorted.size() / 2;
+        if (sorted.size() % 2)
+            return sorted[mid];
+        return (sorted[mid - 1] + sorted[mid]) / 2;
+    }
+    [[nodiscard]] double min() const {
+        return *std::min_element(ns_per_op.begin(), ns_per_op.end());
+    }
+};
+
+static std::vector<BenchResult> results;
+
+// Times @run, which performs the benchmarked operation as many times as it is
+// asked to. The iteration count is first raised until one run takes a tenth of
+// the sample time, then scaled so that each sample takes about the sample
+// time. Returns false if @run failed.
+template <typename F>
+static bool measure(const std::string& name, F&& run) {
+    if (filter && !strstr(name.c_str(), filter))
+        return true;
+
+    auto time_run = [&run](uint64_t n, double* elapsed_ns) {
+        auto start = std::chrono::steady_clock::now();
+        if (!run(n))
+            return false;
+        std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        *elapsed_ns = std::max(elapsed.count(), 1.0);
+        return true;
+    };
+
+    double target_ns = sample_ms * 1e6;
+    uint64_t n = 1;
+    double elapsed_ns;
+    while (true) {
+        if (!time_run(n, &elapsed_ns))
+            return false;
+        if (elapsed_ns >= target_ns / 10)
+            break;
+        n *= std::min(uint64_t(target_ns / 10 / elapsed_ns) + 1, uint64_t(100));
+    }
+
+    BenchResult result{name, std::max(uint64_t(n * target_ns / elapsed_ns), n),
+                       {}, {}, {}, 0};
+    lifecycle.gc_pauses.clear();
+    lifecycle.toggle_latencies.clear();
+    lifecycle.recording = true;
+    for (int ix = 0; ix < n_samples; ix++) {
+        if (!time_run(result.iterations, &elapsed_ns)) {
+            lifecycle.recording = false;
+            return false;
+        }
+        result.ns_per_op.push_back(elapsed_ns / result.iterations);
+    }
+    lifecycle.recording = false;
+    result.gc_pauses = Distribution(lifecycle.gc_pauses);
+    result.toggle_latencies = Distribution(lifecycle.toggle_latencies);
+    result.peak_rss_kib = peak_rss_kib();
+
+    if (!json_output) {
+        g_print("%-48s %12.2f ns/op  (min %.2f, %d x %" G_GUINT64_FORMAT
+                ")\n",
+                name.c_str(), result.median(), result.min(), n_samples,
+                result.iterations);
+        if (result.gc_pauses.count)
+            g_print("    %zu GC pauses: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+                    result.gc_pauses.count, result.gc_pauses.p50,
+                    result.gc_pauses.p99, result.gc_pauses.max);
+        if (result.toggle_latencies.count)
+            g_print("    %zu toggle drains: p50 %.1f us, p99 %.1f us, "
+                    "max %.1f us\n",
+                    result.toggle_latencies.count, result.toggle_latencies.p50,
+                    result.toggle_latencies.p99, result.toggle_latencies.max);
+    }
+    results.push_back(std::move(result));
+    return true;
+}
+
+// benchDrainToggleQueue(): runs the main loop until the toggle notifications
+// queued from other threads are handled, recording the drain latency of each
+// main loop iteration the way the profiler counter reports it. The toggles are
+// queued from JS with GjsTestTools.ref_unref_in_threads().
+GJS_JSAPI_RETURN_CONVENTION
+static bool bench_drain_toggle_queue(JSContext* cx, unsigned argc,
+                                     JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    ToggleQueue& toggle_queue = gjs->toggle_queue();
+    while (toggle_queue.length() > 0) {
+        if (!g_main_context_iteration(gjs->main_context(), false))
+            break;
+        if (lifecycle.recording)
+            lifecycle.toggle_latencies.push_back(
+                double(toggle_queue.last_latency()));
+    }
+
+    args.rval().setUndefined();
+    return true;
+}
+
+static bool run_native_benchmarks(JSContext* cx) {
+    JS::RootedObject global(cx, gjs_get_import_global(cx));
+    JSAutoRealm ar(cx, global);
+    JS::RootedValue func(cx), rval(cx), string(cx);
+
+    // Calling into JS from C, as every signal handler, callback and vfunc
+    // implemented in JS does
+    if (!JS_GetProperty(cx, global, "__emptyFunction", &func) ||
+        !measure("native/call-js-function", [&](uint64_t n) {
+            for (uint64_t ix = 0; ix < n; ix++) {
+                if (!JS::Call(cx, JS::UndefinedHandleValue, func,
+                              JS::HandleValueArray::empty(), &rval))
+                    return false;
+            }
+            return true;
+        }))
+        return false;
+
+    if (!measure("native/intern-atom", [&](uint64_t n) {
+            for (uint64_t ix = 0; ix < n; ix++) {
+                if (gjs_intern_string_to_id(cx, "connect") == JSID_VOID)
+                    return false;
+            }
+            return true;
+        }))
+        return false;
+
+    if (!measure("native/intern-string", [&](uint64_t n) {
+            for (uint64_t ix = 0; ix < n; ix++) {
+                if (gjs_intern_string_to_id(cx, "benchmark_property") ==
+                    JSID_VOID)
+                    return false;
+            }
+            return true;
+        }))
+        return false;
+
+    if (!measure("native/string-from-utf8", [&](uint64_t n) {
+            for (uint64_t ix = 0; ix < n; ix++) {
+                if (!gjs_string_from_utf8(cx, "const \xe2\x99\xa5 utf8",
+                                          &string))
+                    return false;
+            }
+            return true;
+        }))
+        return false;
+
+    if (!gjs_string_from_utf8(cx, "const \xe2\x99\xa5 utf8", &string))
+        return false;
+    return measure("native/string-to-utf8", [&](uint64_t n) {
+        for (uint64_t ix = 0; ix < n; ix++) {
+            if (!gjs_string_to_utf8(cx, string))
+                return false;
+        }
+        return true;
+    });
+}
+
+// Benchmarks are named after their file: benchFoo.js -> Foo
+static std::string suite_name(const char* filename) {
+    GjsAutoChar basename = g_path_get_basename(filename);
+    std::string suite = basename.get();
+    if (g_str_has_prefix(suite.c_str(), "bench"))
+        suite.erase(0, strlen("bench"));
+    if (g_str_has_suffix(suite.c_str(), ".js"))
+        suite.erase(suite.size() - strlen(".js"));
+    return suite;
+}
+
+// Runs the benchmarks that the last evaluated file registered, the ones from
+// index @first on
+static bool run_js_benchmarks(JSContext* cx, const std::string& suite,
+                              uint32_t* first) {
+    JS::RootedObject global(cx, gjs_get_import_global(cx));
+    JSAutoRealm ar(cx, global);
+
+    JS::RootedValue v_benchmarks(cx);
+    if (!JS_GetProperty(cx, global, "__benchmarks", &v_benchmarks))
+        return false;
+    JS::RootedObject benchmarks(cx, &v_benchmarks.toObject());
+    uint32_t length;
+    if (!JS::GetArrayLength(cx, benchmarks, &length))
+        return false;
+
+    JS::RootedValue entry(cx), name(cx), func(cx), rval(cx);
+    JS::RootedValueArray<1> args(cx);
+    for (; *first < length; (*first)++) {
+        if (!JS_GetElement(cx, benchmarks, *first, &entry))
+            return false;
+        JS::RootedObject entry_obj(cx, &entry.toObject());
+        if (!JS_GetProperty(cx, entry_obj, "name", &name) ||
+            !JS_GetProperty(cx, entry_obj, "func", &func))
+            return false;
+        JS::UniqueChars bench_name = gjs_string_to_utf8(cx, name);
+        if (!bench_name)
+            return false;
+
+        if (!measure(suite + "/" + bench_name.get(), [&](uint64_t n) {
+                args[0].setNumber(double(n));
+                return JS::Call(cx, JS::UndefinedHandleValue, func, args,
+                                &rval);
+            }))
+            return false;
+    }
+    return true;
+}
+
+static void print_json_distribution(const char* name,
+                                    const Distribution& distribution) {
+    g_print(", \"%s\": {\"count\": %zu, \"p50\": %.2f, \"p99\": %.2f, "
+            "\"max\": %.2f}",
+            name, distribution.count, distribution.p50, distribution.p99,
+            distribution.max);
+}
+
+static void print_json(void) {
+    g_print("{\n  \"format\": 1,\n  \"version\": \"%s\",\n", VERSION);
+    g_print("  \"benchmarks\": [");
+    for (size_t ix = 0; ix < results.size(); ix++) {
+        const BenchResult& result = results[ix];
+        GjsAutoChar name = g_strescape(result.name.c_str(), nullptr);
+        g_print("%s\n    {\"name\": \"%s\", \"ns_per_op\": %.2f, "
+                "\"min_ns_per_op\": %.2f, \"iterations\": %" G_GUINT64_FORMAT
+                ", \"samples\": [",
+                ix ? "," : "", name.get(), result.median(), result.min(),
+                result.iterations);
+        for (size_t sample = 0; sample < result.ns_per_op.size(); sample++)
+            g_print("%s%.2f", sample ? ", " : "", result.ns_per_op[sample]);
+        g_print("],\n     \"peak_rss_kib\": %ld", result.peak_rss_kib);
+        print_json_distribution("gc_pauses_us", result.gc_pauses);
+        print_json_distribution("toggle_drain_latency_us",
+                                result.toggle_latencies);
+        g_print("}");
+    }
+    g_print("\n  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    setlocale(LC_ALL, "");
+
+    GError* error = nullptr;
+    GOptionContext* context = g_option_context_new("[FILE.js...]");
+    g_option_context_set_summary(context,
+                                 "Runs the microbenchmarks of the GI call and "
+                                 "marshalling paths, and of each FILE\n"
+                                 "given. Without files, only the native "
+                                 "benchmarks are run.");
+    g_option_context_add_main_entries(context, entries, nullptr);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+        g_option_context_free(context);
+        return 1;
+    }
+    g_option_context_free(context);
+    if (sample_ms < 1 || n_samples < 1) {
+        g_printerr("The sample time and count must be positive\n");
+        return 1;
+    }
+
+    GjsContext* gjs_context = gjs_context_new();
+    auto* cx =
+        static_cast<JSContext*>(gjs_context_get_native_context(gjs_context));
+
+    int code = 0;
+    if (!gjs_context_eval(gjs_context, bench_prelude, -1, "<bench>", &code,
+                          &error))
+        g_error("Failed to set up the benchmarks: %s", error->message);
+
+    {
+        JS::RootedObject global(cx, gjs_get_import_global(cx));
+        JSAutoRealm ar(cx, global);
+        if (!JS_DefineFunction(cx, global, "benchDrainToggleQueue",
+                               bench_drain_toggle_queue, 0,
+                               GJS_MODULE_PROP_FLAGS))
+            g_error("Failed to set up the benchmarks");
+    }
+    prev_gc_slice_callback = JS::SetGCSliceCallback(cx, on_gc_slice);
+    prev_nursery_callback =
+        JS::SetGCNurseryCollectionCallback(cx, on_nursery_collection);
+
+    bool ok = true;
+    if (argc < 2 || native)
+        ok = run_native_benchmarks(cx);
+
+    uint32_t first = 0;
+    for (int ix = 1; ok && ix < argc; ix++) {
+        if (!gjs_context_eval_file(gjs_context, argv[ix], &code, &error)) {
+            g_printerr("%s\n", error->message);
+            g_clear_error(&error);
+            ok = false;
+            break;
+        }
+        ok = run_js_benchmarks(cx, suite_name(argv[ix]), &first);
+    }
+
+    if (!ok) {
+        JS::RootedObject global(cx, gjs_get_import_global(cx));
+        JSAutoRealm ar(cx, global);
+        gjs_log_exception(cx);
+    } else if (json_output) {
+        print_json();
+    }
+
+    g_object_unref(gjs_context);
+    return ok ? 0 : 1;
+}
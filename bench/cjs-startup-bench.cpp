@@ -0,0 +1,351 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// cjs-startup-bench: runs cjs-console repeatedly and reports how long it took
+// to reach each startup milestone, and where that time went.
+//
+// The built-in scenarios stop at the first statement of a small script, once
+// imports.gi.Gtk is resolved, and once the main loop is entered; each FILE
+// given is a scenario that stops when the program exits. The console runs with
+// --fast-exit, so the wall time of a run is the time to its milestone. The
+// breakdown comes from the console's own instrumentation: the startup profile
+// (GJS_STARTUP_PROFILE) splits the time before the first statement into engine
+// initialization and bootstrap, and the typelib statistics
+// (GJS_PROFILE_TYPELIBS) into typelib loading and override evaluation.
+
+#include <config.h>
+
+#include <locale.h>  // for setlocale, LC_ALL
+#include <math.h>    // for sqrt
+#include <stdint.h>
+#include <stdio.h>   // for sscanf
+#include <string.h>  // for strcmp
+
+#include <algorithm>  // for fill, sort
+#include <string>
+#include <utility>  // for move
+#include <vector>
+
+#include <glib.h>
+
+#include "cjs/jsapi-util.h"  // for GjsAutoChar, GjsAutoStrv
+
+static char* console_path = nullptr;
+static char* between_command = nullptr;
+static int iterations = 10;
+static int warmup = 1;
+static gboolean json_output = false;
+static gboolean skip_builtin = false;
+static gboolean skip_gtk = false;
+
+// clang-format off
+static GOptionEntry entries[] = {
+    { "console", 0, 0, G_OPTION_ARG_FILENAME, &console_path,
+        "Path to the cjs-console to run (default: cjs-console in PATH)",
+        "PATH" },
+    { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+        "Run each scenario N times (default: 10)", "N" },
+    { "warmup", 'w', 0, G_OPTION_ARG_INT, &warmup,
+        "Discard the first N runs of each scenario (default: 1)", "N" },
+    { "between", 0, 0, G_OPTION_ARG_STRING, &between_command,
+        "Run COMMAND before each run, e.g. to drop the page cache and measure "
+        "cold startup", "COMMAND" },
+    { "json", 0, 0, G_OPTION_ARG_NONE, &json_output,
+        "Print the results as JSON", nullptr },
+    { "no-builtin", 0, 0, G_OPTION_ARG_NONE, &skip_builtin,
+        "Only run the FILEs given, not the built-in scenarios", nullptr },
+    { "no-gtk", 0, 0, G_OPTION_ARG_NONE, &skip_gtk,
+        "Skip the built-in scenarios that need Gtk", nullptr },
+    { nullptr }
+};
+// clang-format on
+
+#define DUMP_AND_EXIT                           \
+    "imports.system.dumpTypelibStats();"        \
+    "imports.system.exit(0);"
+
+struct Scenario {
+    std::string name;
+    std::string code;  // if empty, @file is run
+    std::string file;
+    bool needs_gtk;
+};
+
+// clang-format off
+static const Scenario builtin_scenarios[] = {
+    {"first-statement", DUMP_AND_EXIT, "", false},
+    {"gtk-resolved",
+        "imports.gi.versions.Gtk = '3.0';"
+        "imports.gi.Gtk;"
+        DUMP_AND_EXIT, "", true},
+    {"main-loop-entered",
+        "imports.gi.versions.Gtk = '3.0';"
+        "const {GLib, Gtk} = imports.gi;"
+        "GLib.idle_add(GLib.PRIORITY_DEFAULT, () => {"
+            DUMP_AND_EXIT
+        "});"
+        "new GLib.MainLoop(null, false).run();", "", true},
+};
+// clang-format on
+
+// The quantities measured in each run, in milliseconds
+enum Metric {
+    WALL,
+    BEFORE_FIRST_STATEMENT,
+    ENGINE_INIT,
+    BOOTSTRAP,
+    TYPELIB_LOADING,
+    OVERRIDE_EVALUATION,
+    N_METRICS
+};
+
+static const char* const metric_names[N_METRICS] = {
+    "wall",        "before_first_statement", "engine_init",
+    "bootstrap",   "typelib_loading",        "override_evaluation",
+};
+
+struct Statistics {
+    double median, mean, stddev, min, max;
+
+    explicit Statistics(std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        size_t n = values.size();
+        median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+        min = values.front();
+        max = values.back();
+        double sum = 0;
+        for (double value : values)
+            sum += value;
+        mean = sum / n;
+        double squares = 0;
+        for (double value : values)
+            squares += (value - mean) * (value - mean);
+        stddev = n > 1 ? sqrt(squares / (n - 1)) : 0;
+    }
+};
+
+struct ScenarioResult {
+    std::string name;
+    std::vector<Statistics> metrics;
+};
+
+static std::vector<ScenarioResult> results;
+
+// Adds up the startup profile that the console prints on stderr: the lines
+// of the form "<ms> ms  <phase>", up to the "Included in the above:" ones
+static void parse_startup_profile(const char* output, double* values) {
+    GjsAutoStrv lines = g_strsplit(output, "\n", -1);
+    for (char** line = lines; *line; line++) {
+        if (strcmp(*line, "Included in the above:") == 0)
+            break;
+
+        double ms;
+        int phase_offset = 0;
+        if (sscanf(*line, " %lf ms  %n", &ms, &phase_offset) < 1 ||
+            phase_offset == 0)
+            continue;
+        const char* phase = *line + phase_offset;
+        if (strcmp(phase, "create JS engine") == 0)
+            values[ENGINE_INIT] += ms;
+        else if (strcmp(phase, "total before running the program") == 0)
+            values[BEFORE_FIRST_STATEMENT] += ms;
+        else
+            values[BOOTSTRAP] += ms;
+    }
+}
+
+// Adds up the typelib statistics that the scenario printed on stdout with
+// System.dumpTypelibStats(): "<require ms> <override ms> <infos>  <namespace>"
+static void parse_typelib_stats(const char* output, double* values) {
+    GjsAutoStrv lines = g_strsplit(output, "\n", -1);
+    for (char** line = lines; *line; line++) {
+        double require_ms, override_ms;
+        unsigned infos;
+        if (sscanf(*line, " %lf %lf %u", &require_ms, &override_ms, &infos) <
+            3)
+            continue;
+        values[TYPELIB_LOADING] += require_ms;
+        values[OVERRIDE_EVALUATION] += override_ms;
+    }
+}
+
+// Runs @scenario once and fills in @values; returns false if it failed
+static bool run_once(const Scenario& scenario, char** envp, double* values) {
+    std::vector<const char*> argv{console_path, "--fast-exit"};
+    if (scenario.code.empty()) {
+        argv.push_back(scenario.file.c_str());
+    } else {
+        argv.push_back("-c");
+        argv.push_back(scenario.code.c_str());
+    }
+    argv.push_back(nullptr);
+
+    if (between_command) {
+        GError* error = nullptr;
+        if (!g_spawn_command_line_sync(between_command, nullptr, nullptr,
+                                       nullptr, &error)) {
+            g_printerr("Running %s failed: %s\n", between_command,
+                       error->message);
+            g_clear_error(&error);
+            return false;
+        }
+    }
+
+    char* out = nullptr;
+    char* err = nullptr;
+    int status;
+    GError* error = nullptr;
+    int64_t start = g_get_monotonic_time();
+    bool ok = g_spawn_sync(nullptr, const_cast<char**>(argv.data()), envp,
+                           G_SPAWN_SEARCH_PATH, nullptr, nullptr, &out, &err,
+                           &status, &error);
+    int64_t elapsed = g_get_monotonic_time() - start;
+    GjsAutoChar stdout_data = out, stderr_data = err;
+
+    if (!ok) {
+        g_printerr("Running %s failed: %s\n", console_path, error->message);
+        g_clear_error(&error);
+        return false;
+    }
+    if (!g_spawn_check_exit_status(status, &error)) {
+        g_printerr("Scenario %s failed: %s\n%s", scenario.name.c_str(),
+                   error->message, stderr_data.get());
+        g_clear_error(&error);
+        return false;
+    }
+
+    std::fill(values, values + N_METRICS, 0);
+    values[WALL] = elapsed / 1e3;
+    parse_startup_profile(stderr_data, values);
+    parse_typelib_stats(stdout_data, values);
+    return true;
+}
+
+static bool run_scenario(const Scenario& scenario, char** envp) {
+    std::vector<double> samples[N_METRICS];
+    double values[N_METRICS];
+
+    for (int ix = 0; ix < warmup + iterations; ix++) {
+        if (!run_once(scenario, envp, values))
+            return false;
+        if (ix < warmup)
+            continue;
+        for (int metric = 0; metric < N_METRICS; metric++)
+            samples[metric].push_back(values[metric]);
+    }
+
+    ScenarioResult result{scenario.name, {}};
+    for (int metric = 0; metric < N_METRICS; metric++)
+        result.metrics.emplace_back(std::move(samples[metric]));
+
+    if (!json_output) {
+        g_print("%s\n", scenario.name.c_str());
+        for (int metric = 0; metric < N_METRICS; metric++) {
+            const Statistics& stats = result.metrics[metric];
+            g_print("  %-24s %9.3f ms  (mean %.3f, stddev %.3f, min %.3f, "
+                    "max %.3f)\n",
+                    metric_names[metric], stats.median, stats.mean,
+                    stats.stddev, stats.min, stats.max);
+        }
+    }
+    results.push_back(std::move(result));
+    return true;
+}
+
+static void print_json(void) {
+    g_print("{\n  \"format\": 1,\n  \"version\": \"%s\",\n", VERSION);
+    g_print("  \"iterations\": %d,\n  \"scenarios\": [", iterations);
+    for (size_t ix = 0; ix < results.size(); ix++) {
+        const ScenarioResult& result = results[ix];
+        GjsAutoChar name = g_strescape(result.name.c_str(), nullptr);
+        g_print("%s\n    {\"name\": \"%s\", \"metrics_ms\": {", ix ? "," : "",
+                name.get());
+        for (int metric = 0; metric < N_METRICS; metric++) {
+            const Statistics& stats = result.metrics[metric];
+            g_print("%s\n      \"%s\": {\"median\": %.3f, \"mean\": %.3f, "
+                    "\"stddev\": %.3f, \"min\": %.3f, \"max\": %.3f}",
+                    metric ? "," : "", metric_names[metric], stats.median,
+                    stats.mean, stats.stddev, stats.min, stats.max);
+        }
+        g_print("\n    }}");
+    }
+    g_print("\n  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    setlocale(LC_ALL, "");
+    // The output of the console is parsed with C conventions, see below
+    setlocale(LC_NUMERIC, "C");
+
+    GError* error = nullptr;
+    GOptionContext* context = g_option_context_new("[FILE.js...]");
+    g_option_context_set_summary(context,
+                                 "Measures the startup time of cjs-console: "
+                                 "for a small script, up to imports.gi.Gtk\n"
+                                 "and up to the main loop, and for each FILE "
+                                 "given up to its exit.");
+    g_option_context_add_main_entries(context, entries, nullptr);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+        g_option_context_free(context);
+        return 1;
+    }
+    g_option_context_free(context);
+    if (iterations < 1 || warmup < 0) {
+        g_printerr("The number of iterations must be positive\n");
+        return 1;
+    }
+    if (!console_path)
+        console_path = g_strdup("cjs-console");
+
+    // Locale-independent numbers from the console, for parsing them
+    GjsAutoStrv envp = g_get_environ();
+    envp = g_environ_unsetenv(envp.release(), "LC_ALL");
+    envp = g_environ_setenv(envp.release(), "GJS_STARTUP_PROFILE", "1", true);
+    envp = g_environ_setenv(envp.release(), "GJS_PROFILE_TYPELIBS", "1", true);
+    envp = g_environ_setenv(envp.release(), "LC_NUMERIC", "C", true);
+
+    std::vector<Scenario> scenarios;
+    if (!skip_builtin) {
+        for (const Scenario& scenario : builtin_scenarios) {
+            if (!skip_gtk || !scenario.needs_gtk)
+                scenarios.push_back(scenario);
+        }
+    }
+    for (int ix = 1; ix < argc; ix++) {
+        GjsAutoChar basename = g_path_get_basename(argv[ix]);
+        scenarios.push_back({basename.get(), "", argv[ix], false});
+    }
+
+    for (const Scenario& scenario : scenarios) {
+        if (!run_scenario(scenario, envp))
+            return 1;
+    }
+
+    if (json_output)
+        print_json();
+
+    g_free(console_path);
+    return 0;
+}
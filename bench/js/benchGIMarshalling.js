@@ -0,0 +1,98 @@
+// Each benchmark performs its operation n times. Keep the loop body down to
+// the call being measured, so that the result is the cost of the GI call.
+
+const {GIMarshallingTests, GObject} = imports.gi;
+
+bench('int-in', n => {
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.int_in_max(0x7fffffff);
+});
+
+bench('int-return', n => {
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.int_return_max();
+});
+
+bench('utf8-in', n => {
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.utf8_none_in('const ♥ utf8');
+});
+
+bench('utf8-return-transfer-none', n => {
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.utf8_none_return();
+});
+
+bench('utf8-return-transfer-full', n => {
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.utf8_full_return();
+});
+
+bench('c-array-in', n => {
+    const array = [-1, 0, 1, 2];
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.array_in(array);
+});
+
+bench('garray-in', n => {
+    const array = [-1, 0, 1, 2];
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.garray_int_none_in(array);
+});
+
+bench('glist-in', n => {
+    const list = [-1, 0, 1, 2];
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.glist_int_none_in(list);
+});
+
+bench('glist-utf8-return', n => {
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.glist_utf8_none_return();
+});
+
+bench('ghashtable-in', n => {
+    const hash = {'-1': 1, 0: 0, 1: -1, 2: -2};
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.ghashtable_int_none_in(hash);
+});
+
+bench('ghashtable-utf8-return', n => {
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.ghashtable_utf8_none_return();
+});
+
+bench('boxed-return', n => {
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.boxed_struct_returnv();
+});
+
+bench('callback', n => {
+    const callback = () => 42;
+    for (let i = 0; i < n; i++)
+        GIMarshallingTests.callback_return_value_only(callback);
+});
+
+bench('property-get', n => {
+    const obj = new GIMarshallingTests.PropertiesObject({some_int: 42});
+    for (let i = 0; i < n; i++)
+        void obj.some_int;
+});
+
+bench('property-set', n => {
+    const obj = new GIMarshallingTests.PropertiesObject();
+    for (let i = 0; i < n; i++)
+        obj.some_int = i & 0xffff;
+});
+
+const VFuncTester = GObject.registerClass(class VFuncTester extends GIMarshallingTests.Object {
+    vfunc_vfunc_return_value_only() {
+        return 42;
+    }
+});
+
+bench('vfunc', n => {
+    const tester = new VFuncTester();
+    for (let i = 0; i < n; i++)
+        tester.vfunc_return_value_only();
+});
@@ -0,0 +1,67 @@
+// Stress scenarios for the GObject wrapper lifecycle, the performance side of
+// installed-tests/js/testGObjectDestructionAccess.js. Besides ns/op, look at
+// the GC pause and toggle drain distributions and the peak RSS that cjs-bench
+// reports for these; run with a longer --time to go through millions of
+// wrappers.
+
+const {GjsTestTools, GObject} = imports.gi;
+const System = imports.system;
+
+const N_TOGGLE_THREADS = 4;
+
+// References taken from other threads only queue toggle notifications for
+// objects whose wrapper uses a toggle reference, which an expando property
+// switches it to
+function toggledObject(i) {
+    const obj = new GObject.Object();
+    obj.expando = i;
+    return obj;
+}
+
+function toggleFromThreads(objects, n) {
+    GjsTestTools.ref_unref_in_threads(objects, N_TOGGLE_THREADS, n);
+    benchDrainToggleQueue();
+}
+
+bench('create-destroy', n => {
+    for (let i = 0; i < n; i++)
+        void new GObject.Object();
+});
+
+bench('create-destroy-with-expando', n => {
+    // Expando properties make the wrapper keep its GObject alive by a strong
+    // toggle reference, until the wrapper is collected
+    for (let i = 0; i < n; i++) {
+        const obj = new GObject.Object();
+        obj.expando = i;
+    }
+});
+
+const toggled = Array.from({length: 1000}, (_, i) => toggledObject(i));
+
+bench('toggle-from-threads', n => {
+    toggleFromThreads(toggled, n);
+});
+
+// A long-lived population of rooted wrappers, part of which is replaced by
+// new ones, amid short-lived unrooted ones
+const rooted = Array.from({length: 10000}, (_, i) => toggledObject(i));
+
+bench('mixed-rooted-unrooted', n => {
+    for (let i = 0; i < n; i++) {
+        const obj = new GObject.Object();
+        if (i % 8 === 0)
+            rooted[(i >> 3) % rooted.length] = obj;
+        else if (i % 8 === 1)
+            obj.expando = i;
+    }
+});
+
+bench('toggle-mixed-population', n => {
+    toggleFromThreads(rooted, n);
+});
+
+bench('full-gc', n => {
+    for (let i = 0; i < n; i++)
+        System.gc();
+});
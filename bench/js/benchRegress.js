@@ -0,0 +1,36 @@
+// Each benchmark performs its operation n times. Keep the loop body down to
+// the call being measured, so that the result is the cost of the GI call.
+
+const {Regress} = imports.gi;
+
+bench('signal-connect-disconnect', n => {
+    const obj = new Regress.TestObj();
+    const handler = () => {};
+    for (let i = 0; i < n; i++)
+        obj.disconnect(obj.connect('test', handler));
+});
+
+bench('signal-emit-from-js', n => {
+    const obj = new Regress.TestObj();
+    obj.connect('test', () => {});
+    for (let i = 0; i < n; i++)
+        obj.emit('test');
+});
+
+bench('signal-emit-from-c', n => {
+    const obj = new Regress.TestObj();
+    obj.connect('sig-with-int64-prop', (self, number) => number);
+    for (let i = 0; i < n; i++)
+        obj.emit_sig_with_int64();
+});
+
+bench('constructor', n => {
+    for (let i = 0; i < n; i++)
+        new Regress.TestObj();
+});
+
+bench('method', n => {
+    const obj = new Regress.TestObj();
+    for (let i = 0; i < n; i++)
+        obj.instance_method();
+});
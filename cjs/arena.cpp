@@ -0,0 +1,80 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+
+#include <glib.h>
+
+#include "cjs/arena.h"
+
+GjsArena::~GjsArena() {
+    g_assert(m_depth == 0 && "Arena destroyed while a call was using it");
+
+    while (m_chunk) {
+        Chunk* prev = m_chunk->prev;
+        free_chunk(m_chunk);
+        m_chunk = prev;
+    }
+    g_clear_pointer(&m_spare, g_free);
+}
+
+void GjsArena::free_chunk(Chunk* chunk) {
+    // Oversized chunks are not worth keeping around
+    if (!m_spare && chunk->size == CHUNK_SIZE) {
+        m_spare = chunk;
+        return;
+    }
+    g_free(chunk);
+}
+
+void* GjsArena::alloc_slow(size_t size) {
+    Chunk* chunk;
+    if (m_spare && size <= CHUNK_SIZE) {
+        chunk = m_spare;
+        m_spare = nullptr;
+    } else {
+        size_t chunk_size = MAX(size, CHUNK_SIZE);
+        chunk = static_cast<Chunk*>(g_malloc(sizeof(Chunk) + chunk_size));
+        chunk->size = chunk_size;
+    }
+
+    chunk->prev = m_chunk;
+    chunk->used = size;
+    m_chunk = chunk;
+    return chunk->data();
+}
+
+void GjsArena::leave(const Mark& mark) {
+    g_assert(m_depth > 0 && "Unbalanced arena scope");
+    m_depth--;
+
+    while (m_chunk != mark.chunk) {
+        Chunk* prev = m_chunk->prev;
+        free_chunk(m_chunk);
+        m_chunk = prev;
+    }
+    if (m_chunk)
+        m_chunk->used = mark.used;
+}
@@ -0,0 +1,113 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_ARENA_H_
+#define GJS_ARENA_H_
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t, max_align_t
+
+// Bump allocator for temporary memory that only needs to live for the duration
+// of an introspected function call, such as the GIArgument arrays and the UTF-8
+// copies of JS strings passed as transfer-none arguments.
+//
+// Memory is never freed individually. Instead, each call saves a mark when it
+// starts and rewinds the arena to it when it finishes, so re-entrant calls
+// (for example, a C function calling back into JS which calls another C
+// function) only release their own allocations. Use GjsAutoArenaScope for this.
+class GjsArena {
+    struct alignas(max_align_t) Chunk {
+        Chunk* prev;
+        size_t size;  // usable bytes following the header
+        size_t used;
+
+        [[nodiscard]] char* data() { return reinterpret_cast<char*>(this + 1); }
+    };
+    static_assert(sizeof(Chunk) % alignof(max_align_t) == 0,
+                  "chunk data must be suitably aligned");
+
+    static constexpr size_t CHUNK_SIZE = 4096 - sizeof(Chunk);
+
+    Chunk* m_chunk = nullptr;
+    // Kept around when rewinding, so that calls which need a little more than
+    // one chunk don't malloc and free another one each time
+    Chunk* m_spare = nullptr;
+    unsigned m_depth = 0;
+
+    [[nodiscard]] void* alloc_slow(size_t size);
+    void free_chunk(Chunk* chunk);
+
+ public:
+    struct Mark {
+        Chunk* chunk;
+        size_t used;
+    };
+
+    GjsArena() = default;
+    ~GjsArena();
+    GjsArena(const GjsArena&) = delete;
+    GjsArena& operator=(const GjsArena&) = delete;
+
+    // Returns memory aligned for any type; aborts on out-of-memory like
+    // g_malloc() does
+    [[nodiscard]] void* alloc(size_t size) {
+        size = (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+        if (m_chunk && m_chunk->size - m_chunk->used >= size) {
+            void* retval = m_chunk->data() + m_chunk->used;
+            m_chunk->used += size;
+            return retval;
+        }
+        return alloc_slow(size);
+    }
+
+    template <typename T>
+    [[nodiscard]] T* alloc_n(size_t n) {
+        return static_cast<T*>(alloc(n * sizeof(T)));
+    }
+
+    [[nodiscard]] Mark enter() {
+        m_depth++;
+        return {m_chunk, m_chunk ? m_chunk->used : 0};
+    }
+    void leave(const Mark& mark);
+
+    // Number of calls currently using the arena
+    [[nodiscard]] unsigned depth() const { return m_depth; }
+};
+
+class GjsAutoArenaScope {
+    GjsArena* m_arena;
+    GjsArena::Mark m_mark;
+
+ public:
+    explicit GjsAutoArenaScope(GjsArena* arena)
+        : m_arena(arena), m_mark(arena->enter()) {}
+    ~GjsAutoArenaScope() { m_arena->leave(m_mark); }
+    GjsAutoArenaScope(const GjsAutoArenaScope&) = delete;
+    GjsAutoArenaScope& operator=(const GjsAutoArenaScope&) = delete;
+
+    [[nodiscard]] GjsArena* arena() const { return m_arena; }
+};
+
+#endif  // GJS_ARENA_H_
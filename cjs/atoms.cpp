@@ -26,6 +26,12 @@
 
 #include <config.h>
 
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+#include <string.h>  // for strcmp
+
+#include <iterator>  // for size
+
 #include <js/Id.h>
 #include <js/RootingAPI.h>
 #include <js/Symbol.h>
@@ -62,6 +68,77 @@ bool GjsSymbolAtom::init(JSContext* cx, const char* str) {
     return true;
 }
 
+// Perfect hash of the atom strings: the seed is searched for at compile time,
+// so that each atom gets its own slot in the table
+namespace {
+
+#define ATOM_STRING(identifier, str) str,
+constexpr const char* atom_strings[] = {FOR_EACH_ATOM(ATOM_STRING)};
+#undef ATOM_STRING
+
+#define ATOM_MEMBER(identifier, str) &GjsAtoms::identifier,
+constexpr GjsAtom GjsAtoms::*atom_members[] = {FOR_EACH_ATOM(ATOM_MEMBER)};
+#undef ATOM_MEMBER
+
+constexpr size_t n_atoms = std::size(atom_strings);
+// Sparse enough that a seed is found after a few tries
+constexpr unsigned ATOM_TABLE_SIZE = 512;
+static_assert(n_atoms < ATOM_TABLE_SIZE / 4 && n_atoms < UINT8_MAX,
+              "Too many atoms for the atom table");
+
+// FNV-1a
+constexpr unsigned atom_slot(const char* str, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (; *str; str++) {
+        hash ^= static_cast<uint8_t>(*str);
+        hash *= 16777619u;
+    }
+    return (hash ^ (hash >> 16)) & (ATOM_TABLE_SIZE - 1);
+}
+
+constexpr bool atom_seed_is_perfect(uint32_t seed) {
+    bool used[ATOM_TABLE_SIZE] = {};
+    for (const char* str : atom_strings) {
+        unsigned slot = atom_slot(str, seed);
+        if (used[slot])
+            return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t find_atom_seed() {
+    uint32_t seed = 0;
+    while (!atom_seed_is_perfect(seed))
+        seed++;
+    return seed;
+}
+
+constexpr uint32_t atom_seed = find_atom_seed();
+
+// 1 + the position of the atom in FOR_EACH_ATOM, or 0 if the slot is empty
+struct GjsAtomTable {
+    uint8_t slots[ATOM_TABLE_SIZE];
+};
+
+constexpr GjsAtomTable make_atom_table() {
+    GjsAtomTable table{};
+    for (size_t ix = 0; ix < n_atoms; ix++)
+        table.slots[atom_slot(atom_strings[ix], atom_seed)] = ix + 1;
+    return table;
+}
+
+constexpr GjsAtomTable atom_table = make_atom_table();
+
+}  // namespace
+
+const GjsAtom* GjsAtoms::lookup(const char* str) const {
+    unsigned ix = atom_table.slots[atom_slot(str, atom_seed)];
+    if (ix == 0 || strcmp(str, atom_strings[ix - 1]) != 0)
+        return nullptr;
+    return &(this->*atom_members[ix - 1]);
+}
+
 /* Requires a current realm. This can GC, so it needs to be done after the
  * tracing has been set up. */
 bool GjsAtoms::init_atoms(JSContext* cx) {
@@ -41,6 +41,7 @@ class JSTracer;
     macro(column_number, "columnNumber") \
     macro(connect_after, "connect_after") \
     macro(constructor, "constructor") \
+    macro(data, "data") \
     macro(debuggee, "debuggee") \
     macro(detail, "detail") \
     macro(emit, "emit") \
@@ -53,6 +54,7 @@ class JSTracer;
     macro(gobject, "GObject") \
     macro(gtype, "$gtype") \
     macro(height, "height") \
+    macro(import_async, "importAsync") \
     macro(imports, "imports") \
     macro(init, "_init") \
     macro(instance_init, "_instance_init") \
@@ -66,6 +68,7 @@ class JSTracer;
     macro(name, "name") \
     macro(new_, "new") \
     macro(new_internal, "_new_internal") \
+    macro(onmessage, "onmessage") \
     macro(overrides, "overrides") \
     macro(param_spec, "ParamSpec") \
     macro(parent_module, "__parentModule__") \
@@ -120,6 +123,11 @@ class GjsAtoms {
 
     void trace(JSTracer* trc);
 
+    // Returns the atom whose string is @str, or null if it is not one of
+    // FOR_EACH_ATOM; one hash and one string compare, with a perfect hash
+    // worked out at compile time
+    [[nodiscard]] const GjsAtom* lookup(const char* str) const;
+
 #define DECLARE_ATOM_MEMBER(identifier, str) GjsAtom identifier;
 #define DECLARE_SYMBOL_ATOM_MEMBER(identifier, str) GjsSymbolAtom identifier;
     FOR_EACH_ATOM(DECLARE_ATOM_MEMBER)
@@ -24,29 +24,41 @@
 #include <config.h>
 
 #include <stdint.h>
-#include <string.h>  // for strcmp, memchr, strlen
+#include <string.h>  // for strcmp, memchr, memcpy, memset, strlen
 
+#include <algorithm>  // for max
+
+#include <gio/gio.h>
 #include <girepository.h>
 #include <glib-object.h>
 #include <glib.h>
 
 #include <js/ArrayBuffer.h>
 #include <js/CallArgs.h>
+#include <js/Conversions.h>  // for ToInt32
 #include <js/GCAPI.h>  // for AutoCheckCannotGC
+#include <js/Id.h>
+#include <js/PropertyDescriptor.h>
 #include <js/PropertySpec.h>
+#include <js/Proxy.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>   // for UniqueChars
+#include <js/Wrapper.h>
 #include <jsapi.h>        // for JS_DefineFunctionById, JS_DefineFun...
 #include <jsfriendapi.h>  // for JS_NewUint8ArrayWithBuffer, GetUint...
 
 #include "gi/boxed.h"
+#include "gi/closure.h"
+#include "gi/gerror.h"
+#include "gi/object.h"
 #include "cjs/atoms.h"
 #include "cjs/byteArray.h"
 #include "cjs/context-private.h"
 #include "cjs/deprecation.h"
 #include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
+#include "cjs/string-builder.h"
 
 /* Callbacks to use with JS::NewExternalArrayBuffer() */
 
@@ -54,6 +66,8 @@ static void gfree_arraybuffer_contents(void* contents, void*) {
     g_free(contents);
 }
 
+static void js_free_bytes_contents(void* contents) { js_free(contents); }
+
 static void bytes_unref_arraybuffer(void* contents [[maybe_unused]],
                                     void* user_data) {
     auto* gbytes = static_cast<GBytes*>(user_data);
@@ -206,9 +220,10 @@ to_gbytes_func(JSContext *context,
     JS::CallArgs rec = JS::CallArgsFromVp(argc, vp);
     GIBaseInfo *gbytes_info;
     JS::RootedObject byte_array(context);
+    bool transfer = false;
 
-    if (!gjs_parse_call_args(context, "toGBytes", rec, "o",
-                             "byteArray", &byte_array))
+    if (!gjs_parse_call_args(context, "toGBytes", rec, "o|b", "byteArray",
+                             &byte_array, "transfer", &transfer))
         return false;
 
     if (!JS_IsUint8Array(byte_array)) {
@@ -217,7 +232,11 @@ to_gbytes_func(JSContext *context,
         return false;
     }
 
-    GBytes* bytes = gjs_byte_array_get_bytes(byte_array);
+    GBytes* bytes = transfer
+                        ? gjs_byte_array_steal_bytes(context, byte_array)
+                        : gjs_byte_array_get_bytes(byte_array);
+    if (!bytes)
+        return false;
 
     g_irepository_require(nullptr, "GLib", "2.0", GIRepositoryLoadFlags(0),
                           nullptr);
@@ -346,30 +365,37 @@ from_gbytes_func(JSContext *context,
     if (!gbytes)
         return false;
 
+    JSObject* obj = gjs_byte_array_from_gbytes(context, gbytes);
+    if (!obj)
+        return false;
+
+    argv.rval().setObject(*obj);
+    return true;
+}
+
+JSObject* gjs_byte_array_from_gbytes(JSContext* cx, GBytes* bytes) {
     size_t len;
-    const void* data = g_bytes_get_data(gbytes, &len);
+    const void* data = g_bytes_get_data(bytes, &len);
     JS::RootedObject array_buffer(
-        context,
-        JS::NewExternalArrayBuffer(
-            context, len,
-            const_cast<void*>(data),  // the ArrayBuffer won't modify the data
-            bytes_unref_arraybuffer, gbytes));
+        cx, JS::NewExternalArrayBuffer(
+                cx, len,
+                const_cast<void*>(data),  // the ArrayBuffer won't modify it
+                bytes_unref_arraybuffer, bytes));
     if (!array_buffer)
-        return false;
-    g_bytes_ref(gbytes);  // now owned by both ArrayBuffer and BoxedBase
+        return nullptr;
+    g_bytes_ref(bytes);  // now owned by both ArrayBuffer and the caller
 
     JS::RootedObject obj(
-        context, JS_NewUint8ArrayWithBuffer(context, array_buffer, 0, -1));
+        cx, JS_NewUint8ArrayWithBuffer(cx, array_buffer, 0, -1));
     if (!obj)
-        return false;
+        return nullptr;
 
-    const GjsAtoms& atoms = GjsContextPrivate::atoms(context);
-    if (!JS_DefineFunctionById(context, obj, atoms.to_string(),
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    if (!JS_DefineFunctionById(cx, obj, atoms.to_string(),
                                instance_to_string_func, 1, 0))
-        return false;
+        return nullptr;
 
-    argv.rval().setObject(*obj);
-    return true;
+    return obj;
 }
 
 JSObject* gjs_byte_array_from_data(JSContext* cx, size_t nbytes, void* data) {
@@ -393,6 +419,34 @@ JSObject* gjs_byte_array_from_data(JSContext* cx, size_t nbytes, void* data) {
     return array;
 }
 
+JSObject* gjs_array_buffer_from_owned_data(JSContext* cx, size_t nbytes,
+                                           void* data) {
+    JSObject* array_buffer = JS::NewExternalArrayBuffer(
+        cx, nbytes, data, gfree_arraybuffer_contents, nullptr);
+    if (!array_buffer)
+        g_free(data);
+    return array_buffer;
+}
+
+JSObject* gjs_byte_array_from_owned_data(JSContext* cx, size_t nbytes,
+                                         void* data) {
+    JS::RootedObject array_buffer(
+        cx, gjs_array_buffer_from_owned_data(cx, nbytes, data));
+    if (!array_buffer)
+        return nullptr;
+
+    JS::RootedObject array(cx,
+                           JS_NewUint8ArrayWithBuffer(cx, array_buffer, 0, -1));
+    if (!array)
+        return nullptr;
+
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    if (!JS_DefineFunctionById(cx, array, atoms.to_string(),
+                               instance_to_string_func, 1, 0))
+        return nullptr;
+    return array;
+}
+
 JSObject* gjs_byte_array_from_byte_array(JSContext* cx, GByteArray* array) {
     return gjs_byte_array_from_data(cx, array->len, array->data);
 }
@@ -406,15 +460,746 @@ GBytes* gjs_byte_array_get_bytes(JSObject* obj) {
     return g_bytes_new(data, len);
 }
 
+GBytes* gjs_byte_array_steal_bytes(JSContext* cx, JS::HandleObject obj) {
+    bool is_shared_memory;
+    JS::RootedObject buffer(
+        cx, JS_GetArrayBufferViewBuffer(cx, obj, &is_shared_memory));
+    if (!buffer)
+        return nullptr;
+
+    // Only a view of the whole buffer can take its memory; and the engine
+    // copies the contents itself of buffers it can't hand over, such as
+    // those from gjs_byte_array_from_gbytes() or with inline data
+    if (is_shared_memory || JS_GetTypedArrayByteOffset(obj) != 0 ||
+        JS_GetTypedArrayByteLength(obj) != JS::GetArrayBufferByteLength(buffer))
+        return gjs_byte_array_get_bytes(obj);
+
+    size_t len = JS::GetArrayBufferByteLength(buffer);
+    if (len == 0)
+        return g_bytes_new(nullptr, 0);
+
+    void* data = JS::StealArrayBufferContents(cx, buffer);
+    if (!data)
+        return nullptr;
+
+    return g_bytes_new_with_free_func(data, len, js_free_bytes_contents, data);
+}
+
 GByteArray* gjs_byte_array_get_byte_array(JSObject* obj) {
     return g_bytes_unref_to_array(gjs_byte_array_get_bytes(obj));
 }
 
+/* Reading into and writing from Uint8Arrays, for the Gio.InputStream and
+ * Gio.OutputStream overrides. The JS side fills in the default arguments. */
+
+// Small arrays may keep their contents inline in the JS object, where a GC
+// could move them if the stream runs JS code while we hold a pointer, so
+// these go through a bounce buffer instead
+static constexpr size_t BOUNCE_BUFFER_SIZE = 256;
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool get_stream_args(JSContext* cx, const char* func,
+                            const JS::CallArgs& args, GType stream_type,
+                            GObject** stream, JS::MutableHandleObject array,
+                            uint32_t* offset, uint32_t* count,
+                            GCancellable** cancellable) {
+    JS::RootedObject stream_obj(cx), cancellable_obj(cx);
+    if (!gjs_parse_call_args(cx, func, args, "oouu?o", "stream", &stream_obj,
+                             "array", array, "offset", offset, "count", count,
+                             "cancellable", &cancellable_obj))
+        return false;
+
+    if (!ObjectBase::to_c_ptr(cx, stream_obj, stream))
+        return false;
+    if (!*stream || !G_TYPE_CHECK_INSTANCE_TYPE(*stream, stream_type)) {
+        gjs_throw(cx, "%s() must be called on a %s", func,
+                  g_type_name(stream_type));
+        return false;
+    }
+
+    *cancellable = nullptr;
+    if (cancellable_obj) {
+        GObject* obj;
+        if (!ObjectBase::to_c_ptr(cx, cancellable_obj, &obj))
+            return false;
+        if (!obj || !G_IS_CANCELLABLE(obj)) {
+            gjs_throw(cx, "Argument cancellable must be a Gio.Cancellable");
+            return false;
+        }
+        *cancellable = G_CANCELLABLE(obj);
+    }
+
+    if (!JS_IsUint8Array(array)) {
+        gjs_throw(cx, "Argument array to %s() must be a Uint8Array", func);
+        return false;
+    }
+
+    uint32_t len = JS_GetTypedArrayLength(array);
+    if (*offset > len || *count > len - *offset) {
+        gjs_throw_custom(cx, JSProto_RangeError, nullptr,
+                         "Offset %u and count %u are out of bounds of an "
+                         "array of length %u",
+                         *offset, *count, len);
+        return false;
+    }
+    return true;
+}
+
+[[nodiscard]] static uint8_t* get_array_data(JSObject* array) {
+    uint32_t len;
+    bool is_shared_memory;
+    uint8_t* data;
+    js::GetUint8ArrayLengthAndData(array, &len, &is_shared_memory, &data);
+    return data;
+}
+
+// readInto(stream, array, offset, count, cancellable) -> bytes read
+GJS_JSAPI_RETURN_CONVENTION
+static bool read_into_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GObject* stream;
+    JS::RootedObject array(cx);
+    uint32_t offset, count;
+    GCancellable* cancellable;
+    if (!get_stream_args(cx, "read_into", args, G_TYPE_INPUT_STREAM, &stream,
+                         &array, &offset, &count, &cancellable))
+        return false;
+
+    GError* error = nullptr;
+    gssize nread;
+    if (count <= BOUNCE_BUFFER_SIZE) {
+        uint8_t buffer[BOUNCE_BUFFER_SIZE];
+        nread = g_input_stream_read(G_INPUT_STREAM(stream), buffer, count,
+                                    cancellable, &error);
+        if (nread > 0)
+            memcpy(get_array_data(array) + offset, buffer, nread);
+    } else {
+        nread = g_input_stream_read(G_INPUT_STREAM(stream),
+                                    get_array_data(array) + offset, count,
+                                    cancellable, &error);
+    }
+    if (nread < 0)
+        return gjs_throw_gerror(cx, error);
+
+    args.rval().setNumber(double(nread));
+    return true;
+}
+
+// writeAllFrom(stream, array, offset, count, cancellable) -> bytes written
+GJS_JSAPI_RETURN_CONVENTION
+static bool write_all_from_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GObject* stream;
+    JS::RootedObject array(cx);
+    uint32_t offset, count;
+    GCancellable* cancellable;
+    if (!get_stream_args(cx, "write_all_from", args, G_TYPE_OUTPUT_STREAM,
+                         &stream, &array, &offset, &count, &cancellable))
+        return false;
+
+    GError* error = nullptr;
+    gsize written;
+    bool ok;
+    if (count <= BOUNCE_BUFFER_SIZE) {
+        uint8_t buffer[BOUNCE_BUFFER_SIZE];
+        memcpy(buffer, get_array_data(array) + offset, count);
+        ok = g_output_stream_write_all(G_OUTPUT_STREAM(stream), buffer, count,
+                                       &written, cancellable, &error);
+    } else {
+        ok = g_output_stream_write_all(G_OUTPUT_STREAM(stream),
+                                       get_array_data(array) + offset, count,
+                                       &written, cancellable, &error);
+    }
+    if (!ok)
+        return gjs_throw_gerror(cx, error);
+
+    args.rval().setNumber(double(written));
+    return true;
+}
+
+// While an asynchronous operation runs, the memory of the array's buffer
+// belongs to it: the buffer is detached, as with a WHATWG BYOB reader, and
+// the callback receives a new array over the same memory when it's done
+struct GjsStreamTransfer {
+    GClosure* callback;
+    GObject* stream;
+    void* data;
+    size_t buffer_len;
+    uint32_t view_offset;
+    uint32_t view_len;
+};
+
+static void gjs_stream_transfer_free(GjsStreamTransfer* transfer) {
+    g_closure_unref(transfer->callback);
+    g_object_unref(transfer->stream);
+    js_free(transfer->data);
+    g_free(transfer);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static GjsStreamTransfer* gjs_stream_transfer_new(JSContext* cx,
+                                                  GObject* stream,
+                                                  JS::HandleObject array,
+                                                  JS::HandleValue callback) {
+    if (!callback.isObject() || !JS_ObjectIsFunction(&callback.toObject())) {
+        gjs_throw(cx, "Callback must be a function");
+        return nullptr;
+    }
+
+    bool is_shared_memory;
+    JS::RootedObject buffer(
+        cx, JS_GetArrayBufferViewBuffer(cx, array, &is_shared_memory));
+    if (!buffer)
+        return nullptr;
+    if (is_shared_memory) {
+        gjs_throw(cx, "Cannot transfer a shared buffer");
+        return nullptr;
+    }
+
+    uint32_t view_offset = JS_GetTypedArrayByteOffset(array);
+    uint32_t view_len = JS_GetTypedArrayByteLength(array);
+    size_t buffer_len = JS::GetArrayBufferByteLength(buffer);
+    void* data = JS::StealArrayBufferContents(cx, buffer);
+    if (!data)
+        return nullptr;
+
+    auto* transfer = g_new0(GjsStreamTransfer, 1);
+    transfer->callback = gjs_closure_new(
+        cx, JS_GetObjectFunction(&callback.toObject()), "stream transfer",
+        true);
+    transfer->stream = G_OBJECT(g_object_ref(stream));
+    transfer->data = data;
+    transfer->buffer_len = buffer_len;
+    transfer->view_offset = view_offset;
+    transfer->view_len = view_len;
+    return transfer;
+}
+
+static void gjs_stream_transfer_complete(GjsStreamTransfer* transfer,
+                                         gssize result, GError* error) {
+    if (!gjs_closure_is_valid(transfer->callback)) {
+        // The context was destroyed in the meantime
+        g_clear_error(&error);
+        gjs_stream_transfer_free(transfer);
+        return;
+    }
+
+    JSContext* cx = gjs_closure_get_context(transfer->callback);
+    JSAutoRealm ar(
+        cx, JS_GetFunctionObject(gjs_closure_get_callable(transfer->callback)));
+
+    JS::RootedObject buffer(
+        cx, JS::NewArrayBufferWithContents(cx, transfer->buffer_len,
+                                           transfer->data));
+    JS::RootedValueArray<3> args(cx);
+    if (!buffer) {
+        g_clear_error(&error);
+        gjs_log_exception(cx);
+        gjs_stream_transfer_free(transfer);
+        return;
+    }
+    transfer->data = nullptr;  // now owned by the ArrayBuffer
+
+    JSObject* array = JS_NewUint8ArrayWithBuffer(
+        cx, buffer, transfer->view_offset, transfer->view_len);
+    JSObject* error_obj =
+        error ? ErrorInstance::object_for_c_ptr(cx, error) : nullptr;
+    g_clear_error(&error);
+    if (!array || (result < 0 && !error_obj)) {
+        gjs_log_exception(cx);
+        gjs_stream_transfer_free(transfer);
+        return;
+    }
+
+    if (error_obj)
+        args[0].setObject(*error_obj);
+    else
+        args[1].setNumber(double(result));
+    args[2].setObject(*array);
+
+    JS::RootedValue ignored(cx);
+    if (!gjs_closure_invoke(transfer->callback, nullptr, args, &ignored,
+                            false)) {
+        // Exception already logged
+    }
+    gjs_stream_transfer_free(transfer);
+}
+
+static void read_into_async_done(GObject* source, GAsyncResult* res,
+                                 void* data) {
+    GError* error = nullptr;
+    gssize nread =
+        g_input_stream_read_finish(G_INPUT_STREAM(source), res, &error);
+    gjs_stream_transfer_complete(static_cast<GjsStreamTransfer*>(data), nread,
+                                 error);
+}
+
+static void write_all_from_async_done(GObject* source, GAsyncResult* res,
+                                      void* data) {
+    GError* error = nullptr;
+    gsize written;
+    if (!g_output_stream_write_all_finish(G_OUTPUT_STREAM(source), res,
+                                          &written, &error))
+        written = -1;
+    gjs_stream_transfer_complete(static_cast<GjsStreamTransfer*>(data),
+                                 written, error);
+}
+
+// readIntoAsync(stream, array, offset, count, cancellable, priority, callback)
+// callback(error, bytesRead, array)
+GJS_JSAPI_RETURN_CONVENTION
+static bool read_into_async_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GObject* stream;
+    JS::RootedObject array(cx);
+    uint32_t offset, count;
+    GCancellable* cancellable;
+    if (!args.requireAtLeast(cx, "read_into_async", 7) ||
+        !get_stream_args(cx, "read_into_async", args, G_TYPE_INPUT_STREAM,
+                         &stream, &array, &offset, &count, &cancellable))
+        return false;
+
+    int32_t priority;
+    if (!JS::ToInt32(cx, args[5], &priority))
+        return false;
+
+    GjsStreamTransfer* transfer =
+        gjs_stream_transfer_new(cx, stream, array, args[6]);
+    if (!transfer)
+        return false;
+
+    g_input_stream_read_async(
+        G_INPUT_STREAM(stream),
+        static_cast<uint8_t*>(transfer->data) + transfer->view_offset + offset,
+        count, priority, cancellable, read_into_async_done, transfer);
+
+    args.rval().setUndefined();
+    return true;
+}
+
+// writeAllFromAsync(stream, array, offset, count, cancellable, priority,
+//                   callback)
+// callback(error, bytesWritten, array)
+GJS_JSAPI_RETURN_CONVENTION
+static bool write_all_from_async_func(JSContext* cx, unsigned argc,
+                                      JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GObject* stream;
+    JS::RootedObject array(cx);
+    uint32_t offset, count;
+    GCancellable* cancellable;
+    if (!args.requireAtLeast(cx, "write_all_from_async", 7) ||
+        !get_stream_args(cx, "write_all_from_async", args,
+                         G_TYPE_OUTPUT_STREAM, &stream, &array, &offset,
+                         &count, &cancellable))
+        return false;
+
+    int32_t priority;
+    if (!JS::ToInt32(cx, args[5], &priority))
+        return false;
+
+    GjsStreamTransfer* transfer =
+        gjs_stream_transfer_new(cx, stream, array, args[6]);
+    if (!transfer)
+        return false;
+
+    g_output_stream_write_all_async(
+        G_OUTPUT_STREAM(stream),
+        static_cast<uint8_t*>(transfer->data) + transfer->view_offset + offset,
+        count, priority, cancellable, write_all_from_async_done, transfer);
+
+    args.rval().setUndefined();
+    return true;
+}
+
+/* The legacy ByteArray class from the byteArray module is a proxy around an
+ * ordinary object of that class, which handles indexed elements and length
+ * natively. The bytes live in a Uint8Array in a reserved slot, which may be
+ * longer than the ByteArray; bytes past the end are always zero. */
+
+namespace {
+enum LegacyByteArraySlot : size_t {
+    LEGACY_STORAGE = 0,
+    LEGACY_LENGTH,
+    LEGACY_N_SLOTS
+};
+}  // namespace
+
+static const JSClass legacy_byte_array_class =
+    PROXY_CLASS_DEF("ByteArray", JSCLASS_HAS_RESERVED_SLOTS(LEGACY_N_SLOTS));
+
+class LegacyByteArrayHandler : public js::ForwardingProxyHandler {
+    static const char family;
+
+    [[nodiscard]] static uint32_t length(JSObject* proxy) {
+        return js::GetProxyReservedSlot(proxy, LEGACY_LENGTH).toPrivateUint32();
+    }
+
+    [[nodiscard]] static JSObject* storage(JSObject* proxy) {
+        return &js::GetProxyReservedSlot(proxy, LEGACY_STORAGE).toObject();
+    }
+
+    // The storage's buffer can be detached while the ByteArray still uses it,
+    // for example if the Uint8Array that the ByteArray was created from is
+    // passed to Gio.InputStream.read_into_async(). Its data is then null, so
+    // check for that before any access to the elements.
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool check_attached(JSContext* cx, JSObject* proxy) {
+        uint32_t capacity;
+        bool is_shared_memory;
+        uint8_t* retval;
+        js::GetUint8ArrayLengthAndData(storage(proxy), &capacity,
+                                       &is_shared_memory, &retval);
+        if (retval && capacity >= length(proxy))
+            return true;
+        if (!retval && length(proxy) == 0)
+            return true;  // nothing to access, and resizing replaces storage
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "ByteArray's buffer is detached");
+        return false;
+    }
+
+    [[nodiscard]] static uint8_t* data(JSObject* proxy,
+                                       const JS::AutoRequireNoGC&) {
+        uint32_t capacity;
+        bool is_shared_memory;
+        uint8_t* retval;
+        js::GetUint8ArrayLengthAndData(storage(proxy), &capacity,
+                                       &is_shared_memory, &retval);
+        return retval;
+    }
+
+    [[nodiscard]] static bool get_index(JS::HandleId id, uint32_t* index) {
+        if (!JSID_IS_INT(id) || JSID_TO_INT(id) < 0)
+            return false;
+        *index = JSID_TO_INT(id);
+        return true;
+    }
+
+    [[nodiscard]] static bool is_length(JSContext* cx, JS::HandleId id) {
+        return id == GjsContextPrivate::atoms(cx).length();
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool set_length(JSContext* cx, JS::HandleObject proxy,
+                           uint32_t new_length) {
+        if (!check_attached(cx, proxy))
+            return false;
+
+        uint32_t old_length = length(proxy);
+        uint32_t capacity = JS_GetTypedArrayLength(storage(proxy));
+
+        if (new_length > capacity) {
+            size_t new_capacity =
+                std::max(size_t(new_length), size_t(capacity) * 2);
+            if (new_capacity > UINT32_MAX)
+                new_capacity = new_length;
+            JS::RootedObject new_storage(cx,
+                                         JS_NewUint8Array(cx, new_capacity));
+            if (!new_storage)
+                return false;
+
+            JS::AutoCheckCannotGC nogc;
+            uint32_t ignored_length;
+            bool is_shared_memory;
+            uint8_t* new_data;
+            js::GetUint8ArrayLengthAndData(new_storage, &ignored_length,
+                                           &is_shared_memory, &new_data);
+            if (old_length > 0)
+                memcpy(new_data, data(proxy, nogc), old_length);
+            js::SetProxyReservedSlot(proxy, LEGACY_STORAGE,
+                                     JS::ObjectValue(*new_storage));
+        } else if (new_length < old_length) {
+            JS::AutoCheckCannotGC nogc;
+            memset(data(proxy, nogc) + new_length, 0, old_length - new_length);
+        }
+
+        js::SetProxyReservedSlot(proxy, LEGACY_LENGTH,
+                                 JS::PrivateUint32Value(new_length));
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool set_element(JSContext* cx, JS::HandleObject proxy,
+                            uint32_t index, JS::HandleValue v) {
+        uint8_t byte;
+        if (!JS::ToUint8(cx, v, &byte) || !check_attached(cx, proxy))
+            return false;
+        if (index >= length(proxy) &&
+            (index == UINT32_MAX || !set_length(cx, proxy, index + 1)))
+            return false;
+
+        JS::AutoCheckCannotGC nogc;
+        data(proxy, nogc)[index] = byte;
+        return true;
+    }
+
+ public:
+    static const LegacyByteArrayHandler singleton;
+
+    constexpr LegacyByteArrayHandler() : js::ForwardingProxyHandler(&family) {}
+
+    [[nodiscard]] static bool is_legacy_byte_array(JSObject* obj) {
+        return js::IsProxy(obj) &&
+               js::GetProxyHandler(obj)->family() == &family;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static JSObject* view(JSContext* cx, JS::HandleObject proxy) {
+        if (!check_attached(cx, proxy))
+            return nullptr;
+
+        JS::RootedObject array(cx, storage(proxy));
+        uint32_t len = length(proxy);
+        if (len == JS_GetTypedArrayLength(array))
+            return array;
+
+        bool is_shared_memory;
+        JS::RootedObject buffer(
+            cx, JS_GetArrayBufferViewBuffer(cx, array, &is_shared_memory));
+        if (!buffer)
+            return nullptr;
+        return JS_NewUint8ArrayWithBuffer(
+            cx, buffer, JS_GetTypedArrayByteOffset(array), len);
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static JSObject* create(JSContext* cx, JS::HandleObject target,
+                            JS::HandleObject array) {
+        JS::RootedValue priv(cx, JS::ObjectValue(*target));
+        js::ProxyOptions options;
+        options.setClass(&legacy_byte_array_class);
+        JS::RootedObject proxy(
+            cx, js::NewProxyObject(cx, &singleton, priv,
+                                   js::Wrapper::defaultProto, options));
+        if (!proxy)
+            return nullptr;
+
+        js::SetProxyReservedSlot(proxy, LEGACY_STORAGE,
+                                 JS::ObjectValue(*array));
+        js::SetProxyReservedSlot(
+            proxy, LEGACY_LENGTH,
+            JS::PrivateUint32Value(JS_GetTypedArrayLength(array)));
+        return proxy;
+    }
+
+    bool get(JSContext* cx, JS::HandleObject proxy, JS::HandleValue receiver,
+             JS::HandleId id, JS::MutableHandleValue vp) const override {
+        uint32_t index;
+        if (get_index(id, &index)) {
+            if (index >= length(proxy)) {
+                vp.setUndefined();
+            } else {
+                if (!check_attached(cx, proxy))
+                    return false;
+                JS::AutoCheckCannotGC nogc;
+                vp.setInt32(data(proxy, nogc)[index]);
+            }
+            return true;
+        }
+        if (is_length(cx, id)) {
+            vp.setNumber(length(proxy));
+            return true;
+        }
+        return js::ForwardingProxyHandler::get(cx, proxy, receiver, id, vp);
+    }
+
+    bool set(JSContext* cx, JS::HandleObject proxy, JS::HandleId id,
+             JS::HandleValue v, JS::HandleValue receiver,
+             JS::ObjectOpResult& result) const override {
+        uint32_t index;
+        if (get_index(id, &index)) {
+            if (!set_element(cx, proxy, index, v))
+                return false;
+            return result.succeed();
+        }
+        if (is_length(cx, id)) {
+            uint32_t new_length;
+            if (!JS::ToUint32(cx, v, &new_length) ||
+                !set_length(cx, proxy, new_length))
+                return false;
+            return result.succeed();
+        }
+        return js::ForwardingProxyHandler::set(cx, proxy, id, v, receiver,
+                                               result);
+    }
+
+    bool has(JSContext* cx, JS::HandleObject proxy, JS::HandleId id,
+             bool* bp) const override {
+        uint32_t index;
+        if (get_index(id, &index)) {
+            *bp = index < length(proxy);
+            return true;
+        }
+        if (is_length(cx, id)) {
+            *bp = true;
+            return true;
+        }
+        return js::ForwardingProxyHandler::has(cx, proxy, id, bp);
+    }
+
+    bool hasOwn(JSContext* cx, JS::HandleObject proxy, JS::HandleId id,
+                bool* bp) const override {
+        uint32_t index;
+        if (get_index(id, &index)) {
+            *bp = index < length(proxy);
+            return true;
+        }
+        if (is_length(cx, id)) {
+            *bp = true;
+            return true;
+        }
+        return js::ForwardingProxyHandler::hasOwn(cx, proxy, id, bp);
+    }
+
+    bool getOwnPropertyDescriptor(
+        JSContext* cx, JS::HandleObject proxy, JS::HandleId id,
+        JS::MutableHandle<JS::PropertyDescriptor> desc) const override {
+        uint32_t index;
+        JS::RootedValue value(cx);
+        if (get_index(id, &index)) {
+            if (index >= length(proxy)) {
+                desc.object().set(nullptr);
+                return true;
+            }
+            if (!get(cx, proxy, JS::UndefinedHandleValue, id, &value))
+                return false;
+            desc.object().set(proxy);
+            desc.setAttributes(JSPROP_ENUMERATE);
+            desc.value().set(value);
+            return true;
+        }
+        if (is_length(cx, id)) {
+            desc.object().set(proxy);
+            desc.setAttributes(JSPROP_PERMANENT);
+            desc.value().setNumber(length(proxy));
+            return true;
+        }
+        return js::ForwardingProxyHandler::getOwnPropertyDescriptor(cx, proxy,
+                                                                    id, desc);
+    }
+
+    bool defineProperty(JSContext* cx, JS::HandleObject proxy, JS::HandleId id,
+                        JS::Handle<JS::PropertyDescriptor> desc,
+                        JS::ObjectOpResult& result) const override {
+        uint32_t index;
+        bool id_is_index = get_index(id, &index);
+        if (id_is_index || is_length(cx, id)) {
+            if (desc.isAccessorDescriptor())
+                return result.failInvalidDescriptor();
+            if (!desc.hasValue())
+                return result.succeed();
+            if (id_is_index) {
+                if (!set_element(cx, proxy, index, desc.value()))
+                    return false;
+            } else {
+                uint32_t new_length;
+                if (!JS::ToUint32(cx, desc.value(), &new_length) ||
+                    !set_length(cx, proxy, new_length))
+                    return false;
+            }
+            return result.succeed();
+        }
+        return js::ForwardingProxyHandler::defineProperty(cx, proxy, id, desc,
+                                                          result);
+    }
+
+    bool delete_(JSContext* cx, JS::HandleObject proxy, JS::HandleId id,
+                 JS::ObjectOpResult& result) const override {
+        uint32_t index;
+        if (get_index(id, &index) || is_length(cx, id))
+            return result.failCantDelete();
+        return js::ForwardingProxyHandler::delete_(cx, proxy, id, result);
+    }
+
+    bool ownPropertyKeys(JSContext* cx, JS::HandleObject proxy,
+                         JS::MutableHandleIdVector props) const override {
+        uint32_t len = length(proxy);
+        if (!props.reserve(len + 1))
+            return false;
+        for (uint32_t ix = 0; ix < len; ix++)
+            props.infallibleAppend(INT_TO_JSID(ix));
+        props.infallibleAppend(GjsContextPrivate::atoms(cx).length());
+        return js::ForwardingProxyHandler::ownPropertyKeys(cx, proxy, props);
+    }
+
+    bool getOwnEnumerablePropertyKeys(
+        JSContext* cx, JS::HandleObject proxy,
+        JS::MutableHandleIdVector props) const override {
+        uint32_t len = length(proxy);
+        if (!props.reserve(len))
+            return false;
+        for (uint32_t ix = 0; ix < len; ix++)
+            props.infallibleAppend(INT_TO_JSID(ix));
+        return js::ForwardingProxyHandler::getOwnEnumerablePropertyKeys(
+            cx, proxy, props);
+    }
+
+    const char* className(JSContext*, JS::HandleObject) const override {
+        return "ByteArray";
+    }
+};
+
+const char LegacyByteArrayHandler::family = 0;
+const LegacyByteArrayHandler LegacyByteArrayHandler::singleton;
+
+// legacyWrap(target, uint8array) -> ByteArray proxy around target that uses
+// uint8array as its initial storage
+GJS_JSAPI_RETURN_CONVENTION
+static bool legacy_wrap_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject target(cx), array(cx);
+    if (!gjs_parse_call_args(cx, "legacyWrap", args, "oo", "target", &target,
+                             "array", &array))
+        return false;
+
+    if (!JS_IsUint8Array(array)) {
+        gjs_throw(cx, "Argument to legacyWrap() must be a Uint8Array");
+        return false;
+    }
+
+    JSObject* proxy = LegacyByteArrayHandler::create(cx, target, array);
+    if (!proxy)
+        return false;
+
+    args.rval().setObject(*proxy);
+    return true;
+}
+
+// legacyView(byteArray) -> Uint8Array over the bytes of a legacy ByteArray,
+// without copying
+GJS_JSAPI_RETURN_CONVENTION
+static bool legacy_view_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject byte_array(cx);
+    if (!gjs_parse_call_args(cx, "legacyView", args, "o", "byteArray",
+                             &byte_array))
+        return false;
+
+    if (!LegacyByteArrayHandler::is_legacy_byte_array(byte_array)) {
+        gjs_throw(cx, "Argument to legacyView() must be a ByteArray");
+        return false;
+    }
+
+    JSObject* view = LegacyByteArrayHandler::view(cx, byte_array);
+    if (!view)
+        return false;
+
+    args.rval().setObject(*view);
+    return true;
+}
+
 static JSFunctionSpec gjs_byte_array_module_funcs[] = {
     JS_FN("fromString", from_string_func, 2, 0),
     JS_FN("fromGBytes", from_gbytes_func, 1, 0),
     JS_FN("toGBytes", to_gbytes_func, 1, 0),
+    JS_FN("legacyView", legacy_view_func, 1, 0),
+    JS_FN("legacyWrap", legacy_wrap_func, 2, 0),
     JS_FN("toString", to_string_func, 2, 0),
+    JS_FN("readInto", read_into_func, 5, 0),
+    JS_FN("readIntoAsync", read_into_async_func, 7, 0),
+    JS_FN("writeAllFrom", write_all_from_func, 5, 0),
+    JS_FN("writeAllFromAsync", write_all_from_async_func, 7, 0),
     JS_FS_END};
 
 bool
@@ -422,5 +1207,7 @@ gjs_define_byte_array_stuff(JSContext              *cx,
                             JS::MutableHandleObject module)
 {
     module.set(JS_NewPlainObject(cx));
-    return JS_DefineFunctions(cx, module, gjs_byte_array_module_funcs);
+    JS::RootedObject string_builder_proto(cx);
+    return JS_DefineFunctions(cx, module, gjs_byte_array_module_funcs) &&
+           gjs_string_builder_define_proto(cx, module, &string_builder_proto);
 }
@@ -41,6 +41,23 @@ bool gjs_define_byte_array_stuff(JSContext              *context,
 GJS_JSAPI_RETURN_CONVENTION
 JSObject* gjs_byte_array_from_data(JSContext* cx, size_t nbytes, void* data);
 
+// Takes ownership of @data, which must have been allocated with g_malloc(), and
+// wraps it in an ArrayBuffer without copying. @data is freed even on failure.
+GJS_JSAPI_RETURN_CONVENTION
+JSObject* gjs_array_buffer_from_owned_data(JSContext* cx, size_t nbytes,
+                                           void* data);
+
+// Like gjs_array_buffer_from_owned_data(), but returns a Uint8Array with the
+// ByteArray methods
+GJS_JSAPI_RETURN_CONVENTION
+JSObject* gjs_byte_array_from_owned_data(JSContext* cx, size_t nbytes,
+                                         void* data);
+
+// Exposes the contents of @bytes to JS without copying, keeping a reference to
+// @bytes for as long as the array is alive
+GJS_JSAPI_RETURN_CONVENTION
+JSObject* gjs_byte_array_from_gbytes(JSContext* cx, GBytes* bytes);
+
 GJS_JSAPI_RETURN_CONVENTION
 JSObject *    gjs_byte_array_from_byte_array (JSContext  *context,
                                               GByteArray *array);
@@ -48,4 +65,10 @@ JSObject *    gjs_byte_array_from_byte_array (JSContext  *context,
 [[nodiscard]] GByteArray* gjs_byte_array_get_byte_array(JSObject* obj);
 [[nodiscard]] GBytes* gjs_byte_array_get_bytes(JSObject* obj);
 
+// Moves the memory of the whole ArrayBuffer under @obj into a GBytes without
+// copying, leaving the buffer detached. Copies instead if @obj only views part
+// of a buffer, or views a shared one.
+GJS_JSAPI_RETURN_CONVENTION
+GBytes* gjs_byte_array_steal_bytes(JSContext* cx, JS::HandleObject obj);
+
 #endif  // GJS_BYTEARRAY_H_
@@ -0,0 +1,480 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <glib.h>
+
+#ifdef G_OS_UNIX
+
+#    include <errno.h>
+#    include <fcntl.h>   // for fcntl, F_DUPFD_CLOEXEC
+#    include <signal.h>  // for sigaction, kill, SIGINT, SIGTERM...
+#    include <stdint.h>
+#    include <stdlib.h>  // for exit
+#    include <string.h>  // for memcpy, memset, strchr, strlen, strncmp
+#    include <sys/socket.h>
+#    include <sys/stat.h>  // for lstat, umask, S_ISSOCK
+#    include <sys/types.h>
+#    include <sys/un.h>    // for sockaddr_un
+#    include <sys/wait.h>  // for waitpid, WIFEXITED...
+#    include <unistd.h>
+
+#    include <string>
+#    include <vector>
+
+#    include <girepository.h>
+#    include <glib-object.h>
+
+#    include <cjs/gjs.h>
+
+#    include "cjs/console-zygote.h"
+
+/* Protocol: the client sends a RequestHeader, with its stdin, stdout and
+ * stderr attached as SCM_RIGHTS, followed by data_size bytes of
+ * NUL-terminated strings: the working directory, n_args arguments and n_env
+ * environment entries. The server replies with the worker's PID as an
+ * int32_t, so that the client can forward signals, and once the worker has
+ * finished, with its exit status as an int32_t. The server may close the
+ * connection without replying if it can't run the program. */
+struct RequestHeader {
+    uint32_t version;
+    uint32_t n_args;
+    uint32_t n_env;
+    uint32_t data_size;
+};
+
+static constexpr uint32_t REQUEST_VERSION = 1;
+static constexpr uint32_t MAX_REQUEST_SIZE = 4 * 1024 * 1024;
+static constexpr int N_STDIO_FDS = 3;
+
+[[nodiscard]] static bool write_all(int fd, const void* buf, size_t len) {
+    auto* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+[[nodiscard]] static bool read_all(int fd, void* buf, size_t len) {
+    auto* p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+[[nodiscard]] static bool fill_address(const char* path,
+                                       struct sockaddr_un* addr) {
+    size_t len = strlen(path);
+    if (len >= sizeof(addr->sun_path))
+        return false;
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, path, len + 1);
+    return true;
+}
+
+/* Client */
+
+static volatile sig_atomic_t worker_pid = 0;
+
+static void forward_signal(int signum) {
+    pid_t pid = worker_pid;
+    if (pid > 0)
+        kill(pid, signum);
+}
+
+void gjs_console_zygote_try_run(const char* path, int argc, char** argv) {
+    struct sockaddr_un addr;
+    if (!fill_address(path, &addr))
+        return;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return;
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+        0) {
+        close(fd);
+        return;
+    }
+
+    std::string data;
+    char* cwd = g_get_current_dir();
+    data.append(cwd).push_back('\0');
+    g_free(cwd);
+    for (int ix = 0; ix < argc; ix++)
+        data.append(argv[ix]).push_back('\0');
+    char** env = g_get_environ();
+    unsigned n_env = g_strv_length(env);
+    for (unsigned ix = 0; ix < n_env; ix++)
+        data.append(env[ix]).push_back('\0');
+    g_strfreev(env);
+
+    if (data.size() > MAX_REQUEST_SIZE) {
+        close(fd);
+        return;
+    }
+
+    RequestHeader header = {REQUEST_VERSION, unsigned(argc), n_env,
+                            uint32_t(data.size())};
+    int fds[N_STDIO_FDS] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov = {&header, sizeof(header)};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+
+    // Until the server says it has started the program, it's still fine to
+    // run it here instead
+    int32_t pid;
+    if (sent < 0 ||
+        !write_all(fd, reinterpret_cast<char*>(&header) + sent,
+                   sizeof(header) - sent) ||
+        !write_all(fd, data.data(), data.size()) ||
+        !read_all(fd, &pid, sizeof(pid))) {
+        close(fd);
+        return;
+    }
+
+    worker_pid = pid;
+    struct sigaction action = {};
+    action.sa_handler = forward_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    for (int signum : {SIGHUP, SIGINT, SIGQUIT, SIGTERM})
+        sigaction(signum, &action, nullptr);
+
+    int32_t status;
+    if (!read_all(fd, &status, sizeof(status))) {
+        g_printerr("Lost the connection to the zygote server at %s\n", path);
+        exit(1);
+    }
+    exit(status);
+}
+
+/* Server */
+
+/* Work that every program does before it starts running, and that can be
+ * shared with the forked workers. No JS context is created here: the JS
+ * engine's helper threads would not survive fork(). That still leaves
+ * exec(), dynamic linking and relocation of the JS engine, and mapping the
+ * core typelibs, out of each program's startup. */
+static void preload(void) {
+    // Also puts CjsPrivate on the typelib search path
+    g_type_class_unref(g_type_class_ref(GJS_TYPE_CONTEXT));
+
+    static const struct {
+        const char* ns;
+        const char* version;
+    } typelibs[] = {
+        {"GLib", "2.0"},
+        {"GObject", "2.0"},
+        {"Gio", "2.0"},
+        {"CjsPrivate", "1.0"},
+    };
+    for (const auto& typelib : typelibs) {
+        GError* error = nullptr;
+        if (!g_irepository_require(nullptr, typelib.ns, typelib.version,
+                                   GIRepositoryLoadFlags(0), &error)) {
+            g_warning("Could not preload %s-%s: %s", typelib.ns,
+                      typelib.version, error->message);
+            g_clear_error(&error);
+        }
+    }
+}
+
+[[nodiscard]] static bool peer_is_same_user(int conn) {
+#    ifdef SO_PEERCRED
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+        return false;
+    return cred.uid == geteuid();
+#    else
+    // The socket is only accessible to this user anyway
+    (void)conn;
+    return true;
+#    endif
+}
+
+[[nodiscard]] static bool receive_header(int conn, RequestHeader* header,
+                                         int* fds) {
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int) * N_STDIO_FDS)];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov = {header, sizeof(*header)};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t received;
+    do {
+        received = recvmsg(conn, &msg, 0);
+    } while (received < 0 && errno == EINTR);
+    if (received <= 0)
+        return false;
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+        cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int) * N_STDIO_FDS))
+        return false;
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * N_STDIO_FDS);
+
+    // Keep them clear of the numbers that they will be moved to
+    for (int ix = 0; ix < N_STDIO_FDS; ix++) {
+        if (fds[ix] < N_STDIO_FDS)
+            fds[ix] = fcntl(fds[ix], F_DUPFD_CLOEXEC, N_STDIO_FDS);
+        if (fds[ix] < 0)
+            return false;
+    }
+
+    return read_all(conn, reinterpret_cast<char*>(header) + received,
+                    sizeof(*header) - received);
+}
+
+static void replace_environment(const std::vector<const char*>& env) {
+    char** names = g_listenv();
+    for (char** name = names; *name; name++)
+        g_unsetenv(*name);
+    g_strfreev(names);
+
+    for (const char* entry : env) {
+        const char* equals = strchr(entry, '=');
+        if (!equals)
+            continue;
+        char* name = g_strndup(entry, equals - entry);
+        g_setenv(name, equals + 1, true);
+        g_free(name);
+    }
+}
+
+/* The server has already loaded libraries and typelibs using these, so a
+ * client that sets them differently would not get what it asked for. */
+static constexpr const char* PRELOAD_VARIABLES[] = {
+    "GI_TYPELIB_PATH",
+    "LD_LIBRARY_PATH",
+    "LD_PRELOAD",
+};
+
+[[nodiscard]] static bool preload_environment_matches(
+    const std::vector<const char*>& env) {
+    for (const char* variable : PRELOAD_VARIABLES) {
+        size_t len = strlen(variable);
+        const char* value = nullptr;
+        for (const char* entry : env) {
+            if (strncmp(entry, variable, len) == 0 && entry[len] == '=') {
+                value = entry + len + 1;
+                break;
+            }
+        }
+        if (g_strcmp0(value, g_getenv(variable)) != 0)
+            return false;
+    }
+    return true;
+}
+
+/* Runs in the process forked for one request. Reads the request and forks
+ * the worker, then waits for it and reports its exit status. Only the worker
+ * returns from this. */
+static void handle_request(int conn, int* argc_p, char*** argv_p) {
+    RequestHeader header;
+    int fds[N_STDIO_FDS];
+    if (!receive_header(conn, &header, fds) ||
+        header.version != REQUEST_VERSION ||
+        header.data_size > MAX_REQUEST_SIZE)
+        _exit(1);
+
+    std::vector<char> data(header.data_size);
+    if (!read_all(conn, data.data(), data.size()) || data.empty() ||
+        data.back() != '\0')
+        _exit(1);
+
+    std::vector<const char*> strings;
+    for (size_t ix = 0; ix < data.size(); ix += strlen(&data[ix]) + 1)
+        strings.push_back(&data[ix]);
+    if (strings.size() != 1 + size_t(header.n_args) + header.n_env ||
+        header.n_args == 0)
+        _exit(1);
+
+    // Closing the connection before sending the PID makes the client run the
+    // program itself
+    auto env_begin = strings.begin() + 1 + header.n_args;
+    if (!preload_environment_matches({env_begin, strings.end()}))
+        _exit(1);
+
+    pid_t pid = fork();
+    if (pid < 0)
+        _exit(1);
+
+    if (pid == 0) {
+        close(conn);
+        for (int ix = 0; ix < N_STDIO_FDS; ix++) {
+            if (dup2(fds[ix], ix) < 0)
+                _exit(1);
+            if (fds[ix] >= N_STDIO_FDS)
+                close(fds[ix]);
+        }
+
+        if (chdir(strings[0]) < 0) {
+            g_printerr("Could not change to directory %s: %s\n", strings[0],
+                       g_strerror(errno));
+            _exit(1);
+        }
+
+        auto args_begin = strings.begin() + 1;
+        replace_environment({env_begin, strings.end()});
+
+        char** argv = g_new(char*, header.n_args + 1);
+        for (uint32_t ix = 0; ix < header.n_args; ix++)
+            argv[ix] = g_strdup(args_begin[ix]);
+        argv[header.n_args] = nullptr;
+        *argc_p = header.n_args;
+        *argv_p = argv;
+        return;
+    }
+
+    for (int fd : fds)
+        close(fd);
+
+    int32_t pid32 = pid;
+    int status;
+    if (!write_all(conn, &pid32, sizeof(pid32))) {
+        // The client is gone, nobody will see the program's output
+        kill(pid, SIGTERM);
+    }
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            _exit(1);
+    }
+
+    // Same convention as the shell for programs killed by a signal
+    int32_t code = 1;
+    if (WIFEXITED(status))
+        code = WEXITSTATUS(status);
+    else if (WIFSIGNALED(status))
+        code = 128 + WTERMSIG(status);
+    (void)write_all(conn, &code, sizeof(code));
+    _exit(0);
+}
+
+void gjs_console_zygote_serve(const char* path, int* argc_p, char*** argv_p) {
+    struct sockaddr_un addr;
+    if (!fill_address(path, &addr)) {
+        g_printerr("Zygote socket path is too long: %s\n", path);
+        exit(1);
+    }
+
+    preload();
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        g_printerr("Could not create zygote socket: %s\n", g_strerror(errno));
+        exit(1);
+    }
+
+    // Replace a socket left behind by a server that didn't exit cleanly, but
+    // nothing else
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+
+    mode_t old_umask = umask(0077);
+    int result = bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr),
+                      sizeof(addr));
+    umask(old_umask);
+    if (result < 0 || listen(listen_fd, SOMAXCONN) < 0) {
+        g_printerr("Could not listen on %s: %s\n", path, g_strerror(errno));
+        exit(1);
+    }
+
+    // The processes forked for each request are never waited for
+    struct sigaction action = {};
+    action.sa_handler = SIG_IGN;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, nullptr);
+
+    while (true) {
+        int conn = accept(listen_fd, nullptr, nullptr);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            g_printerr("Could not accept on %s: %s\n", path, g_strerror(errno));
+            exit(1);
+        }
+
+        if (!peer_is_same_user(conn)) {
+            close(conn);
+            continue;
+        }
+
+        pid_t pid = fork();
+        if (pid != 0) {
+            close(conn);
+            continue;
+        }
+
+        close(listen_fd);
+        action.sa_handler = SIG_DFL;
+        sigaction(SIGCHLD, &action, nullptr);
+        handle_request(conn, argc_p, argv_p);
+        return;
+    }
+}
+
+#endif  // G_OS_UNIX
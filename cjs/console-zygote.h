@@ -0,0 +1,47 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_CONSOLE_ZYGOTE_H_
+#define GJS_CONSOLE_ZYGOTE_H_
+
+#include <config.h>
+
+#include <glib.h>
+
+#ifdef G_OS_UNIX
+
+/* Runs the zygote server on a UNIX socket at @path until it is killed. Each
+ * request is answered by forking a worker process, in which this function
+ * returns with @argc_p and @argv_p replaced by the client's command line, and
+ * with the client's environment, working directory and standard streams. */
+void gjs_console_zygote_serve(const char* path, int* argc_p, char*** argv_p);
+
+/* Asks the zygote server at @path to run this command line, and exits with
+ * the exit status of the program once it has finished. Returns only if the
+ * server couldn't be reached, in which case the program should be run in
+ * this process as usual. */
+void gjs_console_zygote_try_run(const char* path, int argc, char** argv);
+
+#endif  // G_OS_UNIX
+
+#endif  // GJS_CONSOLE_ZYGOTE_H_
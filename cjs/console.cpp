@@ -39,6 +39,8 @@
 
 #include <cjs/gjs.h>
 
+#include "cjs/console-zygote.h"
+
 static char **include_path = NULL;
 static char **coverage_prefixes = NULL;
 static char *coverage_output_path = NULL;
@@ -48,8 +50,16 @@ static gboolean print_version = false;
 static gboolean print_js_version = false;
 static gboolean debugging = false;
 static bool enable_profiler = false;
+static gboolean startup_profile = false;
+static gboolean fast_exit = false;
+static char* profile_allocations = nullptr;
+#ifdef G_OS_UNIX
+static char* zygote_serve_path = nullptr;
+#endif
 
 static gboolean parse_profile_arg(const char *, const char *, void *, GError **);
+static gboolean parse_profile_allocations_arg(const char*, const char*, void*,
+                                              GError**);
 
 // clang-format off
 static GOptionEntry entries[] = {
@@ -64,7 +74,22 @@ static GOptionEntry entries[] = {
         G_OPTION_ARG_CALLBACK, reinterpret_cast<void *>(&parse_profile_arg),
         "Enable the profiler and write output to FILE (default: gjs-$PID.syscap)",
         "FILE" },
+    { "profile-allocations", 0, G_OPTION_FLAG_OPTIONAL_ARG,
+        G_OPTION_ARG_CALLBACK,
+        reinterpret_cast<void*>(&parse_profile_allocations_arg),
+        "Also record the stack of one in every N object allocations when "
+        "profiling (default: 100)", "N" },
     { "debugger", 'd', 0, G_OPTION_ARG_NONE, &debugging, "Start in debug mode" },
+    { "startup-profile", 0, 0, G_OPTION_ARG_NONE, &startup_profile,
+        "Print where the time went before the program started running" },
+    { "fast-exit", 0, 0, G_OPTION_ARG_NONE, &fast_exit,
+        "Exit without tearing down the JS engine, after writing any output" },
+#ifdef G_OS_UNIX
+    { "zygote-serve", 0, 0, G_OPTION_ARG_FILENAME, &zygote_serve_path,
+        "Listen on SOCKET and run the programs of cjs-console invocations that "
+        "have GJS_ZYGOTE=SOCKET set, in preloaded processes forked from this "
+        "one (must be the first option)", "SOCKET" },
+#endif
     { NULL }
 };
 // clang-format on
@@ -110,6 +135,21 @@ static gboolean parse_profile_arg(const char* option_name [[maybe_unused]],
     return true;
 }
 
+static gboolean parse_profile_allocations_arg(const char* option_name,
+                                              const char* value, void*,
+                                              GError** error) {
+    if (value && !g_ascii_string_to_unsigned(value, 10, 1, G_MAXUINT, nullptr,
+                                             error)) {
+        g_prefix_error(error, "%s: ", option_name);
+        return false;
+    }
+
+    enable_profiler = true;
+    g_free(profile_allocations);
+    profile_allocations = g_strdup(value ? value : "");
+    return true;
+}
+
 static void
 check_script_args_for_stray_gjs_args(int           argc,
                                      char * const *argv)
@@ -208,6 +248,7 @@ main(int argc, char **argv)
     GjsContext *js_context;
     GjsCoverage *coverage = NULL;
     char *script;
+    GMappedFile* mapped_script = nullptr;
     const char *filename;
     const char *program_name;
     gsize len;
@@ -218,6 +259,20 @@ main(int argc, char **argv)
     const char *env_coverage_output_path;
     bool interactive_mode = false;
 
+#ifdef G_OS_UNIX
+    // The zygote server only returns in a forked worker, with the command
+    // line of a program to run
+    if (argc >= 2 && g_str_has_prefix(argv[1], "--zygote-serve=")) {
+        gjs_console_zygote_serve(argv[1] + strlen("--zygote-serve="), &argc,
+                                 &argv);
+        g_strfreev(argv_copy);
+        argv_copy_addr = argv_copy = g_strdupv(argv);
+        gjs_argc = argc;
+    } else if (const char* zygote_path = g_getenv("GJS_ZYGOTE")) {
+        gjs_console_zygote_try_run(zygote_path, argc, argv);
+    }
+#endif
+
     setlocale(LC_ALL, "");
 
     context = g_option_context_new(NULL);
@@ -259,6 +314,8 @@ main(int argc, char **argv)
     print_version = false;
     print_js_version = false;
     debugging = false;
+    startup_profile = false;
+    fast_exit = false;
     g_option_context_set_ignore_unknown_options(context, false);
     g_option_context_set_help_enabled(context, true);
     if (!g_option_context_parse_strv(context, &gjs_argv, &error)) {
@@ -271,6 +328,13 @@ main(int argc, char **argv)
 
     g_option_context_free (context);
 
+#ifdef G_OS_UNIX
+    if (zygote_serve_path) {
+        g_printerr("--zygote-serve=SOCKET must be the first option\n");
+        exit(1);
+    }
+#endif
+
     if (print_version) {
         g_print("%s\n", PACKAGE_STRING);
         exit(0);
@@ -297,10 +361,15 @@ main(int argc, char **argv)
         /* All unprocessed options should be in script_argv */
         g_assert(gjs_argc == 2);
         error = NULL;
-        if (!g_file_get_contents(gjs_argv[1], &script, &len, &error)) {
+        // Mapped rather than read, so that the JS engine can compile large
+        // programs in place
+        mapped_script = g_mapped_file_new(gjs_argv[1], false, &error);
+        if (!mapped_script) {
             g_printerr("%s\n", error->message);
             exit(1);
         }
+        len = g_mapped_file_get_length(mapped_script);
+        script = nullptr;
         filename = gjs_argv[1];
         program_name = gjs_argv[1];
     }
@@ -334,6 +403,13 @@ main(int argc, char **argv)
     if (coverage_prefixes)
         gjs_coverage_enable();
 
+    if (startup_profile)
+        g_setenv("GJS_STARTUP_PROFILE", "1", true);
+    if (fast_exit)
+        g_setenv("GJS_FAST_EXIT", "1", true);
+    if (enable_profiler && profile_allocations)
+        g_setenv("GJS_PROFILE_ALLOCATIONS", profile_allocations, true);
+
     js_context = (GjsContext*) g_object_new(GJS_TYPE_CONTEXT,
                                             "search-path", include_path,
                                             "program-name", program_name,
@@ -374,22 +450,32 @@ main(int argc, char **argv)
     if (debugging)
         gjs_context_setup_debugger_console(js_context);
 
+    const char* script_data = script;
+    if (mapped_script)
+        script_data = len > 0 ? g_mapped_file_get_contents(mapped_script) : "";
     int code = define_argv_and_eval_script(js_context, script_argc, script_argv,
-                                           script, len, filename);
+                                           script_data, len, filename);
 
     g_strfreev(gjs_argv_addr);
 
+    // Coverage statistics are written by the context's exit hook
+    if (fast_exit)
+        gjs_context_exit_fast(js_context, code);
+
     /* Probably doesn't make sense to write statistics on failure */
     if (coverage && code == 0)
         gjs_coverage_write_statistics(coverage);
 
     g_free(coverage_output_path);
     g_free(profile_output_path);
+    g_free(profile_allocations);
     g_strfreev(coverage_prefixes);
     if (coverage)
         g_object_unref(coverage);
     g_object_unref(js_context);
     g_free(script);
+    if (mapped_script)
+        g_mapped_file_unref(mapped_script);
 
     if (debugging)
         g_print("Program exited with code %d\n", code);
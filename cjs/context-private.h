@@ -26,16 +26,22 @@
 
 #include <config.h>
 
+#include <stddef.h>  // for size_t
 #include <stdint.h>
 #include <sys/types.h>  // for ssize_t
 
-#include <type_traits>  // for is_same
+#include <string>
 #include <unordered_map>
+#include <utility>  // for pair
+#include <vector>
 
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 
+#include <js/GCAPI.h>  // for GCDescription, GCProgress, GCNurseryProgress
 #include <js/GCHashTable.h>
+#include <js/CompileOptions.h>
 #include <js/GCVector.h>
 #include <js/Promise.h>
 #include <js/RootingAPI.h>
@@ -46,33 +52,50 @@
 #include <mozilla/HashTable.h>  // for DefaultHasher
 #include <mozilla/UniquePtr.h>
 
+#include "cjs/arena.h"
 #include "cjs/context.h"
+#include "cjs/engine.h"
+#include "cjs/gettext.h"
+#include "cjs/job-queue.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
 #include "cjs/profiler.h"
+#include "cjs/root-set.h"
+#include "cjs/slab.h"
+#include "cjs/string-cache.h"
+#include "cjs/timers.h"
+#include "gi/callback-queue.h"
+#include "gi/toggle.h"
+#include "modules/format.h"
 
 namespace js {
 class SystemAllocPolicy;
 }
 class GjsAtoms;
+class GjsWorker;
 class JSTracer;
 
-using JobQueueStorage =
-    JS::GCVector<JS::Heap<JSObject*>, 0, js::SystemAllocPolicy>;
 using ObjectInitList =
     JS::GCVector<JS::Heap<JSObject*>, 0, js::SystemAllocPolicy>;
 using FundamentalTable =
     JS::GCHashMap<void*, JS::Heap<JSObject*>, js::DefaultHasher<void*>,
                   js::SystemAllocPolicy>;
-using GTypeTable =
-    JS::GCHashMap<GType, JS::Heap<JSObject*>, js::DefaultHasher<GType>,
-                  js::SystemAllocPolicy>;
-
-struct Dummy {};
-using GTypeNotUint64 =
-    std::conditional_t<!std::is_same_v<GType, uint64_t>, GType, Dummy>;
+// Values are weak pointers, updated after each GC. Nodes of std::unordered_map
+// never move, so GType qdata can point straight at a value; see gi/gtype.cpp.
+using GTypeTable = std::unordered_map<GType, JS::Heap<JSObject*>>;
+// The same for GParamSpec wrappers and GParamSpec qdata; see gi/param.cpp.
+using ParamTable = std::unordered_map<GParamSpec*, JS::Heap<JSObject*>>;
+
+// Direct-mapped cache in front of the FundamentalTable, for fundamentals that
+// cross into JS over and over, such as buffers and caps in a GStreamer
+// pipeline. Like the table's values, the wrappers are weak; they are updated
+// or cleared after each GC, see gi/fundamental.cpp.
+struct GjsRecentFundamental {
+    void* ptr;
+    JS::Heap<JSObject*> wrapper;
+};
 
-// The GC sweep method should ignore FundamentalTable and GTypeTable's key types
+// The GC sweep method should ignore FundamentalTable's key type
 namespace JS {
 // Forward declarations
 template <typename T>
@@ -82,35 +105,80 @@ struct GCPolicy;
 
 template <>
 struct GCPolicy<void*> : public IgnoreGCPolicy<void*> {};
-// We need GCPolicy<GType> for GTypeTable. SpiderMonkey already defines
-// GCPolicy<uint64_t> which is equal to GType on some systems; for others we
-// need to define it. (macOS's uint64_t is unsigned long long, which is a
-// different type from unsigned long, even if they are the same width)
-template <>
-struct GCPolicy<GTypeNotUint64> : public IgnoreGCPolicy<GTypeNotUint64> {};
 }  // namespace JS
 
+// How the full GC that follows toggle refs going down is run
+enum class GjsGCPolicy : uint8_t {
+    // In slices from the main loop's idle time, or after a frame when the
+    // embedder reports an idle budget
+    INCREMENTAL,
+    // All at once, blocking the main loop
+    FULL,
+};
+
+// Called when the process exits without tearing down the context, see
+// GjsContextPrivate::fast_exit()
+using GjsExitHook = void (*)(uint8_t exit_code, void* data);
+
+// How much of a script's source SpiderMonkey keeps, and how eagerly it compiles
+// the script's functions; chosen per path prefix with System.setSourcePolicy()
+enum class GjsSourcePolicy : uint8_t {
+    // Source kept in memory; functions are syntax-parsed, and compiled when
+    // they are first called
+    DEFAULT,
+    // Source not kept; it is read back from the file when needed, such as
+    // when a function is first called, or by toString()
+    LAZY,
+    // Source kept; all functions are compiled up front, which is faster for
+    // modules whose functions are nearly all called
+    EAGER,
+};
+
 class GjsContextPrivate : public JS::JobQueue {
     GjsContext* m_public_context;
     JSContext* m_cx;
     JS::Heap<JSObject*> m_global;
     GThread* m_owner_thread;
+    // Main context of the thread the context was created on, which all of
+    // its sources are attached to
+    GMainContext* m_main_context;
+    // Set if this is the context of a worker thread
+    GjsWorker* m_worker = nullptr;
 
     char* m_program_name;
 
     char** m_search_path;
 
     unsigned m_auto_gc_id;
+    unsigned m_gc_slice_id;
+    int64_t m_gc_slice_budget_usec;
+    int64_t m_frame_deadline;
+    // Shrinking GC once the program has been idle this long, or 0 for never
+    int64_t m_idle_shrink_delay_usec = 0;
+    int64_t m_last_activity_usec = 0;
+    unsigned m_idle_shrink_id = 0;
+    bool m_active_since_shrink = false;
+    GjsGCPolicy m_gc_policy;
+    GjsTuningProfile m_tuning_profile;
 
     GjsAtoms* m_atoms;
 
-    JobQueueStorage m_job_queue;
+    GjsJobQueue m_job_queue;
     unsigned m_idle_drain_handler;
+    int m_job_queue_priority;
+    int64_t m_job_queue_budget_usec;
 
     std::unordered_map<uint64_t, GjsAutoChar> m_unhandled_rejection_stacks;
 
+    // Longest prefix wins
+    std::vector<std::pair<std::string, GjsSourcePolicy>> m_source_policies;
+
     GjsProfiler* m_profiler;
 
+#if GLIB_CHECK_VERSION(2, 64, 0)
+    GMemoryMonitor* m_memory_monitor;
+#endif
+
     /* Environment preparer needed for debugger, taken from SpiderMonkey's
      * JS shell */
     struct EnvironmentPreparer final : protected js::ScriptEnvironmentPreparer {
@@ -126,15 +194,50 @@ class GjsContextPrivate : public JS::JobQueue {
 
     // Weak pointer mapping from fundamental native pointer to JSObject
     JS::WeakCache<FundamentalTable>* m_fundamental_table;
-    JS::WeakCache<GTypeTable>* m_gtype_table;
+    static constexpr size_t N_RECENT_FUNDAMENTALS = 64;
+    GjsRecentFundamental m_recent_fundamentals[N_RECENT_FUNDAMENTALS] = {};
+    // Weak pointers to fundamental prototypes, by the GType they were looked
+    // up for
+    GTypeTable m_fundamental_proto_table;
+    GTypeTable m_gtype_table;
+    ParamTable m_param_table;
 
     // List that holds JSObject GObject wrappers for JS-created classes, from
     // the time of their creation until their GObject instance init function is
     // called
     ObjectInitList m_object_init_list;
 
+    // Temporary storage for introspected function calls
+    GjsArena m_call_arena;
+
+    // JS strings for short strings returned from introspected functions
+    GjsStringCache m_string_cache;
+    GjsGettextCache m_gettext_cache;
+    GjsFormatCache m_format_cache;
+
+    // Roots of GjsMaybeOwned wrappers
+    GjsRootSet m_root_set;
+
+    // C memory for small structs allocated by boxed wrappers
+    GjsSlab m_boxed_slab;
+
+    // Timers of setTimeout() and setInterval()
+    GjsTimerQueue m_timers;
+
+    // Toggles of the GObjects wrapped in this context
+    ToggleQueue m_toggle_queue;
+
+    // JS callbacks invoked on other threads, waiting to run on this one
+    GjsCallbackQueue m_thread_callbacks;
+
+    // Attaches the debugger, if GJS_DEBUGGER_ATTACH_SIGNAL is set
+    unsigned m_debugger_signal_id;
+
     uint8_t m_exit_code;
 
+    // Flushing the output of objects outside the context, such as coverage
+    std::vector<std::pair<GjsExitHook, void*>> m_exit_hooks;
+
     /* flags */
     bool m_destroying : 1;
     bool m_in_gc_sweep : 1;
@@ -143,11 +246,49 @@ class GjsContextPrivate : public JS::JobQueue {
     bool m_draining_job_queue : 1;
     bool m_should_profile : 1;
     bool m_should_listen_sigusr2 : 1;
+    bool m_debugger_attached : 1;
+    bool m_fast_exit : 1;
 
     int64_t m_sweep_begin_time;
+    // For the GC marks in the profiler capture, in nanoseconds; the budget
+    // is that of the slice GJS is running from the main loop, if any
+    int64_t m_gc_cycle_begin_time;
+    int64_t m_gc_slice_begin_time;
+    int64_t m_minor_gc_begin_time;
+    int64_t m_finalize_begin_time;
+    int64_t m_requested_slice_budget_ms;
+
+    // Where the time went before the first script started running, collected
+    // when GJS_STARTUP_PROFILE is set. Phases that are nested inside another
+    // one, such as native module initialization, are printed separately.
+    struct StartupPhase {
+        std::string name;
+        int64_t usec;
+        bool nested;
+    };
+    std::vector<StartupPhase> m_startup_phases;
+    int64_t m_startup_engine_usec;
+    int64_t m_startup_mark;
+    bool m_startup_done : 1;
+
+    // Attaches @source, with this context as its data, to the context's own
+    // main context, which for a worker is not the global default one
+    unsigned attach_source(GSource* source, int priority, GSourceFunc func);
+    void remove_source(unsigned id);
 
     void schedule_gc_internal(bool force_gc);
     static gboolean trigger_gc_if_needed(void* data);
+    [[nodiscard]] int64_t gc_slice_budget() const;
+    void run_gc_slice(int64_t budget_usec);
+    void schedule_gc_slice(void);
+    static gboolean trigger_gc_slice(void* data);
+    static gboolean trigger_idle_shrink(void* data);
+#if GLIB_CHECK_VERSION(2, 64, 0)
+    void ensure_memory_monitor(void);
+    static void on_low_memory_warning(GMemoryMonitor*,
+                                      GMemoryMonitorWarningLevel level,
+                                      void* data);
+#endif
 
     class SavedQueue;
     void start_draining_job_queue(void);
@@ -156,6 +297,8 @@ class GjsContextPrivate : public JS::JobQueue {
 
     void warn_about_unhandled_promise_rejections(void);
 
+    void print_startup_profile(void);
+
     class AutoResetExit {
         GjsContextPrivate* m_self;
 
@@ -177,6 +320,7 @@ class GjsContextPrivate : public JS::JobQueue {
     [[nodiscard]] static GjsContextPrivate* from_object(
         GjsContext* public_context);
     [[nodiscard]] static GjsContextPrivate* from_current_context();
+    [[nodiscard]] static GjsContextPrivate* primary();
 
     GjsContextPrivate(JSContext* cx, GjsContext* public_context);
     ~GjsContextPrivate(void);
@@ -188,28 +332,74 @@ class GjsContextPrivate : public JS::JobQueue {
     [[nodiscard]] JSContext* context() const { return m_cx; }
     [[nodiscard]] JSObject* global() const { return m_global.get(); }
     [[nodiscard]] GjsProfiler* profiler() const { return m_profiler; }
+    [[nodiscard]] GjsProfiler* ensure_profiler();
     [[nodiscard]] const GjsAtoms& atoms() const { return *m_atoms; }
     [[nodiscard]] bool destroying() const { return m_destroying; }
     [[nodiscard]] bool sweeping() const { return m_in_gc_sweep; }
     [[nodiscard]] const char* program_name() const { return m_program_name; }
     void set_program_name(char* value) { m_program_name = value; }
     void set_search_path(char** value) { m_search_path = value; }
+    [[nodiscard]] char** search_path() const { return m_search_path; }
+    [[nodiscard]] GMainContext* main_context() const { return m_main_context; }
+    [[nodiscard]] GjsWorker* worker() const { return m_worker; }
+    void set_worker(GjsWorker* worker) { m_worker = worker; }
+    // The primary context is the first one created in the process that is
+    // still alive. GObject wrappers, the toggle queue, and the rest of the GI
+    // state that the process shares belong to it; other contexts, such as
+    // workers', run plain JS.
+    [[nodiscard]] bool is_primary() const { return primary() == this; }
+    [[nodiscard]] GjsTuningProfile tuning_profile() const {
+        return m_tuning_profile;
+    }
+    void set_tuning_profile(GjsTuningProfile value) {
+        m_tuning_profile = value;
+    }
     void set_should_profile(bool value) { m_should_profile = value; }
+    [[nodiscard]] static bool startup_profile_enabled(void);
+    void set_startup_engine_time(int64_t usec) {
+        m_startup_engine_usec = usec;
+    }
+    void mark_startup_phase(const char* name);
+    void record_nested_startup_time(const char* name, int64_t usec);
     void set_should_listen_sigusr2(bool value) {
         m_should_listen_sigusr2 = value;
     }
+    // The debugger shows the source as it was when the script was compiled
+    [[nodiscard]] bool debugger_attached() const {
+        return m_debugger_attached;
+    }
+    void set_debugger_attached() { m_debugger_attached = true; }
     [[nodiscard]] bool is_owner_thread() const {
         return m_owner_thread == g_thread_self();
     }
     [[nodiscard]] JS::WeakCache<FundamentalTable>& fundamental_table() {
         return *m_fundamental_table;
     }
-    [[nodiscard]] JS::WeakCache<GTypeTable>& gtype_table() {
-        return *m_gtype_table;
+    [[nodiscard]] GjsRecentFundamental* recent_fundamentals() {
+        return m_recent_fundamentals;
+    }
+    [[nodiscard]] static constexpr size_t n_recent_fundamentals() {
+        return N_RECENT_FUNDAMENTALS;
+    }
+    [[nodiscard]] GTypeTable& fundamental_proto_table() {
+        return m_fundamental_proto_table;
     }
+    [[nodiscard]] GTypeTable& gtype_table() { return m_gtype_table; }
+    [[nodiscard]] ParamTable& param_table() { return m_param_table; }
     [[nodiscard]] ObjectInitList& object_init_list() {
         return m_object_init_list;
     }
+    [[nodiscard]] GjsArena* call_arena() { return &m_call_arena; }
+    [[nodiscard]] GjsStringCache& string_cache() { return m_string_cache; }
+    [[nodiscard]] GjsGettextCache& gettext_cache() { return m_gettext_cache; }
+    [[nodiscard]] GjsFormatCache& format_cache() { return m_format_cache; }
+    [[nodiscard]] GjsRootSet& root_set() { return m_root_set; }
+    [[nodiscard]] GjsSlab* boxed_slab() { return &m_boxed_slab; }
+    [[nodiscard]] GjsTimerQueue& timers() { return m_timers; }
+    [[nodiscard]] ToggleQueue& toggle_queue() { return m_toggle_queue; }
+    [[nodiscard]] GjsCallbackQueue& thread_callbacks() {
+        return m_thread_callbacks;
+    }
     [[nodiscard]] static const GjsAtoms& atoms(JSContext* cx) {
         return *(from_cx(cx)->m_atoms);
     }
@@ -226,11 +416,25 @@ class GjsContextPrivate : public JS::JobQueue {
                        const JS::HandleValueArray& args,
                        JS::MutableHandleValue rval);
 
+    void set_source_policy(const char* path_prefix, GjsSourcePolicy policy);
+    void apply_source_policy(const char* filename,
+                             JS::CompileOptions* options) const;
+
     void schedule_gc(void) { schedule_gc_internal(true); }
     void schedule_gc_if_needed(void);
+    void notify_idle_budget(int64_t budget_usec);
+    void notify_idle(void);
+    void shrink_heap(void);
+    void set_frame_deadline(int64_t deadline_usec) {
+        m_frame_deadline = deadline_usec;
+    }
 
     void exit(uint8_t exit_code);
     [[nodiscard]] bool should_exit(uint8_t* exit_code_p) const;
+    [[nodiscard]] bool fast_exit_enabled() const { return m_fast_exit; }
+    [[noreturn]] void fast_exit(uint8_t exit_code);
+    void add_exit_hook(GjsExitHook hook, void* data);
+    void remove_exit_hook(GjsExitHook hook, void* data);
 
     // Implementations of JS::JobQueue virtual functions
     GJS_JSAPI_RETURN_CONVENTION
@@ -242,16 +446,25 @@ class GjsContextPrivate : public JS::JobQueue {
                            JS::HandleObject incumbent_global) override;
     void runJobs(JSContext* cx) override;
     [[nodiscard]] bool empty() const override { return m_job_queue.empty(); }
+    [[nodiscard]] size_t job_queue_length() const {
+        return m_job_queue.length();
+    }
     js::UniquePtr<JS::JobQueue::SavedJobQueue> saveJobQueue(
         JSContext* cx) override;
 
-    GJS_JSAPI_RETURN_CONVENTION bool run_jobs_fallible(void);
+    GJS_JSAPI_RETURN_CONVENTION bool run_jobs_fallible(int64_t deadline = 0);
     void register_unhandled_promise_rejection(uint64_t id, GjsAutoChar&& stack);
     void unregister_unhandled_promise_rejection(uint64_t id);
 
     void set_sweeping(bool value);
+    void set_finalizing(bool value);
+    void on_gc_progress(JS::GCProgress progress, const JS::GCDescription& desc);
+    void on_nursery_progress(JS::GCNurseryProgress progress,
+                             JS::GCReason reason);
 
     static void trace(JSTracer* trc, void* data);
+    static void update_weak_pointers(JSContext* cx, JS::Compartment*,
+                                     void* data);
 
     void free_profiler(void);
     void dispose(void);
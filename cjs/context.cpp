@@ -26,7 +26,8 @@
 #include <signal.h>  // for sigaction, SIGUSR1, sa_handler
 #include <stdint.h>
 #include <stdio.h>      // for FILE, fclose, size_t
-#include <string.h>     // for memset
+#include <stdlib.h>     // for strtol, strtoll
+#include <string.h>     // for memset, strcmp, strlen
 
 #ifdef HAVE_UNISTD_H
 #    include <unistd.h>  // for getpid
@@ -34,8 +35,10 @@
 #    include <process.h>
 #endif
 
+#include <algorithm>  // for max, min, find
+#include <atomic>
 #include <new>
-#include <string>       // for u16string
+#include <string>
 #include <type_traits>  // for remove_reference<>::type
 #include <unordered_map>
 #include <utility>  // for move
@@ -45,6 +48,9 @@
 #include <girepository.h>
 #include <glib-object.h>
 #include <glib.h>
+#ifdef G_OS_UNIX
+#    include <glib-unix.h>  // for g_unix_signal_add
+#endif
 
 #ifdef G_OS_WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -61,7 +67,6 @@
 #include <js/Promise.h>             // for JobQueue::SavedJobQueue
 #include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT, JSPROP_RE...
 #include <js/RootingAPI.h>
-#include <js/SourceText.h>
 #include <js/TracingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/UniquePtr.h>
@@ -72,7 +77,11 @@
 #include <jsfriendapi.h>  // for DumpHeap, IgnoreNurseryObjects
 #include <mozilla/UniquePtr.h>
 
+#include "gi/fundamental.h"
+#include "gi/gjs_gi_trace.h"
+#include "gi/gtype.h"
 #include "gi/object.h"
+#include "gi/param.h"
 #include "gi/private.h"
 #include "gi/repo.h"
 #include "cjs/atoms.h"
@@ -81,14 +90,22 @@
 #include "cjs/context.h"
 #include "cjs/engine.h"
 #include "cjs/error-types.h"
+#include "cjs/gettext.h"
 #include "cjs/global.h"
+#include "cjs/heap-snapshot.h"
 #include "cjs/importer.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem.h"
 #include "cjs/native.h"
+#include "cjs/performance.h"
 #include "cjs/profiler-private.h"
 #include "cjs/profiler.h"
+#include "cjs/script-cache.h"
+#include "cjs/text-encoding.h"
+#include "cjs/timers.h"
+#include "cjs/worker.h"
 #include "modules/modules.h"
+#include "modules/print.h"
 #include "util/log.h"
 
 static void     gjs_context_dispose           (GObject               *object);
@@ -134,22 +151,34 @@ GjsContextPrivate* GjsContextPrivate::from_object(GjsContext* js_context) {
         gjs_context_get_instance_private(js_context));
 }
 
+// Threads that don't run JS, such as GDBus's worker thread, can still toggle
+// GObject wrappers, which all belong to the primary context
 GjsContextPrivate* GjsContextPrivate::from_current_context() {
-    return from_object(gjs_context_get_current());
+    GjsContext* current = gjs_context_get_current();
+    if (!current)
+        return primary();
+    return from_object(current);
 }
 
+static std::atomic<GjsContextPrivate*> s_primary_context = nullptr;
+
+GjsContextPrivate* GjsContextPrivate::primary() { return s_primary_context; }
+
 enum {
     PROP_0,
     PROP_SEARCH_PATH,
     PROP_PROGRAM_NAME,
     PROP_PROFILER_ENABLED,
     PROP_PROFILER_SIGUSR2,
+    PROP_TUNING_PROFILE,
 };
 
 static GMutex contexts_lock;
 static GList *all_contexts = NULL;
 
 static GjsAutoChar dump_heap_output;
+static bool dump_heap_snapshot = false;
+static GjsAutoChar dump_wrappers_output;
 static unsigned dump_heap_idle_id = 0;
 
 #ifdef G_OS_UNIX
@@ -166,22 +195,44 @@ gjs_context_dump_heaps(void)
                                            intmax_t(getpid()), counter);
     ++counter;
 
-    FILE *fp = fopen(filename, "w");
+    FILE* fp = fopen(filename, dump_heap_snapshot ? "wb" : "w");
     if (!fp)
         return;
 
     for (GList *l = all_contexts; l; l = g_list_next(l)) {
         auto* gjs = static_cast<GjsContextPrivate*>(l->data);
-        js::DumpHeap(gjs->context(), fp, js::IgnoreNurseryObjects);
+        if (!dump_heap_snapshot)
+            js::DumpHeap(gjs->context(), fp, js::IgnoreNurseryObjects);
+        else if (!gjs_heap_snapshot_write(gjs->context(), fp))
+            g_warning("Heap snapshot to %s is incomplete", filename.get());
     }
 
     fclose(fp);
 }
 
+static void gjs_context_dump_wrappers(void) {
+    static unsigned counter = 0;
+
+    GjsAutoChar filename =
+        g_strdup_printf("%s.%jd.%u", dump_wrappers_output.get(),
+                        intmax_t(getpid()), counter);
+    ++counter;
+
+    FILE* fp = fopen(filename, "w");
+    if (!fp)
+        return;
+
+    gjs_object_dump_wrapper_stats(fp);
+    fclose(fp);
+}
+
 static gboolean dump_heap_idle(void*) {
     dump_heap_idle_id = 0;
 
-    gjs_context_dump_heaps();
+    if (dump_heap_output)
+        gjs_context_dump_heaps();
+    if (dump_wrappers_output)
+        gjs_context_dump_wrappers();
 
     return false;
 }
@@ -202,11 +253,15 @@ setup_dump_heap(void)
 
         /* install signal handler only if environment variable is set */
         const char *heap_output = g_getenv("GJS_DEBUG_HEAP_OUTPUT");
-        if (heap_output) {
+        const char* wrappers_output = g_getenv("GJS_DEBUG_WRAPPERS_OUTPUT");
+        if (heap_output || wrappers_output) {
 #ifdef G_OS_UNIX
             struct sigaction sa;
 
             dump_heap_output = g_strdup(heap_output);
+            dump_heap_snapshot =
+                g_strcmp0(g_getenv("GJS_DEBUG_HEAP_FORMAT"), "snapshot") == 0;
+            dump_wrappers_output = g_strdup(wrappers_output);
 
             memset(&sa, 0, sizeof(sa));
             sa.sa_handler = dump_heap_signal_handler;
@@ -293,6 +348,27 @@ gjs_context_class_init(GjsContextClass *klass)
     g_object_class_install_property(object_class, PROP_PROFILER_SIGUSR2, pspec);
     g_param_spec_unref(pspec);
 
+    /**
+     * GjsContext:tuning-profile:
+     *
+     * The name of a set of garbage collector and JIT settings suited to a kind
+     * of program: "interactive" for long-running programs with a user
+     * interface, "throughput" for batch jobs, "low-memory", or "startup" for
+     * short-lived scripts. By default, settings in between are used.
+     *
+     * The JIT settings are shared by all contexts in the process; a context
+     * with the default profile leaves them as they are.
+     *
+     * The value of this property is superseded by the GJS_TUNING_PROFILE
+     * environment variable.
+     */
+    pspec = g_param_spec_string("tuning-profile", "Tuning profile",
+                                "Workload to tune the JS engine for",
+                                "default",
+                                GParamFlags(G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+    g_object_class_install_property(object_class, PROP_TUNING_PROFILE, pspec);
+    g_param_spec_unref(pspec);
+
     /* For GjsPrivate */
     {
 #ifdef G_OS_WIN32
@@ -308,8 +384,15 @@ gjs_context_class_init(GjsContextClass *klass)
     }
 
     gjs_register_native_module("_byteArrayNative", gjs_define_byte_array_stuff);
+    gjs_register_native_module("_encodingNative",
+                               gjs_define_text_encoding_stuff);
+    gjs_register_native_module("_gettextNative", gjs_define_gettext_stuff);
     gjs_register_native_module("_gi", gjs_define_private_gi_stuff);
+    gjs_register_native_module("_performanceNative",
+                               gjs_define_performance_stuff);
+    gjs_register_native_module("_timers", gjs_define_timers_stuff);
     gjs_register_native_module("gi", gjs_define_repo);
+    gjs_register_native_module("_workerNative", gjs_define_worker_stuff);
 
     gjs_register_static_modules();
 }
@@ -320,6 +403,19 @@ void GjsContextPrivate::trace(JSTracer* trc, void* data) {
     gjs->m_atoms->trace(trc);
     gjs->m_job_queue.trace(trc);
     gjs->m_object_init_list.trace(trc);
+    gjs->m_string_cache.trace(trc);
+    gjs->m_gettext_cache.trace(trc);
+    gjs->m_format_cache.trace(trc);
+    gjs->m_root_set.trace(trc);
+    gjs->m_timers.trace(trc);
+}
+
+void GjsContextPrivate::update_weak_pointers(JSContext*, JS::Compartment*,
+                                             void* data) {
+    auto* gjs = static_cast<GjsContextPrivate*>(data);
+    gjs_fundamental_update_caches_after_gc(gjs);
+    gjs_gtype_update_wrappers_after_gc(gjs);
+    gjs_param_update_wrappers_after_gc(gjs);
 }
 
 void GjsContextPrivate::warn_about_unhandled_promise_rejections(void) {
@@ -349,8 +445,8 @@ gjs_context_dispose(GObject *object)
      * notifications, which causes all GjsMaybeOwned instances to unroot.
      * We don't want any objects to toggle down after that. */
     gjs_debug(GJS_DEBUG_CONTEXT, "Shutting down toggle queue");
-    gjs_object_clear_toggles();
-    gjs_object_shutdown_toggle_queue();
+    gjs_object_clear_toggles(gjs);
+    gjs_object_shutdown_toggle_queue(gjs);
 
     /* Run dispose notifications next, so that anything releasing
      * references in response to this can still get garbage collected */
@@ -361,6 +457,14 @@ gjs_context_dispose(GObject *object)
     gjs->dispose();
 }
 
+// Creates the profiler if the context doesn't have one, for starting it on
+// demand; returns null if another context is already being profiled
+GjsProfiler* GjsContextPrivate::ensure_profiler() {
+    if (!m_profiler)
+        m_profiler = _gjs_profiler_new(m_public_context);
+    return m_profiler;
+}
+
 void GjsContextPrivate::free_profiler(void) {
     gjs_debug(GJS_DEBUG_CONTEXT, "Stopping profiler");
     if (m_profiler)
@@ -373,9 +477,27 @@ void GjsContextPrivate::dispose(void) {
                   "Checking unhandled promise rejections");
         warn_about_unhandled_promise_rejections();
 
+        gjs_debug(GJS_DEBUG_CONTEXT, "Terminating workers");
+        gjs_worker_terminate_all(this);
+
+        if (is_primary())
+            gjs_print_shutdown();
+
+        gjs_debug(GJS_DEBUG_CONTEXT, "Removing pending timers");
+        m_timers.clear();
+
+        // Threads waiting for their callbacks to run would otherwise hang
+        gjs_debug(GJS_DEBUG_CONTEXT, "Cancelling callbacks from other threads");
+        m_thread_callbacks.shutdown();
+
         gjs_debug(GJS_DEBUG_CONTEXT, "Releasing cached JS wrappers");
         m_fundamental_table->clear();
-        m_gtype_table->clear();
+        gjs_fundamental_release_caches(this);
+        gjs_gtype_release_wrappers(this);
+        gjs_param_release_wrappers(this);
+        m_string_cache.clear();
+        m_gettext_cache.clear();
+        m_format_cache.clear();
 
         /* Do a full GC here before tearing down, since once we do
          * that we may not have the JS_GetPrivate() to access the
@@ -392,21 +514,41 @@ void GjsContextPrivate::dispose(void) {
          * still exist, but point to NULL.
          */
         gjs_debug(GJS_DEBUG_CONTEXT, "Releasing all native objects");
-        ObjectInstance::prepare_shutdown();
+        ObjectInstance::prepare_shutdown(this);
+
+        if (m_debugger_signal_id > 0) {
+            remove_source(m_debugger_signal_id);
+            m_debugger_signal_id = 0;
+        }
 
         gjs_debug(GJS_DEBUG_CONTEXT, "Disabling auto GC");
         if (m_auto_gc_id > 0) {
-            g_source_remove(m_auto_gc_id);
+            remove_source(m_auto_gc_id);
             m_auto_gc_id = 0;
         }
+        if (m_gc_slice_id > 0) {
+            remove_source(m_gc_slice_id);
+            m_gc_slice_id = 0;
+        }
+        if (m_idle_shrink_id > 0) {
+            remove_source(m_idle_shrink_id);
+            m_idle_shrink_id = 0;
+        }
+#if GLIB_CHECK_VERSION(2, 64, 0)
+        if (m_memory_monitor) {
+            g_signal_handlers_disconnect_by_data(m_memory_monitor, this);
+            g_clear_object(&m_memory_monitor);
+        }
+#endif
 
         gjs_debug(GJS_DEBUG_CONTEXT, "Ending trace on global object");
         JS_RemoveExtraGCRootsTracer(m_cx, &GjsContextPrivate::trace, this);
+        JS_RemoveWeakPointerCompartmentCallback(
+            m_cx, &GjsContextPrivate::update_weak_pointers);
         m_global = nullptr;
 
         gjs_debug(GJS_DEBUG_CONTEXT, "Freeing allocated resources");
         delete m_fundamental_table;
-        delete m_gtype_table;
         delete m_atoms;
 
         /* Tear down JS */
@@ -416,9 +558,13 @@ void GjsContextPrivate::dispose(void) {
         // destroy the context in case we dump stack
         gjs_debug(GJS_DEBUG_CONTEXT, "JS context destroyed");
     }
+
+    GjsContextPrivate* self = this;
+    s_primary_context.compare_exchange_strong(self, nullptr);
 }
 
 GjsContextPrivate::~GjsContextPrivate(void) {
+    g_clear_pointer(&m_main_context, g_main_context_unref);
     g_clear_pointer(&m_search_path, g_strfreev);
     g_clear_pointer(&m_program_name, g_free);
 }
@@ -438,6 +584,17 @@ gjs_context_finalize(GObject *object)
     G_OBJECT_CLASS(gjs_context_parent_class)->finalize(object);
 }
 
+static void set_tuning_profile_name(GjsContextPrivate* gjs,
+                                    const char* name) {
+    GjsTuningProfile profile;
+    if (!name || !gjs_tuning_profile_from_name(name, &profile)) {
+        if (name)
+            g_warning("Unknown tuning profile '%s', using the default", name);
+        profile = GjsTuningProfile::DEFAULT;
+    }
+    gjs->set_tuning_profile(profile);
+}
+
 static void
 gjs_context_constructed(GObject *object)
 {
@@ -446,11 +603,19 @@ gjs_context_constructed(GObject *object)
     G_OBJECT_CLASS(gjs_context_parent_class)->constructed(object);
 
     GjsContextPrivate* gjs_location = GjsContextPrivate::from_object(object);
-    JSContext* cx = gjs_create_js_context(gjs_location);
+    const char* env_profile = g_getenv("GJS_TUNING_PROFILE");
+    if (env_profile)
+        set_tuning_profile_name(gjs_location, env_profile);
+
+    int64_t engine_start = g_get_monotonic_time();
+    JSContext* cx = gjs_create_js_context(gjs_location,
+                                          gjs_location->tuning_profile());
     if (!cx)
         g_error("Failed to create javascript context");
+    int64_t engine_usec = g_get_monotonic_time() - engine_start;
 
     new (gjs_location) GjsContextPrivate(cx, js_context);
+    gjs_location->set_startup_engine_time(engine_usec);
 
     g_mutex_lock(&contexts_lock);
     all_contexts = g_list_prepend(all_contexts, object);
@@ -458,14 +623,62 @@ gjs_context_constructed(GObject *object)
 
     setup_dump_heap();
 
-    g_object_weak_ref(object, &ObjectInstance::context_dispose_notify, nullptr);
+    if (gjs_location->is_primary())
+        g_object_weak_ref(object, &ObjectInstance::context_dispose_notify,
+                          nullptr);
 }
 
+/* SpiderMonkey counts slice budgets in whole milliseconds, and takes 0 to mean
+ * its own default, so don't run slices shorter than this */
+static constexpr int64_t MIN_GC_SLICE_BUDGET_USEC = 1000;
+
 GjsContextPrivate::GjsContextPrivate(JSContext* cx, GjsContext* public_context)
     : m_public_context(public_context),
       m_cx(cx),
-      m_environment_preparer(cx) {
+      m_environment_preparer(cx),
+      m_timers(cx),
+      m_toggle_queue(this) {
     m_owner_thread = g_thread_self();
+    m_main_context = g_main_context_ref_thread_default();
+    m_thread_callbacks.attach(m_main_context);
+    GjsContextPrivate* no_primary = nullptr;
+    s_primary_context.compare_exchange_strong(no_primary, this);
+    m_startup_mark = g_get_monotonic_time();
+
+    m_job_queue_priority = G_PRIORITY_DEFAULT;
+    const char* job_priority = g_getenv("GJS_JOB_QUEUE_PRIORITY");
+    if (job_priority)
+        m_job_queue_priority = strtol(job_priority, nullptr, 10);
+    const char* job_budget_ms = g_getenv("GJS_JOB_QUEUE_BUDGET");
+    if (job_budget_ms)
+        m_job_queue_budget_usec =
+            std::max(strtoll(job_budget_ms, nullptr, 10), 0LL) * 1000;
+
+    // Time to spend in each incremental GC slice run from the main loop's idle
+    // time, unless the embedder says a frame is due sooner
+    const GjsTuning& tuning = gjs_tuning_profile_get(m_tuning_profile);
+    m_gc_slice_budget_usec = tuning.gc_slice_budget_usec;
+    m_gc_policy =
+        tuning.full_gc ? GjsGCPolicy::FULL : GjsGCPolicy::INCREMENTAL;
+    const char* slice_budget_ms = g_getenv("GJS_GC_SLICE_BUDGET");
+    if (slice_budget_ms) {
+        int64_t budget_usec = strtoll(slice_budget_ms, nullptr, 10) * 1000;
+        m_gc_slice_budget_usec = std::max(budget_usec, MIN_GC_SLICE_BUDGET_USEC);
+    }
+    const char* gc_policy = g_getenv("GJS_GC_POLICY");
+    if (gc_policy)
+        m_gc_policy = strcmp(gc_policy, "full") == 0 ? GjsGCPolicy::FULL
+                                                     : GjsGCPolicy::INCREMENTAL;
+    // Compacting needs to be enabled for a shrinking GC to compact anything
+    if (tuning.compacting)
+        m_idle_shrink_delay_usec = tuning.idle_shrink_delay_sec * G_USEC_PER_SEC;
+    const char* idle_shrink_delay = g_getenv("GJS_IDLE_SHRINK_DELAY");
+    if (idle_shrink_delay)
+        m_idle_shrink_delay_usec =
+            std::max(strtoll(idle_shrink_delay, nullptr, 10), 0LL) *
+            G_USEC_PER_SEC;
+
+    m_fast_exit = g_getenv("GJS_FAST_EXIT");
 
     const char *env_profiler = g_getenv("GJS_ENABLE_PROFILER");
     if (env_profiler || m_should_listen_sigusr2)
@@ -482,11 +695,37 @@ GjsContextPrivate::GjsContextPrivate(JSContext* cx, GjsContext* public_context)
         }
     }
 
+    // Only controlled from outside, so it isn't started automatically. There
+    // is only one object path, so it belongs to the primary context.
+    if (is_primary() && g_getenv("GJS_PROFILER_DBUS") && ensure_profiler())
+        _gjs_profiler_export_dbus(m_profiler);
+
+    m_debugger_signal_id = 0;
+#ifdef G_OS_UNIX
+    // SIGUSR1 is already taken if it is set up to dump the heap
+    if (is_primary() && g_getenv("GJS_DEBUGGER_ATTACH_SIGNAL") &&
+        !g_getenv("GJS_DEBUG_HEAP_OUTPUT") &&
+        !g_getenv("GJS_DEBUG_WRAPPERS_OUTPUT")) {
+        m_debugger_signal_id = g_unix_signal_add(
+            SIGUSR1,
+            [](void* data) -> gboolean {
+                gjs_context_attach_debugger_console(GJS_CONTEXT(data));
+                return G_SOURCE_CONTINUE;
+            },
+            m_public_context);
+    }
+#endif
+
+#if GLIB_CHECK_VERSION(2, 64, 0)
+    // Created along with the first GC timer; see ensure_memory_monitor()
+    m_memory_monitor = nullptr;
+#endif
+
     JSRuntime* rt = JS_GetRuntime(m_cx);
     m_fundamental_table = new JS::WeakCache<FundamentalTable>(rt);
-    m_gtype_table = new JS::WeakCache<GTypeTable>(rt);
 
     m_atoms = new GjsAtoms();
+    mark_startup_phase("set up context");
 
     JS::RootedObject global(
         m_cx, gjs_create_global_object(cx, GjsGlobalType::DEFAULT));
@@ -495,16 +734,20 @@ GjsContextPrivate::GjsContextPrivate(JSContext* cx, GjsContext* public_context)
         gjs_log_exception(m_cx);
         g_error("Failed to initialize global object");
     }
+    mark_startup_phase("create global object");
 
     JSAutoRealm ar(m_cx, global);
 
     m_global = global;
     JS_AddExtraGCRootsTracer(m_cx, &GjsContextPrivate::trace, this);
+    JS_AddWeakPointerCompartmentCallback(
+        m_cx, &GjsContextPrivate::update_weak_pointers, this);
 
     if (!m_atoms->init_atoms(m_cx)) {
         gjs_log_exception(m_cx);
         g_error("Failed to initialize global strings");
     }
+    mark_startup_phase("intern atoms");
 
     std::vector<std::string> paths;
     if (m_search_path)
@@ -521,12 +764,66 @@ GjsContextPrivate::GjsContextPrivate(JSContext* cx, GjsContext* public_context)
 
     gjs_set_global_slot(global, GjsGlobalSlot::IMPORTS,
                         JS::ObjectValue(*importer));
+    mark_startup_phase("create root importer");
 
     if (!gjs_define_global_properties(m_cx, global, GjsGlobalType::DEFAULT,
                                       "GJS", "default")) {
         gjs_log_exception(m_cx);
         g_error("Failed to define properties on global object");
     }
+    mark_startup_phase("run bootstrap script");
+}
+
+bool GjsContextPrivate::startup_profile_enabled(void) {
+    static const bool enabled = g_getenv("GJS_STARTUP_PROFILE");
+    return enabled;
+}
+
+// Records the time since the previous mark as a startup phase
+void GjsContextPrivate::mark_startup_phase(const char* name) {
+    if (G_LIKELY(!startup_profile_enabled()) || m_startup_done)
+        return;
+
+    int64_t now = g_get_monotonic_time();
+    m_startup_phases.push_back({name, now - m_startup_mark, false});
+    m_startup_mark = now;
+}
+
+void GjsContextPrivate::record_nested_startup_time(const char* name,
+                                                   int64_t usec) {
+    if (G_LIKELY(!startup_profile_enabled()) || m_startup_done)
+        return;
+
+    m_startup_phases.push_back({name, usec, true});
+}
+
+void GjsContextPrivate::print_startup_profile(void) {
+    m_startup_done = true;
+
+    int64_t total = m_startup_engine_usec;
+    g_printerr("Startup profile:\n%10.3f ms  create JS engine\n",
+               m_startup_engine_usec / 1e3);
+    for (const StartupPhase& phase : m_startup_phases) {
+        if (phase.nested)
+            continue;
+        g_printerr("%10.3f ms  %s\n", phase.usec / 1e3, phase.name.c_str());
+        total += phase.usec;
+    }
+    g_printerr("%10.3f ms  total before running the program\n", total / 1e3);
+
+    bool header = false;
+    for (const StartupPhase& phase : m_startup_phases) {
+        if (!phase.nested)
+            continue;
+        if (!header) {
+            g_printerr("Included in the above:\n");
+            header = true;
+        }
+        g_printerr("%10.3f ms  %s\n", phase.usec / 1e3, phase.name.c_str());
+    }
+
+    m_startup_phases.clear();
+    m_startup_phases.shrink_to_fit();
 }
 
 static void
@@ -541,6 +838,10 @@ gjs_context_get_property (GObject     *object,
     case PROP_PROGRAM_NAME:
         g_value_set_string(value, gjs->program_name());
         break;
+    case PROP_TUNING_PROFILE:
+        g_value_set_string(value,
+                           gjs_tuning_profile_get(gjs->tuning_profile()).name);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -568,6 +869,9 @@ gjs_context_set_property (GObject      *object,
     case PROP_PROFILER_SIGUSR2:
         gjs->set_should_listen_sigusr2(g_value_get_boolean(value));
         break;
+    case PROP_TUNING_PROFILE:
+        set_tuning_profile_name(gjs, g_value_get_string(value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -594,6 +898,11 @@ gboolean GjsContextPrivate::trigger_gc_if_needed(void* data) {
     gjs->m_auto_gc_id = 0;
 
     if (gjs->m_force_gc) {
+        if (gjs->m_gc_policy == GjsGCPolicy::INCREMENTAL) {
+            // m_force_gc stays set until the first slice has run
+            gjs->schedule_gc_slice();
+            return G_SOURCE_REMOVE;
+        }
         gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "Big Hammer hit");
         JS_GC(gjs->m_cx);
     } else {
@@ -604,6 +913,95 @@ gboolean GjsContextPrivate::trigger_gc_if_needed(void* data) {
     return G_SOURCE_REMOVE;
 }
 
+/* Budget for the next slice run from idle time: the configured one, cut short
+ * so as not to run into the next frame if the embedder told us when that is */
+int64_t GjsContextPrivate::gc_slice_budget() const {
+    if (m_frame_deadline == 0)
+        return m_gc_slice_budget_usec;
+
+    int64_t remaining = m_frame_deadline - g_get_monotonic_time();
+    if (remaining <= 0)
+        return m_gc_slice_budget_usec;
+    return std::min(remaining, m_gc_slice_budget_usec);
+}
+
+/* Starts a full incremental GC if none is in progress, otherwise continues the
+ * one in progress, for at most @budget_usec. */
+void GjsContextPrivate::run_gc_slice(int64_t budget_usec) {
+    int64_t budget_ms = std::max(budget_usec, MIN_GC_SLICE_BUDGET_USEC) / 1000;
+
+    m_requested_slice_budget_ms = budget_ms;
+    if (!JS::IsIncrementalGCInProgress(m_cx)) {
+        JS::PrepareForFullGC(m_cx);
+        JS::StartIncrementalGC(m_cx, GC_NORMAL, JS::GCReason::API, budget_ms);
+    } else {
+        JS::IncrementalGCSlice(m_cx, JS::GCReason::API, budget_ms);
+    }
+    m_requested_slice_budget_ms = 0;
+
+    if (JS::IsIncrementalGCInProgress(m_cx))
+        schedule_gc_slice();
+    else
+        gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "Incremental GC finished");
+}
+
+unsigned GjsContextPrivate::attach_source(GSource* source, int priority,
+                                          GSourceFunc func) {
+    g_source_set_priority(source, priority);
+    g_source_set_callback(source, func, this, nullptr);
+    unsigned id = g_source_attach(source, m_main_context);
+    g_source_unref(source);
+    return id;
+}
+
+void GjsContextPrivate::remove_source(unsigned id) {
+    GSource* source = g_main_context_find_source_by_id(m_main_context, id);
+    if (source)
+        g_source_destroy(source);
+}
+
+void GjsContextPrivate::schedule_gc_slice(void) {
+    if (m_gc_slice_id > 0)
+        return;
+
+    // If the next frame is due too soon to fit a slice in, wait until it has
+    // been drawn
+    int64_t remaining =
+        m_frame_deadline == 0 ? 0 : m_frame_deadline - g_get_monotonic_time();
+    if (remaining > 0 && remaining < MIN_GC_SLICE_BUDGET_USEC) {
+        m_gc_slice_id =
+            attach_source(g_timeout_source_new(remaining / 1000 + 1),
+                          G_PRIORITY_LOW, trigger_gc_slice);
+        return;
+    }
+
+    m_gc_slice_id =
+        attach_source(g_idle_source_new(), G_PRIORITY_LOW, trigger_gc_slice);
+}
+
+gboolean GjsContextPrivate::trigger_gc_slice(void* data) {
+    auto* gjs = static_cast<GjsContextPrivate*>(data);
+    gjs->m_gc_slice_id = 0;
+
+    // The first slice is run from here too; otherwise the GC may have been
+    // finished in the meantime by the engine or by gjs_context_gc()
+    if (!gjs->m_force_gc && !JS::IsIncrementalGCInProgress(gjs->m_cx))
+        return G_SOURCE_REMOVE;
+
+    int64_t budget = gjs->gc_slice_budget();
+    if (budget < MIN_GC_SLICE_BUDGET_USEC) {
+        gjs->schedule_gc_slice();
+        return G_SOURCE_REMOVE;
+    }
+
+    if (gjs->m_force_gc) {
+        gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "Incremental GC started");
+        gjs->m_force_gc = false;
+    }
+    gjs->run_gc_slice(budget);
+    return G_SOURCE_REMOVE;
+}
+
 void GjsContextPrivate::schedule_gc_internal(bool force_gc) {
     m_force_gc |= force_gc;
 
@@ -613,9 +1011,130 @@ void GjsContextPrivate::schedule_gc_internal(bool force_gc) {
     if (force_gc)
         gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "Big Hammer scheduled");
 
-    m_auto_gc_id = g_timeout_add_seconds_full(G_PRIORITY_LOW, 10,
-                                              trigger_gc_if_needed, this,
-                                              nullptr);
+#if GLIB_CHECK_VERSION(2, 64, 0)
+    ensure_memory_monitor();
+#endif
+
+    m_auto_gc_id = attach_source(g_timeout_source_new_seconds(10),
+                                 G_PRIORITY_LOW, trigger_gc_if_needed);
+}
+
+/*
+ * GjsContextPrivate::notify_idle_budget:
+ *
+ * Spends up to @budget_usec on a pending or ongoing incremental GC right away,
+ * instead of waiting for the main loop to be idle.
+ */
+void GjsContextPrivate::notify_idle_budget(int64_t budget_usec) {
+    if (m_gc_policy != GjsGCPolicy::INCREMENTAL ||
+        budget_usec < MIN_GC_SLICE_BUDGET_USEC)
+        return;
+
+    if (m_force_gc) {
+        if (m_auto_gc_id > 0) {
+            remove_source(m_auto_gc_id);
+            m_auto_gc_id = 0;
+        }
+        m_force_gc = false;
+        gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "Incremental GC started");
+    } else if (!JS::IsIncrementalGCInProgress(m_cx)) {
+        return;
+    }
+
+    run_gc_slice(budget_usec);
+}
+
+#if GLIB_CHECK_VERSION(2, 64, 0)
+/*
+ * GjsContextPrivate::ensure_memory_monitor:
+ *
+ * Gets the default memory monitor the first time a GC is scheduled, rather
+ * than in the constructor, since finding it loads a GIO extension point and
+ * may connect to a portal, which short-lived scripts have no use for. The
+ * monitor is a singleton, emitting on the main context it was first created
+ * for, so only the primary context listens to it.
+ */
+void GjsContextPrivate::ensure_memory_monitor(void) {
+    if (m_memory_monitor || !is_primary())
+        return;
+
+    m_memory_monitor = g_memory_monitor_dup_default();
+    g_signal_connect(m_memory_monitor, "low-memory-warning",
+                     G_CALLBACK(on_low_memory_warning), this);
+}
+
+/* Native memory owned by unreachable wrappers is only released when they are
+ * collected, so when the system runs low on memory, collect everything right
+ * away and compact the heap, instead of waiting for the usual heuristics. */
+void GjsContextPrivate::on_low_memory_warning(GMemoryMonitor*,
+                                              GMemoryMonitorWarningLevel level,
+                                              void* data) {
+    auto* gjs = static_cast<GjsContextPrivate*>(data);
+    if (gjs->m_destroying)
+        return;
+
+    gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "Low memory warning, level %d",
+                        level);
+    gjs->shrink_heap();
+}
+#endif
+
+/*
+ * GjsContextPrivate::shrink_heap:
+ *
+ * Collects everything right away, in a shrinking GC that compacts the heap and
+ * releases the chunks it no longer needs back to the operating system. This
+ * blocks, so it is only done when nobody is waiting: the system runs low on
+ * memory, or the program has been idle for a while.
+ */
+void GjsContextPrivate::shrink_heap(void) {
+    gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "Shrinking GC");
+    if (m_auto_gc_id > 0) {
+        remove_source(m_auto_gc_id);
+        m_auto_gc_id = 0;
+    }
+    m_force_gc = false;
+    if (m_idle_shrink_id > 0) {
+        remove_source(m_idle_shrink_id);
+        m_idle_shrink_id = 0;
+    }
+    m_active_since_shrink = false;
+
+    JS::PrepareForFullGC(m_cx);
+    JS::NonIncrementalGC(m_cx, GC_SHRINK, JS::GCReason::API);
+}
+
+/*
+ * GjsContextPrivate::notify_idle:
+ *
+ * The embedder says the user has gone idle, so shrink the heap now instead of
+ * waiting for the idle shrink delay, unless nothing ran since the last time.
+ */
+void GjsContextPrivate::notify_idle(void) {
+    if (m_active_since_shrink && !m_destroying)
+        shrink_heap();
+}
+
+gboolean GjsContextPrivate::trigger_idle_shrink(void* data) {
+    auto* gjs = static_cast<GjsContextPrivate*>(data);
+    gjs->m_idle_shrink_id = 0;
+    if (!gjs->m_active_since_shrink)
+        return G_SOURCE_REMOVE;
+
+    // JS ran in the meantime; check again once the delay has passed since then
+    int64_t idle = g_get_monotonic_time() - gjs->m_last_activity_usec;
+    if (idle < gjs->m_idle_shrink_delay_usec) {
+        int64_t remaining_ms =
+            (gjs->m_idle_shrink_delay_usec - idle) / 1000 + 1;
+        gjs->m_idle_shrink_id =
+            gjs->attach_source(g_timeout_source_new(remaining_ms),
+                               G_PRIORITY_LOW, trigger_idle_shrink);
+        return G_SOURCE_REMOVE;
+    }
+
+    // Once shrunk, stay asleep until JS runs again
+    gjs->shrink_heap();
+    return G_SOURCE_REMOVE;
 }
 
 /*
@@ -630,6 +1149,18 @@ void GjsContextPrivate::schedule_gc_if_needed(void) {
     JS_MaybeGC(m_cx);
 
     schedule_gc_internal(false);
+
+    // This is called whenever JS has run, so it also marks the program as
+    // active, for the shrinking GC once it goes idle. Only the time is updated
+    // here; the timer checks whether it has moved on when it expires.
+    m_active_since_shrink = true;
+    if (m_idle_shrink_delay_usec > 0) {
+        m_last_activity_usec = g_get_monotonic_time();
+        if (m_idle_shrink_id == 0)
+            m_idle_shrink_id = attach_source(
+                g_timeout_source_new(m_idle_shrink_delay_usec / 1000),
+                G_PRIORITY_LOW, trigger_idle_shrink);
+    }
 }
 
 void GjsContextPrivate::set_sweeping(bool value) {
@@ -652,6 +1183,103 @@ void GjsContextPrivate::set_sweeping(bool value) {
     m_in_gc_sweep = value;
 }
 
+void GjsContextPrivate::set_finalizing(bool value) {
+    if (!m_profiler)
+        return;
+
+    int64_t now = g_get_monotonic_time() * 1000L;
+    if (value) {
+        m_finalize_begin_time = now;
+    } else if (m_finalize_begin_time != 0) {
+        _gjs_profiler_add_mark(m_profiler, m_finalize_begin_time,
+                               now - m_finalize_begin_time, "GJS GC",
+                               "Finalize", nullptr);
+        m_finalize_begin_time = 0;
+    }
+}
+
+[[nodiscard]] static const char* gc_kind(const JS::GCDescription& desc) {
+    if (desc.invocationKind_ == GC_SHRINK)
+        return desc.isZone_ ? "shrinking zone" : "shrinking full";
+    return desc.isZone_ ? "zone" : "full";
+}
+
+void GjsContextPrivate::on_gc_progress(JS::GCProgress progress,
+                                       const JS::GCDescription& desc) {
+    if (progress == JS::GC_CYCLE_BEGIN)
+        TRACE(GJS_GC_BEGIN(JS::ExplainGCReason(desc.reason_)));
+    else if (progress == JS::GC_CYCLE_END)
+        TRACE(GJS_GC_END());
+
+    if (!m_profiler || !_gjs_profiler_is_running(m_profiler))
+        return;
+
+    int64_t now = g_get_monotonic_time() * 1000L;
+    switch (progress) {
+        case JS::GC_CYCLE_BEGIN:
+            m_gc_cycle_begin_time = now;
+            break;
+        case JS::GC_SLICE_BEGIN:
+            m_gc_slice_begin_time = now;
+            break;
+        case JS::GC_SLICE_END: {
+            if (m_gc_slice_begin_time == 0)
+                break;
+            GjsAutoChar budget =
+                m_requested_slice_budget_ms
+                    ? g_strdup_printf("%" G_GINT64_FORMAT " ms",
+                                      m_requested_slice_budget_ms)
+                    : g_strdup(desc.isComplete_ ? "none" : "engine's");
+            GjsAutoChar message = g_strdup_printf(
+                "%s major GC%s, reason %s, budget %s", gc_kind(desc),
+                desc.isComplete_ ? " (non-incremental)" : "",
+                JS::ExplainGCReason(desc.reason_), budget.get());
+            _gjs_profiler_add_mark(m_profiler, m_gc_slice_begin_time,
+                                   now - m_gc_slice_begin_time, "GJS GC",
+                                   "GC slice", message);
+            m_gc_slice_begin_time = 0;
+            break;
+        }
+        case JS::GC_CYCLE_END: {
+            if (m_gc_cycle_begin_time == 0)
+                break;
+            GjsAutoChar message =
+                g_strdup_printf("%s major GC, reason %s", gc_kind(desc),
+                                JS::ExplainGCReason(desc.reason_));
+            _gjs_profiler_add_mark(m_profiler, m_gc_cycle_begin_time,
+                                   now - m_gc_cycle_begin_time, "GJS GC",
+                                   "Major GC", message);
+            m_gc_cycle_begin_time = 0;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void GjsContextPrivate::on_nursery_progress(JS::GCNurseryProgress progress,
+                                            JS::GCReason reason) {
+    if (progress == JS::GCNurseryProgress::GC_NURSERY_COLLECTION_START)
+        TRACE(GJS_MINOR_GC_BEGIN(JS::ExplainGCReason(reason)));
+    else
+        TRACE(GJS_MINOR_GC_END());
+
+    if (!m_profiler || !_gjs_profiler_is_running(m_profiler))
+        return;
+
+    int64_t now = g_get_monotonic_time() * 1000L;
+    if (progress == JS::GCNurseryProgress::GC_NURSERY_COLLECTION_START) {
+        m_minor_gc_begin_time = now;
+    } else if (m_minor_gc_begin_time != 0) {
+        GjsAutoChar message =
+            g_strdup_printf("reason %s", JS::ExplainGCReason(reason));
+        _gjs_profiler_add_mark(m_profiler, m_minor_gc_begin_time,
+                               now - m_minor_gc_begin_time, "GJS GC",
+                               "Minor GC", message);
+        m_minor_gc_begin_time = 0;
+    }
+}
+
 void GjsContextPrivate::exit(uint8_t exit_code) {
     g_assert(!m_should_exit);
     m_should_exit = true;
@@ -664,27 +1292,74 @@ bool GjsContextPrivate::should_exit(uint8_t* exit_code_p) const {
     return m_should_exit;
 }
 
+/*
+ * GjsContextPrivate::fast_exit:
+ *
+ * Exits the process without the final GC and without releasing the native
+ * objects, which for a large heap takes much longer than anything the program
+ * did at the end. Only the output that would otherwise be lost is flushed:
+ * unhandled promise rejections, the exit hooks (such as coverage), buffered
+ * print() output, the profiler capture and the debug log.
+ */
+void GjsContextPrivate::fast_exit(uint8_t exit_code) {
+    gjs_debug(GJS_DEBUG_CONTEXT, "Exiting with code %u without teardown",
+              exit_code);
+
+    warn_about_unhandled_promise_rejections();
+
+    for (auto& [hook, data] : m_exit_hooks)
+        hook(exit_code, data);
+
+    if (is_primary())
+        gjs_print_shutdown();
+
+    free_profiler();
+
+    gjs_debug_flush();
+    fflush(stdout);
+    fflush(stderr);
+    _exit(exit_code);
+}
+
+void GjsContextPrivate::add_exit_hook(GjsExitHook hook, void* data) {
+    m_exit_hooks.emplace_back(hook, data);
+}
+
+void GjsContextPrivate::remove_exit_hook(GjsExitHook hook, void* data) {
+    auto it = std::find(m_exit_hooks.begin(), m_exit_hooks.end(),
+                        std::make_pair(hook, data));
+    if (it != m_exit_hooks.end())
+        m_exit_hooks.erase(it);
+}
+
 void GjsContextPrivate::start_draining_job_queue(void) {
     if (!m_idle_drain_handler)
-        m_idle_drain_handler = g_idle_add_full(
-            G_PRIORITY_DEFAULT, drain_job_queue_idle_handler, this, nullptr);
+        m_idle_drain_handler =
+            attach_source(g_idle_source_new(), m_job_queue_priority,
+                          drain_job_queue_idle_handler);
 }
 
 void GjsContextPrivate::stop_draining_job_queue(void) {
     m_draining_job_queue = false;
     if (m_idle_drain_handler) {
-        g_source_remove(m_idle_drain_handler);
+        remove_source(m_idle_drain_handler);
         m_idle_drain_handler = 0;
     }
 }
 
 gboolean GjsContextPrivate::drain_job_queue_idle_handler(void* data) {
     auto* gjs = static_cast<GjsContextPrivate*>(data);
-    gjs->runJobs(gjs->context());
+    int64_t deadline = 0;
+    if (gjs->m_job_queue_budget_usec > 0)
+        deadline = g_get_monotonic_time() + gjs->m_job_queue_budget_usec;
+
+    if (!gjs->run_jobs_fallible(deadline))
+        gjs_log_exception(gjs->m_cx);
     /* Uncatchable exceptions are swallowed here - no way to get a handle on
      * the main loop to exit it from this idle handler */
-    g_assert(gjs->empty() && gjs->m_idle_drain_handler == 0 &&
-             "GjsContextPrivate::runJobs() should have emptied queue");
+    g_assert(gjs->empty() == (gjs->m_idle_drain_handler == 0) &&
+             "GjsContextPrivate::run_jobs_fallible() should have emptied queue "
+             "or scheduled the rest");
     return G_SOURCE_REMOVE;
 }
 
@@ -706,7 +1381,7 @@ bool GjsContextPrivate::enqueuePromiseJob(
     else
         g_assert(empty());
 
-    if (!m_job_queue.append(job)) {
+    if (!m_job_queue.push(job)) {
         JS_ReportOutOfMemory(m_cx);
         return false;
     }
@@ -724,19 +1399,27 @@ void GjsContextPrivate::runJobs(JSContext* cx) {
         gjs_log_exception(cx);
 }
 
+/* Check the clock only every so many jobs, since most of them are short */
+static constexpr unsigned JOB_DEADLINE_CHECK_INTERVAL = 8;
+
 /*
  * GjsContext::run_jobs_fallible:
+ * @deadline: monotonic time after which to stop, or 0 to run all jobs
  *
  * Drains the queue of promise callbacks that the JS engine has reported
  * finished, calling each one and logging any exceptions that it throws.
  *
+ * If @deadline passes before the queue is empty, the remaining jobs are left
+ * for a later main loop iteration, at a priority below redrawing, so that a
+ * long chain of callbacks does not hold up input and drawing.
+ *
  * Adapted from js::RunJobs() in SpiderMonkey's default job queue
  * implementation.
  *
  * Returns: false if one of the jobs threw an uncatchable exception;
  * otherwise true.
  */
-bool GjsContextPrivate::run_jobs_fallible(void) {
+bool GjsContextPrivate::run_jobs_fallible(int64_t deadline) {
     bool retval = true;
 
     if (m_draining_job_queue || m_should_exit)
@@ -748,24 +1431,28 @@ bool GjsContextPrivate::run_jobs_fallible(void) {
     JS::HandleValueArray args(JS::HandleValueArray::empty());
     JS::RootedValue rval(m_cx);
 
+    int64_t start_time = g_get_monotonic_time();
+    size_t n_run = 0;
+
     /* Execute jobs in a loop until we've reached the end of the queue.
      * Since executing a job can trigger enqueueing of additional jobs,
      * it's crucial to recheck the queue length during each iteration. */
-    for (size_t ix = 0; ix < m_job_queue.length(); ix++) {
+    bool out_of_time = false;
+    while (!m_job_queue.empty()) {
         /* A previous job might have set this flag. e.g., System.exit(). */
         if (m_should_exit)
             break;
 
-        job = m_job_queue[ix];
-
-        /* It's possible that job draining was interrupted prematurely,
-         * leaving the queue partly processed. In that case, slots for
-         * already-executed entries will contain nullptrs, which we should
-         * just skip. */
-        if (!job)
-            continue;
+        if (deadline && n_run > 0 && n_run % JOB_DEADLINE_CHECK_INTERVAL == 0 &&
+            g_get_monotonic_time() >= deadline) {
+            out_of_time = true;
+            break;
+        }
 
-        m_job_queue[ix] = nullptr;
+        /* Take the job off the queue before running it, so that if draining
+         * is interrupted, e.g. by the debugger, it is not run again. */
+        job = m_job_queue.pop();
+        n_run++;
         {
             JSAutoRealm ar(m_cx, job);
             if (!JS::Call(m_cx, JS::UndefinedHandleValue, job, args, &rval)) {
@@ -787,6 +1474,24 @@ bool GjsContextPrivate::run_jobs_fallible(void) {
         }
     }
 
+    if (m_profiler) {
+        _gjs_profiler_set_counter(m_profiler,
+                                  GJS_PROFILER_COUNTER_JOB_DRAIN_COUNT, n_run);
+        _gjs_profiler_set_counter(m_profiler,
+                                  GJS_PROFILER_COUNTER_JOB_DRAIN_DURATION,
+                                  g_get_monotonic_time() - start_time);
+    }
+
+    if (out_of_time) {
+        // Leave the rest of the queue for later
+        stop_draining_job_queue();
+        m_idle_drain_handler = attach_source(
+            g_idle_source_new(),
+            std::max(m_job_queue_priority, G_PRIORITY_DEFAULT_IDLE),
+            drain_job_queue_idle_handler);
+        return retval;
+    }
+
     m_job_queue.clear();
     stop_draining_job_queue();
     return retval;
@@ -795,7 +1500,7 @@ bool GjsContextPrivate::run_jobs_fallible(void) {
 class GjsContextPrivate::SavedQueue : public JS::JobQueue::SavedJobQueue {
  private:
     GjsContextPrivate* m_gjs;
-    JS::PersistentRooted<JobQueueStorage> m_queue;
+    JS::PersistentRooted<GjsJobQueue> m_queue;
     bool m_was_draining : 1;
 
  public:
@@ -881,6 +1586,81 @@ gjs_context_gc (GjsContext  *context)
     JS_GC(gjs->context());
 }
 
+/**
+ * gjs_context_notify_idle_budget:
+ * @context: a #GjsContext
+ * @budget_usec: microseconds that may be spent right now
+ *
+ * Tells the garbage collector that the embedder has @budget_usec of spare
+ * time, for example after it has drawn a frame, and nothing to do until then.
+ * If a full garbage collection is pending or in progress, a slice of it is run
+ * immediately, taking no longer than @budget_usec, rather than waiting for the
+ * main loop to become idle.
+ *
+ * Budgets shorter than a millisecond are ignored, as is the call if the
+ * `GJS_GC_POLICY` environment variable selects non-incremental collection.
+ */
+void gjs_context_notify_idle_budget(GjsContext* context, int64_t budget_usec) {
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(context);
+    gjs->notify_idle_budget(budget_usec);
+}
+
+/**
+ * gjs_context_notify_idle:
+ * @context: a #GjsContext
+ *
+ * Tells the garbage collector that the user has gone idle, for example when
+ * the screen is locked or blanked. If any JS has run since the last time, the
+ * heap is compacted right away with a shrinking garbage collection, which
+ * releases the memory that it no longer needs back to the operating system.
+ * This blocks for the duration of a full garbage collection.
+ *
+ * Even without this, the heap is compacted once no JS has run for the number
+ * of seconds in the `GJS_IDLE_SHRINK_DELAY` environment variable.
+ */
+void gjs_context_notify_idle(GjsContext* context) {
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(context);
+    gjs->notify_idle();
+}
+
+/**
+ * gjs_context_set_frame_deadline:
+ * @context: a #GjsContext
+ * @deadline_usec: monotonic time of the next frame, in microseconds, or 0
+ *
+ * Tells the garbage collector when the embedder has to start drawing its next
+ * frame, in the time base of g_get_monotonic_time(). Garbage collection slices
+ * run from the main loop's idle time are cut short so as to end before then,
+ * or postponed until after the frame if there is too little time left.
+ *
+ * Pass 0 if no frame is scheduled.
+ */
+void gjs_context_set_frame_deadline(GjsContext* context,
+                                    int64_t deadline_usec) {
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(context);
+    gjs->set_frame_deadline(deadline_usec);
+}
+
+/**
+ * gjs_context_exit_fast:
+ * @context: a #GjsContext
+ * @exit_code: the process's exit status
+ *
+ * Exits the process right away, without the final garbage collection and
+ * without releasing the native objects that disposing @context would do.
+ * Unhandled promise rejections are still reported, and pending output, such as
+ * the profiler capture and coverage statistics, is still written.
+ *
+ * This is meant for short-lived command-line programs with large heaps, which
+ * otherwise spend a noticeable time exiting. If the `GJS_FAST_EXIT`
+ * environment variable is set when @context is created, `System.exit()` exits
+ * this way as well.
+ */
+void gjs_context_exit_fast(GjsContext* context, uint8_t exit_code) {
+    GjsContextPrivate* gjs = GjsContextPrivate::from_object(context);
+    gjs->fast_exit(exit_code);
+}
+
 /**
  * gjs_context_get_all:
  *
@@ -948,6 +1728,14 @@ bool GjsContextPrivate::eval(const char* script, ssize_t script_len,
     if (auto_profile)
         gjs_profiler_start(m_profiler);
 
+    // Whatever the embedder did between creating the context and running the
+    // first script, such as defining ARGV or attaching the debugger
+    mark_startup_phase("embedder setup");
+
+    gjs_importer_prefetch(m_cx, script,
+                          script_len < 0 ? strlen(script) : script_len);
+    mark_startup_phase("prefetch imported modules");
+
     JS::RootedValue retval(m_cx);
     bool ok = eval_with_scope(nullptr, script, script_len, filename, &retval);
 
@@ -1011,19 +1799,55 @@ gjs_context_eval_file(GjsContext    *js_context,
                       int           *exit_status_p,
                       GError       **error)
 {
-    char *script;
-    size_t script_len;
     GjsAutoUnref<GFile> file = g_file_new_for_commandline_arg(filename);
-
-    if (!g_file_load_contents(file, nullptr, &script, &script_len, nullptr,
-                              error))
+    GjsScriptFileContents script;
+    if (!script.load(file, error))
         return false;
-    GjsAutoChar script_ref = script;
 
-    return gjs_context_eval(js_context, script, script_len, filename,
+    return gjs_context_eval(js_context, script.data, script.length, filename,
                             exit_status_p, error);
 }
 
+void GjsContextPrivate::set_source_policy(const char* path_prefix,
+                                          GjsSourcePolicy policy) {
+    for (auto& entry : m_source_policies) {
+        if (entry.first == path_prefix) {
+            entry.second = policy;
+            return;
+        }
+    }
+    m_source_policies.emplace_back(path_prefix, policy);
+}
+
+void GjsContextPrivate::apply_source_policy(const char* filename,
+                                            JS::CompileOptions* options) const {
+    GjsSourcePolicy policy = GjsSourcePolicy::DEFAULT;
+    size_t longest = 0;
+    for (const auto& entry : m_source_policies) {
+        if (entry.first.size() >= longest &&
+            g_str_has_prefix(filename, entry.first.c_str())) {
+            policy = entry.second;
+            longest = entry.first.size();
+        }
+    }
+
+    switch (policy) {
+        case GjsSourcePolicy::LAZY:
+            // The source hook can only read the source back from resources
+            // and absolute paths, see GjsSourceHook
+            if (!m_debugger_attached &&
+                (g_str_has_prefix(filename, "resource://") ||
+                 g_path_is_absolute(filename)))
+                options->setSourceIsLazy(true);
+            break;
+        case GjsSourcePolicy::EAGER:
+            options->setForceFullParse();
+            break;
+        case GjsSourcePolicy::DEFAULT:
+            break;
+    }
+}
+
 /*
  * GjsContextPrivate::eval_with_scope:
  * @scope_object: an object to use as the global scope, or nullptr
@@ -1052,15 +1876,6 @@ bool GjsContextPrivate::eval_with_scope(JS::HandleObject scope_object,
     if (!eval_obj)
         eval_obj = JS_NewPlainObject(m_cx);
 
-    std::u16string utf16_string = gjs_utf8_script_to_utf16(script, script_len);
-    // COMPAT: This could use JS::SourceText<mozilla::Utf8Unit> directly,
-    // but that messes up code coverage. See bug
-    // https://bugzilla.mozilla.org/show_bug.cgi?id=1404784
-    JS::SourceText<char16_t> buf;
-    if (!buf.init(m_cx, utf16_string.c_str(), utf16_string.size(),
-                  JS::SourceOwnership::Borrowed))
-        return false;
-
     JS::RootedObjectVector scope_chain(m_cx);
     if (!scope_chain.append(eval_obj)) {
         JS_ReportOutOfMemory(m_cx);
@@ -1069,15 +1884,29 @@ bool GjsContextPrivate::eval_with_scope(JS::HandleObject scope_object,
 
     JS::CompileOptions options(m_cx);
     options.setFileAndLine(filename, 1);
+    apply_source_policy(filename, &options);
+
+    JS::RootedScript compiled_script(
+        m_cx, gjs_script_cache_compile_utf8(
+                  m_cx, options, script,
+                  script_len < 0 ? strlen(script) : script_len,
+                  /* non_syntactic = */ true));
+    if (!compiled_script)
+        return false;
+
+    if (G_UNLIKELY(startup_profile_enabled()) && !m_startup_done) {
+        mark_startup_phase("compile program");
+        print_startup_profile();
+    }
 
-    if (!JS::Evaluate(m_cx, scope_chain, options, buf, retval))
+    if (!JS_ExecuteScript(m_cx, scope_chain, compiled_script, retval))
         return false;
 
     schedule_gc_if_needed();
 
     if (JS_IsExceptionPending(m_cx)) {
         g_warning(
-            "JS::Evaluate() returned true but exception was pending; "
+            "JS_ExecuteScript() returned true but exception was pending; "
             "did somebody call gjs_throw() without returning false?");
         return false;
     }
@@ -1143,7 +1972,8 @@ gjs_context_define_string_array(GjsContext  *js_context,
     return true;
 }
 
-static GjsContext *current_context;
+// Each thread that runs JS has its own current context
+static thread_local GjsContext* current_context;
 
 GjsContext *
 gjs_context_get_current (void)
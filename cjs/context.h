@@ -29,6 +29,7 @@
 #endif
 
 #include <stdbool.h>    /* IWYU pragma: keep */
+#include <stdint.h>
 
 #ifndef _WIN32
 #    include <signal.h> /* for siginfo_t */
@@ -87,6 +88,18 @@ void            gjs_context_maybe_gc              (GjsContext  *context);
 GJS_EXPORT
 void            gjs_context_gc                    (GjsContext  *context);
 
+GJS_EXPORT
+void gjs_context_notify_idle_budget(GjsContext* context, int64_t budget_usec);
+
+GJS_EXPORT
+void gjs_context_notify_idle(GjsContext* context);
+
+GJS_EXPORT
+void gjs_context_set_frame_deadline(GjsContext* context, int64_t deadline_usec);
+
+GJS_EXPORT G_NORETURN void gjs_context_exit_fast(GjsContext* context,
+                                                 uint8_t exit_code);
+
 GJS_EXPORT GJS_USE GjsProfiler* gjs_context_get_profiler(GjsContext* self);
 
 GJS_EXPORT GJS_USE bool gjs_profiler_chain_signal(GjsContext* context,
@@ -100,6 +113,9 @@ GJS_EXPORT GJS_USE const char* gjs_get_js_version(void);
 GJS_EXPORT
 void gjs_context_setup_debugger_console(GjsContext* gjs);
 
+GJS_EXPORT
+void gjs_context_attach_debugger_console(GjsContext* gjs);
+
 G_END_DECLS
 
 #endif /* GJS_CONTEXT_H_ */
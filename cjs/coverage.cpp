@@ -26,8 +26,9 @@
 #include <config.h>
 
 #include <stdlib.h>  // for free, size_t
-#include <string.h>  // for strcmp, strlen
+#include <string.h>  // for memchr, strlen
 
+#include <algorithm>  // for min
 #include <new>
 
 #include <gio/gio.h>
@@ -49,6 +50,7 @@
 #include "cjs/global.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
+#include "cjs/script-cache.h"
 
 static bool s_coverage_enabled = false;
 
@@ -189,14 +191,6 @@ static GParamSpec *properties[PROP_N] = { NULL, };
     return false;
 }
 
-static inline bool
-write_line(GOutputStream *out,
-           const char    *line,
-           GError       **error)
-{
-    return g_output_stream_printf(out, nullptr, nullptr, error, "%s\n", line);
-}
-
 [[nodiscard]] static GjsAutoUnref<GFile> write_statistics_internal(
     GjsCoverage* coverage, JSContext* cx, GError** error) {
     if (!s_coverage_enabled) {
@@ -228,52 +222,77 @@ write_line(GOutputStream *out,
     if (!ostream)
         return nullptr;
 
-    GjsAutoStrv lcov_lines = g_strsplit(lcov.get(), "\n", -1);
-    const char* test_name = NULL;
-    bool ignoring_file = false;
-
-    for (const char * const *iter = lcov_lines.get(); *iter; iter++) {
-        if (ignoring_file) {
-            if (strcmp(*iter, "end_of_record") == 0)
-                ignoring_file = false;
-            continue;
-        }
-
-        if (g_str_has_prefix(*iter, "TN:")) {
+    // The summary is scanned in place rather than split into lines, and each
+    // record that is kept is written out with one call, so that writing out a
+    // large test suite's data doesn't take longer than the suite itself
+    const char* test_name = nullptr;
+    size_t test_name_len = 0;
+    const char* end = lcov.get() + lcov_length;
+    const char* line = lcov.get();
+
+    while (line < end) {
+        const char* newline =
+            static_cast<const char*>(memchr(line, '\n', end - line));
+        const char* next = newline ? newline + 1 : end;
+        size_t len = (newline ? newline : end) - line;
+
+        if (g_str_has_prefix(line, "TN:")) {
             /* Don't write the test name if the next line shows we are
              * ignoring the source file */
-            test_name = *iter;
+            test_name = line;
+            test_name_len = next - line;
+            line = next;
             continue;
-        } else if (g_str_has_prefix(*iter, "SF:")) {
-            const char *filename = *iter + 3;
-            if (!filename_has_coverage_prefixes(coverage, filename)) {
-                ignoring_file = true;
-                continue;
-            }
-
-            /* Now we can write the test name before writing the source file */
-            if (!write_line(ostream, test_name, error))
-                return nullptr;
-
-            /* The source file could be a resource, so we must use
-             * g_file_new_for_commandline_arg() to disambiguate between URIs and
-             * filesystem paths. */
-            GjsAutoUnref<GFile> source_file = g_file_new_for_commandline_arg(filename);
-            GjsAutoChar diverged_paths =
-                find_diverging_child_components(source_file, priv->output_dir);
-            GjsAutoUnref<GFile> destination_file =
-                g_file_resolve_relative_path(priv->output_dir, diverged_paths);
-            if (!copy_source_file_to_coverage_output(source_file, destination_file, error))
-                return nullptr;
+        }
 
-            /* Rewrite the source file path to be relative to the output
-             * dir so that genhtml will find it */
-            if (!write_source_file_header(ostream, destination_file, error))
+        if (!g_str_has_prefix(line, "SF:")) {
+            if (!g_output_stream_write_all(ostream, line, next - line, nullptr,
+                                           nullptr, error))
                 return nullptr;
+            line = next;
             continue;
         }
 
-        if (!write_line(ostream, *iter, error))
+        // Everything up to and including end_of_record belongs to this file
+        static constexpr const char END_OF_RECORD[] = "end_of_record\n";
+        const char* record_end = next;
+        while (record_end < end &&
+               !g_str_has_prefix(record_end, END_OF_RECORD)) {
+            auto* eol = static_cast<const char*>(
+                memchr(record_end, '\n', end - record_end));
+            record_end = eol ? eol + 1 : end;
+        }
+        record_end = std::min(record_end + strlen(END_OF_RECORD), end);
+
+        GjsAutoChar filename = g_strndup(line + 3, len - 3);
+        line = record_end;
+        if (!filename_has_coverage_prefixes(coverage, filename))
+            continue;
+
+        /* Now we can write the test name before writing the source file */
+        if (test_name &&
+            !g_output_stream_write_all(ostream, test_name, test_name_len,
+                                       nullptr, nullptr, error))
+            return nullptr;
+
+        /* The source file could be a resource, so we must use
+         * g_file_new_for_commandline_arg() to disambiguate between URIs and
+         * filesystem paths. */
+        GjsAutoUnref<GFile> source_file =
+            g_file_new_for_commandline_arg(filename);
+        GjsAutoChar diverged_paths =
+            find_diverging_child_components(source_file, priv->output_dir);
+        GjsAutoUnref<GFile> destination_file =
+            g_file_resolve_relative_path(priv->output_dir, diverged_paths);
+        if (!copy_source_file_to_coverage_output(source_file, destination_file,
+                                                 error))
+            return nullptr;
+
+        /* Rewrite the source file path to be relative to the output
+         * dir so that genhtml will find it */
+        if (!write_source_file_header(ostream, destination_file, error) ||
+            !g_output_stream_write_all(ostream, next, record_end - next,
+                                       nullptr, nullptr, error))
             return nullptr;
     }
 
@@ -365,6 +384,13 @@ bootstrap_coverage(GjsCoverage *coverage)
     return true;
 }
 
+// Coverage statistics are not written when the program fails, as in the
+// console's regular exit
+static void write_statistics_on_exit(uint8_t exit_code, void* data) {
+    if (exit_code == 0)
+        gjs_coverage_write_statistics(GJS_COVERAGE(data));
+}
+
 static void
 gjs_coverage_constructed(GObject *object)
 {
@@ -374,6 +400,16 @@ gjs_coverage_constructed(GObject *object)
     GjsCoveragePrivate *priv = (GjsCoveragePrivate *) gjs_coverage_get_instance_private(coverage);
     new (&priv->global) JS::Heap<JSObject*>();
 
+    GjsContextPrivate::from_object(priv->context)
+        ->add_exit_hook(write_statistics_on_exit, coverage);
+
+    // The engine already keeps the counters that GetCodeCoverageSummary()
+    // reports, once gjs_coverage_enable() has been called. A debugger that
+    // collects coverage info additionally makes all code a debuggee, which
+    // keeps it out of the optimizing JITs; in native mode there is none.
+    if (g_getenv("GJS_COVERAGE_NATIVE"))
+        return;
+
     if (!bootstrap_coverage(coverage)) {
         JSContext *context = static_cast<JSContext *>(gjs_context_get_native_context(priv->context));
         JSAutoRealm ar(context, gjs_get_import_global(context));
@@ -419,6 +455,8 @@ gjs_coverage_dispose(GObject *object)
     auto cx = static_cast<JSContext *>(gjs_context_get_native_context(priv->context));
     JS_RemoveExtraGCRootsTracer(cx, coverage_tracer, coverage);
     priv->global = nullptr;
+    GjsContextPrivate::from_object(priv->context)
+        ->remove_exit_hook(write_statistics_on_exit, coverage);
 
     g_clear_object(&priv->context);
 
@@ -516,5 +554,6 @@ gjs_coverage_new (const char * const *prefixes,
  */
 void gjs_coverage_enable() {
     js::EnableCodeCoverage();
+    gjs_script_cache_disable();
     s_coverage_enabled = true;
 }
@@ -131,8 +131,9 @@ static JSFunctionSpec debugger_funcs[] = {
 };
 // clang-format on
 
-void gjs_context_setup_debugger_console(GjsContext* gjs) {
+static void setup_debugger(GjsContext* gjs, bool on_demand) {
     auto cx = static_cast<JSContext*>(gjs_context_get_native_context(gjs));
+    GjsContextPrivate::from_object(gjs)->set_debugger_attached();
 
     JS::RootedObject debuggee(cx, gjs_get_import_global(cx));
     JS::RootedObject debugger_global(
@@ -148,10 +149,33 @@ void gjs_context_setup_debugger_console(GjsContext* gjs) {
 
     const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
     JS::RootedValue v_wrapper(cx, JS::ObjectValue(*debuggee_wrapper));
+    JS::RootedValue v_on_demand(cx, JS::BooleanValue(on_demand));
     if (!JS_SetPropertyById(cx, debugger_global, atoms.debuggee(), v_wrapper) ||
+        !JS_SetProperty(cx, debugger_global, "attachedOnDemand",
+                        v_on_demand) ||
         !JS_DefineFunctions(cx, debugger_global, debugger_funcs) ||
         !gjs_define_global_properties(cx, debugger_global,
                                       GjsGlobalType::DEBUGGER, "GJS debugger",
                                       "debugger"))
         gjs_log_exception(cx);
 }
+
+void gjs_context_setup_debugger_console(GjsContext* gjs) {
+    setup_debugger(gjs, /* on_demand = */ false);
+}
+
+/**
+ * gjs_context_attach_debugger_console:
+ * @gjs: a #GjsContext
+ *
+ * Attaches the debugger to a running context and drops into its prompt right
+ * away. Unlike gjs_context_setup_debugger_console(), the debugger doesn't
+ * watch every frame, promise, or exception: only scripts that are given
+ * breakpoints are affected, and everything else keeps running at full speed.
+ * Does nothing if a debugger is already attached.
+ */
+void gjs_context_attach_debugger_console(GjsContext* gjs) {
+    if (GjsContextPrivate::from_object(gjs)->debugger_attached())
+        return;
+    setup_debugger(gjs, /* on_demand = */ true);
+}
@@ -25,18 +25,14 @@
 
 #include <cstddef>        // for size_t
 #include <string>         // for string
+#include <string_view>
 #include <unordered_set>  // for unordered_set
-#include <utility>        // for hash, move
+#include <utility>        // for hash
 
 #include <glib.h>  // for g_warning
 
-#include <js/CharacterEncoding.h>
-#include <js/Conversions.h>
-#include <js/RootingAPI.h>
-#include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
-#include <js/Value.h>
-#include <jsapi.h>        // for MaxFrames, CaptureCurrentStack
+#include <jsapi.h>        // for AutoFilename, DescribeScriptedCaller
 #include <jsfriendapi.h>  // for FormatStackDump
 
 #include "cjs/deprecation.h"
@@ -72,15 +68,19 @@ const char* messages[] = {
     "Some code tried to set a deprecated GObject property.",
 };
 
+// A call site is identified by where the caller is in its script, which
+// DescribeScriptedCaller() gives without capturing a stack or allocating. Code
+// that keeps hitting a deprecated path, for example in a loop, then only pays
+// for a hash lookup after the first warning.
 struct DeprecationEntry {
     GjsDeprecationMessageId id;
-    std::string loc;
-
-    DeprecationEntry(GjsDeprecationMessageId an_id, const char* a_loc)
-        : id(an_id), loc(a_loc) {}
+    std::string_view filename;
+    unsigned lineno;
+    unsigned column;
 
     bool operator==(const DeprecationEntry& other) const {
-        return id == other.id && loc == other.loc;
+        return id == other.id && lineno == other.lineno &&
+               column == other.column && filename == other.filename;
     }
 };
 
@@ -88,40 +88,36 @@ namespace std {
 template <>
 struct hash<DeprecationEntry> {
     size_t operator()(const DeprecationEntry& key) const {
-        return hash<int>()(key.id) ^ hash<std::string>()(key.loc);
+        return hash<int>()(key.id) ^ hash<std::string_view>()(key.filename) ^
+               hash<unsigned>()(key.lineno) ^
+               (hash<unsigned>()(key.column) << 1);
     }
 };
 };  // namespace std
 
+// The entries' filenames point into here, since a script's filename is freed
+// along with the script
+static std::unordered_set<std::string> logged_filenames;
 static std::unordered_set<DeprecationEntry> logged_messages;
 
-GJS_JSAPI_RETURN_CONVENTION
-static JS::UniqueChars get_callsite(JSContext* cx) {
-    JS::RootedObject stack_frame(cx);
-    if (!JS::CaptureCurrentStack(cx, &stack_frame,
-                                 JS::StackCapture(JS::MaxFrames(1))) ||
-        !stack_frame)
-        return nullptr;
-
-    JS::RootedValue v_frame(cx, JS::ObjectValue(*stack_frame));
-    JS::RootedString frame_string(cx, JS::ToString(cx, v_frame));
-    if (!frame_string)
-        return nullptr;
-
-    return JS_EncodeStringToUTF8(cx, frame_string);
-}
-
 /* Note, this can only be called from the JS thread because it uses the full
  * stack dump API and not the "safe" gjs_dumpstack() which can only print to
  * stdout or stderr. Do not use this function during GC, for example. */
 void _gjs_warn_deprecated_once_per_callsite(JSContext* cx,
                                             const GjsDeprecationMessageId id) {
-    JS::UniqueChars callsite(get_callsite(cx));
-    DeprecationEntry entry(id, callsite.get());
-    if (!logged_messages.count(entry)) {
-        JS::UniqueChars stack_dump =
-            JS::FormatStackDump(cx, false, false, false);
-        g_warning("%s\n%s", messages[id], stack_dump.get());
-        logged_messages.insert(std::move(entry));
-    }
+    JS::AutoFilename filename;
+    DeprecationEntry entry{id, "", 0, 0};
+    if (JS::DescribeScriptedCaller(cx, &filename, &entry.lineno,
+                                   &entry.column) &&
+        filename.get())
+        entry.filename = filename.get();
+
+    if (logged_messages.count(entry))
+        return;
+
+    JS::UniqueChars stack_dump = JS::FormatStackDump(cx, false, false, false);
+    g_warning("%s\n%s", messages[id], stack_dump.get());
+
+    entry.filename = *logged_filenames.emplace(entry.filename).first;
+    logged_messages.insert(entry);
 }
@@ -24,12 +24,15 @@
 #include <config.h>
 
 #include <stdint.h>
+#include <string.h>  // for strcmp
 
 #ifdef _WIN32
 #    define WIN32_LEAN_AND_MEAN
 #    include <windows.h>
 #endif
 
+#include <algorithm>  // for copy
+#include <string>
 #include <utility>  // for move
 
 #include <gio/gio.h>
@@ -41,6 +44,7 @@
 #include <js/Promise.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
+#include <js/Utility.h>  // for js_pod_malloc
 #include <js/Warnings.h>
 #include <js/experimental/SourceHook.h>
 #include <jsapi.h>  // for InitSelfHostedCode, JS_Destr...
@@ -96,13 +100,28 @@ static void gjs_finalize_callback(JSFreeOp*, JSFinalizeStatus status,
      code, so we can probably rely on this behavior.
   */
 
-  if (status == JSFINALIZE_GROUP_PREPARE)
-        gjs->set_sweeping(true);
-  else if (status == JSFINALIZE_GROUP_END)
-        gjs->set_sweeping(false);
+  if (status == JSFINALIZE_GROUP_PREPARE) {
+      gjs->set_sweeping(true);
+  } else if (status == JSFINALIZE_GROUP_START) {
+      gjs->set_finalizing(true);
+  } else if (status == JSFINALIZE_GROUP_END) {
+      gjs->set_finalizing(false);
+      gjs->set_sweeping(false);
+  }
 }
 
-static void on_garbage_collect(JSContext*, JSGCStatus status, JS::GCReason,
+static void on_gc_slice(JSContext* cx, JS::GCProgress progress,
+                        const JS::GCDescription& desc) {
+    GjsContextPrivate::from_cx(cx)->on_gc_progress(progress, desc);
+}
+
+static void on_nursery_collection(JSContext* cx,
+                                  JS::GCNurseryProgress progress,
+                                  JS::GCReason reason) {
+    GjsContextPrivate::from_cx(cx)->on_nursery_progress(progress, reason);
+}
+
+static void on_garbage_collect(JSContext* cx, JSGCStatus status, JS::GCReason,
                                void*) {
     /* We finalize any pending toggle refs before doing any garbage collection,
      * so that we can collect the JS wrapper objects, and in order to minimize
@@ -110,7 +129,7 @@ static void on_garbage_collect(JSContext*, JSGCStatus status, JS::GCReason,
      * garbage collected. */
     if (status == JSGC_BEGIN) {
         gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "Begin garbage collection");
-        gjs_object_clear_toggles();
+        gjs_object_clear_toggles(GjsContextPrivate::from_cx(cx));
     } else if (status == JSGC_END) {
         gjs_debug_lifecycle(GJS_DEBUG_CONTEXT, "End garbage collection");
     }
@@ -146,12 +165,42 @@ bool gjs_load_internal_source(JSContext* cx, const char* filename, char** src,
     return true;
 }
 
+// Reads back the source of scripts compiled without keeping it: the realm
+// bootstrap code, and scripts with GjsSourcePolicy::LAZY
 class GjsSourceHook : public js::SourceHook {
-    bool load(JSContext* cx, const char* filename,
-              char16_t** two_byte_source [[maybe_unused]], char** utf8_source,
-              size_t* length) {
+    bool load(JSContext* cx, const char* filename, char16_t** two_byte_source,
+              char** utf8_source, size_t* length) {
+        char* source;
+        size_t source_len;
+        if (g_str_has_prefix(filename, "resource://")) {
+            if (!gjs_load_internal_source(cx, filename, &source, &source_len))
+                return false;
+        } else {
+            GError* error = nullptr;
+            if (!g_file_get_contents(filename, &source, &source_len, &error))
+                return gjs_throw_gerror_message(cx, error);
+        }
+
         // caller owns the source, per documentation of SourceHook
-        return gjs_load_internal_source(cx, filename, utf8_source, length);
+        if (utf8_source) {
+            *utf8_source = source;
+            *length = source_len;
+            return true;
+        }
+
+        // Scripts are compiled from UTF-16 when code coverage is enabled, and
+        // off the main thread, see gjs_script_cache_compile_utf8(); the units
+        // must be the same
+        GjsAutoChar owned_source = source;
+        std::u16string utf16 = gjs_utf8_script_to_utf16(source, source_len);
+        *two_byte_source = js_pod_malloc<char16_t>(utf16.size());
+        if (!*two_byte_source) {
+            JS_ReportOutOfMemory(cx);
+            return false;
+        }
+        std::copy(utf16.begin(), utf16.end(), *two_byte_source);
+        *length = utf16.size();
+        return true;
     }
 };
 
@@ -201,7 +250,44 @@ public:
 static GjsInit gjs_is_inited;
 #endif
 
-JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs) {
+// Indexed by GjsTuningProfile
+static const GjsTuning tuning_profiles[] = {
+    // name, min/max nursery, engine slice, GJS slice, compacting, idle shrink,
+    // full GC, Baseline/Ion warm-up, Ion
+    {"default", 0, 0, 10, 5000, true, 0, false, 0, 0, true},
+    // Long-running programs with a UI: short GC slices so as to fit between
+    // frames, and the heap compacted when the user has been away for a while,
+    // since it fragments after spikes of activity
+    {"interactive", 0, 0, 5, 3000, true, 120, false, 0, 0, true},
+    // Batch jobs: a larger nursery, long slices and no compacting, so that
+    // less time overall is spent in the GC, and hot code optimized sooner
+    {"throughput", 4 * 1024 * 1024, 0, 50, 50000, false, 0, true, 0, 500,
+     true},
+    // A small nursery, compacting, and no Ion, whose code takes up memory
+    {"low-memory", 0, 1024 * 1024, 10, 5000, true, 30, false, 0, 0, false},
+    // Short-lived scripts: the nursery is large enough to not need collecting
+    // for most of them, and code only gets compiled if it is very hot
+    {"startup", 16 * 1024 * 1024, 0, 10, 5000, false, 0, true, 200, 5000,
+     true},
+};
+
+bool gjs_tuning_profile_from_name(const char* name,
+                                  GjsTuningProfile* profile_out) {
+    for (size_t ix = 0; ix < G_N_ELEMENTS(tuning_profiles); ix++) {
+        if (strcmp(name, tuning_profiles[ix].name) == 0) {
+            *profile_out = static_cast<GjsTuningProfile>(ix);
+            return true;
+        }
+    }
+    return false;
+}
+
+const GjsTuning& gjs_tuning_profile_get(GjsTuningProfile profile) {
+    return tuning_profiles[static_cast<size_t>(profile)];
+}
+
+JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs,
+                                 GjsTuningProfile profile) {
     g_assert(gjs_is_inited);
     JSContext *cx = JS_NewContext(32 * 1024 * 1024 /* max bytes */);
     if (!cx)
@@ -216,7 +302,15 @@ JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs) {
     JS_SetNativeStackQuota(cx, 1024 * 1024);
     JS_SetGCParameter(cx, JSGC_MAX_BYTES, -1);
     JS_SetGCParameter(cx, JSGC_MODE, JSGC_MODE_INCREMENTAL);
-    JS_SetGCParameter(cx, JSGC_SLICE_TIME_BUDGET_MS, 10); /* ms */
+    const GjsTuning& tuning = gjs_tuning_profile_get(profile);
+    JS_SetGCParameter(cx, JSGC_SLICE_TIME_BUDGET_MS,
+                      tuning.engine_slice_budget_ms);
+    JS_SetGCParameter(cx, JSGC_COMPACTING_ENABLED, tuning.compacting);
+    // The maximum first, as the minimum can't be set larger than it
+    if (tuning.max_nursery_bytes)
+        JS_SetGCParameter(cx, JSGC_MAX_NURSERY_BYTES, tuning.max_nursery_bytes);
+    if (tuning.min_nursery_bytes)
+        JS_SetGCParameter(cx, JSGC_MIN_NURSERY_BYTES, tuning.min_nursery_bytes);
     // JS_SetGCParameter(cx, JSGC_HIGH_FREQUENCY_TIME_LIMIT, 1000); /* ms */
     // JS_SetGCParameter(cx, JSGC_LOW_FREQUENCY_HEAP_GROWTH, 150);
     // JS_SetGCParameter(cx, JSGC_HIGH_FREQUENCY_HEAP_GROWTH_MIN, 150);
@@ -231,6 +325,8 @@ JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs) {
 
     JS_AddFinalizeCallback(cx, gjs_finalize_callback, uninitialized_gjs);
     JS_SetGCCallback(cx, on_garbage_collect, uninitialized_gjs);
+    JS::SetGCSliceCallback(cx, on_gc_slice);
+    JS::SetGCNurseryCollectionCallback(cx, on_nursery_collection);
     JS::SetWarningReporter(cx, gjs_warning_reporter);
     JS::SetJobQueue(cx, dynamic_cast<JS::JobQueue*>(uninitialized_gjs));
     JS::SetPromiseRejectionTrackerCallback(cx, on_promise_unhandled_rejection,
@@ -256,12 +352,28 @@ JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs) {
     JS::ContextOptionsRef(cx)
         .setAsmJS(enable_jit);
 
-    uint32_t value = enable_jit ? 1 : 0;
+    // The JIT options are process-wide, not per context. Only a context whose
+    // profile differs from the default changes them, so that one created
+    // later with the default profile does not undo another context's choice.
+    // uint32_t(-1) puts back SpiderMonkey's default.
+    if (!enable_jit) {
+        JS_SetGlobalJitCompilerOption(
+            cx, JSJitCompilerOption::JSJITCOMPILER_ION_ENABLE, 0);
+        JS_SetGlobalJitCompilerOption(
+            cx, JSJitCompilerOption::JSJITCOMPILER_BASELINE_ENABLE, 0);
+    } else if (profile != GjsTuningProfile::DEFAULT) {
+        JS_SetGlobalJitCompilerOption(
+            cx, JSJitCompilerOption::JSJITCOMPILER_ION_ENABLE, tuning.ion);
+    }
 
-    JS_SetGlobalJitCompilerOption(
-        cx, JSJitCompilerOption::JSJITCOMPILER_ION_ENABLE, value);
-    JS_SetGlobalJitCompilerOption(
-        cx, JSJitCompilerOption::JSJITCOMPILER_BASELINE_ENABLE, value);
+    if (profile != GjsTuningProfile::DEFAULT) {
+        JS_SetGlobalJitCompilerOption(
+            cx, JSJitCompilerOption::JSJITCOMPILER_BASELINE_WARMUP_TRIGGER,
+            tuning.baseline_warmup ? tuning.baseline_warmup : uint32_t(-1));
+        JS_SetGlobalJitCompilerOption(
+            cx, JSJitCompilerOption::JSJITCOMPILER_ION_NORMAL_WARMUP_TRIGGER,
+            tuning.ion_warmup ? tuning.ion_warmup : uint32_t(-1));
+    }
 
     return cx;
 }
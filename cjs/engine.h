@@ -25,11 +25,52 @@
 #define GJS_ENGINE_H_
 
 #include <stddef.h>  // for size_t
+#include <stdint.h>
 
 class GjsContextPrivate;
 struct JSContext;
 
-JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs);
+// Named sets of SpiderMonkey settings for different workloads, selected with
+// the GjsContext:tuning-profile property
+enum class GjsTuningProfile : uint8_t {
+    DEFAULT,
+    INTERACTIVE,
+    THROUGHPUT,
+    LOW_MEMORY,
+    STARTUP,
+};
+
+struct GjsTuning {
+    const char* name;
+    // Bounds of the nursery size, or 0 to keep SpiderMonkey's default
+    uint32_t min_nursery_bytes;
+    uint32_t max_nursery_bytes;
+    // Length of SpiderMonkey's own incremental GC slices
+    uint32_t engine_slice_budget_ms;
+    // Length of the GC slices run from the main loop, see
+    // GjsContextPrivate::gc_slice_budget(); GJS_GC_SLICE_BUDGET overrides it
+    int64_t gc_slice_budget_usec;
+    bool compacting;
+    // Seconds without JS running after which the heap is compacted, see
+    // GjsContextPrivate::shrink_heap(), or 0 for never; GJS_IDLE_SHRINK_DELAY
+    // overrides it
+    unsigned idle_shrink_delay_sec;
+    // Run the GCs scheduled after releasing GObjects all at once; setting
+    // GJS_GC_POLICY overrides it
+    bool full_gc;
+    // Number of calls or loop iterations before a script is compiled by the
+    // Baseline JIT or by Ion, or 0 to keep SpiderMonkey's default
+    uint32_t baseline_warmup;
+    uint32_t ion_warmup;
+    bool ion;
+};
+
+[[nodiscard]] bool gjs_tuning_profile_from_name(const char* name,
+                                                GjsTuningProfile* profile_out);
+[[nodiscard]] const GjsTuning& gjs_tuning_profile_get(GjsTuningProfile profile);
+
+JSContext* gjs_create_js_context(GjsContextPrivate* uninitialized_gjs,
+                                 GjsTuningProfile profile);
 
 bool gjs_load_internal_source(JSContext* cx, const char* filename, char** src,
                               size_t* length);
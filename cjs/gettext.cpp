@@ -0,0 +1,164 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <glib/gi18n.h>  // for g_dgettext, g_dpgettext2
+
+#include <js/CallArgs.h>
+#include <js/GCHashTable.h>  // for GCHashMap
+#include <js/Id.h>
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TracingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars
+#include <js/Value.h>
+#include <jsapi.h>  // for JS_DefineFunctions, JS_NewPlainObject, ...
+
+#include "cjs/context-private.h"
+#include "cjs/gettext.h"
+#include "cjs/jsapi-util.h"
+#include "libgjs-private/gjs-util.h"
+
+void GjsGettextCache::Entry::trace(JSTracer* trc) {
+    JS::TraceEdge(trc, &domain, "GjsGettextCache domain");
+    JS::TraceEdge(trc, &context, "GjsGettextCache context");
+    JS::TraceEdge(trc, &translation, "GjsGettextCache translation");
+}
+
+bool GjsGettextCache::get(JSContext* cx, JS::HandleValue domain,
+                          JS::HandleValue context, JS::HandleString msgid,
+                          JS::MutableHandleValue value_p) {
+    unsigned generation = gjs_gettext_generation();
+    if (generation != m_generation) {
+        clear();
+        m_generation = generation;
+    }
+
+    JS::RootedId domain_id(cx, JSID_VOID), context_id(cx, JSID_VOID),
+        msgid_id(cx);
+    if ((!domain.isNull() && !JS_ValueToId(cx, domain, &domain_id)) ||
+        (!context.isNull() && !JS_ValueToId(cx, context, &context_id)) ||
+        !JS_StringToId(cx, msgid, &msgid_id))
+        return false;
+
+    Table::Ptr entry = m_table.lookup(msgid_id);
+    if (entry && entry->value().domain.get() == domain_id.get() &&
+        entry->value().context.get() == context_id.get()) {
+        value_p.setString(entry->value().translation);
+        return true;
+    }
+
+    JS::UniqueChars domain_utf8, context_utf8;
+    if (!domain.isNull() && !(domain_utf8 = gjs_string_to_utf8(cx, domain)))
+        return false;
+    if (!context.isNull() &&
+        !(context_utf8 = gjs_string_to_utf8(cx, context)))
+        return false;
+    JS::UniqueChars msgid_utf8 = gjs_string_to_utf8(cx, JS::StringValue(msgid));
+    if (!msgid_utf8)
+        return false;
+
+    const char* translated =
+        context_utf8 ? g_dpgettext2(domain_utf8.get(), context_utf8.get(),
+                                    msgid_utf8.get())
+                     : g_dgettext(domain_utf8.get(), msgid_utf8.get());
+
+    // gettext returns the message ID itself if there is no translation
+    if (translated == msgid_utf8.get())
+        value_p.setString(msgid);
+    else if (!gjs_string_from_utf8(cx, translated, value_p))
+        return false;
+
+    if (m_table.count() >= MAX_ENTRIES)
+        clear();
+
+    if (!m_table.put(msgid_id, Entry(domain_id, context_id,
+                                     value_p.toString()))) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    return true;
+}
+
+void GjsGettextCache::trace(JSTracer* trc) { m_table.trace(trc); }
+
+void GjsGettextCache::clear() { m_table.clearAndCompact(); }
+
+// All but the last argument are strings or null, and the last one is the
+// message ID string
+GJS_JSAPI_RETURN_CONVENTION
+static bool check_args(JSContext* cx, const char* func_name,
+                       const JS::CallArgs& args, unsigned n_args) {
+    if (!args.requireAtLeast(cx, func_name, n_args))
+        return false;
+
+    for (unsigned ix = 0; ix < n_args - 1; ix++) {
+        if (!args[ix].isNull() && !args[ix].isString()) {
+            gjs_throw(cx, "%s: argument %u must be a string or null",
+                      func_name, ix + 1);
+            return false;
+        }
+    }
+
+    if (!args[n_args - 1].isString()) {
+        gjs_throw(cx, "%s: message ID must be a string", func_name);
+        return false;
+    }
+    return true;
+}
+
+// dgettext(domain, msgid)
+GJS_JSAPI_RETURN_CONVENTION
+static bool dgettext_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!check_args(cx, "dgettext", args, 2))
+        return false;
+
+    JS::RootedString msgid(cx, args[1].toString());
+    return GjsContextPrivate::from_cx(cx)->gettext_cache().get(
+        cx, args[0], JS::NullHandleValue, msgid, args.rval());
+}
+
+// dpgettext(domain, context, msgid)
+GJS_JSAPI_RETURN_CONVENTION
+static bool dpgettext_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!check_args(cx, "dpgettext", args, 3))
+        return false;
+
+    JS::RootedString msgid(cx, args[2].toString());
+    return GjsContextPrivate::from_cx(cx)->gettext_cache().get(
+        cx, args[0], args[1], msgid, args.rval());
+}
+
+static JSFunctionSpec gjs_gettext_module_funcs[] = {
+    JS_FN("dgettext", dgettext_func, 2, 0),
+    JS_FN("dpgettext", dpgettext_func, 3, 0), JS_FS_END};
+
+bool gjs_define_gettext_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    return module && JS_DefineFunctions(cx, module, gjs_gettext_module_funcs);
+}
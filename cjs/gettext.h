@@ -0,0 +1,95 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_GETTEXT_H_
+#define GJS_GETTEXT_H_
+
+#include <config.h>
+
+#include <js/GCHashTable.h>  // for GCHashMap
+#include <js/Id.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for SystemAllocPolicy
+#include <mozilla/HashFunctions.h>  // for HashGeneric, HashNumber
+
+#include "cjs/macros.h"
+
+class JSTracer;
+
+// Cache of translated strings for imports.gettext. User interface code calls
+// _("...") in update paths over and over with the same message IDs, and each
+// call would otherwise go through GI, converting the message ID to UTF-8 and
+// the translation back to a new JSString.
+//
+// Entries are keyed by the message ID's atom, so a hit costs only a hash
+// lookup. Each message ID remembers one translation, for the domain and
+// context that it was last looked up in. The whole cache is dropped when
+// setlocale(), textdomain() or bindtextdomain() are called through
+// imports.gettext, since any of them can change the translations.
+class GjsGettextCache {
+    static constexpr unsigned MAX_ENTRIES = 4096;
+
+    struct Entry {
+        JS::Heap<jsid> domain;   // JSID_VOID for the default domain
+        JS::Heap<jsid> context;  // JSID_VOID for no context
+        JS::Heap<JSString*> translation;
+
+        Entry(jsid domain_id, jsid context_id, JSString* str)
+            : domain(domain_id), context(context_id), translation(str) {}
+
+        void trace(JSTracer* trc);
+    };
+
+    struct IdHasher {
+        using Lookup = jsid;
+        // Atoms and symbols are never moved by the GC
+        static mozilla::HashNumber hash(jsid id) {
+            return mozilla::HashGeneric(JSID_BITS(id));
+        }
+        static bool match(jsid id1, jsid id2) { return id1 == id2; }
+    };
+
+    using Table = JS::GCHashMap<JS::Heap<jsid>, Entry, IdHasher,
+                                js::SystemAllocPolicy>;
+
+    Table m_table;
+    unsigned m_generation = 0;
+
+ public:
+    // Sets @value_p to the translation of @msgid in @domain and @context,
+    // which are null for the default domain and no context
+    GJS_JSAPI_RETURN_CONVENTION
+    bool get(JSContext* cx, JS::HandleValue domain, JS::HandleValue context,
+             JS::HandleString msgid, JS::MutableHandleValue value_p);
+
+    void trace(JSTracer* trc);
+    void clear();
+};
+
+// Native part of imports.gettext, which is defined in modules/core/_gettext.js
+// on top of it
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_define_gettext_stuff(JSContext* cx, JS::MutableHandleObject module);
+
+#endif  // GJS_GETTEXT_H_
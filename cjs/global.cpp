@@ -51,6 +51,7 @@
 #include "cjs/global.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/native.h"
+#include "cjs/script-cache.h"
 
 namespace mozilla {
 union Utf8Unit;
@@ -115,7 +116,9 @@ class GjsBaseGlobal {
                          JS::SourceOwnership::TakeOwnership))
             return false;
 
-        JS::RootedScript compiled_script(cx, JS::Compile(cx, options, source));
+        JS::RootedScript compiled_script(
+            cx, gjs_script_cache_compile(cx, options, source,
+                                         /* non_syntactic = */ false));
         if (!compiled_script)
             return false;
 
@@ -70,6 +70,10 @@ enum class GjsGlobalSlot : uint32_t {
     PROTOTYPE_cairo_surface,
     PROTOTYPE_cairo_surface_pattern,
     PROTOTYPE_cairo_svg_surface,
+    PROTOTYPE_property_tween,
+    PROTOTYPE_signal_connections,
+    PROTOTYPE_string_builder,
+    PROTOTYPE_worker,
     LAST,
 };
 
@@ -0,0 +1,300 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>  // for strlen
+
+#include <memory>  // for make_unique, unique_ptr
+#include <string>
+#include <unordered_map>
+
+#include <glib-object.h>
+#include <glib.h>
+
+#include <js/GCAPI.h>  // for FinishIncrementalGC, IsIncrementalGCInProgress
+#include <js/UbiNode.h>
+#include <js/UbiNodeBreadthFirst.h>
+#include <jsapi.h>  // for JS_GetClass
+#include <mozilla/Maybe.h>
+
+#include "gi/object.h"
+#include "cjs/heap-snapshot.h"
+#include "cjs/jsapi-util.h"
+#include "util/log.h"
+
+static constexpr char SNAPSHOT_MAGIC[8] = {'G', 'J', 'S', 'H', 'E', 'A', 'P', 1};
+
+enum SnapshotTag : uint8_t {
+    TAG_END = 0,
+    TAG_STRING = 1,
+    TAG_NODE = 2,
+    TAG_SOURCE = 3,
+    TAG_EDGE = 4,
+};
+
+// Only the GC cell itself is counted in node sizes; the engine does not give
+// us a usable malloc size function in a standalone build
+static size_t no_malloc_size_of(const void*) { return 0; }
+
+class GjsHeapSnapshotWriter {
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    FILE* m_fp;
+    size_t m_used = 0;
+    bool m_failed = false;
+    uint64_t m_next_string = 1;
+    // Type and class names are static strings, so look them up by address
+    std::unordered_map<const void*, uint64_t> m_static_strings;
+    std::unordered_map<std::string, uint64_t> m_strings;
+    std::string m_scratch;
+    uint8_t m_buffer[BUFFER_SIZE];
+
+    void flush() {
+        if (m_used && fwrite(m_buffer, 1, m_used, m_fp) != m_used)
+            m_failed = true;
+        m_used = 0;
+    }
+
+    void write_bytes(const void* data, size_t len) {
+        if (m_used + len > BUFFER_SIZE)
+            flush();
+        if (len > BUFFER_SIZE) {
+            if (fwrite(data, 1, len, m_fp) != len)
+                m_failed = true;
+            return;
+        }
+        memcpy(m_buffer + m_used, data, len);
+        m_used += len;
+    }
+
+    void write_byte(uint8_t byte) {
+        if (m_used == BUFFER_SIZE)
+            flush();
+        m_buffer[m_used++] = byte;
+    }
+
+    void write_uint(uint64_t value) {
+        do {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            write_byte(value ? byte | 0x80 : byte);
+        } while (value);
+    }
+
+    void write_inline_string(const char* str, size_t len) {
+        write_uint(len);
+        write_bytes(str, len);
+    }
+
+    uint64_t add_string(const std::string& str) {
+        write_byte(TAG_STRING);
+        write_inline_string(str.data(), str.size());
+        return m_next_string++;
+    }
+
+ public:
+    explicit GjsHeapSnapshotWriter(FILE* fp) : m_fp(fp) {
+        write_bytes(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    }
+
+    [[nodiscard]] bool ok() const { return !m_failed; }
+
+    [[nodiscard]] bool finish() {
+        write_byte(TAG_END);
+        flush();
+        return ok();
+    }
+
+    uint64_t static_string(const char* str) {
+        if (!str)
+            return 0;
+        auto it = m_static_strings.find(str);
+        if (it != m_static_strings.end())
+            return it->second;
+        uint64_t id = string_id(str);
+        m_static_strings.emplace(str, id);
+        return id;
+    }
+
+    uint64_t static_string(const char16_t* str) {
+        if (!str)
+            return 0;
+        auto it = m_static_strings.find(str);
+        if (it != m_static_strings.end())
+            return it->second;
+        uint64_t id = string_id(str);
+        m_static_strings.emplace(str, id);
+        return id;
+    }
+
+    uint64_t string_id(const char* str) {
+        m_scratch.assign(str);
+        auto it = m_strings.find(m_scratch);
+        if (it != m_strings.end())
+            return it->second;
+        uint64_t id = add_string(m_scratch);
+        m_strings.emplace(m_scratch, id);
+        return id;
+    }
+
+    // Edge names are mostly ASCII property names, so avoid a conversion
+    // allocation per edge in that case
+    uint64_t string_id(const char16_t* str) {
+        if (!str)
+            return 0;
+        m_scratch.clear();
+        for (const char16_t* c = str; *c; c++) {
+            if (*c >= 0x80) {
+                GjsAutoChar utf8 = g_utf16_to_utf8(
+                    reinterpret_cast<const gunichar2*>(str), -1, nullptr,
+                    nullptr, nullptr);
+                if (!utf8)
+                    return 0;
+                return string_id(utf8.get());
+            }
+            m_scratch.push_back(static_cast<char>(*c));
+        }
+        auto it = m_strings.find(m_scratch);
+        if (it != m_strings.end())
+            return it->second;
+        uint64_t id = add_string(m_scratch);
+        m_strings.emplace(m_scratch, id);
+        return id;
+    }
+
+    void write_node(const JS::ubi::Node& node) {
+        uint64_t type = static_string(node.typeName());
+        uint64_t klass = static_string(node.jsObjectClassName());
+
+        // Wrappers are what one usually hunts for in a leak, and the JS class
+        // alone doesn't say which GObject they belong to
+        GjsAutoChar detail;
+        if (node.is<JSObject>()) {
+            JSObject* obj = node.as<JSObject>();
+            if (JS_GetClass(obj) == &ObjectBase::klass) {
+                ObjectBase* priv = ObjectBase::for_js_nocheck(obj);
+                if (priv && priv->is_prototype())
+                    detail = g_strdup_printf("%s prototype",
+                                             priv->type_name());
+                else if (priv)
+                    detail = g_strdup_printf("%s %p", priv->type_name(),
+                                             priv->to_instance()->ptr());
+            }
+        }
+
+        write_byte(TAG_NODE);
+        write_uint(node.identifier());
+        write_uint(type);
+        write_uint(klass);
+        write_uint(node.size(no_malloc_size_of));
+        if (detail)
+            write_inline_string(detail, strlen(detail));
+        else
+            write_uint(0);
+    }
+
+    void write_source(uint64_t id) {
+        write_byte(TAG_SOURCE);
+        write_uint(id);
+    }
+
+    void write_edge(uint64_t target, uint64_t name) {
+        write_byte(TAG_EDGE);
+        write_uint(target);
+        write_uint(name);
+    }
+};
+
+class GjsHeapSnapshotHandler {
+    GjsHeapSnapshotWriter* m_writer;
+    JS::ubi::Node::Id m_roots;
+    JS::ubi::Node::Id m_source;
+
+ public:
+    struct NodeData {};
+    using Traversal = JS::ubi::BreadthFirst<GjsHeapSnapshotHandler>;
+
+    GjsHeapSnapshotHandler(GjsHeapSnapshotWriter* writer,
+                           const JS::ubi::Node& roots)
+        : m_writer(writer),
+          m_roots(roots.identifier()),
+          m_source(roots.identifier()) {
+        m_writer->write_source(0);
+    }
+
+    // The traversal visits all the edges of one node before moving to the
+    // next, so each node's outgoing edges form one contiguous run
+    bool operator()(Traversal&, JS::ubi::Node origin,
+                    const JS::ubi::Edge& edge, NodeData*, bool first) {
+        JS::ubi::Node::Id source = origin.identifier();
+        if (source != m_source) {
+            m_source = source;
+            m_writer->write_source(source == m_roots ? 0 : source);
+        }
+
+        if (first)
+            m_writer->write_node(edge.referent);
+
+        m_writer->write_edge(edge.referent.identifier(),
+                             m_writer->string_id(edge.name.get()));
+        return m_writer->ok();
+    }
+};
+
+/**
+ * gjs_heap_snapshot_write:
+ * @cx: the JS context
+ * @fp: file to append the snapshot to
+ *
+ * Walks everything reachable from the GC roots of @cx's runtime and streams
+ * it to @fp in the format described in heap-snapshot.h. Memory use is bounded
+ * by the set of visited nodes and the string table, not by the output.
+ *
+ * Returns: false on OOM or a write error; no JS exception is pending.
+ */
+bool gjs_heap_snapshot_write(JSContext* cx, FILE* fp) {
+    if (JS::IsIncrementalGCInProgress(cx))
+        JS::FinishIncrementalGC(cx, JS::GCReason::API);
+
+    auto writer = std::make_unique<GjsHeapSnapshotWriter>(fp);
+
+    mozilla::Maybe<JS::AutoCheckCannotGC> nogc;
+    JS::ubi::RootList roots(cx, nogc, /* wantNames = */ true);
+    if (!roots.init())
+        return false;
+
+    JS::ubi::Node roots_node(&roots);
+    GjsHeapSnapshotHandler handler(writer.get(), roots_node);
+    GjsHeapSnapshotHandler::Traversal traversal(cx, handler, nogc.ref());
+    traversal.wantNames = true;
+    if (!traversal.addStart(roots_node) || !traversal.traverse()) {
+        gjs_debug(GJS_DEBUG_CONTEXT, "Heap snapshot incomplete");
+        return false;
+    }
+
+    return writer->finish();
+}
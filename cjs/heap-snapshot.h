@@ -0,0 +1,54 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_HEAP_SNAPSHOT_H_
+#define GJS_HEAP_SNAPSHOT_H_
+
+#include <config.h>
+
+#include <stdio.h>  // for FILE
+
+#include <js/TypeDecls.h>
+
+// Compact binary heap snapshots, streamed to a file while walking the heap
+// graph, as an alternative to the text format of js::DumpHeap() which can be
+// several times larger than the heap it describes.
+//
+// A snapshot starts with the 8 bytes "GJSHEAP\1" and is followed by records,
+// each starting with a one-byte tag. All integers are unsigned LEB128.
+//
+//   STRING  (1): length, UTF-8 bytes. Strings are numbered from 1 in the
+//                order they appear; 0 means "no string".
+//   NODE    (2): node id, type string, class string, size in bytes, and an
+//                inline detail string (length, bytes), e.g. the GType name
+//                and address of a GObject wrapper.
+//   SOURCE  (3): node id that following EDGE records originate from; 0 for
+//                the GC roots.
+//   EDGE    (4): target node id, edge name string.
+//   END     (0): end of the snapshot.
+//
+// Node ids are the addresses of the GC things. Several snapshots may be
+// concatenated in one file, each with its own string numbering.
+[[nodiscard]] bool gjs_heap_snapshot_write(JSContext* cx, FILE* fp);
+
+#endif  // GJS_HEAP_SNAPSHOT_H_
@@ -30,10 +30,19 @@
 #    include <windows.h>
 #endif
 
+#include <algorithm>  // for any_of
+#include <condition_variable>
+#include <iterator>  // for begin, end
+#include <list>
+#include <memory>  // for unique_ptr, make_unique, shared_ptr
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>  // for move
 #include <vector>   // for vector
 
 #include <gio/gio.h>
+#include <girepository.h>
 #include <glib-object.h>
 #include <glib.h>
 
@@ -41,10 +50,14 @@
 #include <js/CallArgs.h>
 #include <js/CharacterEncoding.h>
 #include <js/Class.h>
+#include <js/CompileOptions.h>
 #include <js/Id.h>        // for PropertyKey, JSID_IS_STRING
+#include <js/OffThreadScriptCompilation.h>
+#include <js/Promise.h>
 #include <js/PropertyDescriptor.h>
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
+#include <js/SourceText.h>
 #include <js/Symbol.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
@@ -56,8 +69,10 @@
 
 #include "cjs/atoms.h"
 #include "cjs/context-private.h"
+#include "cjs/global.h"
 #include "cjs/importer.h"
 #include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem-private.h"
 #include "cjs/module.h"
@@ -66,9 +81,67 @@
 
 #define MODULE_INIT_FILENAME "__init__.js"
 
-typedef struct {
+/* A search path entry naming a file with this suffix is an application
+ * bundle: a compiled GResource file which has a key file at
+ * BUNDLE_METADATA_PATH, like
+ *
+ *   [Bundle]
+ *   Root=/org/example/MyApplet/js
+ *   Requires=Gtk-3.0;Soup-2.4
+ *
+ * The bundle is mapped and registered the first time the entry is searched,
+ * and from then on the entry stands for the resource directory named by Root.
+ * Module lookups are then lookups in the bundle's hashed index, and module
+ * sources point into the mapping. The typelibs listed in Requires are loaded
+ * when the bundle is mounted, so that a missing dependency is reported up
+ * front. */
+#define BUNDLE_SUFFIX ".gresource"
+#define BUNDLE_METADATA_PATH "/cjs-bundle.ini"
+
+/* Bundles are registered with the process-wide resources, so they are
+ * mounted once per process, by path. An empty root means that the path is
+ * not a bundle file after all. */
+static std::mutex mounted_bundles_lock;
+static std::unordered_map<std::string, std::string> mounted_bundles;
+
+/* The contents of one search path directory, read with a single enumeration
+ * instead of querying each candidate file for every import. Listings are read
+ * again when they are marked stale: by a file monitor if GJS_IMPORTER_MONITOR
+ * is set, or when an import finds nothing in them. */
+struct GjsImporterDirListing {
+    std::unordered_map<std::string, GFileType> entries;
+    GjsAutoUnref<GFileMonitor> monitor;
+    bool stale = false;
+};
+
+/* Module sources read ahead on worker threads, by URI, see
+ * gjs_importer_prefetch() */
+struct GjsImportPrefetch {
+    struct Source {
+        GjsAutoChar contents;
+        size_t length = 0;
+        bool done = false;
+        std::list<std::string>::iterator age;
+    };
+
+    std::mutex lock;
+    std::condition_variable loaded;
+    std::unordered_map<std::string, Source> sources;
+    // The URIs in @sources, oldest first, so the ones that were never taken
+    // can make room for new ones
+    std::list<std::string> ages;
+    GjsAutoUnref<GCancellable> cancellable = g_cancellable_new();
+};
+
+struct Importer {
     bool is_root;
-} Importer;
+    std::unordered_map<std::string, std::unique_ptr<GjsImporterDirListing>>
+        dir_cache;
+    // The search path entries that dir_cache was read for
+    std::vector<std::string> search_path;
+    // Only on the root importer
+    std::shared_ptr<GjsImportPrefetch> prefetch;
+};
 
 extern const JSClass gjs_importer_class;
 
@@ -279,6 +352,21 @@ cancel_import(JSContext       *context,
     }
 }
 
+// GObject wrappers and the rest of the GI state are only safe to use on the
+// main thread, so workers only get the native modules that stay clear of them
+static constexpr const char* WORKER_NATIVE_MODULES[] = {
+    "_encodingNative", "_formatNative", "_gettextNative", "_performanceNative",
+    "_print",          "_signalsNative", "_timers",       "_workerNative",
+};
+
+[[nodiscard]] static bool native_module_allowed_in_worker(const char* name) {
+    return std::any_of(std::begin(WORKER_NATIVE_MODULES),
+                       std::end(WORKER_NATIVE_MODULES),
+                       [name](const char* allowed) {
+                           return strcmp(name, allowed) == 0;
+                       });
+}
+
 /*
  * gjs_import_native_module:
  * @cx: the #JSContext
@@ -299,6 +387,12 @@ gjs_import_native_module(JSContext       *cx,
 {
     gjs_debug(GJS_DEBUG_IMPORTER, "Importing '%s'", parse_name);
 
+    if (GjsContextPrivate::from_cx(cx)->worker() &&
+        !native_module_allowed_in_worker(parse_name)) {
+        gjs_throw(cx, "imports.%s is not available in workers", parse_name);
+        return false;
+    }
+
     JS::RootedObject module(cx);
     return gjs_load_native_module(cx, parse_name, &module) &&
            define_meta_properties(cx, module, nullptr, parse_name, importer) &&
@@ -378,6 +472,396 @@ static JSObject* load_module_init(JSContext* cx, JS::HandleObject in_object,
     return module_obj;
 }
 
+static void on_search_path_dir_changed(GFileMonitor*, GFile*, GFile*,
+                                       GFileMonitorEvent, void* data) {
+    static_cast<GjsImporterDirListing*>(data)->stale = true;
+}
+
+static void read_dir_listing(const char* dirname,
+                             GjsImporterDirListing* listing) {
+    listing->entries.clear();
+    listing->stale = false;
+
+    /* new_for_commandline_arg handles resource:/// paths */
+    GjsAutoUnref<GFile> dir = g_file_new_for_commandline_arg(dirname);
+    GjsAutoUnref<GFileEnumerator> direnum = g_file_enumerate_children(
+        dir, G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE,
+        G_FILE_QUERY_INFO_NONE, nullptr, nullptr);
+    if (!direnum)
+        return;  // a missing directory is cached as an empty one
+
+    GFileInfo* info;
+    while (g_file_enumerator_iterate(direnum, &info, nullptr, nullptr,
+                                     nullptr) &&
+           info)
+        listing->entries.emplace(g_file_info_get_name(info),
+                                 g_file_info_get_file_type(info));
+
+    // Resources can't be monitored; a resource registered later is found by
+    // reading the listing again when an import misses
+    static const bool monitor_dirs = !!g_getenv("GJS_IMPORTER_MONITOR");
+    if (monitor_dirs && !listing->monitor && g_file_is_native(dir)) {
+        listing->monitor = g_file_monitor_directory(
+            dir, G_FILE_MONITOR_NONE, nullptr, nullptr);
+        if (listing->monitor)
+            g_signal_connect(listing->monitor, "changed",
+                             G_CALLBACK(on_search_path_dir_changed), listing);
+    }
+}
+
+/* Forgets the directory listings when the search path is not the one they
+ * were read for, since they may be out of date by the time it is changed.
+ * Called with each entry as the search path is walked. */
+static void check_search_path_entry(Importer* priv, uint32_t ix,
+                                    const char* dirname) {
+    if (ix < priv->search_path.size() && priv->search_path[ix] == dirname)
+        return;
+    priv->dir_cache.clear();
+    priv->search_path.resize(ix);
+    priv->search_path.emplace_back(dirname);
+}
+
+/* Returns the type of the file @name in the search path directory @dirname,
+ * or G_FILE_TYPE_UNKNOWN if it doesn't exist. */
+[[nodiscard]] static GFileType importer_query_file_type(Importer* priv,
+                                                        const char* dirname,
+                                                        const char* name) {
+    // Only direct children of the directory are in the listing
+    if (strchr(name, '/') || strchr(name, G_DIR_SEPARATOR) ||
+        strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        GjsAutoChar full_path = g_build_filename(dirname, name, nullptr);
+        GjsAutoUnref<GFile> file = g_file_new_for_commandline_arg(full_path);
+        return g_file_query_file_type(file, G_FILE_QUERY_INFO_NONE, nullptr);
+    }
+
+    auto& listing = priv->dir_cache[dirname];
+    if (!listing) {
+        listing = std::make_unique<GjsImporterDirListing>();
+        read_dir_listing(dirname, listing.get());
+    } else if (listing->stale) {
+        read_dir_listing(dirname, listing.get());
+    }
+
+    auto entry = listing->entries.find(name);
+    if (entry == listing->entries.end())
+        return G_FILE_TYPE_UNKNOWN;
+    return entry->second;
+}
+
+[[nodiscard]] static bool mount_bundle(const char* path, std::string* root_out,
+                                       GError** error) {
+    GjsAutoPointer<GResource, GResource, g_resource_unref> resource =
+        g_resource_load(path, error);
+    if (!resource)
+        return false;
+
+    GjsAutoPointer<GBytes, GBytes, g_bytes_unref> metadata =
+        g_resource_lookup_data(resource, BUNDLE_METADATA_PATH,
+                               G_RESOURCE_LOOKUP_FLAGS_NONE, error);
+    if (!metadata) {
+        g_prefix_error(error, "Bundle %s has no %s: ", path,
+                       BUNDLE_METADATA_PATH);
+        return false;
+    }
+
+    GjsAutoPointer<GKeyFile, GKeyFile, g_key_file_free> keyfile =
+        g_key_file_new();
+    if (!g_key_file_load_from_bytes(keyfile, metadata, G_KEY_FILE_NONE,
+                                    error)) {
+        g_prefix_error(error, "Bundle %s: ", path);
+        return false;
+    }
+
+    GjsAutoChar root = g_key_file_get_string(keyfile, "Bundle", "Root", error);
+    if (!root || root[0] != '/') {
+        if (root)
+            g_set_error(error, G_KEY_FILE_ERROR,
+                        G_KEY_FILE_ERROR_INVALID_VALUE,
+                        "Root must be an absolute resource path");
+        g_prefix_error(error, "Bundle %s: ", path);
+        return false;
+    }
+
+    GjsAutoStrv requirements = g_key_file_get_string_list(
+        keyfile, "Bundle", "Requires", nullptr, nullptr);
+    for (char** require = requirements; require && *require; require++) {
+        char* dash = strrchr(*require, '-');
+        if (!dash) {
+            g_set_error(error, G_KEY_FILE_ERROR,
+                        G_KEY_FILE_ERROR_INVALID_VALUE,
+                        "Bundle %s: requirement '%s' is not Namespace-Version",
+                        path, *require);
+            return false;
+        }
+        GjsAutoChar ns = g_strndup(*require, dash - *require);
+        if (!g_irepository_require(nullptr, ns, dash + 1,
+                                   GIRepositoryLoadFlags(0), error)) {
+            g_prefix_error(error, "Bundle %s requires %s: ", path, *require);
+            return false;
+        }
+    }
+
+    g_resources_register(resource);
+    *root_out = std::string("resource://") + root.get();
+    return true;
+}
+
+/* Replaces a search path entry that names a bundle with the resource
+ * directory of its modules, mounting the bundle the first time. */
+GJS_JSAPI_RETURN_CONVENTION
+static bool resolve_search_path_entry(JSContext* cx, JS::UniqueChars* dirname) {
+    if (!g_str_has_suffix(dirname->get(), BUNDLE_SUFFIX))
+        return true;
+
+    std::string root;
+    GError* error = nullptr;
+    {
+        std::lock_guard<std::mutex> hold(mounted_bundles_lock);
+        auto entry = mounted_bundles.find(dirname->get());
+        if (entry != mounted_bundles.end()) {
+            root = entry->second;
+        } else if (!g_file_test(dirname->get(), G_FILE_TEST_IS_REGULAR)) {
+            mounted_bundles.emplace(dirname->get(), "");
+        } else if (mount_bundle(dirname->get(), &root, &error)) {
+            mounted_bundles.emplace(dirname->get(), root);
+        }
+    }
+    if (error)
+        return gjs_throw_gerror_message(cx, error);
+
+    if (root.empty())
+        return true;
+    *dirname = JS::DuplicateString(cx, root.c_str());
+    return !!*dirname;
+}
+
+/* Caps the sources held for references that never turn into imports, such
+ * as ones in comments; past it, the oldest ones are dropped */
+static constexpr size_t MAX_PREFETCHED_MODULES = 64;
+
+struct GjsPrefetchRequest {
+    std::shared_ptr<GjsImportPrefetch> prefetch;
+    std::string uri;
+    GjsAutoUnref<GFile> file;
+};
+
+static void prefetch_request_free(void* data) {
+    delete static_cast<GjsPrefetchRequest*>(data);
+}
+
+static void prefetch_thread(GTask*, void*, void* data, GCancellable*) {
+    auto* request = static_cast<GjsPrefetchRequest*>(data);
+    GjsImportPrefetch* prefetch = request->prefetch.get();
+
+    char* contents = nullptr;
+    size_t length = 0;
+    if (!g_file_load_contents(request->file, prefetch->cancellable, &contents,
+                              &length, nullptr, nullptr))
+        contents = nullptr;
+
+    std::lock_guard<std::mutex> hold(prefetch->lock);
+    auto entry = prefetch->sources.find(request->uri);
+    if (entry == prefetch->sources.end() || entry->second.done) {
+        g_free(contents);  // taken meanwhile
+        return;
+    }
+    entry->second.contents = contents;
+    entry->second.length = length;
+    entry->second.done = true;
+    prefetch->loaded.notify_all();
+}
+
+static void prefetch_file(const std::shared_ptr<GjsImportPrefetch>& prefetch,
+                          const char* path) {
+    GjsAutoUnref<GFile> file = g_file_new_for_commandline_arg(path);
+    GjsAutoChar uri = g_file_get_uri(file);
+    {
+        std::lock_guard<std::mutex> hold(prefetch->lock);
+        auto inserted =
+            prefetch->sources.emplace(uri.get(), GjsImportPrefetch::Source());
+        if (!inserted.second)
+            return;
+        inserted.first->second.age =
+            prefetch->ages.insert(prefetch->ages.end(), uri.get());
+
+        // A read of an evicted source still in progress finds it gone, and
+        // drops what it read
+        if (prefetch->sources.size() > MAX_PREFETCHED_MODULES) {
+            prefetch->sources.erase(prefetch->ages.front());
+            prefetch->ages.pop_front();
+        }
+    }
+
+    gjs_debug(GJS_DEBUG_IMPORTER, "Prefetching module source %s", path);
+    auto* request = new GjsPrefetchRequest{prefetch, uri.get(), std::move(file)};
+    GjsAutoUnref<GTask> task = g_task_new(nullptr, nullptr, nullptr, nullptr);
+    g_task_set_task_data(task, request, prefetch_request_free);
+    g_task_run_in_thread(task, prefetch_thread);
+}
+
+[[nodiscard]] static Importer* get_root_importer_priv(JSContext* cx) {
+    JS::RootedObject global(cx, gjs_get_import_global(cx));
+    JS::Value v_importer = gjs_get_global_slot(global, GjsGlobalSlot::IMPORTS);
+    if (!v_importer.isObject())
+        return nullptr;
+    JS::RootedObject importer(cx, &v_importer.toObject());
+    return priv_from_js(cx, importer);
+}
+
+/**
+ * gjs_importer_prefetch:
+ * @cx: the JS context
+ * @script: source code of a script or module about to be evaluated
+ * @script_len: length of @script in bytes
+ *
+ * Looks for top-level `imports.name` and `imports.dir.name` references in
+ * @script, and starts reading the module files they would import from the
+ * root importer's search path on worker threads, so that the synchronous
+ * import finds the contents already in memory instead of waiting for each
+ * file in turn. Only modules in the file system are prefetched; resources are
+ * in memory already. This is a best-effort optimization and never fails.
+ */
+void gjs_importer_prefetch(JSContext* cx, const char* script,
+                           size_t script_len) {
+    static GRegex* imports_regex = g_regex_new(
+        "\\bimports\\.([A-Za-z_$][\\w$]*)(?:\\.([A-Za-z_$][\\w$]*))?",
+        G_REGEX_OPTIMIZE, GRegexMatchFlags(0), nullptr);
+
+    Importer* priv = get_root_importer_priv(cx);
+    if (!priv)
+        return;
+
+    JS::AutoSaveExceptionState saved_exc(cx);
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    JS::RootedObject global(cx, gjs_get_import_global(cx));
+    JS::RootedObject importer(
+        cx, &gjs_get_global_slot(global, GjsGlobalSlot::IMPORTS).toObject());
+    JS::RootedValue v_search_path(cx);
+    bool is_array;
+    if (!JS_GetPropertyById(cx, importer, atoms.search_path(),
+                            &v_search_path) ||
+        !v_search_path.isObject())
+        return;
+    JS::RootedObject search_path(cx, &v_search_path.toObject());
+    uint32_t search_path_len;
+    if (!JS::IsArrayObject(cx, search_path, &is_array) || !is_array ||
+        !JS::GetArrayLength(cx, search_path, &search_path_len))
+        return;
+
+    std::vector<std::string> dirs;
+    JS::RootedValue elem(cx);
+    for (uint32_t i = 0; i < search_path_len; i++) {
+        if (!JS_GetElement(cx, search_path, i, &elem))
+            return;
+        if (!elem.isString())
+            continue;
+        JS::RootedString str(cx, elem.toString());
+        JS::UniqueChars dirname(JS_EncodeStringToUTF8(cx, str));
+        if (!dirname)
+            return;
+        if (dirname[0] != '\0' && !g_str_has_prefix(dirname.get(), "resource:") &&
+            !g_str_has_suffix(dirname.get(), BUNDLE_SUFFIX))
+            dirs.push_back(dirname.get());
+    }
+    if (dirs.empty())
+        return;
+
+    if (!priv->prefetch)
+        priv->prefetch = std::make_shared<GjsImportPrefetch>();
+
+    GMatchInfo* match_info;
+    g_regex_match_full(imports_regex, script, script_len, 0,
+                       GRegexMatchFlags(0), &match_info, nullptr);
+    for (; g_match_info_matches(match_info);
+         g_match_info_next(match_info, nullptr)) {
+        GjsAutoChar name = g_match_info_fetch(match_info, 1);
+        GjsAutoChar child = g_match_info_fetch(match_info, 2);
+        bool imported;
+        if (gjs_is_registered_native_module(name) ||
+            !JS_AlreadyHasOwnProperty(cx, importer, name, &imported))
+            continue;
+        if (imported && !*child)
+            continue;
+        if (imported) {
+            // Already imported as a directory, so look at its sub-importer
+            JS::RootedValue v_subimporter(cx);
+            bool child_imported;
+            if (!JS_GetProperty(cx, importer, name, &v_subimporter) ||
+                !v_subimporter.isObject())
+                continue;
+            JS::RootedObject subimporter(cx, &v_subimporter.toObject());
+            if (!JS_AlreadyHasOwnProperty(cx, subimporter, child,
+                                          &child_imported) ||
+                child_imported)
+                continue;
+        }
+
+        GjsAutoChar filename = g_strdup_printf("%s.js", name.get());
+        GjsAutoChar child_filename =
+            *child ? g_strdup_printf("%s.js", child.get()) : nullptr;
+        bool found_directory = false;
+        for (const std::string& dir : dirs) {
+            const char* dirname = dir.c_str();
+            // Same order of precedence as do_import()
+            if (importer_query_file_type(priv, dirname, name) ==
+                G_FILE_TYPE_DIRECTORY) {
+                found_directory = true;
+                if (!child_filename)
+                    continue;
+                GjsAutoChar subdir = g_build_filename(dirname, name.get(),
+                                                      nullptr);
+                if (importer_query_file_type(priv, subdir, child_filename) !=
+                    G_FILE_TYPE_UNKNOWN) {
+                    GjsAutoChar path =
+                        g_build_filename(subdir, child_filename.get(), nullptr);
+                    prefetch_file(priv->prefetch, path);
+                }
+            } else if (!found_directory && !imported &&
+                       importer_query_file_type(priv, dirname, filename) !=
+                           G_FILE_TYPE_UNKNOWN) {
+                GjsAutoChar path =
+                    g_build_filename(dirname, filename.get(), nullptr);
+                prefetch_file(priv->prefetch, path);
+                break;
+            }
+        }
+    }
+    g_match_info_free(match_info);
+}
+
+/**
+ * gjs_importer_take_prefetched:
+ * @cx: the JS context
+ * @file: module file about to be imported
+ * @length: (out): return location for the length of the contents
+ *
+ * Checks whether the contents of @file were prefetched with
+ * gjs_importer_prefetch(), waiting for the read if it is still in progress.
+ *
+ * Returns: (transfer full) (nullable): the contents of @file, or %NULL if it
+ *   was not prefetched or could not be read
+ */
+char* gjs_importer_take_prefetched(JSContext* cx, GFile* file,
+                                   size_t* length) {
+    Importer* priv = get_root_importer_priv(cx);
+    if (!priv || !priv->prefetch)
+        return nullptr;
+
+    GjsImportPrefetch* prefetch = priv->prefetch.get();
+    GjsAutoChar uri = g_file_get_uri(file);
+    std::unique_lock<std::mutex> hold(prefetch->lock);
+    auto entry = prefetch->sources.find(uri.get());
+    if (entry == prefetch->sources.end())
+        return nullptr;
+
+    prefetch->loaded.wait(hold, [&entry]() { return entry->second.done; });
+    *length = entry->second.length;
+    char* contents = entry->second.contents.release();
+    prefetch->ages.erase(entry->second.age);
+    prefetch->sources.erase(entry);
+    return contents;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool load_module_elements(JSContext* cx, JS::HandleObject in_object,
                                  JS::MutableHandleIdVector prop_ids,
@@ -405,11 +889,23 @@ GJS_JSAPI_RETURN_CONVENTION
 static bool
 import_symbol_from_init_js(JSContext       *cx,
                            JS::HandleObject importer,
+                           Importer        *priv,
                            const char      *dirname,
                            const char      *name,
                            bool            *result)
 {
     bool found;
+
+    // Don't try to load a nonexistent __init__.js for every import
+    if (importer_query_file_type(priv, dirname, MODULE_INIT_FILENAME) ==
+        G_FILE_TYPE_UNKNOWN) {
+        const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+        if (!JS_HasPropertyById(cx, importer, atoms.module_init(), &found))
+            return false;
+        if (!found)
+            return true;
+    }
+
     GjsAutoChar full_path = g_build_filename(dirname, MODULE_INIT_FILENAME,
                                              NULL);
 
@@ -438,9 +934,12 @@ import_symbol_from_init_js(JSContext       *cx,
 GJS_JSAPI_RETURN_CONVENTION
 static bool attempt_import(JSContext* cx, JS::HandleObject obj,
                            JS::HandleId module_id, const char* module_name,
-                           GFile* file) {
+                           GFile* file, JS::HandleScript precompiled) {
     JS::RootedObject module_obj(
-        cx, gjs_module_import(cx, obj, module_id, module_name, file));
+        cx, precompiled ? gjs_module_import_compiled(cx, obj, module_id,
+                                                     module_name, precompiled)
+                        : gjs_module_import(cx, obj, module_id, module_name,
+                                            file));
     if (!module_obj)
         return false;
 
@@ -457,9 +956,10 @@ import_file_on_module(JSContext       *context,
                       JS::HandleObject obj,
                       JS::HandleId     id,
                       const char      *name,
-                      GFile           *file)
+                      GFile           *file,
+                      JS::HandleScript precompiled = nullptr)
 {
-    if (!attempt_import(context, obj, id, name, file)) {
+    if (!attempt_import(context, obj, id, name, file, precompiled)) {
         cancel_import(context, obj, name);
         return false;
     }
@@ -473,7 +973,7 @@ static bool do_import(JSContext* context, JS::HandleObject obj, Importer* priv,
     JS::RootedObject search_path(context);
     guint32 search_path_len;
     guint32 i;
-    bool exists, is_array;
+    bool is_array;
     const GjsAtoms& atoms = GjsContextPrivate::atoms(context);
 
     if (!gjs_object_require_property(context, obj, "importer",
@@ -515,92 +1015,107 @@ static bool do_import(JSContext* context, JS::HandleObject obj, Importer* priv,
     JS::RootedValue elem(context);
     JS::RootedString str(context);
 
-    for (i = 0; i < search_path_len; ++i) {
-        elem.setUndefined();
-        if (!JS_GetElement(context, search_path, i, &elem)) {
-            /* this means there was an exception, while elem.isUndefined()
-             * means no element found
-             */
-            return false;
-        }
+    // A module may have been added, or the resource it is in registered,
+    // after the listings were read, so on a miss they are read again and the
+    // search repeated once
+    for (bool reread = false;; reread = true) {
+        for (i = 0; i < search_path_len; ++i) {
+            elem.setUndefined();
+            if (!JS_GetElement(context, search_path, i, &elem)) {
+                /* this means there was an exception, while elem.isUndefined()
+                 * means no element found
+                 */
+                return false;
+            }
 
-        if (elem.isUndefined())
-            continue;
+            if (elem.isUndefined())
+                continue;
 
-        if (!elem.isString()) {
-            gjs_throw(context, "importer searchPath contains non-string");
-            return false;
-        }
+            if (!elem.isString()) {
+                gjs_throw(context, "importer searchPath contains non-string");
+                return false;
+            }
 
-        str = elem.toString();
-        JS::UniqueChars dirname(JS_EncodeStringToUTF8(context, str));
-        if (!dirname)
-            return false;
+            str = elem.toString();
+            JS::UniqueChars dirname(JS_EncodeStringToUTF8(context, str));
+            if (!dirname)
+                return false;
+            check_search_path_entry(priv, i, dirname.get());
 
-        /* Ignore empty path elements */
-        if (dirname[0] == '\0')
-            continue;
+            /* Ignore empty path elements */
+            if (dirname[0] == '\0')
+                continue;
 
-        /* Try importing __init__.js and loading the symbol from it */
-        bool found = false;
-        if (!import_symbol_from_init_js(context, obj, dirname.get(), name.get(),
-                                        &found))
-            return false;
-        if (found)
-            return true;
+            if (!resolve_search_path_entry(context, &dirname))
+                return false;
 
-        /* Second try importing a directory (a sub-importer) */
-        GjsAutoChar full_path =
-            g_build_filename(dirname.get(), name.get(), nullptr);
-        GjsAutoUnref<GFile> gfile = g_file_new_for_commandline_arg(full_path);
+            /* Try importing __init__.js and loading the symbol from it */
+            bool found = false;
+            if (!import_symbol_from_init_js(context, obj, priv, dirname.get(),
+                                            name.get(), &found))
+                return false;
+            if (found)
+                return true;
+
+            /* Second try importing a directory (a sub-importer) */
+            GjsAutoChar full_path =
+                g_build_filename(dirname.get(), name.get(), nullptr);
+
+            if (importer_query_file_type(priv, dirname.get(), name.get()) ==
+                G_FILE_TYPE_DIRECTORY) {
+                gjs_debug(GJS_DEBUG_IMPORTER,
+                          "Adding directory '%s' to child importer '%s'",
+                          full_path.get(), name.get());
+                directories.push_back(full_path.get());
+            }
 
-        if (g_file_query_file_type(gfile, (GFileQueryInfoFlags) 0, NULL) == G_FILE_TYPE_DIRECTORY) {
-            gjs_debug(GJS_DEBUG_IMPORTER,
-                      "Adding directory '%s' to child importer '%s'",
-                      full_path.get(), name.get());
-            directories.push_back(full_path.get());
-        }
+            /* If we just added to directories, we know we don't need to
+             * check for a file.  If we added to directories on an earlier
+             * iteration, we want to ignore any files later in the
+             * path. So, always skip the rest of the loop block if we have
+             * directories.
+             */
+            if (!directories.empty())
+                continue;
 
-        /* If we just added to directories, we know we don't need to
-         * check for a file.  If we added to directories on an earlier
-         * iteration, we want to ignore any files later in the
-         * path. So, always skip the rest of the loop block if we have
-         * directories.
-         */
-        if (!directories.empty())
-            continue;
+            /* Third, if it's not a directory, try importing a file */
+            if (importer_query_file_type(priv, dirname.get(), filename) ==
+                G_FILE_TYPE_UNKNOWN) {
+                gjs_debug(GJS_DEBUG_IMPORTER, "JS import '%s' not found in %s",
+                          name.get(), dirname.get());
+                continue;
+            }
 
-        /* Third, if it's not a directory, try importing a file */
-        full_path = g_build_filename(dirname.get(), filename.get(), nullptr);
-        gfile = g_file_new_for_commandline_arg(full_path);
-        exists = g_file_query_exists(gfile, NULL);
+            full_path =
+                g_build_filename(dirname.get(), filename.get(), nullptr);
+            GjsAutoUnref<GFile> gfile =
+                g_file_new_for_commandline_arg(full_path);
+            if (import_file_on_module(context, obj, id, name.get(), gfile)) {
+                gjs_debug(GJS_DEBUG_IMPORTER,
+                          "successfully imported module '%s'", name.get());
+                return true;
+            }
 
-        if (!exists) {
-            gjs_debug(GJS_DEBUG_IMPORTER, "JS import '%s' not found in %s",
-                      name.get(), dirname.get());
-            continue;
+            /* Don't keep searching path if we fail to load the file for
+             * reasons other than it doesn't exist... i.e. broken files
+             * block searching for nonbroken ones
+             */
+            return false;
         }
 
-        if (import_file_on_module(context, obj, id, name.get(), gfile)) {
-            gjs_debug(GJS_DEBUG_IMPORTER, "successfully imported module '%s'",
-                      name.get());
+        if (!directories.empty()) {
+            if (!import_directory(context, obj, name.get(), directories))
+                return false;
+
+            gjs_debug(GJS_DEBUG_IMPORTER,
+                      "successfully imported directory '%s'", name.get());
             return true;
         }
 
-        /* Don't keep searching path if we fail to load the file for
-         * reasons other than it doesn't exist... i.e. broken files
-         * block searching for nonbroken ones
-         */
-        return false;
-    }
-
-    if (!directories.empty()) {
-        if (!import_directory(context, obj, name.get(), directories))
-            return false;
-
-        gjs_debug(GJS_DEBUG_IMPORTER, "successfully imported directory '%s'",
-                  name.get());
-        return true;
+        if (reread || priv->dir_cache.empty())
+            break;
+        for (auto& entry : priv->dir_cache)
+            entry.second->stale = true;
     }
 
     /* If no exception occurred, the problem is just that we got to the
@@ -670,7 +1185,7 @@ static bool importer_new_enumerate(JSContext* context, JS::HandleObject object,
 
         str = elem.toString();
         JS::UniqueChars dirname(JS_EncodeStringToUTF8(context, str));
-        if (!dirname)
+        if (!dirname || !resolve_search_path_entry(context, &dirname))
             return false;
 
         init_path =
@@ -748,7 +1263,7 @@ importer_resolve(JSContext        *context,
 
     const GjsAtoms& atoms = GjsContextPrivate::atoms(context);
     if (id == atoms.module_init() || id == atoms.to_string() ||
-        id == atoms.value_of()) {
+        id == atoms.value_of() || id == atoms.import_async()) {
         *resolved = false;
         return true;
     }
@@ -776,6 +1291,278 @@ importer_resolve(JSContext        *context,
     return true;
 }
 
+/* Modules at least this large are compiled off the main thread by
+ * importAsync(); for smaller ones it's not worth the round trip. */
+static constexpr size_t ASYNC_IMPORT_MIN_SIZE = 32 * 1024;
+
+struct GjsAsyncImport {
+    GjsAsyncImport(JSContext* cx, JS::HandleObject importer, JS::HandleId id,
+                   JS::HandleObject promise, const char* name, GFile* file)
+        : m_cx(cx),
+          m_importer(cx, importer),
+          m_id(cx, id),
+          m_promise(cx, promise),
+          m_name(g_strdup(name)),
+          m_file(file, GjsAutoTakeOwnership()),
+          m_main_context(GjsContextPrivate::from_cx(cx)->main_context()) {}
+    ~GjsAsyncImport() {
+        if (m_source)
+            g_source_unref(m_source);
+    }
+
+    JSContext* m_cx;
+    JS::PersistentRootedObject m_importer;
+    JS::PersistentRootedId m_id;
+    JS::PersistentRootedObject m_promise;
+    GjsAutoChar m_name;
+    GjsAutoUnref<GFile> m_file;
+    // Where the compiled script is picked up
+    GMainContext* m_main_context;
+    // Borrowed by the helper thread until the compilation is finished
+    std::u16string m_source_chars;
+    JS::SourceText<char16_t> m_source_text;
+
+    // The helper thread's callback and the context's dispose notification may
+    // race, so these are protected by m_lock. Once the compilation is finished
+    // there is a token and an idle source to pick it up.
+    std::mutex m_lock;
+    JS::OffThreadToken* m_token = nullptr;
+    GSource* m_source = nullptr;
+    bool m_cancelled = false;
+};
+
+/* Looks for a plain module file that importAsync() can compile ahead of time.
+ * Anything else (native modules, directories, symbols from __init__.js, or
+ * errors) is left to the synchronous import, which knows how to deal with
+ * it. */
+GJS_JSAPI_RETURN_CONVENTION
+static bool find_plain_module_file(JSContext* cx, JS::HandleObject importer,
+                                   Importer* priv, const char* name,
+                                   GjsAutoUnref<GFile>* file_out) {
+    if (priv->is_root && gjs_is_registered_native_module(name))
+        return true;
+
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    JS::RootedObject search_path(cx);
+    bool is_array;
+    if (!gjs_object_require_property(cx, importer, "importer",
+                                     atoms.search_path(), &search_path) ||
+        !JS::IsArrayObject(cx, search_path, &is_array))
+        return false;
+    if (!is_array)
+        return true;
+
+    uint32_t search_path_len;
+    if (!JS::GetArrayLength(cx, search_path, &search_path_len))
+        return false;
+
+    GjsAutoChar filename = g_strdup_printf("%s.js", name);
+    JS::RootedValue elem(cx);
+    for (uint32_t i = 0; i < search_path_len; ++i) {
+        if (!JS_GetElement(cx, search_path, i, &elem))
+            return false;
+        if (elem.isUndefined())
+            continue;
+        if (!elem.isString())
+            return true;
+
+        JS::RootedString str(cx, elem.toString());
+        JS::UniqueChars dirname(JS_EncodeStringToUTF8(cx, str));
+        if (!dirname)
+            return false;
+        if (dirname[0] == '\0')
+            continue;
+        if (!resolve_search_path_entry(cx, &dirname))
+            return false;
+
+        if (importer_query_file_type(priv, dirname.get(),
+                                     MODULE_INIT_FILENAME) !=
+                G_FILE_TYPE_UNKNOWN ||
+            importer_query_file_type(priv, dirname.get(), name) ==
+                G_FILE_TYPE_DIRECTORY)
+            return true;
+
+        if (importer_query_file_type(priv, dirname.get(), filename) !=
+            G_FILE_TYPE_UNKNOWN) {
+            GjsAutoChar full_path =
+                g_build_filename(dirname.get(), filename.get(), nullptr);
+            *file_out = g_file_new_for_commandline_arg(full_path);
+            return true;
+        }
+    }
+
+    return true;
+}
+
+/* Resolves @promise with the module, doing a regular import if needed, or
+ * rejects it with the import's exception. */
+GJS_JSAPI_RETURN_CONVENTION
+static bool settle_import(JSContext* cx, JS::HandleObject importer,
+                          JS::HandleId id, JS::HandleObject promise) {
+    JS::RootedValue module(cx);
+    if (JS_GetPropertyById(cx, importer, id, &module))
+        return JS::ResolvePromise(cx, promise, module);
+
+    JS::RootedValue exc(cx);
+    if (!JS_GetPendingException(cx, &exc))
+        return false;  // uncatchable
+    JS_ClearPendingException(cx);
+    return JS::RejectPromise(cx, promise, exc);
+}
+
+static void async_import_context_disposed(void* data, GObject*) {
+    auto* request = static_cast<GjsAsyncImport*>(data);
+    request->m_importer.reset();
+    request->m_id.reset();
+    request->m_promise.reset();
+
+    std::unique_lock<std::mutex> lock(request->m_lock);
+    request->m_cancelled = true;
+    // Still compiling; the helper thread's callback frees the request, and the
+    // runtime discards the script when it is torn down
+    if (!request->m_token)
+        return;
+    lock.unlock();
+
+    JS::CancelOffThreadScript(request->m_cx, request->m_token);
+    g_source_destroy(request->m_source);
+    delete request;
+}
+
+static gboolean finish_async_import(void* data) {
+    std::unique_ptr<GjsAsyncImport> request(static_cast<GjsAsyncImport*>(data));
+    // Disposing the context would have destroyed this source
+    g_assert(!request->m_cancelled);
+
+    JSContext* cx = request->m_cx;
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    g_object_weak_unref(G_OBJECT(gjs->public_context()),
+                        async_import_context_disposed, request.get());
+
+    JSAutoRealm ar(cx, request->m_promise);
+    JS::RootedScript script(cx,
+                            JS::FinishOffThreadScript(cx, request->m_token));
+
+    bool already_imported;
+    bool ok = script && JS_AlreadyHasOwnPropertyById(cx, request->m_importer,
+                                                     request->m_id,
+                                                     &already_imported);
+    // A synchronous import of the same module may have happened meanwhile
+    if (ok && !already_imported) {
+        ok = import_file_on_module(cx, request->m_importer, request->m_id,
+                                   request->m_name, request->m_file, script);
+        if (ok)
+            gjs_debug(GJS_DEBUG_IMPORTER,
+                      "successfully imported module '%s' asynchronously",
+                      request->m_name.get());
+    }
+
+    if (ok) {
+        ok = settle_import(cx, request->m_importer, request->m_id,
+                           request->m_promise);
+    } else {
+        JS::RootedValue exc(cx);
+        ok = JS_GetPendingException(cx, &exc);
+        if (ok) {
+            JS_ClearPendingException(cx);
+            ok = JS::RejectPromise(cx, request->m_promise, exc);
+        }
+    }
+
+    if (!ok)
+        gjs_log_exception(cx);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void async_import_compiled(JS::OffThreadToken* token, void* data) {
+    // Called on a helper thread; everything else happens on the main thread
+    auto* request = static_cast<GjsAsyncImport*>(data);
+    std::unique_lock<std::mutex> lock(request->m_lock);
+    if (request->m_cancelled) {
+        lock.unlock();
+        delete request;
+        return;
+    }
+
+    request->m_token = token;
+    request->m_source = g_idle_source_new();
+    g_source_set_callback(request->m_source, finish_async_import, request,
+                          nullptr);
+    g_source_attach(request->m_source, request->m_main_context);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool importer_import_async(JSContext* cx, unsigned argc,
+                                  JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, importer, Importer, priv);
+    if (!priv) {
+        gjs_throw(cx, "importAsync() called on the importer prototype");
+        return false;
+    }
+
+    JS::UniqueChars name;
+    if (!gjs_parse_call_args(cx, "importAsync", args, "s", "name", &name))
+        return false;
+
+    JS::RootedId id(cx, gjs_intern_string_to_id(cx, name.get()));
+    if (id == JSID_VOID)
+        return false;
+
+    JS::RootedObject promise(cx, JS::NewPromiseObject(cx, nullptr));
+    if (!promise)
+        return false;
+    args.rval().setObject(*promise);
+
+    bool already_imported;
+    if (!JS_AlreadyHasOwnPropertyById(cx, importer, id, &already_imported))
+        return false;
+
+    GjsAutoUnref<GFile> file;
+    if (!already_imported &&
+        !find_plain_module_file(cx, importer, priv, name.get(), &file))
+        return false;
+
+    // Files too small to be worth it, and anything that isn't a file, are
+    // imported right away.
+    GjsAutoChar contents;
+    size_t length = 0;
+    if (file) {
+        char* unowned_contents;
+        if (g_file_load_contents(file, nullptr, &unowned_contents, &length,
+                                 nullptr, nullptr))
+            contents = unowned_contents;
+    }
+
+    if (!contents || length < ASYNC_IMPORT_MIN_SIZE)
+        return settle_import(cx, importer, id, promise);
+
+    GjsAutoChar full_path = g_file_get_parse_name(file);
+    JS::CompileOptions options(cx);
+    options.setFileAndLine(full_path, 1).setNonSyntacticScope(true);
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    gjs->apply_source_policy(full_path, &options);
+
+    auto request = std::make_unique<GjsAsyncImport>(cx, importer, id, promise,
+                                                    name.get(), file);
+    request->m_source_chars = gjs_utf8_script_to_utf16(contents, length);
+    if (!JS::CanCompileOffThread(cx, options, request->m_source_chars.size()))
+        return settle_import(cx, importer, id, promise);
+
+    if (!request->m_source_text.init(cx, request->m_source_chars.c_str(),
+                                     request->m_source_chars.size(),
+                                     JS::SourceOwnership::Borrowed) ||
+        !JS::CompileOffThread(cx, options, request->m_source_text,
+                              async_import_compiled, request.get()))
+        return false;
+
+    gjs_debug(GJS_DEBUG_IMPORTER, "Compiling module '%s' off the main thread",
+              name.get());
+    g_object_weak_ref(G_OBJECT(gjs->public_context()),
+                      async_import_context_disposed, request.release());
+    return true;
+}
+
 GJS_NATIVE_CONSTRUCTOR_DEFINE_ABSTRACT(importer)
 
 static void importer_finalize(JSFreeOp*, JSObject* obj) {
@@ -788,7 +1575,9 @@ static void importer_finalize(JSFreeOp*, JSObject* obj) {
         return; /* we are the prototype, not a real instance */
 
     GJS_DEC_COUNTER(importer);
-    g_slice_free(Importer, priv);
+    if (priv->prefetch)
+        g_cancellable_cancel(priv->prefetch->cancellable);
+    delete priv;
 }
 
 /* The bizarre thing about this vtable is that it applies to both
@@ -819,6 +1608,7 @@ static JSFunctionSpec *gjs_importer_static_funcs = nullptr;
 
 JSFunctionSpec gjs_importer_proto_funcs[] = {
     JS_FN("toString", importer_to_string, 0, 0),
+    JS_FN("importAsync", importer_import_async, 1, 0),
     JS_FS_END};
 
 GJS_DEFINE_PROTO_FUNCS(importer)
@@ -839,7 +1629,7 @@ importer_new(JSContext *context,
     if (!importer)
         return nullptr;
 
-    priv = g_slice_new0(Importer);
+    priv = new Importer();
     priv->is_root = is_root;
 
     GJS_INC_COUNTER(importer);
@@ -26,9 +26,13 @@
 
 #include <config.h>
 
+#include <stddef.h>  // for size_t
+
 #include <string>
 #include <vector>
 
+#include <gio/gio.h>
+
 #include <js/TypeDecls.h>
 
 #include "cjs/macros.h"
@@ -42,4 +46,10 @@ bool gjs_import_native_module(JSContext       *cx,
                               JS::HandleObject importer,
                               const char      *name);
 
+void gjs_importer_prefetch(JSContext* cx, const char* script,
+                           size_t script_len);
+
+[[nodiscard]] char* gjs_importer_take_prefetched(JSContext* cx, GFile* file,
+                                                 size_t* length);
+
 #endif  // GJS_IMPORTER_H_
@@ -0,0 +1,64 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+
+#include <new>  // for nothrow
+
+#include <js/RootingAPI.h>
+#include <js/TracingAPI.h>
+#include <js/TypeDecls.h>
+
+#include "cjs/job-queue.h"
+
+bool GjsJobQueue::grow() {
+    size_t capacity = m_capacity ? m_capacity * 2 : INITIAL_CAPACITY;
+    auto* slots = new (std::nothrow) JS::Heap<JSObject*>[capacity];
+    if (!slots)
+        return false;
+
+    // Unwrap the jobs so that the front of the queue is at the start again
+    for (size_t ix = 0; ix < m_length; ix++)
+        slots[ix] = m_slots[(m_head + ix) & (m_capacity - 1)];
+
+    delete[] m_slots;
+    m_slots = slots;
+    m_capacity = capacity;
+    m_head = 0;
+    return true;
+}
+
+void GjsJobQueue::clear() {
+    for (size_t ix = 0; ix < m_length; ix++)
+        m_slots[(m_head + ix) & (m_capacity - 1)] = nullptr;
+    m_head = 0;
+    m_length = 0;
+}
+
+void GjsJobQueue::trace(JSTracer* trc) {
+    for (size_t ix = 0; ix < m_length; ix++)
+        JS::TraceEdge(trc, &m_slots[(m_head + ix) & (m_capacity - 1)],
+                      "job queue");
+}
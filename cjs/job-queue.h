@@ -0,0 +1,95 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_JOB_QUEUE_H_
+#define GJS_JOB_QUEUE_H_
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+
+#include <utility>  // for swap
+
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+
+class JSTracer;
+
+// FIFO queue of the promise jobs waiting to be run. Jobs are taken from the
+// front while new ones are added at the back, often while draining, so this is
+// a ring buffer that doubles in size when full, instead of a vector that would
+// have to shift its contents or keep the slots of the jobs that were run.
+//
+// Moving a queue only moves its buffer, which keeps saving and restoring the
+// queue around nested event loops cheap.
+class GjsJobQueue {
+    static constexpr size_t INITIAL_CAPACITY = 16;
+
+    JS::Heap<JSObject*>* m_slots = nullptr;
+    size_t m_capacity = 0;  // zero or a power of two
+    size_t m_head = 0;
+    size_t m_length = 0;
+
+    [[nodiscard]] bool grow();
+
+ public:
+    GjsJobQueue() = default;
+    ~GjsJobQueue() { delete[] m_slots; }
+    GjsJobQueue(const GjsJobQueue&) = delete;
+    GjsJobQueue& operator=(const GjsJobQueue&) = delete;
+    GjsJobQueue(GjsJobQueue&& other) noexcept { *this = std::move(other); }
+    GjsJobQueue& operator=(GjsJobQueue&& other) noexcept {
+        std::swap(m_slots, other.m_slots);
+        std::swap(m_capacity, other.m_capacity);
+        std::swap(m_head, other.m_head);
+        std::swap(m_length, other.m_length);
+        return *this;
+    }
+
+    [[nodiscard]] bool empty() const { return m_length == 0; }
+    [[nodiscard]] size_t length() const { return m_length; }
+
+    // Returns false if out of memory
+    [[nodiscard]] bool push(JSObject* job) {
+        if (m_length == m_capacity && !grow())
+            return false;
+        m_slots[(m_head + m_length) & (m_capacity - 1)] = job;
+        m_length++;
+        return true;
+    }
+
+    // Removes and returns the job at the front; the queue must not be empty
+    [[nodiscard]] JSObject* pop() {
+        JS::Heap<JSObject*>& slot = m_slots[m_head];
+        JSObject* job = slot;
+        slot = nullptr;
+        m_head = (m_head + 1) & (m_capacity - 1);
+        m_length--;
+        return job;
+    }
+
+    void clear();
+    void trace(JSTracer* trc);
+};
+
+#endif  // GJS_JOB_QUEUE_H_
@@ -63,6 +63,13 @@ bool gjs_define_property_dynamic(JSContext       *cx,
                                  JS::HandleValue  private_slot,
                                  unsigned         flags);
 
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_define_property_dynamic(JSContext* cx, JS::HandleObject proto,
+                                 const char* prop_name,
+                                 const char* func_namespace, JSNative getter,
+                                 JSNative setter, JS::HandleValue private_slot,
+                                 JS::HandleValue cache_slot, unsigned flags);
+
 /*
  * Helper methods to access private data:
  *
@@ -331,6 +338,7 @@ GJS_DEFINE_PROTO_FUNCS_WITH_PARENT(cname, no_parent)
 
 [[nodiscard]] JS::Value gjs_dynamic_property_private_slot(
     JSObject* accessor_obj);
+[[nodiscard]] JS::Value gjs_dynamic_property_cache_slot(JSObject* accessor_obj);
 
 GJS_JSAPI_RETURN_CONVENTION
 bool gjs_object_in_prototype_chain(JSContext* cx, JS::HandleObject proto,
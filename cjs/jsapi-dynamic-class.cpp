@@ -52,6 +52,7 @@ struct JSPropertySpec;
 /* Reserved slots of JSNative accessor wrappers */
 enum {
     DYNAMIC_PROPERTY_PRIVATE_SLOT,
+    DYNAMIC_PROPERTY_CACHE_SLOT,
 };
 
 bool gjs_init_class_dynamic(JSContext* context, JS::HandleObject in_object,
@@ -90,10 +91,19 @@ bool gjs_init_class_dynamic(JSContext* context, JS::HandleObject in_object,
     if (!prototype)
         return false;
 
-    if (proto_ps && !JS_DefineProperties(context, prototype, proto_ps))
-        return false;
-    if (proto_fs && !JS_DefineFunctions(context, prototype, proto_fs))
-        return false;
+    // A prototype whose parent is of the same class inherits the property and
+    // function specs shared by all classes of that wrapper kind, so they are
+    // only defined on the root of each hierarchy. Besides saving the work for
+    // each of the hundreds of classes in a namespace, that keeps the subclass
+    // prototypes from growing their own copy of the same shape
+    bool inherits_specs = parent_proto && JS_GetClass(parent_proto) == clasp;
+
+    if (!inherits_specs) {
+        if (proto_ps && !JS_DefineProperties(context, prototype, proto_ps))
+            return false;
+        if (proto_fs && !JS_DefineFunctions(context, prototype, proto_fs))
+            return false;
+    }
 
     GjsAutoChar full_function_name =
         g_strdup_printf("%s_%s", ns_name, class_name);
@@ -169,7 +179,8 @@ define_native_accessor_wrapper(JSContext      *cx,
                                JSNative        call,
                                unsigned        nargs,
                                const char     *func_name,
-                               JS::HandleValue private_slot)
+                               JS::HandleValue private_slot,
+                               JS::HandleValue cache_slot)
 {
     JSFunction *func = js::NewFunctionWithReserved(cx, call, nargs, 0, func_name);
     if (!func)
@@ -178,6 +189,8 @@ define_native_accessor_wrapper(JSContext      *cx,
     JSObject *func_obj = JS_GetFunctionObject(func);
     js::SetFunctionNativeReserved(func_obj, DYNAMIC_PROPERTY_PRIVATE_SLOT,
                                   private_slot);
+    js::SetFunctionNativeReserved(func_obj, DYNAMIC_PROPERTY_CACHE_SLOT,
+                                  cache_slot);
     return func_obj;
 }
 
@@ -214,16 +227,36 @@ gjs_define_property_dynamic(JSContext       *cx,
                             JS::HandleValue  private_slot,
                             unsigned         flags)
 {
+    return gjs_define_property_dynamic(cx, proto, prop_name, func_namespace,
+                                       getter, setter, private_slot,
+                                       JS::UndefinedHandleValue, flags);
+}
+
+/**
+ * gjs_define_property_dynamic:
+ * @cache_slot: additional data, usually a #JS::PrivateValue, that the getter
+ *   and setter can use to skip looking up the property by @private_slot
+ *
+ * Like the above, but also stores @cache_slot in the accessor functions; see
+ * gjs_dynamic_property_cache_slot().
+ */
+bool gjs_define_property_dynamic(JSContext* cx, JS::HandleObject proto,
+                                 const char* prop_name,
+                                 const char* func_namespace, JSNative getter,
+                                 JSNative setter, JS::HandleValue private_slot,
+                                 JS::HandleValue cache_slot, unsigned flags) {
     GjsAutoChar getter_name = g_strconcat(func_namespace, "_get::", prop_name, nullptr);
     GjsAutoChar setter_name = g_strconcat(func_namespace, "_set::", prop_name, nullptr);
 
     JS::RootedObject getter_obj(cx,
-        define_native_accessor_wrapper(cx, getter, 0, getter_name, private_slot));
+        define_native_accessor_wrapper(cx, getter, 0, getter_name,
+                                       private_slot, cache_slot));
     if (!getter_obj)
         return false;
 
     JS::RootedObject setter_obj(cx,
-        define_native_accessor_wrapper(cx, setter, 1, setter_name, private_slot));
+        define_native_accessor_wrapper(cx, setter, 1, setter_name,
+                                       private_slot, cache_slot));
     if (!setter_obj)
         return false;
 
@@ -250,6 +283,18 @@ gjs_dynamic_property_private_slot(JSObject *accessor_obj)
                                          DYNAMIC_PROPERTY_PRIVATE_SLOT);
 }
 
+/**
+ * gjs_dynamic_property_cache_slot:
+ * @accessor_obj: the getter or setter as a function object
+ *
+ * Returns: the cache value passed to gjs_define_property_dynamic(), or
+ *   undefined if none was given.
+ */
+JS::Value gjs_dynamic_property_cache_slot(JSObject* accessor_obj) {
+    return js::GetFunctionNativeReserved(accessor_obj,
+                                         DYNAMIC_PROPERTY_CACHE_SLOT);
+}
+
 /**
  * gjs_object_in_prototype_chain:
  * @cx:
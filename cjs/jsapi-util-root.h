@@ -31,7 +31,6 @@
 
 #include <cstddef>  // for nullptr_t
 #include <memory>
-#include <new>
 #include <type_traits>  // for enable_if_t, is_pointer
 
 #include <glib-object.h>
@@ -43,6 +42,7 @@
 #include "cjs/context-private.h"
 #include "cjs/context.h"
 #include "cjs/macros.h"
+#include "cjs/root-set.h"
 #include "util/log.h"
 
 /* jsapi-util-root.h - Utilities for dealing with the lifetime and ownership of
@@ -121,11 +121,11 @@ class GjsMaybeOwned {
     typedef void (*DestroyNotify)(JS::Handle<T> thing, void *data);
 
  private:
-    /* m_root value controls which of these members we can access. When switching
-     * from one to the other, be careful to call the constructor and destructor
-     * of JS::Heap, since they use post barriers. */
+    /* The thing is always kept in m_heap. While it is rooted, m_heap is
+     * registered in a slot of the context's GjsRootSet, which traces it. */
     JS::Heap<T> m_heap;
-    std::unique_ptr<JS::PersistentRooted<T>> m_root;
+    GjsRootSet* m_root_set = nullptr;
+    uint32_t m_root_slot = 0;
 
     struct Notifier {
         Notifier(GjsMaybeOwned<T> *parent, DestroyNotify func, void *data)
@@ -171,16 +171,26 @@ class GjsMaybeOwned {
                             what);
     }
 
+    void add_root(JSContext* cx) {
+        m_root_set = &GjsContextPrivate::from_cx(cx)->root_set();
+        m_root_slot = m_root_set->add(&m_heap);
+    }
+
+    void remove_root() {
+        m_root_set->remove(m_root_slot);
+        m_root_set = nullptr;
+    }
+
     void
     teardown_rooting()
     {
         debug("teardown_rooting()");
-        g_assert(m_root);
+        g_assert(m_root_set);
 
-        m_root.reset();
+        remove_root();
         m_notify.reset();
 
-        new (&m_heap) JS::Heap<T>();
+        m_heap = JS::SafelyInitialized<T>();
     }
 
  public:
@@ -190,29 +200,27 @@ class GjsMaybeOwned {
 
     ~GjsMaybeOwned() {
         debug("destroyed");
+        if (m_root_set)
+            remove_root();
     }
 
     /* To access the GC thing, call get(). In many cases you can just use the
      * GjsMaybeOwned wrapper in place of the GC thing itself due to the implicit
      * cast operator. But if you want to call methods on the GC thing, for
      * example if it's a JS::Value, you have to use get(). */
-    [[nodiscard]] const T get() const {
-        return m_root ? m_root->get() : m_heap.get();
-    }
+    [[nodiscard]] const T get() const { return m_heap.get(); }
     operator const T() const { return get(); }
 
     /* Use debug_addr() only for debug logging, because it is unbarriered. */
     template <typename U = T>
     [[nodiscard]] const void* debug_addr(
         std::enable_if_t<std::is_pointer_v<U>>* = nullptr) const {
-        return m_root ? m_root->get() : m_heap.unbarrieredGet();
+        return m_heap.unbarrieredGet();
     }
 
     bool
     operator==(const T& other) const
     {
-        if (m_root)
-            return m_root->get() == other;
         return m_heap == other;
     }
     inline bool operator!=(const T& other) const { return !(*this == other); }
@@ -222,8 +230,6 @@ class GjsMaybeOwned {
     bool
     operator==(std::nullptr_t) const
     {
-        if (m_root)
-            return m_root->get() == nullptr;
         return m_heap.unbarrieredGet() == nullptr;
     }
     inline bool operator!=(std::nullptr_t) const { return !(*this == nullptr); }
@@ -235,8 +241,8 @@ class GjsMaybeOwned {
      * wrapper with stack rooting. However, you must not do this if the
      * JSContext can be destroyed while the Handle is live. */
     [[nodiscard]] JS::Handle<T> handle() {
-        g_assert(m_root);
-        return *m_root;
+        g_assert(m_root_set);
+        return JS::Handle<T>::fromMarkedLocation(m_heap.address());
     }
 
     /* Roots the GC thing. You must not use this if you're already using the
@@ -248,10 +254,10 @@ class GjsMaybeOwned {
          void         *data   = nullptr)
     {
         debug("root()");
-        g_assert(!m_root);
+        g_assert(!m_root_set);
         g_assert(m_heap.get() == JS::SafelyInitialized<T>());
-        m_heap.~Heap();
-        m_root = std::make_unique<JS::PersistentRooted<T>>(cx, thing);
+        m_heap = thing;
+        add_root(cx);
 
         if (notify)
             m_notify = std::make_unique<Notifier>(this, notify, data);
@@ -262,7 +268,7 @@ class GjsMaybeOwned {
     void
     operator=(const T& thing)
     {
-        g_assert(!m_root);
+        g_assert(!m_root_set);
         m_heap = thing;
     }
 
@@ -271,13 +277,13 @@ class GjsMaybeOwned {
      * in the rooted case. */
     void prevent_collection() {
         debug("prevent_collection()");
-        g_assert(!m_root);
+        g_assert(!m_root_set);
         GjsHeapOperation<T>::expose_to_js(m_heap);
     }
 
     void reset() {
         debug("reset()");
-        if (!m_root) {
+        if (!m_root_set) {
             m_heap = JS::SafelyInitialized<T>();
             return;
         }
@@ -291,38 +297,33 @@ class GjsMaybeOwned {
                      void         *data   = nullptr)
     {
         debug("switch to rooted");
-        g_assert(!m_root);
+        g_assert(!m_root_set);
 
-        /* Prevent the thing from being garbage collected while it is in neither
-         * m_heap nor m_root */
-        JS::Rooted<T> thing(cx, m_heap);
+        /* The read barrier marks the thing, in case an incremental GC has
+         * already traced the roots */
+        static_cast<void>(m_heap.get());
+        add_root(cx);
 
-        reset();
-        root(cx, thing, notify, data);
-        g_assert(m_root);
+        if (notify)
+            m_notify = std::make_unique<Notifier>(this, notify, data);
     }
 
-    void switch_to_unrooted(JSContext* cx) {
+    void switch_to_unrooted(JSContext* cx [[maybe_unused]]) {
         debug("switch to unrooted");
-        g_assert(m_root);
-
-        /* Prevent the thing from being garbage collected while it is in neither
-         * m_heap nor m_root */
-        JS::Rooted<T> thing(cx, *m_root);
+        g_assert(m_root_set);
 
-        reset();
-        m_heap = thing;
-        g_assert(!m_root);
+        remove_root();
+        m_notify.reset();
     }
 
-    /* Tracing makes no sense in the rooted case, because JS::PersistentRooted
-     * already takes care of that. */
+    /* Tracing makes no sense in the rooted case, because the context's root
+     * set already takes care of that. */
     void
     trace(JSTracer   *tracer,
           const char *name)
     {
         debug("trace()");
-        g_assert(!m_root);
+        g_assert(!m_root_set);
         JS::TraceEdge<T>(tracer, &m_heap, name);
     }
 
@@ -331,11 +332,11 @@ class GjsMaybeOwned {
      * finalized. If the object was finalized, returns true. */
     bool update_after_gc() {
         debug("update_after_gc()");
-        g_assert(!m_root);
+        g_assert(!m_root_set);
         return GjsHeapOperation<T>::update_after_gc(&m_heap);
     }
 
-    [[nodiscard]] bool rooted() const { return m_root != nullptr; }
+    [[nodiscard]] bool rooted() const { return m_root_set != nullptr; }
 };
 
 #endif  // GJS_JSAPI_UTIL_ROOT_H_
@@ -31,6 +31,7 @@
 #include <iomanip>    // for operator<<, setfill, setw
 #include <sstream>    // for operator<<, basic_ostream, ostring...
 #include <string>     // for allocator, char_traits
+#include <utility>    // for move
 
 #include <glib.h>
 
@@ -46,9 +47,13 @@
 #include <js/Value.h>
 #include <jsapi.h>        // for JSID_TO_FLAT_STRING, JS_GetTwoByte...
 #include <jsfriendapi.h>  // for FlatStringToLinearString, GetLatin...
+#include <mozilla/Unused.h>
 
+#include "cjs/atoms.h"
+#include "cjs/context-private.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
+#include "util/text.h"
 
 // Avoid static_assert in MSVC builds
 namespace JS {
@@ -91,6 +96,36 @@ JS::UniqueChars gjs_string_to_utf8(JSContext* cx, const JS::Value value) {
     }
 
     JS::RootedString str(cx, value.toString());
+
+    // An ASCII string is already UTF-8, so it only needs copying
+    JSLinearString* linear = JS_EnsureLinearString(cx, str);
+    if (!linear)
+        return nullptr;
+    if (js::LinearStringHasLatin1Chars(linear)) {
+        size_t len = js::GetLinearStringLength(linear);
+        bool is_ascii;
+        {
+            JS::AutoCheckCannotGC nogc;
+            is_ascii = gjs_text_is_ascii(
+                reinterpret_cast<const char*>(
+                    js::GetLatin1LinearStringChars(nogc, linear)),
+                len);
+        }
+
+        if (is_ascii) {
+            JS::UniqueChars retval(js_pod_malloc<char>(len + 1));
+            if (!retval) {
+                JS_ReportOutOfMemory(cx);
+                return nullptr;
+            }
+            JS::AutoCheckCannotGC nogc;
+            memcpy(retval.get(), js::GetLatin1LinearStringChars(nogc, linear),
+                   len);
+            retval[len] = '\0';
+            return retval;
+        }
+    }
+
     return JS_EncodeStringToUTF8(cx, str);
 }
 
@@ -99,12 +134,8 @@ gjs_string_from_utf8(JSContext             *context,
                      const char            *utf8_string,
                      JS::MutableHandleValue value_p)
 {
-    JS::ConstUTF8CharsZ chars(utf8_string, strlen(utf8_string));
-    JS::RootedString str(context, JS_NewStringCopyUTF8Z(context, chars));
-    if (str)
-        value_p.setString(str);
-
-    return str != nullptr;
+    return gjs_string_from_utf8_n(context, utf8_string, strlen(utf8_string),
+                                  value_p);
 }
 
 bool
@@ -113,8 +144,42 @@ gjs_string_from_utf8_n(JSContext             *cx,
                        size_t                 len,
                        JS::MutableHandleValue out)
 {
-    JS::UTF8Chars chars(utf8_chars, len);
-    JS::RootedString str(cx, JS_NewStringCopyUTF8N(cx, chars));
+    JS::RootedString str(cx);
+
+    if (gjs_text_is_ascii(utf8_chars, len)) {
+        // ASCII is a subset of Latin-1, so can be used as the string's
+        // characters without decoding
+        str = JS_NewStringCopyN(cx, utf8_chars, len);
+    } else {
+        // UTF-16 never takes more code units than UTF-8 takes bytes
+        JS::UniqueTwoByteChars utf16(js_pod_malloc<char16_t>(len));
+        if (!utf16) {
+            JS_ReportOutOfMemory(cx);
+            return false;
+        }
+
+        size_t utf16_len =
+            gjs_text_utf8_to_utf16(utf8_chars, len, utf16.get());
+        if (utf16_len == GJS_TEXT_INVALID) {
+            // Let SpiderMonkey throw its usual exception about the malformed
+            // sequence
+            JS::UTF8Chars chars(utf8_chars, len);
+            str = JS_NewStringCopyUTF8N(cx, chars);
+        } else {
+            // Don't keep a mostly empty buffer around for text that isn't
+            // mostly ASCII, such as CJK
+            if (utf16_len < len / 2) {
+                char16_t* shrunk =
+                    js_pod_realloc<char16_t>(utf16.get(), len, utf16_len);
+                if (shrunk) {
+                    mozilla::Unused << utf16.release();
+                    utf16.reset(shrunk);
+                }
+            }
+            str = JS_NewUCString(cx, std::move(utf16), utf16_len);
+        }
+    }
+
     if (str)
         out.setString(str);
 
@@ -264,6 +329,16 @@ gjs_string_to_ucs4(JSContext       *cx,
         return false;
     }
 
+    // Most text is in the Basic Multilingual Plane, where every UTF-16 code
+    // unit is a code point of its own
+    if (gjs_text_utf16_has_no_surrogates(utf16, len)) {
+        *ucs4_string_p = g_new(gunichar, len);
+        std::copy(utf16, utf16 + len, *ucs4_string_p);
+        if (len_p != NULL)
+            *len_p = len;
+        return true;
+    }
+
     if (ucs4_string_p != NULL) {
         long length;
         *ucs4_string_p = g_utf16_to_ucs4(reinterpret_cast<const gunichar2 *>(utf16),
@@ -383,6 +458,13 @@ jsid
 gjs_intern_string_to_id(JSContext  *cx,
                         const char *string)
 {
+    // Well-known names are already pinned, skip atomizing them again
+    if (const GjsAtom* atom = GjsContextPrivate::atoms(cx).lookup(string)) {
+        jsid id = (*atom)();
+        if (!JSID_IS_VOID(id))
+            return id;
+    }
+
     JS::RootedString str(cx, JS_AtomizeAndPinString(cx, string));
     if (!str)
         return JSID_VOID;
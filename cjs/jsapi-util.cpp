@@ -676,6 +676,43 @@ static std::wstring gjs_win32_vc140_utf8_to_utf16(const char* str,
 }
 #endif
 
+bool GjsScriptFileContents::load(GFile* file, GError** error) {
+    // Resources, such as the core modules and application bundles, are
+    // already mapped, so this points into the mapping instead of copying
+    if (g_file_has_uri_scheme(file, "resource")) {
+        GjsAutoChar uri = g_file_get_uri(file);
+        GjsAutoChar resource_path = g_uri_unescape_string(
+            uri.get() + strlen("resource://"), nullptr);
+        bytes = g_resources_lookup_data(resource_path,
+                                        G_RESOURCE_LOOKUP_FLAGS_NONE, error);
+        if (!bytes)
+            return false;
+        data = static_cast<const char*>(g_bytes_get_data(bytes, &length));
+        if (!data)
+            data = "";
+        return true;
+    }
+
+    GjsAutoChar path = g_file_get_path(file);
+    if (path) {
+        mapped = g_mapped_file_new(path, /* writable = */ false, error);
+        if (!mapped)
+            return false;
+        length = g_mapped_file_get_length(mapped);
+        // An empty file doesn't get mapped
+        data = length > 0 ? g_mapped_file_get_contents(mapped) : "";
+        return true;
+    }
+
+    char* contents;
+    if (!g_file_load_contents(file, nullptr, &contents, &length, nullptr,
+                              error))
+        return false;
+    owned = contents;
+    data = owned;
+    return true;
+}
+
 std::u16string gjs_utf8_script_to_utf16(const char* script, ssize_t len) {
 #if defined(G_OS_WIN32) && (defined(_MSC_VER) && (_MSC_VER >= 1900))
     std::wstring wscript = gjs_win32_vc140_utf8_to_utf16(script, len);
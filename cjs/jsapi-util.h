@@ -34,6 +34,7 @@
 #include <string>  // for string, u16string
 #include <vector>
 
+#include <gio/gio.h>
 #include <girepository.h>
 #include <glib-object.h>
 #include <glib.h>
@@ -150,6 +151,7 @@ struct GjsAutoInfo : GjsAutoBaseInfo {
     }
 };
 
+using GjsAutoArgInfo = GjsAutoInfo<GI_INFO_TYPE_ARG>;
 using GjsAutoEnumInfo = GjsAutoInfo<GI_INFO_TYPE_ENUM>;
 using GjsAutoFieldInfo = GjsAutoInfo<GI_INFO_TYPE_FIELD>;
 using GjsAutoFunctionInfo = GjsAutoInfo<GI_INFO_TYPE_FUNCTION>;
@@ -321,6 +323,18 @@ void gjs_gc_if_needed(JSContext *cx);
 [[nodiscard]] std::u16string gjs_utf8_script_to_utf16(const char* script,
                                                       ssize_t len);
 
+// Contents of a script file, mapped into memory when the file is local so that
+// large scripts can be compiled in place instead of being copied first
+struct GjsScriptFileContents {
+    GjsAutoChar owned;
+    GjsAutoPointer<GMappedFile, GMappedFile, g_mapped_file_unref> mapped;
+    GjsAutoPointer<GBytes, GBytes, g_bytes_unref> bytes;
+    const char* data = nullptr;
+    size_t length = 0;
+
+    [[nodiscard]] bool load(GFile* file, GError** error);
+};
+
 GJS_JSAPI_RETURN_CONVENTION
 GjsAutoChar gjs_format_stack_trace(JSContext       *cx,
                                    JS::HandleObject saved_frame);
@@ -58,6 +58,11 @@ typedef struct {
 GJS_DECLARE_COUNTER(everything)
 GJS_FOR_EACH_COUNTER(GJS_DECLARE_COUNTER)
 
+// Callback trampolines currently in use. Not part of the total, since the
+// trampolines of vfuncs live as long as their GType, which may outlive the
+// context.
+GJS_DECLARE_COUNTER(callback_trampoline)
+
 #define GJS_INC_COUNTER(name)                               \
     do {                                                    \
         g_atomic_int_add(&gjs_counter_everything.value, 1); \
@@ -72,4 +77,40 @@ GJS_FOR_EACH_COUNTER(GJS_DECLARE_COUNTER)
 
 #define GJS_GET_COUNTER(name) g_atomic_int_get(&gjs_counter_##name.value)
 
+#define GJS_INC_UNTOTALED_COUNTER(name) \
+    g_atomic_int_add(&gjs_counter_##name.value, 1)
+#define GJS_DEC_UNTOTALED_COUNTER(name) \
+    g_atomic_int_add(&gjs_counter_##name.value, -1)
+
+// Bytes of native memory held by GJS for things that aren't JS objects, and so
+// don't show up in the JS heap size. These only count what GJS allocates
+// itself, such as the payload of boxed structs allocated directly, not the
+// memory that libraries allocate on their behalf.
+typedef struct {
+    volatile gssize value;
+    const char* name;
+} GjsMemByteCounter;
+
+// clang-format off
+#define GJS_FOR_EACH_BYTE_COUNTER(macro) \
+    macro(arg_cache)                     \
+    macro(boxed_payload)                 \
+    macro(callback_trampoline)           \
+    macro(closure)                       \
+    macro(ffi_closure)                   \
+    macro(toggle_queue)
+// clang-format on
+
+#define GJS_DECLARE_BYTE_COUNTER(name) \
+    extern GjsMemByteCounter gjs_bytes_##name;
+
+GJS_FOR_EACH_BYTE_COUNTER(GJS_DECLARE_BYTE_COUNTER)
+
+#define GJS_ADD_BYTES(name, n) \
+    g_atomic_pointer_add(&gjs_bytes_##name.value, (gssize)(n))
+#define GJS_SUB_BYTES(name, n) \
+    g_atomic_pointer_add(&gjs_bytes_##name.value, -(gssize)(n))
+#define GJS_GET_BYTES(name) \
+    ((gssize)g_atomic_pointer_get(&gjs_bytes_##name.value))
+
 #endif  // GJS_MEM_PRIVATE_H_
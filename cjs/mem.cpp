@@ -35,11 +35,22 @@
 
 GJS_DEFINE_COUNTER(everything)
 GJS_FOR_EACH_COUNTER(GJS_DEFINE_COUNTER)
+GJS_DEFINE_COUNTER(callback_trampoline)
+
+#define GJS_DEFINE_BYTE_COUNTER(name) \
+    GjsMemByteCounter gjs_bytes_##name = {0, #name};
+
+GJS_FOR_EACH_BYTE_COUNTER(GJS_DEFINE_BYTE_COUNTER)
 
 #define GJS_LIST_COUNTER(name) &gjs_counter_##name,
 
 static GjsMemCounter* counters[] = {GJS_FOR_EACH_COUNTER(GJS_LIST_COUNTER)};
 
+#define GJS_LIST_BYTE_COUNTER(name) &gjs_bytes_##name,
+
+static GjsMemByteCounter* byte_counters[] = {
+    GJS_FOR_EACH_BYTE_COUNTER(GJS_LIST_BYTE_COUNTER)};
+
 void
 gjs_memory_report(const char *where,
                   bool        die_if_leaks)
@@ -67,6 +78,17 @@ gjs_memory_report(const char *where,
     gjs_debug(GJS_DEBUG_MEMORY,
               "  %d objects currently alive",
               GJS_GET_COUNTER(everything));
+    gjs_debug(GJS_DEBUG_MEMORY, "  %d callback trampolines currently in use",
+              GJS_GET_COUNTER(callback_trampoline));
+
+    gssize total_bytes = 0;
+    for (const GjsMemByteCounter* counter : byte_counters)
+        total_bytes += counter->value;
+    gjs_debug(GJS_DEBUG_MEMORY, "  %" G_GSSIZE_FORMAT " bytes of native memory",
+              total_bytes);
+    for (const GjsMemByteCounter* counter : byte_counters)
+        gjs_debug(GJS_DEBUG_MEMORY, "    %24s = %" G_GSSIZE_FORMAT,
+                  counter->name, counter->value);
 
     if (GJS_GET_COUNTER(everything) != 0) {
         for (i = 0; i < n_counters; ++i) {
@@ -23,10 +23,7 @@
 
 #include <config.h>
 
-#include <stddef.h>     // for size_t
-#include <sys/types.h>  // for ssize_t
-
-#include <string>  // for u16string
+#include <stddef.h>  // for size_t
 
 #include <gio/gio.h>
 #include <glib.h>
@@ -37,14 +34,17 @@
 #include <js/GCVector.h>  // for RootedVector
 #include <js/PropertyDescriptor.h>
 #include <js/RootingAPI.h>
-#include <js/SourceText.h>
 #include <js/TypeDecls.h>
 #include <jsapi.h>  // for JS_DefinePropertyById, ...
 
 #include "cjs/context-private.h"
+#include "cjs/importer.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem-private.h"
 #include "cjs/module.h"
+#include "cjs/profiler-private.h"
+#include "cjs/script-cache.h"
+#include "gi/gjs_gi_trace.h"
 #include "util/log.h"
 
 class GjsScriptModule {
@@ -94,33 +94,41 @@ class GjsScriptModule {
     /* Carries out the actual execution of the module code */
     GJS_JSAPI_RETURN_CONVENTION
     bool evaluate_import(JSContext* cx, JS::HandleObject module,
-                         const char* script, ssize_t script_len,
+                         const char* script, size_t script_len,
                          const char* filename) {
-        std::u16string utf16_string =
-            gjs_utf8_script_to_utf16(script, script_len);
-        // COMPAT: This could use JS::SourceText<mozilla::Utf8Unit> directly,
-        // but that messes up code coverage. See bug
-        // https://bugzilla.mozilla.org/show_bug.cgi?id=1404784
-        JS::SourceText<char16_t> buf;
-        if (!buf.init(cx, utf16_string.c_str(), utf16_string.size(),
-                      JS::SourceOwnership::Borrowed))
+        JS::CompileOptions options(cx);
+        options.setFileAndLine(filename, 1);
+        GjsContextPrivate::from_cx(cx)->apply_source_policy(filename, &options);
+
+        JS::RootedScript compiled_script(cx);
+        {
+            GjsAutoProfilerMark mark(cx, "Compile module", "%s", filename);
+            compiled_script =
+                gjs_script_cache_compile_utf8(cx, options, script, script_len,
+                                              /* non_syntactic = */ true);
+        }
+        if (!compiled_script)
             return false;
 
+        return execute_import(cx, module, compiled_script);
+    }
+
+    /* Runs already compiled module code in the module's scope */
+    GJS_JSAPI_RETURN_CONVENTION
+    bool execute_import(JSContext* cx, JS::HandleObject module,
+                        JS::HandleScript script) {
         JS::RootedObjectVector scope_chain(cx);
         if (!scope_chain.append(module)) {
             JS_ReportOutOfMemory(cx);
             return false;
         }
 
-        JS::CompileOptions options(cx);
-        options.setFileAndLine(filename, 1);
-
+        GjsAutoProfilerMark mark(cx, "Evaluate module", "%s", m_name);
         JS::RootedValue ignored_retval(cx);
-        if (!JS::Evaluate(cx, scope_chain, options, buf, &ignored_retval))
+        if (!JS_ExecuteScript(cx, scope_chain, script, &ignored_retval))
             return false;
 
-        GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
-        gjs->schedule_gc_if_needed();
+        GjsContextPrivate::from_cx(cx)->schedule_gc_if_needed();
 
         gjs_debug(GJS_DEBUG_IMPORTER, "Importing module %s succeeded", m_name);
 
@@ -135,18 +143,22 @@ class GjsScriptModule {
                 GFile           *file)
     {
         GError *error = nullptr;
-        char *unowned_script;
-        size_t script_len = 0;
-
-        if (!(g_file_load_contents(file, nullptr, &unowned_script, &script_len,
-                                   nullptr, &error)))
-            return gjs_throw_gerror_message(cx, error);
+        GjsAutoChar full_path = g_file_get_parse_name(file);
+        GjsScriptFileContents script;
+        {
+            GjsAutoProfilerMark mark(cx, "Read module", "%s", full_path.get());
+            script.owned =
+                gjs_importer_take_prefetched(cx, file, &script.length);
+            script.data = script.owned;
+
+            if (!script.data && !script.load(file, &error))
+                return gjs_throw_gerror_message(cx, error);
+        }
 
-        GjsAutoChar script = unowned_script;  /* steals ownership */
-        g_assert(script);
+        gjs_importer_prefetch(cx, script.data, script.length);
 
-        GjsAutoChar full_path = g_file_get_parse_name(file);
-        return evaluate_import(cx, module, script, script_len, full_path);
+        return evaluate_import(cx, module, script.data, script.length,
+                               full_path);
     }
 
     /* JSClass operations */
@@ -225,10 +237,32 @@ class GjsScriptModule {
            const char      *name,
            GFile           *file)
     {
+        GjsAutoProfilerMark mark(cx, "Import", "%s", name);
+        TRACE(GJS_MODULE_IMPORT_ENTRY(name));
+        JS::RootedObject module(cx, GjsScriptModule::create(cx, name));
+        bool ok = module &&
+                  priv(module)->define_import(cx, module, importer, id) &&
+                  priv(module)->import_file(cx, module, file);
+        TRACE(GJS_MODULE_IMPORT_RETURN(name, ok));
+        if (!ok)
+            return nullptr;
+
+        return module;
+    }
+
+    /* Same, but with code that was already compiled elsewhere */
+    GJS_JSAPI_RETURN_CONVENTION
+    static JSObject* import_compiled(JSContext* cx, JS::HandleObject importer,
+                                     JS::HandleId id, const char* name,
+                                     JS::HandleScript script) {
+        GjsAutoProfilerMark mark(cx, "Import", "%s", name);
+        TRACE(GJS_MODULE_IMPORT_ENTRY(name));
         JS::RootedObject module(cx, GjsScriptModule::create(cx, name));
-        if (!module ||
-            !priv(module)->define_import(cx, module, importer, id) ||
-            !priv(module)->import_file(cx, module, file))
+        bool ok = module &&
+                  priv(module)->define_import(cx, module, importer, id) &&
+                  priv(module)->execute_import(cx, module, script);
+        TRACE(GJS_MODULE_IMPORT_RETURN(name, ok));
+        if (!ok)
             return nullptr;
 
         return module;
@@ -261,5 +295,24 @@ gjs_module_import(JSContext       *cx,
     return GjsScriptModule::import(cx, importer, id, name, file);
 }
 
+/**
+ * gjs_module_import_compiled:
+ * @cx: the JS context
+ * @importer: the JS importer object, parent of the module to be imported
+ * @id: module name in the form of a jsid
+ * @name: module name, used for logging and identification
+ * @script: the module's code, compiled for a non-syntactic scope
+ *
+ * Like gjs_module_import(), but executes code that was compiled beforehand,
+ * for example off the main thread, instead of loading it from a file.
+ *
+ * Returns: the JS module object, or nullptr on failure.
+ */
+JSObject* gjs_module_import_compiled(JSContext* cx, JS::HandleObject importer,
+                                     JS::HandleId id, const char* name,
+                                     JS::HandleScript script) {
+    return GjsScriptModule::import_compiled(cx, importer, id, name, script);
+}
+
 decltype(GjsScriptModule::klass) constexpr GjsScriptModule::klass;
 decltype(GjsScriptModule::class_ops) constexpr GjsScriptModule::class_ops;
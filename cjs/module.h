@@ -40,4 +40,9 @@ gjs_module_import(JSContext       *cx,
                   const char      *name,
                   GFile           *file);
 
+GJS_JSAPI_RETURN_CONVENTION
+JSObject* gjs_module_import_compiled(JSContext* cx, JS::HandleObject importer,
+                                     JS::HandleId id, const char* name,
+                                     JS::HandleScript script);
+
 #endif  // GJS_MODULE_H_
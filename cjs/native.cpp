@@ -23,6 +23,8 @@
 
 #include <config.h>
 
+#include <stdint.h>
+
 #include <string>
 #include <tuple>  // for tie
 #include <unordered_map>
@@ -33,6 +35,7 @@
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 
+#include "cjs/context-private.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/native.h"
 #include "util/log.h"
@@ -98,5 +101,18 @@ gjs_load_native_module(JSContext              *context,
         return false;
     }
 
-    return iter->second(context, module_out);
+    // Modules are only defined when first imported, so that programs don't
+    // pay for cairo's classes if they never draw. Their initialization time is
+    // part of the startup profile if that happens before the program runs.
+    int64_t start = g_get_monotonic_time();
+    if (!iter->second(context, module_out))
+        return false;
+
+    if (G_UNLIKELY(GjsContextPrivate::startup_profile_enabled())) {
+        GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
+        std::string phase = "native module " + iter->first;
+        gjs->record_nested_startup_time(phase.c_str(),
+                                        g_get_monotonic_time() - start);
+    }
+    return true;
 }
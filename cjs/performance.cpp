@@ -0,0 +1,112 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+
+#include <chrono>
+
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars
+#include <jsapi.h>  // for JS_DefineFunctions, JS_NewPlainObject, ...
+
+#include "cjs/context-private.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/performance.h"
+#include "cjs/profiler-private.h"
+
+// The clock is the one that sysprof timestamps captures with, so the times of
+// performance.mark() line up with everything else in a capture
+static int64_t now_nsec() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// performance.now() counts from when the library was loaded, which is close
+// enough to the program's start
+static const int64_t time_origin_nsec = now_nsec();
+static const int64_t time_origin_real_usec = g_get_real_time();
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool now_func(JSContext*, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    args.rval().setDouble((now_nsec() - time_origin_nsec) / 1e6);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool is_profiling_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsProfiler* profiler = GjsContextPrivate::from_cx(cx)->profiler();
+    args.rval().setBoolean(profiler && _gjs_profiler_is_running(profiler));
+    return true;
+}
+
+// addProfilerMark(name, message, startTime, duration): adds a mark to the
+// profiler capture, with times in milliseconds as returned by now()
+GJS_JSAPI_RETURN_CONVENTION
+static bool add_profiler_mark_func(JSContext* cx, unsigned argc,
+                                   JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::UniqueChars name, message;
+    double start_ms, duration_ms;
+    if (!gjs_parse_call_args(cx, "addProfilerMark", args, "ssff", "name",
+                             &name, "message", &message, "startTime",
+                             &start_ms, "duration", &duration_ms))
+        return false;
+
+    args.rval().setUndefined();
+    GjsProfiler* profiler = GjsContextPrivate::from_cx(cx)->profiler();
+    if (!profiler || !_gjs_profiler_is_running(profiler))
+        return true;
+
+    _gjs_profiler_add_mark(profiler,
+                           time_origin_nsec + int64_t(start_ms * 1e6),
+                           int64_t(duration_ms * 1e6), "GJS", name.get(),
+                           message.get());
+    return true;
+}
+
+static JSFunctionSpec gjs_performance_module_funcs[] = {
+    JS_FN("now", now_func, 0, 0),
+    JS_FN("isProfiling", is_profiling_func, 0, 0),
+    JS_FN("addProfilerMark", add_profiler_mark_func, 4, 0),
+    JS_FS_END};
+
+bool gjs_define_performance_stuff(JSContext* cx,
+                                  JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    return module &&
+           JS_DefineFunctions(cx, module, gjs_performance_module_funcs) &&
+           JS_DefineProperty(cx, module, "timeOrigin",
+                             time_origin_real_usec / 1e3,
+                             GJS_MODULE_PROP_FLAGS | JSPROP_READONLY);
+}
@@ -26,10 +26,33 @@
 
 #include <stdint.h>
 
+#include <glib.h>  // for G_GNUC_PRINTF, GError
+
+#include <js/ProfilingStack.h>
+#include <js/TypeDecls.h>
+
 #include "cjs/context.h"
 #include "cjs/macros.h"
 #include "cjs/profiler.h"
 
+// Counters that the profiler records alongside the samples; keep in sync with
+// the table in profiler.cpp. The ones after the drain statistics are sampled
+// periodically by the profiler itself, followed in the capture by one counter
+// for each GjsMemCounter.
+enum GjsProfilerCounter {
+    GJS_PROFILER_COUNTER_TOGGLE_QUEUE_LENGTH,
+    GJS_PROFILER_COUNTER_TOGGLE_DRAIN_LATENCY,
+    GJS_PROFILER_COUNTER_JOB_DRAIN_COUNT,
+    GJS_PROFILER_COUNTER_JOB_DRAIN_DURATION,
+    GJS_PROFILER_COUNTER_GC_HEAP_BYTES,
+    GJS_PROFILER_COUNTER_GC_CHUNKS,
+    GJS_PROFILER_COUNTER_GC_NUMBER,
+    GJS_PROFILER_COUNTER_WRAPPED_GOBJECTS,
+    GJS_PROFILER_COUNTER_JOB_QUEUE_LENGTH,
+    GJS_PROFILER_COUNTER_DROPPED_SAMPLES,
+    GJS_PROFILER_N_COUNTERS
+};
+
 GjsProfiler *_gjs_profiler_new(GjsContext *context);
 void _gjs_profiler_free(GjsProfiler *self);
 
@@ -37,8 +60,60 @@ void _gjs_profiler_add_mark(GjsProfiler* self, int64_t time, int64_t duration,
                             const char* group, const char* name,
                             const char* message);
 
+void _gjs_profiler_set_counter(GjsProfiler* self, GjsProfilerCounter counter,
+                               int64_t value);
+
 [[nodiscard]] bool _gjs_profiler_is_running(GjsProfiler* self);
 
+#define GJS_PROFILER_MAX_SAMPLE_RATE 10000
+#define GJS_PROFILER_DBUS_PATH "/org/gnome/gjs/Profiler"
+
+void _gjs_profiler_set_sample_rate(GjsProfiler* self, unsigned hz);
+void _gjs_profiler_set_counters_enabled(GjsProfiler* self, bool enabled);
+
+// Starts the profiler for the JS and D-Bus interfaces, writing to @filename if
+// not null, and taking @hz samples per second, or the previous rate if 0
+[[nodiscard]] bool _gjs_profiler_start_with_options(GjsProfiler* self,
+                                                    const char* filename,
+                                                    unsigned hz, bool counters,
+                                                    GError** error);
+
+void _gjs_profiler_export_dbus(GjsProfiler* self);
+
+// Adds a mark spanning the lifetime of this object to the capture, if the
+// profiler of @cx's context is running; marks made while another one is alive
+// show up nested inside it in sysprof. The message is only formatted when the
+// mark is going to be recorded.
+class GjsAutoProfilerMark {
+    GjsProfiler* m_profiler;
+    int64_t m_start;
+    const char* m_name;
+    char* m_message;
+
+ public:
+    GjsAutoProfilerMark(JSContext* cx, const char* name, const char* format,
+                        ...) G_GNUC_PRINTF(4, 5);
+    ~GjsAutoProfilerMark();
+
+    GjsAutoProfilerMark(const GjsAutoProfilerMark&) = delete;
+    GjsAutoProfilerMark& operator=(const GjsAutoProfilerMark&) = delete;
+};
+
+// Pushes a frame labelled @label onto the profiling stack for the lifetime of
+// this object, if the profiler of @cx's context is running, so that samples
+// taken during a native call are attributed to it instead of only to the JS
+// code calling it. @label must outlive this object.
+class GjsAutoProfilerLabel {
+    ProfilingStack* m_stack;
+
+ public:
+    GjsAutoProfilerLabel(JSContext* cx, const char* label);
+    ~GjsAutoProfilerLabel();
+
+    GjsAutoProfilerLabel(const GjsAutoProfilerLabel&) = delete;
+    GjsAutoProfilerLabel& operator=(const GjsAutoProfilerLabel&) = delete;
+};
+
 void _gjs_profiler_setup_signals(GjsProfiler *self, GjsContext *context);
 
 #endif  // GJS_PROFILER_PRIVATE_H_
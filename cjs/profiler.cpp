@@ -26,7 +26,13 @@
 #ifndef HAVE_SIGNAL_H
 #    include <signal.h>  // for siginfo_t, sigevent, sigaction, SIGPROF, ...
 #endif
+#include <stdarg.h>  // for va_list
+#include <stdint.h>
 
+#include <atomic>
+#include <vector>
+
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 
@@ -34,7 +40,6 @@
 #    include <alloca.h>
 #    include <errno.h>
 #    include <stddef.h>  // for size_t
-#    include <stdint.h>
 #    include <stdio.h>      // for sscanf
 #    include <string.h>     // for memcpy, strlen
 #    include <sys/time.h>   // for CLOCK_MONOTONIC
@@ -50,13 +55,28 @@
 #    include <sysprof-capture.h>
 #endif
 
+#include <js/GCAPI.h>  // for JS_GetGCParameter
+#include <js/ProfilingCategory.h>
 #include <js/ProfilingStack.h>  // for EnableContextProfilingStack, ...
-
+#include <js/RootingAPI.h>
+#include <js/Utility.h>  // for AutoEnterOOMUnsafeRegion
+#include <jsapi.h>        // for JSAutoRealm
+#include <jsfriendapi.h>  // for AllocationMetadataBuilder, ...
+
+#include "gi/object.h"
+#include "gi/toggle.h"
+#include "cjs/context-private.h"
 #include "cjs/context.h"
 #include "cjs/jsapi-util.h"
+#include "cjs/mem-private.h"
+#include "cjs/profiler-private.h"
 #include "cjs/profiler.h"
 
 #define FLUSH_DELAY_SECONDS 3
+#define COUNTER_SAMPLE_INTERVAL_MS 250
+#define WRITER_INTERVAL_MS 10
+#define SAMPLE_BUFFER_SIZE (4 * 1024 * 1024)
+#define FRAME_LABEL_MAX 512
 
 /*
  * This is mostly non-exciting code wrapping the builtin Profiler in
@@ -74,19 +94,24 @@
  * Another option might be to use pthread_kill() and a secondary thread
  * to perform the notification.
  *
- * From within the signal handler, we process the current stack as
- * delivered to us from the JSContext. Any pointer data that comes from
- * the runtime has to be copied, so we keep our own dedup'd string
- * pointers for JavaScript file/line information. Non-JS instruction
- * pointers are just fine, as they can be resolved by parsing the ELF for
- * the file mapped on disk containing that address.
+ * From within the signal handler, we copy the current stack as
+ * delivered to us from the JSContext into a ring buffer, and nothing
+ * else. Any pointer data that comes from the runtime has to be copied,
+ * since it may be gone by the time it is read. A writer thread empties
+ * the ring buffer, and does the more expensive part: it dedups the
+ * strings for JavaScript file/line information in the capture's jitmap,
+ * and writes and flushes the samples. Non-JS instruction pointers are
+ * just fine, as they can be resolved by parsing the ELF for the file
+ * mapped on disk containing that address.
  *
- * As much of this code has to run from signal handlers, it is very
- * important that we don't use anything that can malloc() or lock, or
- * deadlocks are very likely. Most of GjsProfilerCapture is signal-safe.
+ * As the signal handler can interrupt the JS thread anywhere, it is very
+ * important that it doesn't use anything that can malloc() or lock, or
+ * deadlocks are very likely. Everything else that writes to the capture,
+ * from the JS thread or from the writer thread, holds capture_lock.
  */
 
 #define SAMPLES_PER_SEC G_GUINT64_CONSTANT(1000)
+#define DEFAULT_ALLOCATION_INTERVAL 100
 #define NSEC_PER_SEC G_GUINT64_CONSTANT(1000000000)
 
 G_DEFINE_POINTER_TYPE(GjsProfiler, gjs_profiler)
@@ -104,7 +129,21 @@ struct _GjsProfiler {
 
     /* Buffers and writes our sampled stacks */
     SysprofCaptureWriter* capture;
-    GSource* periodic_flush;
+    GMutex capture_lock;
+    GSource* periodic_counters;
+
+    /* Samples copied by the SIGPROF handler, waiting for the writer thread.
+     * The head and tail count the bytes ever written and read, so they are
+     * equal when the buffer is empty. */
+    uint8_t* samples;
+    std::atomic<size_t> samples_head;
+    std::atomic<size_t> samples_tail;
+    std::atomic<unsigned> dropped_samples;
+
+    /* Writes the samples to the capture and flushes it periodically */
+    GThread* writer;
+    std::atomic<bool> writer_quit;
+    std::atomic<bool> write_failed;
 #endif  /* ENABLE_PROFILER */
 
     /* The filename to write to */
@@ -122,15 +161,150 @@ struct _GjsProfiler {
 
     /* GLib signal handler ID for SIGUSR2 */
     unsigned sigusr2_id;
+
+    /* ID of the first of our counters in the capture */
+    unsigned counter_base;
+
+    /* Record the stack of one in this many object allocations, or none if 0,
+     * and how many allocations are left until the next one is recorded */
+    unsigned allocation_interval;
+    unsigned allocations_until_sample;
+
+    /* Stack samples taken per second */
+    unsigned sample_rate;
+
+    /* Whether the counters are recorded along with the samples */
+    bool counters_enabled : 1;
+
+    /* The optional D-Bus interface, see _gjs_profiler_export_dbus() */
+    GCancellable* dbus_cancellable;
+    GDBusConnection* dbus_connection;
+    unsigned dbus_registration_id;
 #endif  /* ENABLE_PROFILER */
 
     /* If we are currently sampling */
     unsigned running : 1;
 };
 
-static GjsContext *profiling_context;
+// The one context that has a profiler. Contexts on other threads may try to
+// create one at the same time, and the SIGPROF handler reads it, so it is
+// atomic
+static std::atomic<GjsContext*> profiling_context = ATOMIC_VAR_INIT(nullptr);
 
 #ifdef ENABLE_PROFILER
+struct GjsProfilerCounterInfo {
+    const char* category;
+    const char* name;
+    const char* description;
+};
+
+static const GjsProfilerCounterInfo counter_info[GJS_PROFILER_N_COUNTERS] = {
+    {"GJS", "Toggle queue length", "Toggle notifications waiting"},
+    {"GJS", "Toggle drain latency", "Time toggles waited in queue (us)"},
+    {"GJS", "Jobs per drain", "Promise jobs run in the last drain"},
+    {"GJS", "Job drain duration", "Time spent in the last drain (us)"},
+    {"GJS GC", "Heap bytes", "Bytes allocated in the GC heap"},
+    {"GJS GC", "Chunks", "1 MiB chunks held by the GC heap"},
+    {"GJS GC", "GC number", "Major and minor GCs run so far"},
+    {"GJS", "Wrapped GObjects", "GObjects with a JS wrapper"},
+    {"GJS", "Job queue length", "Promise jobs waiting to run"},
+    {"GJS", "Dropped samples", "Samples lost because the buffer was full"},
+};
+
+#define GJS_LIST_MEM_COUNTER(name) &gjs_counter_##name,
+static GjsMemCounter* const mem_counters[] = {
+    &gjs_counter_everything,
+    GJS_FOR_EACH_COUNTER(GJS_LIST_MEM_COUNTER)
+    &gjs_counter_callback_trampoline};
+#undef GJS_LIST_MEM_COUNTER
+
+static constexpr size_t N_CAPTURE_COUNTERS =
+    GJS_PROFILER_N_COUNTERS + G_N_ELEMENTS(mem_counters);
+
+/* Defines the counters in the capture, must be called right after creating
+ * the capture writer. */
+[[nodiscard]] static bool gjs_profiler_define_counters(GjsProfiler* self) {
+    SysprofCaptureCounter counters[N_CAPTURE_COUNTERS];
+
+    self->counter_base = sysprof_capture_writer_request_counter(
+        self->capture, N_CAPTURE_COUNTERS);
+
+    for (size_t ix = 0; ix < N_CAPTURE_COUNTERS; ix++) {
+        SysprofCaptureCounter* counter = &counters[ix];
+        memset(counter, 0, sizeof(*counter));
+        if (ix < GJS_PROFILER_N_COUNTERS) {
+            g_strlcpy(counter->category, counter_info[ix].category,
+                      sizeof(counter->category));
+            g_strlcpy(counter->name, counter_info[ix].name,
+                      sizeof(counter->name));
+            g_strlcpy(counter->description, counter_info[ix].description,
+                      sizeof(counter->description));
+        } else {
+            const GjsMemCounter* mem =
+                mem_counters[ix - GJS_PROFILER_N_COUNTERS];
+            g_strlcpy(counter->category, "GJS memory",
+                      sizeof(counter->category));
+            g_strlcpy(counter->name, mem->name, sizeof(counter->name));
+            g_snprintf(counter->description, sizeof(counter->description),
+                       "Live %s objects", mem->name);
+        }
+        counter->id = self->counter_base + ix;
+        counter->type = SYSPROF_CAPTURE_COUNTER_INT64;
+        counter->value.v64 = 0;
+    }
+
+    int64_t now = g_get_monotonic_time() * 1000L;
+    return sysprof_capture_writer_define_counters(
+        self->capture, now, -1, self->pid, counters, N_CAPTURE_COUNTERS);
+}
+
+// Writes the counters that aren't updated when something happens, but
+// describe the state of the heap and the queues; runs from the main loop
+static gboolean profiler_sample_counters_cb(void* user_data) {
+    auto* self = static_cast<GjsProfiler*>(user_data);
+
+    if (!self->running)
+        return G_SOURCE_REMOVE;
+
+    // The writer thread can't stop the profiler itself
+    if (self->write_failed) {
+        g_warning("Failed to write profiler samples");
+        gjs_profiler_stop(self);
+        return G_SOURCE_REMOVE;
+    }
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(self->cx);
+    int64_t values[N_CAPTURE_COUNTERS - GJS_PROFILER_COUNTER_GC_HEAP_BYTES];
+    int64_t* value = values;
+    *value++ = JS_GetGCParameter(self->cx, JSGC_BYTES);
+    *value++ = JS_GetGCParameter(self->cx, JSGC_TOTAL_CHUNKS);
+    *value++ = JS_GetGCParameter(self->cx, JSGC_NUMBER);
+    *value++ = ObjectInstance::num_wrapped_gobjects();
+    *value++ = gjs->job_queue_length();
+    *value++ = self->dropped_samples;
+    for (const GjsMemCounter* mem : mem_counters)
+        *value++ = g_atomic_int_get(&mem->value);
+
+    unsigned ids[G_N_ELEMENTS(values)];
+    SysprofCaptureCounterValue counter_values[G_N_ELEMENTS(values)];
+    for (size_t ix = 0; ix < G_N_ELEMENTS(values); ix++) {
+        ids[ix] = self->counter_base + GJS_PROFILER_COUNTER_GC_HEAP_BYTES + ix;
+        counter_values[ix].v64 = values[ix];
+    }
+    g_mutex_lock(&self->capture_lock);
+    sysprof_capture_writer_set_counters(
+        self->capture, g_get_monotonic_time() * 1000L, -1, self->pid, ids,
+        counter_values, G_N_ELEMENTS(values));
+    g_mutex_unlock(&self->capture_lock);
+
+    // Also sampled here, since it is otherwise only written when the queue is
+    // drained, so a queue that never drains would look empty
+    _gjs_profiler_set_counter(self, GJS_PROFILER_COUNTER_TOGGLE_QUEUE_LENGTH,
+                              gjs->toggle_queue().length());
+
+    return G_SOURCE_CONTINUE;
+}
+
 /*
  * gjs_profiler_extract_maps:
  *
@@ -211,14 +385,13 @@ _gjs_profiler_new(GjsContext *context)
 {
     g_return_val_if_fail(context, nullptr);
 
-    if (profiling_context == context) {
-        g_critical("You can only create one profiler at a time.");
-        return nullptr;
-    }
-
-    if (profiling_context) {
-        g_message("Not going to profile GjsContext %p; you can only profile "
-                  "one context at a time.", context);
+    GjsContext* current = nullptr;
+    if (!profiling_context.compare_exchange_strong(current, context)) {
+        if (current == context)
+            g_critical("You can only create one profiler at a time.");
+        else
+            g_message("Not going to profile GjsContext %p; you can only "
+                      "profile one context at a time.", context);
         return nullptr;
     }
 
@@ -227,10 +400,22 @@ _gjs_profiler_new(GjsContext *context)
 #ifdef ENABLE_PROFILER
     self->cx = static_cast<JSContext *>(gjs_context_get_native_context(context));
     self->pid = getpid();
+    self->sample_rate = SAMPLES_PER_SEC;
+    self->counters_enabled = true;
+
+    const char* env_allocations = g_getenv("GJS_PROFILE_ALLOCATIONS");
+    if (env_allocations) {
+        // Any value that isn't a number, such as an empty one, means default
+        self->allocation_interval =
+            g_ascii_strtoull(env_allocations, nullptr, 10);
+        if (self->allocation_interval == 0)
+            self->allocation_interval = DEFAULT_ALLOCATION_INTERVAL;
+    }
 #endif
     self->fd = -1;
-
-    profiling_context = context;
+#ifdef ENABLE_PROFILER
+    g_mutex_init(&self->capture_lock);
+#endif
 
     return self;
 }
@@ -258,7 +443,16 @@ _gjs_profiler_free(GjsProfiler *self)
     g_clear_pointer(&self->filename, g_free);
 #ifdef ENABLE_PROFILER
     g_clear_pointer(&self->capture, sysprof_capture_writer_unref);
-    g_clear_pointer(&self->periodic_flush, g_source_destroy);
+    g_clear_pointer(&self->periodic_counters, g_source_destroy);
+    g_mutex_clear(&self->capture_lock);
+
+    if (self->dbus_cancellable)
+        g_cancellable_cancel(self->dbus_cancellable);
+    g_clear_object(&self->dbus_cancellable);
+    if (self->dbus_registration_id != 0)
+        g_dbus_connection_unregister_object(self->dbus_connection,
+                                            self->dbus_registration_id);
+    g_clear_object(&self->dbus_connection);
 
     if (self->fd != -1)
         close(self->fd);
@@ -287,6 +481,120 @@ _gjs_profiler_is_running(GjsProfiler *self)
 
 #ifdef ENABLE_PROFILER
 
+/*
+ * gjs_profiler_format_frame:
+ *
+ * Writes the label of @entry, followed by its dynamic string if it has one,
+ * into @final_string, which must have room for FRAME_LABEL_MAX bytes, and
+ * returns its length. This is called from the SIGPROF handler, so it must not
+ * malloc() or lock.
+ */
+static size_t gjs_profiler_format_frame(const js::ProfilingStackFrame& entry,
+                                        char* final_string) {
+    const char *label = entry.label();
+    const char *dynamic_string = entry.dynamicString();
+    size_t label_length = strlen(label);
+
+    char *position = final_string;
+    size_t available_length = FRAME_LABEL_MAX - 1;
+
+    if (label_length > 0) {
+        label_length = MIN(label_length, available_length);
+
+        /* Start copying the label to the final string */
+        memcpy(position, label, label_length);
+        available_length -= label_length;
+        position += label_length;
+
+        /*
+         * Add a space in between the label and the dynamic string,
+         * if there is one.
+         */
+        if (dynamic_string && available_length > 0) {
+            *position++ = ' ';
+            available_length--;
+        }
+    }
+
+    /* Now append the dynamic string at the end of the final string.
+     * The string is cut in case it doesn't fit the remaining space.
+     */
+    if (dynamic_string) {
+        size_t dynamic_string_length = strlen(dynamic_string);
+
+        if (dynamic_string_length > 0) {
+            size_t remaining_length = MIN(available_length, dynamic_string_length);
+            memcpy(position, dynamic_string, remaining_length);
+            position += remaining_length;
+        }
+    }
+
+    *position = 0;
+    return position - final_string;
+}
+
+/*
+ * gjs_profiler_collect_stack:
+ *
+ * Fills @addrs with the @depth frames of the profiling stack, innermost
+ * first, adding the labels of JS frames to the capture's jitmap. The caller
+ * must hold capture_lock, so this can't be used from the SIGPROF handler.
+ */
+static void gjs_profiler_collect_stack(GjsProfiler* self,
+                                       SysprofCaptureAddress* addrs,
+                                       uint32_t depth) {
+    for (uint32_t ix = 0; ix < depth; ix++) {
+        const js::ProfilingStackFrame& entry = self->stack.frames[ix];
+        uint32_t flipped = depth - 1 - ix;
+        char final_string[FRAME_LABEL_MAX];
+
+        /*
+         * GeckoProfiler will put "js::RunScript" on the stack, but it has
+         * a stack address of "this", which is not terribly useful since
+         * everything will show up as [stack] when building callgraphs.
+         */
+        if (gjs_profiler_format_frame(entry, final_string) > 0)
+            addrs[flipped] =
+                sysprof_capture_writer_add_jitmap(self->capture, final_string);
+        else
+            addrs[flipped] = SysprofCaptureAddress(entry.stackAddress());
+    }
+}
+
+/*
+ * The SIGPROF handler writes each sample into the sample buffer as a
+ * GjsSampleHeader followed by one GjsFrameHeader per frame, innermost first,
+ * each followed by label_length bytes of its label. Frames without a label
+ * have their stack address instead. Records may wrap around the end of the
+ * buffer.
+ */
+struct GjsSampleHeader {
+    int64_t time;
+    uint32_t depth;
+};
+
+struct GjsFrameHeader {
+    SysprofCaptureAddress address;
+    uint32_t label_length;
+};
+
+static void samples_write(GjsProfiler* self, size_t pos, const void* data,
+                          size_t len) {
+    size_t offset = pos % SAMPLE_BUFFER_SIZE;
+    size_t first = MIN(len, SAMPLE_BUFFER_SIZE - offset);
+    memcpy(self->samples + offset, data, first);
+    memcpy(self->samples, static_cast<const uint8_t*>(data) + first,
+           len - first);
+}
+
+static void samples_read(GjsProfiler* self, size_t pos, void* data,
+                         size_t len) {
+    size_t offset = pos % SAMPLE_BUFFER_SIZE;
+    size_t first = MIN(len, SAMPLE_BUFFER_SIZE - offset);
+    memcpy(data, self->samples + offset, first);
+    memcpy(static_cast<uint8_t*>(data) + first, self->samples, len - first);
+}
+
 static void gjs_profiler_sigprof(int signum [[maybe_unused]], siginfo_t* info,
                                  void*) {
     GjsProfiler *self = gjs_context_get_profiler(profiling_context);
@@ -303,97 +611,196 @@ static void gjs_profiler_sigprof(int signum [[maybe_unused]], siginfo_t* info,
      * that is not okay to do, is *malloc*.
      */
 
-    if (!self || info->si_code != SI_TIMER)
+    if (!self || !self->samples || info->si_code != SI_TIMER)
         return;
 
     uint32_t depth = self->stack.stackSize();
     if (depth == 0)
         return;
 
-    int64_t now = g_get_monotonic_time() * 1000L;
+    // Only this handler moves the head, and the writer thread only moves the
+    // tail forward, so the space seen here can only grow while writing
+    size_t head = self->samples_head.load(std::memory_order_relaxed);
+    size_t tail = self->samples_tail.load(std::memory_order_acquire);
+    size_t pos = head + sizeof(GjsSampleHeader);
+
+    for (uint32_t ix = depth; ix-- > 0;) {
+        const js::ProfilingStackFrame& entry = self->stack.frames[ix];
+        char final_string[FRAME_LABEL_MAX];
+        GjsFrameHeader frame;
+        frame.label_length = gjs_profiler_format_frame(entry, final_string);
+        frame.address = frame.label_length > 0
+                            ? 0
+                            : SysprofCaptureAddress(entry.stackAddress());
+
+        if (pos + sizeof frame + frame.label_length - tail >
+            SAMPLE_BUFFER_SIZE) {
+            self->dropped_samples++;
+            return;
+        }
 
-    /* NOTE: cppcheck warns that alloca() is not recommended since it can
-     * easily overflow the stack; however, dynamic allocation is not an option
-     * here since we are in a signal handler.
-     */
-    SysprofCaptureAddress* addrs =
-        // cppcheck-suppress allocaCalled
-        static_cast<SysprofCaptureAddress*>(alloca(sizeof *addrs * depth));
+        samples_write(self, pos, &frame, sizeof frame);
+        pos += sizeof frame;
+        samples_write(self, pos, final_string, frame.label_length);
+        pos += frame.label_length;
+    }
 
-    for (uint32_t ix = 0; ix < depth; ix++) {
-        js::ProfilingStackFrame& entry = self->stack.frames[ix];
-        const char *label = entry.label();
-        const char *dynamic_string = entry.dynamicString();
-        uint32_t flipped = depth - 1 - ix;
-        size_t label_length = strlen(label);
+    GjsSampleHeader sample;
+    sample.time = g_get_monotonic_time() * 1000L;
+    sample.depth = depth;
+    samples_write(self, head, &sample, sizeof sample);
 
-        /*
-         * 512 is an arbitrarily large size, very likely to be enough to
-         * hold the final string.
-         */
-        char final_string[512];
-        char *position = final_string;
-        size_t available_length = sizeof (final_string) - 1;
-
-        if (label_length > 0) {
-            label_length = MIN(label_length, available_length);
-
-            /* Start copying the label to the final string */
-            memcpy(position, label, label_length);
-            available_length -= label_length;
-            position += label_length;
-
-            /*
-             * Add a space in between the label and the dynamic string,
-             * if there is one.
-             */
-            if (dynamic_string && available_length > 0) {
-                *position++ = ' ';
-                available_length--;
+    self->samples_head.store(pos, std::memory_order_release);
+}
+
+/* Writes the samples in the sample buffer to the capture; the caller must
+ * hold capture_lock. */
+static void gjs_profiler_write_samples(GjsProfiler* self) {
+    size_t tail = self->samples_tail.load(std::memory_order_relaxed);
+    size_t head = self->samples_head.load(std::memory_order_acquire);
+    std::vector<SysprofCaptureAddress> addrs;
+
+    while (tail != head) {
+        GjsSampleHeader sample;
+        samples_read(self, tail, &sample, sizeof sample);
+        tail += sizeof sample;
+
+        addrs.resize(sample.depth);
+        for (uint32_t ix = 0; ix < sample.depth; ix++) {
+            GjsFrameHeader frame;
+            samples_read(self, tail, &frame, sizeof frame);
+            tail += sizeof frame;
+
+            if (frame.label_length == 0) {
+                addrs[ix] = frame.address;
+                continue;
             }
+
+            char final_string[FRAME_LABEL_MAX];
+            samples_read(self, tail, final_string, frame.label_length);
+            final_string[frame.label_length] = '\0';
+            tail += frame.label_length;
+            addrs[ix] =
+                sysprof_capture_writer_add_jitmap(self->capture, final_string);
         }
 
-        /* Now append the dynamic string at the end of the final string.
-         * The string is cut in case it doesn't fit the remaining space.
-         */
-        if (dynamic_string) {
-            size_t dynamic_string_length = strlen(dynamic_string);
+        if (!self->write_failed &&
+            !sysprof_capture_writer_add_sample(self->capture, sample.time, -1,
+                                               self->pid, -1, addrs.data(),
+                                               sample.depth))
+            self->write_failed = true;
 
-            if (dynamic_string_length > 0) {
-                size_t remaining_length = MIN(available_length, dynamic_string_length);
-                memcpy(position, dynamic_string, remaining_length);
-                position += remaining_length;
-            }
-        }
+        // Give the space back to the handler as soon as possible
+        self->samples_tail.store(tail, std::memory_order_release);
+    }
+}
 
-        *position = 0;
+static void* gjs_profiler_writer_thread(void* data) {
+    auto* self = static_cast<GjsProfiler*>(data);
+    int64_t last_flush = g_get_monotonic_time();
 
-        /*
-         * GeckoProfiler will put "js::RunScript" on the stack, but it has
-         * a stack address of "this", which is not terribly useful since
-         * everything will show up as [stack] when building callgraphs.
-         */
-        if (final_string[0] != '\0')
-            addrs[flipped] =
-                sysprof_capture_writer_add_jitmap(self->capture, final_string);
-        else
-            addrs[flipped] = SysprofCaptureAddress(entry.stackAddress());
+    while (!self->writer_quit) {
+        g_usleep(WRITER_INTERVAL_MS * 1000);
+
+        g_mutex_lock(&self->capture_lock);
+        gjs_profiler_write_samples(self);
+
+        /* Automatically flush to be resilient against SIGINT, etc */
+        int64_t now = g_get_monotonic_time();
+        if (now - last_flush >= FLUSH_DELAY_SECONDS * G_USEC_PER_SEC) {
+            sysprof_capture_writer_flush(self->capture);
+            last_flush = now;
+        }
+        g_mutex_unlock(&self->capture_lock);
     }
 
-    if (!sysprof_capture_writer_add_sample(self->capture, now, -1, self->pid,
-                                           -1, addrs, depth))
-        gjs_profiler_stop(self);
+    return nullptr;
 }
 
-static gboolean profiler_auto_flush_cb(void* user_data) {
-    auto* self = static_cast<GjsProfiler*>(user_data);
+static void gjs_profiler_start_writer(GjsProfiler* self) {
+    self->samples = static_cast<uint8_t*>(g_malloc(SAMPLE_BUFFER_SIZE));
+    self->samples_head = 0;
+    self->samples_tail = 0;
+    self->dropped_samples = 0;
+    self->writer_quit = false;
+    self->write_failed = false;
+    self->writer =
+        g_thread_new("gjs-profiler", gjs_profiler_writer_thread, self);
+}
 
-    if (!self->running)
-        return G_SOURCE_REMOVE;
+/* Stops the writer thread and writes what it left behind; the SIGPROF timer
+ * must already be stopped. */
+static void gjs_profiler_stop_writer(GjsProfiler* self) {
+    self->writer_quit = true;
+    g_thread_join(self->writer);
+    self->writer = nullptr;
 
-    sysprof_capture_writer_flush(self->capture);
+    g_mutex_lock(&self->capture_lock);
+    gjs_profiler_write_samples(self);
+    g_mutex_unlock(&self->capture_lock);
 
-    return G_SOURCE_CONTINUE;
+    uint8_t* samples = self->samples;
+    self->samples = nullptr;
+    g_free(samples);
+}
+
+/*
+ * GjsAllocationSampler:
+ *
+ * SpiderMonkey calls this for every object allocated in the realm of the
+ * global object while it is installed. One in every allocation_interval of
+ * them gets the current profiling stack recorded as an allocation in the
+ * capture; the size recorded is the interval, so that the totals sysprof
+ * shows for each stack estimate the number of objects allocated there.
+ *
+ * Installing a builder makes SpiderMonkey allocate objects in the tenured
+ * heap instead of the nursery, so expect more major GCs while sampling.
+ */
+class GjsAllocationSampler : public js::AllocationMetadataBuilder {
+ public:
+    JSObject* build(JSContext*, JS::HandleObject obj,
+                    js::AutoEnterOOMUnsafeRegion&) const override {
+        GjsProfiler* self = gjs_context_get_profiler(profiling_context);
+        if (!self || !self->running || self->allocation_interval == 0)
+            return nullptr;
+
+        if (self->allocations_until_sample > 1) {
+            self->allocations_until_sample--;
+            return nullptr;
+        }
+        self->allocations_until_sample = self->allocation_interval;
+
+        uint32_t depth = self->stack.stackSize();
+        if (depth == 0)
+            return nullptr;
+
+        SysprofCaptureAddress* addrs =
+            // cppcheck-suppress allocaCalled
+            static_cast<SysprofCaptureAddress*>(alloca(sizeof *addrs * depth));
+
+        g_mutex_lock(&self->capture_lock);
+        gjs_profiler_collect_stack(self, addrs, depth);
+        sysprof_capture_writer_add_allocation_copy(
+            self->capture, g_get_monotonic_time() * 1000L, -1, self->pid, -1,
+            SysprofCaptureAddress(obj.get()), self->allocation_interval, addrs,
+            depth);
+        g_mutex_unlock(&self->capture_lock);
+
+        // No metadata is attached to the object
+        return nullptr;
+    }
+};
+
+static const GjsAllocationSampler allocation_sampler{};
+
+static void gjs_profiler_set_allocation_sampler(
+    GjsProfiler* self, const js::AllocationMetadataBuilder* sampler) {
+    JSObject* global = GjsContextPrivate::from_cx(self->cx)->global();
+    if (!global)
+        return;
+
+    JSAutoRealm ar(self->cx, global);
+    js::SetAllocationMetadataBuilder(self->cx, sampler);
 }
 
 #endif  /* ENABLE_PROFILER */
@@ -445,27 +852,27 @@ gjs_profiler_start(GjsProfiler *self)
         return;
     }
 
-    /* Automatically flush to be resilient against SIGINT, etc */
-    if (!self->periodic_flush) {
-        self->periodic_flush =
-            g_timeout_source_new_seconds(FLUSH_DELAY_SECONDS);
-        g_source_set_name(self->periodic_flush,
-                          "[sysprof-capture-writer-flush]");
-        g_source_set_priority(self->periodic_flush, G_PRIORITY_LOW + 100);
-        g_source_set_callback(self->periodic_flush,
-                              (GSourceFunc)profiler_auto_flush_cb, self,
-                              nullptr);
-        g_source_attach(self->periodic_flush,
-                        g_main_context_get_thread_default());
-    }
-
     if (!gjs_profiler_extract_maps(self)) {
         g_warning("Failed to extract proc maps");
         g_clear_pointer(&self->capture, sysprof_capture_writer_unref);
-        g_clear_pointer(&self->periodic_flush, g_source_destroy);
+        g_clear_pointer(&self->periodic_counters, g_source_destroy);
         return;
     }
 
+    if (!self->counters_enabled) {
+        // Not recording any
+    } else if (!gjs_profiler_define_counters(self)) {
+        g_warning("Failed to define profiler counters");
+    } else if (!self->periodic_counters) {
+        self->periodic_counters = g_timeout_source_new(
+            COUNTER_SAMPLE_INTERVAL_MS);
+        g_source_set_name(self->periodic_counters, "[gjs-profiler-counters]");
+        g_source_set_callback(self->periodic_counters,
+                              profiler_sample_counters_cb, self, nullptr);
+        g_source_attach(self->periodic_counters,
+                        g_main_context_get_thread_default());
+    }
+
     /* Setup our signal handler for SIGPROF delivery */
     sa.sa_flags = SA_RESTART | SA_SIGINFO;
     sa.sa_sigaction = gjs_profiler_sigprof;
@@ -474,7 +881,7 @@ gjs_profiler_start(GjsProfiler *self)
     if (sigaction(SIGPROF, &sa, nullptr) == -1) {
         g_warning("Failed to register sigaction handler: %s", g_strerror(errno));
         g_clear_pointer(&self->capture, sysprof_capture_writer_unref);
-        g_clear_pointer(&self->periodic_flush, g_source_destroy);
+        g_clear_pointer(&self->periodic_counters, g_source_destroy);
         return;
     }
 
@@ -495,22 +902,25 @@ gjs_profiler_start(GjsProfiler *self)
     if (timer_create(CLOCK_MONOTONIC, &sev, &self->timer) == -1) {
         g_warning("Failed to create profiler timer: %s", g_strerror(errno));
         g_clear_pointer(&self->capture, sysprof_capture_writer_unref);
-        g_clear_pointer(&self->periodic_flush, g_source_destroy);
+        g_clear_pointer(&self->periodic_counters, g_source_destroy);
         return;
     }
 
+    gjs_profiler_start_writer(self);
+
     /* Calculate sampling interval */
-    its.it_interval.tv_sec = 0;
-    its.it_interval.tv_nsec = NSEC_PER_SEC / SAMPLES_PER_SEC;
-    its.it_value.tv_sec = 0;
-    its.it_value.tv_nsec = NSEC_PER_SEC / SAMPLES_PER_SEC;
+    uint64_t interval_nsec = NSEC_PER_SEC / self->sample_rate;
+    its.it_interval.tv_sec = interval_nsec / NSEC_PER_SEC;
+    its.it_interval.tv_nsec = interval_nsec % NSEC_PER_SEC;
+    its.it_value = its.it_interval;
 
     /* Now start this timer */
     if (timer_settime(self->timer, 0, &its, &old_its) != 0) {
         g_warning("Failed to enable profiler timer: %s", g_strerror(errno));
         timer_delete(self->timer);
+        gjs_profiler_stop_writer(self);
         g_clear_pointer(&self->capture, sysprof_capture_writer_unref);
-        g_clear_pointer(&self->periodic_flush, g_source_destroy);
+        g_clear_pointer(&self->periodic_counters, g_source_destroy);
         return;
     }
 
@@ -522,6 +932,11 @@ gjs_profiler_start(GjsProfiler *self)
     /* Start recording stack info */
     js::EnableContextProfilingStack(self->cx, true);
 
+    if (self->allocation_interval > 0) {
+        self->allocations_until_sample = self->allocation_interval;
+        gjs_profiler_set_allocation_sampler(self, &allocation_sampler);
+    }
+
     g_message("Profiler started");
 
 #else  /* !ENABLE_PROFILER */
@@ -565,10 +980,14 @@ gjs_profiler_stop(GjsProfiler *self)
     js::EnableContextProfilingStack(self->cx, false);
     js::SetContextProfilingStack(self->cx, nullptr);
 
+    if (self->allocation_interval > 0)
+        gjs_profiler_set_allocation_sampler(self, nullptr);
+
+    gjs_profiler_stop_writer(self);
     sysprof_capture_writer_flush(self->capture);
 
     g_clear_pointer(&self->capture, sysprof_capture_writer_unref);
-    g_clear_pointer(&self->periodic_flush, g_source_destroy);
+    g_clear_pointer(&self->periodic_counters, g_source_destroy);
 
     g_message("Profiler stopped");
 
@@ -700,8 +1119,10 @@ void _gjs_profiler_add_mark(GjsProfiler* self, gint64 time_nsec,
 
 #ifdef ENABLE_PROFILER
     if (self->running && self->capture != nullptr) {
+        g_mutex_lock(&self->capture_lock);
         sysprof_capture_writer_add_mark(self->capture, time_nsec, -1, self->pid,
                                         duration_nsec, group, name, message);
+        g_mutex_unlock(&self->capture_lock);
     }
 #else
     // Unused in the no-profiler case
@@ -711,6 +1132,101 @@ void _gjs_profiler_add_mark(GjsProfiler* self, gint64 time_nsec,
 #endif
 }
 
+GjsAutoProfilerMark::GjsAutoProfilerMark(JSContext* cx, const char* name,
+                                         const char* format, ...)
+    : m_profiler(nullptr), m_start(0), m_name(name), m_message(nullptr) {
+    GjsProfiler* profiler = GjsContextPrivate::from_cx(cx)->profiler();
+    if (!profiler || !_gjs_profiler_is_running(profiler))
+        return;
+
+    m_profiler = profiler;
+    m_start = g_get_monotonic_time() * 1000L;
+
+    va_list args;
+    va_start(args, format);
+    m_message = g_strdup_vprintf(format, args);
+    va_end(args);
+}
+
+GjsAutoProfilerMark::~GjsAutoProfilerMark() {
+    if (!m_profiler)
+        return;
+
+    int64_t now = g_get_monotonic_time() * 1000L;
+    _gjs_profiler_add_mark(m_profiler, m_start, now - m_start, "GJS", m_name,
+                           m_message);
+    g_free(m_message);
+}
+
+GjsAutoProfilerLabel::GjsAutoProfilerLabel(JSContext* cx, const char* label)
+    : m_stack(nullptr) {
+#ifdef ENABLE_PROFILER
+    GjsProfiler* profiler = GjsContextPrivate::from_cx(cx)->profiler();
+    if (!profiler || !profiler->running)
+        return;
+
+    m_stack = &profiler->stack;
+    m_stack->pushLabelFrame(label, nullptr, this,
+                            JS::ProfilingCategoryPair::OTHER);
+#else
+    // Unused in the no-profiler case
+    (void)cx;
+    (void)label;
+#endif
+}
+
+GjsAutoProfilerLabel::~GjsAutoProfilerLabel() {
+    // Popped even if the profiler was stopped in the meantime, since the
+    // stack is kept until the profiler is freed
+    if (m_stack)
+        m_stack->pop();
+}
+
+void _gjs_profiler_set_counter(GjsProfiler* self, GjsProfilerCounter counter,
+                               int64_t value) {
+    g_return_if_fail(self);
+    g_return_if_fail(counter < GJS_PROFILER_N_COUNTERS);
+
+#ifdef ENABLE_PROFILER
+    if (self->running && self->capture != nullptr && self->counters_enabled) {
+        unsigned id = self->counter_base + counter;
+        SysprofCaptureCounterValue counter_value;
+        counter_value.v64 = value;
+        g_mutex_lock(&self->capture_lock);
+        sysprof_capture_writer_set_counters(self->capture,
+                                            g_get_monotonic_time() * 1000L, -1,
+                                            self->pid, &id, &counter_value, 1);
+        g_mutex_unlock(&self->capture_lock);
+    }
+#else
+    // Unused in the no-profiler case
+    (void)value;
+#endif
+}
+
+/**
+ * gjs_profiler_set_allocation_interval:
+ * @self: A #GjsProfiler
+ * @interval: record one in this many object allocations, or 0 for none
+ *
+ * Besides the periodic stack samples, record the JS stack at which objects
+ * are allocated, for one in every @interval objects allocated in the global
+ * object's realm. They show up as memory allocations in sysprof. This makes
+ * the program run slower while profiling, so it is off by default, unless
+ * the `GJS_PROFILE_ALLOCATIONS` environment variable is set.
+ */
+void gjs_profiler_set_allocation_interval(GjsProfiler* self,
+                                          unsigned interval) {
+    g_return_if_fail(self);
+    g_return_if_fail(!self->running);
+
+#ifdef ENABLE_PROFILER
+    self->allocation_interval = interval;
+#else
+    (void)interval;  // Unused in the no-profiler case
+#endif
+}
+
 void gjs_profiler_set_fd(GjsProfiler* self, int fd) {
     g_return_if_fail(self);
     g_return_if_fail(!self->filename);
@@ -726,3 +1242,170 @@ void gjs_profiler_set_fd(GjsProfiler* self, int fd) {
     (void)fd;  // Unused in the no-profiler case
 #endif
 }
+
+void _gjs_profiler_set_sample_rate(GjsProfiler* self, unsigned hz) {
+    g_return_if_fail(self);
+    g_return_if_fail(!self->running);
+    g_return_if_fail(hz > 0);
+
+#ifdef ENABLE_PROFILER
+    self->sample_rate = hz;
+#else
+    (void)hz;  // Unused in the no-profiler case
+#endif
+}
+
+void _gjs_profiler_set_counters_enabled(GjsProfiler* self, bool enabled) {
+    g_return_if_fail(self);
+    g_return_if_fail(!self->running);
+
+#ifdef ENABLE_PROFILER
+    self->counters_enabled = enabled;
+#else
+    (void)enabled;  // Unused in the no-profiler case
+#endif
+}
+
+bool _gjs_profiler_start_with_options(GjsProfiler* self, const char* filename,
+                                      unsigned hz, bool counters,
+                                      GError** error) {
+    g_return_val_if_fail(self, false);
+
+    if (self->running) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_BUSY,
+                            "The profiler is already running");
+        return false;
+    }
+    if (hz > GJS_PROFILER_MAX_SAMPLE_RATE) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                    "The sampling frequency must be between 1 and %u Hz",
+                    GJS_PROFILER_MAX_SAMPLE_RATE);
+        return false;
+    }
+
+    if (filename)
+        gjs_profiler_set_filename(self, filename);
+    if (hz > 0)
+        _gjs_profiler_set_sample_rate(self, hz);
+    _gjs_profiler_set_counters_enabled(self, counters);
+
+    gjs_profiler_start(self);
+    if (!self->running) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                            "Failed to start the profiler");
+        return false;
+    }
+    return true;
+}
+
+#ifdef ENABLE_PROFILER
+
+static const char profiler_dbus_xml[] =
+    "<node>"
+    "  <interface name='org.gnome.gjs.Profiler'>"
+    "    <method name='Start'>"
+    "      <arg type='a{sv}' name='options' direction='in'/>"
+    "    </method>"
+    "    <method name='Stop'/>"
+    "    <property type='b' name='Running' access='read'/>"
+    "  </interface>"
+    "</node>";
+
+static void profiler_dbus_method_call(GDBusConnection*, const char*,
+                                      const char*, const char*,
+                                      const char* method_name,
+                                      GVariant* parameters,
+                                      GDBusMethodInvocation* invocation,
+                                      void* user_data) {
+    auto* self = static_cast<GjsProfiler*>(user_data);
+
+    if (strcmp(method_name, "Stop") == 0) {
+        gjs_profiler_stop(self);
+        g_dbus_method_invocation_return_value(invocation, nullptr);
+        return;
+    }
+
+    g_assert(strcmp(method_name, "Start") == 0);
+
+    GjsAutoPointer<GVariant, GVariant, g_variant_unref> options =
+        g_variant_get_child_value(parameters, 0);
+    const char* filename = nullptr;
+    unsigned hz = 0;
+    gboolean counters = true;
+    g_variant_lookup(options, "file", "&s", &filename);
+    g_variant_lookup(options, "frequency-hz", "u", &hz);
+    g_variant_lookup(options, "counters", "b", &counters);
+
+    GError* error = nullptr;
+    if (!_gjs_profiler_start_with_options(self, filename, hz, counters,
+                                          &error)) {
+        g_dbus_method_invocation_take_error(invocation, error);
+        return;
+    }
+    g_dbus_method_invocation_return_value(invocation, nullptr);
+}
+
+static GVariant* profiler_dbus_get_property(GDBusConnection*, const char*,
+                                            const char*, const char*,
+                                            const char* property_name,
+                                            GError**, void* user_data) {
+    auto* self = static_cast<GjsProfiler*>(user_data);
+    g_assert(strcmp(property_name, "Running") == 0);
+    return g_variant_new_boolean(self->running);
+}
+
+static const GDBusInterfaceVTable profiler_dbus_vtable = {
+    profiler_dbus_method_call, profiler_dbus_get_property, nullptr, {}};
+
+static void on_profiler_bus_acquired(GObject*, GAsyncResult* result,
+                                     void* user_data) {
+    GError* error = nullptr;
+    GDBusConnection* connection = g_bus_get_finish(result, &error);
+    if (!connection) {
+        // Cancelled if the profiler was freed in the meantime
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            g_warning("Not exporting the profiler on D-Bus: %s",
+                      error->message);
+        g_error_free(error);
+        return;
+    }
+
+    auto* self = static_cast<GjsProfiler*>(user_data);
+    self->dbus_connection = connection;
+
+    GjsAutoPointer<GDBusNodeInfo, GDBusNodeInfo, g_dbus_node_info_unref> info =
+        g_dbus_node_info_new_for_xml(profiler_dbus_xml, nullptr);
+    self->dbus_registration_id = g_dbus_connection_register_object(
+        connection, GJS_PROFILER_DBUS_PATH, info->interfaces[0],
+        &profiler_dbus_vtable, self, nullptr, &error);
+    if (self->dbus_registration_id == 0) {
+        g_warning("Not exporting the profiler on D-Bus: %s", error->message);
+        g_error_free(error);
+    }
+}
+
+#endif  /* ENABLE_PROFILER */
+
+/*
+ * _gjs_profiler_export_dbus:
+ * @self: A #GjsProfiler
+ *
+ * Makes the profiler controllable over the session bus, with the
+ * org.gnome.gjs.Profiler interface at GJS_PROFILER_DBUS_PATH on the process's
+ * connection, which is set up asynchronously. Its methods run in the thread
+ * default main context of the calling thread, which must be the JS thread.
+ */
+void _gjs_profiler_export_dbus(GjsProfiler* self) {
+    g_return_if_fail(self);
+
+#ifdef ENABLE_PROFILER
+    if (self->dbus_cancellable)
+        return;
+
+    self->dbus_cancellable = g_cancellable_new();
+    g_bus_get(G_BUS_TYPE_SESSION, self->dbus_cancellable,
+              on_profiler_bus_acquired, self);
+#else
+    g_message("Profiler is disabled. Not exporting it on D-Bus.");
+#endif
+}
@@ -47,6 +47,8 @@ void gjs_profiler_set_filename(GjsProfiler *self,
                                const char  *filename);
 GJS_EXPORT
 void gjs_profiler_set_fd(GjsProfiler* self, int fd);
+GJS_EXPORT
+void gjs_profiler_set_allocation_interval(GjsProfiler* self, unsigned interval);
 
 GJS_EXPORT
 void gjs_profiler_start(GjsProfiler *self);
@@ -0,0 +1,93 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_ROOT_SET_H_
+#define GJS_ROOT_SET_H_
+
+#include <config.h>
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <js/RootingAPI.h>
+#include <js/TracingAPI.h>
+
+class JSTracer;
+
+// Roots owned by the context, for GjsMaybeOwned. Each root is a slot holding
+// the address of a JS::Heap, which the context traces as long as the slot is
+// in use. Rooting and unrooting only take a slot from and return it to a free
+// list, where a JS::PersistentRooted would be allocated and freed each time,
+// so that wrappers whose toggle ref state keeps changing don't cost a malloc
+// on each change.
+class GjsRootSet {
+    using TraceFunc = void (*)(JSTracer*, void*);
+
+    struct Slot {
+        void* location;  // a JS::Heap<T>*, or null if the slot is free
+        TraceFunc trace;
+        uint32_t next_free;
+    };
+
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    std::vector<Slot> m_slots;
+    uint32_t m_first_free = NO_SLOT;
+
+    template <typename T>
+    static void trace_heap(JSTracer* trc, void* location) {
+        JS::TraceEdge(trc, static_cast<JS::Heap<T>*>(location),
+                      "GjsMaybeOwned root");
+    }
+
+ public:
+    // Returns the slot, to pass to remove()
+    template <typename T>
+    [[nodiscard]] uint32_t add(JS::Heap<T>* location) {
+        uint32_t ix = m_first_free;
+        if (ix == NO_SLOT) {
+            ix = m_slots.size();
+            m_slots.push_back({});
+        } else {
+            m_first_free = m_slots[ix].next_free;
+        }
+        m_slots[ix] = {location, &trace_heap<T>, NO_SLOT};
+        return ix;
+    }
+
+    void remove(uint32_t ix) {
+        m_slots[ix].location = nullptr;
+        m_slots[ix].next_free = m_first_free;
+        m_first_free = ix;
+    }
+
+    void trace(JSTracer* trc) {
+        for (const Slot& slot : m_slots) {
+            if (slot.location)
+                slot.trace(trc, slot.location);
+        }
+    }
+};
+
+#endif  // GJS_ROOT_SET_H_
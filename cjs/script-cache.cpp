@@ -0,0 +1,339 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+#include <string.h>  // for memcmp, memcpy, strlen
+#include <sys/stat.h>  // for S_ISREG
+
+#include <mutex>
+#include <string>  // for string, u16string
+#include <unordered_map>
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+#include <glib/gstdio.h>  // for g_stat, g_unlink
+
+#include <js/BuildId.h>
+#include <js/CompilationAndEvaluation.h>
+#include <js/CompileOptions.h>
+#include <js/RootingAPI.h>
+#include <js/SourceText.h>
+#include <js/Transcoding.h>
+#include <js/TypeDecls.h>
+#include <jsapi.h>  // for JS_ClearPendingException, JS_GetImplementationVersion
+#include <mozilla/Range.h>
+#include <mozilla/Utf8.h>  // for Utf8Unit
+
+#include "cjs/jsapi-util.h"
+#include "cjs/script-cache.h"
+#include "util/log.h"
+
+static bool s_disabled = false;
+static bool s_utf16_sources = false;
+static bool s_build_id_set = false;
+
+void gjs_script_cache_disable(void) {
+    s_disabled = true;
+    s_utf16_sources = true;
+}
+
+// The XDR encoding is only valid for the exact engine build that produced it
+static bool get_build_id(JS::BuildIdCharVector* build_id) {
+    const char* parts[] = {PACKAGE_STRING, "/", JS_GetImplementationVersion()};
+    for (const char* part : parts) {
+        if (!build_id->append(part, strlen(part)))
+            return false;
+    }
+    return true;
+}
+
+// Precedes the XDR-encoded script in each cache file; its size keeps the
+// encoding 8-byte aligned, as SpiderMonkey requires when decoding
+struct CacheHeader {
+    char magic[4];
+    uint32_t scope;
+    // Of the source file, in seconds since the epoch; 0 for resources
+    int64_t mtime;
+    uint8_t source_hash[32];
+};
+static_assert(sizeof(CacheHeader) % 8 == 0, "misaligned bytecode");
+static constexpr char CACHE_MAGIC[4] = {'C', 'J', 'S', 'B'};
+
+// Scripts evaluated from strings rather than files, such as with `gjs -c`,
+// have no file to check the cache entry against, so they are not cached.
+// Otherwise, returns the name to key the cache entry on, and sets the file's
+// modification time.
+[[nodiscard]] static char* cache_name(const char* filename, int64_t* mtime) {
+    if (s_disabled || !filename)
+        return nullptr;
+
+    static const bool env_disabled = !!g_getenv("GJS_DISABLE_BYTECODE_CACHE");
+    if (env_disabled)
+        return nullptr;
+
+    if (g_str_has_prefix(filename, "resource://")) {
+        *mtime = 0;
+        return g_strdup(filename);
+    }
+
+    GStatBuf buf;
+    if (g_stat(filename, &buf) != 0 || !S_ISREG(buf.st_mode))
+        return nullptr;
+    *mtime = buf.st_mtime;
+    return g_canonicalize_filename(filename, nullptr);
+}
+
+template <typename Unit>
+static void hash_source(const JS::SourceText<Unit>& source, uint8_t* digest) {
+    GjsAutoPointer<GChecksum, GChecksum, g_checksum_free> checksum =
+        g_checksum_new(G_CHECKSUM_SHA256);
+    g_checksum_update(checksum,
+                      reinterpret_cast<const uint8_t*>(source.get()),
+                      source.length() * sizeof(Unit));
+    size_t length = sizeof(CacheHeader::source_hash);
+    g_checksum_get_digest(checksum, digest, &length);
+}
+
+[[nodiscard]] static char* cache_path(const char* name, uint32_t scope) {
+    GjsAutoPointer<GChecksum, GChecksum, g_checksum_free> checksum =
+        g_checksum_new(G_CHECKSUM_SHA256);
+    g_checksum_update(checksum, reinterpret_cast<const uint8_t*>(name),
+                      strlen(name));
+    g_checksum_update(checksum, reinterpret_cast<const uint8_t*>(&scope),
+                      sizeof(scope));
+
+    return g_build_filename(g_get_user_cache_dir(), "cjs", "bytecode",
+                            g_checksum_get_string(checksum), nullptr);
+}
+
+using GjsAutoBytes = GjsAutoPointer<GBytes, GBytes, g_bytes_unref, g_bytes_ref>;
+
+// Encoded scripts, including their header, that this process already compiled
+// or read from the disk, keyed by cache path. Every context in the process
+// decodes its own copy of a script from the same bytes, so processes that run
+// several contexts neither compile a file again nor read it back from the disk.
+static std::mutex s_memory_cache_lock;
+static std::unordered_map<std::string, GjsAutoBytes> s_memory_cache;
+static size_t s_memory_cache_size = 0;
+static constexpr size_t MEMORY_CACHE_MAX_SIZE = 32 * 1024 * 1024;
+
+[[nodiscard]] static GBytes* memory_cache_lookup(const char* path) {
+    std::lock_guard<std::mutex> lock(s_memory_cache_lock);
+    auto entry = s_memory_cache.find(path);
+    if (entry == s_memory_cache.end())
+        return nullptr;
+    return entry->second.copy();
+}
+
+static void memory_cache_insert(const char* path, GBytes* contents) {
+    std::lock_guard<std::mutex> lock(s_memory_cache_lock);
+    size_t length = g_bytes_get_size(contents);
+    GjsAutoBytes& slot = s_memory_cache[path];
+    size_t old_length = slot ? g_bytes_get_size(slot) : 0;
+    if (s_memory_cache_size - old_length + length > MEMORY_CACHE_MAX_SIZE) {
+        if (!slot)
+            s_memory_cache.erase(path);
+        return;
+    }
+    s_memory_cache_size += length - old_length;
+    slot = g_bytes_ref(contents);
+}
+
+// Returns null without an exception pending if @contents is out of date or
+// can't be decoded; in the second case, @invalid is set.
+[[nodiscard]] static JSScript* decode_bytes(
+    JSContext* cx, const JS::ReadOnlyCompileOptions& options, GBytes* contents,
+    const CacheHeader& expected, bool* invalid) {
+    size_t length;
+    const void* data = g_bytes_get_data(contents, &length);
+    *invalid = false;
+
+    // Edited since it was cached; it will be cached again after compiling
+    if (length <= sizeof(CacheHeader) ||
+        memcmp(data, &expected, sizeof(CacheHeader)) != 0)
+        return nullptr;
+
+    // The bytes are never written to; DecodeScript() takes a mutable range
+    // but only reads from it
+    JS::RootedScript script(cx);
+    JS::TranscodeRange range(
+        const_cast<uint8_t*>(static_cast<const uint8_t*>(data)) +
+            sizeof(CacheHeader),
+        length - sizeof(CacheHeader));
+    JS::TranscodeResult result = JS::DecodeScript(cx, options, range, &script);
+    if (result == JS::TranscodeResult_Ok)
+        return script;
+
+    // From another engine build, or corrupt
+    gjs_debug(GJS_DEBUG_CONTEXT, "Discarding cached bytecode for %s: %d",
+              options.filename(), result);
+    if (result & JS::TranscodeResult_Throw)
+        JS_ClearPendingException(cx);
+    *invalid = true;
+    return nullptr;
+}
+
+[[nodiscard]] static JSScript* decode(JSContext* cx,
+                                      const JS::ReadOnlyCompileOptions& options,
+                                      const char* path,
+                                      const CacheHeader& expected) {
+    bool invalid;
+    GjsAutoBytes cached = memory_cache_lookup(path);
+    if (cached) {
+        JSScript* script = decode_bytes(cx, options, cached, expected, &invalid);
+        if (script)
+            return script;
+    }
+
+    char* contents;
+    size_t length;
+    if (!g_file_get_contents(path, &contents, &length, nullptr))
+        return nullptr;
+    GjsAutoBytes bytes = g_bytes_new_take(contents, length);
+
+    JSScript* script = decode_bytes(cx, options, bytes, expected, &invalid);
+    if (script)
+        memory_cache_insert(path, bytes);
+    else if (invalid)
+        g_unlink(path);
+    return script;
+}
+
+struct CacheWrite {
+    GjsAutoChar path;
+    GBytes* contents;
+};
+
+static void cache_write_free(void* data) {
+    auto* write = static_cast<CacheWrite*>(data);
+    g_bytes_unref(write->contents);
+    delete write;
+}
+
+static void cache_write_thread(GTask*, void*, void* data, GCancellable*) {
+    auto* write = static_cast<CacheWrite*>(data);
+    GjsAutoChar dir = g_path_get_dirname(write->path);
+    size_t length;
+    const void* contents = g_bytes_get_data(write->contents, &length);
+    GError* error = nullptr;
+
+    // The file is replaced atomically, so a process exiting before the write
+    // finishes doesn't leave a truncated file behind
+    if (g_mkdir_with_parents(dir, 0755) != 0 ||
+        !g_file_set_contents(write->path, static_cast<const char*>(contents),
+                             length, &error)) {
+        gjs_debug(GJS_DEBUG_CONTEXT, "Could not cache bytecode in %s: %s",
+                  write->path.get(), error ? error->message : g_strerror(errno));
+        g_clear_error(&error);
+    }
+}
+
+// Encodes @script on the calling thread, which has to be the one that owns the
+// JSContext, and writes it out in a worker thread
+static void encode(JSContext* cx, JS::HandleScript script, const char* path,
+                   const CacheHeader& header) {
+    JS::TranscodeBuffer buffer;
+    if (!buffer.append(reinterpret_cast<const uint8_t*>(&header),
+                       sizeof(CacheHeader)))
+        return;
+
+    JS::TranscodeResult result = JS::EncodeScript(cx, buffer, script);
+    if (result != JS::TranscodeResult_Ok) {
+        if (result & JS::TranscodeResult_Throw)
+            JS_ClearPendingException(cx);
+        return;
+    }
+
+    auto* write = new CacheWrite;
+    write->path = g_strdup(path);
+    write->contents = g_bytes_new(buffer.begin(), buffer.length());
+    memory_cache_insert(path, write->contents);
+
+    GjsAutoUnref<GTask> task = g_task_new(nullptr, nullptr, nullptr, nullptr);
+    g_task_set_task_data(task, write, cache_write_free);
+    g_task_run_in_thread(task, cache_write_thread);
+}
+
+template <typename Unit>
+JSScript* gjs_script_cache_compile(JSContext* cx,
+                                   const JS::ReadOnlyCompileOptions& options,
+                                   JS::SourceText<Unit>& source,
+                                   bool non_syntactic) {
+    CacheHeader header = {};
+    GjsAutoChar path;
+    GjsAutoChar name = cache_name(options.filename(), &header.mtime);
+    if (name) {
+        if (!s_build_id_set) {
+            JS::SetProcessBuildIdOp(get_build_id);
+            s_build_id_set = true;
+        }
+
+        memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.scope = non_syntactic;
+        hash_source(source, header.source_hash);
+        path = cache_path(name, header.scope);
+
+        JSScript* script = decode(cx, options, path, header);
+        if (script)
+            return script;
+    }
+
+    JS::RootedScript script(
+        cx, non_syntactic ? JS::CompileForNonSyntacticScope(cx, options, source)
+                          : JS::Compile(cx, options, source));
+    if (script && path)
+        encode(cx, script, path, header);
+    return script;
+}
+
+template JSScript* gjs_script_cache_compile(
+    JSContext*, const JS::ReadOnlyCompileOptions&,
+    JS::SourceText<mozilla::Utf8Unit>&, bool);
+template JSScript* gjs_script_cache_compile(JSContext*,
+                                            const JS::ReadOnlyCompileOptions&,
+                                            JS::SourceText<char16_t>&, bool);
+
+JSScript* gjs_script_cache_compile_utf8(JSContext* cx,
+                                        const JS::ReadOnlyCompileOptions& options,
+                                        const char* script, size_t script_len,
+                                        bool non_syntactic) {
+    if (s_utf16_sources) {
+        std::u16string utf16_string =
+            gjs_utf8_script_to_utf16(script, script_len);
+        JS::SourceText<char16_t> buf;
+        if (!buf.init(cx, utf16_string.c_str(), utf16_string.size(),
+                      JS::SourceOwnership::Borrowed))
+            return nullptr;
+        return gjs_script_cache_compile(cx, options, buf, non_syntactic);
+    }
+
+    JS::SourceText<mozilla::Utf8Unit> buf;
+    if (!buf.init(cx, script, script_len, JS::SourceOwnership::Borrowed))
+        return nullptr;
+    return gjs_script_cache_compile(cx, options, buf, non_syntactic);
+}
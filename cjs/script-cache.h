@@ -0,0 +1,70 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_SCRIPT_CACHE_H_
+#define GJS_SCRIPT_CACHE_H_
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+
+#include <js/CompileOptions.h>
+#include <js/SourceText.h>
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+// Cache of compiled scripts, encoded with SpiderMonkey's XDR format under
+// $XDG_CACHE_HOME/cjs/bytecode, so that later runs can decode them instead of
+// parsing them again. There is one entry per file, checked against the file's
+// modification time and a hash of the source, so an edited script never picks
+// up stale bytecode. The encoding embeds the build ID of the engine, so an
+// upgrade invalidates it as well. Entries are written from a worker thread,
+// and kept in memory as well, so that other contexts in the same process
+// decode them without going to the disk.
+//
+// Scripts and modules loaded from files or resources are cached. Set
+// GJS_DISABLE_BYTECODE_CACHE to turn it off.
+
+// Called when code coverage is enabled, since coverage needs scripts to be
+// compiled from source, and from UTF-16; see
+// https://bugzilla.mozilla.org/show_bug.cgi?id=1404784
+void gjs_script_cache_disable(void);
+
+// Compiles @source, or decodes it if it was cached; if @non_syntactic is set,
+// it is compiled to run with JS_ExecuteScript() in a non-syntactic scope.
+template <typename Unit>
+GJS_JSAPI_RETURN_CONVENTION JSScript* gjs_script_cache_compile(
+    JSContext* cx, const JS::ReadOnlyCompileOptions& options,
+    JS::SourceText<Unit>& source, bool non_syntactic);
+
+// Same, for @script_len bytes of UTF-8 source that the engine reads in place,
+// without a copy, such as a mapped file. @script only has to stay alive
+// during the call.
+GJS_JSAPI_RETURN_CONVENTION
+JSScript* gjs_script_cache_compile_utf8(JSContext* cx,
+                                        const JS::ReadOnlyCompileOptions& options,
+                                        const char* script, size_t script_len,
+                                        bool non_syntactic);
+
+#endif  // GJS_SCRIPT_CACHE_H_
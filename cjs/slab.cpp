@@ -0,0 +1,58 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+
+#include <glib.h>
+
+#include "cjs/slab.h"
+
+GjsSlab::~GjsSlab() {
+    while (m_chunk) {
+        Chunk* prev = m_chunk->prev;
+        g_free(m_chunk);
+        m_chunk = prev;
+    }
+}
+
+void* GjsSlab::alloc_slow(size_t size_class) {
+    size_t size = (size_class + 1) * GRANULE;
+    g_assert(size <= MAX_SIZE);
+
+    // Carve blocks out of the newest chunk until it is full; whatever is left
+    // at the end of it is too small for the block and goes unused
+    if (m_chunk_used + size > CHUNK_SIZE) {
+        auto* chunk =
+            static_cast<Chunk*>(g_malloc0(sizeof(Chunk) + CHUNK_SIZE));
+        chunk->prev = m_chunk;
+        m_chunk = chunk;
+        m_chunk_used = 0;
+    }
+
+    void* retval = m_chunk->data() + m_chunk_used;
+    m_chunk_used += size;
+    return retval;
+}
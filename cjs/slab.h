@@ -0,0 +1,98 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef GJS_SLAB_H_
+#define GJS_SLAB_H_
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t, max_align_t
+#include <string.h>  // for memset
+
+// Pools of small blocks, for the C memory of structs that boxed wrappers
+// allocate themselves, such as Graphene.Point or Gdk.Rectangle. These are
+// created and garbage collected by the tens of thousands, so freed blocks are
+// kept on a free list for their size class and reused, instead of going back
+// to the system allocator each time.
+//
+// Blocks are only released when the pool is destroyed, together with the
+// context; all the wrappers that use it have been finalized by then.
+class GjsSlab {
+    static constexpr size_t GRANULE = alignof(max_align_t);
+    static constexpr size_t N_CLASSES = 4;
+
+ public:
+    static constexpr size_t MAX_SIZE = GRANULE * N_CLASSES;
+
+ private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+    struct alignas(max_align_t) Chunk {
+        Chunk* prev;
+
+        [[nodiscard]] char* data() { return reinterpret_cast<char*>(this + 1); }
+    };
+
+    static constexpr size_t CHUNK_SIZE = 4096 - sizeof(Chunk);
+
+    FreeBlock* m_free[N_CLASSES] = {};
+    Chunk* m_chunk = nullptr;
+    size_t m_chunk_used = CHUNK_SIZE;
+
+    [[nodiscard]] static constexpr size_t size_class(size_t size) {
+        return (size + GRANULE - 1) / GRANULE - 1;
+    }
+
+    [[nodiscard]] void* alloc_slow(size_t size_class);
+
+ public:
+    GjsSlab() = default;
+    ~GjsSlab();
+    GjsSlab(const GjsSlab&) = delete;
+    GjsSlab& operator=(const GjsSlab&) = delete;
+
+    // Returns zero-filled memory aligned for any type; @size must be between 1
+    // and MAX_SIZE
+    [[nodiscard]] void* alloc0(size_t size) {
+        size_t ix = size_class(size);
+        FreeBlock* block = m_free[ix];
+        if (!block)
+            return alloc_slow(ix);
+
+        m_free[ix] = block->next;
+        memset(block, 0, (ix + 1) * GRANULE);
+        return block;
+    }
+
+    // @size must be the same that was passed to alloc0()
+    void free(void* ptr, size_t size) {
+        auto* block = static_cast<FreeBlock*>(ptr);
+        size_t ix = size_class(size);
+        block->next = m_free[ix];
+        m_free[ix] = block;
+    }
+};
+
+#endif  // GJS_SLAB_H_
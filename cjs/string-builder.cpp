@@ -0,0 +1,237 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <string>
+
+#include <girepository.h>
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/Class.h>
+#include <js/Conversions.h>  // for ToString
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
+#include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <jsapi.h>  // for JS_GetInstancePrivate, JS_NewStringCopyN, ...
+
+#include "gi/boxed.h"
+#include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "cjs/string-builder.h"
+#include "cjs/text-encoding.h"
+
+/* StringBuilder collects appended strings into one growable buffer, and only
+ * creates a JS string or GBytes from it when asked. The buffer holds Latin-1
+ * characters until a string with two-byte characters is appended, as
+ * SpiderMonkey's own string buffers do. */
+
+class GjsStringBuilder {
+    std::string m_latin1;
+    std::u16string m_two_byte;
+    bool m_is_two_byte = false;
+
+    void inflate() {
+        m_two_byte.reserve(m_latin1.capacity());
+        for (char c : m_latin1)
+            m_two_byte.push_back(static_cast<unsigned char>(c));
+        std::string().swap(m_latin1);
+        m_is_two_byte = true;
+    }
+
+ public:
+    [[nodiscard]] size_t length() const {
+        return m_is_two_byte ? m_two_byte.length() : m_latin1.length();
+    }
+
+    void reserve(size_t capacity) {
+        if (m_is_two_byte)
+            m_two_byte.reserve(capacity);
+        else
+            m_latin1.reserve(capacity);
+    }
+
+    void clear() {
+        m_latin1.clear();
+        m_two_byte.clear();
+        m_is_two_byte = false;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool append(JSContext* cx, JSString* str) {
+        size_t len = JS_GetStringLength(str);
+        if (len == 0)
+            return true;
+
+        JSLinearString* linear = JS_EnsureLinearString(cx, str);
+        if (!linear)
+            return false;
+
+        JS::AutoCheckCannotGC nogc;
+        if (JS_StringHasLatin1Chars(str)) {
+            // Unsigned, so that characters from U+0080 to U+00FF are not
+            // sign-extended when widened
+            const JS::Latin1Char* chars =
+                JS_GetLatin1LinearStringChars(nogc, linear);
+            if (m_is_two_byte)
+                m_two_byte.append(chars, chars + len);
+            else
+                m_latin1.append(reinterpret_cast<const char*>(chars), len);
+            return true;
+        }
+
+        if (!m_is_two_byte)
+            inflate();
+        m_two_byte.append(JS_GetTwoByteLinearStringChars(nogc, linear), len);
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    JSString* to_string(JSContext* cx) const {
+        if (m_is_two_byte)
+            return JS_NewUCStringCopyN(cx, m_two_byte.data(),
+                                       m_two_byte.length());
+        return JS_NewStringCopyN(cx, m_latin1.data(), m_latin1.length());
+    }
+
+    [[nodiscard]] GBytes* to_bytes() const {
+        if (m_is_two_byte)
+            return gjs_utf8_encode_bytes(m_two_byte.data(),
+                                         m_two_byte.length());
+        return gjs_utf8_encode_bytes(
+            reinterpret_cast<const JS::Latin1Char*>(m_latin1.data()),
+            m_latin1.length());
+    }
+};
+
+[[nodiscard]] static JSObject* gjs_string_builder_get_proto(JSContext*);
+
+GJS_DEFINE_PROTO("StringBuilder", string_builder, JSCLASS_BACKGROUND_FINALIZE)
+GJS_DEFINE_PRIV_FROM_JS(GjsStringBuilder, gjs_string_builder_class)
+
+GJS_NATIVE_CONSTRUCTOR_DECLARE(string_builder) {
+    GJS_NATIVE_CONSTRUCTOR_VARIABLES(string_builder)
+    GJS_NATIVE_CONSTRUCTOR_PRELUDE(string_builder);
+
+    uint32_t capacity = 0;
+    if (!gjs_parse_call_args(context, "StringBuilder", argv, "|u", "capacity",
+                             &capacity))
+        return false;
+
+    auto* priv = new GjsStringBuilder();
+    priv->reserve(capacity);
+    JS_SetPrivate(object, priv);
+
+    GJS_NATIVE_CONSTRUCTOR_FINISH(string_builder);
+    return true;
+}
+
+static void gjs_string_builder_finalize(JSFreeOp*, JSObject* obj) {
+    delete static_cast<GjsStringBuilder*>(JS_GetPrivate(obj));
+    JS_SetPrivate(obj, nullptr);
+}
+
+// append(...values) -> this
+GJS_JSAPI_RETURN_CONVENTION
+static bool append_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsStringBuilder, priv);
+
+    JS::RootedString str(cx);
+    for (unsigned ix = 0; ix < args.length(); ix++) {
+        str = JS::ToString(cx, args[ix]);
+        if (!str || !priv->append(cx, str))
+            return false;
+    }
+
+    args.rval().setObject(*obj);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool clear_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsStringBuilder, priv);
+    priv->clear();
+    args.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool to_string_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsStringBuilder, priv);
+    JSString* str = priv->to_string(cx);
+    if (!str)
+        return false;
+    args.rval().setString(str);
+    return true;
+}
+
+// toGBytes() -> GLib.Bytes with the contents encoded as UTF-8
+GJS_JSAPI_RETURN_CONVENTION
+static bool to_gbytes_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsStringBuilder, priv);
+
+    g_irepository_require(nullptr, "GLib", "2.0", GIRepositoryLoadFlags(0),
+                          nullptr);
+    GjsAutoBaseInfo gbytes_info =
+        g_irepository_find_by_gtype(nullptr, G_TYPE_BYTES);
+    GBytes* bytes = priv->to_bytes();
+    JSObject* bytes_obj =
+        BoxedInstance::new_for_c_struct(cx, gbytes_info, bytes);
+    g_bytes_unref(bytes);
+    if (!bytes_obj)
+        return false;
+
+    args.rval().setObject(*bytes_obj);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool get_length_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsStringBuilder, priv);
+    args.rval().setNumber(double(priv->length()));
+    return true;
+}
+
+// clang-format off
+JSPropertySpec gjs_string_builder_proto_props[] = {
+    JS_PSG("length", get_length_func, JSPROP_PERMANENT),
+    JS_STRING_SYM_PS(toStringTag, "StringBuilder", JSPROP_READONLY),
+    JS_PS_END};
+// clang-format on
+
+JSFunctionSpec gjs_string_builder_proto_funcs[] = {
+    JS_FN("append", append_func, 1, 0),
+    JS_FN("clear", clear_func, 0, 0),
+    JS_FN("toGBytes", to_gbytes_func, 0, 0),
+    JS_FN("toString", to_string_func, 0, 0),
+    JS_FS_END};
+
+JSFunctionSpec gjs_string_builder_static_funcs[] = {JS_FS_END};
@@ -0,0 +1,92 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+#include <string.h>  // for memcmp, memcpy, strnlen
+
+#include <js/RootingAPI.h>
+#include <js/TracingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <jsapi.h>  // for JS_AtomizeStringN
+
+#include "cjs/jsapi-util.h"
+#include "cjs/string-cache.h"
+
+bool GjsStringCache::get(JSContext* cx, const char* utf8_string,
+                         JS::MutableHandleValue value_p) {
+    size_t length = strnlen(utf8_string, MAX_LENGTH + 1);
+    if (length > MAX_LENGTH)
+        return gjs_string_from_utf8(cx, utf8_string, value_p);
+
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    bool is_ascii = true;
+    for (size_t ix = 0; ix < length; ix++) {
+        auto c = static_cast<unsigned char>(utf8_string[ix]);
+        is_ascii = is_ascii && c < 0x80;
+        hash = (hash ^ c) * 16777619u;
+    }
+
+    Slot& slot = m_slots[hash % N_SLOTS];
+    if (slot.str && slot.hash == hash && slot.length == length &&
+        memcmp(slot.chars, utf8_string, length) == 0) {
+        value_p.setString(slot.str);
+        return true;
+    }
+
+    JSString* str;
+    if (is_ascii) {
+        // ASCII is also Latin-1, so the string can be atomized directly
+        str = JS_AtomizeStringN(cx, utf8_string, length);
+    } else {
+        if (!gjs_string_from_utf8_n(cx, utf8_string, length, value_p))
+            return false;
+        str = value_p.toString();
+    }
+    if (!str)
+        return false;
+
+    slot.str = str;
+    slot.hash = hash;
+    slot.length = length;
+    memcpy(slot.chars, utf8_string, length);
+
+    value_p.setString(str);
+    return true;
+}
+
+void GjsStringCache::trace(JSTracer* trc) {
+    for (Slot& slot : m_slots) {
+        if (slot.str)
+            JS::TraceEdge(trc, &slot.str, "GjsStringCache entry");
+    }
+}
+
+void GjsStringCache::clear() {
+    for (Slot& slot : m_slots)
+        slot.str = nullptr;
+}
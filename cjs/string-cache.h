@@ -0,0 +1,71 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_STRING_CACHE_H_
+#define GJS_STRING_CACHE_H_
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+class JSTracer;
+
+// Small cache of JS strings for short UTF-8 strings returned (transfer none)
+// from introspected functions. Getters such as get_name() or g_type_name()
+// return the same long-lived strings over and over, and would otherwise create
+// a new JSString, decoding the UTF-8, every time.
+//
+// The cache is direct-mapped on a hash of the string's contents, and an entry
+// is only reused if the contents match exactly. The C pointer is never used as
+// a key, so a freed and reused pointer cannot produce a stale result.
+class GjsStringCache {
+    static constexpr size_t N_SLOTS = 128;
+    static constexpr size_t MAX_LENGTH = 63;
+
+    struct Slot {
+        JS::Heap<JSString*> str;
+        uint32_t hash;
+        uint8_t length;
+        char chars[MAX_LENGTH];
+    };
+
+    Slot m_slots[N_SLOTS] = {};
+
+ public:
+    // Sets @value_p to a string with the contents of @utf8_string, which must
+    // not be null
+    GJS_JSAPI_RETURN_CONVENTION
+    bool get(JSContext* cx, const char* utf8_string,
+             JS::MutableHandleValue value_p);
+
+    void trace(JSTracer* trc);
+    void clear();
+};
+
+#endif  // GJS_STRING_CACHE_H_
@@ -0,0 +1,701 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+#include <string.h>  // for memcpy, strcmp
+
+#include <type_traits>  // for is_same_v
+#include <utility>  // for move
+
+#include <glib.h>
+
+#include <js/Array.h>  // for NewArrayObject
+#include <js/ArrayBuffer.h>
+#include <js/CallArgs.h>
+#include <js/Conversions.h>  // for ToString
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars, js_pod_malloc
+#include <js/ValueArray.h>
+#include <jsapi.h>  // for JS_NewUCString, JS_NewLatin1String, ...
+#include <jsfriendapi.h>  // for GetArrayBufferViewLengthAndData, ...
+
+#include "cjs/byteArray.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/text-encoding.h"
+
+static constexpr char16_t REPLACEMENT_CHARACTER = 0xfffd;
+
+// These scan a machine word at a time; compilers turn the loops into vector
+// code where it helps, so there's no need for per-architecture kernels
+template <typename CharT>
+[[nodiscard]] static size_t ascii_prefix_length(const CharT* chars,
+                                                size_t len) {
+    static_assert(sizeof(CharT) == 1 || sizeof(CharT) == 2);
+    constexpr uint64_t mask = sizeof(CharT) == 1 ? UINT64_C(0x8080808080808080)
+                                                 : UINT64_C(0xff80ff80ff80ff80);
+    constexpr size_t per_word = sizeof(uint64_t) / sizeof(CharT);
+
+    size_t ix = 0;
+    for (; ix + per_word <= len; ix += per_word) {
+        uint64_t word;
+        memcpy(&word, chars + ix, sizeof(word));
+        if (word & mask)
+            break;
+    }
+    while (ix < len && chars[ix] < 0x80)
+        ix++;
+    return ix;
+}
+
+[[nodiscard]] static bool is_high_surrogate(uint32_t c) {
+    return c >= 0xd800 && c <= 0xdbff;
+}
+
+[[nodiscard]] static bool is_low_surrogate(uint32_t c) {
+    return c >= 0xdc00 && c <= 0xdfff;
+}
+
+// Returns the code point starting at @chars[@ix], with lone surrogates
+// replaced, and sets @units to the number of code units it takes
+template <typename CharT>
+[[nodiscard]] static uint32_t next_code_point(const CharT* chars, size_t len,
+                                              size_t ix, size_t* units) {
+    uint32_t c = chars[ix];
+    *units = 1;
+    if constexpr (std::is_same_v<CharT, char16_t>) {
+        if (is_high_surrogate(c) && ix + 1 < len &&
+            is_low_surrogate(chars[ix + 1])) {
+            *units = 2;
+            return 0x10000 + ((c - 0xd800) << 10) + (chars[ix + 1] - 0xdc00);
+        }
+        if (is_high_surrogate(c) || is_low_surrogate(c))
+            return REPLACEMENT_CHARACTER;
+    }
+    return c;
+}
+
+[[nodiscard]] static size_t utf8_length(uint32_t c) {
+    return c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+}
+
+template <typename CharT>
+[[nodiscard]] static size_t utf8_encoded_length(const CharT* chars,
+                                                size_t len) {
+    size_t total = 0;
+    for (size_t ix = 0; ix < len;) {
+        size_t ascii = ascii_prefix_length(chars + ix, len - ix);
+        total += ascii;
+        ix += ascii;
+        if (ix == len)
+            break;
+
+        size_t units;
+        total += utf8_length(next_code_point(chars, len, ix, &units));
+        ix += units;
+    }
+    return total;
+}
+
+// Encodes as many whole code points of @chars as fit into @dest. Returns the
+// number of bytes written, and sets @read to the number of code units used.
+template <typename CharT>
+static size_t utf8_encode(const CharT* chars, size_t len, uint8_t* dest,
+                          size_t dest_len, size_t* read) {
+    size_t in = 0, out = 0;
+    while (in < len) {
+        size_t ascii =
+            ascii_prefix_length(chars + in, MIN(len - in, dest_len - out));
+        if constexpr (sizeof(CharT) == 1) {
+            memcpy(dest + out, chars + in, ascii);
+        } else {
+            for (size_t ix = 0; ix < ascii; ix++)
+                dest[out + ix] = static_cast<uint8_t>(chars[in + ix]);
+        }
+        in += ascii;
+        out += ascii;
+        if (in == len || out == dest_len)
+            break;
+
+        size_t units;
+        uint32_t c = next_code_point(chars, len, in, &units);
+        size_t n = utf8_length(c);
+        if (out + n > dest_len)
+            break;
+
+        if (n == 2) {
+            dest[out] = 0xc0 | (c >> 6);
+        } else if (n == 3) {
+            dest[out] = 0xe0 | (c >> 12);
+            dest[out + 1] = 0x80 | ((c >> 6) & 0x3f);
+        } else {
+            dest[out] = 0xf0 | (c >> 18);
+            dest[out + 1] = 0x80 | ((c >> 12) & 0x3f);
+            dest[out + 2] = 0x80 | ((c >> 6) & 0x3f);
+        }
+        dest[out + n - 1] = 0x80 | (c & 0x3f);
+        in += units;
+        out += n;
+    }
+    *read = in;
+    return out;
+}
+
+template <typename CharT>
+[[nodiscard]] static GBytes* utf8_encode_bytes(const CharT* chars,
+                                               size_t len) {
+    size_t nbytes = utf8_encoded_length(chars, len);
+    auto* data = static_cast<uint8_t*>(g_malloc(nbytes));
+    size_t read;
+    utf8_encode(chars, len, data, nbytes, &read);
+    return g_bytes_new_take(data, nbytes);
+}
+
+GBytes* gjs_utf8_encode_bytes(const JS::Latin1Char* chars, size_t len) {
+    return utf8_encode_bytes(chars, len);
+}
+
+GBytes* gjs_utf8_encode_bytes(const char16_t* chars, size_t len) {
+    return utf8_encode_bytes(chars, len);
+}
+
+// encode(string) -> Uint8Array, always UTF-8
+GJS_JSAPI_RETURN_CONVENTION
+static bool encode_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!args.requireAtLeast(cx, "encode", 1))
+        return false;
+
+    JS::RootedString str(cx, JS::ToString(cx, args[0]));
+    if (!str)
+        return false;
+
+    JS::RootedObject buffer(cx);
+    size_t len = JS_GetStringLength(str);
+    if (len == 0) {
+        buffer = JS::NewArrayBuffer(cx, 0);
+    } else {
+        JSLinearString* linear = JS_EnsureLinearString(cx, str);
+        if (!linear)
+            return false;
+
+        size_t nbytes;
+        uint8_t* data;
+        {
+            JS::AutoCheckCannotGC nogc;
+            if (JS_StringHasLatin1Chars(str)) {
+                const JS::Latin1Char* chars =
+                    JS_GetLatin1LinearStringChars(nogc, linear);
+                nbytes = utf8_encoded_length(chars, len);
+                data = js_pod_malloc<uint8_t>(nbytes);
+                if (data) {
+                    size_t read;
+                    utf8_encode(chars, len, data, nbytes, &read);
+                }
+            } else {
+                const char16_t* chars =
+                    JS_GetTwoByteLinearStringChars(nogc, linear);
+                nbytes = utf8_encoded_length(chars, len);
+                data = js_pod_malloc<uint8_t>(nbytes);
+                if (data) {
+                    size_t read;
+                    utf8_encode(chars, len, data, nbytes, &read);
+                }
+            }
+        }
+        if (!data) {
+            JS_ReportOutOfMemory(cx);
+            return false;
+        }
+
+        buffer = JS::NewArrayBufferWithContents(cx, nbytes, data);
+        if (!buffer)
+            js_free(data);
+    }
+    if (!buffer)
+        return false;
+
+    JSObject* array = JS_NewUint8ArrayWithBuffer(cx, buffer, 0, -1);
+    if (!array)
+        return false;
+
+    args.rval().setObject(*array);
+    return true;
+}
+
+// encodeInto(string, uint8array) -> [read, written]
+GJS_JSAPI_RETURN_CONVENTION
+static bool encode_into_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!args.requireAtLeast(cx, "encodeInto", 2))
+        return false;
+
+    JS::RootedString str(cx, JS::ToString(cx, args[0]));
+    if (!str)
+        return false;
+
+    JS::RootedObject dest(cx, args[1].isObject() ? &args[1].toObject()
+                                                 : nullptr);
+    if (!dest || !JS_IsUint8Array(dest)) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "Destination of encodeInto() must be a Uint8Array");
+        return false;
+    }
+
+    JSLinearString* linear = JS_EnsureLinearString(cx, str);
+    if (!linear)
+        return false;
+
+    size_t len = JS_GetStringLength(str);
+    size_t read, written;
+    {
+        JS::AutoCheckCannotGC nogc;
+        uint32_t dest_len;
+        bool is_shared;
+        uint8_t* data;
+        js::GetUint8ArrayLengthAndData(dest, &dest_len, &is_shared, &data);
+
+        if (JS_StringHasLatin1Chars(str))
+            written = utf8_encode(JS_GetLatin1LinearStringChars(nogc, linear),
+                                  len, data, dest_len, &read);
+        else
+            written = utf8_encode(JS_GetTwoByteLinearStringChars(nogc, linear),
+                                  len, data, dest_len, &read);
+    }
+
+    JS::RootedValueArray<2> result(cx);
+    result[0].setNumber(double(read));
+    result[1].setNumber(double(written));
+    JSObject* array = JS::NewArrayObject(cx, result);
+    if (!array)
+        return false;
+
+    args.rval().setObject(*array);
+    return true;
+}
+
+enum class Encoding { UTF8, UTF16LE, UTF16BE };
+
+// The bytes left over from the previous call in streaming mode, followed by
+// the bytes of this call, seen as one sequence
+class ByteSource {
+    const uint8_t* m_pending;
+    size_t m_pending_len;
+    const uint8_t* m_data;
+    size_t m_len;
+
+ public:
+    ByteSource(const uint8_t* pending, size_t pending_len, const uint8_t* data,
+               size_t len)
+        : m_pending(pending),
+          m_pending_len(pending_len),
+          m_data(data),
+          m_len(len) {}
+
+    [[nodiscard]] size_t size() const { return m_pending_len + m_len; }
+    [[nodiscard]] uint8_t operator[](size_t ix) const {
+        return ix < m_pending_len ? m_pending[ix] : m_data[ix - m_pending_len];
+    }
+    // Contiguous bytes starting at @ix, from which ASCII can be copied fast
+    [[nodiscard]] const uint8_t* run(size_t ix, size_t* len) const {
+        if (ix < m_pending_len) {
+            *len = m_pending_len - ix;
+            return m_pending + ix;
+        }
+        *len = m_len - (ix - m_pending_len);
+        return m_data + (ix - m_pending_len);
+    }
+};
+
+// Decoders following the WHATWG Encoding Standard. They write at most one
+// code unit per input byte, plus one, to @out, and return false on invalid
+// input if @fatal. Unless @stream, an incomplete sequence at the end is an
+// error; otherwise its length is returned in @left_over.
+
+static bool decode_utf8(const ByteSource& src, bool fatal, bool stream,
+                        char16_t* out, size_t* out_len, size_t* left_over) {
+    size_t n = 0;
+    uint32_t code_point = 0;
+    unsigned needed = 0, seen = 0;
+    uint8_t lower = 0x80, upper = 0xbf;
+    size_t size = src.size();
+
+    for (size_t ix = 0; ix < size;) {
+        if (needed == 0) {
+            size_t run_len;
+            const uint8_t* run = src.run(ix, &run_len);
+            size_t ascii = ascii_prefix_length(run, run_len);
+            for (size_t jx = 0; jx < ascii; jx++)
+                out[n + jx] = run[jx];
+            n += ascii;
+            ix += ascii;
+            if (ix == size)
+                break;
+
+            uint8_t byte = src[ix++];
+            if (byte >= 0xc2 && byte <= 0xdf) {
+                needed = 1;
+                code_point = byte & 0x1f;
+            } else if (byte >= 0xe0 && byte <= 0xef) {
+                if (byte == 0xe0)
+                    lower = 0xa0;
+                else if (byte == 0xed)
+                    upper = 0x9f;
+                needed = 2;
+                code_point = byte & 0xf;
+            } else if (byte >= 0xf0 && byte <= 0xf4) {
+                if (byte == 0xf0)
+                    lower = 0x90;
+                else if (byte == 0xf4)
+                    upper = 0x8f;
+                needed = 3;
+                code_point = byte & 0x7;
+            } else {
+                if (fatal)
+                    return false;
+                out[n++] = REPLACEMENT_CHARACTER;
+            }
+            continue;
+        }
+
+        uint8_t byte = src[ix];
+        if (byte < lower || byte > upper) {
+            // The byte is not consumed, it may start the next sequence
+            code_point = needed = seen = 0;
+            lower = 0x80;
+            upper = 0xbf;
+            if (fatal)
+                return false;
+            out[n++] = REPLACEMENT_CHARACTER;
+            continue;
+        }
+
+        ix++;
+        lower = 0x80;
+        upper = 0xbf;
+        code_point = (code_point << 6) | (byte & 0x3f);
+        if (++seen < needed)
+            continue;
+
+        if (code_point >= 0x10000) {
+            out[n++] = 0xd800 + ((code_point - 0x10000) >> 10);
+            out[n++] = 0xdc00 + ((code_point - 0x10000) & 0x3ff);
+        } else {
+            out[n++] = code_point;
+        }
+        code_point = needed = seen = 0;
+    }
+
+    *left_over = 0;
+    if (needed != 0) {
+        if (stream) {
+            *left_over = seen + 1;
+        } else {
+            if (fatal)
+                return false;
+            out[n++] = REPLACEMENT_CHARACTER;
+        }
+    }
+    *out_len = n;
+    return true;
+}
+
+static bool decode_utf16(const ByteSource& src, bool big_endian, bool fatal,
+                         bool stream, char16_t* out, size_t* out_len,
+                         size_t* left_over) {
+    size_t n = 0;
+    char16_t lead_surrogate = 0;
+    size_t size = src.size();
+    size_t ix = 0;
+
+    for (; ix + 1 < size; ix += 2) {
+        char16_t unit = big_endian ? (src[ix] << 8) | src[ix + 1]
+                                   : src[ix] | (src[ix + 1] << 8);
+        if (lead_surrogate) {
+            char16_t lead = lead_surrogate;
+            lead_surrogate = 0;
+            if (is_low_surrogate(unit)) {
+                out[n++] = lead;
+                out[n++] = unit;
+                continue;
+            }
+            if (fatal)
+                return false;
+            out[n++] = REPLACEMENT_CHARACTER;
+        }
+        if (is_high_surrogate(unit)) {
+            lead_surrogate = unit;
+        } else if (is_low_surrogate(unit)) {
+            if (fatal)
+                return false;
+            out[n++] = REPLACEMENT_CHARACTER;
+        } else {
+            out[n++] = unit;
+        }
+    }
+
+    *left_over = 0;
+    if (lead_surrogate || ix < size) {
+        if (stream) {
+            *left_over = (lead_surrogate ? 2 : 0) + (size - ix);
+        } else {
+            if (fatal)
+                return false;
+            out[n++] = REPLACEMENT_CHARACTER;
+        }
+    }
+    *out_len = n;
+    return true;
+}
+
+// Exposes the bytes of any ArrayBuffer or ArrayBuffer view. The pointer is
+// only valid until the next GC.
+[[nodiscard]] static bool get_buffer_source_data(JSObject* obj, uint8_t** data,
+                                                 size_t* len) {
+    uint32_t length;
+    bool is_shared;
+    if (JS_IsArrayBufferViewObject(obj)) {
+        js::GetArrayBufferViewLengthAndData(obj, &length, &is_shared, data);
+    } else if (JS::IsArrayBufferObject(obj)) {
+        JS::GetArrayBufferLengthAndData(obj, &length, &is_shared, data);
+    } else {
+        return false;
+    }
+    *len = length;
+    return true;
+}
+
+[[nodiscard]] static bool parse_encoding(const char* name, Encoding* encoding) {
+    if (strcmp(name, "utf-8") == 0)
+        *encoding = Encoding::UTF8;
+    else if (strcmp(name, "utf-16le") == 0)
+        *encoding = Encoding::UTF16LE;
+    else if (strcmp(name, "utf-16be") == 0)
+        *encoding = Encoding::UTF16BE;
+    else
+        return false;
+    return true;
+}
+
+// Other encodings go through iconv, without streaming, and invalid input is
+// always an error since iconv has no replacement mode
+GJS_JSAPI_RETURN_CONVENTION
+static bool decode_with_iconv(JSContext* cx, JS::HandleObject input,
+                              const char* encoding,
+                              JS::MutableHandleValue rval) {
+    GError* error = nullptr;
+    size_t bytes_written;
+    GjsAutoChar utf16;
+    {
+        JS::AutoCheckCannotGC nogc;
+        uint8_t* data;
+        size_t len;
+        if (!get_buffer_source_data(input, &data, &len))
+            g_assert_not_reached();  // checked by the caller
+        utf16 = g_convert(reinterpret_cast<char*>(data), len,
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+                          "UTF-16LE",
+#else
+                          "UTF-16BE",
+#endif
+                          encoding, nullptr, &bytes_written, &error);
+    }
+    if (!utf16) {
+        bool unsupported = g_error_matches(error, G_CONVERT_ERROR,
+                                           G_CONVERT_ERROR_NO_CONVERSION);
+        gjs_throw_custom(cx, unsupported ? JSProto_RangeError : JSProto_TypeError,
+                         nullptr, "Cannot decode %s: %s", encoding,
+                         error->message);
+        g_error_free(error);
+        return false;
+    }
+
+    JSString* str = JS_NewUCStringCopyN(
+        cx, reinterpret_cast<char16_t*>(utf16.get()), bytes_written / 2);
+    if (!str)
+        return false;
+    rval.setString(str);
+    return true;
+}
+
+// decode(input, encoding, fatal, stream, pending) -> [string, pending]
+//
+// @input is any ArrayBuffer or view, @encoding a canonical name, and @pending
+// the incomplete sequence returned from the previous call in streaming mode,
+// or null.
+GJS_JSAPI_RETURN_CONVENTION
+static bool decode_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject input(cx), pending(cx);
+    JS::UniqueChars encoding_name;
+    bool fatal, stream;
+    if (!gjs_parse_call_args(cx, "decode", args, "osbb?o", "input", &input,
+                             "encoding", &encoding_name, "fatal", &fatal,
+                             "stream", &stream, "pending", &pending))
+        return false;
+
+    uint8_t* data;
+    size_t len;
+    if (!get_buffer_source_data(input, &data, &len)) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "Argument to decode() must be an ArrayBuffer or a "
+                         "view on one");
+        return false;
+    }
+
+    JS::RootedValueArray<2> result(cx);
+    Encoding encoding;
+    if (!parse_encoding(encoding_name.get(), &encoding)) {
+        if (stream || pending) {
+            gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                             "Streaming is not supported for %s",
+                             encoding_name.get());
+            return false;
+        }
+        if (!decode_with_iconv(cx, input, encoding_name.get(), result[0]))
+            return false;
+        result[1].setNull();
+        JSObject* array = JS::NewArrayObject(cx, result);
+        if (!array)
+            return false;
+        args.rval().setObject(*array);
+        return true;
+    }
+
+    uint8_t pending_bytes[4];
+    size_t pending_len = 0;
+    if (pending) {
+        uint8_t* pending_data;
+        if (!get_buffer_source_data(pending, &pending_data, &pending_len) ||
+            pending_len > sizeof(pending_bytes)) {
+            gjs_throw(cx, "Invalid pending bytes");
+            return false;
+        }
+        memcpy(pending_bytes, pending_data, pending_len);
+    }
+
+    JS::RootedString str(cx);
+    size_t left_over = 0;
+    uint8_t left_over_bytes[4];
+
+    // These conversions produce the string's characters directly, in a
+    // buffer handed over to the engine; the only pass over the input is the
+    // decoding itself
+    if (pending_len == 0 && encoding == Encoding::UTF8 &&
+        ascii_prefix_length(data, len) == len) {
+        if (len == 0) {
+            str = JS_GetEmptyString(cx);
+        } else {
+            JS::UniqueLatin1Chars chars(js_pod_malloc<JS::Latin1Char>(len + 1));
+            if (!chars) {
+                JS_ReportOutOfMemory(cx);
+                return false;
+            }
+            {
+                JS::AutoCheckCannotGC nogc;
+                get_buffer_source_data(input, &data, &len);
+                memcpy(chars.get(), data, len);
+            }
+            chars[len] = '\0';
+            str = JS_NewLatin1String(cx, std::move(chars), len);
+            if (!str)
+                return false;
+        }
+    } else {
+        size_t capacity = pending_len + len + 2;
+        JS::UniqueTwoByteChars chars(js_pod_malloc<char16_t>(capacity));
+        if (!chars) {
+            JS_ReportOutOfMemory(cx);
+            return false;
+        }
+
+        size_t out_len;
+        bool ok;
+        {
+            JS::AutoCheckCannotGC nogc;
+            get_buffer_source_data(input, &data, &len);
+            ByteSource src(pending_bytes, pending_len, data, len);
+            if (encoding == Encoding::UTF8)
+                ok = decode_utf8(src, fatal, stream, chars.get(), &out_len,
+                                 &left_over);
+            else
+                ok = decode_utf16(src, encoding == Encoding::UTF16BE, fatal,
+                                  stream, chars.get(), &out_len, &left_over);
+            for (size_t ix = 0; ok && ix < left_over; ix++)
+                left_over_bytes[ix] = src[src.size() - left_over + ix];
+        }
+        if (!ok) {
+            gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                             "The encoded data is not valid %s",
+                             encoding_name.get());
+            return false;
+        }
+
+        chars[out_len] = '\0';
+        if (out_len == 0)
+            str = JS_GetEmptyString(cx);
+        else if (out_len < capacity / 2)  // don't keep a mostly empty buffer
+            str = JS_NewUCStringCopyN(cx, chars.get(), out_len);
+        else
+            str = JS_NewUCString(cx, std::move(chars), out_len);
+        if (!str)
+            return false;
+    }
+
+    result[0].setString(str);
+    if (left_over > 0) {
+        JSObject* left_over_array =
+            gjs_byte_array_from_data(cx, left_over, left_over_bytes);
+        if (!left_over_array)
+            return false;
+        result[1].setObject(*left_over_array);
+    } else {
+        result[1].setNull();
+    }
+
+    JSObject* array = JS::NewArrayObject(cx, result);
+    if (!array)
+        return false;
+
+    args.rval().setObject(*array);
+    return true;
+}
+
+static JSFunctionSpec gjs_text_encoding_module_funcs[] = {
+    JS_FN("decode", decode_func, 5, 0),
+    JS_FN("encode", encode_func, 1, 0),
+    JS_FN("encodeInto", encode_into_func, 2, 0),
+    JS_FS_END};
+
+bool gjs_define_text_encoding_stuff(JSContext* cx,
+                                    JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    return module && JS_DefineFunctions(cx, module,
+                                        gjs_text_encoding_module_funcs);
+}
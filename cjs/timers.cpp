@@ -0,0 +1,326 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <math.h>  // for isnan
+#include <stdint.h>
+#include <stdlib.h>  // for exit
+
+#include <set>
+#include <utility>  // for make_pair
+#include <vector>
+
+#include <glib.h>
+
+#include <js/Array.h>  // for NewArrayObject, GetArrayLength
+#include <js/CallArgs.h>
+#include <js/Conversions.h>  // for ToNumber
+#include <js/GCVector.h>  // for RootedVector
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TracingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <js/ValueArray.h>
+#include <jsapi.h>  // for JS::Call, JS_GetElement, JS_DefineFunctions, ...
+#include <jspubtd.h>  // for JSProto_TypeError
+
+#include "cjs/context-private.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "cjs/timers.h"
+
+struct GjsTimerSource {
+    GSource base;
+    GjsTimerQueue* queue;
+};
+
+GjsTimerQueue::Schedule& GjsTimerQueue::ensure_schedule(
+    GMainContext* main_context) {
+    auto found = m_schedules.find(main_context);
+    if (found != m_schedules.end())
+        return found->second;
+
+    static GSourceFuncs source_funcs = {
+        nullptr,  // prepare; the ready time is enough
+        nullptr,  // check
+        &GjsTimerQueue::on_source_dispatch,
+        nullptr,  // finalize
+        nullptr,  // closure_callback
+        nullptr,  // closure_marshal
+    };
+    GSource* source = g_source_new(&source_funcs, sizeof(GjsTimerSource));
+    reinterpret_cast<GjsTimerSource*>(source)->queue = this;
+    g_source_set_name(source, "GJS timers");
+    // A timer callback may run a nested main loop, and the other timers must
+    // keep running in it
+    g_source_set_can_recurse(source, true);
+    g_source_attach(source, main_context);
+
+    Schedule& added = m_schedules[g_main_context_ref(main_context)];
+    added.source = source;
+    return added;
+}
+
+void GjsTimerQueue::drop_schedule(GMainContext* main_context) {
+    auto found = m_schedules.find(main_context);
+    if (found == m_schedules.end())
+        return;
+    g_source_destroy(found->second.source);
+    g_source_unref(found->second.source);
+    m_schedules.erase(found);
+    g_main_context_unref(main_context);
+}
+
+void GjsTimerQueue::schedule(uint32_t id, Timer* timer, int64_t deadline) {
+    timer->deadline = deadline;
+    ensure_schedule(timer->main_context).timers.emplace(deadline, id);
+}
+
+// The wakeup is for the first timer to expire, delayed by the slack; every
+// timer that has expired by then runs in the same wakeup
+void GjsTimerQueue::update_ready_time(GMainContext* main_context) {
+    auto found = m_schedules.find(main_context);
+    if (found == m_schedules.end())
+        return;
+    Schedule& schedule = found->second;
+    if (schedule.timers.empty()) {
+        drop_schedule(main_context);
+        return;
+    }
+    g_source_set_ready_time(schedule.source,
+                            schedule.timers.begin()->first + m_slack_usec);
+}
+
+void GjsTimerQueue::set_slack(int64_t slack_usec) {
+    m_slack_usec = slack_usec;
+    for (auto& context_and_schedule : m_schedules) {
+        // Empty only while its expired timers are running
+        const Schedule& pending = context_and_schedule.second;
+        if (!pending.timers.empty())
+            g_source_set_ready_time(
+                pending.source, pending.timers.begin()->first + m_slack_usec);
+    }
+}
+
+uint32_t GjsTimerQueue::add(JSObject* callback, JSObject* args,
+                            int64_t delay_usec, bool repeat) {
+    GMainContext* main_context = g_main_context_get_thread_default();
+    if (!main_context)
+        main_context = g_main_context_default();
+
+    uint32_t id = m_next_id++;
+    Timer& timer = m_timers[id];
+    timer.interval = delay_usec;
+    timer.repeat = repeat;
+    timer.main_context = main_context;
+    timer.callback = callback;
+    timer.args = args;
+    schedule(id, &timer, g_get_monotonic_time() + delay_usec);
+    update_ready_time(main_context);
+    return id;
+}
+
+void GjsTimerQueue::remove(uint32_t id) {
+    auto found = m_timers.find(id);
+    if (found == m_timers.end())
+        return;
+    // Not in the schedule if it is about to run, and then the schedule may even
+    // be gone
+    GMainContext* main_context = found->second.main_context;
+    auto schedule_found = m_schedules.find(main_context);
+    if (schedule_found != m_schedules.end())
+        schedule_found->second.timers.erase(
+            std::make_pair(found->second.deadline, id));
+    m_timers.erase(found);
+    update_ready_time(main_context);
+}
+
+void GjsTimerQueue::clear() {
+    while (!m_schedules.empty())
+        drop_schedule(m_schedules.begin()->first);
+    m_timers.clear();
+}
+
+void GjsTimerQueue::trace(JSTracer* trc) {
+    for (auto& id_and_timer : m_timers) {
+        Timer& timer = id_and_timer.second;
+        JS::TraceEdge(trc, &timer.callback, "timer callback");
+        JS::TraceEdge(trc, &timer.args, "timer arguments");
+    }
+}
+
+void GjsTimerQueue::run_expired(GMainContext* main_context, int64_t now) {
+    // Only the timers that are already expired are run, so that a timer
+    // scheduled by one of them with no delay waits for the next main loop
+    // iteration. The schedule is looked up again afterwards, since a nested
+    // main loop in a callback may have dropped it.
+    std::vector<uint32_t> expired;
+    {
+        auto found = m_schedules.find(main_context);
+        if (found == m_schedules.end())
+            return;
+        std::set<std::pair<int64_t, uint32_t>>& timers = found->second.timers;
+        while (!timers.empty() && timers.begin()->first <= now) {
+            expired.push_back(timers.begin()->second);
+            timers.erase(timers.begin());
+        }
+    }
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(m_cx);
+    JSAutoRealm ar(m_cx, gjs->global());
+    JS::RootedValue callback(m_cx), retval(m_cx), arg(m_cx);
+    JS::RootedObject args_array(m_cx);
+    JS::RootedValueVector args(m_cx);
+
+    for (uint32_t id : expired) {
+        // May have been cleared by an earlier timer
+        auto found = m_timers.find(id);
+        if (found == m_timers.end())
+            continue;
+
+        Timer& timer = found->second;
+        callback.setObject(*timer.callback);
+        args_array = timer.args;
+        if (timer.repeat) {
+            int64_t next = timer.deadline + timer.interval;
+            schedule(id, &timer, next > now ? next : now + timer.interval);
+        } else {
+            m_timers.erase(found);
+        }
+
+        args.clear();
+        uint32_t n_args = 0;
+        bool ok = true;
+        if (args_array) {
+            ok = JS::GetArrayLength(m_cx, args_array, &n_args) &&
+                 args.reserve(n_args);
+            for (uint32_t ix = 0; ok && ix < n_args; ix++) {
+                ok = JS_GetElement(m_cx, args_array, ix, &arg);
+                if (ok)
+                    args.infallibleAppend(arg);
+            }
+        }
+        if (ok)
+            ok = JS::Call(m_cx, JS::UndefinedHandleValue, callback, args,
+                          &retval);
+
+        if (!ok) {
+            if (!JS_IsExceptionPending(m_cx)) {
+                // Uncatchable exception: System.exit() or out of memory
+                uint8_t code;
+                if (gjs->should_exit(&code))
+                    exit(code);
+                g_error("Timer callback terminated with uncatchable exception");
+            }
+            gjs_log_exception_uncaught(m_cx);
+        }
+        gjs->schedule_gc_if_needed();
+    }
+
+    update_ready_time(main_context);
+}
+
+gboolean GjsTimerQueue::on_source_dispatch(GSource* source, GSourceFunc,
+                                           void*) {
+    GjsTimerQueue* self = reinterpret_cast<GjsTimerSource*>(source)->queue;
+    self->run_expired(g_source_get_context(source), g_source_get_time(source));
+    return G_SOURCE_CONTINUE;
+}
+
+// setTimeout(callback, delay = 0, ...args) and setInterval(), which returns an
+// ID for clearTimeout() or clearInterval()
+GJS_JSAPI_RETURN_CONVENTION
+static bool add_timer(JSContext* cx, unsigned argc, JS::Value* vp,
+                      const char* func_name, bool repeat) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!args.requireAtLeast(cx, func_name, 1))
+        return false;
+
+    if (!args[0].isObject() || !JS::IsCallable(&args[0].toObject())) {
+        gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                         "The first argument to %s() must be a function",
+                         func_name);
+        return false;
+    }
+    JS::RootedObject callback(cx, &args[0].toObject());
+
+    double delay_ms = 0;
+    if (args.length() > 1 && !JS::ToNumber(cx, args[1], &delay_ms))
+        return false;
+    if (isnan(delay_ms) || delay_ms < 0)
+        delay_ms = 0;
+    else if (delay_ms > G_MAXINT32)
+        delay_ms = G_MAXINT32;
+
+    JS::RootedObject extra_args(cx);
+    if (args.length() > 2) {
+        extra_args = JS::NewArrayObject(
+            cx, JS::HandleValueArray::subarray(args, 2, args.length() - 2));
+        if (!extra_args)
+            return false;
+    }
+
+    GjsTimerQueue& timers = GjsContextPrivate::from_cx(cx)->timers();
+    uint32_t id = timers.add(callback, extra_args, int64_t(delay_ms * 1000),
+                             repeat);
+    args.rval().setNumber(id);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool set_timeout_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    return add_timer(cx, argc, vp, "setTimeout", false);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool set_interval_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    return add_timer(cx, argc, vp, "setInterval", true);
+}
+
+// clearTimeout(id) and clearInterval(id); IDs that are not of a pending timer
+// are ignored
+GJS_JSAPI_RETURN_CONVENTION
+static bool clear_timer_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    double id = args.get(0).isNumber() ? args[0].toNumber() : 0;
+    if (id >= 1 && id <= UINT32_MAX && id == uint32_t(id))
+        GjsContextPrivate::from_cx(cx)->timers().remove(uint32_t(id));
+    args.rval().setUndefined();
+    return true;
+}
+
+// clang-format off
+static JSFunctionSpec gjs_timers_module_funcs[] = {
+    JS_FN("clearInterval", clear_timer_func, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("clearTimeout", clear_timer_func, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("setInterval", set_interval_func, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FN("setTimeout", set_timeout_func, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
+// clang-format on
+
+bool gjs_define_timers_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    return module && JS_DefineFunctions(cx, module, gjs_timers_module_funcs);
+}
@@ -0,0 +1,107 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_TIMERS_H_
+#define GJS_TIMERS_H_
+
+#include <config.h>
+
+#include <stdint.h>
+
+#include <set>
+#include <unordered_map>
+#include <utility>  // for pair
+
+#include <glib.h>
+
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+class JSTracer;
+
+// The timers of setTimeout() and setInterval(). All the timers of a context
+// that were added with the same thread-default main context share a single
+// GSource, whose ready time is that of the earliest of them, so thousands of
+// short timers don't add thousands of sources to the main context's poll list.
+// The sources can recurse, so timers still run while a timer callback iterates
+// a nested main loop.
+//
+// With some slack, timers may run that much late, so that timers expiring
+// close to each other are run together in one wakeup.
+class GjsTimerQueue {
+    struct Timer {
+        int64_t deadline;  // monotonic time, in microseconds
+        int64_t interval;
+        bool repeat;
+        GMainContext* main_context;  // owned by the schedule
+        JS::Heap<JSObject*> callback;
+        JS::Heap<JSObject*> args;  // array of extra arguments, or null
+    };
+
+    // The pending timers of one main context, and the source that runs them.
+    // Dropped, along with the reference on the main context, once empty.
+    struct Schedule {
+        GSource* source;
+        std::set<std::pair<int64_t, uint32_t>> timers;
+    };
+
+    JSContext* m_cx;
+    // Node-based, so the Heap pointers in it don't move
+    std::unordered_map<uint32_t, Timer> m_timers;
+    std::unordered_map<GMainContext*, Schedule> m_schedules;
+    int64_t m_slack_usec = 0;
+    uint32_t m_next_id = 1;
+
+    Schedule& ensure_schedule(GMainContext* main_context);
+    void drop_schedule(GMainContext* main_context);
+    void schedule(uint32_t id, Timer* timer, int64_t deadline);
+    void update_ready_time(GMainContext* main_context);
+    void run_expired(GMainContext* main_context, int64_t now);
+    static gboolean on_source_dispatch(GSource* source, GSourceFunc, void*);
+
+ public:
+    explicit GjsTimerQueue(JSContext* cx) : m_cx(cx) {}
+    ~GjsTimerQueue() { clear(); }
+    GjsTimerQueue(const GjsTimerQueue&) = delete;
+    GjsTimerQueue& operator=(const GjsTimerQueue&) = delete;
+
+    // Returns the ID of the new timer, which runs in the thread-default main
+    // context; @args may be null
+    [[nodiscard]] uint32_t add(JSObject* callback, JSObject* args,
+                               int64_t delay_usec, bool repeat);
+    void remove(uint32_t id);
+    [[nodiscard]] size_t size() const { return m_timers.size(); }
+
+    void set_slack(int64_t slack_usec);
+    [[nodiscard]] int64_t slack() const { return m_slack_usec; }
+
+    void clear();
+    void trace(JSTracer* trc);
+};
+
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_define_timers_stuff(JSContext* cx, JS::MutableHandleObject module);
+
+#endif  // GJS_TIMERS_H_
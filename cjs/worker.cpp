@@ -0,0 +1,726 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+
+#include <algorithm>  // for remove, stable_partition
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>  // for move, exchange
+#include <vector>
+
+#include <gio/gio.h>
+#include <girepository.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/Class.h>
+#include <js/PropertySpec.h>
+#include <js/Realm.h>
+#include <js/RootingAPI.h>
+#include <js/StructuredClone.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <js/ValueArray.h>
+#include <jsapi.h>  // for JS_GetPrivate, JS_SetPrivate, JS_NewPlainObject
+
+#include "cjs/byteArray.h"
+#include "cjs/context-private.h"
+#include "cjs/context.h"
+#include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "cjs/worker.h"
+#include "gi/boxed.h"
+#include "gi/wrapperutils.h"
+#include "util/log.h"
+
+namespace {
+
+// Structured clone tags for the GLib types that are passed by reference
+enum : uint32_t {
+    SCTAG_GBYTES = JS_SCTAG_USER_MIN,
+    SCTAG_GVARIANT,
+};
+
+// A GBytes or GVariant passed by reference in a message. Both are immutable
+// and atomically refcounted, so both sides can use them without copying.
+class GjsCloneRef {
+    uint32_t m_tag;
+    void* m_ptr;
+
+ public:
+    GjsCloneRef(uint32_t tag, void* ptr) : m_tag(tag), m_ptr(ptr) {
+        if (tag == SCTAG_GBYTES)
+            g_bytes_ref(static_cast<GBytes*>(ptr));
+        else
+            g_variant_ref(static_cast<GVariant*>(ptr));
+    }
+    GjsCloneRef(GjsCloneRef&& other) noexcept
+        : m_tag(other.m_tag), m_ptr(std::exchange(other.m_ptr, nullptr)) {}
+    GjsCloneRef(const GjsCloneRef&) = delete;
+    GjsCloneRef& operator=(const GjsCloneRef&) = delete;
+    ~GjsCloneRef() {
+        if (!m_ptr)
+            return;
+        if (m_tag == SCTAG_GBYTES)
+            g_bytes_unref(static_cast<GBytes*>(m_ptr));
+        else
+            g_variant_unref(static_cast<GVariant*>(m_ptr));
+    }
+
+    [[nodiscard]] uint32_t tag() const { return m_tag; }
+    [[nodiscard]] void* get() const { return m_ptr; }
+};
+
+// A message on its way between a worker and its parent. Data messages are
+// structured clones, which are not tied to either context's runtime, and own
+// the contents of any ArrayBuffers transferred with them, as well as
+// references to the GBytes and GVariants in them.
+struct GjsWorkerMessage {
+    enum Kind : uint8_t { DATA, ERROR, EXIT };
+
+    Kind kind;
+    std::unique_ptr<JSAutoStructuredCloneBuffer> data;
+    std::string error;
+    std::vector<GjsCloneRef> refs;
+};
+
+// Messages going one way between two threads. Whoever pushes the first message
+// after the queue was last emptied schedules a dispatch on the receiving
+// thread; any messages pushed before that dispatch runs go along with it.
+class GjsWorkerQueue {
+    std::mutex m_lock;
+    std::deque<GjsWorkerMessage> m_messages;
+    bool m_dispatch_pending = false;
+
+ public:
+    // Returns true if the caller has to schedule a dispatch
+    [[nodiscard]] bool push(GjsWorkerMessage&& message) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_messages.push_back(std::move(message));
+        return !std::exchange(m_dispatch_pending, true);
+    }
+
+    [[nodiscard]] std::deque<GjsWorkerMessage> take() {
+        std::deque<GjsWorkerMessage> messages;
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_dispatch_pending = false;
+        messages.swap(m_messages);
+        return messages;
+    }
+};
+
+}  // namespace
+
+// A worker runs a script in a context of its own, on its own thread with its
+// own main context. It is reference counted, since it is used from both
+// threads.
+//
+// Each side has a source that dispatches the messages sent to it. It is made
+// ready from the other thread by setting its ready time, and doesn't keep the
+// worker alive, so that the worker and the main contexts don't keep each other
+// alive.
+class GjsWorker {
+    std::atomic_int m_refcount{1};
+
+    GjsAutoChar m_filename;
+    GjsAutoStrv m_search_path;
+
+    // Used on the parent's thread only. The Worker object is rooted while the
+    // worker's thread runs, so that messages and errors can be delivered to
+    // it even if nothing else refers to it.
+    GjsContextPrivate* m_parent;
+    GSource* m_parent_source = nullptr;
+    JS::PersistentRootedObject m_wrapper;
+    GThread* m_thread = nullptr;
+
+    // The worker's thread runs m_loop on m_main_context; m_cx is set while the
+    // worker's context can be interrupted from the parent's thread
+    GMainContext* m_main_context;
+    GMainLoop* m_loop;
+    GSource* m_source;
+    std::mutex m_cx_lock;
+    JSContext* m_cx = nullptr;
+    bool m_closing = false;
+    std::atomic_bool m_terminated{false};
+
+    GjsWorkerQueue m_to_worker;
+    GjsWorkerQueue m_to_parent;
+
+    ~GjsWorker() {
+        g_assert(!m_thread && "worker's thread should have been joined");
+        if (m_parent_source) {
+            g_source_destroy(m_parent_source);
+            g_source_unref(m_parent_source);
+        }
+        g_source_destroy(m_source);
+        g_source_unref(m_source);
+        g_main_loop_unref(m_loop);
+        g_main_context_unref(m_main_context);
+    }
+
+    [[nodiscard]] GSource* create_source(GMainContext* main_context,
+                                         GSourceFunc func);
+
+    static void* thread_main(void* data);
+    void run();
+    GJS_JSAPI_RETURN_CONVENTION
+    bool run_script(JSContext* cx, GjsContextPrivate* gjs);
+    void report_exception(JSContext* cx);
+    void finish();
+
+    static gboolean on_source_dispatch(GSource* source, GSourceFunc func,
+                                       void* data);
+    static gboolean dispatch_to_worker(void* data);
+    static gboolean dispatch_to_parent(void* data);
+    static bool on_interrupt(JSContext* cx);
+
+ public:
+    GjsWorker(GjsContextPrivate* parent, const char* filename)
+        : m_filename(g_strdup(filename)),
+          m_search_path(g_strdupv(parent->search_path())),
+          m_parent(parent),
+          m_main_context(g_main_context_new()),
+          m_loop(g_main_loop_new(m_main_context, false)),
+          m_source(create_source(m_main_context, dispatch_to_worker)) {}
+
+    GjsWorker* ref() {
+        m_refcount++;
+        return this;
+    }
+    void unref() {
+        if (--m_refcount == 0)
+            delete this;
+    }
+
+    [[nodiscard]] GjsContextPrivate* parent() const { return m_parent; }
+    void detach_parent() { m_parent = nullptr; }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool start(JSContext* cx, JS::HandleObject wrapper);
+    void terminate();
+    void join();
+    void close();
+
+    void post_to_worker(GjsWorkerMessage&& message);
+    void post_to_parent(GjsWorkerMessage&& message);
+};
+
+// Workers that have been started and whose exit the parent hasn't handled yet
+static std::mutex s_workers_lock;
+static std::vector<GjsWorker*> s_workers;
+
+enum : unsigned { HANDLER_SLOT = 0 };
+
+// GLib.Bytes and GLib.Variant are written as an index into the message's
+// references. A worker can't have either wrapper without imports.gi, so a
+// GBytes becomes a Uint8Array there, still without copying.
+GJS_JSAPI_RETURN_CONVENTION
+static bool write_glib_object(JSContext* cx, JSStructuredCloneWriter* writer,
+                              JS::HandleObject obj, bool*, void* closure) {
+    auto* message = static_cast<GjsWorkerMessage*>(closure);
+    uint32_t tag;
+    if (BoxedBase::typecheck(cx, obj, nullptr, G_TYPE_BYTES,
+                             GjsTypecheckNoThrow())) {
+        tag = SCTAG_GBYTES;
+    } else if (BoxedBase::typecheck(cx, obj, nullptr, G_TYPE_VARIANT,
+                                    GjsTypecheckNoThrow())) {
+        tag = SCTAG_GVARIANT;
+    } else {
+        gjs_throw_custom(cx, JSProto_TypeError, "DataCloneError",
+                         "%s can't be sent to or from a worker",
+                         JS_GetClass(obj)->name);
+        return false;
+    }
+
+    void* ptr = BoxedBase::to_c_ptr(cx, obj);
+    if (!ptr)
+        return false;
+    message->refs.emplace_back(tag, ptr);
+    return JS_WriteUint32Pair(writer, tag, message->refs.size() - 1);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static JSObject* read_glib_object(JSContext* cx, JSStructuredCloneReader*,
+                                  const JS::CloneDataPolicy&, uint32_t tag,
+                                  uint32_t index, void* closure) {
+    auto* message = static_cast<GjsWorkerMessage*>(closure);
+    g_assert(index < message->refs.size() && message->refs[index].tag() == tag);
+    void* ptr = message->refs[index].get();
+
+    if (!GjsContextPrivate::from_cx(cx)->is_primary()) {
+        // Copied, since a Uint8Array viewing the data would allow writing to
+        // memory that the GBytes promises never changes
+        if (tag == SCTAG_GBYTES) {
+            auto* bytes = static_cast<GBytes*>(ptr);
+            size_t len;
+            const void* data = g_bytes_get_data(bytes, &len);
+            return gjs_byte_array_from_data(cx, len, const_cast<void*>(data));
+        }
+        gjs_throw(cx, "A GLib.Variant can't be received in a worker");
+        return nullptr;
+    }
+
+    GjsAutoStructInfo info = g_irepository_find_by_gtype(
+        nullptr, tag == SCTAG_GBYTES ? G_TYPE_BYTES : G_TYPE_VARIANT);
+    return BoxedInstance::new_for_c_struct(cx, info, ptr);
+}
+
+// clang-format off
+static const JSStructuredCloneCallbacks clone_callbacks = {
+    read_glib_object,
+    write_glib_object,
+    nullptr,  // reportError
+    nullptr,  // readTransfer
+    nullptr,  // writeTransfer
+    nullptr,  // freeTransfer
+    nullptr,  // canTransfer
+    nullptr,  // sabCloned
+};
+// clang-format on
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool write_message(JSContext* cx, JS::HandleValue value,
+                          JS::HandleValue transfer,
+                          GjsWorkerMessage* message) {
+    message->kind = GjsWorkerMessage::DATA;
+    message->data = std::make_unique<JSAutoStructuredCloneBuffer>(
+        JS::StructuredCloneScope::SameProcess, &clone_callbacks, message);
+    return message->data->write(cx, value, transfer, JS::CloneDataPolicy(),
+                                &clone_callbacks, message);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool read_message(JSContext* cx, GjsWorkerMessage* message,
+                         JS::MutableHandleValue value) {
+    return message->data->read(cx, value, JS::CloneDataPolicy(),
+                               &clone_callbacks, message);
+}
+
+GSource* GjsWorker::create_source(GMainContext* main_context,
+                                  GSourceFunc func) {
+    static GSourceFuncs source_funcs = {
+        nullptr,  // prepare; the ready time is enough
+        nullptr,  // check
+        &GjsWorker::on_source_dispatch,
+        nullptr,  // finalize
+        nullptr,  // closure_callback
+        nullptr,  // closure_marshal
+    };
+    GSource* source = g_source_new(&source_funcs, sizeof(GSource));
+    g_source_set_name(source, "GJS worker messages");
+    g_source_set_callback(source, func, this, nullptr);
+    g_source_attach(source, main_context);
+    return source;
+}
+
+gboolean GjsWorker::on_source_dispatch(GSource* source, GSourceFunc func,
+                                       void* data) {
+    g_source_set_ready_time(source, -1);
+    func(data);
+    return G_SOURCE_CONTINUE;
+}
+
+bool GjsWorker::start(JSContext* cx, JS::HandleObject wrapper) {
+    m_wrapper.init(cx, wrapper);
+    m_parent_source =
+        create_source(m_parent->main_context(), dispatch_to_parent);
+
+    GError* error = nullptr;
+    m_thread = g_thread_try_new("gjs-worker", &GjsWorker::thread_main, ref(),
+                                &error);
+    if (!m_thread) {
+        unref();
+        m_wrapper.reset();
+        gjs_throw(cx, "Failed to start worker: %s", error->message);
+        g_error_free(error);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_workers_lock);
+    s_workers.push_back(ref());
+    return true;
+}
+
+void* GjsWorker::thread_main(void* data) {
+    auto* self = static_cast<GjsWorker*>(data);
+    self->run();
+    self->unref();
+    return nullptr;
+}
+
+void GjsWorker::run() {
+    g_main_context_push_thread_default(m_main_context);
+    {
+        GjsAutoUnref<GjsContext> context(
+            gjs_context_new_with_search_path(m_search_path));
+        GjsContextPrivate* gjs = GjsContextPrivate::from_object(context);
+        JSContext* cx = gjs->context();
+        gjs->set_worker(this);
+        if (!JS_AddInterruptCallback(cx, &GjsWorker::on_interrupt))
+            g_error("Failed to set up worker's interrupt callback");
+        {
+            std::lock_guard<std::mutex> lock(m_cx_lock);
+            m_cx = cx;
+        }
+
+        if (!m_terminated) {
+            JS::RootedObject global(cx, gjs->global());
+            JSAutoRealm ar(cx, global);
+            if (!run_script(cx, gjs))
+                report_exception(cx);
+        }
+
+        if (!m_terminated && !m_closing)
+            g_main_loop_run(m_loop);
+
+        std::lock_guard<std::mutex> lock(m_cx_lock);
+        m_cx = nullptr;
+    }
+    g_main_context_pop_thread_default(m_main_context);
+
+    post_to_parent({GjsWorkerMessage::EXIT, nullptr, {}});
+}
+
+static bool worker_post_message_func(JSContext* cx, unsigned argc,
+                                     JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsWorkerMessage message;
+    if (!write_message(cx, args.get(0), args.get(1), &message))
+        return false;
+
+    GjsContextPrivate::from_cx(cx)->worker()->post_to_parent(
+        std::move(message));
+    args.rval().setUndefined();
+    return true;
+}
+
+static bool worker_close_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsContextPrivate::from_cx(cx)->worker()->close();
+    args.rval().setUndefined();
+    return true;
+}
+
+// Functions on the worker's global object; incoming messages are passed to its
+// onmessage property
+// clang-format off
+static JSFunctionSpec worker_global_funcs[] = {
+    JS_FN("postMessage", worker_post_message_func, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FN("close", worker_close_func, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
+// clang-format on
+
+bool GjsWorker::run_script(JSContext* cx, GjsContextPrivate* gjs) {
+    JS::RootedObject global(cx, gjs->global());
+    if (!JS_DefineFunctions(cx, global, worker_global_funcs))
+        return false;
+
+    GjsAutoUnref<GFile> file = g_file_new_for_commandline_arg(m_filename);
+    char* script;
+    size_t script_len;
+    GError* error = nullptr;
+    if (!g_file_load_contents(file, nullptr, &script, &script_len, nullptr,
+                              &error))
+        return gjs_throw_gerror_message(cx, error);
+    GjsAutoChar script_owner = script;
+
+    GjsAutoChar uri = g_file_get_uri(file);
+    JS::RootedValue ignored(cx);
+    return gjs->eval_with_scope(nullptr, script, script_len, uri, &ignored);
+}
+
+// Uncaught exceptions are reported to the parent as error events; there is
+// nothing to report for uncatchable ones, such as from terminate() or
+// System.exit()
+void GjsWorker::report_exception(JSContext* cx) {
+    JS::RootedValue exc(cx);
+    if (!JS_GetPendingException(cx, &exc))
+        return;
+    JS_ClearPendingException(cx);
+
+    GjsWorkerMessage message{GjsWorkerMessage::ERROR, nullptr, {}};
+    JS::RootedString str(cx, JS::ToString(cx, exc));
+    JS::UniqueChars utf8;
+    if (str)
+        utf8 = JS_EncodeStringToUTF8(cx, str);
+    if (utf8) {
+        message.error = utf8.get();
+    } else {
+        JS_ClearPendingException(cx);
+        message.error = "uncaught exception";
+    }
+    post_to_parent(std::move(message));
+}
+
+void GjsWorker::post_to_worker(GjsWorkerMessage&& message) {
+    if (m_to_worker.push(std::move(message)))
+        g_source_set_ready_time(m_source, 0);
+}
+
+void GjsWorker::post_to_parent(GjsWorkerMessage&& message) {
+    if (m_to_parent.push(std::move(message)))
+        g_source_set_ready_time(m_parent_source, 0);
+}
+
+gboolean GjsWorker::dispatch_to_worker(void* data) {
+    auto* self = static_cast<GjsWorker*>(data);
+    if (self->m_terminated) {
+        g_main_loop_quit(self->m_loop);
+        return G_SOURCE_CONTINUE;
+    }
+
+    std::deque<GjsWorkerMessage> messages = self->m_to_worker.take();
+    JSContext* cx = self->m_cx;
+    if (!cx)
+        return G_SOURCE_CONTINUE;
+
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(cx);
+    JS::RootedObject global(cx, gjs->global());
+    JSAutoRealm ar(cx, global);
+    const GjsAtoms& atoms = gjs->atoms();
+
+    for (GjsWorkerMessage& message : messages) {
+        if (self->m_closing || self->m_terminated)
+            break;
+
+        JS::RootedValue handler(cx), value(cx);
+        JS::RootedObject event(cx, JS_NewPlainObject(cx));
+        JS::RootedValueArray<1> args(cx);
+        if (!event || !read_message(cx, &message, &value) ||
+            !JS_DefinePropertyById(cx, event, atoms.data(), value,
+                                   JSPROP_ENUMERATE) ||
+            !JS_GetPropertyById(cx, global, atoms.onmessage(), &handler)) {
+            self->report_exception(cx);
+            continue;
+        }
+        if (!handler.isObject() || !JS::IsCallable(&handler.toObject()))
+            continue;
+
+        args[0].setObject(*event);
+        JS::RootedValue ignored(cx);
+        if (!JS::Call(cx, global, handler, args, &ignored))
+            self->report_exception(cx);
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean GjsWorker::dispatch_to_parent(void* data) {
+    auto* self = static_cast<GjsWorker*>(data);
+    std::deque<GjsWorkerMessage> messages = self->m_to_parent.take();
+    // The parent context's teardown has already joined the worker's thread
+    if (!self->m_parent || !self->m_wrapper || messages.empty())
+        return G_SOURCE_CONTINUE;
+
+    JSContext* cx = self->m_parent->context();
+    JS::RootedObject wrapper(cx, self->m_wrapper);
+    JSAutoRealm ar(cx, wrapper);
+    JS::RootedValue handler(cx, JS_GetReservedSlot(wrapper, HANDLER_SLOT));
+
+    for (GjsWorkerMessage& message : messages) {
+        if (message.kind == GjsWorkerMessage::EXIT) {
+            self->finish();
+            break;
+        }
+        // Nothing more is delivered after terminate()
+        if (self->m_terminated)
+            continue;
+
+        JS::RootedValueArray<2> args(cx);
+        JS::RootedValue ignored(cx);
+        bool ok;
+        if (message.kind == GjsWorkerMessage::ERROR) {
+            ok = gjs_string_from_utf8(cx, "error", args[0]) &&
+                 gjs_string_from_utf8(cx, message.error.c_str(), args[1]);
+        } else {
+            ok = gjs_string_from_utf8(cx, "message", args[0]) &&
+                 read_message(cx, &message, args[1]);
+        }
+        if (!ok || !JS::Call(cx, JS::UndefinedHandleValue, handler, args,
+                             &ignored))
+            gjs_log_exception(cx);
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+bool GjsWorker::on_interrupt(JSContext* cx) {
+    GjsWorker* self = GjsContextPrivate::from_cx(cx)->worker();
+    return !self || !self->m_terminated;
+}
+
+// Called from the worker's own thread; it finishes the task it is running
+void GjsWorker::close() {
+    m_closing = true;
+    g_main_loop_quit(m_loop);
+}
+
+// Called from the parent's thread; stops the worker even in the middle of
+// running JS
+void GjsWorker::terminate() {
+    if (m_terminated.exchange(true))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_cx_lock);
+        if (m_cx)
+            JS_RequestInterruptCallback(m_cx);
+    }
+    // The loop may not be running yet, in which case this quits it as soon
+    // as it starts
+    g_source_set_ready_time(m_source, 0);
+}
+
+void GjsWorker::join() {
+    if (m_thread) {
+        g_thread_join(m_thread);
+        m_thread = nullptr;
+    }
+    m_wrapper.reset();
+}
+
+// Called on the parent's thread when the worker's thread is done
+void GjsWorker::finish() {
+    join();
+
+    {
+        std::lock_guard<std::mutex> lock(s_workers_lock);
+        s_workers.erase(std::remove(s_workers.begin(), s_workers.end(), this),
+                        s_workers.end());
+    }
+    unref();
+}
+
+void gjs_worker_terminate_all(GjsContextPrivate* parent) {
+    std::vector<GjsWorker*> workers;
+    {
+        std::lock_guard<std::mutex> lock(s_workers_lock);
+        auto it = std::stable_partition(
+            s_workers.begin(), s_workers.end(),
+            [parent](GjsWorker* worker) { return worker->parent() != parent; });
+        workers.assign(it, s_workers.end());
+        s_workers.erase(it, s_workers.end());
+    }
+
+    for (GjsWorker* worker : workers)
+        worker->terminate();
+    for (GjsWorker* worker : workers) {
+        worker->join();
+        worker->detach_parent();
+        worker->unref();
+    }
+}
+
+[[nodiscard]] static JSObject* gjs_worker_get_proto(JSContext*);
+
+GJS_DEFINE_PROTO("Worker", worker,
+                 JSCLASS_HAS_RESERVED_SLOTS(1) | JSCLASS_BACKGROUND_FINALIZE)
+GJS_DEFINE_PRIV_FROM_JS(GjsWorker, gjs_worker_class)
+
+// new Worker(filename, handler); handler is called with ('message', data) or
+// ('error', message) for each event
+GJS_NATIVE_CONSTRUCTOR_DECLARE(worker) {
+    GJS_NATIVE_CONSTRUCTOR_VARIABLES(worker)
+    GJS_NATIVE_CONSTRUCTOR_PRELUDE(worker);
+
+    JS::UniqueChars filename;
+    JS::RootedObject handler(context);
+    if (!gjs_parse_call_args(context, "Worker", argv, "so", "filename",
+                             &filename, "handler", &handler))
+        return false;
+
+    auto* worker =
+        new GjsWorker(GjsContextPrivate::from_cx(context), filename.get());
+    JS_SetReservedSlot(object, HANDLER_SLOT, JS::ObjectValue(*handler));
+    JS_SetPrivate(object, worker);
+    if (!worker->start(context, object))
+        return false;
+
+    GJS_NATIVE_CONSTRUCTOR_FINISH(worker);
+    return true;
+}
+
+static void gjs_worker_finalize(JSFreeOp*, JSObject* obj) {
+    auto* worker = static_cast<GjsWorker*>(JS_GetPrivate(obj));
+    if (worker)
+        worker->unref();
+    JS_SetPrivate(obj, nullptr);
+}
+
+// postMessage(message, transfer)
+GJS_JSAPI_RETURN_CONVENTION
+static bool post_message_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsWorker, priv);
+    if (!priv) {
+        gjs_throw(cx, "postMessage() called on the Worker prototype");
+        return false;
+    }
+
+    GjsWorkerMessage message;
+    if (!write_message(cx, args.get(0), args.get(1), &message))
+        return false;
+
+    priv->post_to_worker(std::move(message));
+    args.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool terminate_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsWorker, priv);
+    if (priv)
+        priv->terminate();
+    args.rval().setUndefined();
+    return true;
+}
+
+// clang-format off
+JSPropertySpec gjs_worker_proto_props[] = {
+    JS_STRING_SYM_PS(toStringTag, "Worker", JSPROP_READONLY),
+    JS_PS_END};
+// clang-format on
+
+JSFunctionSpec gjs_worker_proto_funcs[] = {
+    JS_FN("postMessage", post_message_func, 2, 0),
+    JS_FN("terminate", terminate_func, 0, 0),
+    JS_FS_END};
+
+JSFunctionSpec gjs_worker_static_funcs[] = {JS_FS_END};
+
+bool gjs_define_worker_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    if (!module)
+        return false;
+
+    JS::RootedObject proto(cx);
+    return gjs_worker_define_proto(cx, module, &proto);
+}
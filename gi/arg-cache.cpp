@@ -27,11 +27,16 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <algorithm>  // for binary_search, find_if, sort, unique
+#include <vector>
+
 #include <ffi.h>
 #include <girepository.h>
 #include <glib.h>
 
+#include <js/CharacterEncoding.h>  // for DeflateStringToUTF8Buffer
 #include <js/Conversions.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
@@ -39,6 +44,7 @@
 #include <jsapi.h>        // for JS_TypeOfValue
 #include <jsfriendapi.h>  // for JS_GetObjectFunction
 #include <jspubtd.h>      // for JSTYPE_FUNCTION
+#include <mozilla/Span.h>
 
 #include "gi/arg-cache.h"
 #include "gi/arg-inl.h"
@@ -53,8 +59,11 @@
 #include "gi/param.h"
 #include "gi/union.h"
 #include "gi/value.h"
+#include "cjs/atoms.h"
 #include "cjs/byteArray.h"
+#include "cjs/context-private.h"
 #include "cjs/jsapi-util.h"
+#include "util/text.h"
 
 enum ExpectedType {
     OBJECT,
@@ -73,7 +82,7 @@ static void gjs_destroy_notify_callback(void* data) {
     auto* trampoline = static_cast<GjsCallbackTrampoline*>(data);
 
     g_assert(trampoline);
-    gjs_callback_trampoline_unref(trampoline);
+    gjs_callback_trampoline_destroy_notify(trampoline);
 }
 
 // A helper function to retrieve array lengths from a GIArgument (letting the
@@ -211,7 +220,8 @@ GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_generic_in_in(JSContext* cx, GjsArgumentCache* self,
                                       GjsFunctionCallState*, GIArgument* arg,
                                       JS::HandleValue value) {
-    return gjs_value_to_g_argument(cx, value, &self->type_info, self->arg_name,
+    return gjs_value_to_g_argument(cx, value, self->type_info(),
+                                   self->arg_name(),
                                    self->is_return_value()
                                        ? GJS_ARGUMENT_RETURN_VALUE
                                        : GJS_ARGUMENT_ARGUMENT,
@@ -242,8 +252,9 @@ static bool gjs_marshal_explicit_array_in_in(JSContext* cx,
     size_t length;
 
     if (!gjs_array_to_explicit_array(
-            cx, value, &self->type_info, self->arg_name, GJS_ARGUMENT_ARGUMENT,
-            self->transfer, self->nullable, &data, &length))
+            cx, value, self->type_info(), self->arg_name(),
+            GJS_ARGUMENT_ARGUMENT, self->transfer, self->nullable, &data,
+            &length))
         return false;
 
     uint8_t length_pos = self->contents.array.length_pos;
@@ -301,13 +312,13 @@ static bool gjs_marshal_callback_in(JSContext* cx, GjsArgumentCache* self,
     } else {
         if (JS_TypeOfValue(cx, value) != JSTYPE_FUNCTION) {
             gjs_throw(cx, "Expected function for callback argument %s, got %s",
-                      self->arg_name, JS::InformalValueTypeName(value));
+                      self->arg_name(), JS::InformalValueTypeName(value));
             return false;
         }
 
         JS::RootedFunction func(cx, JS_GetObjectFunction(&value.toObject()));
         GjsAutoCallableInfo callable_info =
-            g_type_info_get_interface(&self->type_info);
+            g_type_info_get_interface(self->type_info());
         bool is_object_method = !!state->instance_object;
         trampoline = gjs_callback_trampoline_new(cx, func, callable_info,
                                                  self->contents.callback.scope,
@@ -347,6 +358,23 @@ static bool gjs_marshal_callback_in(JSContext* cx, GjsArgumentCache* self,
     return true;
 }
 
+// A GAsyncReadyCallback left out of the call settles the promise returned from
+// it natively; see gjs_invoke_c_function()
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_async_ready_callback_in(JSContext* cx,
+                                                GjsArgumentCache* self,
+                                                GjsFunctionCallState* state,
+                                                GIArgument* arg,
+                                                JS::HandleValue value) {
+    if (!state->async_call || !value.isUndefined())
+        return gjs_marshal_callback_in(cx, self, state, arg, value);
+
+    gjs_arg_set(&state->in_cvalues[self->contents.callback.closure_pos],
+                state->async_call);
+    gjs_arg_set(arg, gjs_async_promise_call_ready);
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_generic_out_in(JSContext*, GjsArgumentCache* self,
                                        GjsFunctionCallState* state,
@@ -407,7 +435,7 @@ static bool gjs_marshal_integer_in_in(JSContext* cx, GjsArgumentCache* self,
             return false;
 
         if (!value_in_range(number, tag))
-            return report_out_of_range(cx, self->arg_name, tag);
+            return report_out_of_range(cx, self->arg_name(), tag);
 
         gjs_g_argument_set_array_length(tag, arg, number);
     } else {
@@ -416,7 +444,7 @@ static bool gjs_marshal_integer_in_in(JSContext* cx, GjsArgumentCache* self,
             return false;
 
         if (!value_in_range(number, tag))
-            return report_out_of_range(cx, self->arg_name, tag);
+            return report_out_of_range(cx, self->arg_name(), tag);
 
         gjs_g_argument_set_array_length(tag, arg, number);
     }
@@ -437,19 +465,21 @@ static bool gjs_marshal_number_in_in(JSContext* cx, GjsArgumentCache* self,
         gjs_arg_set(arg, v);
     } else if (tag == GI_TYPE_TAG_FLOAT) {
         if (v < -G_MAXFLOAT || v > G_MAXFLOAT)
-            return report_out_of_range(cx, self->arg_name, GI_TYPE_TAG_FLOAT);
+            return report_out_of_range(cx, self->arg_name(), GI_TYPE_TAG_FLOAT);
         gjs_arg_set<float>(arg, v);
     } else if (tag == GI_TYPE_TAG_INT64) {
         if (v < G_MININT64 || v > G_MAXINT64)
-            return report_out_of_range(cx, self->arg_name, GI_TYPE_TAG_INT64);
+            return report_out_of_range(cx, self->arg_name(), GI_TYPE_TAG_INT64);
         gjs_arg_set<int64_t>(arg, v);
     } else if (tag == GI_TYPE_TAG_UINT64) {
         if (v < 0 || v > G_MAXUINT64)
-            return report_out_of_range(cx, self->arg_name, GI_TYPE_TAG_UINT64);
+            return report_out_of_range(cx, self->arg_name(),
+                                       GI_TYPE_TAG_UINT64);
         gjs_arg_set<uint64_t>(arg, v);
     } else if (tag == GI_TYPE_TAG_UINT32) {
         if (v < 0 || v > G_MAXUINT32)
-            return report_out_of_range(cx, self->arg_name, GI_TYPE_TAG_UINT32);
+            return report_out_of_range(cx, self->arg_name(),
+                                       GI_TYPE_TAG_UINT32);
         gjs_arg_set<uint32_t>(arg, v);
     } else {
         g_assert_not_reached();
@@ -463,7 +493,7 @@ static bool gjs_marshal_unichar_in_in(JSContext* cx, GjsArgumentCache* self,
                                       GjsFunctionCallState*, GIArgument* arg,
                                       JS::HandleValue value) {
     if (!value.isString())
-        return report_typeof_mismatch(cx, self->arg_name, value,
+        return report_typeof_mismatch(cx, self->arg_name(), value,
                                       ExpectedType::STRING);
 
     return gjs_unichar_from_string(cx, value, &gjs_arg_member<char32_t>(arg));
@@ -474,9 +504,9 @@ static bool gjs_marshal_gtype_in_in(JSContext* cx, GjsArgumentCache* self,
                                     GjsFunctionCallState*, GIArgument* arg,
                                     JS::HandleValue value) {
     if (value.isNull())
-        return report_invalid_null(cx, self->arg_name);
+        return report_invalid_null(cx, self->arg_name());
     if (!value.isObject())
-        return report_typeof_mismatch(cx, self->arg_name, value,
+        return report_typeof_mismatch(cx, self->arg_name(), value,
                                       ExpectedType::OBJECT);
 
     JS::RootedObject gtype_obj(cx, &value.toObject());
@@ -487,7 +517,7 @@ static bool gjs_marshal_gtype_in_in(JSContext* cx, GjsArgumentCache* self,
 // Common code for most types that are pointers on the C side
 bool GjsArgumentCache::handle_nullable(JSContext* cx, GIArgument* arg) {
     if (!nullable)
-        return report_invalid_null(cx, arg_name);
+        return report_invalid_null(cx, arg_name());
     gjs_arg_unset<void*>(arg);
     return true;
 }
@@ -500,7 +530,7 @@ static bool gjs_marshal_string_in_in(JSContext* cx, GjsArgumentCache* self,
         return self->handle_nullable(cx, arg);
 
     if (!value.isString())
-        return report_typeof_mismatch(cx, self->arg_name, value,
+        return report_typeof_mismatch(cx, self->arg_name(), value,
                                       ExpectedType::STRING);
 
     if (self->contents.string_is_filename) {
@@ -518,6 +548,161 @@ static bool gjs_marshal_string_in_in(JSContext* cx, GjsArgumentCache* self,
     return true;
 }
 
+// Copies a JS string into @arena as zero-terminated UTF-8, returning null on
+// failure. The JS string's characters cannot be borrowed, since they are not
+// guaranteed to be zero-terminated.
+GJS_JSAPI_RETURN_CONVENTION
+static char* encode_string_in_arena(JSContext* cx, GjsArena* arena,
+                                    JSString* str) {
+    JSLinearString* linear = JS_EnsureLinearString(cx, str);
+    if (!linear)
+        return nullptr;
+
+    JS::AutoCheckCannotGC nogc;
+
+    // Most strings passed to C APIs (CSS class names, icon names, signal
+    // names...) are ASCII, and so are already valid UTF-8
+    if (js::LinearStringHasLatin1Chars(linear)) {
+        size_t length = js::GetLinearStringLength(linear);
+        const JS::Latin1Char* chars =
+            js::GetLatin1LinearStringChars(nogc, linear);
+        if (gjs_text_is_ascii(reinterpret_cast<const char*>(chars), length)) {
+            char* buffer = arena->alloc_n<char>(length + 1);
+            memcpy(buffer, chars, length);
+            buffer[length] = '\0';
+            return buffer;
+        }
+    }
+
+    size_t length = JS::GetDeflatedUTF8StringLength(linear);
+    char* buffer = arena->alloc_n<char>(length + 1);
+    size_t written = JS::DeflateStringToUTF8Buffer(
+        linear, mozilla::Span<char>(buffer, length));
+    buffer[written] = '\0';
+    return buffer;
+}
+
+// Transfer-none UTF-8 strings only need to live until the call returns, so
+// they are encoded directly into the call's arena instead of being copied
+// twice to the malloc heap.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_string_in_transfer_none_in(JSContext* cx,
+                                                   GjsArgumentCache* self,
+                                                   GjsFunctionCallState* state,
+                                                   GIArgument* arg,
+                                                   JS::HandleValue value) {
+    if (value.isNull())
+        return self->handle_nullable(cx, arg);
+
+    if (!value.isString())
+        return report_typeof_mismatch(cx, self->arg_name(), value,
+                                      ExpectedType::STRING);
+
+    char* buffer =
+        encode_string_in_arena(cx, state->arena.arena(), value.toString());
+    if (!buffer)
+        return false;
+
+    gjs_arg_set(arg, buffer);
+    return true;
+}
+
+// Likewise, transfer-none string vectors (style classes, argv, search paths)
+// are built in the call's arena: the pointer table and the UTF-8 data of every
+// element share the arena's chunks, and are all released together when the
+// call returns instead of with one g_free() per element.
+GJS_JSAPI_RETURN_CONVENTION
+static bool strv_to_arena(JSContext* cx, GjsArgumentCache* self,
+                          GjsFunctionCallState* state, JS::HandleValue value,
+                          void** data, size_t* length_p) {
+    if (value.isObject()) {
+        JS::RootedObject array(cx, &value.toObject());
+        const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+        bool found_length;
+        if (!JS_HasPropertyById(cx, array, atoms.length(), &found_length))
+            return false;
+
+        if (found_length) {
+            uint32_t length;
+            if (!gjs_object_require_converted_property(
+                    cx, array, nullptr, atoms.length(), &length))
+                return false;
+
+            GjsArena* arena = state->arena.arena();
+            char** strv = arena->alloc_n<char*>(length + 1);
+            JS::RootedValue elem(cx);
+            for (uint32_t i = 0; i < length; i++) {
+                if (!JS_GetElement(cx, array, i, &elem)) {
+                    gjs_throw(cx, "Missing array element %u", i);
+                    return false;
+                }
+                if (!elem.isString()) {
+                    gjs_throw(cx,
+                              "Value is not a string, cannot convert to "
+                              "UTF-8");
+                    return false;
+                }
+                strv[i] = encode_string_in_arena(cx, arena, elem.toString());
+                if (!strv[i])
+                    return false;
+            }
+            strv[length] = nullptr;
+
+            *data = strv;
+            *length_p = length;
+            return true;
+        }
+    }
+
+    // Null or an invalid value; let the generic code handle or report it
+    return gjs_array_to_explicit_array(
+        cx, value, self->type_info(), self->arg_name(), GJS_ARGUMENT_ARGUMENT,
+        self->transfer, self->nullable, data, length_p);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_strv_in_transfer_none_in(JSContext* cx,
+                                                 GjsArgumentCache* self,
+                                                 GjsFunctionCallState* state,
+                                                 GIArgument* arg,
+                                                 JS::HandleValue value) {
+    void* data;
+    size_t length;
+    if (!strv_to_arena(cx, self, state, value, &data, &length))
+        return false;
+
+    gjs_arg_set(arg, data);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_explicit_strv_in_transfer_none_in(
+    JSContext* cx, GjsArgumentCache* self, GjsFunctionCallState* state,
+    GIArgument* arg, JS::HandleValue value) {
+    void* data;
+    size_t length;
+    if (!strv_to_arena(cx, self, state, value, &data, &length))
+        return false;
+
+    uint8_t length_pos = self->contents.array.length_pos;
+    gjs_g_argument_set_array_length(self->contents.array.length_tag,
+                                    &state->in_cvalues[length_pos], length);
+    gjs_arg_set(arg, data);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_string_return_transfer_none_out(
+    JSContext* cx, GjsArgumentCache*, GjsFunctionCallState*, GIArgument* arg,
+    JS::MutableHandleValue value) {
+    const char* str = gjs_arg_get<char*>(arg);
+    if (!str) {
+        value.setNull();
+        return true;
+    }
+    return GjsContextPrivate::from_cx(cx)->string_cache().get(cx, str, value);
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_enum_in_in(JSContext* cx, GjsArgumentCache* self,
                                    GjsFunctionCallState*, GIArgument* arg,
@@ -539,7 +724,7 @@ static bool gjs_marshal_enum_in_in(JSContext* cx, GjsArgumentCache* self,
 
     if (number > max || number < min) {
         gjs_throw(cx, "%" PRId64 " is not a valid value for enum argument %s",
-                  number, self->arg_name);
+                  number, self->arg_name());
         return false;
     }
 
@@ -561,7 +746,7 @@ static bool gjs_marshal_flags_in_in(JSContext* cx, GjsArgumentCache* self,
 
     if ((uint64_t(number) & self->contents.flags_mask) != uint64_t(number)) {
         gjs_throw(cx, "%" PRId64 " is not a valid value for flags argument %s",
-                  number, self->arg_name);
+                  number, self->arg_name());
         return false;
     }
 
@@ -572,15 +757,162 @@ static bool gjs_marshal_flags_in_in(JSContext* cx, GjsArgumentCache* self,
     return true;
 }
 
+// Valid values of an enum or flags type, precomputed when building the cache
+// so that values coming out of C can be checked without walking the
+// GIEnumInfo or looking up the GFlagsClass on every call. The checks are the
+// same as in _gjs_enum_value_is_valid() and _gjs_flags_value_is_valid().
+struct GjsEnumTable {
+    // Sparse enums whose values span at most this many bits get a bitset,
+    // wider ones a sorted table
+    static constexpr uint64_t MAX_BITSET_SPAN = 1024;
+
+    GType gtype;
+    bool is_signed : 1;  // storage type, for widening the 32-bit value
+    bool is_flags : 1;
+
+    // Enums: the range of values, and the bitset of valid values indexed by
+    // (value - min) or sorted table of them if the enum has holes
+    int64_t min;
+    int64_t max;
+    std::vector<uint64_t> bitset;
+    // Enums: see above. Flags: all nonzero values, in the GFlagsClass order
+    // that g_flags_get_first_value() uses
+    std::vector<int64_t> values;
+
+    // Flags: the bits that are flag values on their own. Any combination of
+    // them is valid, so the greedy decomposition is only needed otherwise.
+    uint32_t single_bits;
+
+    [[nodiscard]] bool enum_contains(int64_t value) const {
+        if (value < min || value > max)
+            return false;
+        if (!bitset.empty()) {
+            uint64_t ix = value - min;
+            return bitset[ix / 64] & (uint64_t(1) << (ix % 64));
+        }
+        if (!values.empty())
+            return std::binary_search(values.begin(), values.end(), value);
+        return true;  // dense
+    }
+
+    [[nodiscard]] bool flags_contains(int64_t value) const {
+        if (gtype == G_TYPE_NONE)
+            return true;
+
+        auto remaining = static_cast<uint32_t>(value);
+        if (remaining != value)
+            return false;
+        if ((remaining & ~single_bits) == 0)
+            return true;
+
+        while (remaining) {
+            auto it = std::find_if(values.begin(), values.end(),
+                                   [remaining](int64_t v) {
+                                       auto bits = static_cast<uint32_t>(v);
+                                       return (bits & remaining) == bits;
+                                   });
+            if (it == values.end())
+                return false;
+            remaining &= ~static_cast<uint32_t>(*it);
+        }
+        return true;
+    }
+};
+
+static GjsEnumTable* gjs_enum_table_new(GIEnumInfo* info, bool is_flags) {
+    auto* table = new GjsEnumTable();
+    table->gtype = g_registered_type_info_get_g_type(info);
+    table->is_flags = is_flags;
+
+    GITypeTag storage = g_enum_info_get_storage_type(info);
+    table->is_signed =
+        storage == GI_TYPE_TAG_INT8 || storage == GI_TYPE_TAG_INT16 ||
+        storage == GI_TYPE_TAG_INT32 || storage == GI_TYPE_TAG_INT64;
+
+    if (is_flags) {
+        if (table->gtype == G_TYPE_NONE)
+            return table;
+
+        GjsAutoTypeClass<GFlagsClass> klass(table->gtype);
+        for (unsigned ix = 0; ix < klass->n_values; ix++) {
+            unsigned value = klass->values[ix].value;
+            if (value == 0)
+                continue;
+            table->values.push_back(value);
+            if ((value & (value - 1)) == 0)
+                table->single_bits |= value;
+        }
+        return table;
+    }
+
+    int n = g_enum_info_get_n_values(info);
+    for (int ix = 0; ix < n; ix++) {
+        GjsAutoValueInfo value_info = g_enum_info_get_value(info, ix);
+        table->values.push_back(g_value_info_get_value(value_info));
+    }
+    std::sort(table->values.begin(), table->values.end());
+    table->values.erase(
+        std::unique(table->values.begin(), table->values.end()),
+        table->values.end());
+
+    if (table->values.empty()) {
+        // Nothing is valid
+        table->min = 1;
+        table->max = 0;
+        return table;
+    }
+
+    table->min = table->values.front();
+    table->max = table->values.back();
+    uint64_t span = uint64_t(table->max - table->min) + 1;
+    if (span == table->values.size()) {
+        table->values.clear();
+    } else if (span <= GjsEnumTable::MAX_BITSET_SPAN) {
+        table->bitset.resize((span + 63) / 64);
+        for (int64_t value : table->values) {
+            uint64_t bit = value - table->min;
+            table->bitset[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+        table->values.clear();
+    }
+    table->values.shrink_to_fit();
+    return table;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_enum_out_out(JSContext* cx, GjsArgumentCache* self,
+                                     GjsFunctionCallState*, GIArgument* arg,
+                                     JS::MutableHandleValue value) {
+    const GjsEnumTable* table = self->cold->enum_table;
+    int int_value = gjs_arg_get<int, GI_TYPE_TAG_INTERFACE>(arg);
+    int64_t number = table->is_signed ? int64_t(int_value)
+                                      : int64_t(uint32_t(int_value));
+
+    if (table->is_flags) {
+        if (!table->flags_contains(number)) {
+            gjs_throw(cx, "0x%x is not a valid value for flags %s",
+                      uint32_t(number), g_type_name(table->gtype));
+            return false;
+        }
+    } else if (!table->enum_contains(number)) {
+        gjs_throw(cx,
+                  "%" G_GINT64_MODIFIER "d is not a valid value for "
+                  "enumeration %s",
+                  number, g_base_info_get_name(self->cold->interface_info));
+        return false;
+    }
+
+    value.setNumber(static_cast<double>(number));
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_foreign_in_in(JSContext* cx, GjsArgumentCache* self,
                                       GjsFunctionCallState*, GIArgument* arg,
                                       JS::HandleValue value) {
-    GIStructInfo* foreign_info = g_type_info_get_interface(&self->type_info);
-    self->contents.tmp_foreign_info = foreign_info;
-    return gjs_struct_foreign_convert_to_g_argument(
-        cx, value, foreign_info, self->arg_name, GJS_ARGUMENT_ARGUMENT,
-        self->transfer, self->nullable, arg);
+    return self->contents.foreign_info->to_func(
+        cx, value, self->arg_name(), GJS_ARGUMENT_ARGUMENT, self->transfer,
+        self->nullable, arg);
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -608,7 +940,7 @@ static bool gjs_marshal_boxed_in_in(JSContext* cx, GjsArgumentCache* self,
     GType gtype = self->contents.object.gtype;
 
     if (!value.isObject())
-        return report_gtype_mismatch(cx, self->arg_name, value, gtype);
+        return report_gtype_mismatch(cx, self->arg_name(), value, gtype);
 
     JS::RootedObject object(cx, &value.toObject());
     if (gtype == G_TYPE_ERROR) {
@@ -618,7 +950,7 @@ static bool gjs_marshal_boxed_in_in(JSContext* cx, GjsArgumentCache* self,
 
     return BoxedBase::transfer_to_gi_argument(cx, object, arg, GI_DIRECTION_IN,
                                               self->transfer, gtype,
-                                              self->contents.object.info);
+                                              self->cold->interface_info);
 }
 
 // Unions include ClutterEvent and GdkEvent, which occur fairly often in an
@@ -635,12 +967,12 @@ static bool gjs_marshal_union_in_in(JSContext* cx, GjsArgumentCache* self,
     g_assert(gtype != G_TYPE_NONE);
 
     if (!value.isObject())
-        return report_gtype_mismatch(cx, self->arg_name, value, gtype);
+        return report_gtype_mismatch(cx, self->arg_name(), value, gtype);
 
     JS::RootedObject object(cx, &value.toObject());
     return UnionBase::transfer_to_gi_argument(cx, object, arg, GI_DIRECTION_IN,
                                               self->transfer, gtype,
-                                              self->contents.object.info);
+                                              self->cold->interface_info);
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -651,7 +983,7 @@ static bool gjs_marshal_gclosure_in_in(JSContext* cx, GjsArgumentCache* self,
         return self->handle_nullable(cx, arg);
 
     if (!(JS_TypeOfValue(cx, value) == JSTYPE_FUNCTION))
-        return report_typeof_mismatch(cx, self->arg_name, value,
+        return report_typeof_mismatch(cx, self->arg_name(), value,
                                       ExpectedType::FUNCTION);
 
     JS::RootedFunction func(cx, JS_GetObjectFunction(&value.toObject()));
@@ -671,7 +1003,7 @@ static bool gjs_marshal_gbytes_in_in(JSContext* cx, GjsArgumentCache* self,
         return self->handle_nullable(cx, arg);
 
     if (!value.isObject())
-        return report_gtype_mismatch(cx, self->arg_name, value, G_TYPE_BYTES);
+        return report_gtype_mismatch(cx, self->arg_name(), value, G_TYPE_BYTES);
 
     JS::RootedObject object(cx, &value.toObject());
     if (JS_IsUint8Array(object)) {
@@ -683,12 +1015,25 @@ static bool gjs_marshal_gbytes_in_in(JSContext* cx, GjsArgumentCache* self,
     // ownership, so we need to do the same here.
     return BoxedBase::transfer_to_gi_argument(
         cx, object, arg, GI_DIRECTION_IN, GI_TRANSFER_EVERYTHING, G_TYPE_BYTES,
-        self->contents.object.info);
+        self->cold->interface_info);
+}
+
+// The inline cache of GIWrapperInstance::typecheck_cached() for this argument
+// of the function being called, if any. It is kept with the function rather
+// than in the argument cache, which is shared between threads.
+[[nodiscard]] static GType* typecheck_memo(GjsArgumentCache* self,
+                                           GjsFunctionCallState* state) {
+    if (!state->typecheck_memo)
+        return nullptr;
+    if (self->arg_pos == GjsArgumentCache::INSTANCE_PARAM)
+        return &state->typecheck_memo[-2];
+    return &state->typecheck_memo[self->arg_pos];
 }
 
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_interface_in_in(JSContext* cx, GjsArgumentCache* self,
-                                        GjsFunctionCallState*, GIArgument* arg,
+                                        GjsFunctionCallState* state,
+                                        GIArgument* arg,
                                         JS::HandleValue value) {
     if (value.isNull())
         return self->handle_nullable(cx, arg);
@@ -697,28 +1042,31 @@ static bool gjs_marshal_interface_in_in(JSContext* cx, GjsArgumentCache* self,
     g_assert(gtype != G_TYPE_NONE);
 
     if (!value.isObject())
-        return report_gtype_mismatch(cx, self->arg_name, value, gtype);
+        return report_gtype_mismatch(cx, self->arg_name(), value, gtype);
 
     JS::RootedObject object(cx, &value.toObject());
 
     // Could be a GObject interface that's missing a prerequisite,
     // or could be a fundamental
-    if (ObjectBase::typecheck(cx, object, nullptr, gtype,
-                              GjsTypecheckNoThrow())) {
+    GType* last_passed_gtype = typecheck_memo(self, state);
+    if (ObjectBase::typecheck(cx, object, nullptr, gtype, GjsTypecheckNoThrow(),
+                              last_passed_gtype)) {
         return ObjectBase::transfer_to_gi_argument(
-                        cx, object, arg, GI_DIRECTION_IN, self->transfer, gtype);
+            cx, object, arg, GI_DIRECTION_IN, self->transfer, gtype, nullptr,
+            last_passed_gtype);
     }
 
     // If this typecheck fails, then it's neither an object nor a
     // fundamental
     return FundamentalBase::transfer_to_gi_argument(
-            cx, object, arg, GI_DIRECTION_IN, self->transfer, gtype);
+        cx, object, arg, GI_DIRECTION_IN, self->transfer, gtype, nullptr,
+        last_passed_gtype);
 }
 
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_object_in_in(JSContext* cx, GjsArgumentCache* self,
-                                     GjsFunctionCallState*, GIArgument* arg,
-                                     JS::HandleValue value) {
+                                     GjsFunctionCallState* state,
+                                     GIArgument* arg, JS::HandleValue value) {
     if (value.isNull())
         return self->handle_nullable(cx, arg);
 
@@ -726,16 +1074,17 @@ static bool gjs_marshal_object_in_in(JSContext* cx, GjsArgumentCache* self,
     g_assert(gtype != G_TYPE_NONE);
 
     if (!value.isObject())
-        return report_gtype_mismatch(cx, self->arg_name, value, gtype);
+        return report_gtype_mismatch(cx, self->arg_name(), value, gtype);
 
     JS::RootedObject object(cx, &value.toObject());
     return ObjectBase::transfer_to_gi_argument(cx, object, arg, GI_DIRECTION_IN,
-                                               self->transfer, gtype);
+                                               self->transfer, gtype, nullptr,
+                                               typecheck_memo(self, state));
 }
 
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_fundamental_in_in(JSContext* cx, GjsArgumentCache* self,
-                                          GjsFunctionCallState*,
+                                          GjsFunctionCallState* state,
                                           GIArgument* arg,
                                           JS::HandleValue value) {
     if (value.isNull())
@@ -745,11 +1094,12 @@ static bool gjs_marshal_fundamental_in_in(JSContext* cx, GjsArgumentCache* self,
     g_assert(gtype != G_TYPE_NONE);
 
     if (!value.isObject())
-        return report_gtype_mismatch(cx, self->arg_name, value, gtype);
+        return report_gtype_mismatch(cx, self->arg_name(), value, gtype);
 
     JS::RootedObject object(cx, &value.toObject());
     return FundamentalBase::transfer_to_gi_argument(
-        cx, object, arg, GI_DIRECTION_IN, self->transfer, gtype);
+        cx, object, arg, GI_DIRECTION_IN, self->transfer, gtype, nullptr,
+        typecheck_memo(self, state));
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -760,7 +1110,7 @@ static bool gjs_marshal_gtype_struct_instance_in(JSContext* cx,
                                                  JS::HandleValue value) {
     // Instance parameter is never nullable
     if (!value.isObject())
-        return report_typeof_mismatch(cx, self->arg_name, value,
+        return report_typeof_mismatch(cx, self->arg_name(), value,
                                       ExpectedType::OBJECT);
 
     JS::RootedObject obj(cx, &value.toObject());
@@ -792,7 +1142,7 @@ static bool gjs_marshal_param_instance_in(JSContext* cx, GjsArgumentCache* self,
                                           JS::HandleValue value) {
     // Instance parameter is never nullable
     if (!value.isObject())
-        return report_typeof_mismatch(cx, self->arg_name, value,
+        return report_typeof_mismatch(cx, self->arg_name(), value,
                                       ExpectedType::OBJECT);
 
     JS::RootedObject obj(cx, &value.toObject());
@@ -817,7 +1167,7 @@ GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_generic_out_out(JSContext* cx, GjsArgumentCache* self,
                                         GjsFunctionCallState*, GIArgument* arg,
                                         JS::MutableHandleValue value) {
-    return gjs_value_from_g_argument(cx, value, &self->type_info, arg, true);
+    return gjs_value_from_g_argument(cx, value, self->type_info(), arg, true);
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -831,7 +1181,29 @@ static bool gjs_marshal_explicit_array_out_out(JSContext* cx,
     GITypeTag length_tag = self->contents.array.length_tag;
     size_t length = gjs_g_argument_get_array_length(length_tag, length_arg);
 
-    return gjs_value_from_explicit_array(cx, value, &self->type_info, arg,
+    // Arrays that we own can sometimes be handed over to JS without copying
+    if (self->transfer != GI_TRANSFER_NOTHING)
+        return gjs_value_from_owned_explicit_array(cx, value, self->type_info(),
+                                                   arg, length);
+
+    return gjs_value_from_explicit_array(cx, value, self->type_info(), arg,
+                                         length);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_explicit_array_inout_out(JSContext* cx,
+                                                 GjsArgumentCache* self,
+                                                 GjsFunctionCallState* state,
+                                                 GIArgument* arg,
+                                                 JS::MutableHandleValue value) {
+    // The function may have given back the array that we passed in, so don't
+    // take it over; the release marshaller needs to see the original pointer
+    uint8_t length_pos = self->contents.array.length_pos;
+    GIArgument* length_arg = &(state->out_cvalues[length_pos]);
+    GITypeTag length_tag = self->contents.array.length_tag;
+    size_t length = gjs_g_argument_get_array_length(length_tag, length_arg);
+
+    return gjs_value_from_explicit_array(cx, value, self->type_info(), arg,
                                          length);
 }
 
@@ -849,7 +1221,7 @@ static bool gjs_marshal_generic_in_release(
     GIArgument* in_arg, GIArgument* out_arg [[maybe_unused]]) {
     GITransfer transfer =
         state->call_completed ? self->transfer : GI_TRANSFER_NOTHING;
-    return gjs_g_argument_release_in_arg(cx, transfer, &self->type_info,
+    return gjs_g_argument_release_in_arg(cx, transfer, self->type_info(),
                                          in_arg);
 }
 
@@ -859,7 +1231,7 @@ static bool gjs_marshal_generic_out_release(JSContext* cx,
                                             GjsFunctionCallState*,
                                             GIArgument* in_arg [[maybe_unused]],
                                             GIArgument* out_arg) {
-    return gjs_g_argument_release(cx, self->transfer, &self->type_info,
+    return gjs_g_argument_release(cx, self->transfer, self->type_info(),
                                   out_arg);
 }
 
@@ -876,7 +1248,7 @@ static bool gjs_marshal_generic_inout_release(JSContext* cx,
     GIArgument* original_out_arg =
         &(state->inout_original_cvalues[self->arg_pos]);
     if (!gjs_g_argument_release_in_arg(cx, GI_TRANSFER_NOTHING,
-                                       &self->type_info, original_out_arg))
+                                       self->type_info(), original_out_arg))
         return false;
 
     return gjs_marshal_generic_out_release(cx, self, state, in_arg, out_arg);
@@ -892,7 +1264,7 @@ static bool gjs_marshal_explicit_array_out_release(
     size_t length = gjs_g_argument_get_array_length(length_tag, length_arg);
 
     return gjs_g_argument_release_out_array(cx, self->transfer,
-                                            &self->type_info, length, out_arg);
+                                            self->type_info(), length, out_arg);
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -907,7 +1279,7 @@ static bool gjs_marshal_explicit_array_in_release(
     GITransfer transfer =
         state->call_completed ? self->transfer : GI_TRANSFER_NOTHING;
 
-    return gjs_g_argument_release_in_array(cx, transfer, &self->type_info,
+    return gjs_g_argument_release_in_array(cx, transfer, self->type_info(),
                                            length, in_arg);
 }
 
@@ -928,12 +1300,12 @@ static bool gjs_marshal_explicit_array_inout_release(
         &(state->inout_original_cvalues[self->arg_pos]);
     if (gjs_arg_get<void*>(original_out_arg) != gjs_arg_get<void*>(out_arg) &&
         !gjs_g_argument_release_in_array(cx, GI_TRANSFER_NOTHING,
-                                         &self->type_info, length,
+                                         self->type_info(), length,
                                          original_out_arg))
         return false;
 
     return gjs_g_argument_release_out_array(cx, self->transfer,
-                                            &self->type_info, length, out_arg);
+                                            self->type_info(), length, out_arg);
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -963,6 +1335,16 @@ static bool gjs_marshal_callback_release(JSContext*, GjsArgumentCache*,
     return true;
 }
 
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_marshal_async_ready_callback_release(
+    JSContext* cx, GjsArgumentCache* self, GjsFunctionCallState* state,
+    GIArgument* in_arg, GIArgument* out_arg) {
+    // Not a trampoline, owned by GIO once the function is called
+    if (state->async_call)
+        return true;
+    return gjs_marshal_callback_release(cx, self, state, in_arg, out_arg);
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_string_in_release(JSContext*, GjsArgumentCache*,
                                           GjsFunctionCallState*,
@@ -977,17 +1359,13 @@ GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_marshal_foreign_in_release(
     JSContext* cx, GjsArgumentCache* self, GjsFunctionCallState* state,
     GIArgument* in_arg, GIArgument* out_arg [[maybe_unused]]) {
-    bool ok = true;
-
+    GjsForeignInfo* foreign = self->contents.foreign_info;
     GITransfer transfer =
         state->call_completed ? self->transfer : GI_TRANSFER_NOTHING;
 
-    if (transfer == GI_TRANSFER_NOTHING)
-        ok = gjs_struct_foreign_release_g_argument(
-            cx, self->transfer, self->contents.tmp_foreign_info, in_arg);
-
-    g_base_info_unref(self->contents.tmp_foreign_info);
-    return ok;
+    if (transfer == GI_TRANSFER_NOTHING && foreign->release_func)
+        return foreign->release_func(cx, self->transfer, in_arg);
+    return true;
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -1007,7 +1385,13 @@ static bool gjs_marshal_boxed_in_release(JSContext*, GjsArgumentCache* self,
 }
 
 static void gjs_arg_cache_interface_free(GjsArgumentCache* self) {
-    g_clear_pointer(&self->contents.object.info, g_base_info_unref);
+    g_clear_pointer(&self->cold->interface_info, g_base_info_unref);
+}
+
+static void gjs_arg_cache_enum_free(GjsArgumentCache* self) {
+    g_clear_pointer(&self->cold->interface_info, g_base_info_unref);
+    delete self->cold->enum_table;
+    self->cold->enum_table = nullptr;
 }
 
 static const GjsArgumentMarshallers skip_all_marshallers = {
@@ -1017,12 +1401,26 @@ static const GjsArgumentMarshallers skip_all_marshallers = {
 };
 
 // .in is ignored for the return value
+// Transfer-none UTF-8 return values; nothing to release
+static const GjsArgumentMarshallers string_return_transfer_none_marshallers = {
+    nullptr,  // no in
+    gjs_marshal_string_return_transfer_none_out,  // out
+    gjs_marshal_skipped_release,  // release
+};
+
 static const GjsArgumentMarshallers return_value_marshallers = {
     nullptr,  // no in
     gjs_marshal_generic_out_out,  // out
     gjs_marshal_generic_out_release,  // release
 };
 
+static const GjsArgumentMarshallers enum_return_marshallers = {
+    nullptr,  // no in
+    gjs_marshal_enum_out_out,  // out
+    gjs_marshal_skipped_release,  // release
+    gjs_arg_cache_enum_free,  // free
+};
+
 static const GjsArgumentMarshallers return_array_marshallers = {
     gjs_marshal_generic_out_in,  // in
     gjs_marshal_explicit_array_out_out,  // out
@@ -1060,6 +1458,13 @@ static const GjsArgumentMarshallers fallback_out_marshallers = {
     gjs_marshal_generic_out_release,  // release
 };
 
+static const GjsArgumentMarshallers enum_out_marshallers = {
+    gjs_marshal_generic_out_in,  // in
+    gjs_marshal_enum_out_out,  // out
+    gjs_marshal_skipped_release,  // release
+    gjs_arg_cache_enum_free,  // free
+};
+
 static const GjsArgumentMarshallers invalid_in_marshallers = {
     nullptr,  // no in, will cause the function invocation code to throw
     gjs_marshal_skipped_out,  // out
@@ -1215,6 +1620,20 @@ static const GjsArgumentMarshallers string_in_marshallers = {
 };
 
 static const GjsArgumentMarshallers string_in_transfer_none_marshallers = {
+    gjs_marshal_string_in_transfer_none_in,  // in
+    gjs_marshal_skipped_out,  // out
+    // The string is allocated in the call's arena, no release needed
+    gjs_marshal_skipped_release,  // release
+};
+
+static const GjsArgumentMarshallers strv_in_transfer_none_marshallers = {
+    gjs_marshal_strv_in_transfer_none_in,  // in
+    gjs_marshal_skipped_out,  // out
+    // The vector is allocated in the call's arena, no release needed
+    gjs_marshal_skipped_release,  // release
+};
+
+static const GjsArgumentMarshallers filename_in_transfer_none_marshallers = {
     gjs_marshal_string_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_string_in_release,  // release
@@ -1239,15 +1658,28 @@ static const GjsArgumentMarshallers callback_in_marshallers = {
     gjs_marshal_callback_release,  // release
 };
 
+static const GjsArgumentMarshallers async_ready_callback_in_marshallers = {
+    gjs_marshal_async_ready_callback_in,  // in
+    gjs_marshal_skipped_out,  // out
+    gjs_marshal_async_ready_callback_release,  // release
+};
+
 static const GjsArgumentMarshallers c_array_in_marshallers = {
     gjs_marshal_explicit_array_in_in,  // in
     gjs_marshal_skipped_out,  // out
     gjs_marshal_explicit_array_in_release,  // release
 };
 
+static const GjsArgumentMarshallers c_array_strv_in_marshallers = {
+    gjs_marshal_explicit_strv_in_transfer_none_in,  // in
+    gjs_marshal_skipped_out,  // out
+    // The vector is allocated in the call's arena, no release needed
+    gjs_marshal_skipped_release,  // release
+};
+
 static const GjsArgumentMarshallers c_array_inout_marshallers = {
     gjs_marshal_explicit_array_inout_in,  // in
-    gjs_marshal_explicit_array_out_out,  // out
+    gjs_marshal_explicit_array_inout_out,  // out
     gjs_marshal_explicit_array_inout_release,  // release
 };
 
@@ -1263,6 +1695,21 @@ static const GjsArgumentMarshallers caller_allocates_out_marshallers = {
     gjs_marshal_caller_allocates_release,  // release
 };
 
+// Sets up the validation table if the argument is an enum or flags type
+[[nodiscard]] static bool gjs_arg_cache_build_enum_table(
+    GjsArgumentCache* self) {
+    GjsAutoBaseInfo interface_info =
+        g_type_info_get_interface(self->type_info());
+    GIInfoType info_type = interface_info.type();
+    if (info_type != GI_INFO_TYPE_ENUM && info_type != GI_INFO_TYPE_FLAGS)
+        return false;
+
+    self->cold->enum_table =
+        gjs_enum_table_new(interface_info, info_type == GI_INFO_TYPE_FLAGS);
+    self->cold->interface_info = interface_info.release();
+    return true;
+}
+
 static inline void gjs_arg_cache_set_skip_all(GjsArgumentCache* self) {
     self->marshallers = &skip_all_marshallers;
     self->skip_in = self->skip_out = true;
@@ -1274,9 +1721,9 @@ bool gjs_arg_cache_build_return(JSContext*, GjsArgumentCache* self,
                                 bool* inc_counter_out) {
     g_assert(inc_counter_out && "forgot out parameter");
 
-    g_callable_info_load_return_type(callable, &self->type_info);
+    g_callable_info_load_return_type(callable, self->type_info());
 
-    if (g_type_info_get_tag(&self->type_info) == GI_TYPE_TAG_VOID) {
+    if (g_type_info_get_tag(self->type_info()) == GI_TYPE_TAG_VOID) {
         *inc_counter_out = false;
         gjs_arg_cache_set_skip_all(self);
         return true;
@@ -1286,8 +1733,8 @@ bool gjs_arg_cache_build_return(JSContext*, GjsArgumentCache* self,
     self->set_return_value();
     self->transfer = g_callable_info_get_caller_owns(callable);
 
-    if (g_type_info_get_tag(&self->type_info) == GI_TYPE_TAG_ARRAY) {
-        int length_pos = g_type_info_get_array_length(&self->type_info);
+    if (g_type_info_get_tag(self->type_info()) == GI_TYPE_TAG_ARRAY) {
+        int length_pos = g_type_info_get_array_length(self->type_info());
         if (length_pos >= 0) {
             gjs_arg_cache_set_skip_all(&arguments[length_pos]);
 
@@ -1315,9 +1762,74 @@ bool gjs_arg_cache_build_return(JSContext*, GjsArgumentCache* self,
     self->skip_in = true;
     self->marshallers = &return_value_marshallers;
 
+    // Keep the tag around so that scalar return values can be converted
+    // without going back to the type info
+    self->contents.number.number_tag = g_type_info_get_tag(self->type_info());
+
+    if (self->contents.number.number_tag == GI_TYPE_TAG_UTF8 &&
+        self->transfer == GI_TRANSFER_NOTHING)
+        self->marshallers = &string_return_transfer_none_marshallers;
+
+    if (self->contents.number.number_tag == GI_TYPE_TAG_INTERFACE &&
+        gjs_arg_cache_build_enum_table(self))
+        self->marshallers = &enum_return_marshallers;
+
     return true;
 }
 
+bool gjs_arg_cache_is_trivial_in(const GjsArgumentCache* self) {
+    if (self->skip_in || !self->skip_out)
+        return false;
+
+    if (self->arg_pos == GjsArgumentCache::INSTANCE_PARAM)
+        return self->marshallers == &object_in_marshallers &&
+               self->transfer == GI_TRANSFER_NOTHING;
+
+    return self->marshallers == &boolean_in_marshallers ||
+           self->marshallers == &integer_in_marshallers ||
+           self->marshallers == &number_in_marshallers ||
+           self->marshallers == &enum_in_marshallers ||
+           self->marshallers == &flags_in_marshallers;
+}
+
+bool gjs_arg_cache_is_trivial_return(const GjsArgumentCache* self) {
+    // void
+    if (self->skip_out)
+        return true;
+
+    if (self->marshallers != &return_value_marshallers)
+        return false;
+
+    switch (self->contents.number.number_tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+        case GI_TYPE_TAG_INT8:
+        case GI_TYPE_TAG_UINT8:
+        case GI_TYPE_TAG_INT16:
+        case GI_TYPE_TAG_UINT16:
+        case GI_TYPE_TAG_INT32:
+        case GI_TYPE_TAG_UINT32:
+        case GI_TYPE_TAG_FLOAT:
+        case GI_TYPE_TAG_DOUBLE:
+            return true;
+        default:
+            // 64-bit integers may need a rounding warning, and enums need
+            // validation, so leave them to the generic path
+            return false;
+    }
+}
+
+GITypeTag gjs_arg_cache_get_scalar_in_tag(const GjsArgumentCache* self) {
+    if (self->marshallers == &boolean_in_marshallers)
+        return GI_TYPE_TAG_BOOLEAN;
+    if (self->marshallers == &integer_in_marshallers ||
+        self->marshallers == &number_in_marshallers)
+        return self->contents.number.number_tag;
+    if (self->marshallers == &enum_in_marshallers ||
+        self->marshallers == &flags_in_marshallers)
+        return GI_TYPE_TAG_INTERFACE;
+    return GI_TYPE_TAG_VOID;
+}
+
 static void gjs_arg_cache_build_enum_bounds(GjsArgumentCache* self,
                                             GIEnumInfo* enum_info) {
     int64_t min = G_MAXINT64;
@@ -1376,7 +1888,8 @@ static bool gjs_arg_cache_build_interface_in_arg(JSContext* cx,
     // We do some transfer magic later, so let's ensure we don't mess up.
     // Should not happen in practice.
     if (G_UNLIKELY(self->transfer == GI_TRANSFER_CONTAINER))
-        return throw_not_introspectable_argument(cx, callable, self->arg_name);
+        return throw_not_introspectable_argument(cx, callable,
+                                                 self->arg_name());
 
     switch (interface_type) {
         case GI_INFO_TYPE_ENUM:
@@ -1391,6 +1904,12 @@ static bool gjs_arg_cache_build_interface_in_arg(JSContext* cx,
 
         case GI_INFO_TYPE_STRUCT:
             if (g_struct_info_is_foreign(interface_info)) {
+                // Look up the converter once here, instead of hashing the
+                // type's namespace and name in every call
+                self->contents.foreign_info =
+                    gjs_struct_foreign_lookup(cx, interface_info);
+                if (!self->contents.foreign_info)
+                    return false;
                 if (is_instance_param)
                     self->marshallers = &foreign_struct_instance_in_marshallers;
                 else
@@ -1404,7 +1923,7 @@ static bool gjs_arg_cache_build_interface_in_arg(JSContext* cx,
         case GI_INFO_TYPE_UNION: {
             GType gtype = g_registered_type_info_get_g_type(interface_info);
             self->contents.object.gtype = gtype;
-            self->contents.object.info = g_base_info_ref(interface_info);
+            self->cold->interface_info = g_base_info_ref(interface_info);
 
             // Transfer handling is a bit complex here, because some of our _in
             // marshallers know not to copy stuff if we don't need to.
@@ -1454,7 +1973,7 @@ static bool gjs_arg_cache_build_interface_in_arg(JSContext* cx,
                 if (gtype == G_TYPE_NONE) {
                     // Can't handle unions without a GType
                     return throw_not_introspectable_unboxed_type(
-                        cx, callable, self->arg_name);
+                        cx, callable, self->arg_name());
                 }
 
                 self->marshallers = &union_in_marshallers;
@@ -1476,7 +1995,7 @@ static bool gjs_arg_cache_build_interface_in_arg(JSContext* cx,
                 // Can't transfer ownership of a structure type not
                 // registered as a boxed
                 return throw_not_introspectable_unboxed_type(cx, callable,
-                                                             self->arg_name);
+                                                             self->arg_name());
             }
 
             self->marshallers = &boxed_in_marshallers;
@@ -1500,10 +2019,20 @@ static bool gjs_arg_cache_build_interface_in_arg(JSContext* cx,
             // Don't know how to handle this interface type (should not happen
             // in practice, for typelibs emitted by g-ir-compiler)
             return throw_not_introspectable_argument(cx, callable,
-                                                     self->arg_name);
+                                                     self->arg_name());
     }
 }
 
+// Whether the argument is a C array of UTF-8 strings that the callee only
+// borrows, so that it can be built in the call's arena
+[[nodiscard]] static bool is_transfer_none_strv(GjsArgumentCache* self) {
+    if (self->transfer != GI_TRANSFER_NOTHING)
+        return false;
+    GjsAutoTypeInfo param_info =
+        g_type_info_get_param_type(self->type_info(), 0);
+    return g_type_info_get_tag(param_info) == GI_TYPE_TAG_UTF8;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_arg_cache_build_normal_in_arg(JSContext* cx,
                                               GjsArgumentCache* self,
@@ -1564,7 +2093,7 @@ static bool gjs_arg_cache_build_normal_in_arg(JSContext* cx,
 
         case GI_TYPE_TAG_FILENAME:
             if (self->transfer == GI_TRANSFER_NOTHING)
-                self->marshallers = &string_in_transfer_none_marshallers;
+                self->marshallers = &filename_in_transfer_none_marshallers;
             else
                 self->marshallers = &string_in_marshallers;
             self->contents.string_is_filename = true;
@@ -1580,13 +2109,21 @@ static bool gjs_arg_cache_build_normal_in_arg(JSContext* cx,
 
         case GI_TYPE_TAG_INTERFACE: {
             GjsAutoBaseInfo interface_info =
-                g_type_info_get_interface(&self->type_info);
+                g_type_info_get_interface(self->type_info());
             return gjs_arg_cache_build_interface_in_arg(
                 cx, self, callable, interface_info,
                 /* is_instance_param = */ false);
         }
 
         case GI_TYPE_TAG_ARRAY:
+            if (g_type_info_get_array_type(self->type_info()) ==
+                    GI_ARRAY_TYPE_C &&
+                g_type_info_is_zero_terminated(self->type_info()) &&
+                is_transfer_none_strv(self)) {
+                self->marshallers = &strv_in_transfer_none_marshallers;
+                break;
+            }
+            [[fallthrough]];
         case GI_TYPE_TAG_GLIST:
         case GI_TYPE_TAG_GSLIST:
         case GI_TYPE_TAG_GHASH:
@@ -1638,8 +2175,8 @@ bool gjs_arg_cache_build_arg(JSContext* cx, GjsArgumentCache* self,
     g_assert(inc_counter_out && "forgot out parameter");
 
     self->set_arg_pos(gi_index);
-    self->arg_name = g_base_info_get_name(arg);
-    g_arg_info_load_type(arg, &self->type_info);
+    self->cold->arg_name = g_base_info_get_name(arg);
+    g_arg_info_load_type(arg, self->type_info());
     self->transfer = g_arg_info_get_ownership_transfer(arg);
     self->nullable = g_arg_info_may_be_null(arg);
 
@@ -1649,18 +2186,18 @@ bool gjs_arg_cache_build_arg(JSContext* cx, GjsArgumentCache* self,
         self->skip_in = true;
     *inc_counter_out = true;
 
-    GITypeTag type_tag = g_type_info_get_tag(&self->type_info);
+    GITypeTag type_tag = g_type_info_get_tag(self->type_info());
     if (direction == GI_DIRECTION_OUT && g_arg_info_is_caller_allocates(arg)) {
         if (type_tag != GI_TYPE_TAG_INTERFACE) {
             gjs_throw(cx,
                       "Unsupported type %s for argument %s with (out "
                       "caller-allocates)",
-                      g_type_tag_to_string(type_tag), self->arg_name);
+                      g_type_tag_to_string(type_tag), self->arg_name());
             return false;
         }
 
         GjsAutoBaseInfo interface_info =
-            g_type_info_get_interface(&self->type_info);
+            g_type_info_get_interface(self->type_info());
         g_assert(interface_info);
 
         GIInfoType interface_type = g_base_info_get_type(interface_info);
@@ -1674,7 +2211,7 @@ bool gjs_arg_cache_build_arg(JSContext* cx, GjsArgumentCache* self,
             gjs_throw(cx,
                       "Unsupported type %s for argument %s with (out "
                       "caller-allocates)",
-                      g_info_type_to_string(interface_type), self->arg_name);
+                      g_info_type_to_string(interface_type), self->arg_name());
             return false;
         }
 
@@ -1686,7 +2223,7 @@ bool gjs_arg_cache_build_arg(JSContext* cx, GjsArgumentCache* self,
 
     if (type_tag == GI_TYPE_TAG_INTERFACE) {
         GjsAutoBaseInfo interface_info =
-            g_type_info_get_interface(&self->type_info);
+            g_type_info_get_interface(self->type_info());
         if (interface_info.type() == GI_INFO_TYPE_CALLBACK) {
             if (direction != GI_DIRECTION_IN) {
                 // Can't do callbacks for out or inout
@@ -1694,7 +2231,7 @@ bool gjs_arg_cache_build_arg(JSContext* cx, GjsArgumentCache* self,
                           "Function %s.%s has a callback out-argument %s, not "
                           "supported",
                           g_base_info_get_namespace(callable),
-                          g_base_info_get_name(callable), self->arg_name);
+                          g_base_info_get_name(callable), self->arg_name());
                 return false;
             }
 
@@ -1732,6 +2269,12 @@ bool gjs_arg_cache_build_arg(JSContext* cx, GjsArgumentCache* self,
                 self->contents.callback.scope = g_arg_info_get_scope(arg);
                 self->set_callback_destroy_pos(destroy_pos);
                 self->set_callback_closure_pos(closure_pos);
+
+                if (closure_pos >= 0 &&
+                    self->contents.callback.scope == GI_SCOPE_TYPE_ASYNC &&
+                    strcmp(interface_info.name(), "AsyncReadyCallback") == 0 &&
+                    strcmp(interface_info.ns(), "Gio") == 0)
+                    self->marshallers = &async_ready_callback_in_marshallers;
             }
 
             return true;
@@ -1739,14 +2282,17 @@ bool gjs_arg_cache_build_arg(JSContext* cx, GjsArgumentCache* self,
     }
 
     if (type_tag == GI_TYPE_TAG_ARRAY &&
-        g_type_info_get_array_type(&self->type_info) == GI_ARRAY_TYPE_C) {
-        int length_pos = g_type_info_get_array_length(&self->type_info);
+        g_type_info_get_array_type(self->type_info()) == GI_ARRAY_TYPE_C) {
+        int length_pos = g_type_info_get_array_length(self->type_info());
 
         if (length_pos >= 0) {
             gjs_arg_cache_set_skip_all(&arguments[length_pos]);
 
             if (direction == GI_DIRECTION_IN) {
-                self->marshallers = &c_array_in_marshallers;
+                if (is_transfer_none_strv(self))
+                    self->marshallers = &c_array_strv_in_marshallers;
+                else
+                    self->marshallers = &c_array_in_marshallers;
             } else if (direction == GI_DIRECTION_INOUT) {
                 self->marshallers = &c_array_inout_marshallers;
             } else {
@@ -1781,8 +2327,15 @@ bool gjs_arg_cache_build_arg(JSContext* cx, GjsArgumentCache* self,
 
     if (direction == GI_DIRECTION_INOUT)
         self->marshallers = &fallback_inout_marshallers;
+    else if (type_tag == GI_TYPE_TAG_INTERFACE &&
+             gjs_arg_cache_build_enum_table(self))
+        self->marshallers = &enum_out_marshallers;
     else
         self->marshallers = &fallback_out_marshallers;
 
     return true;
 }
+
+bool gjs_arg_cache_is_async_ready_callback(const GjsArgumentCache* self) {
+    return self->marshallers == &async_ready_callback_in_marshallers;
+}
@@ -40,6 +40,8 @@
 
 struct GjsFunctionCallState;
 struct GjsArgumentCache;
+struct GjsEnumTable;
+struct GjsForeignInfo;
 
 struct GjsArgumentMarshallers {
     bool (*in)(JSContext* cx, GjsArgumentCache* cache,
@@ -54,17 +56,24 @@ struct GjsArgumentMarshallers {
     void (*free)(GjsArgumentCache* cache);
 };
 
-struct GjsArgumentCache {
-    const GjsArgumentMarshallers* marshallers;
+// Members of the argument cache that are not needed when marshalling scalars:
+// they are only used on error paths, for complex types, and while building the
+// cache. Keeping them out of line lets the hot part of each argument fit in 32
+// bytes.
+struct GjsArgumentCacheCold {
     const char* arg_name;
     GITypeInfo type_info;
 
-    uint8_t arg_pos;
-    bool skip_in : 1;
-    bool skip_out : 1;
-    GITransfer transfer : 2;
-    bool nullable : 1;
-    bool is_unsigned : 1;  // number and enum only
+    // boxed / union / GObject, and enum / flags out values
+    GIBaseInfo* interface_info;
+
+    // enum / flags out values
+    GjsEnumTable* enum_table;
+};
+
+struct GjsArgumentCache {
+    const GjsArgumentMarshallers* marshallers;
+    GjsArgumentCacheCold* cold;
 
     union {
         // for explicit array only
@@ -83,14 +92,13 @@ struct GjsArgumentCache {
             GITypeTag number_tag : 5;
         } number;
 
-        // boxed / union / GObject
+        // boxed / union / GObject (the info is in cold->interface_info)
         struct {
             GType gtype;
-            GIBaseInfo* info;
         } object;
 
-        // foreign structures
-        GIStructInfo* tmp_foreign_info;
+        // foreign structures, resolved when building the cache
+        GjsForeignInfo* foreign_info;
 
         // enum / flags
         struct {
@@ -106,6 +114,16 @@ struct GjsArgumentCache {
         size_t caller_allocates_size;
     } contents;
 
+    uint8_t arg_pos;
+    bool skip_in : 1;
+    bool skip_out : 1;
+    GITransfer transfer : 2;
+    bool nullable : 1;
+    bool is_unsigned : 1;  // number and enum only
+
+    [[nodiscard]] const char* arg_name() const { return cold->arg_name; }
+    [[nodiscard]] GITypeInfo* type_info() const { return &cold->type_info; }
+
     GJS_JSAPI_RETURN_CONVENTION
     bool handle_nullable(JSContext* cx, GIArgument* arg);
 
@@ -142,7 +160,7 @@ struct GjsArgumentCache {
 
     void set_instance_parameter() {
         arg_pos = INSTANCE_PARAM;
-        arg_name = "instance parameter";
+        cold->arg_name = "instance parameter";
         // Some calls accept null for the instance, but generally in an object
         // oriented language it's wrong to call a method on null
         nullable = false;
@@ -151,7 +169,7 @@ struct GjsArgumentCache {
 
     void set_return_value() {
         arg_pos = RETURN_VALUE;
-        arg_name = "return value";
+        cold->arg_name = "return value";
         nullable = false;  // We don't really care for return values
     }
     [[nodiscard]] bool is_return_value() { return arg_pos == RETURN_VALUE; }
@@ -167,10 +185,11 @@ struct GjsArgumentCache {
 // if sizeof(GjsArgumentCache) is increased.
 // Note that this check is not applicable for clang-cl builds, as Windows is
 // an LLP64 system
-static_assert(sizeof(GjsArgumentCache) <= 112,
+static_assert(sizeof(GjsArgumentCache) <= 32,
               "Think very hard before increasing the size of GjsArgumentCache. "
               "One is allocated for every argument to every introspected "
-              "function.");
+              "function, and it is touched on every call. Consider putting "
+              "new members in GjsArgumentCacheCold instead.");
 #endif  // x86-64 clang
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -189,4 +208,20 @@ GJS_JSAPI_RETURN_CONVENTION
 bool gjs_arg_cache_build_instance(JSContext* cx, GjsArgumentCache* self,
                                   GICallableInfo* callable);
 
+// Trivially marshallable arguments are scalars (or a GObject instance parameter
+// passed with transfer none) which need neither an out nor a release phase.
+// Functions consisting only of these will use a faster invoker in function.cpp.
+[[nodiscard]] bool gjs_arg_cache_is_trivial_in(const GjsArgumentCache* self);
+[[nodiscard]] bool gjs_arg_cache_is_trivial_return(
+    const GjsArgumentCache* self);
+// Returns the type tag that the in marshaller stores into the GIArgument for a
+// trivially marshallable argument, GI_TYPE_TAG_INTERFACE for 32-bit enums and
+// flags, or GI_TYPE_TAG_VOID if not a scalar.
+[[nodiscard]] GITypeTag gjs_arg_cache_get_scalar_in_tag(
+    const GjsArgumentCache* self);
+// Whether the argument is a GAsyncReadyCallback that may be left out of a call
+// to get a promise instead
+[[nodiscard]] bool gjs_arg_cache_is_async_ready_callback(
+    const GjsArgumentCache* self);
+
 #endif  // GI_ARG_CACHE_H_
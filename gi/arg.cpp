@@ -35,8 +35,10 @@
 #include <glib.h>
 
 #include <js/Array.h>
+#include <js/ArrayBuffer.h>  // for IsArrayBufferObject
 #include <js/CharacterEncoding.h>
 #include <js/Conversions.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/GCVector.h>            // for RootedVector, MutableWrappedPtrOp...
 #include <js/PropertyDescriptor.h>  // for JSPROP_ENUMERATE
 #include <js/RootingAPI.h>
@@ -45,7 +47,7 @@
 #include <js/Value.h>
 #include <js/ValueArray.h>
 #include <jsapi.h>        // for JS_ReportOutOfMemory, JS_GetElement
-#include <jsfriendapi.h>  // for JS_IsUint8Array, JS_GetObjectFunc...
+#include <jsfriendapi.h>  // for JS_IsUint8Array, JS_GetArrayBufferViewData...
 
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
@@ -65,6 +67,7 @@
 #include "cjs/context-private.h"
 #include "cjs/jsapi-util.h"
 #include "util/log.h"
+#include "util/text.h"
 
 bool _gjs_flags_value_is_valid(JSContext* context, GType gtype, int64_t value) {
     GFlagsValue *v;
@@ -699,6 +702,7 @@ gjs_object_to_g_hash(JSContext   *context,
     GjsAutoPointer<GHashTable, GHashTable, g_hash_table_destroy> result =
         create_hash_table_for_key_type(key_param_info);
 
+    GITypeTag val_type = g_type_info_get_tag(val_param_info);
     JS::RootedValue key_js(context), val_js(context);
     JS::RootedId cur_id(context);
     for (id_ix = 0, id_len = ids.length(); id_ix < id_len; ++id_ix) {
@@ -717,7 +721,6 @@ gjs_object_to_g_hash(JSContext   *context,
                                      true /* allow null */, &val_arg))
             return false;
 
-        GITypeTag val_type = g_type_info_get_tag(val_param_info);
         /* Use heap-allocated values for types that don't fit in a pointer */
         if (val_type == GI_TYPE_TAG_INT64) {
             val_ptr = heap_value_new_from_arg<int64_t>(&val_arg);
@@ -754,7 +757,7 @@ gjs_array_from_strv(JSContext             *context,
                     JS::MutableHandleValue value_p,
                     const char           **strv)
 {
-    guint i;
+    size_t length = 0;
     JS::RootedValueVector elems(context);
 
     /* We treat a NULL strv as an empty array, since this function should always
@@ -763,13 +766,20 @@ gjs_array_from_strv(JSContext             *context,
      * would need to always check for both an empty array and null if that was
      * the case.
      */
-    for (i = 0; strv != NULL && strv[i] != NULL; i++) {
-        if (!elems.growBy(1)) {
-            JS_ReportOutOfMemory(context);
-            return false;
-        }
+    if (strv)
+        length = g_strv_length(const_cast<char**>(strv));
+
+    if (!elems.resize(length)) {
+        JS_ReportOutOfMemory(context);
+        return false;
+    }
 
-        if (!gjs_string_from_utf8(context, strv[i], elems[i]))
+    // String vectors tend to repeat the same short values (style classes,
+    // MIME types, search paths), so look elements up in the string cache to
+    // share one JS string for each of them
+    GjsStringCache& cache = GjsContextPrivate::from_cx(context)->string_cache();
+    for (size_t i = 0; i < length; i++) {
+        if (!cache.get(context, strv[i], elems[i]))
             return false;
     }
 
@@ -888,64 +898,139 @@ gjs_array_to_gboolean_array(JSContext      *cx,
     return true;
 }
 
-GJS_JSAPI_RETURN_CONVENTION
-static bool
-gjs_array_to_intarray(JSContext   *context,
-                      JS::Value    array_value,
-                      unsigned int length,
-                      void       **arr_p,
-                      unsigned     intsize,
-                      bool         is_signed)
-{
-    /* nasty union types in an attempt to unify the various int types */
-    union { uint64_t u; int64_t i; } intval;
-    void *result;
-    unsigned i;
-    JS::RootedObject array(context, array_value.toObjectOrNull());
-    JS::RootedValue elem(context);
+// Converts the elements of a TypedArray of element type U into @dest, if
+// that gives the same result as converting each element to a JS number and
+// then to T. Returns false otherwise, so that the caller falls back to the
+// generic path.
+template <typename T, typename U>
+[[nodiscard]] static bool convert_typed_array_elements(const void* src,
+                                                       size_t length,
+                                                       T* dest) {
+    if constexpr (std::is_same_v<T, U>) {
+        memcpy(dest, src, length * sizeof(T));
+        return true;
+    } else if constexpr (std::is_floating_point_v<T> || std::is_integral_v<U>) {
+        // Simple enough loop for the compiler to vectorize the widening or
+        // narrowing conversion; integers are truncated just like the
+        // per-element path does
+        const U* elements = static_cast<const U*>(src);
+        for (size_t i = 0; i < length; i++)
+            dest[i] = static_cast<T>(elements[i]);
+        return true;
+    } else {
+        return false;
+    }
+}
 
-    /* add one so we're always zero terminated */
-    result = g_malloc0((length+1) * intsize);
+template <typename T>
+[[nodiscard]] static bool copy_from_typed_array(JSObject* array, size_t length,
+                                                T* dest) {
+    if (!JS_IsTypedArrayObject(array) ||
+        JS_GetTypedArrayLength(array) != length)
+        return false;
 
-    for (i = 0; i < length; ++i) {
-        bool success;
+    JS::AutoCheckCannotGC nogc;
+    bool is_shared_memory;
+    const void* data =
+        JS_GetArrayBufferViewData(array, &is_shared_memory, nogc);
+    if (is_shared_memory)
+        return false;
 
-        elem = JS::UndefinedValue();
-        if (!JS_GetElement(context, array, i, &elem)) {
-            g_free(result);
-            gjs_throw(context,
-                      "Missing array element %u",
-                      i);
+    switch (JS_GetArrayBufferViewType(array)) {
+        case js::Scalar::Int8:
+            return convert_typed_array_elements<T, int8_t>(data, length, dest);
+        case js::Scalar::Uint8:
+        case js::Scalar::Uint8Clamped:
+            return convert_typed_array_elements<T, uint8_t>(data, length, dest);
+        case js::Scalar::Int16:
+            return convert_typed_array_elements<T, int16_t>(data, length, dest);
+        case js::Scalar::Uint16:
+            return convert_typed_array_elements<T, uint16_t>(data, length,
+                                                             dest);
+        case js::Scalar::Int32:
+            return convert_typed_array_elements<T, int32_t>(data, length, dest);
+        case js::Scalar::Uint32:
+            return convert_typed_array_elements<T, uint32_t>(data, length,
+                                                             dest);
+        case js::Scalar::Float32:
+            return convert_typed_array_elements<T, float>(data, length, dest);
+        case js::Scalar::Float64:
+            return convert_typed_array_elements<T, double>(data, length, dest);
+        case js::Scalar::BigInt64:
+            // BigInts don't convert to numbers, so only allow a straight copy
+            if constexpr (std::is_same_v<T, int64_t>)
+                return convert_typed_array_elements<T, int64_t>(data, length,
+                                                                dest);
             return false;
-        }
-
-        /* do whatever sign extension is appropriate */
-        success = (is_signed) ?
-            JS::ToInt64(context, elem, &(intval.i)) :
-            JS::ToUint64(context, elem, &(intval.u));
+        case js::Scalar::BigUint64:
+            if constexpr (std::is_same_v<T, uint64_t>)
+                return convert_typed_array_elements<T, uint64_t>(data, length,
+                                                                 dest);
+            return false;
+        default:
+            return false;
+    }
+}
 
-        if (!success) {
-            g_free(result);
-            gjs_throw(context,
-                      "Invalid element in int array");
+template <typename T>
+GJS_JSAPI_RETURN_CONVENTION static bool value_to_array_element(
+    JSContext* cx, JS::HandleValue elem, T* out) {
+    if constexpr (std::is_floating_point_v<T>) {
+        double val;
+        if (!JS::ToNumber(cx, elem, &val))
             return false;
-        }
         /* Note that this is truncating assignment. */
-        switch (intsize) {
-        case 1:
-            ((guint8*)result)[i] = (gint8) intval.u; break;
-        case 2:
-            ((guint16*)result)[i] = (gint16) intval.u; break;
-        case 4:
-            ((guint32*)result)[i] = (gint32) intval.u; break;
-        case 8:
-            ((uint64_t *)result)[i] = (int64_t) intval.u; break;
-        default:
-            g_assert_not_reached();
+        *out = val;
+    } else {
+        // do whatever sign extension is appropriate
+        if (elem.isInt32()) {
+            *out = static_cast<T>(elem.toInt32());
+        } else if constexpr (std::is_signed_v<T>) {
+            int64_t val;
+            if (!JS::ToInt64(cx, elem, &val))
+                return false;
+            *out = static_cast<T>(val);
+        } else {
+            uint64_t val;
+            if (!JS::ToUint64(cx, elem, &val))
+                return false;
+            *out = static_cast<T>(val);
         }
     }
+    return true;
+}
 
-    *arr_p = result;
+// Converts a JS array-like of numbers into a newly allocated, zero-terminated
+// C array of T. TypedArrays are copied directly without going through JS
+// values.
+template <typename T>
+GJS_JSAPI_RETURN_CONVENTION static bool gjs_array_to_numeric_array(
+    JSContext* cx, JS::Value array_value, size_t length, void** arr_p) {
+    static_assert(std::is_arithmetic_v<T>, "Only for numeric C arrays");
+
+    /* add one so we're always zero terminated */
+    GjsAutoPointer<T, void, g_free> result = g_new0(T, length + 1);
+    JS::RootedObject array(cx, array_value.toObjectOrNull());
+
+    if (!copy_from_typed_array(array, length, result.get())) {
+        JS::RootedValue elem(cx);
+        for (size_t i = 0; i < length; ++i) {
+            elem = JS::UndefinedValue();
+            if (!JS_GetElement(cx, array, i, &elem)) {
+                gjs_throw(cx, "Missing array element %zu", i);
+                return false;
+            }
+
+            if (!value_to_array_element(cx, elem, &result[i])) {
+                gjs_throw(cx, std::is_integral_v<T>
+                                  ? "Invalid element in int array"
+                                  : "Invalid element in array");
+                return false;
+            }
+        }
+    }
+
+    *arr_p = result.release();
 
     return true;
 }
@@ -993,60 +1078,6 @@ gjs_gtypearray_to_array(JSContext   *context,
     return true;
 }
 
-GJS_JSAPI_RETURN_CONVENTION
-static bool
-gjs_array_to_floatarray(JSContext   *context,
-                        JS::Value    array_value,
-                        unsigned int length,
-                        void       **arr_p,
-                        bool         is_double)
-{
-    unsigned int i;
-    void *result;
-    JS::RootedObject array(context, array_value.toObjectOrNull());
-    JS::RootedValue elem(context);
-
-    /* add one so we're always zero terminated */
-    result = g_malloc0((length+1) * (is_double ? sizeof(double) : sizeof(float)));
-
-    for (i = 0; i < length; ++i) {
-        double val;
-        bool success;
-
-        elem = JS::UndefinedValue();
-        if (!JS_GetElement(context, array, i, &elem)) {
-            g_free(result);
-            gjs_throw(context,
-                      "Missing array element %u",
-                      i);
-            return false;
-        }
-
-        /* do whatever sign extension is appropriate */
-        success = JS::ToNumber(context, elem, &val);
-
-        if (!success) {
-            g_free(result);
-            gjs_throw(context,
-                      "Invalid element in array");
-            return false;
-        }
-
-        /* Note that this is truncating assignment. */
-        if (is_double) {
-            double *darray = (double*)result;
-            darray[i] = val;
-        } else {
-            float *farray = (float*)result;
-            farray[i] = val;
-        }
-    }
-
-    *arr_p = result;
-
-    return true;
-}
-
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_array_to_ptrarray(JSContext   *context,
@@ -1123,6 +1154,15 @@ static bool gjs_array_to_flat_struct_array(JSContext* cx,
 
     JS::RootedObject array(cx, &array_value.toObject());
     JS::RootedValue elem(cx);
+    JS::RootedObject elem_obj(cx);
+
+    // Arrays of structs are nearly always homogeneous. Once one element has
+    // gone through the full conversion and typecheck, elements wrapped by the
+    // same prototype can be copied without repeating them. The element is
+    // kept rooted so that its prototype stays alive during the loop.
+    JS::RootedObject checked_elem(cx);
+    const BoxedPrototype* checked_proto = nullptr;
+
     for (unsigned i = 0; i < length; i++) {
         elem = JS::UndefinedValue();
 
@@ -1131,6 +1171,16 @@ static bool gjs_array_to_flat_struct_array(JSContext* cx,
             return false;
         }
 
+        if (checked_proto && elem.isObject()) {
+            elem_obj = &elem.toObject();
+            void* ptr =
+                BoxedBase::ptr_if_instance_of(cx, elem_obj, checked_proto);
+            if (ptr) {
+                memcpy(&flat_array[struct_size * i], ptr, struct_size);
+                continue;
+            }
+        }
+
         GIArgument arg;
         if (!gjs_value_to_g_argument(cx, elem, param_info,
                                      /* arg_name = */ nullptr,
@@ -1141,6 +1191,12 @@ static bool gjs_array_to_flat_struct_array(JSContext* cx,
 
         memcpy(&flat_array[struct_size * i], gjs_arg_get<void*>(&arg),
                struct_size);
+
+        if (!checked_proto && info_type == GI_INFO_TYPE_STRUCT &&
+            elem.isObject()) {
+            checked_elem = &elem.toObject();
+            checked_proto = BoxedBase::prototype_of_instance(cx, checked_elem);
+        }
     }
 
     *arr_p = flat_array.release();
@@ -1265,8 +1321,6 @@ GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_array_to_array(JSContext* context, JS::HandleValue array_value,
                                size_t length, GITransfer transfer,
                                GITypeInfo* param_info, void** arr_p) {
-    enum { UNSIGNED=false, SIGNED=true };
-
     GITypeTag element_type = _g_type_info_get_storage_type(param_info);
 
     /* Special case for GValue "flat arrays" */
@@ -1279,38 +1333,38 @@ static bool gjs_array_to_array(JSContext* context, JS::HandleValue array_value,
     case GI_TYPE_TAG_BOOLEAN:
         return gjs_array_to_gboolean_array(context, array_value, length, arr_p);
     case GI_TYPE_TAG_UNICHAR:
-        return gjs_array_to_intarray(context, array_value, length, arr_p,
-            sizeof(gunichar), UNSIGNED);
+        return gjs_array_to_numeric_array<gunichar>(context, array_value,
+                                                    length, arr_p);
     case GI_TYPE_TAG_UINT8:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 1, UNSIGNED);
+        return gjs_array_to_numeric_array<uint8_t>(context, array_value,
+                                                   length, arr_p);
     case GI_TYPE_TAG_INT8:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 1, SIGNED);
+        return gjs_array_to_numeric_array<int8_t>(context, array_value, length,
+                                                  arr_p);
     case GI_TYPE_TAG_UINT16:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 2, UNSIGNED);
+        return gjs_array_to_numeric_array<uint16_t>(context, array_value,
+                                                    length, arr_p);
     case GI_TYPE_TAG_INT16:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 2, SIGNED);
+        return gjs_array_to_numeric_array<int16_t>(context, array_value,
+                                                   length, arr_p);
     case GI_TYPE_TAG_UINT32:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 4, UNSIGNED);
+        return gjs_array_to_numeric_array<uint32_t>(context, array_value,
+                                                    length, arr_p);
     case GI_TYPE_TAG_INT32:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 4, SIGNED);
+        return gjs_array_to_numeric_array<int32_t>(context, array_value,
+                                                   length, arr_p);
     case GI_TYPE_TAG_INT64:
-        return gjs_array_to_intarray(context, array_value, length, arr_p, 8,
-            SIGNED);
+        return gjs_array_to_numeric_array<int64_t>(context, array_value,
+                                                   length, arr_p);
     case GI_TYPE_TAG_UINT64:
-        return gjs_array_to_intarray(context, array_value, length, arr_p, 8,
-            UNSIGNED);
+        return gjs_array_to_numeric_array<uint64_t>(context, array_value,
+                                                    length, arr_p);
     case GI_TYPE_TAG_FLOAT:
-        return gjs_array_to_floatarray
-            (context, array_value, length, arr_p, false);
+        return gjs_array_to_numeric_array<float>(context, array_value, length,
+                                                 arr_p);
     case GI_TYPE_TAG_DOUBLE:
-        return gjs_array_to_floatarray
-            (context, array_value, length, arr_p, true);
+        return gjs_array_to_numeric_array<double>(context, array_value, length,
+                                                  arr_p);
     case GI_TYPE_TAG_GTYPE:
         return gjs_gtypearray_to_array
             (context, array_value, length, arr_p);
@@ -1412,6 +1466,74 @@ gjs_g_array_new_for_type(JSContext    *context,
     return g_array_sized_new(true, false, element_size, length);
 }
 
+// Copies the bytes of any ArrayBuffer or ArrayBuffer view (TypedArray or
+// DataView) into a new GByteArray in one block. Returns null if @obj is none
+// of those.
+[[nodiscard]] static GByteArray* byte_array_from_buffer_object(JSObject* obj) {
+    uint32_t length;
+    bool is_shared_memory;
+    uint8_t* data;
+
+    if (JS::IsArrayBufferObject(obj))
+        JS::GetArrayBufferLengthAndData(obj, &length, &is_shared_memory, &data);
+    else if (JS_IsArrayBufferViewObject(obj))
+        js::GetArrayBufferViewLengthAndData(obj, &length, &is_shared_memory,
+                                            &data);
+    else
+        return nullptr;
+
+    GByteArray* byte_array = g_byte_array_sized_new(length);
+    g_byte_array_append(byte_array, data, length);
+    return byte_array;
+}
+
+template <typename T>
+[[nodiscard]] static GArray* garray_from_typed_array(JSObject* obj) {
+    uint32_t length = JS_GetTypedArrayLength(obj);
+    GArray* array = g_array_sized_new(true, false, sizeof(T), length);
+    g_array_set_size(array, length);
+    if (!copy_from_typed_array(obj, length, reinterpret_cast<T*>(array->data))) {
+        g_array_unref(array);
+        return nullptr;
+    }
+    return array;
+}
+
+// Fills a new GArray straight from the contents of a TypedArray, without
+// converting each element to a JS value and back. Returns null if @obj is not
+// a TypedArray whose elements convert directly to @param_info.
+[[nodiscard]] static GArray* garray_from_typed_array(JSObject* obj,
+                                                     GITypeInfo* param_info) {
+    if (!JS_IsTypedArrayObject(obj))
+        return nullptr;
+
+    switch (_g_type_info_get_storage_type(param_info)) {
+        case GI_TYPE_TAG_INT8:
+            return garray_from_typed_array<int8_t>(obj);
+        case GI_TYPE_TAG_UINT8:
+            return garray_from_typed_array<uint8_t>(obj);
+        case GI_TYPE_TAG_INT16:
+            return garray_from_typed_array<int16_t>(obj);
+        case GI_TYPE_TAG_UINT16:
+            return garray_from_typed_array<uint16_t>(obj);
+        case GI_TYPE_TAG_INT32:
+            return garray_from_typed_array<int32_t>(obj);
+        case GI_TYPE_TAG_UINT32:
+        case GI_TYPE_TAG_UNICHAR:
+            return garray_from_typed_array<uint32_t>(obj);
+        case GI_TYPE_TAG_INT64:
+            return garray_from_typed_array<int64_t>(obj);
+        case GI_TYPE_TAG_UINT64:
+            return garray_from_typed_array<uint64_t>(obj);
+        case GI_TYPE_TAG_FLOAT:
+            return garray_from_typed_array<float>(obj);
+        case GI_TYPE_TAG_DOUBLE:
+            return garray_from_typed_array<double>(obj);
+        default:
+            return nullptr;
+    }
+}
+
 char* gjs_argument_display_name(const char* arg_name,
                                 GjsArgumentType arg_type) {
     switch (arg_type) {
@@ -2120,18 +2242,31 @@ _Pragma("GCC diagnostic pop")
         gsize length;
         GIArrayType array_type = g_type_info_get_array_type(type_info);
 
-        /* First, let's handle the case where we're passed an instance
-         * of Uint8Array and it needs to be marshalled to GByteArray.
+        /* First, let's handle the case where we're passed binary data,
+         * such as an instance of Uint8Array, that can be copied into a
+         * GByteArray or GArray in one go.
          */
         if (value.isObject()) {
-            JSObject* bytearray_obj = &value.toObject();
-            if (JS_IsUint8Array(bytearray_obj) &&
-                array_type == GI_ARRAY_TYPE_BYTE_ARRAY) {
-                gjs_arg_set(arg, gjs_byte_array_get_byte_array(bytearray_obj));
-                break;
-            } else {
-                /* Fall through, !handled */
+            JSObject* buffer_obj = &value.toObject();
+            if (array_type == GI_ARRAY_TYPE_BYTE_ARRAY) {
+                GByteArray* byte_array =
+                    JS_IsUint8Array(buffer_obj)
+                        ? gjs_byte_array_get_byte_array(buffer_obj)
+                        : byte_array_from_buffer_object(buffer_obj);
+                if (byte_array) {
+                    gjs_arg_set(arg, byte_array);
+                    break;
+                }
+            } else if (array_type == GI_ARRAY_TYPE_ARRAY) {
+                GjsAutoTypeInfo param_info =
+                    g_type_info_get_param_type(type_info, 0);
+                GArray* array = garray_from_typed_array(buffer_obj, param_info);
+                if (array) {
+                    gjs_arg_set(arg, array);
+                    break;
+                }
             }
+            /* Fall through, !handled */
         }
 
         if (!gjs_array_to_explicit_array(context, value, type_info, arg_name,
@@ -2326,6 +2461,32 @@ gjs_value_to_arg(JSContext      *context,
                                    arg);
 }
 
+// Converts the elements of a GList or GSList into @elems, which is sized once
+// up front rather than grown element by element
+template <typename List>
+GJS_JSAPI_RETURN_CONVENTION static bool fill_vector_from_list(
+    JSContext* cx, JS::RootedValueVector& elems,  // NOLINT(runtime/references)
+    GITypeInfo* param_info, List* list) {
+    size_t length = 0;
+    for (List* l = list; l; l = l->next)
+        length++;
+
+    if (!elems.resize(length)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+
+    GIArgument arg;
+    size_t i = 0;
+    for (List* l = list; l; l = l->next, i++) {
+        _g_type_info_argument_from_hash_pointer(param_info, l->data, &arg);
+        if (!gjs_value_from_g_argument(cx, elems[i], param_info, &arg, true))
+            return false;
+    }
+
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_array_from_g_list (JSContext             *context,
@@ -2335,39 +2496,14 @@ gjs_array_from_g_list (JSContext             *context,
                        GList                 *list,
                        GSList                *slist)
 {
-    unsigned int i;
-    GArgument arg;
     JS::RootedValueVector elems(context);
 
-    i = 0;
     if (list_tag == GI_TYPE_TAG_GLIST) {
-        for ( ; list != NULL; list = list->next) {
-            _g_type_info_argument_from_hash_pointer(param_info, list->data,
-                                                    &arg);
-            if (!elems.growBy(1)) {
-                JS_ReportOutOfMemory(context);
-                return false;
-            }
-
-            if (!gjs_value_from_g_argument(context, elems[i], param_info, &arg,
-                                           true))
-                return false;
-            ++i;
-        }
+        if (!fill_vector_from_list(context, elems, param_info, list))
+            return false;
     } else {
-        for ( ; slist != NULL; slist = slist->next) {
-            _g_type_info_argument_from_hash_pointer(param_info, slist->data,
-                                                    &arg);
-            if (!elems.growBy(1)) {
-                JS_ReportOutOfMemory(context);
-                return false;
-            }
-
-            if (!gjs_value_from_g_argument(context, elems[i], param_info, &arg,
-                                           true))
-                return false;
-            ++i;
-        }
+        if (!fill_vector_from_list(context, elems, param_info, slist))
+            return false;
     }
 
     JS::RootedObject obj(context, JS::NewArrayObject(context, elems));
@@ -2383,6 +2519,22 @@ template <typename T, GITypeTag TAG = GI_TYPE_TAG_VOID>
 GJS_JSAPI_RETURN_CONVENTION static bool fill_vector_from_carray(
     JSContext* cx, JS::RootedValueVector& elems,  // NOLINT(runtime/references)
     GITypeInfo* param_info, GIArgument* arg, void* array, size_t length) {
+    // Numbers that always fit in a JS number are converted directly, without
+    // a round trip through GIArgument
+    if constexpr (TAG == GI_TYPE_TAG_VOID && std::is_arithmetic_v<T> &&
+                  (std::is_floating_point_v<T> || sizeof(T) <= 4)) {
+        const T* elements = static_cast<const T*>(array);
+        for (size_t i = 0; i < length; i++) {
+            if constexpr (std::is_integral_v<T> && sizeof(T) < 4)
+                elems[i].setInt32(elements[i]);
+            else if constexpr (std::is_same_v<T, int32_t>)
+                elems[i].setInt32(elements[i]);
+            else
+                elems[i].setNumber(elements[i]);
+        }
+        return true;
+    }
+
     for (size_t i = 0; i < length; i++) {
         gjs_arg_set<T, TAG>(arg, *(static_cast<T*>(array) + i));
 
@@ -2495,8 +2647,9 @@ gjs_array_from_carray_internal (JSContext             *context,
                 return false;
             break;
         case GI_TYPE_TAG_INTERFACE: {
-            GIBaseInfo *interface_info = g_type_info_get_interface (param_info);
-            GIInfoType info_type = g_base_info_get_type (interface_info);
+            GjsAutoBaseInfo interface_info =
+                g_type_info_get_interface(param_info);
+            GIInfoType info_type = interface_info.type();
 
             if (array_type != GI_ARRAY_TYPE_PTR_ARRAY &&
                 (info_type == GI_INFO_TYPE_STRUCT ||
@@ -2509,24 +2662,58 @@ gjs_array_from_carray_internal (JSContext             *context,
                 else
                     struct_size = g_struct_info_get_size(interface_info);
 
+                // Plain structs (points, rectangles, colors) are always
+                // copied into a new boxed wrapper, so skip the per-element
+                // type dispatch in gjs_value_from_g_argument()
+                GType gtype = g_registered_type_info_get_g_type(interface_info);
+                bool plain_struct =
+                    info_type == GI_INFO_TYPE_STRUCT &&
+                    !g_struct_info_is_foreign(interface_info) &&
+                    !g_struct_info_is_gtype_struct(interface_info) &&
+                    !g_type_is_a(gtype, G_TYPE_VALUE) &&
+                    !g_type_is_a(gtype, G_TYPE_ERROR) &&
+                    !is_gdk_atom(interface_info);
+
                 for (i = 0; i < length; i++) {
-                    gjs_arg_set(&arg,
-                                static_cast<char*>(array) + (struct_size * i));
+                    void* element = static_cast<char*>(array) + struct_size * i;
+
+                    if (plain_struct) {
+                        JSObject* obj = BoxedInstance::new_for_c_struct(
+                            context, interface_info, element);
+                        if (!obj)
+                            return false;
+                        elems[i].setObject(*obj);
+                        continue;
+                    }
 
+                    gjs_arg_set(&arg, element);
                     if (!gjs_value_from_g_argument(context, elems[i], param_info,
                                                    &arg, true))
                         return false;
                 }
 
-                g_base_info_unref(interface_info);
                 break;
             }
 
-            g_base_info_unref(interface_info);
+            // Pointers to objects, boxed types and the like
+            if (!fill_vector_from_carray<void*>(context, elems, param_info,
+                                                &arg, array, length))
+                return false;
+            break;
+        }
+        case GI_TYPE_TAG_UTF8: {
+            GjsStringCache& cache =
+                GjsContextPrivate::from_cx(context)->string_cache();
+            for (i = 0; i < length; i++) {
+                const char* str = static_cast<char**>(array)[i];
+                if (!str)
+                    elems[i].setNull();
+                else if (!cache.get(context, str, elems[i]))
+                    return false;
+            }
+            break;
         }
-        /* fallthrough */
         case GI_TYPE_TAG_GTYPE:
-        case GI_TYPE_TAG_UTF8:
         case GI_TYPE_TAG_FILENAME:
         case GI_TYPE_TAG_ARRAY:
         case GI_TYPE_TAG_GLIST:
@@ -2598,6 +2785,168 @@ gjs_value_from_explicit_array(JSContext             *context,
     return res;
 }
 
+// Whether numeric C arrays returned with ownership transferred to us should
+// come out as TypedArrays wrapping the C memory, instead of as JS Arrays.
+// Arrays of guint8 are always TypedArrays, so they are always handed over.
+[[nodiscard]] static bool typed_array_return_values_enabled() {
+    static const bool enabled = g_getenv("GJS_TYPED_ARRAY_RETURN_VALUES");
+    return enabled;
+}
+
+// Wraps @array_buffer in a TypedArray with elements of the C type T
+template <typename T>
+[[nodiscard]] static JSObject* new_typed_array_with_buffer(
+    JSContext* cx, JS::HandleObject array_buffer) {
+    if constexpr (std::is_same_v<T, int8_t>)
+        return JS_NewInt8ArrayWithBuffer(cx, array_buffer, 0, -1);
+    else if constexpr (std::is_same_v<T, int16_t>)
+        return JS_NewInt16ArrayWithBuffer(cx, array_buffer, 0, -1);
+    else if constexpr (std::is_same_v<T, uint16_t>)
+        return JS_NewUint16ArrayWithBuffer(cx, array_buffer, 0, -1);
+    else if constexpr (std::is_same_v<T, int32_t>)
+        return JS_NewInt32ArrayWithBuffer(cx, array_buffer, 0, -1);
+    else if constexpr (std::is_same_v<T, uint32_t>)
+        return JS_NewUint32ArrayWithBuffer(cx, array_buffer, 0, -1);
+    else if constexpr (std::is_same_v<T, float>)
+        return JS_NewFloat32ArrayWithBuffer(cx, array_buffer, 0, -1);
+    else if constexpr (std::is_same_v<T, double>)
+        return JS_NewFloat64ArrayWithBuffer(cx, array_buffer, 0, -1);
+}
+
+// Takes ownership of @array, a g_malloc()ed C array of @length elements of
+// type T, and exposes it as a TypedArray without copying. @array is freed
+// even on failure.
+template <typename T>
+GJS_JSAPI_RETURN_CONVENTION static bool typed_array_from_owned_carray(
+    JSContext* cx, JS::MutableHandleValue value_p, void* array,
+    size_t length) {
+    JS::RootedObject array_buffer(
+        cx, gjs_array_buffer_from_owned_data(cx, length * sizeof(T), array));
+    if (!array_buffer)
+        return false;
+
+    JSObject* obj = new_typed_array_with_buffer<T>(cx, array_buffer);
+    if (!obj)
+        return false;
+
+    value_p.setObject(*obj);
+    return true;
+}
+
+bool gjs_value_from_owned_explicit_array(JSContext* cx,
+                                         JS::MutableHandleValue value_p,
+                                         GITypeInfo* type_info, GIArgument* arg,
+                                         int length) {
+    void* array = gjs_arg_get<void*>(arg);
+    if (!array || length <= 0 ||
+        g_type_info_get_array_type(type_info) != GI_ARRAY_TYPE_C)
+        return gjs_value_from_explicit_array(cx, value_p, type_info, arg,
+                                             length);
+
+    GjsAutoTypeInfo param_info = g_type_info_get_param_type(type_info, 0);
+    GITypeTag element_type = g_type_info_get_tag(param_info);
+
+    if (element_type == GI_TYPE_TAG_UINT8) {
+        gjs_arg_unset<void*>(arg);
+        JSObject* obj = gjs_byte_array_from_owned_data(cx, length, array);
+        if (!obj)
+            return false;
+        value_p.setObject(*obj);
+        return true;
+    }
+
+    if (!typed_array_return_values_enabled())
+        return gjs_value_from_explicit_array(cx, value_p, type_info, arg,
+                                             length);
+
+    // 64-bit integers are left out, since the matching TypedArrays hold
+    // BigInts, which don't mix with the numbers that GJS uses elsewhere
+    switch (element_type) {
+        case GI_TYPE_TAG_INT8:
+            gjs_arg_unset<void*>(arg);
+            return typed_array_from_owned_carray<int8_t>(cx, value_p, array,
+                                                         length);
+        case GI_TYPE_TAG_INT16:
+            gjs_arg_unset<void*>(arg);
+            return typed_array_from_owned_carray<int16_t>(cx, value_p, array,
+                                                          length);
+        case GI_TYPE_TAG_UINT16:
+            gjs_arg_unset<void*>(arg);
+            return typed_array_from_owned_carray<uint16_t>(cx, value_p, array,
+                                                           length);
+        case GI_TYPE_TAG_INT32:
+            gjs_arg_unset<void*>(arg);
+            return typed_array_from_owned_carray<int32_t>(cx, value_p, array,
+                                                          length);
+        case GI_TYPE_TAG_UINT32:
+            gjs_arg_unset<void*>(arg);
+            return typed_array_from_owned_carray<uint32_t>(cx, value_p, array,
+                                                           length);
+        case GI_TYPE_TAG_FLOAT:
+            gjs_arg_unset<void*>(arg);
+            return typed_array_from_owned_carray<float>(cx, value_p, array,
+                                                        length);
+        case GI_TYPE_TAG_DOUBLE:
+            gjs_arg_unset<void*>(arg);
+            return typed_array_from_owned_carray<double>(cx, value_p, array,
+                                                         length);
+        default:
+            return gjs_value_from_explicit_array(cx, value_p, type_info, arg,
+                                                 length);
+    }
+}
+
+// Copies @array, a C array of @length elements of type T that the caller
+// keeps owning, and exposes the copy as a TypedArray.
+template <typename T>
+GJS_JSAPI_RETURN_CONVENTION static bool typed_array_from_carray_copy(
+    JSContext* cx, JS::MutableHandleValue value_p, const void* array,
+    size_t length) {
+    void* copy = g_malloc(length * sizeof(T));
+    memcpy(copy, array, length * sizeof(T));
+    return typed_array_from_owned_carray<T>(cx, value_p, copy, length);
+}
+
+bool gjs_value_from_borrowed_explicit_array(JSContext* cx,
+                                            JS::MutableHandleValue value_p,
+                                            GITypeInfo* type_info,
+                                            GIArgument* arg, int length) {
+    void* array = gjs_arg_get<void*>(arg);
+    if (!array || length <= 0 || !typed_array_return_values_enabled() ||
+        g_type_info_get_array_type(type_info) != GI_ARRAY_TYPE_C)
+        return gjs_value_from_explicit_array(cx, value_p, type_info, arg,
+                                             length);
+
+    GjsAutoTypeInfo param_info = g_type_info_get_param_type(type_info, 0);
+    switch (g_type_info_get_tag(param_info)) {
+        case GI_TYPE_TAG_INT8:
+            return typed_array_from_carray_copy<int8_t>(cx, value_p, array,
+                                                        length);
+        case GI_TYPE_TAG_INT16:
+            return typed_array_from_carray_copy<int16_t>(cx, value_p, array,
+                                                         length);
+        case GI_TYPE_TAG_UINT16:
+            return typed_array_from_carray_copy<uint16_t>(cx, value_p, array,
+                                                          length);
+        case GI_TYPE_TAG_INT32:
+            return typed_array_from_carray_copy<int32_t>(cx, value_p, array,
+                                                         length);
+        case GI_TYPE_TAG_UINT32:
+            return typed_array_from_carray_copy<uint32_t>(cx, value_p, array,
+                                                          length);
+        case GI_TYPE_TAG_FLOAT:
+            return typed_array_from_carray_copy<float>(cx, value_p, array,
+                                                       length);
+        case GI_TYPE_TAG_DOUBLE:
+            return typed_array_from_carray_copy<double>(cx, value_p, array,
+                                                        length);
+        default:
+            // Including guint8, which already comes out as a Uint8Array copy
+            return gjs_value_from_explicit_array(cx, value_p, type_info, arg,
+                                                 length);
+    }
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_array_from_boxed_array (JSContext             *context,
@@ -2685,12 +3034,17 @@ gjs_array_from_zero_terminated_c_array (JSContext             *context,
     if (element_type == GI_TYPE_TAG_UNICHAR)
         return gjs_string_from_ucs4(context, (gunichar *) c_array, -1, value_p);
 
+    if (element_type == GI_TYPE_TAG_UTF8)
+        return gjs_array_from_strv(context, value_p,
+                                   static_cast<const char**>(c_array));
+
     JS::RootedValueVector elems(context);
 
     switch (element_type) {
         /* Special cases handled above. */
         case GI_TYPE_TAG_UINT8:
         case GI_TYPE_TAG_UNICHAR:
+        case GI_TYPE_TAG_UTF8:
             g_assert_not_reached();
         case GI_TYPE_TAG_INT8:
             if (!fill_vector_from_zero_terminated_carray<int8_t>(
@@ -2738,7 +3092,6 @@ gjs_array_from_zero_terminated_c_array (JSContext             *context,
                 return false;
             break;
         case GI_TYPE_TAG_GTYPE:
-        case GI_TYPE_TAG_UTF8:
         case GI_TYPE_TAG_FILENAME:
         case GI_TYPE_TAG_ARRAY:
         case GI_TYPE_TAG_INTERFACE:
@@ -2770,6 +3123,25 @@ gjs_array_from_zero_terminated_c_array (JSContext             *context,
     return true;
 }
 
+// Converts a UTF-8 hash table key to a property key. Keys are mostly ASCII,
+// which can be atomized directly without decoding to UTF-16 first.
+GJS_JSAPI_RETURN_CONVENTION
+static bool utf8_to_id(JSContext* cx, const char* utf8,
+                       JS::MutableHandleId id_p) {
+    size_t len = strlen(utf8);
+    JS::RootedString str(cx);
+    if (gjs_text_is_ascii(utf8, len)) {
+        str = JS_AtomizeStringN(cx, utf8, len);
+    } else {
+        JS::RootedValue v_str(cx);
+        if (!gjs_string_from_utf8_n(cx, utf8, len, &v_str))
+            return false;
+        str = v_str.toString();
+    }
+
+    return str && JS_StringToId(cx, str, id_p);
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 gjs_object_from_g_hash (JSContext             *context,
@@ -2793,37 +3165,52 @@ gjs_object_from_g_hash (JSContext             *context,
 
     value_p.setObject(*obj);
 
+    // String keys and values, as in a{ss}-like tables, are by far the most
+    // common, so convert them directly instead of through GIArgument
+    bool utf8_keys = g_type_info_get_tag(key_param_info) == GI_TYPE_TAG_UTF8;
+    bool utf8_values = g_type_info_get_tag(val_param_info) == GI_TYPE_TAG_UTF8;
+
     JS::RootedValue keyjs(context), valjs(context);
     JS::RootedString keystr(context);
+    JS::RootedId keyid(context);
 
     g_hash_table_iter_init(&iter, hash);
     void* key_pointer;
     void* val_pointer;
     while (g_hash_table_iter_next(&iter, &key_pointer, &val_pointer)) {
-        _g_type_info_argument_from_hash_pointer(key_param_info, key_pointer,
-                                                &keyarg);
-        if (!gjs_value_from_g_argument(context, &keyjs,
-                                       key_param_info, &keyarg,
-                                       true))
-            return false;
-
-        keystr = JS::ToString(context, keyjs);
-        if (!keystr)
-            return false;
+        if (utf8_keys && key_pointer) {
+            if (!utf8_to_id(context, static_cast<const char*>(key_pointer),
+                            &keyid))
+                return false;
+        } else {
+            _g_type_info_argument_from_hash_pointer(key_param_info,
+                                                    key_pointer, &keyarg);
+            if (!gjs_value_from_g_argument(context, &keyjs, key_param_info,
+                                           &keyarg, true))
+                return false;
 
-        JS::UniqueChars keyutf8(JS_EncodeStringToUTF8(context, keystr));
-        if (!keyutf8)
-            return false;
+            keystr = JS::ToString(context, keyjs);
+            if (!keystr || !JS_StringToId(context, keystr, &keyid))
+                return false;
+        }
 
-        _g_type_info_argument_from_hash_pointer(val_param_info, val_pointer,
-                                                &valarg);
-        if (!gjs_value_from_g_argument(context, &valjs,
-                                       val_param_info, &valarg,
-                                       true))
-            return false;
+        if (utf8_values) {
+            if (!val_pointer)
+                valjs.setNull();
+            else if (!gjs_string_from_utf8(
+                         context, static_cast<const char*>(val_pointer),
+                         &valjs))
+                return false;
+        } else {
+            _g_type_info_argument_from_hash_pointer(val_param_info,
+                                                    val_pointer, &valarg);
+            if (!gjs_value_from_g_argument(context, &valjs, val_param_info,
+                                           &valarg, true))
+                return false;
+        }
 
-        if (!JS_DefineProperty(context, obj, keyutf8.get(), valjs,
-                               JSPROP_ENUMERATE))
+        if (!JS_DefinePropertyById(context, obj, keyid, valjs,
+                                   JSPROP_ENUMERATE))
             return false;
     }
 
@@ -89,6 +89,26 @@ bool gjs_value_from_explicit_array(JSContext             *context,
                                    GIArgument            *arg,
                                    int                    length);
 
+// Like gjs_value_from_explicit_array(), for an array whose ownership was
+// transferred to the caller. Numeric arrays that can be exposed to JS without
+// copying are taken over, in which case the pointer in @arg is cleared so
+// that releasing @arg afterwards does not free them.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_value_from_owned_explicit_array(JSContext* cx,
+                                         JS::MutableHandleValue value_p,
+                                         GITypeInfo* type_info, GIArgument* arg,
+                                         int length);
+
+// Like gjs_value_from_explicit_array(), for an array that the caller keeps
+// owning, such as a signal argument. Where
+// gjs_value_from_owned_explicit_array() would take a numeric array over as a
+// TypedArray, this copies it into one instead, in a single pass.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_value_from_borrowed_explicit_array(JSContext* cx,
+                                            JS::MutableHandleValue value_p,
+                                            GITypeInfo* type_info,
+                                            GIArgument* arg, int length);
+
 GJS_JSAPI_RETURN_CONVENTION
 bool gjs_g_argument_release    (JSContext  *context,
                                 GITransfer  transfer,
@@ -24,7 +24,7 @@
 #include <config.h>
 
 #include <stdint.h>
-#include <string.h>  // for memcpy, size_t, strcmp
+#include <string.h>  // for memcpy, memset, size_t, strcmp
 
 #include <string>       // for string
 #include <type_traits>  // for remove_reference
@@ -55,6 +55,7 @@
 #include "cjs/context-private.h"
 #include "cjs/jsapi-class.h"
 #include "cjs/mem-private.h"
+#include "cjs/slab.h"
 #include "util/log.h"
 
 BoxedInstance::BoxedInstance(JSContext* cx, JS::HandleObject obj)
@@ -66,6 +67,7 @@ BoxedInstance::BoxedInstance(JSContext* cx, JS::HandleObject obj)
 }
 
 [[nodiscard]] static bool struct_is_simple(GIStructInfo* info);
+[[nodiscard]] static bool struct_is_plain_data(GIStructInfo* info);
 
 // See GIWrapperBase::resolve().
 bool BoxedPrototype::resolve_impl(JSContext* cx, JS::HandleObject obj,
@@ -149,6 +151,22 @@ BoxedBase* BoxedBase::get_copy_source(JSContext* context,
     return source_priv;
 }
 
+const BoxedPrototype* BoxedBase::prototype_of_instance(JSContext* cx,
+                                                       JS::HandleObject obj) {
+    BoxedBase* priv = BoxedBase::for_js(cx, obj);
+    if (!priv || priv->is_prototype())
+        return nullptr;
+    return priv->get_prototype();
+}
+
+void* BoxedBase::ptr_if_instance_of(JSContext* cx, JS::HandleObject obj,
+                                    const BoxedPrototype* proto) {
+    BoxedBase* priv = BoxedBase::for_js(cx, obj);
+    if (!priv || priv->is_prototype() || priv->get_prototype() != proto)
+        return nullptr;
+    return priv->to_instance()->ptr();
+}
+
 /*
  * BoxedInstance::allocate_directly:
  *
@@ -158,39 +176,57 @@ BoxedBase* BoxedBase::get_copy_source(JSContext* context,
  * function.)
  */
 void BoxedInstance::allocate_directly(void) {
-    g_assert(get_prototype()->can_allocate_directly());
-
-    own_ptr(g_slice_alloc0(g_struct_info_get_size(info())));
+    const BoxedPrototype* proto = get_prototype();
+    g_assert(proto->can_allocate_directly());
+
+    size_t size = proto->size();
+    if (size <= INLINE_SIZE) {
+        memset(m_inline_storage, 0, size);
+        own_ptr(m_inline_storage);
+    } else if (size <= GjsSlab::MAX_SIZE) {
+        own_ptr(proto->slab()->alloc0(size));
+        GJS_ADD_BYTES(boxed_payload, size);
+    } else {
+        own_ptr(g_slice_alloc0(size));
+        GJS_ADD_BYTES(boxed_payload, size);
+    }
     m_allocated_directly = true;
 
     debug_lifecycle("Boxed pointer directly allocated");
 }
 
+void BoxedInstance::free_directly_allocated(void) {
+    const BoxedPrototype* proto = get_prototype();
+    size_t size = proto->size();
+    if (size <= INLINE_SIZE)
+        return;
+    GJS_SUB_BYTES(boxed_payload, size);
+    if (size <= GjsSlab::MAX_SIZE)
+        proto->slab()->free(m_ptr, size);
+    else
+        g_slice_free1(size, m_ptr);
+}
+
 /* When initializing a boxed object from a hash of properties, we don't want
  * to do n O(n) lookups, so put put the fields into a hash table and store it on proto->priv
  * for fast lookup. 
  */
 BoxedPrototype::FieldMap* BoxedPrototype::create_field_map(
-    JSContext* cx, GIStructInfo* struct_info) {
-    int n_fields;
-    int i;
-
+    JSContext* cx) const {
     auto* result = new BoxedPrototype::FieldMap();
-    n_fields = g_struct_info_get_n_fields(struct_info);
-    if (!result->reserve(n_fields)) {
+    if (!result->reserve(m_fields.size())) {
         JS_ReportOutOfMemory(cx);
         return nullptr;
     }
 
-    for (i = 0; i < n_fields; i++) {
-        GjsAutoFieldInfo field_info = g_struct_info_get_field(struct_info, i);
-
+    for (uint32_t i = 0; i < m_fields.size(); i++) {
         // We get the string as a jsid later, which is interned. We intern the
         // string here as well, so it will be the same string pointer
-        JS::RootedString name(cx, JS_NewStringCopyZ(cx, field_info.name()));
+        JS::RootedString name(cx,
+                              JS_NewStringCopyZ(cx, m_fields[i].info.name()));
         JSString* atom = JS_AtomizeAndPinJSString(cx, name);
 
-        result->putNewInfallible(atom, std::move(field_info));
+        result->putNewInfallible(atom, i);
     }
 
     return result;
@@ -205,7 +241,7 @@ BoxedPrototype::FieldMap* BoxedPrototype::create_field_map(
  */
 bool BoxedPrototype::ensure_field_map(JSContext* cx) {
     if (!m_field_map)
-        m_field_map = create_field_map(cx, info());
+        m_field_map = create_field_map(cx);
     return !!m_field_map;
 }
 
@@ -215,7 +251,8 @@ bool BoxedPrototype::ensure_field_map(JSContext* cx) {
  * Look up the introspection info corresponding to the field name @prop_name,
  * creating the field cache if necessary.
  */
-GIFieldInfo* BoxedPrototype::lookup_field(JSContext* cx, JSString* prop_name) {
+const BoxedField* BoxedPrototype::lookup_field(JSContext* cx,
+                                               JSString* prop_name) {
     if (!ensure_field_map(cx))
         return nullptr;
 
@@ -226,7 +263,7 @@ GIFieldInfo* BoxedPrototype::lookup_field(JSContext* cx, JSString* prop_name) {
         return nullptr;
     }
 
-    return entry->value().get();
+    return &m_fields[entry->value()];
 }
 
 /* Initialize a newly created Boxed from an object that is a "hash" of
@@ -255,9 +292,9 @@ bool BoxedInstance::init_from_props(JSContext* context, JS::Value props_value) {
             return false;
         }
 
-        GIFieldInfo* field_info =
+        const BoxedField* field =
             get_prototype()->lookup_field(context, JSID_TO_STRING(ids[ix]));
-        if (!field_info)
+        if (!field)
             return false;
 
         /* ids[ix] is reachable because props is rooted, but require_property
@@ -267,7 +304,7 @@ bool BoxedInstance::init_from_props(JSContext* context, JS::Value props_value) {
                                          &value))
             return false;
 
-        if (!field_setter_impl(context, field_info, value))
+        if (!field_setter_impl(context, *field, value))
             return false;
     }
 
@@ -300,7 +337,14 @@ static bool boxed_invoke_constructor(JSContext* context, JS::HandleObject obj,
  * pointer or another BoxedInstance.
  */
 void BoxedInstance::copy_boxed(void* boxed_ptr) {
+    BoxedPrototype* proto = get_prototype();
+    if (proto->copies_by_value()) {
+        copy_memory(boxed_ptr);
+        return;
+    }
+
     own_ptr(g_boxed_copy(gtype(), boxed_ptr));
+    proto->learn_copy_semantics(boxed_ptr, m_ptr);
     debug_lifecycle("Boxed pointer created with g_boxed_copy()");
 }
 
@@ -316,7 +360,7 @@ void BoxedInstance::copy_boxed(BoxedInstance* source) {
  */
 void BoxedInstance::copy_memory(void* boxed_ptr) {
     allocate_directly();
-    memcpy(m_ptr, boxed_ptr, g_struct_info_get_size(info()));
+    memcpy(m_ptr, boxed_ptr, get_prototype()->size());
 }
 
 void BoxedInstance::copy_memory(BoxedInstance* source) {
@@ -438,7 +482,7 @@ bool BoxedInstance::constructor_impl(JSContext* context, JS::HandleObject obj,
 BoxedInstance::~BoxedInstance() {
     if (m_owning_ptr) {
         if (m_allocated_directly) {
-            g_slice_free1(g_struct_info_get_size(info()), m_ptr);
+            free_directly_allocated();
         } else {
             if (g_type_is_a(gtype(), G_TYPE_BOXED))
                 g_boxed_free(gtype(), m_ptr);
@@ -463,20 +507,119 @@ BoxedPrototype::~BoxedPrototype(void) {
     GJS_DEC_COUNTER(boxed_prototype);
 }
 
-/*
- * BoxedBase::get_field_info:
- *
- * Does the same thing as g_struct_info_get_field(), but throws a JS exception
- * if there is no such field.
- */
-GIFieldInfo* BoxedBase::get_field_info(JSContext* cx, uint32_t id) const {
-    GIFieldInfo* field_info = g_struct_info_get_field(info(), id);
-    if (field_info == NULL) {
-        gjs_throw(cx, "No field %d on boxed type %s", id, name());
-        return NULL;
+BoxedField::BoxedField(GIFieldInfo* field_info)
+    : info(field_info),
+      type_info(g_field_info_get_type(field_info)),
+      offset(g_field_info_get_offset(field_info)),
+      direct_tag(GI_TYPE_TAG_VOID) {
+    GIFieldInfoFlags flags = g_field_info_get_flags(field_info);
+    readable = (flags & GI_FIELD_IS_READABLE) != 0;
+    writable = (flags & GI_FIELD_IS_WRITABLE) != 0;
+
+    if (g_type_info_is_pointer(type_info))
+        return;
+
+    GITypeTag tag = g_type_info_get_tag(type_info);
+    switch (tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+        case GI_TYPE_TAG_INT8:
+        case GI_TYPE_TAG_UINT8:
+        case GI_TYPE_TAG_INT16:
+        case GI_TYPE_TAG_UINT16:
+        case GI_TYPE_TAG_INT32:
+        case GI_TYPE_TAG_UINT32:
+        case GI_TYPE_TAG_INT64:
+        case GI_TYPE_TAG_UINT64:
+        case GI_TYPE_TAG_FLOAT:
+        case GI_TYPE_TAG_DOUBLE:
+            direct_tag = tag;
+            break;
+        default:
+            break;
     }
+}
 
-    return field_info;
+// Same as what g_field_info_get_field() and g_field_info_set_field() do for
+// fields with a direct_tag, without going through the typelib
+static void read_direct_field(GITypeTag tag, void* mem, GIArgument* arg) {
+    switch (tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+            arg->v_boolean = *static_cast<gboolean*>(mem) != FALSE;
+            break;
+        case GI_TYPE_TAG_INT8:
+            arg->v_int8 = *static_cast<int8_t*>(mem);
+            break;
+        case GI_TYPE_TAG_UINT8:
+            arg->v_uint8 = *static_cast<uint8_t*>(mem);
+            break;
+        case GI_TYPE_TAG_INT16:
+            arg->v_int16 = *static_cast<int16_t*>(mem);
+            break;
+        case GI_TYPE_TAG_UINT16:
+            arg->v_uint16 = *static_cast<uint16_t*>(mem);
+            break;
+        case GI_TYPE_TAG_INT32:
+            arg->v_int32 = *static_cast<int32_t*>(mem);
+            break;
+        case GI_TYPE_TAG_UINT32:
+            arg->v_uint32 = *static_cast<uint32_t*>(mem);
+            break;
+        case GI_TYPE_TAG_INT64:
+            arg->v_int64 = *static_cast<int64_t*>(mem);
+            break;
+        case GI_TYPE_TAG_UINT64:
+            arg->v_uint64 = *static_cast<uint64_t*>(mem);
+            break;
+        case GI_TYPE_TAG_FLOAT:
+            arg->v_float = *static_cast<float*>(mem);
+            break;
+        case GI_TYPE_TAG_DOUBLE:
+            arg->v_double = *static_cast<double*>(mem);
+            break;
+        default:
+            g_assert_not_reached();
+    }
+}
+
+static void write_direct_field(GITypeTag tag, void* mem,
+                               const GIArgument* arg) {
+    switch (tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+            *static_cast<gboolean*>(mem) = arg->v_boolean != FALSE;
+            break;
+        case GI_TYPE_TAG_INT8:
+            *static_cast<int8_t*>(mem) = arg->v_int8;
+            break;
+        case GI_TYPE_TAG_UINT8:
+            *static_cast<uint8_t*>(mem) = arg->v_uint8;
+            break;
+        case GI_TYPE_TAG_INT16:
+            *static_cast<int16_t*>(mem) = arg->v_int16;
+            break;
+        case GI_TYPE_TAG_UINT16:
+            *static_cast<uint16_t*>(mem) = arg->v_uint16;
+            break;
+        case GI_TYPE_TAG_INT32:
+            *static_cast<int32_t*>(mem) = arg->v_int32;
+            break;
+        case GI_TYPE_TAG_UINT32:
+            *static_cast<uint32_t*>(mem) = arg->v_uint32;
+            break;
+        case GI_TYPE_TAG_INT64:
+            *static_cast<int64_t*>(mem) = arg->v_int64;
+            break;
+        case GI_TYPE_TAG_UINT64:
+            *static_cast<uint64_t*>(mem) = arg->v_uint64;
+            break;
+        case GI_TYPE_TAG_FLOAT:
+            *static_cast<float*>(mem) = arg->v_float;
+            break;
+        case GI_TYPE_TAG_DOUBLE:
+            *static_cast<double*>(mem) = arg->v_double;
+            break;
+        default:
+            g_assert_not_reached();
+    }
 }
 
 /*
@@ -546,19 +689,24 @@ bool BoxedBase::field_getter(JSContext* context, unsigned argc, JS::Value* vp) {
 
     uint32_t field_ix = gjs_dynamic_property_private_slot(&args.callee())
         .toPrivateUint32();
-    GjsAutoFieldInfo field_info = priv->get_field_info(context, field_ix);
-    if (!field_info)
-        return false;
+    const BoxedField& field = priv->get_prototype()->field(field_ix);
 
-    return priv->to_instance()->field_getter_impl(context, obj, field_info,
+    return priv->to_instance()->field_getter_impl(context, obj, field,
                                                   args.rval());
 }
 
 // See BoxedBase::field_getter().
 bool BoxedInstance::field_getter_impl(JSContext* cx, JSObject* obj,
-                                      GIFieldInfo* field_info,
+                                      const BoxedField& field,
                                       JS::MutableHandleValue rval) const {
-    GjsAutoTypeInfo type_info = g_field_info_get_type(field_info);
+    GIFieldInfo* field_info = field.info;
+    GITypeInfo* type_info = field.type_info;
+    GIArgument arg;
+
+    if (field.direct_tag != GI_TYPE_TAG_VOID && field.readable) {
+        read_direct_field(field.direct_tag, raw_ptr() + field.offset, &arg);
+        return gjs_value_from_g_argument(cx, rval, type_info, &arg, true);
+    }
 
     if (!g_type_info_is_pointer(type_info) &&
         g_type_info_get_tag(type_info) == GI_TYPE_TAG_INTERFACE) {
@@ -571,7 +719,6 @@ bool BoxedInstance::field_getter_impl(JSContext* cx, JSObject* obj,
         }
     }
 
-    GIArgument arg;
     if (!g_field_info_get_field(field_info, m_ptr, &arg)) {
         gjs_throw(cx, "Reading field %s.%s is not supported", name(),
                   g_base_info_get_name(field_info));
@@ -641,10 +788,21 @@ bool BoxedInstance::set_nested_interface_object(JSContext* context,
 
 // See BoxedBase::field_setter().
 bool BoxedInstance::field_setter_impl(JSContext* context,
-                                      GIFieldInfo* field_info,
+                                      const BoxedField& field,
                                       JS::HandleValue value) {
+    GIFieldInfo* field_info = field.info;
+    GITypeInfo* type_info = field.type_info;
     GArgument arg;
-    GjsAutoTypeInfo type_info = g_field_info_get_type(field_info);
+
+    if (field.direct_tag != GI_TYPE_TAG_VOID && field.writable) {
+        if (!gjs_value_to_g_argument(context, value, type_info,
+                                     field.info.name(), GJS_ARGUMENT_FIELD,
+                                     GI_TRANSFER_NOTHING, true, &arg))
+            return false;
+
+        write_direct_field(field.direct_tag, raw_ptr() + field.offset, &arg);
+        return true;
+    }
 
     if (!g_type_info_is_pointer (type_info) &&
         g_type_info_get_tag (type_info) == GI_TYPE_TAG_INTERFACE) {
@@ -694,11 +852,9 @@ bool BoxedBase::field_setter(JSContext* cx, unsigned argc, JS::Value* vp) {
 
     uint32_t field_ix = gjs_dynamic_property_private_slot(&args.callee())
         .toPrivateUint32();
-    GjsAutoFieldInfo field_info = priv->get_field_info(cx, field_ix);
-    if (!field_info)
-        return false;
+    const BoxedField& field = priv->get_prototype()->field(field_ix);
 
-    if (!priv->to_instance()->field_setter_impl(cx, field_info, args[0]))
+    if (!priv->to_instance()->field_setter_impl(cx, field, args[0]))
         return false;
 
     args.rval().setUndefined();  /* No stored value */
@@ -709,7 +865,9 @@ bool BoxedBase::field_setter(JSContext* cx, unsigned argc, JS::Value* vp) {
  * BoxedPrototype::define_boxed_class_fields:
  *
  * Defines properties on the JS prototype object, with JSNative getters and
- * setters, for all the fields exposed by GObject introspection.
+ * setters, for all the fields exposed by GObject introspection. The getters and
+ * setters find the field's BoxedField in m_fields by its index, which is stored
+ * in their private slot.
  */
 bool BoxedPrototype::define_boxed_class_fields(JSContext* cx,
                                                JS::HandleObject proto) {
@@ -731,10 +889,13 @@ bool BoxedPrototype::define_boxed_class_fields(JSContext* cx,
      * as well if doing it ahead of time caused to much start-up
      * memory overhead.
      */
+    m_fields.reserve(n_fields);
     for (i = 0; i < n_fields; i++) {
-        GjsAutoFieldInfo field = g_struct_info_get_field(info(), i);
+        const BoxedField& field =
+            m_fields.emplace_back(g_struct_info_get_field(info(), i));
         JS::RootedValue private_id(cx, JS::PrivateUint32Value(i));
-        if (!gjs_define_property_dynamic(cx, proto, field.name(), "boxed_field",
+        if (!gjs_define_property_dynamic(cx, proto, field.info.name(),
+                                         "boxed_field",
                                          &BoxedBase::field_getter,
                                          &BoxedBase::field_setter, private_id,
                                          GJS_MODULE_PROP_FLAGS))
@@ -895,13 +1056,69 @@ const struct JSClass BoxedBase::klass = {
     return is_simple;
 }
 
+/* Stricter than struct_is_simple(): the struct has no pointers at all, not even
+ * untyped ones, so a copy made with memcpy() has nothing to share with the
+ * original.
+ */
+[[nodiscard]] static bool struct_is_plain_data(GIStructInfo* info) {
+    int n_fields = g_struct_info_get_n_fields(info);
+    if (n_fields == 0)
+        return false;
+
+    for (int i = 0; i < n_fields; i++) {
+        GjsAutoFieldInfo field_info = g_struct_info_get_field(info, i);
+        GjsAutoTypeInfo type_info = g_field_info_get_type(field_info);
+        if (g_type_info_is_pointer(type_info))
+            return false;
+
+        switch (g_type_info_get_tag(type_info)) {
+            case GI_TYPE_TAG_BOOLEAN:
+            case GI_TYPE_TAG_INT8:
+            case GI_TYPE_TAG_UINT8:
+            case GI_TYPE_TAG_INT16:
+            case GI_TYPE_TAG_UINT16:
+            case GI_TYPE_TAG_INT32:
+            case GI_TYPE_TAG_UINT32:
+            case GI_TYPE_TAG_INT64:
+            case GI_TYPE_TAG_UINT64:
+            case GI_TYPE_TAG_FLOAT:
+            case GI_TYPE_TAG_DOUBLE:
+            case GI_TYPE_TAG_UNICHAR:
+                break;
+            case GI_TYPE_TAG_INTERFACE: {
+                GjsAutoBaseInfo interface_info =
+                    g_type_info_get_interface(type_info);
+                GIInfoType type = interface_info.type();
+                if (type == GI_INFO_TYPE_ENUM || type == GI_INFO_TYPE_FLAGS)
+                    break;
+                if ((type == GI_INFO_TYPE_STRUCT ||
+                     type == GI_INFO_TYPE_BOXED) &&
+                    struct_is_plain_data(interface_info))
+                    break;
+                return false;
+            }
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
 BoxedPrototype::BoxedPrototype(GIStructInfo* info, GType gtype)
     : GIWrapperPrototype(info, gtype),
       m_zero_args_constructor(-1),
       m_default_constructor(-1),
       m_default_constructor_name(JSID_VOID),
       m_field_map(nullptr),
-      m_can_allocate_directly(struct_is_simple(info)) {
+      m_slab(nullptr),
+      m_size(g_struct_info_get_size(info)),
+      m_can_allocate_directly(struct_is_simple(info)),
+      m_copy_semantics(g_type_is_a(gtype, G_TYPE_BOXED) &&
+                               m_can_allocate_directly &&
+                               struct_is_plain_data(info)
+                           ? CopySemantics::UNKNOWN
+                           : CopySemantics::BY_REFERENCE) {
     GJS_INC_COUNTER(boxed_prototype);
 }
 
@@ -963,6 +1180,8 @@ bool BoxedPrototype::init(JSContext* context) {
         }
     }
 
+    m_slab = GjsContextPrivate::from_cx(context)->boxed_slab();
+
     return true;
 }
 
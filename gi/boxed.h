@@ -26,8 +26,11 @@
 
 #include <config.h>
 
+#include <stddef.h>  // for size_t, max_align_t
 #include <stdint.h>
 
+#include <vector>
+
 #include <girepository.h>
 #include <glib-object.h>
 #include <glib.h>
@@ -45,6 +48,7 @@
 
 class BoxedPrototype;
 class BoxedInstance;
+class GjsSlab;
 class JSTracer;
 namespace JS {
 class CallArgs;
@@ -85,12 +89,36 @@ class BoxedBase
 
     [[nodiscard]] const char* to_string_kind() const { return "boxed"; }
 
-    GJS_JSAPI_RETURN_CONVENTION
-    GIFieldInfo* get_field_info(JSContext* cx, uint32_t id) const;
-
  public:
     [[nodiscard]] BoxedBase* get_copy_source(JSContext* cx,
                                              JS::Value value) const;
+
+    // Used to copy flat arrays of structs without checking the type of every
+    // element: the first element is converted normally, and the following
+    // elements that are instances of the same prototype are copied directly.
+    // Neither method throws; they return null if @obj is not a boxed instance
+    // (of @proto, for the second one.)
+    [[nodiscard]] static const BoxedPrototype* prototype_of_instance(
+        JSContext* cx, JS::HandleObject obj);
+    [[nodiscard]] static void* ptr_if_instance_of(JSContext* cx,
+                                                  JS::HandleObject obj,
+                                                  const BoxedPrototype* proto);
+};
+
+// Introspection info of a boxed type's field, looked up once when the class is
+// defined
+struct BoxedField {
+    GjsAutoFieldInfo info;
+    GjsAutoTypeInfo type_info;
+    int offset;
+    // For fields of a basic type that is stored inline, such as the
+    // coordinates of a Graphene.Point, the type tag; these are read and
+    // written directly at the offset. GI_TYPE_TAG_VOID for other fields.
+    GITypeTag direct_tag;
+    bool readable : 1;
+    bool writable : 1;
+
+    explicit BoxedField(GIFieldInfo* field_info);
 };
 
 class BoxedPrototype : public GIWrapperPrototype<BoxedBase, BoxedPrototype,
@@ -99,15 +127,25 @@ class BoxedPrototype : public GIWrapperPrototype<BoxedBase, BoxedPrototype,
                                     GIStructInfo>;
     friend class GIWrapperBase<BoxedBase, BoxedPrototype, BoxedInstance>;
 
+    // Maps field names to indices in m_fields
     using FieldMap =
-        JS::GCHashMap<JS::Heap<JSString*>, GjsAutoFieldInfo,
+        JS::GCHashMap<JS::Heap<JSString*>, uint32_t,
                       js::DefaultHasher<JSString*>, js::SystemAllocPolicy>;
 
     int m_zero_args_constructor;  // -1 if none
     int m_default_constructor;  // -1 if none
     JS::Heap<jsid> m_default_constructor_name;
     FieldMap* m_field_map;
+    std::vector<BoxedField> m_fields;
+    GjsSlab* m_slab;  // owned by the context
+    size_t m_size;
     bool m_can_allocate_directly : 1;
+    // Boxed types made only of plain data, such as Gdk.Rectangle or
+    // Clutter.ActorBox, are copied with memcpy() into memory that the wrapper
+    // owns, instead of with g_boxed_copy(). This is only done once the first
+    // g_boxed_copy() has shown that the type is not reference counted.
+    enum class CopySemantics : uint8_t { UNKNOWN, BY_VALUE, BY_REFERENCE };
+    CopySemantics m_copy_semantics;
 
     explicit BoxedPrototype(GIStructInfo* info, GType gtype);
     ~BoxedPrototype(void);
@@ -122,6 +160,20 @@ class BoxedPrototype : public GIWrapperPrototype<BoxedBase, BoxedPrototype,
     [[nodiscard]] bool can_allocate_directly() const {
         return m_can_allocate_directly;
     }
+    [[nodiscard]] size_t size() const { return m_size; }
+    [[nodiscard]] bool copies_by_value() const {
+        return m_copy_semantics == CopySemantics::BY_VALUE;
+    }
+    void learn_copy_semantics(const void* original, const void* copy) {
+        if (m_copy_semantics == CopySemantics::UNKNOWN)
+            m_copy_semantics = original == copy ? CopySemantics::BY_REFERENCE
+                                                : CopySemantics::BY_VALUE;
+    }
+    [[nodiscard]] const BoxedField& field(uint32_t ix) const {
+        g_assert(ix < m_fields.size());
+        return m_fields[ix];
+    }
+    [[nodiscard]] GjsSlab* slab() const { return m_slab; }
     [[nodiscard]] bool has_zero_args_constructor() const {
         return m_zero_args_constructor >= 0;
     }
@@ -153,7 +205,7 @@ class BoxedPrototype : public GIWrapperPrototype<BoxedBase, BoxedPrototype,
     // Helper methods
 
     GJS_JSAPI_RETURN_CONVENTION
-    static FieldMap* create_field_map(JSContext* cx, GIStructInfo* struct_info);
+    FieldMap* create_field_map(JSContext* cx) const;
     GJS_JSAPI_RETURN_CONVENTION
     bool ensure_field_map(JSContext* cx);
     GJS_JSAPI_RETURN_CONVENTION
@@ -164,7 +216,7 @@ class BoxedPrototype : public GIWrapperPrototype<BoxedBase, BoxedPrototype,
     static bool define_class(JSContext* cx, JS::HandleObject in_object,
                              GIStructInfo* info);
     GJS_JSAPI_RETURN_CONVENTION
-    GIFieldInfo* lookup_field(JSContext* cx, JSString* prop_name);
+    const BoxedField* lookup_field(JSContext* cx, JSString* prop_name);
 };
 
 class BoxedInstance
@@ -177,6 +229,11 @@ class BoxedInstance
     bool m_owning_ptr : 1;  // if set, the JS wrapper owns the C memory referred
                             // to by m_ptr.
 
+    // Directly allocated structs that fit here, such as Graphene.Point or
+    // Clutter.Color, are stored in the wrapper itself
+    static constexpr size_t INLINE_SIZE = 16;
+    alignas(max_align_t) char m_inline_storage[INLINE_SIZE];
+
     explicit BoxedInstance(JSContext* cx, JS::HandleObject obj);
     ~BoxedInstance(void);
 
@@ -196,6 +253,7 @@ class BoxedInstance
     // Methods for different ways to allocate the GBoxed pointer
 
     void allocate_directly(void);
+    void free_directly_allocated(void);
     void copy_boxed(void* boxed_ptr);
     void copy_boxed(BoxedInstance* source);
     void copy_memory(void* boxed_ptr);
@@ -222,10 +280,11 @@ class BoxedInstance
     // JS property accessors
 
     GJS_JSAPI_RETURN_CONVENTION
-    bool field_getter_impl(JSContext* cx, JSObject* obj, GIFieldInfo* info,
+    bool field_getter_impl(JSContext* cx, JSObject* obj,
+                           const BoxedField& field,
                            JS::MutableHandleValue rval) const;
     GJS_JSAPI_RETURN_CONVENTION
-    bool field_setter_impl(JSContext* cx, GIFieldInfo* info,
+    bool field_setter_impl(JSContext* cx, const BoxedField& field,
                            JS::HandleValue value);
 
     // JS constructor
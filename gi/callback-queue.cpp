@@ -0,0 +1,134 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <atomic>
+#include <mutex>
+
+#include <glib.h>
+
+#include "gi/callback-queue.h"
+
+GjsCallbackQueue::GjsCallbackQueue() {
+    if (g_getenv("GJS_QUEUE_THREAD_CALLBACKS"))
+        m_enabled = true;
+}
+
+GjsCallbackQueue::~GjsCallbackQueue() {
+    cancel_all();
+    if (m_source) {
+        g_source_destroy(m_source);
+        g_source_unref(m_source);
+    }
+}
+
+void GjsCallbackQueue::attach(GMainContext* main_context) {
+    static GSourceFuncs source_funcs = {
+        nullptr,  // prepare; the ready time is enough
+        nullptr,  // check
+        &GjsCallbackQueue::on_source_dispatch,
+        nullptr,  // finalize
+        nullptr,  // closure_callback
+        nullptr,  // closure_marshal
+    };
+    g_assert(!m_source && "callback queue should only be attached once");
+    m_source = g_source_new(&source_funcs, sizeof(GSource));
+    g_source_set_name(m_source, "GJS callbacks from other threads");
+    // Like toggles from other threads, these are often holding up the thread
+    // that invoked them
+    g_source_set_priority(m_source, G_PRIORITY_HIGH);
+    g_source_set_callback(m_source, nullptr, this, nullptr);
+    g_source_attach(m_source, main_context);
+}
+
+gboolean GjsCallbackQueue::on_source_dispatch(GSource* source, GSourceFunc,
+                                              void* data) {
+    g_source_set_ready_time(source, -1);
+    static_cast<GjsCallbackQueue*>(data)->run_all();
+    return G_SOURCE_CONTINUE;
+}
+
+void GjsCallbackQueue::push(GjsQueuedCallback* item) {
+    std::unique_lock<std::mutex> lock(m_lock);
+    if (G_UNLIKELY(m_shutdown)) {
+        lock.unlock();
+        item->run(item, true);
+        return;
+    }
+
+    item->next = m_incoming.load(std::memory_order_relaxed);
+    while (!m_incoming.compare_exchange_weak(item->next, item,
+                                             std::memory_order_release))
+        ;
+    // Only the push onto an empty stack needs to wake up the owner's thread
+    if (!item->next)
+        g_source_set_ready_time(m_source, 0);
+}
+
+// Takes everything pushed since the last call, in the order it was pushed
+GjsQueuedCallback* GjsCallbackQueue::take_incoming() {
+    GjsQueuedCallback* item =
+        m_incoming.exchange(nullptr, std::memory_order_acquire);
+    GjsQueuedCallback* reversed = nullptr;
+    while (item) {
+        GjsQueuedCallback* next = item->next;
+        item->next = reversed;
+        reversed = item;
+        item = next;
+    }
+    return reversed;
+}
+
+void GjsCallbackQueue::run_all() {
+    GjsQueuedCallback* item;
+    while ((item = take_incoming())) {
+        while (item) {
+            GjsQueuedCallback* next = item->next;
+            item->run(item, false);
+            item = next;
+        }
+    }
+}
+
+// Lets go of callbacks that will never run, so that threads waiting for them
+// don't hang
+void GjsCallbackQueue::cancel_all() {
+    GjsQueuedCallback* item;
+    while ((item = take_incoming())) {
+        while (item) {
+            GjsQueuedCallback* next = item->next;
+            item->run(item, true);
+            item = next;
+        }
+    }
+}
+
+void GjsCallbackQueue::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_shutdown = true;
+    }
+    // Anything pushed before this point is on the stack now
+    cancel_all();
+}
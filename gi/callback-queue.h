@@ -0,0 +1,83 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GI_CALLBACK_QUEUE_H_
+#define GI_CALLBACK_QUEUE_H_
+
+#include <config.h>
+
+#include <atomic>
+#include <mutex>
+
+#include <glib.h>
+
+// A callback invoked on a thread other than that of the context owning it,
+// waiting to run on the context's thread. @run is called there, or with
+// @cancelled set if the context goes away first, and takes care of the item.
+struct GjsQueuedCallback {
+    GjsQueuedCallback* next;
+    void (*run)(GjsQueuedCallback* item, bool cancelled);
+};
+
+// Callbacks that other threads have handed to a context. Any thread may push
+// items onto a lock-free stack; the context's thread takes them over in one go
+// and runs them in the order they were pushed, from a source on the context's
+// main context that is made ready by the first push. Pushing and shutting down
+// take a lock, so that an item can't be pushed after the final cancellation,
+// where nothing would ever run it.
+//
+// Queueing is opt-in: without it, callbacks invoked on other threads are
+// blocked with a warning, as they always were.
+class GjsCallbackQueue {
+    std::atomic<GjsQueuedCallback*> m_incoming = ATOMIC_VAR_INIT(nullptr);
+    std::atomic_bool m_enabled = ATOMIC_VAR_INIT(false);
+    std::mutex m_lock;
+    bool m_shutdown = false;  // protected by m_lock
+    GSource* m_source = nullptr;
+
+    [[nodiscard]] GjsQueuedCallback* take_incoming();
+    static gboolean on_source_dispatch(GSource* source, GSourceFunc, void*);
+
+ public:
+    GjsCallbackQueue();
+    ~GjsCallbackQueue();
+    GjsCallbackQueue(const GjsCallbackQueue&) = delete;
+    GjsCallbackQueue& operator=(const GjsCallbackQueue&) = delete;
+
+    // Called on the owner's thread before any callbacks are queued
+    void attach(GMainContext* main_context);
+
+    [[nodiscard]] bool enabled() const { return m_enabled; }
+    void set_enabled(bool enabled) { m_enabled = enabled; }
+
+    // May be called from any thread. After shutdown(), @item is cancelled
+    // right away on the calling thread.
+    void push(GjsQueuedCallback* item);
+
+    // Owner's thread only
+    void run_all();
+    void cancel_all();
+    void shutdown();
+};
+
+#endif  // GI_CALLBACK_QUEUE_H_
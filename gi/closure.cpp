@@ -33,6 +33,7 @@
 #include <jsapi.h>  // for JS_IsExceptionPending, Call, JS_Get...
 
 #include "gi/closure.h"
+#include "gi/gjs_gi_trace.h"
 #include "cjs/context-private.h"
 #include "cjs/jsapi-util-root.h"
 #include "cjs/jsapi-util.h"
@@ -42,6 +43,19 @@
 struct Closure {
     JSContext *context;
     GjsMaybeOwned<JSFunction*> func;
+
+    // Data cached by the marshaller on first invocation
+    void* marshal_plan = nullptr;
+    GDestroyNotify marshal_plan_destroy = nullptr;
+
+    // Index in ObjectInstance::m_closures of the object this is associated
+    // with, if any
+    size_t owner_index = GJS_CLOSURE_INDEX_NONE;
+
+    ~Closure() {
+        if (marshal_plan_destroy)
+            marshal_plan_destroy(marshal_plan);
+    }
 };
 
 struct GjsClosure {
@@ -179,6 +193,7 @@ static void closure_finalize(void*, GClosure* closure) {
     Closure *self = &((GjsClosure*) closure)->priv;
 
     self->~Closure();
+    GJS_SUB_BYTES(closure, sizeof(GjsClosure));
 }
 
 bool
@@ -208,7 +223,10 @@ gjs_closure_invoke(GClosure                   *closure,
     }
 
     JS::RootedFunction func(context, c->func);
-    if (!JS::Call(context, this_obj, func, args, retval)) {
+    TRACE(GJS_CLOSURE_INVOKE_ENTRY(closure));
+    bool ok = JS::Call(context, this_obj, func, args, retval);
+    TRACE(GJS_CLOSURE_INVOKE_RETURN(closure, ok));
+    if (!ok) {
         /* Exception thrown... */
         gjs_debug_closure(
             "Closure invocation failed (exception should have been thrown) "
@@ -269,6 +287,28 @@ JSFunction* gjs_closure_get_callable(GClosure* closure) {
     return c->func;
 }
 
+void* gjs_closure_get_marshal_plan(GClosure* closure) {
+    return reinterpret_cast<GjsClosure*>(closure)->priv.marshal_plan;
+}
+
+void gjs_closure_set_marshal_plan(GClosure* closure, void* plan,
+                                  GDestroyNotify destroy) {
+    Closure* c = &reinterpret_cast<GjsClosure*>(closure)->priv;
+
+    if (c->marshal_plan_destroy)
+        c->marshal_plan_destroy(c->marshal_plan);
+    c->marshal_plan = plan;
+    c->marshal_plan_destroy = destroy;
+}
+
+size_t gjs_closure_get_owner_index(GClosure* closure) {
+    return reinterpret_cast<GjsClosure*>(closure)->priv.owner_index;
+}
+
+void gjs_closure_set_owner_index(GClosure* closure, size_t index) {
+    reinterpret_cast<GjsClosure*>(closure)->priv.owner_index = index;
+}
+
 void
 gjs_closure_trace(GClosure *closure,
                   JSTracer *tracer)
@@ -300,6 +340,7 @@ GClosure* gjs_closure_new(JSContext* context, JSFunction* callable,
     c->context = context;
 
     GJS_INC_COUNTER(closure);
+    GJS_ADD_BYTES(closure, sizeof(GjsClosure));
 
     if (root_function) {
         /* Fully manage closure lifetime if so asked */
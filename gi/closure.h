@@ -26,6 +26,9 @@
 
 #include <config.h>
 
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for SIZE_MAX
+
 #include <glib-object.h>
 
 #include <js/TypeDecls.h>
@@ -49,6 +52,19 @@ class HandleValueArray;
 [[nodiscard]] bool gjs_closure_is_valid(GClosure* closure);
 [[nodiscard]] JSFunction* gjs_closure_get_callable(GClosure* closure);
 
+// Opaque per-closure data owned by the closure's marshaller, freed with
+// @destroy when the closure is finalized or the plan is replaced
+[[nodiscard]] void* gjs_closure_get_marshal_plan(GClosure* closure);
+void gjs_closure_set_marshal_plan(GClosure* closure, void* plan,
+                                  GDestroyNotify destroy);
+
+// Position of the closure in the closure list of the object it is associated
+// with, so that it can be removed without searching; see
+// ObjectInstance::associate_closure()
+inline constexpr size_t GJS_CLOSURE_INDEX_NONE = SIZE_MAX;
+[[nodiscard]] size_t gjs_closure_get_owner_index(GClosure* closure);
+void gjs_closure_set_owner_index(GClosure* closure, size_t index);
+
 void       gjs_closure_trace         (GClosure     *closure,
                                       JSTracer     *tracer);
 
@@ -100,8 +100,8 @@ void gjs_struct_foreign_register(const char* gi_namespace,
     g_hash_table_insert(get_foreign_structs(), canonical_name, info);
 }
 
-[[nodiscard]] static GjsForeignInfo* gjs_struct_foreign_lookup(
-    JSContext* context, GIBaseInfo* interface_info) {
+GjsForeignInfo* gjs_struct_foreign_lookup(JSContext* context,
+                                          GIBaseInfo* interface_info) {
     GjsForeignInfo *retval = NULL;
     GHashTable *hash_table;
     char *key;
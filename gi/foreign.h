@@ -51,7 +51,7 @@ typedef bool (*GjsArgOverrideReleaseGArgumentFunc) (JSContext *context,
                                                     GITransfer transfer,
                                                     GArgument *arg);
 
-typedef struct {
+typedef struct GjsForeignInfo {
     GjsArgOverrideToGArgumentFunc to_func;
     GjsArgOverrideFromGArgumentFunc from_func;
     GjsArgOverrideReleaseGArgumentFunc release_func;
@@ -60,6 +60,12 @@ typedef struct {
 void gjs_struct_foreign_register(const char* gi_namespace,
                                  const char* type_name, GjsForeignInfo* info);
 
+// Finds the converter for a foreign struct, importing the module implementing
+// it if needed. The returned pointer stays valid, so it can be cached
+GJS_JSAPI_RETURN_CONVENTION
+GjsForeignInfo* gjs_struct_foreign_lookup(JSContext* cx,
+                                          GIBaseInfo* interface_info);
+
 GJS_JSAPI_RETURN_CONVENTION
 bool  gjs_struct_foreign_convert_to_g_argument   (JSContext      *context,
                                                   JS::Value       value,
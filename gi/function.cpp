@@ -24,11 +24,23 @@
 #include <config.h>
 
 #include <stdint.h>
+#include <stdio.h>   // for FILE, fprintf
 #include <stdlib.h>  // for exit
 #include <string.h>  // for strcmp, memset, size_t
 
+#include <algorithm>  // for sort
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>  // for next
+#include <memory>    // for unique_ptr
+#include <mutex>
 #include <new>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>  // for index_sequence
+#include <vector>
 
 #include <ffi.h>
 #include <girepository.h>
@@ -42,6 +54,7 @@
 #include <js/GCVector.h>
 #include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT
 #include <js/PropertySpec.h>
+#include <js/Promise.h>
 #include <js/Realm.h>  // for GetRealmFunctionPrototype
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
@@ -52,16 +65,21 @@
 #include "gi/arg-cache.h"
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
+#include "gi/callback-queue.h"
 #include "gi/closure.h"
 #include "gi/function.h"
 #include "gi/gerror.h"
+#include "gi/gjs_gi_trace.h"
 #include "gi/object.h"
 #include "gi/utils-inl.h"
+#include "cjs/atoms.h"
 #include "cjs/context-private.h"
 #include "cjs/context.h"
 #include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem-private.h"
+#include "cjs/profiler-private.h"
 #include "util/log.h"
 
 /* We use guint8 for arguments; functions can't
@@ -69,46 +87,246 @@
  */
 #define GJS_ARG_INDEX_INVALID G_MAXUINT8
 
+// Calls @address as a C function, with the arguments pointed to by
+// @ffi_arg_pointers, in the same format that ffi_call() takes them
+using GjsDirectThunk = void (*)(void* address, void** ffi_arg_pointers,
+                                GIFFIReturnValue* return_value);
+
+// Argument caches only depend on the introspection info, so they are shared
+// between all Function objects wrapping the same callable, for example a method
+// looked up on several prototypes, the same vfunc on several classes, or a
+// constructor invoked from C. They are kept in a process-wide registry since
+// Function objects are finalized on a background thread, and the caches don't
+// contain anything that belongs to a particular JSContext.
+struct GjsSharedArgumentCache {
+    unsigned refcount;
+    std::string key;
+    // The GITypeInfos embedded in the argument cache point into this info
+    GICallableInfo* info;
+    // Offset by one or two, see build_shared_arg_cache()
+    GjsArgumentCache* arguments;
+    GjsArgumentCacheCold* cold_arguments;  // not offset
+    uint8_t n_args;
+    bool is_method : 1;
+    uint8_t js_in_argc;
+    uint8_t js_out_argc;
+    // Shown in profiler samples taken during calls, such as
+    // "Gtk.Widget.queue_resize"
+    std::string profiler_label;
+};
+
+static std::unordered_map<std::string, GjsSharedArgumentCache*>
+    shared_arg_caches;
+static std::mutex shared_arg_caches_lock;
+
+// Opt-in per-callable statistics, enabled with the GJS_PROFILE_FUNCTIONS
+// environment variable. They are kept for the lifetime of the process, so that
+// they can still be dumped after all wrappers of a function are collected.
+// Marshalling time is the total time minus the time spent in the C function.
+// Workers call the same functions, so the map is locked, and the counters are
+// atomic; the entries never move once added.
+struct GjsFunctionStats {
+    std::string name;
+    std::atomic<uint64_t> calls{0};
+    std::atomic<int64_t> total_ns{0};
+    std::atomic<int64_t> native_ns{0};
+};
+
+static std::unordered_map<std::string, GjsFunctionStats> function_stats;
+static std::mutex function_stats_lock;
+
+[[nodiscard]] static bool function_stats_enabled() {
+    static const bool enabled = g_getenv("GJS_PROFILE_FUNCTIONS");
+    return enabled;
+}
+
+[[nodiscard]] static inline int64_t function_stats_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Adds the time spent in its scope to @field of the stats, if any
+class GjsAutoFunctionTimer {
+    std::atomic<int64_t>* m_field;
+    int64_t m_start;
+
+ public:
+    explicit GjsAutoFunctionTimer(
+        GjsFunctionStats* stats, std::atomic<int64_t> GjsFunctionStats::*field)
+        : m_field(G_UNLIKELY(stats) ? &(stats->*field) : nullptr),
+          m_start(m_field ? function_stats_now() : 0) {}
+    ~GjsAutoFunctionTimer() {
+        if (G_UNLIKELY(m_field))
+            m_field->fetch_add(function_stats_now() - m_start,
+                               std::memory_order_relaxed);
+    }
+};
+
 typedef struct {
     GICallableInfo* info;
 
-    GjsArgumentCache* arguments;
+    GjsSharedArgumentCache* shared_arguments;
+    GjsArgumentCache* arguments;  // shared_arguments->arguments
 
     uint8_t js_in_argc;
     guint8 js_out_argc;
     GIFunctionInvoker invoker;
+
+    bool is_method : 1;
+    // All arguments are scalars that can be marshalled without an out or
+    // release phase, see gjs_invoke_trivial_c_function()
+    bool is_trivial : 1;
+
+    // For trivial functions with a common signature, calls the native function
+    // directly instead of through ffi_call(); otherwise null
+    GjsDirectThunk direct_thunk;
+
+    // Null unless GJS_PROFILE_FUNCTIONS is set
+    GjsFunctionStats* stats;
+
+    // Per function and so per context, unlike the shared argument cache; see
+    // GjsFunctionCallState::typecheck_memo. Offset by two, like in_cvalues.
+    GType* typecheck_memo;
+
+    // Set if the last argument taken from JS is a GAsyncReadyCallback, so that
+    // the function may be called without it to get a promise
+    bool has_async_ready_callback : 1;
+    bool async_finish_looked_up : 1;
+    // Set by Gio._promisify(): the promise calls then also record where they
+    // were made, for the stack of the errors they are rejected with
+    bool promisified : 1;
+    // The matching _finish function, looked up on the first such call; null
+    // if there is none
+    struct GjsAsyncFinish* async_finish;
+
+    // Set until the first use of a function defined with
+    // gjs_define_lazy_function(), which initializes the rest from it
+    GICallableInfo* lazy_info;
+    GType lazy_gtype;
 } Function;
 
+// The _finish function of an async function. It is shared by the calls still
+// in progress, since the JS function object may be finalized before they
+// complete.
+struct GjsAsyncFinish {
+    int ref_count;
+    Function function;
+};
+
+struct GjsAsyncPromiseCall {
+    JSContext* cx;
+    JS::PersistentRootedObject promise;
+    // The SavedFrame of the call, only for promisified functions
+    JS::PersistentRootedObject stack;
+    GjsAsyncFinish* finish;
+
+    GjsAsyncPromiseCall(JSContext* context, JSObject* promise_obj,
+                        GjsAsyncFinish* async_finish)
+        : cx(context),
+          promise(context, promise_obj),
+          stack(context),
+          finish(async_finish) {
+        finish->ref_count++;
+    }
+    ~GjsAsyncPromiseCall();
+};
+
+// Functions with more C arguments than this always take the generic path, so
+// that the trivial path can use fixed-size arrays on the stack
+#define GJS_TRIVIAL_MAX_ARGS 8
+
 extern struct JSClass gjs_function_class;
 
 /* Because we can't free the mmap'd data for a callback
  * while it's in use, this list keeps track of ones that
- * will be freed the next time we invoke a C function.
+ * will be freed the next time we invoke a C function, or the next time the
+ * main loop gets control back, whichever comes first.
  */
 static GSList *completed_trampolines = NULL;  /* GjsCallbackTrampoline */
+static unsigned completed_trampolines_idle_id = 0;
+
+static gboolean complete_async_calls_idle(void*);
 
 GJS_DEFINE_PRIV_FROM_JS(Function, gjs_function_class)
 
+GjsFunctionCallState::GjsFunctionCallState(JSContext* cx)
+    : instance_object(cx),
+      async_call(nullptr),
+      typecheck_memo(nullptr),
+      call_completed(false),
+      arena(GjsContextPrivate::from_cx(cx)->call_arena()) {}
+
 void
 gjs_callback_trampoline_ref(GjsCallbackTrampoline *trampoline)
 {
     trampoline->ref_count++;
 }
 
+/* Trampolines for call and async callbacks are kept here once they are no
+ * longer used, without their JS function, so that passing a JS function for
+ * the same type of callback again can reuse the prepared ffi closure instead of
+ * allocating executable memory for a new one. The most recently released ones
+ * are at the end.
+ */
+static std::vector<GjsCallbackTrampoline*> trampoline_pool;
+static constexpr size_t TRAMPOLINE_POOL_SIZE = 16;
+
+static void gjs_callback_trampoline_free(GjsCallbackTrampoline* trampoline) {
+    g_clear_pointer(&trampoline->js_function, g_closure_unref);
+    if (trampoline->info && trampoline->closure) {
+        g_callable_info_free_closure(trampoline->info, trampoline->closure);
+        GJS_SUB_BYTES(ffi_closure, sizeof(ffi_closure));
+    }
+    GJS_SUB_BYTES(callback_trampoline,
+                  sizeof(GjsCallbackTrampoline) +
+                      trampoline->n_args * sizeof(GjsCallbackParam));
+    g_clear_pointer(&trampoline->info, g_base_info_unref);
+    g_free(trampoline->params);
+    g_slice_free(GjsCallbackTrampoline, trampoline);
+}
+
+[[nodiscard]] static bool trampoline_is_poolable(
+    const GjsCallbackTrampoline* trampoline) {
+    return trampoline->closure && !trampoline->is_vfunc &&
+           (trampoline->scope == GI_SCOPE_TYPE_CALL ||
+            trampoline->scope == GI_SCOPE_TYPE_ASYNC);
+}
+
+[[nodiscard]] static GjsCallbackTrampoline* take_pooled_trampoline(
+    GICallableInfo* info) {
+    for (auto it = trampoline_pool.rbegin(); it != trampoline_pool.rend();
+         ++it) {
+        GjsCallbackTrampoline* trampoline = *it;
+        if (g_base_info_equal(trampoline->info, info)) {
+            trampoline_pool.erase(std::next(it).base());
+            return trampoline;
+        }
+    }
+    return nullptr;
+}
+
 void
 gjs_callback_trampoline_unref(GjsCallbackTrampoline *trampoline)
 {
-    /* Not MT-safe, like all the rest of GJS */
+    // The pool and the JS function are not MT-safe, so the last reference may
+    // only be dropped on the context's thread
+    if (--trampoline->ref_count > 0)
+        return;
 
-    trampoline->ref_count--;
-    if (trampoline->ref_count == 0) {
-        g_clear_pointer(&trampoline->js_function, g_closure_unref);
-        if (trampoline->info && trampoline->closure)
-            g_callable_info_free_closure(trampoline->info, trampoline->closure);
-        g_clear_pointer(&trampoline->info, g_base_info_unref);
-        g_free (trampoline->param_types);
-        g_slice_free(GjsCallbackTrampoline, trampoline);
+    GJS_DEC_UNTOTALED_COUNTER(callback_trampoline);
+
+    if (!trampoline_is_poolable(trampoline)) {
+        gjs_callback_trampoline_free(trampoline);
+        return;
     }
+
+    g_clear_pointer(&trampoline->js_function, g_closure_unref);
+    if (trampoline_pool.size() == TRAMPOLINE_POOL_SIZE) {
+        gjs_callback_trampoline_free(trampoline_pool.front());
+        trampoline_pool.erase(trampoline_pool.begin());
+    }
+    trampoline_pool.push_back(trampoline);
 }
 
 template <typename T, GITypeTag TAG = GI_TYPE_TAG_VOID>
@@ -228,24 +446,58 @@ warn_about_illegal_js_callback(const GjsCallbackTrampoline *trampoline,
     return;
 }
 
+// Hands a callback invoked on another thread to the thread of @gjs
+static void queue_thread_callback(GjsContextPrivate* gjs,
+                                  GjsCallbackTrampoline* trampoline,
+                                  bool is_vfunc, ffi_cif* cif, void* result,
+                                  void** ffi_args);
+
 /* This is our main entry point for ffi_closure callbacks.
  * ffi_prep_closure is doing pure magic and replaces the original
  * function call with this one which gives us the ffi arguments,
  * a place to store the return value and our use data.
  * In other words, everything we need to call the JS function and
  * getting the return value back.
+ *
+ * Vfuncs get their own instantiation, since they are often called many times
+ * per frame (e.g. drawing or allocation): their JS function lives as long as
+ * the class, so it can be called directly instead of through
+ * gjs_closure_invoke(), and they never need the async callback bookkeeping.
  */
-static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
-                                 void** ffi_args, void* data) {
+template <bool is_vfunc>
+static void gjs_callback_closure(ffi_cif* cif, void* result, void** ffi_args,
+                                 void* data) {
     JSContext *context;
     GjsCallbackTrampoline *trampoline;
     int i, n_args, n_jsargs, n_outargs, c_args_offset = 0;
-    GITypeInfo ret_type;
     bool success = false;
     auto args = reinterpret_cast<GIArgument **>(ffi_args);
 
     trampoline = (GjsCallbackTrampoline *) data;
     g_assert(trampoline);
+
+    if (G_UNLIKELY(!trampoline->js_function)) {
+        warn_about_illegal_js_callback(trampoline, "after it was released",
+            "calling an async callback more than once");
+        return;
+    }
+
+    // Checked before anything else, since the trampoline's reference count
+    // and the context's state belong to the context's thread
+    context = gjs_closure_get_context(trampoline->js_function);
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
+    if (G_UNLIKELY(!gjs->is_owner_thread())) {
+        if (gjs->thread_callbacks().enabled() &&
+            (is_vfunc || trampoline->scope != GI_SCOPE_TYPE_CALL)) {
+            queue_thread_callback(gjs, trampoline, is_vfunc, cif, result,
+                                  ffi_args);
+            return;
+        }
+        warn_about_illegal_js_callback(trampoline, "on a different thread",
+            "an API not intended to be used in JS");
+        return;
+    }
+
     gjs_callback_trampoline_ref(trampoline);
 
     if (G_UNLIKELY(!gjs_closure_is_valid(trampoline->js_function))) {
@@ -257,8 +509,6 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
         return;
     }
 
-    context = gjs_closure_get_context(trampoline->js_function);
-    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
     if (G_UNLIKELY(gjs->sweeping())) {
         warn_about_illegal_js_callback(trampoline, "during garbage collection",
             "destroying a Clutter actor or GTK widget with ::destroy signal "
@@ -268,23 +518,17 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
         return;
     }
 
-    if (G_UNLIKELY(!gjs->is_owner_thread())) {
-        warn_about_illegal_js_callback(trampoline, "on a different thread",
-            "an API not intended to be used in JS");
-        gjs_callback_trampoline_unref(trampoline);
-        return;
-    }
-
     JSAutoRealm ar(context, JS_GetFunctionObject(gjs_closure_get_callable(
                                 trampoline->js_function)));
 
-    bool can_throw_gerror = g_callable_info_can_throw_gerror(trampoline->info);
-    n_args = g_callable_info_get_n_args(trampoline->info);
-
-    g_assert(n_args >= 0);
+    bool can_throw_gerror = trampoline->can_throw_gerror;
+    n_args = trampoline->n_args;
+    n_outargs = trampoline->n_outargs;
+    GITypeInfo* ret_type = &trampoline->ret_type;
+    bool ret_type_is_void = trampoline->ret_type_is_void;
 
     JS::RootedObject this_object(context);
-    if (trampoline->is_vfunc) {
+    if constexpr (is_vfunc) {
         GObject* gobj = G_OBJECT(gjs_arg_get<GObject*>(args[0]));
         if (gobj) {
             this_object = ObjectInstance::wrapper_from_gobject(context, gobj);
@@ -299,78 +543,46 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
         c_args_offset = 1;
     }
 
-    n_outargs = 0;
     JS::RootedValueVector jsargs(context);
-
-    if (!jsargs.reserve(n_args))
+    if (!jsargs.resize(trampoline->n_jsargs))
         g_error("Unable to reserve space for vector");
 
     JS::RootedValue rval(context);
 
-    g_callable_info_load_return_type(trampoline->info, &ret_type);
-    bool ret_type_is_void = g_type_info_get_tag (&ret_type) == GI_TYPE_TAG_VOID;
-
     for (i = 0, n_jsargs = 0; i < n_args; i++) {
-        GIArgInfo arg_info;
-        GITypeInfo type_info;
-        GjsParamType param_type;
-
-        g_callable_info_load_arg(trampoline->info, i, &arg_info);
-        g_arg_info_load_type(&arg_info, &type_info);
-
-        /* Skip void * arguments */
-        if (g_type_info_get_tag(&type_info) == GI_TYPE_TAG_VOID)
-            continue;
-
-        if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_OUT) {
-            n_outargs++;
+        GjsCallbackParam* param = &trampoline->params[i];
+        if (!param->to_js)
             continue;
-        }
-
-        if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_INOUT)
-            n_outargs++;
 
-        param_type = trampoline->param_types[i];
-
-        switch (param_type) {
-            case PARAM_SKIPPED:
-                continue;
+        switch (param->param_type) {
             case PARAM_ARRAY: {
-                gint array_length_pos = g_type_info_get_array_length(&type_info);
-                GIArgInfo array_length_arg;
-                GITypeInfo arg_type_info;
+                GjsCallbackParam* length_param =
+                    &trampoline->params[param->array_length_pos];
                 JS::RootedValue length(context);
 
-                g_callable_info_load_arg(trampoline->info, array_length_pos, &array_length_arg);
-                g_arg_info_load_type(&array_length_arg, &arg_type_info);
-                if (!gjs_value_from_g_argument(context, &length, &arg_type_info,
-                                               args[array_length_pos + c_args_offset],
-                                               true))
+                if (!gjs_value_from_g_argument(
+                        context, &length, &length_param->type_info,
+                        args[param->array_length_pos + c_args_offset], true))
                     goto out;
 
-                if (!jsargs.growBy(1))
-                    g_error("Unable to grow vector");
-
                 if (!gjs_value_from_explicit_array(context, jsargs[n_jsargs++],
-                                                   &type_info,
+                                                   &param->type_info,
                                                    args[i + c_args_offset],
                                                    length.toInt32()))
                     goto out;
                 break;
             }
             case PARAM_NORMAL: {
-                if (!jsargs.growBy(1))
-                    g_error("Unable to grow vector");
-
                 GIArgument* arg = args[i + c_args_offset];
-                if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_INOUT)
+                if (param->direction == GI_DIRECTION_INOUT)
                     arg = *reinterpret_cast<GIArgument**>(arg);
 
                 if (!gjs_value_from_g_argument(context, jsargs[n_jsargs++],
-                                               &type_info, arg, false))
+                                               &param->type_info, arg, false))
                     goto out;
                 break;
             }
+            case PARAM_SKIPPED:
             case PARAM_CALLBACK:
                 /* Callbacks that accept another callback as a parameter are not
                  * supported, see gjs_callback_trampoline_new() */
@@ -381,42 +593,44 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
         }
     }
 
-    if (!gjs_closure_invoke(trampoline->js_function, this_object, jsargs, &rval,
-                            true))
-        goto out;
+    if constexpr (is_vfunc) {
+        JS::RootedFunction func(
+            context, gjs_closure_get_callable(trampoline->js_function));
+        if (!JS::Call(context, this_object, func, jsargs, &rval)) {
+            // Same as gjs_closure_invoke() with return_exception
+            if (JS_IsExceptionPending(context))
+                JS_GetPendingException(context, &rval);
+            goto out;
+        }
+    } else {
+        if (!gjs_closure_invoke(trampoline->js_function, this_object, jsargs,
+                                &rval, true))
+            goto out;
+    }
 
     if (n_outargs == 0 && ret_type_is_void) {
         /* void return value, no out args, nothing to do */
     } else if (n_outargs == 0) {
         GIArgument argument;
-        GITransfer transfer;
 
-        transfer = g_callable_info_get_caller_owns (trampoline->info);
         /* non-void return value, no out args. Should
          * be a single return value. */
-        if (!gjs_value_to_g_argument(context,
-                                     rval,
-                                     &ret_type,
-                                     "callback",
+        if (!gjs_value_to_g_argument(context, rval, ret_type, "callback",
                                      GJS_ARGUMENT_RETURN_VALUE,
-                                     transfer,
-                                     true,
+                                     trampoline->ret_transfer, true,
                                      &argument))
             goto out;
 
-        set_return_ffi_arg_from_giargument(&ret_type,
-                                           result,
-                                           &argument);
+        set_return_ffi_arg_from_giargument(ret_type, result, &argument);
     } else if (n_outargs == 1 && ret_type_is_void) {
         /* void return value, one out args. Should
          * be a single return value. */
         for (i = 0; i < n_args; i++) {
-            GIArgInfo arg_info;
-            g_callable_info_load_arg(trampoline->info, i, &arg_info);
-            if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_IN)
+            GjsCallbackParam* param = &trampoline->params[i];
+            if (param->direction == GI_DIRECTION_IN)
                 continue;
 
-            if (!gjs_value_to_arg(context, rval, &arg_info,
+            if (!gjs_value_to_arg(context, rval, &param->arg_info,
                                   *reinterpret_cast<GIArgument **>(args[i + c_args_offset])))
                 goto out;
 
@@ -446,33 +660,30 @@ static void gjs_callback_closure(ffi_cif* cif [[maybe_unused]], void* result,
 
         if (!ret_type_is_void) {
             GIArgument argument;
-            GITransfer transfer = g_callable_info_get_caller_owns(trampoline->info);
 
             if (!JS_GetElement(context, out_array, elem_idx, &elem))
                 goto out;
 
-            if (!gjs_value_to_g_argument(context, elem, &ret_type, "callback",
-                                         GJS_ARGUMENT_RETURN_VALUE, transfer,
-                                         true, &argument))
+            if (!gjs_value_to_g_argument(context, elem, ret_type, "callback",
+                                         GJS_ARGUMENT_RETURN_VALUE,
+                                         trampoline->ret_transfer, true,
+                                         &argument))
                 goto out;
 
-            set_return_ffi_arg_from_giargument(&ret_type,
-                                               result,
-                                               &argument);
+            set_return_ffi_arg_from_giargument(ret_type, result, &argument);
 
             elem_idx++;
         }
 
         for (i = 0; i < n_args; i++) {
-            GIArgInfo arg_info;
-            g_callable_info_load_arg(trampoline->info, i, &arg_info);
-            if (g_arg_info_get_direction(&arg_info) == GI_DIRECTION_IN)
+            GjsCallbackParam* param = &trampoline->params[i];
+            if (param->direction == GI_DIRECTION_IN)
                 continue;
 
             if (!JS_GetElement(context, out_array, elem_idx, &elem))
                 goto out;
 
-            if (!gjs_value_to_arg(context, elem, &arg_info,
+            if (!gjs_value_to_arg(context, elem, &param->arg_info,
                                   *(GIArgument **)args[i + c_args_offset]))
                 goto out;
 
@@ -504,9 +715,8 @@ out:
         /* Fill in the result with some hopefully neutral value */
         if (!ret_type_is_void) {
             GIArgument argument = {};
-            g_callable_info_load_return_type(trampoline->info, &ret_type);
-            gjs_gi_argument_init_default(&ret_type, &argument);
-            set_return_ffi_arg_from_giargument(&ret_type, result, &argument);
+            gjs_gi_argument_init_default(ret_type, &argument);
+            set_return_ffi_arg_from_giargument(ret_type, result, &argument);
         }
 
         /* If the callback has a GError** argument and invoking the closure
@@ -529,14 +739,282 @@ out:
         gjs_log_exception_uncaught(context);
     }
 
-    if (trampoline->scope == GI_SCOPE_TYPE_ASYNC) {
+    if (!is_vfunc && trampoline->scope == GI_SCOPE_TYPE_ASYNC) {
+        // An async callback is only called once, so the JS function can be
+        // let go of right away; only the ffi closure, which is still running,
+        // has to wait.
+        g_clear_pointer(&trampoline->js_function, g_closure_unref);
+
         completed_trampolines = g_slist_prepend(completed_trampolines, trampoline);
+        if (!completed_trampolines_idle_id) {
+            completed_trampolines_idle_id = g_idle_add_full(
+                G_PRIORITY_HIGH, complete_async_calls_idle, nullptr, nullptr);
+        }
     }
 
     gjs_callback_trampoline_unref(trampoline);
     gjs->schedule_gc_if_needed();
 }
 
+// A callback invoked on another thread, queued to run on its context's thread.
+// If the caller waits for it, it lives on the caller's stack and points to the
+// caller's arguments; otherwise it owns copies of them. Either way it holds a
+// reference to the trampoline, taken on the calling thread while the caller
+// still holds the callback, so that an unref on the context's thread in the
+// meantime can't free the trampoline from under it.
+struct GjsThreadCallback : GjsQueuedCallback {
+    GjsCallbackTrampoline* trampoline;
+    ffi_cif* cif;
+    void* result;
+    void** ffi_args;
+    bool is_vfunc : 1;
+    bool waits : 1;
+    bool unref_only : 1;  // for a GDestroyNotify, nothing to call
+
+    // Only if the caller waits
+    std::mutex lock;
+    std::condition_variable cond;
+    bool done = false;
+
+    // Only if the caller doesn't wait
+    std::vector<GIArgument> arg_values;
+    std::vector<void*> arg_pointers;
+    GIArgument return_value;
+};
+
+// The first C argument of a vfunc is the instance, which is not in the
+// trampoline's params
+[[nodiscard]] static inline unsigned c_args_offset(
+    const GjsThreadCallback* call) {
+    return call->is_vfunc ? 1 : 0;
+}
+
+static void copy_thread_callback_args(GjsThreadCallback* call) {
+    unsigned n_args = call->cif->nargs;
+    call->arg_values.resize(n_args);
+    call->arg_pointers.resize(n_args);
+    for (unsigned ix = 0; ix < n_args; ix++) {
+        size_t size = call->cif->arg_types[ix]->size;
+        g_assert(size <= sizeof(GIArgument));
+        memcpy(&call->arg_values[ix], call->ffi_args[ix], size);
+        call->arg_pointers[ix] = &call->arg_values[ix];
+    }
+    call->ffi_args = call->arg_pointers.data();
+    call->result = &call->return_value;
+
+    if (call->is_vfunc) {
+        if (auto* gobj = gjs_arg_get<GObject*>(&call->arg_values[0]))
+            g_object_ref(gobj);
+    }
+    GjsCallbackTrampoline* trampoline = call->trampoline;
+    for (int ix = 0; ix < trampoline->n_args; ix++) {
+        GIArgument* arg = &call->arg_values[ix + c_args_offset(call)];
+        switch (trampoline->params[ix].copy) {
+            case COPY_OBJECT:
+                if (auto* gobj = gjs_arg_get<GObject*>(arg))
+                    g_object_ref(gobj);
+                break;
+            case COPY_STRING:
+                gjs_arg_set(arg, g_strdup(gjs_arg_get<char*>(arg)));
+                break;
+            case COPY_VALUE:
+            default:
+                break;
+        }
+    }
+}
+
+static void release_thread_callback_args(GjsThreadCallback* call) {
+    if (call->is_vfunc) {
+        if (auto* gobj = gjs_arg_get<GObject*>(&call->arg_values[0]))
+            g_object_unref(gobj);
+    }
+    GjsCallbackTrampoline* trampoline = call->trampoline;
+    for (int ix = 0; ix < trampoline->n_args; ix++) {
+        GIArgument* arg = &call->arg_values[ix + c_args_offset(call)];
+        switch (trampoline->params[ix].copy) {
+            case COPY_OBJECT:
+                if (auto* gobj = gjs_arg_get<GObject*>(arg))
+                    g_object_unref(gobj);
+                break;
+            case COPY_STRING:
+                g_free(gjs_arg_get<char*>(arg));
+                break;
+            case COPY_VALUE:
+            default:
+                break;
+        }
+    }
+}
+
+// Runs on the context's thread, or wherever the callback is cancelled if the
+// context is going away
+static void run_thread_callback(GjsQueuedCallback* item, bool cancelled) {
+    auto* call = static_cast<GjsThreadCallback*>(item);
+    GjsCallbackTrampoline* trampoline = call->trampoline;
+
+    if (call->unref_only) {
+        // Leaked if the context is going away, since it can only be freed on
+        // the context's thread
+        if (!cancelled)
+            gjs_callback_trampoline_unref(trampoline);
+        delete call;
+        return;
+    }
+
+    if (!cancelled) {
+        if (call->is_vfunc)
+            gjs_callback_closure<true>(call->cif, call->result, call->ffi_args,
+                                       trampoline);
+        else
+            gjs_callback_closure<false>(call->cif, call->result,
+                                        call->ffi_args, trampoline);
+    }
+
+    if (call->waits) {
+        if (cancelled && !trampoline->ret_type_is_void) {
+            GIArgument argument = {};
+            gjs_gi_argument_init_default(&trampoline->ret_type, &argument);
+            set_return_ffi_arg_from_giargument(&trampoline->ret_type,
+                                               call->result, &argument);
+        }
+        // Like the destroy notify, the reference is leaked if cancelled
+        if (!cancelled)
+            gjs_callback_trampoline_unref(trampoline);
+        // The caller may free @call as soon as it sees @done
+        std::lock_guard<std::mutex> lock(call->lock);
+        call->done = true;
+        call->cond.notify_one();
+        return;
+    }
+
+    release_thread_callback_args(call);
+    if (!cancelled)
+        gjs_callback_trampoline_unref(trampoline);
+    delete call;
+}
+
+static void queue_thread_callback(GjsContextPrivate* gjs,
+                                  GjsCallbackTrampoline* trampoline,
+                                  bool is_vfunc, ffi_cif* cif, void* result,
+                                  void** ffi_args) {
+    if (trampoline->can_queue_async) {
+        auto* call = new GjsThreadCallback();
+        call->run = run_thread_callback;
+        call->trampoline = trampoline;
+        call->cif = cif;
+        call->ffi_args = ffi_args;
+        call->is_vfunc = is_vfunc;
+        call->waits = false;
+        call->unref_only = false;
+        copy_thread_callback_args(call);
+        gjs_callback_trampoline_ref(trampoline);
+        gjs->thread_callbacks().push(call);
+        return;
+    }
+
+    // Anything returned has to be waited for. This deadlocks if the context's
+    // thread is itself waiting for this one, which is up to the caller to
+    // avoid.
+    GjsThreadCallback call;
+    call.run = run_thread_callback;
+    call.trampoline = trampoline;
+    call.cif = cif;
+    call.result = result;
+    call.ffi_args = ffi_args;
+    call.is_vfunc = is_vfunc;
+    call.waits = true;
+    call.unref_only = false;
+    gjs_callback_trampoline_ref(trampoline);
+    gjs->thread_callbacks().push(&call);
+
+    std::unique_lock<std::mutex> lock(call.lock);
+    call.cond.wait(lock, [&call] { return call.done; });
+}
+
+void gjs_callback_trampoline_destroy_notify(GjsCallbackTrampoline* trampoline) {
+    if (trampoline->js_function) {
+        GjsContextPrivate* gjs = GjsContextPrivate::from_cx(
+            gjs_closure_get_context(trampoline->js_function));
+        if (!gjs->is_owner_thread() && gjs->thread_callbacks().enabled()) {
+            // Queued behind any calls of the callback still to run
+            auto* call = new GjsThreadCallback();
+            call->run = run_thread_callback;
+            call->trampoline = trampoline;
+            call->unref_only = true;
+            gjs->thread_callbacks().push(call);
+            return;
+        }
+    }
+
+    gjs_callback_trampoline_unref(trampoline);
+}
+
+// Whether a callback can be queued from another thread without waiting for it,
+// and how to copy each of its arguments if so
+static void init_queue_async(GjsCallbackTrampoline* trampoline) {
+    trampoline->can_queue_async = false;
+    if (!trampoline->ret_type_is_void || trampoline->n_outargs > 0 ||
+        trampoline->can_throw_gerror)
+        return;
+
+    for (int ix = 0; ix < trampoline->n_args; ix++) {
+        GjsCallbackParam* param = &trampoline->params[ix];
+        param->copy = COPY_VALUE;
+        if (!param->to_js)
+            continue;
+        if (param->param_type != PARAM_NORMAL)
+            return;
+
+        GITypeTag tag = g_type_info_get_tag(&param->type_info);
+        switch (tag) {
+            case GI_TYPE_TAG_BOOLEAN:
+            case GI_TYPE_TAG_INT8:
+            case GI_TYPE_TAG_UINT8:
+            case GI_TYPE_TAG_INT16:
+            case GI_TYPE_TAG_UINT16:
+            case GI_TYPE_TAG_INT32:
+            case GI_TYPE_TAG_UINT32:
+            case GI_TYPE_TAG_INT64:
+            case GI_TYPE_TAG_UINT64:
+            case GI_TYPE_TAG_FLOAT:
+            case GI_TYPE_TAG_DOUBLE:
+            case GI_TYPE_TAG_GTYPE:
+            case GI_TYPE_TAG_UNICHAR:
+                break;
+            case GI_TYPE_TAG_UTF8:
+            case GI_TYPE_TAG_FILENAME:
+                if (g_type_info_is_pointer(&param->type_info) &&
+                    g_arg_info_get_ownership_transfer(&param->arg_info) ==
+                        GI_TRANSFER_NOTHING) {
+                    param->copy = COPY_STRING;
+                    break;
+                }
+                return;
+            case GI_TYPE_TAG_INTERFACE: {
+                GjsAutoBaseInfo interface_info =
+                    g_type_info_get_interface(&param->type_info);
+                GIInfoType info_type = interface_info.type();
+                if (info_type == GI_INFO_TYPE_ENUM ||
+                    info_type == GI_INFO_TYPE_FLAGS)
+                    break;
+                if (info_type == GI_INFO_TYPE_OBJECT &&
+                    g_type_is_a(g_registered_type_info_get_g_type(
+                                    interface_info),
+                                G_TYPE_OBJECT)) {
+                    param->copy = COPY_OBJECT;
+                    break;
+                }
+                return;
+            }
+            default:
+                return;
+        }
+    }
+
+    trampoline->can_queue_async = true;
+}
+
 GjsCallbackTrampoline* gjs_callback_trampoline_new(
     JSContext* context, JS::HandleFunction function,
     GICallableInfo* callable_info, GIScopeType scope, bool has_scope_object,
@@ -546,30 +1024,51 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
 
     g_assert(function);
 
+    // Call and async callbacks are always rooted; see below
+    if (!is_vfunc &&
+        (scope == GI_SCOPE_TYPE_CALL || scope == GI_SCOPE_TYPE_ASYNC)) {
+        trampoline = take_pooled_trampoline(callable_info);
+        if (trampoline) {
+            GJS_INC_UNTOTALED_COUNTER(callback_trampoline);
+            trampoline->ref_count = 1;
+            trampoline->js_function = gjs_closure_new(
+                context, function, g_base_info_get_name(callable_info), true);
+            trampoline->scope = scope;
+            return trampoline;
+        }
+    }
+
     trampoline = g_slice_new(GjsCallbackTrampoline);
     new (trampoline) GjsCallbackTrampoline();
+    GJS_INC_UNTOTALED_COUNTER(callback_trampoline);
     trampoline->ref_count = 1;
     trampoline->info = callable_info;
     g_base_info_ref((GIBaseInfo*)trampoline->info);
 
     /* Analyze param types and directions, similarly to init_cached_function_data */
     n_args = g_callable_info_get_n_args(trampoline->info);
-    trampoline->param_types = g_new0(GjsParamType, n_args);
+    trampoline->n_args = n_args;
+    trampoline->params = g_new0(GjsCallbackParam, n_args);
+    GJS_ADD_BYTES(callback_trampoline, sizeof(GjsCallbackTrampoline) +
+                                           n_args * sizeof(GjsCallbackParam));
 
     for (i = 0; i < n_args; i++) {
-        GIDirection direction;
-        GIArgInfo arg_info;
-        GITypeInfo type_info;
+        GjsCallbackParam* param = &trampoline->params[i];
+        g_callable_info_load_arg(trampoline->info, i, &param->arg_info);
+        g_arg_info_load_type(&param->arg_info, &param->type_info);
+        param->direction = g_arg_info_get_direction(&param->arg_info);
+    }
+
+    for (i = 0; i < n_args; i++) {
+        GjsCallbackParam* param = &trampoline->params[i];
+        GIDirection direction = param->direction;
+        GITypeInfo* type_info = &param->type_info;
         GITypeTag type_tag;
 
-        if (trampoline->param_types[i] == PARAM_SKIPPED)
+        if (param->param_type == PARAM_SKIPPED)
             continue;
 
-        g_callable_info_load_arg(trampoline->info, i, &arg_info);
-        g_arg_info_load_type(&arg_info, &type_info);
-
-        direction = g_arg_info_get_direction(&arg_info);
-        type_tag = g_type_info_get_tag(&type_info);
+        type_tag = g_type_info_get_tag(type_info);
 
         if (direction != GI_DIRECTION_IN) {
             /* INOUT and OUT arguments are handled differently. */
@@ -580,7 +1079,7 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
             GIBaseInfo* interface_info;
             GIInfoType interface_type;
 
-            interface_info = g_type_info_get_interface(&type_info);
+            interface_info = g_type_info_get_interface(type_info);
             interface_type = g_base_info_get_type(interface_info);
             if (interface_type == GI_INFO_TYPE_CALLBACK) {
                 gjs_throw(context,
@@ -594,14 +1093,12 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
             }
             g_base_info_unref(interface_info);
         } else if (type_tag == GI_TYPE_TAG_ARRAY) {
-            if (g_type_info_get_array_type(&type_info) == GI_ARRAY_TYPE_C) {
-                int array_length_pos = g_type_info_get_array_length(&type_info);
+            if (g_type_info_get_array_type(type_info) == GI_ARRAY_TYPE_C) {
+                int array_length_pos = g_type_info_get_array_length(type_info);
 
                 if (array_length_pos >= 0 && array_length_pos < n_args) {
-                    GIArgInfo length_arg_info;
-
-                    g_callable_info_load_arg(trampoline->info, array_length_pos, &length_arg_info);
-                    if (g_arg_info_get_direction(&length_arg_info) != direction) {
+                    if (trampoline->params[array_length_pos].direction !=
+                        direction) {
                         gjs_throw(context,
                                   "%s %s has an array with different-direction "
                                   "length argument. This is not supported",
@@ -611,15 +1108,53 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
                         return NULL;
                     }
 
-                    trampoline->param_types[array_length_pos] = PARAM_SKIPPED;
-                    trampoline->param_types[i] = PARAM_ARRAY;
+                    trampoline->params[array_length_pos].param_type =
+                        PARAM_SKIPPED;
+                    param->param_type = PARAM_ARRAY;
+                    param->array_length_pos = array_length_pos;
                 }
             }
         }
     }
 
-    trampoline->closure = g_callable_info_prepare_closure(callable_info, &trampoline->cif,
-                                                          gjs_callback_closure, trampoline);
+    // Which arguments are passed to JS, and how many go the other way
+    trampoline->n_jsargs = trampoline->n_outargs = 0;
+    for (i = 0; i < n_args; i++) {
+        GjsCallbackParam* param = &trampoline->params[i];
+
+        /* Skip void * arguments */
+        if (g_type_info_get_tag(&param->type_info) == GI_TYPE_TAG_VOID)
+            continue;
+
+        if (param->direction == GI_DIRECTION_OUT) {
+            trampoline->n_outargs++;
+            continue;
+        }
+
+        if (param->direction == GI_DIRECTION_INOUT)
+            trampoline->n_outargs++;
+
+        if (param->param_type == PARAM_SKIPPED)
+            continue;
+
+        param->to_js = true;
+        trampoline->n_jsargs++;
+    }
+
+    g_callable_info_load_return_type(callable_info, &trampoline->ret_type);
+    trampoline->ret_type_is_void =
+        g_type_info_get_tag(&trampoline->ret_type) == GI_TYPE_TAG_VOID;
+    trampoline->ret_transfer = g_callable_info_get_caller_owns(callable_info);
+    trampoline->can_throw_gerror =
+        g_callable_info_can_throw_gerror(callable_info);
+    init_queue_async(trampoline);
+
+    trampoline->closure = g_callable_info_prepare_closure(
+        callable_info, &trampoline->cif,
+        is_vfunc ? gjs_callback_closure<true> : gjs_callback_closure<false>,
+        trampoline);
+    if (trampoline->closure)
+        GJS_ADD_BYTES(ffi_closure, sizeof(ffi_closure));
 
     // The rule is:
     // - notify callbacks in GObject methods are traced from the scope object
@@ -660,6 +1195,12 @@ complete_async_calls(void)
     }
 }
 
+static gboolean complete_async_calls_idle(void*) {
+    completed_trampolines_idle_id = 0;
+    complete_async_calls();
+    return G_SOURCE_REMOVE;
+}
+
 static void* get_return_ffi_pointer_from_giargument(
     GjsArgumentCache* return_arg, GIFFIReturnValue* return_value) {
     // This should be the inverse of gi_type_info_extract_ffi_return_value().
@@ -668,7 +1209,7 @@ static void* get_return_ffi_pointer_from_giargument(
 
     // FIXME: Note that v_long and v_ulong don't have type-safe template
     // overloads yet, and I don't understand why they won't compile
-    switch (g_type_info_get_tag(&return_arg->type_info)) {
+    switch (g_type_info_get_tag(return_arg->type_info())) {
         case GI_TYPE_TAG_INT8:
         case GI_TYPE_TAG_INT16:
         case GI_TYPE_TAG_INT32:
@@ -689,7 +1230,7 @@ static void* get_return_ffi_pointer_from_giargument(
             return &gjs_arg_member<double>(return_value);
         case GI_TYPE_TAG_INTERFACE: {
             GjsAutoBaseInfo info =
-                g_type_info_get_interface(&return_arg->type_info);
+                g_type_info_get_interface(return_arg->type_info());
 
             switch (g_base_info_get_type(info)) {
                 case GI_INFO_TYPE_ENUM:
@@ -705,104 +1246,454 @@ static void* get_return_ffi_pointer_from_giargument(
     }
 }
 
-// This function can be called in two different ways. You can either use it to
-// create JavaScript objects by calling it without @r_value, or you can decide
-// to keep the return values in #GArgument format by providing a @r_value
-// argument.
 GJS_JSAPI_RETURN_CONVENTION
-static bool gjs_invoke_c_function(JSContext* context, Function* function,
-                                  const JS::CallArgs& args,
-                                  JS::HandleObject this_obj = nullptr,
-                                  GIArgument* r_value = nullptr) {
-    g_assert((args.isConstructing() || !this_obj) &&
-             "If not a constructor, then pass the 'this' object via CallArgs");
-
-    void* return_value_p;  // will point inside the return GIArgument union
-    GIFFIReturnValue return_value;
-
-    int gi_argc, gi_arg_pos;
-    bool can_throw_gerror;
-    bool did_throw_gerror = false;
-    GError *local_error = NULL;
-    bool failed, postinvoke_release_failed;
-
-    bool is_method;
-    JS::RootedValueVector return_values(context);
-
-    /* Because we can't free a closure while we're in it, we defer
-     * freeing until the next time a C function is invoked.  What
-     * we should really do instead is queue it for a GC thread.
-     */
-    complete_async_calls();
-
-    is_method = g_callable_info_is_method(function->info);
-    can_throw_gerror = g_callable_info_can_throw_gerror(function->info);
-
-    unsigned ffi_argc = function->invoker.cif.nargs;
-    gi_argc = g_callable_info_get_n_args( (GICallableInfo*) function->info);
-    if (gi_argc > GjsArgumentCache::MAX_ARGS) {
-        GjsAutoChar name = format_function_name(function);
-        gjs_throw(context, "Function %s has too many arguments", name.get());
-        return false;
-    }
-
-    // ffi_argc is the number of arguments that the underlying C function takes.
-    // gi_argc is the number of arguments the GICallableInfo describes (which
-    // does not include "this" or GError**). function->js_in_argc is the number
-    // of arguments we expect the JS function to take (which does not include
-    // PARAM_SKIPPED args).
+static bool check_js_argc(JSContext* cx, Function* function,
+                          const JS::CallArgs& args) {
     // args.length() is the number of arguments that were actually passed.
     if (args.length() > function->js_in_argc) {
         GjsAutoChar name = format_function_name(function);
 
-        if (!JS::WarnUTF8(context,
-                          "Too many arguments to %s: expected %u, got %u",
+        if (!JS::WarnUTF8(cx, "Too many arguments to %s: expected %u, got %u",
                           name.get(), function->js_in_argc, args.length()))
             return false;
     } else if (args.length() < function->js_in_argc) {
+        // Leaving out a trailing GAsyncReadyCallback asks for a promise
+        if (function->has_async_ready_callback &&
+            args.length() == function->js_in_argc - 1u)
+            return true;
+
         GjsAutoChar name = format_function_name(function);
 
-        args.reportMoreArgsNeeded(context, name, function->js_in_argc,
+        args.reportMoreArgsNeeded(cx, name, function->js_in_argc,
                                   args.length());
         return false;
     }
 
-    // These arrays hold argument pointers.
-    // - state.in_cvalues: C values which are passed on input (in or inout)
-    // - state.out_cvalues: C values which are returned as arguments (out or
-    //   inout)
-    // - state.inout_original_cvalues: For the special case of (inout) args, we
-    //   need to keep track of the original values we passed into the function,
-    //   in case we need to free it.
-    // - ffi_arg_pointers: For passing data to FFI, we need to create another
-    //   layer of indirection; this array is a pointer to an element in
-    //   state.in_cvalues or state.out_cvalues.
-    // - return_value: The actual return value of the C function, i.e. not an
-    //   (out) param
-    //
-    // The 3 GIArgument arrays are indexed by the GI argument index, with the
-    // following exceptions:
-    // - [-1] is the return value (which can be nothing/garbage if the function
-    //   function returns void)
-    // - [-2] is the instance parameter, if present
-    // ffi_arg_pointers, on the other hand, represents the actual C arguments,
-    // in the way ffi expects them.
-    //
+    return true;
+}
+
+// Mirrors gi_type_info_extract_ffi_return_value() and
+// gjs_value_from_g_argument() for the tags accepted by
+// gjs_arg_cache_is_trivial_return()
+static void trivial_return_value_to_js(GITypeTag tag,
+                                       const GIFFIReturnValue& return_value,
+                                       JS::MutableHandleValue value) {
+    switch (tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+            value.setBoolean(static_cast<gboolean>(return_value.v_ulong) != 0);
+            break;
+        case GI_TYPE_TAG_INT8:
+            value.setInt32(static_cast<int8_t>(return_value.v_long));
+            break;
+        case GI_TYPE_TAG_UINT8:
+            value.setInt32(static_cast<uint8_t>(return_value.v_ulong));
+            break;
+        case GI_TYPE_TAG_INT16:
+            value.setInt32(static_cast<int16_t>(return_value.v_long));
+            break;
+        case GI_TYPE_TAG_UINT16:
+            value.setInt32(static_cast<uint16_t>(return_value.v_ulong));
+            break;
+        case GI_TYPE_TAG_INT32:
+            value.setInt32(static_cast<int32_t>(return_value.v_long));
+            break;
+        case GI_TYPE_TAG_UINT32:
+            value.setNumber(static_cast<uint32_t>(return_value.v_ulong));
+            break;
+        case GI_TYPE_TAG_FLOAT:
+            value.setNumber(return_value.v_float);
+            break;
+        case GI_TYPE_TAG_DOUBLE:
+            value.setNumber(return_value.v_double);
+            break;
+        default:
+            g_assert_not_reached();
+    }
+}
+
+// Direct call thunks are instantiated for a handful of common signatures of
+// trivial functions. Only types which are passed in the same way as their
+// 32-bit, pointer, or double representation in a GIArgument are supported:
+// gboolean, gint, guint, enums, flags, gdouble, and the instance pointer. The
+// signature strings consist of the return type followed by the argument types:
+// 'v' void, 'p' pointer, 'i' 32-bit integer, 'd' double.
+template <typename T>
+[[nodiscard]] static inline T direct_arg(void* ffi_arg_pointer) {
+    auto* arg = static_cast<GIArgument*>(ffi_arg_pointer);
+    if constexpr (std::is_pointer_v<T>)
+        return gjs_arg_get<void*>(arg);
+    else if constexpr (std::is_same_v<T, double>)
+        return gjs_arg_get<double>(arg);
+    else
+        return gjs_arg_get<int, GI_TYPE_TAG_INTERFACE>(arg);
+}
+
+template <typename R, typename... Args, size_t... I>
+static void direct_call_impl(void* address,
+                             void** ffi_arg_pointers [[maybe_unused]],
+                             GIFFIReturnValue* return_value [[maybe_unused]],
+                             std::index_sequence<I...>) {
+    auto* func = reinterpret_cast<R (*)(Args...)>(address);
+    if constexpr (std::is_void_v<R>) {
+        func(direct_arg<Args>(ffi_arg_pointers[I])...);
+    } else if constexpr (std::is_same_v<R, double>) {
+        return_value->v_double = func(direct_arg<Args>(ffi_arg_pointers[I])...);
+    } else {
+        // Stored the same way that libffi widens integer return values
+        return_value->v_long = func(direct_arg<Args>(ffi_arg_pointers[I])...);
+    }
+}
+
+template <typename R, typename... Args>
+static void direct_call(void* address, void** ffi_arg_pointers,
+                        GIFFIReturnValue* return_value) {
+    direct_call_impl<R, Args...>(address, ffi_arg_pointers, return_value,
+                                 std::index_sequence_for<Args...>{});
+}
+
+static const struct {
+    const char* signature;
+    GjsDirectThunk thunk;
+} direct_thunks[] = {
+    {"v", direct_call<void>},
+    {"i", direct_call<int>},
+    {"vi", direct_call<void, int>},
+    {"ii", direct_call<int, int>},
+    {"dd", direct_call<double, double>},
+    {"vp", direct_call<void, void*>},
+    {"ip", direct_call<int, void*>},
+    {"dp", direct_call<double, void*>},
+    {"vpi", direct_call<void, void*, int>},
+    {"ipi", direct_call<int, void*, int>},
+    {"dpi", direct_call<double, void*, int>},
+    {"vpd", direct_call<void, void*, double>},
+    {"ipd", direct_call<int, void*, double>},
+    {"vpii", direct_call<void, void*, int, int>},
+    {"ipii", direct_call<int, void*, int, int>},
+    {"vpdd", direct_call<void, void*, double, double>},
+    {"vpiii", direct_call<void, void*, int, int, int>},
+    {"vpiiii", direct_call<void, void*, int, int, int, int>},
+    {"vpdddd", direct_call<void, void*, double, double, double, double>},
+};
+
+[[nodiscard]] static char direct_signature_char(GITypeTag tag) {
+    switch (tag) {
+        case GI_TYPE_TAG_VOID:
+            return 'v';
+        case GI_TYPE_TAG_BOOLEAN:
+        case GI_TYPE_TAG_INT32:
+        case GI_TYPE_TAG_UINT32:
+        case GI_TYPE_TAG_INTERFACE:
+            return 'i';
+        case GI_TYPE_TAG_DOUBLE:
+            return 'd';
+        default:
+            // Smaller integers may need to be widened by the caller, and floats
+            // are passed differently from doubles; leave those to libffi
+            return '\0';
+    }
+}
+
+// Returns the thunk for a function already determined to be trivial, or null
+// if there is none for its signature.
+[[nodiscard]] static GjsDirectThunk find_direct_thunk(Function* function,
+                                                      uint8_t n_args) {
+    char signature[GJS_TRIVIAL_MAX_ARGS + 2];
+    unsigned pos = 0;
+
+    GjsArgumentCache* return_cache = &function->arguments[-1];
+    GITypeTag return_tag = return_cache->skip_out
+                               ? GI_TYPE_TAG_VOID
+                               : return_cache->contents.number.number_tag;
+    if (!(signature[pos++] = direct_signature_char(return_tag)))
+        return nullptr;
+
+    if (function->is_method)
+        signature[pos++] = 'p';
+
+    for (uint8_t i = 0; i < n_args; i++) {
+        GITypeTag tag =
+            gjs_arg_cache_get_scalar_in_tag(&function->arguments[i]);
+        if (tag == GI_TYPE_TAG_VOID ||
+            !(signature[pos++] = direct_signature_char(tag)))
+            return nullptr;
+    }
+    signature[pos] = '\0';
+
+    for (const auto& entry : direct_thunks) {
+        if (strcmp(entry.signature, signature) == 0)
+            return entry.thunk;
+    }
+    return nullptr;
+}
+
+// Specialized version of gjs_invoke_c_function() for functions where
+// init_cached_function_data() determined that every argument is a scalar in
+// argument, that the return value is void or a scalar, and that no GError can
+// be thrown. None of the arguments need to be released, so there is no out or
+// release phase, and everything needed is already in the argument cache so the
+// typelib does not have to be consulted.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_invoke_trivial_c_function(JSContext* context,
+                                          Function* function,
+                                          const JS::CallArgs& args) {
+    complete_async_calls();
+
+    if (!check_js_argc(context, function, args))
+        return false;
+
+    unsigned ffi_argc = function->invoker.cif.nargs;
+    g_assert(ffi_argc <= GJS_TRIVIAL_MAX_ARGS);
+
+    GjsFunctionCallState state(context);
+    // Only in values are needed; indexed the same way as in
+    // gjs_invoke_c_function(), with [-2] being the instance parameter
+    GIArgument in_cvalues[GJS_TRIVIAL_MAX_ARGS + 2];
+    void* ffi_arg_pointers[GJS_TRIVIAL_MAX_ARGS];
+    unsigned ffi_arg_pos = 0;
+    state.in_cvalues = in_cvalues + 2;
+    state.typecheck_memo = function->typecheck_memo;
+
+    if (function->is_method) {
+        JS::RootedObject obj(context);
+        if (!args.computeThis(context, &obj))
+            return false;
+
+        GjsArgumentCache* cache = &function->arguments[-2];
+        JS::RootedValue in_js_value(context, JS::ObjectValue(*obj));
+        if (!cache->marshallers->in(context, cache, &state,
+                                    &state.in_cvalues[-2], in_js_value))
+            return false;
+
+        ffi_arg_pointers[ffi_arg_pos] = &state.in_cvalues[-2];
+        ++ffi_arg_pos;
+    }
+
+    for (unsigned gi_arg_pos = 0; ffi_arg_pos < ffi_argc;
+         gi_arg_pos++, ffi_arg_pos++) {
+        GjsArgumentCache* cache = &function->arguments[gi_arg_pos];
+        GIArgument* in_value = &state.in_cvalues[gi_arg_pos];
+
+        // Every trivial argument consumes exactly one JS argument
+        if (!cache->marshallers->in(context, cache, &state, in_value,
+                                    args.get(gi_arg_pos)))
+            return false;
+
+        ffi_arg_pointers[ffi_arg_pos] = in_value;
+    }
+
+    GjsArgumentCache* return_cache = &function->arguments[-1];
+    GIFFIReturnValue return_value;
+    {
+        GjsAutoFunctionTimer timer(function->stats,
+                                   &GjsFunctionStats::native_ns);
+        if (function->direct_thunk)
+            function->direct_thunk(function->invoker.native_address,
+                                   ffi_arg_pointers, &return_value);
+        else
+            ffi_call(&function->invoker.cif,
+                     FFI_FN(function->invoker.native_address),
+                     return_cache->skip_out ? nullptr : &return_value,
+                     ffi_arg_pointers);
+    }
+
+    if (return_cache->skip_out)
+        args.rval().setUndefined();
+    else
+        trivial_return_value_to_js(return_cache->contents.number.number_tag,
+                                   return_value, args.rval());
+
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool init_cached_function_data(JSContext*, Function*, GType,
+                                      GICallableInfo*);
+static void uninit_cached_function_data(Function*);
+
+static void async_finish_unref(GjsAsyncFinish* finish) {
+    if (--finish->ref_count > 0)
+        return;
+    uninit_cached_function_data(&finish->function);
+    g_free(finish);
+}
+
+GjsAsyncPromiseCall::~GjsAsyncPromiseCall() { async_finish_unref(finish); }
+
+// Finds the _finish function that goes with the async function @info, by the
+// GIO naming convention: foo_async() or foo() pairs with foo_finish()
+[[nodiscard]] static GIFunctionInfo* find_finish_function(GIBaseInfo* info) {
+    const char* name = g_base_info_get_name(info);
+    std::string finish_name(name);
+    if (g_str_has_suffix(name, "_async"))
+        finish_name.resize(finish_name.size() - strlen("_async"));
+    finish_name += "_finish";
+
+    GIBaseInfo* container = g_base_info_get_container(info);
+    GIInfoType container_type =
+        container ? g_base_info_get_type(container) : GI_INFO_TYPE_INVALID;
+    switch (container_type) {
+        case GI_INFO_TYPE_OBJECT:
+            return g_object_info_find_method(container, finish_name.c_str());
+        case GI_INFO_TYPE_INTERFACE:
+            return g_interface_info_find_method(container,
+                                                finish_name.c_str());
+        case GI_INFO_TYPE_STRUCT:
+            return g_struct_info_find_method(container, finish_name.c_str());
+        default: {
+            GjsAutoBaseInfo found = g_irepository_find_by_name(
+                nullptr, g_base_info_get_namespace(info), finish_name.c_str());
+            if (!found || found.type() != GI_INFO_TYPE_FUNCTION)
+                return nullptr;
+            return found.release();
+        }
+    }
+}
+
+// Sets up a call of @function without its GAsyncReadyCallback, returning the
+// promise that will be settled when it finishes; or, if it has no _finish
+// function, throws the same error as for any missing argument.
+GJS_JSAPI_RETURN_CONVENTION
+static GjsAsyncPromiseCall* async_promise_call_new(JSContext* cx,
+                                                   Function* function,
+                                                   const JS::CallArgs& args) {
+    if (!function->async_finish_looked_up) {
+        function->async_finish_looked_up = true;
+
+        GjsAutoFunctionInfo finish_info = find_finish_function(function->info);
+        if (finish_info) {
+            auto* finish = g_new0(GjsAsyncFinish, 1);
+            finish->ref_count = 1;
+            if (!init_cached_function_data(cx, &finish->function, 0,
+                                           finish_info)) {
+                async_finish_unref(finish);
+                return nullptr;
+            }
+            // It can only be called with the GAsyncResult
+            if (finish->function.js_in_argc == 1)
+                function->async_finish = finish;
+            else
+                async_finish_unref(finish);
+        }
+    }
+
+    if (!function->async_finish) {
+        GjsAutoChar name = format_function_name(function);
+        args.reportMoreArgsNeeded(cx, name, function->js_in_argc,
+                                  args.length());
+        return nullptr;
+    }
+
+    JS::RootedObject promise(cx, JS::NewPromiseObject(cx, nullptr));
+    if (!promise)
+        return nullptr;
+    auto* call = new GjsAsyncPromiseCall(cx, promise, function->async_finish);
+    if (function->promisified && !JS::CaptureCurrentStack(cx, &call->stack)) {
+        delete call;
+        return nullptr;
+    }
+    return call;
+}
+
+// This function can be called in two different ways. You can either use it to
+// create JavaScript objects by calling it without @r_value, or you can decide
+// to keep the return values in #GArgument format by providing a @r_value
+// argument. If @out_obj is given, the return value and out arguments are
+// stored in its elements instead of in a new array, see callInto().
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_invoke_c_function(JSContext* context, Function* function,
+                                  const JS::CallArgs& args,
+                                  JS::HandleObject this_obj = nullptr,
+                                  GIArgument* r_value = nullptr,
+                                  JS::HandleObject out_obj = nullptr) {
+    g_assert((args.isConstructing() || !this_obj) &&
+             "If not a constructor, then pass the 'this' object via CallArgs");
+
+    void* return_value_p;  // will point inside the return GIArgument union
+    GIFFIReturnValue return_value;
+
+    int gi_argc, gi_arg_pos;
+    bool can_throw_gerror;
+    bool did_throw_gerror = false;
+    GError *local_error = NULL;
+    bool failed, postinvoke_release_failed;
+
+    bool is_method;
+    JS::RootedValueVector return_values(context);
+
+    /* Because we can't free a closure while we're in it, we defer
+     * freeing until the next time a C function is invoked.  What
+     * we should really do instead is queue it for a GC thread.
+     */
+    complete_async_calls();
+
+    is_method = g_callable_info_is_method(function->info);
+    can_throw_gerror = g_callable_info_can_throw_gerror(function->info);
+
+    unsigned ffi_argc = function->invoker.cif.nargs;
+    gi_argc = g_callable_info_get_n_args( (GICallableInfo*) function->info);
+    if (gi_argc > GjsArgumentCache::MAX_ARGS) {
+        GjsAutoChar name = format_function_name(function);
+        gjs_throw(context, "Function %s has too many arguments", name.get());
+        return false;
+    }
+
+    // ffi_argc is the number of arguments that the underlying C function takes.
+    // gi_argc is the number of arguments the GICallableInfo describes (which
+    // does not include "this" or GError**). function->js_in_argc is the number
+    // of arguments we expect the JS function to take (which does not include
+    // PARAM_SKIPPED args).
+    if (!check_js_argc(context, function, args))
+        return false;
+
+    // These arrays hold argument pointers.
+    // - state.in_cvalues: C values which are passed on input (in or inout)
+    // - state.out_cvalues: C values which are returned as arguments (out or
+    //   inout)
+    // - state.inout_original_cvalues: For the special case of (inout) args, we
+    //   need to keep track of the original values we passed into the function,
+    //   in case we need to free it.
+    // - ffi_arg_pointers: For passing data to FFI, we need to create another
+    //   layer of indirection; this array is a pointer to an element in
+    //   state.in_cvalues or state.out_cvalues.
+    // - return_value: The actual return value of the C function, i.e. not an
+    //   (out) param
+    //
+    // The 3 GIArgument arrays are indexed by the GI argument index, with the
+    // following exceptions:
+    // - [-1] is the return value (which can be nothing/garbage if the function
+    //   function returns void)
+    // - [-2] is the instance parameter, if present
+    // ffi_arg_pointers, on the other hand, represents the actual C arguments,
+    // in the way ffi expects them.
+    //
     // Use gi_arg_pos to index inside the GIArgument array. Use ffi_arg_pos to
     // index inside ffi_arg_pointers.
     GjsFunctionCallState state(context);
-    if (is_method) {
-        state.in_cvalues = g_newa(GIArgument, gi_argc + 2) + 2;
-        state.out_cvalues = g_newa(GIArgument, gi_argc + 2) + 2;
-        state.inout_original_cvalues = g_newa(GIArgument, gi_argc + 2) + 2;
-    } else {
-        state.in_cvalues = g_newa(GIArgument, gi_argc + 1) + 1;
-        state.out_cvalues = g_newa(GIArgument, gi_argc + 1) + 1;
-        state.inout_original_cvalues = g_newa(GIArgument, gi_argc + 1) + 1;
+    state.typecheck_memo = function->typecheck_memo;
+    GjsArena* arena = state.arena.arena();
+    unsigned cvalues_offset = is_method ? 2 : 1;
+    state.in_cvalues =
+        arena->alloc_n<GIArgument>(gi_argc + cvalues_offset) + cvalues_offset;
+    state.out_cvalues =
+        arena->alloc_n<GIArgument>(gi_argc + cvalues_offset) + cvalues_offset;
+    state.inout_original_cvalues =
+        arena->alloc_n<GIArgument>(gi_argc + cvalues_offset) + cvalues_offset;
+
+    void** ffi_arg_pointers = arena->alloc_n<void*>(ffi_argc);
+
+    // Called without its GAsyncReadyCallback; return a promise instead, which
+    // a native callback settles with the result of the _finish function
+    std::unique_ptr<GjsAsyncPromiseCall> async_call;
+    JS::RootedObject promise(context);
+    if (args.length() < function->js_in_argc) {
+        async_call.reset(async_promise_call_new(context, function, args));
+        if (!async_call)
+            return false;
+        promise = async_call->promise;
+        state.async_call = async_call.get();
     }
 
-    void** ffi_arg_pointers = g_newa(void*, ffi_argc);
-
     failed = false;
     unsigned ffi_arg_pos = 0;  // index into ffi_arg_pointers
     unsigned js_arg_pos = 0;   // index into args
@@ -838,7 +1729,7 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
         gjs_debug_marshal(GJS_DEBUG_GFUNCTION,
                           "Marshalling argument '%s' in, %d/%d GI args, %u/%u "
                           "C args, %u/%u JS args",
-                          cache->arg_name, gi_arg_pos, gi_argc, ffi_arg_pos,
+                          cache->arg_name(), gi_arg_pos, gi_argc, ffi_arg_pos,
                           ffi_argc, js_arg_pos, args.length());
 
         ffi_arg_pointers[ffi_arg_pos] = in_value;
@@ -850,7 +1741,7 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
                       "function is unsupported, or there may be a bug in "
                       "its annotations.",
                       g_base_info_get_namespace(function->info),
-                      g_base_info_get_name(function->info), cache->arg_name);
+                      g_base_info_get_name(function->info), cache->arg_name());
             failed = true;
             break;
         }
@@ -895,8 +1786,15 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
 
     return_value_p = get_return_ffi_pointer_from_giargument(
         &function->arguments[-1], &return_value);
-    ffi_call(&(function->invoker.cif), FFI_FN(function->invoker.native_address),
-             return_value_p, ffi_arg_pointers);
+    {
+        GjsAutoFunctionTimer timer(function->stats,
+                                   &GjsFunctionStats::native_ns);
+        ffi_call(&(function->invoker.cif),
+                 FFI_FN(function->invoker.native_address), return_value_p,
+                 ffi_arg_pointers);
+    }
+    // Now owned by the GAsyncReadyCallback, which may even have run already
+    (void)async_call.release();
 
     /* Return value and out arguments are valid only if invocation doesn't
      * return error. In arguments need to be released always.
@@ -912,7 +1810,7 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
 
     if (!function->arguments[-1].skip_out) {
         gi_type_info_extract_ffi_return_value(
-            &function->arguments[-1].type_info, &return_value,
+            function->arguments[-1].type_info(), &return_value,
             &state.out_cvalues[-1]);
     }
 
@@ -925,7 +1823,7 @@ static bool gjs_invoke_c_function(JSContext* context, Function* function,
 
         gjs_debug_marshal(GJS_DEBUG_GFUNCTION,
                           "Marshalling argument '%s' out, %d/%d GI args",
-                          cache->arg_name, gi_arg_pos, gi_argc);
+                          cache->arg_name(), gi_arg_pos, gi_argc);
 
         JS::RootedValue js_out_arg(context);
         if (!r_value) {
@@ -976,7 +1874,7 @@ release:
         gjs_debug_marshal(
             GJS_DEBUG_GFUNCTION,
             "Releasing argument '%s', %d/%d GI args, %u/%u C args",
-            cache->arg_name, gi_arg_pos, gi_argc, ffi_arg_pos,
+            cache->arg_name(), gi_arg_pos, gi_argc, ffi_arg_pos,
             processed_c_args);
 
         // Only process in or inout arguments if we failed, the rest is garbage
@@ -1006,7 +1904,23 @@ release:
         // If we have one return value or out arg, return that item on its
         // own, otherwise return a JavaScript array with [return value,
         // out arg 1, out arg 2, ...]
-        if (function->js_out_argc == 1) {
+        if (out_obj) {
+            for (size_t ix = 0; ix < return_values.length(); ix++) {
+                if (!JS_SetElement(context, out_obj, ix, return_values[ix])) {
+                    failed = true;
+                    break;
+                }
+            }
+            // Drop elements left over from a call with more results
+            const GjsAtoms& atoms = GjsContextPrivate::atoms(context);
+            JS::RootedValue length(
+                context, JS::NumberValue(double(return_values.length())));
+            if (!failed &&
+                !JS_SetPropertyById(context, out_obj, atoms.length(), length))
+                failed = true;
+            if (!failed)
+                args.rval().setObject(*out_obj);
+        } else if (function->js_out_argc == 1) {
             args.rval().set(return_values[0]);
         } else {
             JSObject* array = JS::NewArrayObject(context, return_values);
@@ -1018,6 +1932,9 @@ release:
         }
     }
 
+    if (promise && !r_value && !failed && !did_throw_gerror)
+        args.rval().setObject(*promise);
+
     if (!failed && did_throw_gerror) {
         return gjs_throw_gerror(context, local_error);
     } else if (failed) {
@@ -1027,6 +1944,247 @@ release:
     }
 }
 
+// Leaves out the success flag of _finish functions that also have out
+// arguments, as Gio._promisify() does
+GJS_JSAPI_RETURN_CONVENTION
+static bool async_finish_result(JSContext* cx, JS::MutableHandleValue result) {
+    if (!result.isObject())
+        return true;
+
+    JS::RootedObject array(cx, &result.toObject());
+    bool is_array;
+    if (!JS::IsArrayObject(cx, array, &is_array))
+        return false;
+    if (!is_array)
+        return true;
+
+    uint32_t length;
+    JS::RootedValue first(cx);
+    if (!JS::GetArrayLength(cx, array, &length) ||
+        !JS_GetElement(cx, array, 0, &first))
+        return false;
+    if (length < 2 || !first.isTrue())
+        return true;
+
+    JS::RootedValueVector rest(cx);
+    if (!rest.resize(length - 1)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    for (uint32_t ix = 1; ix < length; ix++) {
+        if (!JS_GetElement(cx, array, ix, rest[ix - 1]))
+            return false;
+    }
+
+    JSObject* rest_array = JS::NewArrayObject(cx, rest);
+    if (!rest_array)
+        return false;
+    result.setObject(*rest_array);
+    return true;
+}
+
+// Calls the _finish function the same way as from JS, in the layout expected
+// by JS::CallArgsFromVp(): [callee, this, result]
+GJS_JSAPI_RETURN_CONVENTION
+static bool async_finish_call(JSContext* cx, Function* finish,
+                              GObject* source, GAsyncResult* res,
+                              JS::MutableHandleValue result) {
+    JS::RootedValueArray<3> vp(cx);
+
+    JSObject* res_wrapper =
+        ObjectInstance::wrapper_from_gobject(cx, G_OBJECT(res));
+    if (!res_wrapper)
+        return false;
+    vp[2].setObject(*res_wrapper);
+
+    if (finish->is_method) {
+        if (!source) {
+            GjsAutoChar name = format_function_name(finish);
+            gjs_throw(cx, "No source object to call %s on", name.get());
+            return false;
+        }
+        JSObject* source_wrapper =
+            ObjectInstance::wrapper_from_gobject(cx, source);
+        if (!source_wrapper)
+            return false;
+        vp[1].setObject(*source_wrapper);
+    }
+
+    JS::CallArgs args = JS::CallArgsFromVp(1, vp.begin());
+    if (!gjs_invoke_c_function(cx, finish, args))
+        return false;
+    result.set(args.rval());
+    return async_finish_result(cx, result);
+}
+
+// Appends the stack of the call that created a promise to the stack of an
+// error that it is rejected with, as the JS Gio._promisify() wrapper did
+GJS_JSAPI_RETURN_CONVENTION
+static bool add_promise_stack(JSContext* cx, JS::HandleObject error,
+                              JS::HandleObject saved_frame) {
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    JS::RootedString call_stack(cx);
+    if (!JS::BuildStackString(cx, nullptr, saved_frame, &call_stack))
+        return false;
+
+    JS::RootedValue stack_val(cx);
+    if (!JS_GetPropertyById(cx, error, atoms.stack(), &stack_val))
+        return false;
+
+    JS::RootedString stack(cx);
+    if (stack_val.isString()) {
+        JS::RootedString header(
+            cx, JS_NewStringCopyZ(cx, "### Promise created here: ###\n"));
+        if (!header)
+            return false;
+        JS::RootedString old_stack(cx, stack_val.toString());
+        stack = JS_ConcatStrings(cx, old_stack, header);
+        if (!stack)
+            return false;
+        stack = JS_ConcatStrings(cx, stack, call_stack);
+        if (!stack)
+            return false;
+    } else {
+        stack = call_stack;
+    }
+
+    stack_val.setString(stack);
+    return JS_SetPropertyById(cx, error, atoms.stack(), stack_val);
+}
+
+void gjs_async_promise_call_ready(GObject* source, GAsyncResult* res,
+                                  void* data) {
+    std::unique_ptr<GjsAsyncPromiseCall> call(
+        static_cast<GjsAsyncPromiseCall*>(data));
+    JSContext* cx = call->cx;
+    if (G_UNLIKELY(GjsContextPrivate::from_cx(cx)->destroying()))
+        return;
+
+    JSAutoRealm ar(cx, call->promise);
+
+    JS::RootedValue result(cx);
+    if (async_finish_call(cx, &call->finish->function, source, res, &result)) {
+        if (!JS::ResolvePromise(cx, call->promise, result))
+            gjs_log_exception(cx);
+        return;
+    }
+
+    JS::RootedValue exc(cx);
+    if (!JS_GetPendingException(cx, &exc))
+        return;  // uncatchable
+    JS_ClearPendingException(cx);
+    if (call->stack && exc.isObject()) {
+        JS::RootedObject exc_obj(cx, &exc.toObject());
+        if (!add_promise_stack(cx, exc_obj, call->stack))
+            gjs_log_exception(cx);
+    }
+    if (!JS::RejectPromise(cx, call->promise, exc))
+        gjs_log_exception(cx);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool ensure_function_initialized(JSContext* cx, Function* priv) {
+    if (G_LIKELY(!priv->lazy_info))
+        return true;
+
+    GjsAutoBaseInfo info = priv->lazy_info;
+    priv->lazy_info = nullptr;
+    if (!init_cached_function_data(cx, priv, priv->lazy_gtype, info)) {
+        // Throw the same exception again on the next call
+        uninit_cached_function_data(priv);
+        priv->lazy_info = info.release();
+        return false;
+    }
+    return true;
+}
+
+// Implementation of _gi.promisify(), see function.h
+bool gjs_function_promisify(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject async_obj(cx), finish_obj(cx);
+    if (!gjs_parse_call_args(cx, "promisify", args, "oo", "asyncFunc",
+                             &async_obj, "finishFunc", &finish_obj))
+        return false;
+
+    args.rval().setBoolean(false);
+
+    Function* function = priv_from_js(cx, async_obj);
+    Function* finish_function = priv_from_js(cx, finish_obj);
+    if (!function || !finish_function ||
+        !ensure_function_initialized(cx, function) ||
+        !ensure_function_initialized(cx, finish_function))
+        return !JS_IsExceptionPending(cx);
+
+    // It can only be called with the GAsyncResult
+    if (!function->has_async_ready_callback ||
+        finish_function->js_in_argc != 1)
+        return true;
+
+    if (!function->async_finish ||
+        !g_base_info_equal(function->async_finish->function.info,
+                           finish_function->info)) {
+        auto* finish = g_new0(GjsAsyncFinish, 1);
+        finish->ref_count = 1;
+        if (!init_cached_function_data(cx, &finish->function, 0,
+                                       finish_function->info)) {
+            async_finish_unref(finish);
+            return false;
+        }
+        if (function->async_finish)
+            async_finish_unref(function->async_finish);
+        function->async_finish = finish;
+    }
+    function->async_finish_looked_up = true;
+    function->promisified = true;
+
+    args.rval().setBoolean(true);
+    return true;
+}
+
+// The trivial path has no out arguments to store in @out_obj
+GJS_JSAPI_RETURN_CONVENTION
+static bool dispatch_function_call(JSContext* context, Function* priv,
+                                   const JS::CallArgs& args,
+                                   JS::HandleObject out_obj) {
+    if (G_UNLIKELY(priv->stats)) {
+        priv->stats->calls.fetch_add(1, std::memory_order_relaxed);
+        GjsAutoFunctionTimer timer(priv->stats, &GjsFunctionStats::total_ns);
+        if (priv->is_trivial && !out_obj)
+            return gjs_invoke_trivial_c_function(context, priv, args);
+        return gjs_invoke_c_function(context, priv, args, nullptr, nullptr,
+                                     out_obj);
+    }
+
+    if (priv->is_trivial && !out_obj)
+        return gjs_invoke_trivial_c_function(context, priv, args);
+
+    return gjs_invoke_c_function(context, priv, args, nullptr, nullptr,
+                                 out_obj);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool invoke_function(JSContext* context, Function* priv,
+                            const JS::CallArgs& args,
+                            JS::HandleObject out_obj = nullptr) {
+    if (!ensure_function_initialized(context, priv))
+        return false;
+
+    GjsAutoProfilerLabel label(context,
+                               priv->shared_arguments->profiler_label.c_str());
+
+    if (G_UNLIKELY(TRACE_ENABLED(GJS_FUNCTION_INVOKE_ENTRY) ||
+                   TRACE_ENABLED(GJS_FUNCTION_INVOKE_RETURN))) {
+        const char* ns = g_base_info_get_namespace(priv->info);
+        const char* name = g_base_info_get_name(priv->info);
+        TRACE(GJS_FUNCTION_INVOKE_ENTRY(ns, name));
+        bool ok = dispatch_function_call(context, priv, args, out_obj);
+        TRACE(GJS_FUNCTION_INVOKE_RETURN(ns, name, ok));
+        return ok;
+    }
+
+    return dispatch_function_call(context, priv, args, out_obj);
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 function_call(JSContext *context,
@@ -1045,40 +2203,60 @@ function_call(JSContext *context,
     if (priv == NULL)
         return true; /* we are the prototype, or have the wrong class */
 
-    return gjs_invoke_c_function(context, priv, js_argv);
+    return invoke_function(context, priv, js_argv);
 }
 
 GJS_NATIVE_CONSTRUCTOR_DEFINE_ABSTRACT(function)
 
+static void shared_arg_cache_free(GjsSharedArgumentCache* cache) {
+    if (cache->arguments) {
+        // Careful! cache->arguments is offset by one or two elements inside
+        // the allocated space, so we have to free index -1 or -2.
+        int start_index = cache->is_method ? -2 : -1;
+
+        for (int ix = start_index; ix < cache->n_args; ix++) {
+            // Not built, if construction failed halfway
+            if (!cache->arguments[ix].marshallers)
+                continue;
+
+            if (cache->arguments[ix].marshallers->free)
+                cache->arguments[ix].marshallers->free(&cache->arguments[ix]);
+        }
+
+        g_free(&cache->arguments[start_index]);
+        GJS_SUB_BYTES(arg_cache, (cache->n_args - start_index) *
+                                     (sizeof(GjsArgumentCache) +
+                                      sizeof(GjsArgumentCacheCold)));
+    }
+    g_free(cache->cold_arguments);
+    GJS_SUB_BYTES(arg_cache, sizeof(GjsSharedArgumentCache));
+
+    g_clear_pointer(&cache->info, g_base_info_unref);
+    delete cache;
+}
+
+static void shared_arg_cache_unref(GjsSharedArgumentCache* cache) {
+    {
+        std::lock_guard<std::mutex> hold(shared_arg_caches_lock);
+        if (--cache->refcount > 0)
+            return;
+        shared_arg_caches.erase(cache->key);
+    }
+    shared_arg_cache_free(cache);
+}
+
 /* Does not actually free storage for structure, just
  * reverses init_cached_function_data
  */
 static void
 uninit_cached_function_data (Function *function)
 {
-    if (function->arguments) {
-        g_assert(function->info &&
-                 "Don't know how to free cache without GI info");
-
-        // Careful! function->arguments is offset by one or two elements inside
-        // the allocated space, so we have to free index -1 or -2.
-        int start_index = g_callable_info_is_method(function->info) ? -2 : -1;
-        int gi_argc = MIN(g_callable_info_get_n_args(function->info),
-                          function->js_in_argc + function->js_out_argc);
-
-        for (int i = 0; i < gi_argc; i++) {
-            int ix = start_index + i;
-
-            if (!function->arguments[ix].marshallers)
-                break;
-
-            if (function->arguments[ix].marshallers->free)
-                function->arguments[ix].marshallers->free(
-                    &function->arguments[ix]);
-        }
-
-        g_free(&function->arguments[start_index]);
-        function->arguments = nullptr;
+    g_clear_pointer(&function->async_finish, async_finish_unref);
+    g_clear_pointer(&function->shared_arguments, shared_arg_cache_unref);
+    function->arguments = nullptr;
+    if (function->typecheck_memo) {
+        g_free(function->typecheck_memo - 2);
+        function->typecheck_memo = nullptr;
     }
 
     g_clear_pointer(&function->info, g_base_info_unref);
@@ -1095,6 +2273,7 @@ static void function_finalize(JSFreeOp*, JSObject* obj) {
         return; /* we are the prototype, not a real instance, so constructor never called */
 
     uninit_cached_function_data(priv);
+    g_clear_pointer(&priv->lazy_info, g_base_info_unref);
 
     GJS_DEC_COUNTER(function);
     g_slice_free(Function, priv);
@@ -1107,6 +2286,8 @@ get_num_arguments (JSContext *context,
                    JS::Value *vp)
 {
     GJS_GET_PRIV(context, argc, vp, rec, to, Function, priv);
+    if (!ensure_function_initialized(context, priv))
+        return false;
     rec.rval().setInt32(priv->js_in_argc);
     return true;
 }
@@ -1130,6 +2311,9 @@ function_to_string (JSContext *context,
         return true;
     }
 
+    if (!ensure_function_initialized(context, priv))
+        return false;
+
     n_args = g_callable_info_get_n_args(priv->info);
     n_jsargs = 0;
     arg_names_str = g_string_new("");
@@ -1162,6 +2346,46 @@ function_to_string (JSContext *context,
     return gjs_string_from_utf8(context, descr, rec.rval());
 }
 
+// callInto(out, this, ...args): calls the function like call() does, but
+// stores [return value, out arg 1, ...] into the elements of @out, sets its
+// length to the number of results and returns @out, rather than returning a
+// new array or a single value. Code that calls getters such as
+// get_preferred_size() every frame can reuse one array and avoid an
+// allocation per call.
+GJS_JSAPI_RETURN_CONVENTION
+static bool function_call_into(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, callee, Function, priv);
+    if (!priv) {
+        gjs_throw(cx, "callInto() must be called on an introspected function");
+        return false;
+    }
+
+    if (!args.requireAtLeast(cx, "callInto", 2))
+        return false;
+    if (!args[0].isObject()) {
+        gjs_throw(cx, "callInto(): first argument must be an object");
+        return false;
+    }
+    JS::RootedObject out_obj(cx, &args[0].toObject());
+
+    // In the layout expected by JS::CallArgsFromVp(): [callee, this, args...]
+    JS::RootedValueVector call_vp(cx);
+    if (!call_vp.resize(argc)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    call_vp[0].setObject(*callee);
+    for (unsigned ix = 1; ix < argc; ix++)
+        call_vp[ix].set(args[ix]);
+
+    JS::CallArgs call_args = JS::CallArgsFromVp(argc - 2, call_vp.begin());
+    if (!invoke_function(cx, priv, call_args, out_obj))
+        return false;
+
+    args.rval().setObject(*out_obj);
+    return true;
+}
+
 /* The bizarre thing about this vtable is that it applies to both
  * instances of the object, and to the prototype that instances of the
  * class have.
@@ -1191,11 +2415,159 @@ static JSPropertySpec gjs_function_proto_props[] = {
    given a GIRepository function as an argument */
 static JSFunctionSpec gjs_function_proto_funcs[] = {
     JS_FN("toString", function_to_string, 0, 0),
+    JS_FN("callInto", function_call_into, 2, 0),
     JS_FS_END
 };
 
 static JSFunctionSpec *gjs_function_static_funcs = nullptr;
 
+GJS_JSAPI_RETURN_CONVENTION
+static bool build_shared_arg_cache(JSContext* context,
+                                   GjsSharedArgumentCache* cache) {
+    GICallableInfo* info = cache->info;
+    bool is_method = cache->is_method;
+    uint8_t n_args = cache->n_args;
+
+    // arguments is one or two inside an array of n_args + 2, so
+    // arguments[-1] is the return value (which can be skipped if void)
+    // arguments[-2] is the instance parameter
+    size_t offset = is_method ? 2 : 1;
+    GjsArgumentCache* storage = g_new0(GjsArgumentCache, n_args + offset);
+    cache->cold_arguments = g_new0(GjsArgumentCacheCold, n_args + offset);
+    GJS_ADD_BYTES(arg_cache, (n_args + offset) * (sizeof(GjsArgumentCache) +
+                                                  sizeof(GjsArgumentCacheCold)));
+    for (size_t ix = 0; ix < n_args + offset; ix++)
+        storage[ix].cold = &cache->cold_arguments[ix];
+    GjsArgumentCache* arguments = storage + offset;
+
+    cache->arguments = arguments;
+    cache->js_in_argc = 0;
+    cache->js_out_argc = 0;
+
+    if (is_method &&
+        !gjs_arg_cache_build_instance(context, &arguments[-2], info))
+        return false;
+
+    bool inc_counter;
+    if (!gjs_arg_cache_build_return(context, &arguments[-1], arguments, info,
+                                    &inc_counter))
+        return false;
+
+    cache->js_out_argc = inc_counter ? 1 : 0;
+
+    for (uint8_t i = 0; i < n_args; i++) {
+        GIDirection direction;
+        GIArgInfo arg_info;
+
+        if (arguments[i].skip_in || arguments[i].skip_out)
+            continue;
+
+        g_callable_info_load_arg(info, i, &arg_info);
+        direction = g_arg_info_get_direction(&arg_info);
+
+        if (!gjs_arg_cache_build_arg(context, &arguments[i], arguments, i,
+                                     direction, &arg_info, info, &inc_counter))
+            return false;
+
+        if (inc_counter) {
+            switch (direction) {
+                case GI_DIRECTION_INOUT:
+                    cache->js_out_argc++;
+                    [[fallthrough]];
+                case GI_DIRECTION_IN:
+                    cache->js_in_argc++;
+                    break;
+                case GI_DIRECTION_OUT:
+                    cache->js_out_argc++;
+                    break;
+                default:
+                    g_assert_not_reached();
+            }
+        }
+    }
+
+    return true;
+}
+
+// Returns a new reference to the argument cache for @info, building it if no
+// other Function has done so yet.
+GJS_JSAPI_RETURN_CONVENTION
+static GjsSharedArgumentCache* get_shared_arg_cache(JSContext* context,
+                                                    GICallableInfo* info) {
+    GIBaseInfo* container = g_base_info_get_container(info);
+    GjsAutoChar key_str = g_strdup_printf(
+        "%s.%s.%s/%d", g_base_info_get_namespace(info),
+        container ? g_base_info_get_name(container) : "",
+        g_base_info_get_name(info), g_base_info_get_type(info));
+    std::string key(key_str.get());
+
+    {
+        std::lock_guard<std::mutex> hold(shared_arg_caches_lock);
+        auto it = shared_arg_caches.find(key);
+        if (it != shared_arg_caches.end()) {
+            it->second->refcount++;
+            return it->second;
+        }
+    }
+
+    int n_args = g_callable_info_get_n_args(info);
+    if (n_args > GjsArgumentCache::MAX_ARGS) {
+        gjs_throw(context, "Function %s.%s has too many arguments",
+                  g_base_info_get_namespace(info), g_base_info_get_name(info));
+        return nullptr;
+    }
+
+    auto* cache = new GjsSharedArgumentCache();
+    GJS_ADD_BYTES(arg_cache, sizeof(GjsSharedArgumentCache));
+    cache->refcount = 1;
+    cache->key = key;
+    cache->info = g_base_info_ref(info);
+    if (container)
+        cache->profiler_label = std::string(g_base_info_get_namespace(info)) +
+                                "." + g_base_info_get_name(container) + "." +
+                                g_base_info_get_name(info);
+    else
+        cache->profiler_label = std::string(g_base_info_get_namespace(info)) +
+                                "." + g_base_info_get_name(info);
+    cache->n_args = n_args;
+    cache->is_method = g_callable_info_is_method(info);
+
+    if (!build_shared_arg_cache(context, cache)) {
+        shared_arg_cache_free(cache);
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> hold(shared_arg_caches_lock);
+    auto [it, inserted] = shared_arg_caches.emplace(key, cache);
+    if (!inserted) {
+        // Someone else built the same cache in the meantime
+        it->second->refcount++;
+        shared_arg_cache_free(cache);
+    }
+    return it->second;
+}
+
+[[nodiscard]] static bool is_trivially_marshallable(Function* function,
+                                                    uint8_t n_args) {
+    if (function->invoker.cif.nargs > GJS_TRIVIAL_MAX_ARGS ||
+        g_callable_info_can_throw_gerror(function->info))
+        return false;
+
+    if (function->is_method &&
+        !gjs_arg_cache_is_trivial_in(&function->arguments[-2]))
+        return false;
+
+    if (!gjs_arg_cache_is_trivial_return(&function->arguments[-1]))
+        return false;
+
+    for (uint8_t i = 0; i < n_args; i++) {
+        if (!gjs_arg_cache_is_trivial_in(&function->arguments[i]))
+            return false;
+    }
+
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 init_cached_function_data (JSContext      *context,
@@ -1203,7 +2575,6 @@ init_cached_function_data (JSContext      *context,
                            GType           gtype,
                            GICallableInfo *info)
 {
-    guint8 i, n_args;
     GError *error = NULL;
     GIInfoType info_type;
 
@@ -1236,61 +2607,43 @@ init_cached_function_data (JSContext      *context,
         }
     }
 
-    bool is_method = g_callable_info_is_method(info);
-    n_args = g_callable_info_get_n_args((GICallableInfo*) info);
-
-    // arguments is one or two inside an array of n_args + 2, so
-    // arguments[-1] is the return value (which can be skipped if void)
-    // arguments[-2] is the instance parameter
-    size_t offset = is_method ? 2 : 1;
-    GjsArgumentCache* arguments =
-        g_new0(GjsArgumentCache, n_args + offset) + offset;
-
-    function->arguments = arguments;
     function->info = g_base_info_ref(info);
-    function->js_in_argc = 0;
-    function->js_out_argc = 0;
 
-    if (is_method &&
-        !gjs_arg_cache_build_instance(context, &arguments[-2], info))
+    GjsSharedArgumentCache* cache = get_shared_arg_cache(context, info);
+    if (!cache)
         return false;
 
-    bool inc_counter;
-    if (!gjs_arg_cache_build_return(context, &arguments[-1], arguments, info,
-                                    &inc_counter))
-        return false;
-
-    function->js_out_argc = inc_counter ? 1 : 0;
-
-    for (i = 0; i < n_args; i++) {
-        GIDirection direction;
-        GIArgInfo arg_info;
-
-        if (arguments[i].skip_in || arguments[i].skip_out)
+    function->shared_arguments = cache;
+    function->arguments = cache->arguments;
+    function->typecheck_memo = g_new0(GType, cache->n_args + 2) + 2;
+    function->js_in_argc = cache->js_in_argc;
+    function->js_out_argc = cache->js_out_argc;
+    function->is_method = cache->is_method;
+
+    // The callback must be the last argument taken from JS for it to be left
+    // out of the call
+    for (int ix = cache->n_args - 1; ix >= 0; ix--) {
+        if (function->arguments[ix].skip_in)
             continue;
+        function->has_async_ready_callback =
+            gjs_arg_cache_is_async_ready_callback(&function->arguments[ix]);
+        break;
+    }
 
-        g_callable_info_load_arg((GICallableInfo*) info, i, &arg_info);
-        direction = g_arg_info_get_direction(&arg_info);
-
-        if (!gjs_arg_cache_build_arg(context, &arguments[i], arguments, i,
-                                     direction, &arg_info, info, &inc_counter))
-            return false;
-
-        if (inc_counter) {
-            switch (direction) {
-                case GI_DIRECTION_INOUT:
-                    function->js_out_argc++;
-                    [[fallthrough]];
-                case GI_DIRECTION_IN:
-                    function->js_in_argc++;
-                    break;
-                case GI_DIRECTION_OUT:
-                    function->js_out_argc++;
-                    break;
-                default:
-                    g_assert_not_reached();
-            }
+    function->is_trivial = is_trivially_marshallable(function, cache->n_args);
+    if (function->is_trivial)
+        function->direct_thunk = find_direct_thunk(function, cache->n_args);
+
+    if (G_UNLIKELY(function_stats_enabled())) {
+        std::lock_guard<std::mutex> hold(function_stats_lock);
+        GjsFunctionStats& stats = function_stats[cache->key];
+        if (stats.name.empty()) {
+            GjsAutoChar name = format_function_name(function);
+            stats.name = name.get();
+            if (info_type == GI_INFO_TYPE_VFUNC)
+                stats.name += " (vfunc)";
         }
+        function->stats = &stats;
     }
 
     return true;
@@ -1307,7 +2660,8 @@ GJS_JSAPI_RETURN_CONVENTION
 static JSObject*
 function_new(JSContext      *context,
              GType           gtype,
-             GICallableInfo *info)
+             GICallableInfo *info,
+             bool            lazy)
 {
     Function *priv;
 
@@ -1333,6 +2687,12 @@ function_new(JSContext      *context,
                         "function constructor, obj %p priv %p", function.get(),
                         priv);
 
+    if (lazy) {
+        priv->lazy_info = g_base_info_ref(info);
+        priv->lazy_gtype = gtype;
+        return function;
+    }
+
     if (!init_cached_function_data(context, priv, gtype, (GICallableInfo *)info))
       return NULL;
 
@@ -1340,19 +2700,17 @@ function_new(JSContext      *context,
 }
 
 GJS_JSAPI_RETURN_CONVENTION
-JSObject*
-gjs_define_function(JSContext       *context,
-                    JS::HandleObject in_object,
-                    GType            gtype,
-                    GICallableInfo  *info)
-{
+static JSObject* define_function(JSContext* context, JS::HandleObject in_object,
+                                 GType gtype, GICallableInfo* info,
+                                 bool lazy) {
     GIInfoType info_type;
     gchar *name;
     bool free_name;
 
     info_type = g_base_info_get_type((GIBaseInfo *)info);
 
-    JS::RootedObject function(context, function_new(context, gtype, info));
+    JS::RootedObject function(context,
+                              function_new(context, gtype, info, lazy));
     if (!function)
         return NULL;
 
@@ -1378,6 +2736,21 @@ gjs_define_function(JSContext       *context,
     return function;
 }
 
+GJS_JSAPI_RETURN_CONVENTION
+JSObject*
+gjs_define_function(JSContext       *context,
+                    JS::HandleObject in_object,
+                    GType            gtype,
+                    GICallableInfo  *info)
+{
+    return define_function(context, in_object, gtype, info, false);
+}
+
+JSObject* gjs_define_lazy_function(JSContext* cx, JS::HandleObject in_object,
+                                   GType gtype, GICallableInfo* info) {
+    return define_function(cx, in_object, gtype, info, true);
+}
+
 bool gjs_invoke_constructor_from_c(JSContext* context, GIFunctionInfo* info,
                                    JS::HandleObject obj,
                                    const JS::CallArgs& args,
@@ -1392,3 +2765,155 @@ bool gjs_invoke_constructor_from_c(JSContext* context, GIFunctionInfo* info,
     uninit_cached_function_data(&function);
     return result;
 }
+
+bool gjs_function_stats_dump(FILE* fp) {
+    if (!function_stats_enabled())
+        return false;
+
+    // A snapshot, since other threads may still be adding to the counters
+    struct Row {
+        const char* name;
+        uint64_t calls;
+        int64_t total_ns;
+        int64_t native_ns;
+    };
+    std::lock_guard<std::mutex> hold(function_stats_lock);
+    std::vector<Row> sorted;
+    sorted.reserve(function_stats.size());
+    for (const auto& it : function_stats) {
+        const GjsFunctionStats& stats = it.second;
+        uint64_t calls = stats.calls.load(std::memory_order_relaxed);
+        if (calls > 0)
+            sorted.push_back({stats.name.c_str(), calls,
+                              stats.total_ns.load(std::memory_order_relaxed),
+                              stats.native_ns.load(std::memory_order_relaxed)});
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Row& a, const Row& b) {
+        return a.total_ns > b.total_ns;
+    });
+
+    fprintf(fp, "%12s %12s %12s %12s  %s\n", "calls", "total ms", "native ms",
+            "marshal ms", "function");
+    for (const Row& row : sorted) {
+        fprintf(fp, "%12" G_GUINT64_FORMAT " %12.3f %12.3f %12.3f  %s\n",
+                row.calls, row.total_ns / 1e6, row.native_ns / 1e6,
+                (row.total_ns - row.native_ns) / 1e6, row.name);
+    }
+    return true;
+}
+
+bool gjs_function_batch(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject calls(cx);
+    if (!gjs_parse_call_args(cx, "batch", args, "o", "calls", &calls))
+        return false;
+
+    uint32_t n_calls;
+    bool is_array;
+    if (!JS::IsArrayObject(cx, calls, &is_array))
+        return false;
+    if (!is_array) {
+        gjs_throw(cx, "batch() expects an array of calls");
+        return false;
+    }
+    if (!JS::GetArrayLength(cx, calls, &n_calls))
+        return false;
+
+    JS::RootedValueVector results(cx);
+    JS::RootedValueVector errors(cx);
+    if (!results.resize(n_calls) || !errors.resize(n_calls)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+
+    // Storage for each call, in the layout expected by JS::CallArgsFromVp():
+    // [callee, this, args...]
+    JS::RootedValueVector call_vp(cx);
+    JS::RootedValue entry_value(cx);
+    JS::RootedObject entry(cx), callee(cx);
+    unsigned n_failed = 0;
+
+    for (uint32_t ix = 0; ix < n_calls; ix++) {
+        if (!JS_GetElement(cx, calls, ix, &entry_value))
+            return false;
+
+        uint32_t entry_length = 0;
+        if (entry_value.isObject()) {
+            entry = &entry_value.toObject();
+            if (!JS::IsArrayObject(cx, entry, &is_array))
+                return false;
+            if (is_array && !JS::GetArrayLength(cx, entry, &entry_length))
+                return false;
+        }
+        if (entry_length < 2) {
+            gjs_throw(cx,
+                      "Batched call %u must be an array [function, this, "
+                      "...args]",
+                      ix);
+            return false;
+        }
+
+        if (!call_vp.resize(entry_length)) {
+            JS_ReportOutOfMemory(cx);
+            return false;
+        }
+        for (uint32_t arg_ix = 0; arg_ix < entry_length; arg_ix++) {
+            if (!JS_GetElement(cx, entry, arg_ix, call_vp[arg_ix]))
+                return false;
+        }
+
+        Function* priv = nullptr;
+        if (call_vp[0].isObject()) {
+            callee = &call_vp[0].toObject();
+            priv = static_cast<Function*>(
+                JS_GetInstancePrivate(cx, callee, &gjs_function_class, nullptr));
+        }
+        if (!priv) {
+            gjs_throw(cx, "Batched call %u is not to an introspected function",
+                      ix);
+            return false;
+        }
+
+        JS::CallArgs call_args =
+            JS::CallArgsFromVp(entry_length - 2, call_vp.begin());
+        if (invoke_function(cx, priv, call_args)) {
+            results[ix].set(call_args.rval());
+            continue;
+        }
+
+        // Collect the exception and carry on with the rest of the batch
+        if (!JS_GetPendingException(cx, errors[ix]))
+            return false;  // uncatchable
+        JS_ClearPendingException(cx);
+        n_failed++;
+    }
+
+    JS::RootedObject results_array(cx, JS::NewArrayObject(cx, results));
+    if (!results_array)
+        return false;
+
+    if (n_failed == 0) {
+        args.rval().setObject(*results_array);
+        return true;
+    }
+
+    JS::RootedObject errors_array(cx, JS::NewArrayObject(cx, errors));
+    if (!errors_array)
+        return false;
+
+    gjs_throw(cx, "%u of %u batched calls failed", n_failed, n_calls);
+    JS::RootedValue exc(cx);
+    if (!JS_GetPendingException(cx, &exc))
+        return false;
+    JS_ClearPendingException(cx);
+
+    JS::RootedObject exc_obj(cx, &exc.toObject());
+    if (!JS_DefineProperty(cx, exc_obj, "errors", errors_array,
+                           JSPROP_ENUMERATE) ||
+        !JS_DefineProperty(cx, exc_obj, "results", results_array,
+                           JSPROP_ENUMERATE))
+        return false;
+
+    JS_SetPendingException(cx, exc);
+    return false;
+}
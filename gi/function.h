@@ -26,18 +26,26 @@
 
 #include <config.h>
 
+#include <stdint.h>
+#include <stdio.h>  // for FILE
+
+#include <atomic>
+
 #include <ffi.h>
+#include <gio/gio.h>  // for GAsyncResult
 #include <girepository.h>
 #include <glib-object.h>
 
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 
+#include "cjs/arena.h"
 #include "cjs/macros.h"
 
 namespace JS {
 class CallArgs;
 }
+struct GjsAsyncPromiseCall;
 
 typedef enum {
     PARAM_NORMAL,
@@ -47,8 +55,32 @@ typedef enum {
     PARAM_UNKNOWN,
 } GjsParamType;
 
+// How an argument of a callback invoked on another thread is kept alive when
+// the callback is queued to run on its context's thread without the caller
+// waiting for it
+enum GjsCallbackArgCopy : uint8_t {
+    COPY_VALUE,   // passed by value
+    COPY_OBJECT,  // a GObject, referenced until the callback has run
+    COPY_STRING,  // a string, duplicated
+};
+
+// How one argument of a callback is marshalled when the callback is invoked.
+// The infos are stack infos loaded from the trampoline's callable info, which
+// the trampoline keeps alive.
+struct GjsCallbackParam {
+    GIArgInfo arg_info;
+    GITypeInfo type_info;
+    GjsParamType param_type;
+    GIDirection direction;
+    int array_length_pos;  // only for PARAM_ARRAY
+    GjsCallbackArgCopy copy;  // only if the trampoline can_queue_async
+    bool to_js : 1;        // converted and passed to the JS function
+};
+
 struct GjsCallbackTrampoline {
-    int ref_count;
+    // Atomic, since calls queued from other threads hold a reference; it is
+    // still only released to zero on the context's thread
+    std::atomic_int ref_count;
     GICallableInfo *info;
 
     GClosure *js_function;
@@ -57,7 +89,21 @@ struct GjsCallbackTrampoline {
     ffi_closure *closure;
     GIScopeType scope;
     bool is_vfunc;
-    GjsParamType *param_types;
+
+    // Marshalling plan, worked out once in gjs_callback_trampoline_new() so
+    // that invoking the callback doesn't have to look at the typelib
+    GjsCallbackParam* params;
+    GITypeInfo ret_type;
+    GITransfer ret_transfer;
+    int n_args;
+    int n_jsargs;
+    int n_outargs;
+    bool can_throw_gerror : 1;
+    bool ret_type_is_void : 1;
+    // Whether invocations from other threads can be queued without the caller
+    // waiting for them, because nothing is returned and the arguments can be
+    // copied
+    bool can_queue_async : 1;
 };
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -67,6 +113,9 @@ GjsCallbackTrampoline* gjs_callback_trampoline_new(
 
 void gjs_callback_trampoline_unref(GjsCallbackTrampoline *trampoline);
 void gjs_callback_trampoline_ref(GjsCallbackTrampoline *trampoline);
+// For the GDestroyNotify of a notified callback, which may be called on
+// another thread
+void gjs_callback_trampoline_destroy_notify(GjsCallbackTrampoline* trampoline);
 
 // Stack allocation only!
 struct GjsFunctionCallState {
@@ -74,18 +123,59 @@ struct GjsFunctionCallState {
     GIArgument* out_cvalues;
     GIArgument* inout_original_cvalues;
     JS::RootedObject instance_object;
+    // Set if the function was called without its GAsyncReadyCallback, to
+    // return a promise instead
+    GjsAsyncPromiseCall* async_call;
+    // The last GType that passed the typecheck of each GObject or fundamental
+    // in argument of the function, indexed like in_cvalues; may be null
+    GType* typecheck_memo;
     bool call_completed;
+    // Marshallers may allocate temporaries here which don't need to outlive
+    // the call; they are released when the state goes out of scope
+    GjsAutoArenaScope arena;
 
-    explicit GjsFunctionCallState(JSContext* cx)
-        : instance_object(cx), call_completed(false) {}
+    explicit GjsFunctionCallState(JSContext* cx);
 };
 
+// GAsyncReadyCallback passed, with a GjsAsyncPromiseCall as user data, to async
+// functions called without a callback. Calls the matching _finish function and
+// settles the promise with its result.
+void gjs_async_promise_call_ready(GObject* source, GAsyncResult* res,
+                                  void* data);
+
 GJS_JSAPI_RETURN_CONVENTION
 JSObject *gjs_define_function(JSContext       *context,
                               JS::HandleObject in_object,
                               GType            gtype,
                               GICallableInfo  *info);
 
+// Like gjs_define_function(), but the function is only set up for calling
+// when it is first used, for the many static methods that classes define
+// whether or not they are ever called
+GJS_JSAPI_RETURN_CONVENTION
+JSObject* gjs_define_lazy_function(JSContext* cx, JS::HandleObject in_object,
+                                   GType gtype, GICallableInfo* info);
+
+// Implementation of imports.gi.batch(): takes an array of calls of the form
+// [function, this, ...args] and invokes them all in one transition from JS.
+// Returns an array of the return values; if any calls throw, the rest still
+// run, and an error is thrown afterwards with the per-call exceptions in its
+// "errors" property and the return values in its "results" property.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_function_batch(JSContext* cx, unsigned argc, JS::Value* vp);
+
+// Implementation of _gi.promisify(asyncFunc, finishFunc), for Gio._promisify():
+// if both are introspected functions and @asyncFunc takes a
+// GAsyncReadyCallback, calls of @asyncFunc without a callback then return a
+// promise settled through @finishFunc, and rejections get the stack of the
+// call appended. Returns whether @asyncFunc could be set up like this.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_function_promisify(JSContext* cx, unsigned argc, JS::Value* vp);
+
+// Prints call counts and timings of introspected functions, sorted by total
+// time. Returns false if GJS_PROFILE_FUNCTIONS is not set.
+bool gjs_function_stats_dump(FILE* fp);
+
 GJS_JSAPI_RETURN_CONVENTION
 bool gjs_invoke_constructor_from_c(JSContext* cx, GIFunctionInfo* info,
                                    JS::HandleObject this_obj,
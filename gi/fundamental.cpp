@@ -24,11 +24,15 @@
 
 #include <config.h>
 
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uintptr_t
+
 #include <girepository.h>
 #include <glib.h>
 
 #include <js/AllocPolicy.h>  // for SystemAllocPolicy
 #include <js/Class.h>
+#include <js/GCAPI.h>  // for JS_UpdateWeakPointerAfterGC
 #include <js/GCHashTable.h>  // for WeakCache
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
@@ -56,6 +60,13 @@ FundamentalInstance::FundamentalInstance(JSContext* cx, JS::HandleObject obj)
     GJS_INC_COUNTER(fundamental_instance);
 }
 
+[[nodiscard]] static GjsRecentFundamental& recent_fundamental_slot(
+    GjsContextPrivate* gjs, const void* gfundamental) {
+    auto addr = reinterpret_cast<uintptr_t>(gfundamental);
+    size_t n_slots = GjsContextPrivate::n_recent_fundamentals();
+    return gjs->recent_fundamentals()[((addr >> 4) ^ (addr >> 10)) % n_slots];
+}
+
 /*
  * FundamentalInstance::associate_js_instance:
  *
@@ -73,6 +84,10 @@ bool FundamentalInstance::associate_js_instance(JSContext* cx, JSObject* object,
         return false;
     }
 
+    GjsRecentFundamental& recent = recent_fundamental_slot(gjs, gfundamental);
+    recent.ptr = gfundamental;
+    recent.wrapper = object;
+
     debug_lifecycle(object, "associated JSObject with fundamental");
 
     ref();
@@ -330,21 +345,64 @@ gjs_lookup_fundamental_prototype(JSContext    *context,
     return prototype;
 }
 
+// The prototype found for each GType is cached, so that wrapping an instance
+// of a subtype without introspection info doesn't walk up the type hierarchy
+// and look the constructor up in its namespace every time.
 GJS_JSAPI_RETURN_CONVENTION
 static JSObject*
 gjs_lookup_fundamental_prototype_from_gtype(JSContext *context,
                                             GType      gtype)
 {
+    GTypeTable& protos =
+        GjsContextPrivate::from_cx(context)->fundamental_proto_table();
+    auto it = protos.find(gtype);
+    if (it != protos.end())
+        return it->second;
+
     GjsAutoObjectInfo info;
+    GType info_gtype = gtype;
 
     /* A given gtype might not have any definition in the introspection
      * data. If that's the case, try to look for a definition of any of the
      * parent type. */
-    while (gtype != G_TYPE_INVALID &&
-           !(info = g_irepository_find_by_gtype(nullptr, gtype)))
-        gtype = g_type_parent(gtype);
+    while (info_gtype != G_TYPE_INVALID &&
+           !(info = g_irepository_find_by_gtype(nullptr, info_gtype)))
+        info_gtype = g_type_parent(info_gtype);
+
+    JSObject* proto =
+        gjs_lookup_fundamental_prototype(context, info, info_gtype);
+    if (proto)
+        protos.emplace(gtype, proto);
+    return proto;
+}
 
-    return gjs_lookup_fundamental_prototype(context, info, gtype);
+void gjs_fundamental_update_caches_after_gc(GjsContextPrivate* gjs) {
+    GjsRecentFundamental* recent = gjs->recent_fundamentals();
+    for (size_t ix = 0; ix < GjsContextPrivate::n_recent_fundamentals(); ix++) {
+        if (!recent[ix].ptr)
+            continue;
+        JS_UpdateWeakPointerAfterGC(&recent[ix].wrapper);
+        if (!recent[ix].wrapper.unbarrieredGet())
+            recent[ix].ptr = nullptr;
+    }
+
+    GTypeTable& protos = gjs->fundamental_proto_table();
+    for (auto it = protos.begin(); it != protos.end();) {
+        JS_UpdateWeakPointerAfterGC(&it->second);
+        if (it->second.unbarrieredGet())
+            ++it;
+        else
+            it = protos.erase(it);
+    }
+}
+
+void gjs_fundamental_release_caches(GjsContextPrivate* gjs) {
+    GjsRecentFundamental* recent = gjs->recent_fundamentals();
+    for (size_t ix = 0; ix < GjsContextPrivate::n_recent_fundamentals(); ix++) {
+        recent[ix].ptr = nullptr;
+        recent[ix].wrapper = nullptr;
+    }
+    gjs->fundamental_proto_table().clear();
 }
 
 // Overrides GIWrapperPrototype::get_parent_proto().
@@ -414,10 +472,19 @@ JSObject* FundamentalInstance::object_for_c_ptr(JSContext* context,
         return nullptr;
     }
 
+    // Fundamentals that were wrapped recently are found without hashing; the
+    // table is the fallback
     GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
+    GjsRecentFundamental& recent = recent_fundamental_slot(gjs, gfundamental);
+    if (recent.ptr == gfundamental)
+        return recent.wrapper;
+
     auto p = gjs->fundamental_table().lookup(gfundamental);
-    if (p)
+    if (p) {
+        recent.ptr = gfundamental;
+        recent.wrapper = p->value();
         return p->value();
+    }
 
     gjs_debug_marshal(GJS_DEBUG_GFUNDAMENTAL,
                       "Wrapping fundamental %p with JSObject", gfundamental);
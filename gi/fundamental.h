@@ -38,6 +38,7 @@
 
 class FundamentalPrototype;
 class FundamentalInstance;
+class GjsContextPrivate;
 namespace JS { class CallArgs; }
 
 /* To conserve memory, we have two different kinds of private data for JS
@@ -182,4 +183,7 @@ class FundamentalInstance
     static void* copy_ptr(JSContext* cx, GType gtype, void* gfundamental);
 };
 
+void gjs_fundamental_update_caches_after_gc(GjsContextPrivate* gjs);
+void gjs_fundamental_release_caches(GjsContextPrivate* gjs);
+
 #endif  // GI_FUNDAMENTAL_H_
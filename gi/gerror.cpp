@@ -25,6 +25,8 @@
 
 #include <stdint.h>
 
+#include <unordered_map>
+
 #include <girepository.h>
 #include <glib-object.h>
 
@@ -33,6 +35,7 @@
 #include <js/PropertyDescriptor.h>  // for JSPROP_ENUMERATE
 #include <js/RootingAPI.h>
 #include <js/SavedFrameAPI.h>
+#include <js/TracingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
 #include <js/Value.h>
@@ -70,6 +73,10 @@ ErrorInstance::~ErrorInstance(void) {
     GJS_DEC_COUNTER(gerror_instance);
 }
 
+void ErrorInstance::trace_impl(JSTracer* trc) {
+    JS::TraceEdge(trc, &m_frame, "GError::frame");
+}
+
 /*
  * ErrorBase::domain:
  *
@@ -136,6 +143,49 @@ bool ErrorBase::get_code(JSContext* cx, unsigned argc, JS::Value* vp) {
     return true;
 }
 
+GJS_JSAPI_RETURN_CONVENTION
+static bool define_frame_properties(JSContext* cx, JS::HandleObject obj,
+                                    JS::HandleObject frame,
+                                    bool keep_existing);
+
+/*
+ * ErrorBase::get_frame_property:
+ *
+ * JSNative property getter for `stack`, `fileName`, `lineNumber`, and
+ * `columnNumber`. On first access, all four are computed from the saved frame
+ * and defined as own properties of the instance, shadowing this accessor.
+ */
+template <GjsAtom GjsAtoms::*member>
+bool ErrorBase::get_frame_property(JSContext* cx, unsigned argc,
+                                   JS::Value* vp) {
+    GJS_GET_THIS(cx, argc, vp, args, obj);
+    ErrorBase* priv = ErrorBase::for_js(cx, obj);
+    if (!priv || priv->is_prototype() || !priv->to_instance()->frame()) {
+        args.rval().setUndefined();
+        return true;
+    }
+
+    JS::RootedObject frame(cx, priv->to_instance()->frame());
+    priv->to_instance()->set_frame(nullptr);
+    if (!define_frame_properties(cx, obj, frame, /* keep_existing = */ true))
+        return false;
+
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    return JS_GetPropertyById(cx, obj, (atoms.*member)(), args.rval());
+}
+
+// JSNative property setter for the properties above; assigning to one of them
+// defines it as an own property, as it would have been before it was lazy.
+template <GjsAtom GjsAtoms::*member>
+bool ErrorBase::set_frame_property(JSContext* cx, unsigned argc,
+                                   JS::Value* vp) {
+    GJS_GET_THIS(cx, argc, vp, args, obj);
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    args.rval().setUndefined();
+    return JS_DefinePropertyById(cx, obj, (atoms.*member)(), args.get(0),
+                                 JSPROP_ENUMERATE);
+}
+
 // JSNative implementation of `toString()`.
 bool ErrorBase::to_string(JSContext* context, unsigned argc, JS::Value* vp) {
     GJS_GET_THIS(context, argc, vp, rec, self);
@@ -205,6 +255,10 @@ const struct JSClassOps ErrorBase::class_ops = {
     nullptr,  // resolve
     nullptr,  // mayResolve
     &ErrorBase::finalize,
+    nullptr,  // call
+    nullptr,  // hasInstance
+    nullptr,  // construct
+    &ErrorBase::trace
 };
 
 const struct JSClass ErrorBase::klass = {
@@ -219,6 +273,20 @@ JSPropertySpec ErrorBase::proto_properties[] = {
     JS_PSG("domain", &ErrorBase::get_domain, GJS_MODULE_PROP_FLAGS),
     JS_PSG("code", &ErrorBase::get_code, GJS_MODULE_PROP_FLAGS),
     JS_PSG("message", &ErrorBase::get_message, GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("stack", &ErrorBase::get_frame_property<&GjsAtoms::stack>,
+            &ErrorBase::set_frame_property<&GjsAtoms::stack>,
+            GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("fileName", &ErrorBase::get_frame_property<&GjsAtoms::file_name>,
+            &ErrorBase::set_frame_property<&GjsAtoms::file_name>,
+            GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("lineNumber",
+            &ErrorBase::get_frame_property<&GjsAtoms::line_number>,
+            &ErrorBase::set_frame_property<&GjsAtoms::line_number>,
+            GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("columnNumber",
+            &ErrorBase::get_frame_property<&GjsAtoms::column_number>,
+            &ErrorBase::set_frame_property<&GjsAtoms::column_number>,
+            GJS_MODULE_PROP_FLAGS),
     JS_PS_END
 };
 
@@ -257,7 +325,7 @@ bool ErrorPrototype::define_class(JSContext* context,
            gjs_define_enum_values(context, constructor, info);
 }
 
-[[nodiscard]] static GIEnumInfo* find_error_domain_info(GQuark domain) {
+[[nodiscard]] static GIEnumInfo* lookup_error_domain_info(GQuark domain) {
     GIEnumInfo *info;
 
     /* first an attempt without loading extra libraries */
@@ -285,18 +353,32 @@ bool ErrorPrototype::define_class(JSContext* context,
     return info;
 }
 
-/* define properties that JS Error() expose, such as
-   fileName, lineNumber and stack
-*/
-GJS_JSAPI_RETURN_CONVENTION
-bool gjs_define_error_properties(JSContext* cx, JS::HandleObject obj) {
-    JS::RootedObject frame(cx);
+/* Returns a borrowed reference. The repository is process-wide and never
+ * unloads typelibs, so a domain, once found, always maps to the same info;
+ * throwing the same kind of error repeatedly then skips the repository
+ * search. Misses are not cached, since loading another namespace later may
+ * provide the domain. */
+[[nodiscard]] static GIEnumInfo* find_error_domain_info(GQuark domain) {
+    static std::unordered_map<GQuark, GIEnumInfo*> domain_infos;
+
+    auto it = domain_infos.find(domain);
+    if (it != domain_infos.end())
+        return it->second;
+
+    GIEnumInfo* info = lookup_error_domain_info(domain);
+    if (info)
+        domain_infos.emplace(domain, info);
+    return info;
+}
+
+static bool define_frame_properties(JSContext* cx, JS::HandleObject obj,
+                                    JS::HandleObject frame,
+                                    bool keep_existing) {
     JS::RootedString stack(cx);
     JS::RootedString source(cx);
     uint32_t line, column;
 
-    if (!JS::CaptureCurrentStack(cx, &frame) ||
-        !JS::BuildStackString(cx, nullptr, frame, &stack))
+    if (!JS::BuildStackString(cx, nullptr, frame, &stack))
         return false;
 
     auto ok = JS::SavedFrameResult::Ok;
@@ -308,14 +390,51 @@ bool gjs_define_error_properties(JSContext* cx, JS::HandleObject obj) {
     }
 
     const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
-    return JS_DefinePropertyById(cx, obj, atoms.stack(), stack,
-                                 JSPROP_ENUMERATE) &&
-           JS_DefinePropertyById(cx, obj, atoms.file_name(), source,
-                                 JSPROP_ENUMERATE) &&
-           JS_DefinePropertyById(cx, obj, atoms.line_number(), line,
-                                 JSPROP_ENUMERATE) &&
-           JS_DefinePropertyById(cx, obj, atoms.column_number(), column,
-                                 JSPROP_ENUMERATE);
+    JS::RootedValueArray<4> values(cx);
+    values[0].setString(stack);
+    values[1].setString(source);
+    values[2].setNumber(line);
+    values[3].setNumber(column);
+    JS::HandleId ids[] = {atoms.stack(), atoms.file_name(),
+                          atoms.line_number(), atoms.column_number()};
+
+    for (size_t ix = 0; ix < G_N_ELEMENTS(ids); ix++) {
+        // Don't clobber a value that was assigned before the lazy properties
+        // were resolved
+        if (keep_existing) {
+            bool has_own;
+            if (!JS_AlreadyHasOwnPropertyById(cx, obj, ids[ix], &has_own))
+                return false;
+            if (has_own)
+                continue;
+        }
+        if (!JS_DefinePropertyById(cx, obj, ids[ix], values[ix],
+                                   JSPROP_ENUMERATE))
+            return false;
+    }
+    return true;
+}
+
+/* define properties that JS Error() expose, such as
+   fileName, lineNumber and stack
+*/
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_define_error_properties(JSContext* cx, JS::HandleObject obj) {
+    JS::RootedObject frame(cx);
+    if (!JS::CaptureCurrentStack(cx, &frame))
+        return false;
+
+    // Wrappers of errors with domain metadata only keep the frame; the
+    // accessors on ErrorBase::proto_properties turn it into strings if the
+    // properties are ever read. Building the stack string is by far the most
+    // expensive part of throwing a GError.
+    ErrorBase* priv = ErrorBase::for_js(cx, obj);
+    if (priv && !priv->is_prototype()) {
+        priv->to_instance()->set_frame(frame);
+        return true;
+    }
+
+    return define_frame_properties(cx, obj, frame, /* keep_existing = */ false);
 }
 
 [[nodiscard]] static JSProtoKey proto_key_from_error_enum(int val) {
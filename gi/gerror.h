@@ -31,9 +31,11 @@
 #include <glib.h>
 
 #include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 
 #include "gi/wrapperutils.h"
+#include "cjs/atoms.h"
 #include "cjs/macros.h"
 #include "util/log.h"
 
@@ -88,6 +90,14 @@ class ErrorBase
     static bool get_message(JSContext* cx, unsigned argc, JS::Value* vp);
     GJS_JSAPI_RETURN_CONVENTION
     static bool get_code(JSContext* cx, unsigned argc, JS::Value* vp);
+    template <GjsAtom GjsAtoms::*member>
+    GJS_JSAPI_RETURN_CONVENTION static bool get_frame_property(JSContext* cx,
+                                                               unsigned argc,
+                                                               JS::Value* vp);
+    template <GjsAtom GjsAtoms::*member>
+    GJS_JSAPI_RETURN_CONVENTION static bool set_frame_property(JSContext* cx,
+                                                               unsigned argc,
+                                                               JS::Value* vp);
 
     // JS methods
 
@@ -145,9 +155,17 @@ class ErrorInstance : public GIWrapperInstance<ErrorBase, ErrorPrototype,
                                    GError>;
     friend class GIWrapperBase<ErrorBase, ErrorPrototype, ErrorInstance>;
 
+    // The SavedFrame captured when the error was created or thrown. The stack,
+    // fileName, lineNumber, and columnNumber properties are only computed
+    // from it if someone asks for them, which most code catching a GError
+    // never does.
+    JS::Heap<JSObject*> m_frame;
+
     explicit ErrorInstance(JSContext* cx, JS::HandleObject obj);
     ~ErrorInstance(void);
 
+    void trace_impl(JSTracer* trc);
+
  public:
     void copy_gerror(GError* other) { m_ptr = g_error_copy(other); }
     GJS_JSAPI_RETURN_CONVENTION
@@ -159,6 +177,8 @@ class ErrorInstance : public GIWrapperInstance<ErrorBase, ErrorPrototype,
 
     [[nodiscard]] const char* message(void) const { return m_ptr->message; }
     [[nodiscard]] int code(void) const { return m_ptr->code; }
+    [[nodiscard]] JSObject* frame(void) const { return m_frame; }
+    void set_frame(JSObject* frame) { m_frame = frame; }
 
     // JS constructor
 
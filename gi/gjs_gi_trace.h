@@ -33,11 +33,14 @@
 /* include the generated probes header and put markers in code */
 #include "gjs_gi_probes.h"
 #define TRACE(probe) probe
+/* For probes whose arguments are not free to compute */
+#define TRACE_ENABLED(probe) probe##_ENABLED()
 
 #else
 
 /* Wrap the probe to allow it to be removed when no systemtap available */
 #define TRACE(probe)
+#define TRACE_ENABLED(probe) false
 
 #endif
 
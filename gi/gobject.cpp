@@ -25,6 +25,7 @@
 
 #include <unordered_map>
 #include <utility>  // for move, pair
+#include <vector>
 
 #include <glib-object.h>
 #include <glib.h>
@@ -36,17 +37,16 @@
 
 #include "gi/gobject.h"
 #include "gi/object.h"
+#include "gi/repo.h"
 #include "gi/value.h"
 #include "cjs/context-private.h"
-#include "cjs/context.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
 
 static std::unordered_map<GType, AutoParamArray> class_init_properties;
 
 [[nodiscard]] static JSContext* current_context() {
-    GjsContext* gjs = gjs_context_get_current();
-    return static_cast<JSContext*>(gjs_context_get_native_context(gjs));
+    return GjsContextPrivate::from_current_context()->context();
 }
 
 void push_class_init_properties(GType gtype, AutoParamArray* params) {
@@ -70,7 +70,7 @@ static bool jsobj_set_gproperty(JSContext* cx, JS::HandleObject object,
     if (!gjs_value_from_g_value(cx, &jsvalue, value))
         return false;
 
-    GjsAutoChar underscore_name = gjs_hyphen_to_underscore(pspec->name);
+    const char* underscore_name = gjs_underscore_property_name(pspec->name);
     return JS_SetProperty(cx, object, underscore_name, jsvalue);
 }
 
@@ -151,6 +151,9 @@ static void gjs_object_set_gproperty(GObject* object,
                                      unsigned property_id [[maybe_unused]],
                                      const GValue* value, GParamSpec* pspec) {
     auto* priv = ObjectInstance::for_gobject(object);
+    // The wrapper was swept by a GC that hasn't finalized it yet
+    if (!priv || !priv->has_wrapper())
+        return;
     JSContext *cx = current_context();
 
     JS::RootedObject js_obj(cx, priv->wrapper());
@@ -164,13 +167,19 @@ static void gjs_object_get_gproperty(GObject* object,
                                      unsigned property_id [[maybe_unused]],
                                      GValue* value, GParamSpec* pspec) {
     auto* priv = ObjectInstance::for_gobject(object);
+    // The wrapper was swept by a GC that hasn't finalized it yet, and the JS
+    // state that backs the property is gone along with it
+    if (!priv || !priv->has_wrapper()) {
+        g_param_value_set_default(pspec, value);
+        return;
+    }
     JSContext *cx = current_context();
 
     JS::RootedObject js_obj(cx, priv->wrapper());
     JS::RootedValue jsvalue(cx);
     JSAutoRealm ar(cx, js_obj);
 
-    GjsAutoChar underscore_name = gjs_hyphen_to_underscore(pspec->name);
+    const char* underscore_name = gjs_underscore_property_name(pspec->name);
     if (!JS_GetProperty(cx, js_obj, underscore_name, &jsvalue)) {
         gjs_log_exception_uncaught(cx);
         return;
@@ -188,15 +197,18 @@ static void gjs_object_class_init(void* class_pointer, void*) {
     klass->get_property = gjs_object_get_gproperty;
 
     AutoParamArray properties;
-    if (!pop_class_init_properties(gtype, &properties))
+    if (!pop_class_init_properties(gtype, &properties) || properties.empty())
         return;
 
-    unsigned i = 0;
+    // Property IDs start at 1, so the first element is unused
+    std::vector<GParamSpec*> pspecs{nullptr};
+    pspecs.reserve(properties.size() + 1);
     for (GjsAutoParam& pspec : properties) {
         g_param_spec_set_qdata(pspec, ObjectBase::custom_property_quark(),
                                GINT_TO_POINTER(1));
-        g_object_class_install_property(klass, ++i, pspec);
+        pspecs.push_back(pspec);
     }
+    g_object_class_install_properties(klass, pspecs.size(), pspecs.data());
 }
 
 static void gjs_object_custom_init(GTypeInstance* instance,
@@ -24,21 +24,17 @@
 
 #include <config.h>
 
-#include <utility>  // for (implicit) move
-
 #include <glib-object.h>
 #include <glib.h>
 
-#include <js/AllocPolicy.h>  // for SystemAllocPolicy
 #include <js/CallArgs.h>
 #include <js/Class.h>
-#include <js/GCHashTable.h>         // for WeakCache
+#include <js/GCAPI.h>               // for JS_UpdateWeakPointerAfterGC
 #include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <jsapi.h>  // for JS_GetPropertyById, JS_AtomizeString
-#include <mozilla/HashTable.h>
 
 #include "gi/gtype.h"
 #include "cjs/atoms.h"
@@ -117,6 +113,21 @@ JSFunctionSpec gjs_gtype_proto_funcs[] = {
 
 JSFunctionSpec gjs_gtype_static_funcs[] = { JS_FS_END };
 
+[[nodiscard]] static GQuark gjs_gtype_wrapper_quark() {
+    static GQuark val = 0;
+    if (G_UNLIKELY(!val))
+        val = g_quark_from_static_string("gjs::gtype-wrapper");
+
+    return val;
+}
+
+// Each GType's wrapper is also reachable from the GType's qdata, which points
+// at the wrapper's slot in the context's GTypeTable, so that the lookups done
+// for every $gtype access and GType argument don't need to hash. Qdata is
+// process-wide, so only one context at a time uses it; any others look their
+// wrappers up in their table.
+static GjsContextPrivate* s_qdata_owner = nullptr;
+
 JSObject *
 gjs_gtype_create_gtype_wrapper (JSContext *context,
                                 GType      gtype)
@@ -125,28 +136,64 @@ gjs_gtype_create_gtype_wrapper (JSContext *context,
               gtype != 0));
 
     GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
-    // We cannot use gtype_table().lookupForAdd() here, because in between the
-    // lookup and the add, GCs may take place and mutate the hash table. A GC
-    // may only remove an element, not add one, so it's still safe to do this
-    // without locking.
-    auto p = gjs->gtype_table().lookup(gtype);
-    if (p.found())
-        return p->value();
+    if (gjs == s_qdata_owner) {
+        auto* slot = static_cast<JS::Heap<JSObject*>*>(
+            g_type_get_qdata(gtype, gjs_gtype_wrapper_quark()));
+        if (slot)
+            return *slot;
+    }
+
+    // Look the wrapper up again after creating it. A GC in between may remove
+    // entries from the table, but never add one.
+    GTypeTable& table = gjs->gtype_table();
+    auto it = table.find(gtype);
+    if (it == table.end()) {
+        JS::RootedObject proto(context);
+        if (!gjs_gtype_define_proto(context, nullptr, &proto))
+            return nullptr;
 
-    JS::RootedObject proto(context);
-    if (!gjs_gtype_define_proto(context, nullptr, &proto))
-        return nullptr;
+        JS::RootedObject gtype_wrapper(
+            context,
+            JS_NewObjectWithGivenProto(context, &gjs_gtype_class, proto));
+        if (!gtype_wrapper)
+            return nullptr;
 
-    JS::RootedObject gtype_wrapper(
-        context, JS_NewObjectWithGivenProto(context, &gjs_gtype_class, proto));
-    if (!gtype_wrapper)
-        return nullptr;
+        JS_SetPrivate(gtype_wrapper, GSIZE_TO_POINTER(gtype));
 
-    JS_SetPrivate(gtype_wrapper, GSIZE_TO_POINTER(gtype));
+        it = table.emplace(gtype, gtype_wrapper.get()).first;
+    }
+
+    if (!s_qdata_owner)
+        s_qdata_owner = gjs;
+    if (gjs == s_qdata_owner)
+        g_type_set_qdata(gtype, gjs_gtype_wrapper_quark(), &it->second);
 
-    gjs->gtype_table().put(gtype, gtype_wrapper);
+    return it->second;
+}
 
-    return gtype_wrapper;
+void gjs_gtype_update_wrappers_after_gc(GjsContextPrivate* gjs) {
+    GTypeTable& table = gjs->gtype_table();
+    for (auto it = table.begin(); it != table.end();) {
+        JS_UpdateWeakPointerAfterGC(&it->second);
+        if (it->second.unbarrieredGet()) {
+            ++it;
+            continue;
+        }
+
+        if (gjs == s_qdata_owner)
+            g_type_set_qdata(it->first, gjs_gtype_wrapper_quark(), nullptr);
+        it = table.erase(it);
+    }
+}
+
+void gjs_gtype_release_wrappers(GjsContextPrivate* gjs) {
+    GTypeTable& table = gjs->gtype_table();
+    if (gjs == s_qdata_owner) {
+        for (auto& entry : table)
+            g_type_set_qdata(entry.first, gjs_gtype_wrapper_quark(), nullptr);
+        s_qdata_owner = nullptr;
+    }
+    table.clear();
 }
 
 GJS_JSAPI_RETURN_CONVENTION
@@ -33,6 +33,8 @@
 
 #include "cjs/macros.h"
 
+class GjsContextPrivate;
+
 GJS_JSAPI_RETURN_CONVENTION
 JSObject * gjs_gtype_create_gtype_wrapper (JSContext *context,
                                            GType      gtype);
@@ -44,4 +46,7 @@ bool gjs_gtype_get_actual_gtype(JSContext* context, JS::HandleObject object,
 [[nodiscard]] bool gjs_typecheck_gtype(JSContext* cx, JS::HandleObject obj,
                                        bool throw_error);
 
+void gjs_gtype_update_wrappers_after_gc(GjsContextPrivate* gjs);
+void gjs_gtype_release_wrappers(GjsContextPrivate* gjs);
+
 #endif  // GI_GTYPE_H_
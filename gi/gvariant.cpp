@@ -0,0 +1,1124 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <memory>  // for unique_ptr
+#include <vector>
+
+#include <gio/gio.h>  // for GTask, GDBusProxy
+#include <girepository.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/CharacterEncoding.h>  // for DeflateStringToUTF8Buffer
+#include <js/Conversions.h>        // for ToBoolean, ToInt32, ToUint32
+#include <js/GCAPI.h>              // for AutoCheckCannotGC
+#include <js/GCVector.h>           // for RootedVector
+#include <js/Id.h>
+#include <js/Realm.h>  // for GetRealmObjectPrototype, JSAutoRealm
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars
+#include <js/Value.h>
+#include <js/ValueArray.h>
+#include <jsapi.h>        // for JS_Enumerate, JS_GetPropertyById, ...
+#include <jsfriendapi.h>  // for JS_IsUint8Array, GetUint8ArrayLengthAndData
+#include <mozilla/Span.h>
+
+#include "gi/arg-inl.h"
+#include "gi/boxed.h"
+#include "gi/closure.h"
+#include "gi/gerror.h"
+#include "gi/gvariant.h"
+#include "gi/object.h"
+#include "cjs/atoms.h"
+#include "cjs/byteArray.h"
+#include "cjs/context-private.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/string-cache.h"
+
+using GjsAutoVariant =
+    GjsAutoPointer<GVariant, GVariant, g_variant_unref, g_variant_ref>;
+using GjsAutoBytes = GjsAutoPointer<GBytes, GBytes, g_bytes_unref>;
+
+[[nodiscard]] static GVariant* sink(GVariant* variant) {
+    return variant ? g_variant_ref_sink(variant) : nullptr;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool wrap_variant(JSContext* cx, GIStructInfo* info, GVariant* variant,
+                         JS::MutableHandleValue value_p) {
+    // Takes its own reference to @variant
+    JSObject* obj = BoxedInstance::new_for_c_struct(cx, info, variant);
+    if (!obj)
+        return false;
+    value_p.setObject(*obj);
+    return true;
+}
+
+// Packs JS values into GVariants following a type string, which has already
+// been checked to be a single, definite type.
+//
+// Only values that map directly onto the type are handled here. Anything that
+// the JS implementation would coerce (a string for a number, an array of
+// numbers for bytes...) or reject makes pack() return null without a pending
+// exception; the caller then starts over with the JS implementation, so that
+// the results and the error messages stay the same.
+class VariantPacker {
+    JSContext* m_cx;
+    const char* m_sig;  // the type that the next call to pack() will consume
+
+    [[nodiscard]] static const char* skip_type(const char* type) {
+        const char* end;
+        g_variant_type_string_scan(type, nullptr, &end);
+        return end;
+    }
+
+    [[nodiscard]] bool get_length(JS::HandleObject obj, uint32_t* length_p) {
+        const GjsAtoms& atoms = GjsContextPrivate::atoms(m_cx);
+        JS::RootedValue length(m_cx);
+        if (!JS_GetPropertyById(m_cx, obj, atoms.length(), &length))
+            return false;
+        // The JS loops run zero times if there is no length
+        if (length.isUndefined()) {
+            *length_p = 0;
+            return true;
+        }
+        if (!length.isInt32() || length.toInt32() < 0)
+            return false;
+        *length_p = length.toInt32();
+        return true;
+    }
+
+    [[nodiscard]] static GVariant* pack_number(char type, double number) {
+        switch (type) {
+            case 'y': {
+                uint32_t n = JS::ToUint32(number);
+                return n <= G_MAXUINT8 ? g_variant_new_byte(n) : nullptr;
+            }
+            case 'n': {
+                int32_t n = JS::ToInt32(number);
+                return n >= G_MININT16 && n <= G_MAXINT16
+                           ? g_variant_new_int16(n)
+                           : nullptr;
+            }
+            case 'q': {
+                uint32_t n = JS::ToUint32(number);
+                return n <= G_MAXUINT16 ? g_variant_new_uint16(n) : nullptr;
+            }
+            case 'i':
+                return g_variant_new_int32(JS::ToInt32(number));
+            case 'h':
+                return g_variant_new_handle(JS::ToInt32(number));
+            case 'u':
+                if (!(number >= 0 && number <= G_MAXUINT32))
+                    return nullptr;
+                return g_variant_new_uint32(static_cast<uint32_t>(number));
+            case 'x':
+                if (!(number >= -0x1p63 && number < 0x1p63))
+                    return nullptr;
+                return g_variant_new_int64(static_cast<int64_t>(number));
+            case 't':
+                if (!(number >= 0 && number < 0x1p64))
+                    return nullptr;
+                return g_variant_new_uint64(static_cast<uint64_t>(number));
+            case 'd':
+                return g_variant_new_double(number);
+            default:
+                g_assert_not_reached();
+        }
+    }
+
+    [[nodiscard]] GVariant* pack_string(char type, JS::HandleValue value) {
+        if (!value.isString())
+            return nullptr;
+        JS::UniqueChars str = gjs_string_to_utf8(m_cx, value);
+        if (!str)
+            return nullptr;
+
+        if (type == 's')
+            return g_variant_new_string(str.get());
+        if (type == 'o')
+            return g_variant_is_object_path(str.get())
+                       ? g_variant_new_object_path(str.get())
+                       : nullptr;
+        return g_variant_is_signature(str.get())
+                   ? g_variant_new_signature(str.get())
+                   : nullptr;
+    }
+
+    [[nodiscard]] GVariant* pack_variant(JS::HandleValue value) {
+        if (!value.isObject())
+            return nullptr;
+        JS::RootedObject obj(m_cx, &value.toObject());
+        if (!BoxedBase::typecheck(m_cx, obj, nullptr, G_TYPE_VARIANT,
+                                  GjsTypecheckNoThrow()))
+            return nullptr;
+        GVariant* child = BoxedBase::to_c_ptr<GVariant>(m_cx, obj);
+        if (!child)
+            return nullptr;
+        return g_variant_new_variant(child);
+    }
+
+    [[nodiscard]] GVariant* pack_maybe(JS::HandleValue value) {
+        if (value.isNull()) {
+            auto* element_type = reinterpret_cast<const GVariantType*>(m_sig);
+            m_sig = skip_type(m_sig);
+            return g_variant_new_maybe(element_type, nullptr);
+        }
+
+        GjsAutoVariant child = pack(value);
+        if (!child)
+            return nullptr;
+        return g_variant_new_maybe(nullptr, child);
+    }
+
+    // Like ByteArray.fromString(), with a terminating zero byte added if the
+    // string doesn't already end with one
+    [[nodiscard]] GVariant* pack_bytestring(JS::HandleString str) {
+        JSLinearString* linear = JS_EnsureLinearString(m_cx, str);
+        if (!linear)
+            return nullptr;
+
+        JS::AutoCheckCannotGC nogc;
+        size_t length = JS::GetDeflatedUTF8StringLength(linear);
+        auto* bytes = static_cast<char*>(g_malloc(length + 1));
+        size_t written = JS::DeflateStringToUTF8Buffer(
+            linear, mozilla::Span<char>(bytes, length));
+        if (written == 0 || bytes[written - 1] != '\0')
+            bytes[written++] = '\0';
+
+        return g_variant_new_from_data(G_VARIANT_TYPE_BYTESTRING, bytes,
+                                       written, true, g_free, bytes);
+    }
+
+    [[nodiscard]] GVariant* pack_bytes(JS::HandleValue value) {
+        if (value.isString()) {
+            JS::RootedString str(m_cx, value.toString());
+            return pack_bytestring(str);
+        }
+
+        if (!value.isObject() || !JS_IsUint8Array(&value.toObject()))
+            return nullptr;
+
+        bool is_shared_memory;
+        uint32_t length;
+        uint8_t* data;
+        js::GetUint8ArrayLengthAndData(&value.toObject(), &length,
+                                       &is_shared_memory, &data);
+        return g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, data, length, 1);
+    }
+
+    [[nodiscard]] bool pack_elements(JS::HandleObject obj,
+                                     const char* element_type,
+                                     GVariantBuilder* builder) {
+        uint32_t length;
+        if (!get_length(obj, &length))
+            return false;
+
+        JS::RootedValue element(m_cx);
+        for (uint32_t ix = 0; ix < length; ix++) {
+            if (!JS_GetElement(m_cx, obj, ix, &element))
+                return false;
+
+            m_sig = element_type;
+            GjsAutoVariant child = pack(element);
+            if (!child)
+                return false;
+            g_variant_builder_add_value(builder, child);
+        }
+        return true;
+    }
+
+    // JS objects become dictionaries through a for...in loop, which only
+    // matches JS_Enumerate() for ordinary objects with nothing enumerable on
+    // the prototype chain.
+    [[nodiscard]] bool pack_dict_entries(JS::HandleObject obj,
+                                         const char* entry_type,
+                                         GVariantBuilder* builder) {
+        // Property names are strings; the JS implementation coerces them for
+        // other key types
+        char key_type = entry_type[1];
+        if (key_type != 's' && key_type != 'o' && key_type != 'g')
+            return false;
+
+        bool is_ordinary;
+        JS::RootedObject proto(m_cx);
+        if (!JS_GetPrototypeIfOrdinary(m_cx, obj, &is_ordinary, &proto))
+            return false;
+        if (!is_ordinary ||
+            (proto && proto != JS::GetRealmObjectPrototype(m_cx)))
+            return false;
+
+        JS::Rooted<JS::IdVector> ids(m_cx, m_cx);
+        if (!JS_Enumerate(m_cx, obj, &ids))
+            return false;
+
+        JS::RootedId id(m_cx);
+        JS::RootedValue key(m_cx), value(m_cx);
+        for (size_t ix = 0; ix < ids.length(); ix++) {
+            id = ids[ix];
+            if (!JS_IdToValue(m_cx, id, &key) ||
+                !JS_GetPropertyById(m_cx, obj, id, &value))
+                return false;
+
+            // Integer property names come back as numbers
+            if (!key.isString()) {
+                JSString* key_str = JS::ToString(m_cx, key);
+                if (!key_str)
+                    return false;
+                key.setString(key_str);
+            }
+
+            m_sig = entry_type + 1;
+            GjsAutoVariant key_variant = pack(key);
+            if (!key_variant)
+                return false;
+            GjsAutoVariant value_variant = pack(value);
+            if (!value_variant)
+                return false;
+
+            g_variant_builder_add_value(
+                builder, g_variant_new_dict_entry(key_variant, value_variant));
+        }
+        return true;
+    }
+
+    [[nodiscard]] GVariant* pack_array(JS::HandleValue value) {
+        const char* element_type = m_sig;
+        const char* end = skip_type(element_type);
+
+        GVariant* retval;
+        if (*element_type == 's' || *element_type == 'y') {
+            retval = *element_type == 's' ? pack_strv(value)
+                                          : pack_bytes(value);
+        } else {
+            if (!value.isObject())
+                return nullptr;
+            JS::RootedObject obj(m_cx, &value.toObject());
+
+            GVariantBuilder builder;
+            g_variant_builder_init(
+                &builder, reinterpret_cast<const GVariantType*>(m_sig - 1));
+            bool ok = *element_type == '{'
+                          ? pack_dict_entries(obj, element_type, &builder)
+                          : pack_elements(obj, element_type, &builder);
+            if (!ok) {
+                g_variant_builder_clear(&builder);
+                return nullptr;
+            }
+            retval = g_variant_builder_end(&builder);
+        }
+
+        m_sig = end;
+        return retval;
+    }
+
+    [[nodiscard]] GVariant* pack_strv(JS::HandleValue value) {
+        if (!value.isObject())
+            return nullptr;
+        JS::RootedObject obj(m_cx, &value.toObject());
+
+        GVariantBuilder builder;
+        g_variant_builder_init(&builder, G_VARIANT_TYPE_STRING_ARRAY);
+        if (!pack_elements(obj, "s", &builder)) {
+            g_variant_builder_clear(&builder);
+            return nullptr;
+        }
+        return g_variant_builder_end(&builder);
+    }
+
+    [[nodiscard]] GVariant* pack_tuple(JS::HandleValue value) {
+        if (!value.isObject())
+            return nullptr;
+        JS::RootedObject obj(m_cx, &value.toObject());
+
+        uint32_t length;
+        if (!get_length(obj, &length))
+            return nullptr;
+
+        std::vector<GjsAutoVariant> children;
+        JS::RootedValue element(m_cx);
+        for (uint32_t ix = 0; ix < length && *m_sig != ')'; ix++) {
+            if (!JS_GetElement(m_cx, obj, ix, &element))
+                return nullptr;
+            GjsAutoVariant child = pack(element);
+            if (!child)
+                return nullptr;
+            children.push_back(std::move(child));
+        }
+
+        // Fewer elements than the tuple type has members
+        if (*m_sig != ')')
+            return nullptr;
+        m_sig++;
+
+        std::vector<GVariant*> items(children.size());
+        for (size_t ix = 0; ix < children.size(); ix++)
+            items[ix] = children[ix];
+        return g_variant_new_tuple(items.data(), items.size());
+    }
+
+    [[nodiscard]] GVariant* pack_dict_entry(JS::HandleValue value) {
+        if (!value.isObject())
+            return nullptr;
+        JS::RootedObject obj(m_cx, &value.toObject());
+
+        JS::RootedValue element(m_cx);
+        if (!JS_GetElement(m_cx, obj, 0, &element))
+            return nullptr;
+        GjsAutoVariant key = pack(element);
+        if (!key || !JS_GetElement(m_cx, obj, 1, &element))
+            return nullptr;
+        GjsAutoVariant child = pack(element);
+        if (!child)
+            return nullptr;
+
+        g_assert(*m_sig == '}' && "type string was already validated");
+        m_sig++;
+        return g_variant_new_dict_entry(key, child);
+    }
+
+ public:
+    VariantPacker(JSContext* cx, const char* type) : m_cx(cx), m_sig(type) {}
+
+    [[nodiscard]] const char* remaining() const { return m_sig; }
+
+    // Returns a GVariant with a full (non-floating) reference, or null either
+    // with a pending exception or to fall back to the JS implementation
+    [[nodiscard]] GVariant* pack(JS::HandleValue value) {
+        char type = *m_sig++;
+        switch (type) {
+            case 'b':
+                return sink(g_variant_new_boolean(JS::ToBoolean(value)));
+            case 'y':
+            case 'n':
+            case 'q':
+            case 'i':
+            case 'u':
+            case 'x':
+            case 't':
+            case 'h':
+            case 'd':
+                if (!value.isNumber())
+                    return nullptr;
+                return sink(pack_number(type, value.toNumber()));
+            case 's':
+            case 'o':
+            case 'g':
+                return sink(pack_string(type, value));
+            case 'v':
+                return sink(pack_variant(value));
+            case 'm':
+                return sink(pack_maybe(value));
+            case 'a':
+                return sink(pack_array(value));
+            case '(':
+                return sink(pack_tuple(value));
+            case '{':
+                return sink(pack_dict_entry(value));
+            default:
+                g_assert_not_reached();
+        }
+    }
+};
+
+// Unpacks GVariants in the same way as _unpackVariant() in the GLib overrides:
+// containers become JS arrays and objects, and when unpacking shallowly their
+// members are GLib.Variant wrappers.
+class VariantUnpacker {
+    JSContext* m_cx;
+    bool m_recursive;
+    GjsAutoStructInfo m_variant_info;
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool unpack_child(GVariant* child, bool deep,
+                      JS::MutableHandleValue value_p) {
+        if (deep)
+            return unpack(child, deep, value_p);
+        return wrap_variant(m_cx, m_variant_info, child, value_p);
+    }
+
+    template <typename T>
+    [[nodiscard]] static double maybe_rounded(T value) {
+        GIArgument arg;
+        gjs_arg_set<T>(&arg, value);
+        return gjs_arg_get_maybe_rounded<T>(&arg);
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool unpack_dict(GVariant* variant, bool deep,
+                     JS::MutableHandleValue value_p) {
+        JS::RootedObject obj(m_cx, JS_NewPlainObject(m_cx));
+        if (!obj)
+            return false;
+
+        JS::RootedValue key(m_cx), value(m_cx);
+        JS::RootedId id(m_cx);
+        size_t n_entries = g_variant_n_children(variant);
+        for (size_t ix = 0; ix < n_entries; ix++) {
+            GjsAutoVariant entry = g_variant_get_child_value(variant, ix);
+            GjsAutoVariant key_variant = g_variant_get_child_value(entry, 0);
+            GjsAutoVariant value_variant = g_variant_get_child_value(entry, 1);
+
+            // The key is always unpacked, or it couldn't be a property name
+            if (!unpack(key_variant, true, &key) ||
+                !JS_ValueToId(m_cx, key, &id) ||
+                !unpack_child(value_variant, deep, &value) ||
+                !JS_SetPropertyById(m_cx, obj, id, value))
+                return false;
+        }
+
+        value_p.setObject(*obj);
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool unpack_children(GVariant* variant, bool deep,
+                         JS::MutableHandleValue value_p) {
+        size_t n_children = g_variant_n_children(variant);
+        JS::RootedValueVector elems(m_cx);
+        if (!elems.resize(n_children)) {
+            JS_ReportOutOfMemory(m_cx);
+            return false;
+        }
+
+        for (size_t ix = 0; ix < n_children; ix++) {
+            GjsAutoVariant child = g_variant_get_child_value(variant, ix);
+            if (!unpack_child(child, deep, elems[ix]))
+                return false;
+        }
+
+        JSObject* array = JS::NewArrayObject(m_cx, elems);
+        if (!array)
+            return false;
+        value_p.setObject(*array);
+        return true;
+    }
+
+ public:
+    VariantUnpacker(JSContext* cx, bool recursive)
+        : m_cx(cx),
+          m_recursive(recursive),
+          m_variant_info(g_irepository_find_by_gtype(nullptr, G_TYPE_VARIANT)) {
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool unpack(GVariant* variant, bool deep, JS::MutableHandleValue value_p) {
+        switch (g_variant_classify(variant)) {
+            case G_VARIANT_CLASS_BOOLEAN:
+                value_p.setBoolean(g_variant_get_boolean(variant));
+                return true;
+            case G_VARIANT_CLASS_BYTE:
+                value_p.setInt32(g_variant_get_byte(variant));
+                return true;
+            case G_VARIANT_CLASS_INT16:
+                value_p.setInt32(g_variant_get_int16(variant));
+                return true;
+            case G_VARIANT_CLASS_UINT16:
+                value_p.setInt32(g_variant_get_uint16(variant));
+                return true;
+            case G_VARIANT_CLASS_INT32:
+                value_p.setInt32(g_variant_get_int32(variant));
+                return true;
+            case G_VARIANT_CLASS_UINT32:
+                value_p.setNumber(g_variant_get_uint32(variant));
+                return true;
+            case G_VARIANT_CLASS_INT64:
+                value_p.setNumber(
+                    maybe_rounded<int64_t>(g_variant_get_int64(variant)));
+                return true;
+            case G_VARIANT_CLASS_UINT64:
+                value_p.setNumber(
+                    maybe_rounded<uint64_t>(g_variant_get_uint64(variant)));
+                return true;
+            case G_VARIANT_CLASS_HANDLE:
+                value_p.setInt32(g_variant_get_handle(variant));
+                return true;
+            case G_VARIANT_CLASS_DOUBLE:
+                value_p.setNumber(g_variant_get_double(variant));
+                return true;
+            case G_VARIANT_CLASS_STRING:
+            case G_VARIANT_CLASS_OBJECT_PATH:
+            case G_VARIANT_CLASS_SIGNATURE:
+                // Object paths, interface names and property names repeat a
+                // lot in D-Bus traffic
+                return GjsContextPrivate::from_cx(m_cx)->string_cache().get(
+                    m_cx, g_variant_get_string(variant, nullptr), value_p);
+            case G_VARIANT_CLASS_VARIANT: {
+                GjsAutoVariant child = g_variant_get_variant(variant);
+                return unpack_child(child, deep && m_recursive, value_p);
+            }
+            case G_VARIANT_CLASS_MAYBE: {
+                GjsAutoVariant child = g_variant_get_maybe(variant);
+                if (!child) {
+                    value_p.setNull();
+                    return true;
+                }
+                return unpack_child(child, deep, value_p);
+            }
+            case G_VARIANT_CLASS_ARRAY: {
+                const GVariantType* type = g_variant_get_type(variant);
+                if (g_variant_type_is_dict_entry(g_variant_type_element(type)))
+                    return unpack_dict(variant, deep, value_p);
+
+                if (g_variant_type_equal(type, G_VARIANT_TYPE_BYTESTRING)) {
+                    GjsAutoBytes bytes = g_variant_get_data_as_bytes(variant);
+                    JSObject* array = gjs_byte_array_from_gbytes(m_cx, bytes);
+                    if (!array)
+                        return false;
+                    value_p.setObject(*array);
+                    return true;
+                }
+
+                return unpack_children(variant, deep, value_p);
+            }
+            case G_VARIANT_CLASS_TUPLE:
+            case G_VARIANT_CLASS_DICT_ENTRY:
+                return unpack_children(variant, deep, value_p);
+            default:
+                gjs_throw(m_cx,
+                          "Assertion failure: this code should not be reached");
+                return false;
+        }
+    }
+};
+
+bool gjs_variant_pack(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::UniqueChars signature;
+    if (!gjs_parse_call_args(cx, "variant_pack", args, "s", "signature",
+                             &signature))
+        return false;
+
+    // Leave invalid type strings to the JS implementation, which has its own
+    // error messages for them
+    const char* end;
+    if (!g_variant_type_string_scan(signature.get(), nullptr, &end) ||
+        *end != '\0' ||
+        !g_variant_type_is_definite(
+            reinterpret_cast<const GVariantType*>(signature.get()))) {
+        args.rval().setUndefined();
+        return true;
+    }
+
+    VariantPacker packer(cx, signature.get());
+    GjsAutoVariant variant = packer.pack(args.get(1));
+    if (!variant) {
+        if (JS_IsExceptionPending(cx))
+            return false;
+        args.rval().setUndefined();
+        return true;
+    }
+    g_assert(*packer.remaining() == '\0');
+
+    GjsAutoStructInfo info =
+        g_irepository_find_by_gtype(nullptr, G_TYPE_VARIANT);
+    return wrap_variant(cx, info, variant, args.rval());
+}
+
+bool gjs_variant_unpack(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject variant_obj(cx);
+    bool deep, recursive;
+    if (!gjs_parse_call_args(cx, "variant_unpack", args, "obb", "variant",
+                             &variant_obj, "deep", &deep, "recursive",
+                             &recursive))
+        return false;
+
+    if (!BoxedBase::typecheck(cx, variant_obj, nullptr, G_TYPE_VARIANT))
+        return false;
+    GVariant* variant = BoxedBase::to_c_ptr<GVariant>(cx, variant_obj);
+    if (!variant)
+        return false;
+
+    VariantUnpacker unpacker(cx, recursive);
+    return unpacker.unpack(variant, deep, args.rval());
+}
+
+// Deep unpacking off the main thread: a GTask thread walks the GVariant into a
+// flat, pre-order list of nodes, and the main thread then builds the JS values
+// from the list in one pass, without going through the GVariant API again.
+//
+// The strings in the nodes point into the GVariant's serialized data, which the
+// decode keeps alive; the variant is serialized before the walk, so that its
+// children are all slices of that data.
+struct VariantNode {
+    enum Kind : uint8_t {
+        BOOLEAN,
+        INT32,
+        NUMBER,
+        STRING,
+        NULL_VALUE,
+        VARIANT,  // stays a GLib.Variant, for 'v' when not recursive
+        BYTES,    // a bytestring, which becomes a Uint8Array
+        ARRAY,    // followed by its children
+        DICT,     // followed by a key and a value for each entry
+    };
+
+    Kind kind;
+    uint32_t n_children;
+    union {
+        bool boolean;
+        int32_t int32;
+        double number;
+        const char* string;
+        GVariant* variant;
+        GBytes* bytes;
+    };
+};
+
+// The task data only holds GLib data, since it may be freed on the GTask's
+// thread. The callback closure is passed to on_decoded() as its user data
+// instead, and released there, on the thread that owns the JS context.
+struct GjsVariantDecode {
+    GjsAutoVariant root;
+    bool recursive;
+    std::vector<VariantNode> nodes;
+
+    ~GjsVariantDecode() {
+        for (VariantNode& node : nodes) {
+            if (node.kind == VariantNode::VARIANT)
+                g_variant_unref(node.variant);
+            else if (node.kind == VariantNode::BYTES)
+                g_bytes_unref(node.bytes);
+        }
+    }
+
+    template <typename T>
+    [[nodiscard]] static double maybe_rounded(T value) {
+        GIArgument arg;
+        gjs_arg_set<T>(&arg, value);
+        return gjs_arg_get_maybe_rounded<T>(&arg);
+    }
+
+    void add_container(VariantNode::Kind kind, GVariant* variant) {
+        size_t n_children = g_variant_n_children(variant);
+        VariantNode node{kind, uint32_t(n_children), {}};
+        nodes.push_back(node);
+        for (size_t ix = 0; ix < n_children; ix++) {
+            GjsAutoVariant child = g_variant_get_child_value(variant, ix);
+            if (kind == VariantNode::DICT) {
+                GjsAutoVariant key = g_variant_get_child_value(child, 0);
+                GjsAutoVariant value = g_variant_get_child_value(child, 1);
+                decode(key, true);
+                decode(value, true);
+            } else {
+                decode(child, true);
+            }
+        }
+    }
+
+    // Called on the GTask's thread; @deep is false only for the contents of a
+    // 'v' when not recursive
+    void decode(GVariant* variant, bool deep) {
+        VariantNode node{VariantNode::NUMBER, 0, {}};
+        if (!deep) {
+            node.kind = VariantNode::VARIANT;
+            node.variant = g_variant_ref(variant);
+            nodes.push_back(node);
+            return;
+        }
+
+        switch (g_variant_classify(variant)) {
+            case G_VARIANT_CLASS_BOOLEAN:
+                node.kind = VariantNode::BOOLEAN;
+                node.boolean = g_variant_get_boolean(variant);
+                break;
+            case G_VARIANT_CLASS_BYTE:
+                node.kind = VariantNode::INT32;
+                node.int32 = g_variant_get_byte(variant);
+                break;
+            case G_VARIANT_CLASS_INT16:
+                node.kind = VariantNode::INT32;
+                node.int32 = g_variant_get_int16(variant);
+                break;
+            case G_VARIANT_CLASS_UINT16:
+                node.kind = VariantNode::INT32;
+                node.int32 = g_variant_get_uint16(variant);
+                break;
+            case G_VARIANT_CLASS_INT32:
+                node.kind = VariantNode::INT32;
+                node.int32 = g_variant_get_int32(variant);
+                break;
+            case G_VARIANT_CLASS_HANDLE:
+                node.kind = VariantNode::INT32;
+                node.int32 = g_variant_get_handle(variant);
+                break;
+            case G_VARIANT_CLASS_UINT32:
+                node.number = g_variant_get_uint32(variant);
+                break;
+            case G_VARIANT_CLASS_INT64:
+                node.number = maybe_rounded<int64_t>(g_variant_get_int64(variant));
+                break;
+            case G_VARIANT_CLASS_UINT64:
+                node.number =
+                    maybe_rounded<uint64_t>(g_variant_get_uint64(variant));
+                break;
+            case G_VARIANT_CLASS_DOUBLE:
+                node.number = g_variant_get_double(variant);
+                break;
+            case G_VARIANT_CLASS_STRING:
+            case G_VARIANT_CLASS_OBJECT_PATH:
+            case G_VARIANT_CLASS_SIGNATURE:
+                node.kind = VariantNode::STRING;
+                node.string = g_variant_get_string(variant, nullptr);
+                break;
+            case G_VARIANT_CLASS_VARIANT: {
+                GjsAutoVariant child = g_variant_get_variant(variant);
+                decode(child, recursive);
+                return;
+            }
+            case G_VARIANT_CLASS_MAYBE: {
+                GjsAutoVariant child = g_variant_get_maybe(variant);
+                if (child) {
+                    decode(child, true);
+                    return;
+                }
+                node.kind = VariantNode::NULL_VALUE;
+                break;
+            }
+            case G_VARIANT_CLASS_ARRAY: {
+                const GVariantType* type = g_variant_get_type(variant);
+                if (g_variant_type_is_dict_entry(g_variant_type_element(type))) {
+                    add_container(VariantNode::DICT, variant);
+                    return;
+                }
+                if (g_variant_type_equal(type, G_VARIANT_TYPE_BYTESTRING)) {
+                    node.kind = VariantNode::BYTES;
+                    node.bytes = g_variant_get_data_as_bytes(variant);
+                    break;
+                }
+                add_container(VariantNode::ARRAY, variant);
+                return;
+            }
+            case G_VARIANT_CLASS_TUPLE:
+            case G_VARIANT_CLASS_DICT_ENTRY:
+                add_container(VariantNode::ARRAY, variant);
+                return;
+            default:
+                g_assert_not_reached();
+        }
+        nodes.push_back(node);
+    }
+
+    static void decode_in_thread(GTask* task, void*, void* data,
+                                 GCancellable*) {
+        auto* self = static_cast<GjsVariantDecode*>(data);
+        // Flattens a variant built in memory into one serialized buffer, from
+        // which the strings are borrowed
+        g_variant_get_data(self->root);
+        self->decode(self->root, true);
+        g_task_return_boolean(task, true);
+    }
+
+    // Builds the JS value for the node at *@ix, moving *@ix past its children
+    GJS_JSAPI_RETURN_CONVENTION
+    bool materialize(JSContext* cx, GIStructInfo* variant_info, size_t* ix,
+                     JS::MutableHandleValue value_p) {
+        const VariantNode& node = nodes[(*ix)++];
+        switch (node.kind) {
+            case VariantNode::BOOLEAN:
+                value_p.setBoolean(node.boolean);
+                return true;
+            case VariantNode::INT32:
+                value_p.setInt32(node.int32);
+                return true;
+            case VariantNode::NUMBER:
+                value_p.setNumber(node.number);
+                return true;
+            case VariantNode::STRING:
+                return GjsContextPrivate::from_cx(cx)->string_cache().get(
+                    cx, node.string, value_p);
+            case VariantNode::NULL_VALUE:
+                value_p.setNull();
+                return true;
+            case VariantNode::VARIANT:
+                return wrap_variant(cx, variant_info, node.variant, value_p);
+            case VariantNode::BYTES: {
+                JSObject* array = gjs_byte_array_from_gbytes(cx, node.bytes);
+                if (!array)
+                    return false;
+                value_p.setObject(*array);
+                return true;
+            }
+            case VariantNode::ARRAY: {
+                JS::RootedValueVector elems(cx);
+                if (!elems.resize(node.n_children)) {
+                    JS_ReportOutOfMemory(cx);
+                    return false;
+                }
+                for (uint32_t child = 0; child < node.n_children; child++) {
+                    if (!materialize(cx, variant_info, ix, elems[child]))
+                        return false;
+                }
+                JSObject* array = JS::NewArrayObject(cx, elems);
+                if (!array)
+                    return false;
+                value_p.setObject(*array);
+                return true;
+            }
+            case VariantNode::DICT: {
+                JS::RootedObject obj(cx, JS_NewPlainObject(cx));
+                if (!obj)
+                    return false;
+                JS::RootedValue key(cx), value(cx);
+                JS::RootedId id(cx);
+                for (uint32_t entry = 0; entry < node.n_children; entry++) {
+                    if (!materialize(cx, variant_info, ix, &key) ||
+                        !JS_ValueToId(cx, key, &id) ||
+                        !materialize(cx, variant_info, ix, &value) ||
+                        !JS_SetPropertyById(cx, obj, id, value))
+                        return false;
+                }
+                value_p.setObject(*obj);
+                return true;
+            }
+            default:
+                g_assert_not_reached();
+        }
+    }
+
+    static void on_decoded(GObject*, GAsyncResult* result, void* data) {
+        GjsAutoPointer<GClosure, GClosure, g_closure_unref> callback(
+            static_cast<GClosure*>(data));
+        GTask* task = G_TASK(result);
+        auto* self = static_cast<GjsVariantDecode*>(g_task_get_task_data(task));
+        if (!gjs_closure_is_valid(callback))
+            return;  // The context was destroyed in the meantime
+
+        JSContext* cx = gjs_closure_get_context(callback);
+        JSAutoRealm ar(cx,
+                       JS_GetFunctionObject(gjs_closure_get_callable(callback)));
+
+        // callback(error, value)
+        JS::RootedValueArray<2> args(cx);
+        GjsAutoStructInfo variant_info =
+            g_irepository_find_by_gtype(nullptr, G_TYPE_VARIANT);
+        size_t ix = 0;
+        if (!self->materialize(cx, variant_info, &ix, args[1]) &&
+            !JS_GetPendingException(cx, args[0])) {
+            gjs_log_exception(cx);
+            return;
+        }
+        JS_ClearPendingException(cx);
+
+        JS::RootedValue ignored(cx);
+        if (!gjs_closure_invoke(callback, nullptr, args, &ignored, false)) {
+            // Exception already logged
+        }
+    }
+};
+
+bool gjs_variant_unpack_async(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject variant_obj(cx), callback(cx);
+    bool recursive;
+    if (!gjs_parse_call_args(cx, "variant_unpack_async", args, "obo",
+                             "variant", &variant_obj, "recursive", &recursive,
+                             "callback", &callback))
+        return false;
+
+    if (!BoxedBase::typecheck(cx, variant_obj, nullptr, G_TYPE_VARIANT))
+        return false;
+    GVariant* variant = BoxedBase::to_c_ptr<GVariant>(cx, variant_obj);
+    if (!variant)
+        return false;
+    if (!JS_ObjectIsFunction(callback)) {
+        gjs_throw(cx, "Callback must be a function");
+        return false;
+    }
+
+    auto* decode = new GjsVariantDecode();
+    decode->root = g_variant_ref(variant);
+    decode->recursive = recursive;
+
+    GClosure* closure = gjs_closure_new(cx, JS_GetObjectFunction(callback),
+                                        "variant_unpack_async", true);
+    GjsAutoUnref<GTask> task =
+        g_task_new(nullptr, nullptr, &GjsVariantDecode::on_decoded, closure);
+    g_task_set_task_data(task, decode, [](void* data) {
+        delete static_cast<GjsVariantDecode*>(data);
+    });
+    g_task_run_in_thread(task, &GjsVariantDecode::decode_in_thread);
+
+    args.rval().setUndefined();
+    return true;
+}
+
+// D-Bus proxy calls: the reply is unpacked directly into the JS values that
+// the Remote and Sync methods of D-Bus proxies return, without going through
+// call_finish() and Variant.deepUnpack() in JS.
+struct GjsDBusProxyCall {
+    GClosure* callback;
+
+    ~GjsDBusProxyCall() { g_closure_unref(callback); }
+
+    // callback(result, error, fdList), which is called once more with the
+    // exception if it throws, like the JS implementation does
+    static void on_ready(GObject* proxy, GAsyncResult* result, void* data) {
+        std::unique_ptr<GjsDBusProxyCall> self(
+            static_cast<GjsDBusProxyCall*>(data));
+        GError* error = nullptr;
+        GUnixFDList* fd_list = nullptr;
+#ifdef G_OS_UNIX
+        GjsAutoVariant reply = g_dbus_proxy_call_with_unix_fd_list_finish(
+            G_DBUS_PROXY(proxy), &fd_list, result, &error);
+#else
+        GjsAutoVariant reply =
+            g_dbus_proxy_call_finish(G_DBUS_PROXY(proxy), result, &error);
+#endif
+        GjsAutoUnref<GUnixFDList> out_fd_list(fd_list);
+        if (!gjs_closure_is_valid(self->callback)) {
+            g_clear_error(&error);
+            return;  // The context was destroyed in the meantime
+        }
+
+        JSContext* cx = gjs_closure_get_context(self->callback);
+        JSAutoRealm ar(
+            cx, JS_GetFunctionObject(gjs_closure_get_callable(self->callback)));
+
+        JS::RootedValueArray<3> args(cx);
+        args[1].setNull();
+        args[2].setNull();
+        if (reply && out_fd_list) {
+            JSObject* fd_list_obj = ObjectInstance::wrapper_from_gobject(
+                cx, G_OBJECT(out_fd_list.get()));
+            if (!fd_list_obj) {
+                gjs_log_exception(cx);
+                return;
+            }
+            args[2].setObject(*fd_list_obj);
+        }
+        if (reply) {
+            VariantUnpacker unpacker(cx, false);
+            if (unpacker.unpack(reply, true, args[0])) {
+                JS::RootedValue exc(cx);
+                if (gjs_closure_invoke(self->callback, nullptr, args, &exc,
+                                       true))
+                    return;
+                JS_ClearPendingException(cx);
+                args[1].set(exc);
+            } else if (!JS_GetPendingException(cx, args[1])) {
+                return;  // uncatchable
+            } else {
+                JS_ClearPendingException(cx);
+            }
+        } else {
+            JSObject* error_obj = ErrorInstance::object_for_c_ptr(cx, error);
+            g_error_free(error);
+            if (!error_obj) {
+                gjs_log_exception(cx);
+                return;
+            }
+            args[1].setObject(*error_obj);
+        }
+
+        JSObject* empty = JS::NewArrayObject(cx, 0);
+        if (!empty) {
+            gjs_log_exception(cx);
+            return;
+        }
+        args[0].setObject(*empty);
+        args[2].setNull();
+
+        JS::RootedValue ignored(cx);
+        if (!gjs_closure_invoke(self->callback, nullptr, args, &ignored,
+                                false)) {
+            // Exception already logged
+        }
+    }
+};
+
+bool gjs_dbus_proxy_call(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject proxy_obj(cx), params_obj(cx), cancellable_obj(cx),
+        callback(cx);
+    JS::UniqueChars method;
+    int32_t flags;
+    if (!gjs_parse_call_args(cx, "dbus_proxy_call", args, "osoi?o?o", "proxy",
+                             &proxy_obj, "method", &method, "parameters",
+                             &params_obj, "flags", &flags, "cancellable",
+                             &cancellable_obj, "callback", &callback))
+        return false;
+
+    GObject* proxy;
+    GObject* cancellable = nullptr;
+    if (!ObjectBase::typecheck(cx, proxy_obj, nullptr, G_TYPE_DBUS_PROXY) ||
+        !ObjectBase::to_c_ptr(cx, proxy_obj, &proxy) ||
+        !BoxedBase::typecheck(cx, params_obj, nullptr, G_TYPE_VARIANT))
+        return false;
+    if (cancellable_obj &&
+        (!ObjectBase::typecheck(cx, cancellable_obj, nullptr,
+                                G_TYPE_CANCELLABLE) ||
+         !ObjectBase::to_c_ptr(cx, cancellable_obj, &cancellable)))
+        return false;
+    GVariant* params = BoxedBase::to_c_ptr<GVariant>(cx, params_obj);
+    if (!params)
+        return false;
+
+    auto call_flags = static_cast<GDBusCallFlags>(flags);
+
+    // Sync: returns the unpacked reply, or throws the GError
+    if (!callback) {
+        GError* error = nullptr;
+        GjsAutoVariant reply = g_dbus_proxy_call_sync(
+            G_DBUS_PROXY(proxy), method.get(), params, call_flags, -1,
+            G_CANCELLABLE(cancellable), &error);
+        if (!reply)
+            return gjs_throw_gerror(cx, error);
+
+        VariantUnpacker unpacker(cx, false);
+        return unpacker.unpack(reply, true, args.rval());
+    }
+
+    if (!JS_ObjectIsFunction(callback)) {
+        gjs_throw(cx, "Callback must be a function");
+        return false;
+    }
+
+    auto* call = new GjsDBusProxyCall();
+    call->callback = gjs_closure_new(cx, JS_GetObjectFunction(callback),
+                                     "dbus_proxy_call", true);
+    // Ask for the reply's file descriptors too, since there may be some even
+    // if we didn't send any
+#ifdef G_OS_UNIX
+    g_dbus_proxy_call_with_unix_fd_list(
+        G_DBUS_PROXY(proxy), method.get(), params, call_flags, -1, nullptr,
+        G_CANCELLABLE(cancellable), &GjsDBusProxyCall::on_ready, call);
+#else
+    g_dbus_proxy_call(G_DBUS_PROXY(proxy), method.get(), params, call_flags,
+                      -1, G_CANCELLABLE(cancellable),
+                      &GjsDBusProxyCall::on_ready, call);
+#endif
+
+    args.rval().setUndefined();
+    return true;
+}
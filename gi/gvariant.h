@@ -0,0 +1,64 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef GI_GVARIANT_H_
+#define GI_GVARIANT_H_
+
+#include <config.h>
+
+#include <js/TypeDecls.h>
+
+#include "cjs/macros.h"
+
+// Native versions of the GLib.Variant packing and unpacking done in the GLib
+// overrides, exposed on the private imports._gi module. D-Bus services and
+// proxies go through these for every call, signal and property.
+
+// variant_pack(signature, value): Returns a new GLib.Variant, or undefined if
+// @value needs one of the type coercions (or would throw one of the errors)
+// that only the JS implementation knows about, in which case the caller falls
+// back to that.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_variant_pack(JSContext* cx, unsigned argc, JS::Value* vp);
+
+// variant_unpack(variant, deep, recursive): Same as _unpackVariant() in the
+// GLib overrides.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_variant_unpack(JSContext* cx, unsigned argc, JS::Value* vp);
+
+// variant_unpack_async(variant, recursive, callback): Unpacks deeply like
+// variant_unpack(), but walks the GVariant on a worker thread, so that a big
+// D-Bus reply only holds up the main thread while its JS values are created.
+// callback(error, value) is called on the main loop.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_variant_unpack_async(JSContext* cx, unsigned argc, JS::Value* vp);
+
+// dbus_proxy_call(proxy, method, parameters, flags, cancellable, callback):
+// Calls @method on a Gio.DBusProxy with the parameters GLib.Variant. The reply
+// is deep-unpacked in C++, and either returned, if @callback is null, or
+// passed to callback(result, error, fdList) on the main loop.
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_dbus_proxy_call(JSContext* cx, unsigned argc, JS::Value* vp);
+
+#endif  // GI_GVARIANT_H_
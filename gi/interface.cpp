@@ -28,6 +28,7 @@
 
 #include <js/Class.h>
 #include <js/TypeDecls.h>
+#include <mozilla/HashFunctions.h>  // for HashGeneric
 
 #include "gi/function.h"
 #include "gi/interface.h"
@@ -118,9 +119,20 @@ bool InterfacePrototype::has_instance_impl(JSContext* cx,
     g_assert(args.length() == 1);
     g_assert(args[0].isObject());
     JS::RootedObject instance(cx, &args[0].toObject());
-    bool isinstance = ObjectBase::typecheck(cx, instance, nullptr, m_gtype,
-                                            GjsTypecheckNoThrow());
-    args.rval().setBoolean(isinstance);
+    ObjectBase* priv = ObjectBase::for_js(cx, instance);
+    if (!priv || priv->is_prototype()) {
+        args.rval().setBoolean(false);
+        return true;
+    }
+
+    GType gtype = priv->gtype();
+    InstanceCheck& slot =
+        m_instance_checks[mozilla::HashGeneric(gtype) % INSTANCE_CHECK_SLOTS];
+    if (slot.gtype != gtype) {
+        slot.result = g_type_is_a(gtype, m_gtype);
+        slot.gtype = gtype;
+    }
+    args.rval().setBoolean(slot.result);
     return true;
 }
 
@@ -27,6 +27,10 @@
 
 #include <config.h>
 
+#include <stddef.h>  // for size_t
+
+#include <array>
+
 #include <girepository.h>
 #include <glib-object.h>
 #include <glib.h>
@@ -101,6 +105,17 @@ class InterfacePrototype
     // the GTypeInterface vtable wrapped by this JS object
     GTypeInterface* m_vtable;
 
+    // Direct-mapped memo of instance GType to whether it implements this
+    // interface, so that repeated instanceof checks in type-dispatching code
+    // don't walk the type hierarchy. The set of interfaces of a type can't
+    // change once it has instances, so entries never go stale.
+    struct InstanceCheck {
+        GType gtype = G_TYPE_INVALID;
+        bool result = false;
+    };
+    static constexpr size_t INSTANCE_CHECK_SLOTS = 8;
+    std::array<InstanceCheck, INSTANCE_CHECK_SLOTS> m_instance_checks;
+
     static constexpr InfoType::Tag info_type_tag = InfoType::Interface;
 
     explicit InterfacePrototype(GIInterfaceInfo* info, GType gtype);
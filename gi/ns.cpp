@@ -23,6 +23,10 @@
 
 #include <config.h>
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include <girepository.h>
 #include <glib.h>
 
@@ -45,14 +49,46 @@
 #include "cjs/mem-private.h"
 #include "util/log.h"
 
-typedef struct {
+struct Ns {
     char *gi_namespace;
-} Ns;
+    // Names of the namespace's infos in typelib order, and the index of each,
+    // so that looking a name up doesn't go through the repository every time.
+    // Built on first use.
+    std::vector<std::string> info_names;
+    std::unordered_map<std::string, int> info_index;
+    bool index_built : 1;
+    bool override_pending : 1;
+};
 
 extern struct JSClass gjs_ns_class;
 
 GJS_DEFINE_PRIV_FROM_JS(Ns, gjs_ns_class)
 
+static void ns_ensure_index(Ns* priv) {
+    if (priv->index_built)
+        return;
+
+    int n = g_irepository_get_n_infos(nullptr, priv->gi_namespace);
+    priv->info_names.reserve(n);
+    priv->info_index.reserve(n);
+    for (int k = 0; k < n; k++) {
+        GjsAutoBaseInfo info =
+            g_irepository_get_info(nullptr, priv->gi_namespace, k);
+        priv->info_names.emplace_back(info.name());
+        priv->info_index.emplace(info.name(), k);
+    }
+    priv->index_built = true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool ns_load_pending_override(JSContext* cx, JS::HandleObject obj,
+                                     Ns* priv) {
+    // Cleared first, since the override module looks up names in the
+    // namespace while it runs
+    priv->override_pending = false;
+    return gjs_load_namespace_override(cx, obj, priv->gi_namespace);
+}
+
 /* The *resolved out parameter, on success, should be false to indicate that id
  * was not resolved; and true if id was resolved. */
 GJS_JSAPI_RETURN_CONVENTION
@@ -95,8 +131,27 @@ ns_resolve(JSContext       *context,
         return true;  /* not resolved, but no error */
     }
 
-    GjsAutoBaseInfo info =
-        g_irepository_find_by_name(nullptr, priv->gi_namespace, name.get());
+    ns_ensure_index(priv);
+    auto entry = priv->info_index.find(name.get());
+    GjsAutoBaseInfo info;
+    if (entry != priv->info_index.end())
+        info = g_irepository_get_info(nullptr, priv->gi_namespace,
+                                      entry->second);
+
+    // Names that aren't in the typelib may be defined by the override
+    if (priv->override_pending &&
+        (!info || info.type() != GI_INFO_TYPE_FUNCTION)) {
+        if (!ns_load_pending_override(context, obj, priv))
+            return false;
+
+        if (!JS_AlreadyHasOwnPropertyById(context, obj, id, &defined))
+            return false;
+        if (defined) {
+            *resolved = true;
+            return true;
+        }
+    }
+
     if (!info) {
         *resolved = false; /* No property defined, but no error either */
         return true;
@@ -112,6 +167,9 @@ ns_resolve(JSContext       *context,
         return false;
     }
 
+    if (defined)
+        gjs_typelib_stats_info_resolved(priv->gi_namespace);
+
     /* we defined the property in this object? */
     *resolved = defined;
     return true;
@@ -127,18 +185,17 @@ static bool ns_new_enumerate(JSContext* cx, JS::HandleObject obj,
         return true;
     }
 
-    int n = g_irepository_get_n_infos(nullptr, priv->gi_namespace);
-    if (!properties.reserve(properties.length() + n)) {
+    if (priv->override_pending && !ns_load_pending_override(cx, obj, priv))
+        return false;
+
+    ns_ensure_index(priv);
+    if (!properties.reserve(properties.length() + priv->info_names.size())) {
         JS_ReportOutOfMemory(cx);
         return false;
     }
 
-    for (int k = 0; k < n; k++) {
-        GjsAutoBaseInfo info =
-            g_irepository_get_info(nullptr, priv->gi_namespace, k);
-        const char* name = info.name();
-
-        jsid id = gjs_intern_string_to_id(cx, name);
+    for (const std::string& name : priv->info_names) {
+        jsid id = gjs_intern_string_to_id(cx, name.c_str());
         if (id == JSID_VOID)
             return false;
         properties.infallibleAppend(id);
@@ -176,7 +233,7 @@ static void ns_finalize(JSFreeOp*, JSObject* obj) {
         g_free(priv->gi_namespace);
 
     GJS_DEC_COUNTER(ns);
-    g_slice_free(Ns, priv);
+    delete priv;
 }
 
 /* The bizarre thing about this vtable is that it applies to both
@@ -212,10 +269,8 @@ static JSFunctionSpec *gjs_ns_static_funcs = nullptr;
 GJS_DEFINE_PROTO_FUNCS(ns)
 
 GJS_JSAPI_RETURN_CONVENTION
-static JSObject*
-ns_new(JSContext    *context,
-       const char   *ns_name)
-{
+static JSObject* ns_new(JSContext* context, const char* ns_name,
+                        bool override_pending) {
     Ns *priv;
 
     JS::RootedObject proto(context);
@@ -227,7 +282,7 @@ ns_new(JSContext    *context,
     if (!ns)
         return nullptr;
 
-    priv = g_slice_new0(Ns);
+    priv = new Ns();
 
     GJS_INC_COUNTER(ns);
 
@@ -239,12 +294,11 @@ ns_new(JSContext    *context,
 
     priv = priv_from_js(context, ns);
     priv->gi_namespace = g_strdup(ns_name);
+    priv->override_pending = override_pending;
     return ns;
 }
 
-JSObject*
-gjs_create_ns(JSContext    *context,
-              const char   *ns_name)
-{
-    return ns_new(context, ns_name);
+JSObject* gjs_create_ns(JSContext* context, const char* ns_name,
+                        bool override_pending) {
+    return ns_new(context, ns_name, override_pending);
 }
@@ -29,8 +29,10 @@
 class JSObject;
 struct JSContext;
 
+// If override_pending is true, the namespace's override module is evaluated
+// when the first info that is not a plain function is looked up in it.
 GJS_JSAPI_RETURN_CONVENTION
-JSObject* gjs_create_ns(JSContext    *context,
-                        const char   *ns_name);
+JSObject* gjs_create_ns(JSContext* context, const char* ns_name,
+                        bool override_pending = false);
 
 #endif  // GI_NS_H_
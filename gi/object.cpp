@@ -25,13 +25,16 @@
 #include <config.h>
 
 #include <stdint.h>
+#include <stdio.h>   // for fprintf
 #include <string.h>  // for memset, strcmp
 
-#include <algorithm>  // for find
+#include <algorithm>   // for sort
 #include <functional>  // for mem_fn
 #include <string>
 #include <tuple>        // for tie
 #include <type_traits>  // for remove_reference<>::type
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>      // for move
 #include <vector>
 
@@ -40,13 +43,14 @@
 #include <glib-object.h>
 #include <glib.h>
 
+#include <js/Array.h>  // for GetArrayLength, IsArrayObject
 #include <js/CallArgs.h>
 #include <js/CharacterEncoding.h>
 #include <js/Class.h>
-#include <js/GCAPI.h>               // for JS_AddWeakPointerCompartmentCallback
 #include <js/GCVector.h>            // for MutableWrappedPtrOperations
 #include <js/MemoryFunctions.h>     // for AddAssociatedMemory, RemoveAssoci...
 #include <js/PropertyDescriptor.h>  // for JSPROP_PERMANENT, JSPROP_READONLY
+#include <js/SweepingAPI.h>         // for WeakCache
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
 #include <js/Value.h>
@@ -87,13 +91,14 @@ class JSTracer;
 #if defined(__x86_64__) && defined(__clang__)
 /* This isn't meant to be comprehensive, but should trip on at least one CI job
  * if sizeof(ObjectInstance) is increased. */
-static_assert(sizeof(ObjectInstance) <= 88,
+static_assert(sizeof(ObjectInstance) <= 120,
               "Think very hard before increasing the size of ObjectInstance. "
               "There can be tens of thousands of them alive in a typical "
               "gnome-shell run.");
 #endif  // x86-64 clang
 
-bool ObjectInstance::s_weak_pointer_callback = false;
+JS::WeakCache<ObjectInstance::WeakWrappers>* ObjectInstance::s_weak_wrappers =
+    nullptr;
 ObjectInstance *ObjectInstance::wrapped_gobject_list = nullptr;
 
 // clang-format off
@@ -178,6 +183,33 @@ void ObjectInstance::unlink(void) {
     if (wrapped_gobject_list == this)
         wrapped_gobject_list = m_instance_link.next();
     m_instance_link.unlink();
+    weak_unlink();
+}
+
+void ObjectInstance::weak_link(void) {
+    if (m_weak_index != WEAK_INDEX_NONE)
+        return;
+    std::vector<ObjectInstance*>& instances = s_weak_wrappers->get().instances;
+    m_weak_index = instances.size();
+    instances.push_back(this);
+}
+
+// Removes this instance from s_weak_wrappers by moving the last element into
+// its slot, so the order of the vector is not preserved
+void ObjectInstance::weak_unlink(void) {
+    if (m_weak_index == WEAK_INDEX_NONE)
+        return;
+    // The set is already gone during the context's last GC
+    if (s_weak_wrappers) {
+        std::vector<ObjectInstance*>& instances =
+            s_weak_wrappers->get().instances;
+        g_assert(instances[m_weak_index] == this);
+        ObjectInstance* last = instances.back();
+        instances[m_weak_index] = last;
+        last->m_weak_index = m_weak_index;
+        instances.pop_back();
+    }
+    m_weak_index = WEAK_INDEX_NONE;
 }
 
 const void* ObjectBase::jsobj_addr(void) const {
@@ -251,18 +283,65 @@ void ObjectPrototype::set_type_qdata(void) {
     g_type_set_qdata(m_gtype, gjs_object_priv_quark(), this);
 }
 
+// Free list of ObjectInstance private structs; only used on the main thread,
+// since ObjectBase objects are finalized in the foreground
+static constexpr size_t MAX_FREE_INSTANCES = 256;
+static std::vector<void*> free_instances;
+
+void* ObjectInstance::allocate_instance() {
+    if (free_instances.empty())
+        return g_slice_alloc0(sizeof(ObjectInstance));
+
+    void* mem = free_instances.back();
+    free_instances.pop_back();
+    memset(mem, 0, sizeof(ObjectInstance));
+    return mem;
+}
+
+void ObjectInstance::free_instance(void* mem) {
+    if (free_instances.size() < MAX_FREE_INSTANCES) {
+        free_instances.push_back(mem);
+        return;
+    }
+    g_slice_free1(sizeof(ObjectInstance), mem);
+}
+
+// Small direct-mapped cache of the wrappers most recently looked up, so that
+// wrapper_from_gobject() doesn't need to look up the qdata of a GObject that
+// was just seen. An entry is only valid while the GObject's qdata points to
+// the same ObjectInstance.
+struct RecentWrapper {
+    GObject* gobj;
+    ObjectInstance* priv;
+};
+static constexpr size_t N_RECENT_WRAPPERS = 64;
+static RecentWrapper recent_wrappers[N_RECENT_WRAPPERS];
+
+[[nodiscard]] static RecentWrapper& recent_wrapper_slot(const GObject* gobj) {
+    auto addr = reinterpret_cast<uintptr_t>(gobj);
+    return recent_wrappers[((addr >> 4) ^ (addr >> 10)) % N_RECENT_WRAPPERS];
+}
+
 void
 ObjectInstance::set_object_qdata(void)
 {
     g_object_set_qdata(m_ptr, gjs_object_priv_quark(), this);
+    recent_wrapper_slot(m_ptr) = {m_ptr, this};
 }
 
 void
 ObjectInstance::unset_object_qdata(void)
 {
+    forget_recent_wrapper();
     g_object_set_qdata(m_ptr, gjs_object_priv_quark(), nullptr);
 }
 
+void ObjectInstance::forget_recent_wrapper(void) {
+    RecentWrapper& recent = recent_wrapper_slot(m_ptr);
+    if (recent.priv == this)
+        recent = {nullptr, nullptr};
+}
+
 GParamSpec* ObjectPrototype::find_param_spec_from_id(JSContext* cx,
                                                      JS::HandleString key) {
     /* First check for the ID in the cache */
@@ -274,7 +353,9 @@ GParamSpec* ObjectPrototype::find_param_spec_from_id(JSContext* cx,
     if (!js_prop_name)
         return nullptr;
 
-    GjsAutoChar gname = gjs_hyphen_from_camel(js_prop_name.get());
+    GjsAutoChar storage;
+    const char* gname =
+        gjs_canonical_property_name(js_prop_name.get(), &storage);
     GjsAutoTypeClass<GObjectClass> gobj_class(m_gtype);
     GParamSpec* pspec = g_object_class_find_property(gobj_class, gname);
     GjsAutoParam param_spec(pspec, GjsAutoTakeOwnership());
@@ -336,7 +417,18 @@ bool ObjectBase::prop_getter(JSContext* cx, unsigned argc, JS::Value* vp) {
         /* Ignore silently; note that this is different from what we do for
          * boxed types, for historical reasons */
 
-    return priv->to_instance()->prop_getter_impl(cx, name, args.rval());
+    ObjectInstance* instance = priv->to_instance();
+
+    // Fast path: the param spec was stored in the accessor when the property
+    // was resolved, so we don't have to look it up by name again
+    JS::Value cached = gjs_dynamic_property_cache_slot(&args.callee());
+    if (!cached.isUndefined()) {
+        auto* pspec = static_cast<GParamSpec*>(cached.toPrivate());
+        if (G_LIKELY(g_type_is_a(instance->gtype(), pspec->owner_type)))
+            return instance->prop_getter_impl(cx, pspec, args.rval());
+    }
+
+    return instance->prop_getter_impl(cx, name, args.rval());
 }
 
 bool ObjectInstance::prop_getter_impl(JSContext* cx, JS::HandleString name,
@@ -344,14 +436,20 @@ bool ObjectInstance::prop_getter_impl(JSContext* cx, JS::HandleString name,
     if (!check_gobject_disposed("get any property from"))
         return true;
 
-    GValue gvalue = { 0, };
-
     ObjectPrototype* proto_priv = get_prototype();
     GParamSpec *param = proto_priv->find_param_spec_from_id(cx, name);
 
     /* This is guaranteed because we resolved the property before */
     g_assert(param);
 
+    return prop_getter_impl(cx, param, rval);
+}
+
+bool ObjectInstance::prop_getter_impl(JSContext* cx, GParamSpec* param,
+                                      JS::MutableHandleValue rval) {
+    if (!check_gobject_disposed("get any property from"))
+        return true;
+
     /* Do not fetch JS overridden properties from GObject, to avoid
      * infinite recursion. */
     if (g_param_spec_get_qdata(param, ObjectBase::custom_property_quark()))
@@ -365,15 +463,56 @@ bool ObjectInstance::prop_getter_impl(JSContext* cx, JS::HandleString name,
     gjs_debug_jsprop(GJS_DEBUG_GOBJECT, "Accessing GObject property %s",
                      param->name);
 
+    GValue gvalue = G_VALUE_INIT;
     g_value_init(&gvalue, G_PARAM_SPEC_VALUE_TYPE(param));
     g_object_get_property(m_ptr, param->name, &gvalue);
-    if (!gjs_value_from_g_value(cx, rval, &gvalue)) {
-        g_value_unset(&gvalue);
-        return false;
+
+    // Convert the most common fundamental types directly, without going
+    // through the full type switch in gjs_value_from_g_value()
+    bool ok = true;
+    switch (G_TYPE_FUNDAMENTAL(G_VALUE_TYPE(&gvalue))) {
+        case G_TYPE_BOOLEAN:
+            rval.setBoolean(!!g_value_get_boolean(&gvalue));
+            break;
+        case G_TYPE_INT:
+            rval.setInt32(g_value_get_int(&gvalue));
+            break;
+        case G_TYPE_UINT:
+            rval.setNumber(g_value_get_uint(&gvalue));
+            break;
+        case G_TYPE_DOUBLE:
+            rval.setNumber(g_value_get_double(&gvalue));
+            break;
+        case G_TYPE_FLOAT:
+            rval.setNumber(static_cast<double>(g_value_get_float(&gvalue)));
+            break;
+        case G_TYPE_STRING: {
+            const char* str = g_value_get_string(&gvalue);
+            if (!str)
+                rval.setNull();
+            else
+                ok = gjs_string_from_utf8(cx, str, rval);
+            break;
+        }
+        case G_TYPE_OBJECT: {
+            auto* gobj = static_cast<GObject*>(g_value_get_object(&gvalue));
+            if (!gobj) {
+                rval.setNull();
+                break;
+            }
+            JSObject* wrapper = ObjectInstance::wrapper_from_gobject(cx, gobj);
+            if (wrapper)
+                rval.setObject(*wrapper);
+            else
+                ok = false;
+            break;
+        }
+        default:
+            ok = gjs_value_from_g_value(cx, rval, &gvalue);
     }
-    g_value_unset(&gvalue);
 
-    return true;
+    g_value_unset(&gvalue);
+    return ok;
 }
 
 [[nodiscard]] static GjsAutoFieldInfo lookup_field_info(GIObjectInfo* info,
@@ -467,7 +606,16 @@ bool ObjectBase::prop_setter(JSContext* cx, unsigned argc, JS::Value* vp) {
     /* Clear the JS stored value, to avoid keeping additional references */
     args.rval().setUndefined();
 
-    return priv->to_instance()->prop_setter_impl(cx, name, args[0]);
+    ObjectInstance* instance = priv->to_instance();
+
+    JS::Value cached = gjs_dynamic_property_cache_slot(&args.callee());
+    if (!cached.isUndefined()) {
+        auto* pspec = static_cast<GParamSpec*>(cached.toPrivate());
+        if (G_LIKELY(g_type_is_a(instance->gtype(), pspec->owner_type)))
+            return instance->prop_setter_impl(cx, pspec, args[0]);
+    }
+
+    return instance->prop_setter_impl(cx, name, args[0]);
 }
 
 bool ObjectInstance::prop_setter_impl(JSContext* cx, JS::HandleString name,
@@ -480,6 +628,48 @@ bool ObjectInstance::prop_setter_impl(JSContext* cx, JS::HandleString name,
     if (!param_spec)
         return false;
 
+    return prop_setter_impl(cx, param_spec, value);
+}
+
+// Fills @gvalue directly if @value already has the JS type corresponding to
+// the GValue's fundamental type, which is the common case. Returns false if
+// the generic conversion is needed.
+[[nodiscard]] static bool fill_g_value_fast(JS::HandleValue value,
+                                            GValue* gvalue) {
+    switch (G_TYPE_FUNDAMENTAL(G_VALUE_TYPE(gvalue))) {
+        case G_TYPE_BOOLEAN:
+            g_value_set_boolean(gvalue, JS::ToBoolean(value));
+            return true;
+        case G_TYPE_INT:
+            if (!value.isInt32())
+                return false;
+            g_value_set_int(gvalue, value.toInt32());
+            return true;
+        case G_TYPE_UINT:
+            if (!value.isInt32() || value.toInt32() < 0)
+                return false;
+            g_value_set_uint(gvalue, value.toInt32());
+            return true;
+        case G_TYPE_DOUBLE:
+            if (!value.isNumber())
+                return false;
+            g_value_set_double(gvalue, value.toNumber());
+            return true;
+        case G_TYPE_FLOAT:
+            if (!value.isNumber())
+                return false;
+            g_value_set_float(gvalue, value.toNumber());
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool ObjectInstance::prop_setter_impl(JSContext* cx, GParamSpec* param_spec,
+                                      JS::HandleValue value) {
+    if (!check_gobject_disposed("set any property on"))
+        return true;
+
     /* Do not set JS overridden properties through GObject, to avoid
      * infinite recursion (unless constructing) */
     if (g_param_spec_get_qdata(param_spec, ObjectBase::custom_property_quark()))
@@ -497,7 +687,8 @@ bool ObjectInstance::prop_setter_impl(JSContext* cx, JS::HandleString name,
 
     GValue gvalue = G_VALUE_INIT;
     g_value_init(&gvalue, G_PARAM_SPEC_VALUE_TYPE(param_spec));
-    if (!gjs_value_to_g_value(cx, value, &gvalue)) {
+    if (!fill_g_value_fast(value, &gvalue) &&
+        !gjs_value_to_g_value(cx, value, &gvalue)) {
         g_value_unset(&gvalue);
         return false;
     }
@@ -597,17 +788,6 @@ bool ObjectPrototype::is_vfunc_unchanged(GIVFuncInfo* info) {
     return vfunc;
 }
 
-/* Taken from GLib */
-static void canonicalize_key(const GjsAutoChar& key) {
-    for (char* p = key.get(); *p != 0; p++) {
-        char c = *p;
-
-        if (c != '-' && (c < '0' || c > '9') && (c < 'A' || c > 'Z') &&
-            (c < 'a' || c > 'z'))
-            *p = '-';
-    }
-}
-
 /* @name must already be canonicalized */
 [[nodiscard]] static bool is_ginterface_property_name(GIInterfaceInfo* info,
                                                       const char* name) {
@@ -641,10 +821,32 @@ bool ObjectPrototype::lazy_define_gobject_property(JSContext* cx,
 
     debug_jsprop("Defining lazy GObject property", id, obj);
 
-    JS::RootedValue private_id(cx, JS::StringValue(JSID_TO_STRING(id)));
+    JS::RootedString key(cx, JSID_TO_STRING(id));
+    JS::RootedValue private_id(cx, JS::StringValue(key));
+
+    // Store the param spec in the accessors, so that the getter does not need
+    // to look it up by name on each access. The property cache keeps a
+    // reference to it for as long as this prototype is alive.
+    JS::RootedValue cached_pspec(cx);
+    GjsAutoChar storage;
+    const char* canonical_name = gjs_canonical_property_name(name, &storage);
+    GjsAutoTypeClass<GObjectClass> oclass(m_gtype);
+    GParamSpec* pspec = g_object_class_find_property(oclass, canonical_name);
+    if (pspec) {
+        auto entry = m_property_cache.lookupForAdd(key);
+        if (!entry) {
+            GjsAutoParam owned(pspec, GjsAutoTakeOwnership());
+            if (!m_property_cache.add(entry, key, std::move(owned))) {
+                JS_ReportOutOfMemory(cx);
+                return false;
+            }
+        }
+        cached_pspec.set(JS::PrivateValue(entry->value().get()));
+    }
+
     if (!gjs_define_property_dynamic(
             cx, obj, name, "gobject_prop", &ObjectBase::prop_getter,
-            &ObjectBase::prop_setter, private_id,
+            &ObjectBase::prop_setter, private_id, cached_pspec,
             // Make property configurable so that interface properties can be
             // overridden by GObject.ParamSpec.override in the class that
             // implements them
@@ -662,13 +864,12 @@ bool ObjectPrototype::resolve_no_info(JSContext* cx, JS::HandleObject obj,
     guint n_interfaces;
     guint i;
 
-    GjsAutoChar canonical_name;
+    GjsAutoChar storage;
+    const char* canonical_name = nullptr;
     if (resolve_props == ConsiderMethodsAndProperties) {
         // Optimization: GObject property names must start with a letter
-        if (g_ascii_isalpha(name[0])) {
-            canonical_name = gjs_hyphen_from_camel(name);
-            canonicalize_key(canonical_name);
-        }
+        if (g_ascii_isalpha(name[0]))
+            canonical_name = gjs_canonical_property_name(name, &storage);
     }
 
     GjsAutoFree<GType> interfaces = g_type_interfaces(m_gtype, &n_interfaces);
@@ -742,8 +943,8 @@ bool ObjectPrototype::resolve_no_info(JSContext* cx, JS::HandleObject obj,
     int n_ifaces = g_object_info_get_n_interfaces(info);
     int ix;
 
-    GjsAutoChar canonical_name = gjs_hyphen_from_camel(name);
-    canonicalize_key(canonical_name);
+    GjsAutoChar storage;
+    const char* canonical_name = gjs_canonical_property_name(name, &storage);
 
     for (ix = 0; ix < n_props; ix++) {
         GjsAutoPropertyInfo prop_info = g_object_info_get_property(info, ix);
@@ -965,7 +1166,8 @@ bool ObjectPrototype::new_enumerate_impl(JSContext* cx, JS::HandleObject,
             GjsAutoPropertyInfo prop_info =
                 g_interface_info_get_property(iface_info, i);
 
-            GjsAutoChar js_name = gjs_hyphen_to_underscore(prop_info.name());
+            const char* js_name =
+                gjs_underscore_property_name(prop_info.name());
 
             jsid id = gjs_intern_string_to_id(cx, js_name);
             if (id == JSID_VOID)
@@ -1004,7 +1206,8 @@ bool ObjectPrototype::new_enumerate_impl(JSContext* cx, JS::HandleObject,
             GjsAutoPropertyInfo prop_info =
                 g_object_info_get_property(info(), i);
 
-            GjsAutoChar js_name = gjs_hyphen_to_underscore(prop_info.name());
+            const char* js_name =
+                gjs_underscore_property_name(prop_info.name());
             jsid id = gjs_intern_string_to_id(cx, js_name);
             if (id == JSID_VOID)
                 return false;
@@ -1146,8 +1349,7 @@ ObjectInstance::toggle_down(void)
      */
     if (wrapper_is_rooted()) {
         debug_lifecycle("Unrooting wrapper");
-        GjsContextPrivate* gjs = GjsContextPrivate::from_current_context();
-        switch_to_unrooted(gjs->context());
+        switch_to_unrooted(m_gjs->context());
 
         /* During a GC, the collector asks each object which other
          * objects that it wants to hold on to so if there's an entire
@@ -1165,8 +1367,8 @@ ObjectInstance::toggle_down(void)
          * always queue a garbage collection when a toggle reference goes
          * down.
          */
-        if (!gjs->destroying())
-            gjs->schedule_gc();
+        if (!m_gjs->destroying())
+            m_gjs->schedule_gc();
     }
 }
 
@@ -1186,11 +1388,8 @@ ObjectInstance::toggle_up(void)
      * in case the wrapper has data in it that the app cares about
      */
     if (!wrapper_is_rooted()) {
-        // FIXME: thread the context through somehow. Maybe by looking up the
-        // realm that obj belongs to.
         debug_lifecycle("Rooting wrapper");
-        auto* cx = GjsContextPrivate::from_current_context()->context();
-        switch_to_rooted(cx);
+        switch_to_rooted(m_gjs->context());
     }
 }
 
@@ -1198,24 +1397,29 @@ static void
 toggle_handler(GObject               *gobj,
                ToggleQueue::Direction direction)
 {
+    ObjectInstance* instance = ObjectInstance::for_gobject(gobj);
     switch (direction) {
         case ToggleQueue::UP:
-            ObjectInstance::for_gobject(gobj)->toggle_up();
+            TRACE(GJS_TOGGLE_UP(instance, gobj));
+            instance->toggle_up();
             break;
         case ToggleQueue::DOWN:
-            ObjectInstance::for_gobject(gobj)->toggle_down();
+            TRACE(GJS_TOGGLE_DOWN(instance, gobj));
+            instance->toggle_down();
             break;
         default:
             g_assert_not_reached();
     }
 }
 
-static void wrapped_gobj_toggle_notify(void*, GObject* gobj,
+// The toggle ref's data is the context owning the wrapper, which may not be the
+// current context of the thread the toggle happens on
+static void wrapped_gobj_toggle_notify(void* data, GObject* gobj,
                                        gboolean is_last_ref) {
     bool is_main_thread;
     bool toggle_up_queued, toggle_down_queued;
 
-    GjsContextPrivate* gjs = GjsContextPrivate::from_current_context();
+    auto* gjs = static_cast<GjsContextPrivate*>(data);
     if (gjs->destroying()) {
         /* Do nothing here - we're in the process of disassociating
          * the objects.
@@ -1253,7 +1457,7 @@ static void wrapped_gobj_toggle_notify(void*, GObject* gobj,
      */
     is_main_thread = gjs->is_owner_thread();
 
-    auto& toggle_queue = ToggleQueue::get_default();
+    ToggleQueue& toggle_queue = gjs->toggle_queue();
     std::tie(toggle_down_queued, toggle_up_queued) = toggle_queue.is_queued(gobj);
 
     if (is_last_ref) {
@@ -1298,8 +1502,10 @@ void
 ObjectInstance::release_native_object(void)
 {
     discard_wrapper();
+    forget_recent_wrapper();
+    // Wrappers are only released on the thread of the context owning them
     if (m_uses_toggle_ref)
-        g_object_remove_toggle_ref(m_ptr, wrapped_gobj_toggle_notify, nullptr);
+        g_object_remove_toggle_ref(m_ptr, wrapped_gobj_toggle_notify, m_gjs);
     else
         g_object_unref(m_ptr);
     m_ptr = nullptr;
@@ -1308,39 +1514,131 @@ ObjectInstance::release_native_object(void)
 /* At shutdown, we need to ensure we've cleared the context of any
  * pending toggle references.
  */
-void
-gjs_object_clear_toggles(void)
-{
-    auto& toggle_queue = ToggleQueue::get_default();
+void gjs_object_clear_toggles(GjsContextPrivate* gjs) {
+    ToggleQueue& toggle_queue = gjs->toggle_queue();
     while (toggle_queue.handle_toggle(toggle_handler))
         ;
 }
 
-void
-gjs_object_shutdown_toggle_queue(void)
-{
-    auto& toggle_queue = ToggleQueue::get_default();
-    toggle_queue.shutdown();
+void gjs_object_shutdown_toggle_queue(GjsContextPrivate* gjs) {
+    gjs->toggle_queue().shutdown();
+}
+
+/*
+ * ObjectInstance::dump_wrapper_stats:
+ *
+ * Writes a report of the GObjects that have JS wrappers, grouped by GType, for
+ * tracking down memory growth. Rooted wrappers are the ones kept alive from C
+ * through their toggle reference; their GObject can't be freed until C code
+ * drops its references, and all the JS reachable from their closures stays
+ * alive with them. For each type, the rooted wrapper with the most references
+ * is shown as a sample of what is being retained.
+ */
+void ObjectInstance::dump_wrapper_stats(FILE* fp) {
+    struct TypeStats {
+        GType gtype;
+        size_t wrappers = 0;
+        size_t rooted = 0;
+        size_t closures = 0;
+        size_t rooted_closures = 0;
+        size_t vfuncs = 0;
+        ObjectInstance* sample = nullptr;
+        unsigned sample_refcount = 0;
+    };
+    std::unordered_map<GType, TypeStats> by_type;
+    size_t total_wrappers = 0, total_rooted = 0;
+
+    iterate_wrapped_gobjects([&](ObjectInstance* instance) {
+        TypeStats& stats = by_type[instance->gtype()];
+        stats.gtype = instance->gtype();
+        stats.wrappers++;
+        stats.closures += instance->m_closures.size();
+        stats.vfuncs = instance->get_prototype()->num_vfuncs();
+        total_wrappers++;
+
+        if (!instance->wrapper_is_rooted())
+            return;
+        stats.rooted++;
+        stats.rooted_closures += instance->m_closures.size();
+        total_rooted++;
+        unsigned refcount =
+            instance->m_ptr ? g_atomic_int_get(&instance->m_ptr->ref_count) : 0;
+        if (!stats.sample || refcount > stats.sample_refcount) {
+            stats.sample = instance;
+            stats.sample_refcount = refcount;
+        }
+    });
+
+    std::vector<const TypeStats*> sorted;
+    sorted.reserve(by_type.size());
+    for (const auto& it : by_type)
+        sorted.push_back(&it.second);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const TypeStats* a, const TypeStats* b) {
+                  if (a->rooted != b->rooted)
+                      return a->rooted > b->rooted;
+                  return a->wrappers > b->wrappers;
+              });
+
+    fprintf(fp, "%10s %10s %10s %10s  %s\n", "rooted", "wrappers",
+            "closures", "vfuncs", "type");
+    for (const TypeStats* stats : sorted) {
+        fprintf(fp, "%10zu %10zu %10zu %10zu  %s\n", stats->rooted,
+                stats->wrappers, stats->closures, stats->vfuncs,
+                g_type_name(stats->gtype));
+        if (!stats->sample)
+            continue;
+
+        ObjectInstance* sample = stats->sample;
+        fprintf(fp,
+                "%45s e.g. %p: %u references, %zu held by C code, rooting "
+                "wrapper %p with %zu closures%s\n",
+                "", sample->m_ptr, stats->sample_refcount,
+                // The toggle reference is the wrapper's
+                stats->sample_refcount ? stats->sample_refcount - 1 : 0,
+                sample->m_wrapper.debug_addr(), sample->m_closures.size(),
+                sample->m_gobj_disposed ? " (disposed)" : "");
+        if (stats->rooted_closures)
+            fprintf(fp, "%45s %zu closures on rooted wrappers\n", "",
+                    stats->rooted_closures);
+    }
+    fprintf(fp, "%zu wrappers, %zu rooted, %zu types\n", total_wrappers,
+            total_rooted, by_type.size());
+}
+
+void gjs_object_dump_wrapper_stats(FILE* fp) {
+    ObjectInstance::dump_wrapper_stats(fp);
 }
 
 /*
  * ObjectInstance::prepare_shutdown:
  *
- * Called when the #GjsContext is disposed, in order to release all GC roots of
- * JSObjects that are held by GObjects.
+ * Called when a #GjsContext is disposed, in order to release all GC roots of
+ * its JSObjects that are held by GObjects. Wrappers owned by other contexts are
+ * left alone.
  */
-void ObjectInstance::prepare_shutdown(void) {
+void ObjectInstance::prepare_shutdown(GjsContextPrivate* gjs) {
     /* We iterate over all of the objects, breaking the JS <-> C
      * association.  We avoid the potential recursion implied in:
      *   toggle ref removal -> gobj dispose -> toggle ref notify
      * by emptying the toggle queue earlier in the shutdown sequence. */
     ObjectInstance::remove_wrapped_gobjects_if(
-        std::mem_fn(&ObjectInstance::wrapper_is_rooted),
+        [gjs](ObjectInstance* instance) {
+            return instance->m_gjs == gjs && instance->wrapper_is_rooted();
+        },
         std::mem_fn(&ObjectInstance::release_native_object));
+
+    // The weak wrapper set is registered with a runtime, so it must go before
+    // the runtime does. It is shared by all contexts, and goes with the primary
+    // one.
+    if (gjs->is_primary()) {
+        delete s_weak_wrappers;
+        s_weak_wrappers = nullptr;
+    }
 }
 
 ObjectInstance::ObjectInstance(JSContext* cx, JS::HandleObject object)
-    : GIWrapperInstance(cx, object) {
+    : GIWrapperInstance(cx, object), m_gjs(GjsContextPrivate::from_cx(cx)) {
     GTypeQuery query;
     type_query_dynamic_safe(&query);
     if (G_LIKELY(query.type))
@@ -1350,40 +1648,78 @@ ObjectInstance::ObjectInstance(JSContext* cx, JS::HandleObject object)
     GJS_INC_COUNTER(object_instance);
 }
 
+/* GObjects whose memory is mostly outside the instance struct, and so would be
+ * invisible to the JS engine's GC heuristics. GdkPixbuf is not a dependency,
+ * so it is recognized by name; it is registered by the time a prototype for it
+ * or a subclass is created. */
+static bool gtype_has_payload(GType gtype) {
+    GType pixbuf_type = g_type_from_name("GdkPixbuf");
+    return pixbuf_type != G_TYPE_INVALID && g_type_is_a(gtype, pixbuf_type);
+}
+
 ObjectPrototype::ObjectPrototype(GIObjectInfo* info, GType gtype)
-    : GIWrapperPrototype(info, gtype) {
+    : GIWrapperPrototype(info, gtype),
+      m_has_payload(gtype_has_payload(gtype)) {
     g_type_class_ref(gtype);
 
     GJS_INC_COUNTER(object_prototype);
 }
 
 /*
- * ObjectInstance::update_heap_wrapper_weak_pointers:
+ * ObjectInstance::WeakWrappers::sweep:
  *
- * Private callback, called after the JS engine finishes garbage collection, and
- * notifies when weak pointers need to be either moved or swept.
+ * Called by the JS engine while sweeping, possibly on a helper thread, to
+ * update the weak pointers that were moved and drop the ones that are about to
+ * be finalized. Must not call into GObject or JS.
  */
-void ObjectInstance::update_heap_wrapper_weak_pointers(JSContext*,
-                                                       JS::Compartment*,
-                                                       void*) {
-    gjs_debug_lifecycle(GJS_DEBUG_GOBJECT, "Weak pointer update callback, "
-                        "%zu wrapped GObject(s) to examine",
-                        ObjectInstance::num_wrapped_gobjects());
+void ObjectInstance::WeakWrappers::sweep() {
+    // Rooted wrappers can't have been finalized, so only the weak ones need to
+    // be looked at
+    for (size_t ix = 0; ix < instances.size();) {
+        ObjectInstance* priv = instances[ix];
+        if (priv->weak_pointer_was_finalized()) {
+            priv->m_weak_swept = true;
+            ObjectInstance* last = instances.back();
+            instances[ix] = last;
+            last->m_weak_index = ix;
+            instances.pop_back();
+            priv->m_weak_index = WEAK_INDEX_NONE;
+        } else {
+            ix++;
+        }
+    }
+}
 
-    ObjectInstance::remove_wrapped_gobjects_if(
-        std::mem_fn(&ObjectInstance::weak_pointer_was_finalized),
-        std::mem_fn(&ObjectInstance::disassociate_js_gobject));
+/*
+ * ObjectInstance::disassociate_if_swept:
+ *
+ * If the last GC found this instance's JS wrapper about to be finalized,
+ * breaks the association with the GObject so that it can get a new wrapper,
+ * and returns true. The instance itself lives until the old wrapper's
+ * finalizer runs.
+ *
+ * Until then, for_gobject() keeps returning the swept instance, whose wrapper
+ * is null; toggles on it do nothing, since there is no wrapper to root or
+ * unroot, and the toggle ref goes away with the instance. Only the callers
+ * that hand out a wrapper disassociate it early.
+ */
+bool ObjectInstance::disassociate_if_swept() {
+    if (G_LIKELY(!m_weak_swept))
+        return false;
+
+    m_weak_swept = false;
+    unlink();
+    if (m_ptr)
+        disassociate_js_gobject();
+    return true;
 }
 
 bool
 ObjectInstance::weak_pointer_was_finalized(void)
 {
     if (has_wrapper() && !wrapper_is_rooted() && update_after_gc()) {
-        /* Ouch, the JS object is dead already. Disassociate the
-         * GObject and hope the GObject dies too. (Remove it from
-         * the weak pointer list first, since the disassociation
-         * may also cause it to be erased.)
-         */
+        /* Ouch, the JS object is dead already. The GObject will be
+         * disassociated, and hopefully die too. */
         debug_lifecycle("Found GObject weak pointer whose JS wrapper is about "
                         "to be finalized");
         return true;
@@ -1392,16 +1728,19 @@ ObjectInstance::weak_pointer_was_finalized(void)
 }
 
 /*
- * ObjectInstance::ensure_weak_pointer_callback:
+ * ObjectInstance::ensure_weak_wrappers:
  *
  * Private method called when adding a weak pointer for the first time.
  */
-void ObjectInstance::ensure_weak_pointer_callback(JSContext* cx) {
-    if (!s_weak_pointer_callback) {
-        JS_AddWeakPointerCompartmentCallback(
-            cx, &ObjectInstance::update_heap_wrapper_weak_pointers, nullptr);
-        s_weak_pointer_callback = true;
-    }
+void ObjectInstance::ensure_weak_wrappers(JSContext* cx) {
+    if (!s_weak_wrappers)
+        s_weak_wrappers = new JS::WeakCache<WeakWrappers>(JS_GetRuntime(cx));
+}
+
+static size_t gobject_payload_size(GObject* gobj) {
+    int rowstride, height;
+    g_object_get(gobj, "rowstride", &rowstride, "height", &height, nullptr);
+    return size_t(rowstride) * height;
 }
 
 void
@@ -1416,8 +1755,13 @@ ObjectInstance::associate_js_gobject(JSContext       *context,
     set_object_qdata();
     m_wrapper = object;
 
-    ensure_weak_pointer_callback(context);
+    m_payload_size =
+        get_prototype()->has_payload() ? gobject_payload_size(gobj) : 0;
+    JS::AddAssociatedMemory(object, m_payload_size, MemoryUse::NativePayload);
+
+    ensure_weak_wrappers(context);
     link();
+    weak_link();
 
     g_object_weak_ref(gobj, wrapped_gobj_dispose_notify, this);
 }
@@ -1445,7 +1789,7 @@ ObjectInstance::ensure_uses_toggle_ref(JSContext *cx)
      */
     m_uses_toggle_ref = true;
     switch_to_rooted(cx);
-    g_object_add_toggle_ref(m_ptr, wrapped_gobj_toggle_notify, nullptr);
+    g_object_add_toggle_ref(m_ptr, wrapped_gobj_toggle_notify, m_gjs);
 
     /* We now have both a ref and a toggle ref, we only want the toggle ref.
      * This may immediately remove the GC root we just added, since refcount
@@ -1453,23 +1797,29 @@ ObjectInstance::ensure_uses_toggle_ref(JSContext *cx)
     g_object_unref(m_ptr);
 }
 
-static void invalidate_closure_list(std::forward_list<GClosure*>* closures) {
+// Called with an instance's vector of closures, and with a prototype's set of
+// vfunc closures
+template <typename Container>
+static void invalidate_closure_list(Container* closures) {
     g_assert(closures);
-    // Can't loop directly through the items, since invalidating an item's
-    // closure might have the effect of removing the item from the list in the
-    // invalidate notifier
-    while (!closures->empty()) {
-        // This will also free the closure data, through the closure
-        // invalidation mechanism, but adding a temporary reference to
-        // ensure that the closure is still valid when calling invalidation
-        // notify callbacks
-        using GjsAutoGClosure =
-            GjsAutoPointer<GClosure, GClosure, g_closure_unref, g_closure_ref>;
-        GjsAutoGClosure closure(closures->front(), GjsAutoTakeOwnership());
+    // Take the closures out of the list before invalidating any of them, so
+    // that the invalidate notifiers, which remove the closure from the list,
+    // have nothing to do when a whole object is being torn down. Hold a
+    // temporary reference to every closure while invalidating, so that they
+    // are all still valid when calling invalidation notify callbacks.
+    std::vector<GClosure*> batch(closures->begin(), closures->end());
+    closures->clear();
+
+    for (GClosure* closure : batch) {
+        gjs_closure_set_owner_index(closure, GJS_CLOSURE_INDEX_NONE);
+        g_closure_ref(closure);
+    }
+    // This will also free the closure data, through the closure invalidation
+    // mechanism
+    for (GClosure* closure : batch)
         g_closure_invalidate(closure);
-        /* Erase element if not already erased */
-        closures->remove(closure);
-    }
+    for (GClosure* closure : batch)
+        g_closure_unref(closure);
 }
 
 // Note: m_wrapper (the JS object) may already be null when this is called, if
@@ -1482,8 +1832,7 @@ ObjectInstance::disassociate_js_gobject(void)
     if (!m_gobj_disposed)
         g_object_weak_unref(m_ptr, wrapped_gobj_dispose_notify, this);
 
-    auto& toggle_queue = ToggleQueue::get_default();
-    std::tie(had_toggle_down, had_toggle_up) = toggle_queue.cancel(m_ptr);
+    std::tie(had_toggle_down, had_toggle_up) = ToggleQueue::cancel(m_ptr);
     if (had_toggle_down != had_toggle_up) {
         g_error(
             "JS object wrapper for GObject %p (%s) is being released while "
@@ -1554,6 +1903,8 @@ ObjectInstance::init_impl(JSContext              *context,
                                                  names.data(), values.data());
 
     ObjectInstance *other_priv = ObjectInstance::for_gobject(gobj);
+    if (other_priv && other_priv->disassociate_if_swept())
+        other_priv = nullptr;
     if (other_priv && other_priv->m_wrapper != object.get()) {
         /* g_object_new_with_properties() returned an object that's already
          * tracked by a JS object. Let's assume this is a singleton like
@@ -1632,6 +1983,7 @@ void ObjectPrototype::trace_impl(JSTracer* tracer) {
     m_property_cache.trace(tracer);
     m_field_cache.trace(tracer);
     m_unresolvable_cache.trace(tracer);
+    m_signal_cache.trace(tracer);
     for (GClosure* closure : m_vfuncs)
         gjs_closure_trace(closure, tracer);
 }
@@ -1642,6 +1994,7 @@ void ObjectInstance::finalize_impl(JSFreeOp* fop, JSObject* obj) {
     if (G_LIKELY(query.type))
         JS::RemoveAssociatedMemory(obj, query.instance_size,
                                    MemoryUse::GObjectInstanceStruct);
+    JS::RemoveAssociatedMemory(obj, m_payload_size, MemoryUse::NativePayload);
 
     GIWrapperInstance::finalize_impl(fop, obj);
 }
@@ -1649,6 +2002,12 @@ void ObjectInstance::finalize_impl(JSFreeOp* fop, JSObject* obj) {
 ObjectInstance::~ObjectInstance() {
     TRACE(GJS_OBJECT_WRAPPER_FINALIZE(this, m_ptr, ns(), name()));
 
+    // The wrapper died without the GObject being looked up since, or during
+    // the context's last GC, after the weak wrapper set was torn down. Either
+    // way the GObject must not keep pointing to this instance
+    if (m_ptr && (m_weak_swept || m_weak_index != WEAK_INDEX_NONE))
+        disassociate_js_gobject();
+
     invalidate_closure_list(&m_closures);
 
     /* GObject is not already freed */
@@ -1663,8 +2022,7 @@ ObjectInstance::~ObjectInstance() {
                 ns(), name());
         }
 
-        auto& toggle_queue = ToggleQueue::get_default();
-        std::tie(had_toggle_down, had_toggle_up) = toggle_queue.cancel(m_ptr);
+        std::tie(had_toggle_down, had_toggle_up) = ToggleQueue::cancel(m_ptr);
 
         if (!had_toggle_up && had_toggle_down) {
             g_error(
@@ -1821,17 +2179,28 @@ void ObjectInstance::associate_closure(JSContext* cx, GClosure* closure) {
 
     /* This is a weak reference, and will be cleared when the closure is
      * invalidated */
-    auto already_has = std::find(m_closures.begin(), m_closures.end(), closure);
-    g_assert(already_has == m_closures.end() &&
-             "This closure was already associated with this object");
-    m_closures.push_front(closure);
+    g_assert(gjs_closure_get_owner_index(closure) == GJS_CLOSURE_INDEX_NONE &&
+             "This closure was already associated with an object");
+    gjs_closure_set_owner_index(closure, m_closures.size());
+    m_closures.push_back(closure);
     g_closure_add_invalidate_notifier(
         closure, this, &ObjectInstance::closure_invalidated_notify);
 }
 
 void ObjectInstance::closure_invalidated_notify(void* data, GClosure* closure) {
     auto* priv = static_cast<ObjectInstance*>(data);
-    priv->m_closures.remove(closure);
+    size_t index = gjs_closure_get_owner_index(closure);
+    // Already taken out of the list by invalidate_closure_list()
+    if (index == GJS_CLOSURE_INDEX_NONE)
+        return;
+
+    g_assert(index < priv->m_closures.size() &&
+             priv->m_closures[index] == closure);
+    GClosure* last = priv->m_closures.back();
+    priv->m_closures[index] = last;
+    gjs_closure_set_owner_index(last, index);
+    priv->m_closures.pop_back();
+    gjs_closure_set_owner_index(closure, GJS_CLOSURE_INDEX_NONE);
 }
 
 bool ObjectBase::connect(JSContext* cx, unsigned argc, JS::Value* vp) {
@@ -1850,16 +2219,56 @@ bool ObjectBase::connect_after(JSContext* cx, unsigned argc, JS::Value* vp) {
     return priv->to_instance()->connect_impl(cx, args, true);
 }
 
+/*
+ * ObjectPrototype::lookup_signal:
+ *
+ * Looks up the signal named @utf8_name (the same as the JS string @name),
+ * possibly with a detail, on this prototype's GType, like g_signal_parse_name()
+ * does. Successful lookups are cached by the atomized name, since the same few
+ * signals are connected over and over. Signals are never removed from a
+ * GType, so the entries stay valid. On failure, *signal_id_out is 0.
+ *
+ * Returns: false if an exception is pending.
+ */
+bool ObjectPrototype::lookup_signal(JSContext* cx, JS::HandleValue name,
+                                    const char* utf8_name,
+                                    bool force_detail_quark,
+                                    unsigned* signal_id_out,
+                                    GQuark* detail_out) {
+    JS::RootedId id(cx);
+    if (name.isString()) {
+        JS::RootedString str(cx, name.toString());
+        if (!JS_StringToId(cx, str, &id))
+            return false;
+
+        auto entry = m_signal_cache.lookup(id);
+        if (entry) {
+            *signal_id_out = entry->value().signal_id;
+            *detail_out = entry->value().detail;
+            return true;
+        }
+    }
+
+    if (!g_signal_parse_name(utf8_name, m_gtype, signal_id_out, detail_out,
+                             force_detail_quark)) {
+        *signal_id_out = 0;
+        return true;
+    }
+
+    if (!JSID_IS_VOID(id) &&
+        !m_signal_cache.putNew(id, GjsSignalCacheEntry{*signal_id_out,
+                                                       *detail_out})) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    return true;
+}
+
 bool
 ObjectInstance::connect_impl(JSContext          *context,
                              const JS::CallArgs& args,
                              bool                after)
 {
-    GClosure *closure;
-    gulong id;
-    guint signal_id;
-    GQuark signal_detail;
-
     gjs_debug_gsignal("connect obj %p priv %p", m_wrapper.get(), this);
 
     if (!check_gobject_disposed("connect to any signal on"))
@@ -1872,29 +2281,331 @@ ObjectInstance::connect_impl(JSContext          *context,
                              "callback", &callback))
         return false;
 
+    unsigned long id;
+    if (!connect_signal(context, args[0], signal_name.get(), callback, after,
+                        nullptr, &id))
+        return false;
+
+    args.rval().setDouble(id);
+
+    return true;
+}
+
+[[nodiscard]] static GQuark gjs_owner_token_quark() {
+    static GQuark val = 0;
+    if (G_UNLIKELY(!val))
+        val = g_quark_from_static_string("gjs::connection-owner-token");
+
+    return val;
+}
+
+// Handlers connected with connectObject() carry a token unique to their owner
+// as the closure data, so that disconnectObject() can remove all of them in one
+// G_SIGNAL_MATCH_DATA pass. The owner itself can't be the data, because C
+// code often connects handlers with another object as their user data. The
+// token is freed at the owner's finalization, after its dispose has
+// invalidated all the handlers that use it.
+[[nodiscard]] static void* owner_token(GObject* owner, bool create) {
+    void* token = g_object_get_qdata(owner, gjs_owner_token_quark());
+    if (!token && create) {
+        token = g_new0(char, 1);
+        g_object_set_qdata_full(owner, gjs_owner_token_quark(), token, g_free);
+    }
+    return token;
+}
+
+/*
+ * ObjectInstance::connect_signal:
+ *
+ * Connects @callback to the signal named @name (which is @utf8_name in UTF-8)
+ * and puts the handler ID in @id_out. If @owner is not null, the handler is
+ * disconnected when @owner is disposed, or by disconnectObject(@owner).
+ */
+bool ObjectInstance::connect_signal(JSContext* cx, JS::HandleValue name,
+                                    const char* utf8_name,
+                                    JS::HandleObject callback, bool after,
+                                    GObject* owner, unsigned long* id_out) {
+    unsigned signal_id;
+    GQuark signal_detail;
+
     if (!JS::IsCallable(callback)) {
-        gjs_throw(context, "second arg must be a callback");
+        gjs_throw(cx, "second arg must be a callback");
         return false;
     }
 
-    if (!g_signal_parse_name(signal_name.get(), gtype(), &signal_id,
-                             &signal_detail, true)) {
-        gjs_throw(context, "No signal '%s' on object '%s'",
-                  signal_name.get(), type_name());
+    if (!get_prototype()->lookup_signal(cx, name, utf8_name, true, &signal_id,
+                                        &signal_detail))
+        return false;
+    if (!signal_id) {
+        gjs_throw(cx, "No signal '%s' on object '%s'", utf8_name, type_name());
         return false;
     }
 
-    closure = gjs_closure_new_for_signal(
-        context, JS_GetObjectFunction(callback), "signal callback", signal_id);
+    GClosure* closure = gjs_closure_new_for_signal(
+        cx, JS_GetObjectFunction(callback), "signal callback", signal_id);
     if (closure == NULL)
         return false;
-    associate_closure(context, closure);
+    associate_closure(cx, closure);
 
-    id = g_signal_connect_closure_by_id(m_ptr, signal_id, signal_detail,
-                                        closure, after);
+    if (owner) {
+        // GjsClosure does not use the closure data itself
+        closure->data = owner_token(owner, true);
+        g_object_watch_closure(owner, closure);
+    }
 
-    args.rval().setDouble(id);
+    *id_out = g_signal_connect_closure_by_id(m_ptr, signal_id, signal_detail,
+                                             closure, after);
+    return true;
+}
+
+bool ObjectBase::connect_object(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_WRAPPER_PRIV(cx, argc, vp, args, obj, ObjectBase, priv);
+    if (!priv->check_is_instance(cx, "connect to signals"))
+        return false;
+
+    return priv->to_instance()->connect_object_impl(cx, args);
+}
+
+bool ObjectBase::disconnect_object(JSContext* cx, unsigned argc,
+                                   JS::Value* vp) {
+    GJS_GET_WRAPPER_PRIV(cx, argc, vp, args, obj, ObjectBase, priv);
+    if (!priv->check_is_instance(cx, "disconnect signals"))
+        return false;
+
+    return priv->to_instance()->disconnect_object_impl(cx, args);
+}
+
+// connectObject(name, callback, [name, callback, ...], owner): connects each
+// callback as connect() would, for as long as the GObject @owner is alive
+bool ObjectInstance::connect_object_impl(JSContext* cx,
+                                         const JS::CallArgs& args) {
+    args.rval().setUndefined();
+
+    if (!check_gobject_disposed("connect to any signal on"))
+        return true;
+
+    unsigned n_args = args.length();
+    if (n_args < 3 || n_args % 2 == 0) {
+        gjs_throw(cx,
+                  "connectObject() takes pairs of signal names and callbacks, "
+                  "followed by the object owning the connections");
+        return false;
+    }
+
+    GObject* owner = nullptr;
+    if (args[n_args - 1].isObject()) {
+        JS::RootedObject owner_obj(cx, &args[n_args - 1].toObject());
+        if (!ObjectBase::to_c_ptr(cx, owner_obj, &owner))
+            owner = nullptr;
+    }
+    if (!owner) {
+        gjs_throw(cx, "connectObject(): the owner must be a GObject");
+        return false;
+    }
+
+    JS::RootedObject callback(cx);
+    for (unsigned ix = 0; ix + 1 < n_args; ix += 2) {
+        if (!args[ix].isString() || !args[ix + 1].isObject()) {
+            gjs_throw(cx,
+                      "connectObject(): expected a signal name and a callback "
+                      "at argument %u",
+                      ix + 1);
+            return false;
+        }
+
+        JS::UniqueChars signal_name = gjs_string_to_utf8(cx, args[ix]);
+        if (!signal_name)
+            return false;
+
+        callback = &args[ix + 1].toObject();
+        unsigned long id;
+        if (!connect_signal(cx, args[ix], signal_name.get(), callback, false,
+                            owner, &id))
+            return false;
+    }
+    return true;
+}
+
+// disconnectObject(owner): disconnects all the handlers that were connected
+// with @owner by connectObject(), and returns how many there were
+bool ObjectInstance::disconnect_object_impl(JSContext* cx,
+                                            const JS::CallArgs& args) {
+    args.rval().setInt32(0);
+
+    if (!check_gobject_disposed("disconnect any signal on"))
+        return true;
+
+    JS::RootedObject owner_obj(cx);
+    if (!gjs_parse_call_args(cx, "disconnectObject", args, "o", "owner",
+                             &owner_obj))
+        return false;
+
+    GObject* owner;
+    if (!ObjectBase::to_c_ptr(cx, owner_obj, &owner)) {
+        gjs_throw(cx, "disconnectObject(): the owner must be a GObject");
+        return false;
+    }
+
+    // A disposed owner has no connections left
+    void* token = owner ? owner_token(owner, false) : nullptr;
+    if (!token)
+        return true;
+
+    unsigned n_disconnected = g_signal_handlers_disconnect_matched(
+        m_ptr, G_SIGNAL_MATCH_DATA, 0, 0, nullptr, nullptr, token);
+    args.rval().setNumber(n_disconnected);
+    return true;
+}
+
+bool ObjectBase::connect_notify_batched(JSContext* cx, unsigned argc,
+                                        JS::Value* vp) {
+    GJS_GET_WRAPPER_PRIV(cx, argc, vp, args, obj, ObjectBase, priv);
+    if (!priv->check_is_instance(cx, "connect to signals"))
+        return false;
+
+    return priv->to_instance()->connect_notify_batched_impl(cx, args);
+}
+
+// Collects the notify emissions for a set of properties, and passes all the
+// properties that changed to the JS callback in one call from an idle, rather
+// than one call per property. Notifications that are queued by
+// g_object_freeze_notify() and emitted on thaw end up in the same call.
+struct GjsNotifyBatch {
+    GObject* gobject;  // not owned, the handler is destroyed with the object
+    GClosure* callback;
+    std::vector<GParamSpec*> props;
+    std::vector<GParamSpec*> pending;
+    unsigned idle_id = 0;
+
+    GjsNotifyBatch(GObject* obj, GClosure* closure)
+        : gobject(obj), callback(closure) {
+        g_closure_ref(callback);
+        g_closure_sink(callback);
+    }
+
+    ~GjsNotifyBatch() {
+        if (idle_id)
+            g_source_remove(idle_id);
+        g_closure_invalidate(callback);
+        g_closure_unref(callback);
+    }
+
+    static gboolean flush(void* data) {
+        auto* batch = static_cast<GjsNotifyBatch*>(data);
+        batch->idle_id = 0;
+
+        std::vector<GParamSpec*> pending;
+        pending.swap(batch->pending);
+        std::vector<const char*> names;
+        names.reserve(pending.size() + 1);
+        for (GParamSpec* pspec : pending)
+            names.push_back(pspec->name);
+        names.push_back(nullptr);
+
+        GValue params[2] = {G_VALUE_INIT, G_VALUE_INIT};
+        g_value_init(&params[0], G_TYPE_OBJECT);
+        g_value_set_object(&params[0], batch->gobject);
+        g_value_init(&params[1], G_TYPE_STRV);
+        g_value_set_boxed(&params[1], names.data());
+
+        // The callback may disconnect the handler, freeing the batch, so it
+        // must not be used after this
+        g_closure_invoke(batch->callback, nullptr, 2, params, nullptr);
+
+        g_value_unset(&params[0]);
+        g_value_unset(&params[1]);
+        return G_SOURCE_REMOVE;
+    }
+
+    static void on_notify(GObject*, GParamSpec* pspec, void* data) {
+        auto* batch = static_cast<GjsNotifyBatch*>(data);
+        if (std::find(batch->props.begin(), batch->props.end(), pspec) ==
+                batch->props.end() ||
+            std::find(batch->pending.begin(), batch->pending.end(), pspec) !=
+                batch->pending.end())
+            return;
 
+        batch->pending.push_back(pspec);
+        if (!batch->idle_id)
+            batch->idle_id = g_idle_add_full(G_PRIORITY_HIGH_IDLE, flush,
+                                             batch, nullptr);
+    }
+
+    static void destroy(void* data, GClosure*) {
+        delete static_cast<GjsNotifyBatch*>(data);
+    }
+};
+
+// connect_notify_batched(props, callback): connects @callback to the notify
+// signal for each of the property names in the array @props. Returns a handler
+// ID for disconnect(). The callback is called as callback(object, names),
+// where @names are the properties that changed since the last call.
+bool ObjectInstance::connect_notify_batched_impl(JSContext* cx,
+                                                 const JS::CallArgs& args) {
+    if (!check_gobject_disposed("connect to any signal on"))
+        return true;
+
+    JS::RootedObject props(cx), callback(cx);
+    if (!gjs_parse_call_args(cx, "connect_notify_batched", args, "oo",
+                             "property names", &props, "callback", &callback))
+        return false;
+
+    bool is_array;
+    if (!JS::IsArrayObject(cx, props, &is_array))
+        return false;
+    if (!is_array) {
+        gjs_throw(cx, "first arg must be an array of property names");
+        return false;
+    }
+    if (!JS::IsCallable(callback)) {
+        gjs_throw(cx, "second arg must be a callback");
+        return false;
+    }
+
+    uint32_t n_props;
+    if (!JS::GetArrayLength(cx, props, &n_props))
+        return false;
+
+    std::vector<GParamSpec*> pspecs;
+    pspecs.reserve(n_props);
+    JS::RootedValue elem(cx);
+    for (uint32_t ix = 0; ix < n_props; ix++) {
+        if (!JS_GetElement(cx, props, ix, &elem))
+            return false;
+        JS::UniqueChars name = gjs_string_to_utf8(cx, elem);
+        if (!name)
+            return false;
+
+        GjsAutoChar canonical_name = g_strdup(name.get());
+        g_strdelimit(canonical_name, "_", '-');
+        GParamSpec* pspec = g_object_class_find_property(
+            G_OBJECT_GET_CLASS(m_ptr), canonical_name);
+        if (!pspec) {
+            gjs_throw(cx, "No property '%s' on object '%s'", name.get(),
+                      type_name());
+            return false;
+        }
+
+        // Notifications of overridden properties are emitted for the
+        // original property
+        if (GParamSpec* redirect = g_param_spec_get_redirect_target(pspec))
+            pspec = redirect;
+        pspecs.push_back(pspec);
+    }
+
+    GClosure* closure = gjs_closure_new_marshaled(
+        cx, JS_GetObjectFunction(callback), "batched notify callback");
+    if (!closure)
+        return false;
+    associate_closure(cx, closure);
+
+    auto* batch = new GjsNotifyBatch(m_ptr, closure);
+    batch->props = std::move(pspecs);
+    unsigned long id = g_signal_connect_data(
+        m_ptr, "notify", G_CALLBACK(&GjsNotifyBatch::on_notify), batch,
+        &GjsNotifyBatch::destroy, GConnectFlags(0));
+
+    args.rval().setDouble(id);
     return true;
 }
 
@@ -1906,6 +2617,119 @@ bool ObjectBase::emit(JSContext* cx, unsigned argc, JS::Value* vp) {
     return priv->to_instance()->emit_impl(cx, args);
 }
 
+bool ObjectBase::set_properties(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_WRAPPER_PRIV(cx, argc, vp, args, obj, ObjectBase, priv);
+    if (!priv->check_is_instance(cx, "set properties"))
+        return false;
+
+    return priv->to_instance()->set_properties_impl(cx, args);
+}
+
+// Holds back notify signals of @gobj while in scope, keeping it alive
+class GjsAutoFreezeNotify {
+    GObject* m_gobj;
+
+ public:
+    explicit GjsAutoFreezeNotify(GObject* gobj)
+        : m_gobj(static_cast<GObject*>(g_object_ref(gobj))) {
+        g_object_freeze_notify(m_gobj);
+    }
+    ~GjsAutoFreezeNotify() {
+        g_object_thaw_notify(m_gobj);
+        g_object_unref(m_gobj);
+    }
+};
+
+// Sets all the GObject properties given in an object, so that notifications
+// are emitted only after all of them have been set. Other keys are assigned as
+// plain JS properties, like Object.assign() would, in the same order: runs of
+// GObject properties between them are set in one g_object_setv() call.
+bool ObjectInstance::set_properties_impl(JSContext* cx,
+                                         const JS::CallArgs& args) {
+    args.rval().setUndefined();
+
+    if (!check_gobject_disposed("set any property on"))
+        return true;
+
+    if (!args.get(0).isObject()) {
+        gjs_throw(cx, "set() takes an object with property names and values");
+        return false;
+    }
+
+    JS::RootedObject props(cx, &args[0].toObject());
+    JS::Rooted<JS::IdVector> ids(cx, cx);
+    if (!JS_Enumerate(cx, props, &ids))
+        return false;
+
+    JS::RootedString js_name(cx);
+    JS::RootedObject wrapper(cx, m_wrapper);
+    JS::RootedId prop_id(cx);
+    JS::RootedValue value(cx);
+    std::vector<const char*> names;
+    AutoGValueVector values;
+    GjsAutoTypeClass<GObjectClass> oclass(gtype());
+    GjsAutoFreezeNotify freeze(m_ptr);
+
+    auto flush_batch = [this, &names, &values]() {
+        g_assert(names.size() == values.size());
+        if (values.empty())
+            return;
+        g_object_setv(m_ptr, values.size(), names.data(), values.data());
+        for (GValue& gvalue : values)
+            g_value_unset(&gvalue);
+        values.clear();
+        names.clear();
+    };
+
+    for (size_t ix = 0; ix < ids.length(); ix++) {
+        prop_id = ids[ix];
+        if (!JS_GetPropertyById(cx, props, prop_id, &value))
+            return false;
+
+        GParamSpec* pspec = nullptr;
+        if (JSID_IS_STRING(prop_id)) {
+            js_name = JSID_TO_STRING(prop_id);
+            JS::UniqueChars name(JS_EncodeStringToUTF8(cx, js_name));
+            if (!name)
+                return false;
+            GjsAutoChar storage;
+            const char* gname =
+                gjs_canonical_property_name(name.get(), &storage);
+            pspec = g_object_class_find_property(oclass, gname);
+        }
+
+        // Anything that's not a plain writable GObject property keeps the
+        // behaviour of an ordinary JS assignment, including its errors
+        if (!pspec || !(pspec->flags & G_PARAM_WRITABLE) ||
+            (pspec->flags & (G_PARAM_CONSTRUCT_ONLY | G_PARAM_DEPRECATED)) ||
+            value.isUndefined() ||
+            g_param_spec_get_qdata(pspec, ObjectBase::custom_property_quark())) {
+            // The properties before it are set first, since its setter may
+            // look at them
+            flush_batch();
+            if (!JS_SetPropertyById(cx, wrapper, prop_id, value))
+                return false;
+            if (!check_gobject_disposed("set any property on"))
+                return true;
+            continue;
+        }
+
+        GValue gvalue = G_VALUE_INIT;
+        g_value_init(&gvalue, G_PARAM_SPEC_VALUE_TYPE(pspec));
+        if (!fill_g_value_fast(value, &gvalue) &&
+            !gjs_value_to_g_value(cx, value, &gvalue)) {
+            g_value_unset(&gvalue);
+            return false;
+        }
+
+        names.push_back(pspec->name);  // owned by the class
+        values.push_back(gvalue);
+    }
+
+    flush_batch();
+    return true;
+}
+
 bool
 ObjectInstance::emit_impl(JSContext          *context,
                           const JS::CallArgs& argv)
@@ -1929,8 +2753,10 @@ ObjectInstance::emit_impl(JSContext          *context,
                              "signal name", &signal_name))
         return false;
 
-    if (!g_signal_parse_name(signal_name.get(), gtype(), &signal_id,
-                             &signal_detail, false)) {
+    if (!get_prototype()->lookup_signal(context, argv[0], signal_name.get(),
+                                        false, &signal_id, &signal_detail))
+        return false;
+    if (!signal_id) {
         gjs_throw(context, "No signal '%s' on object '%s'",
                   signal_name.get(), type_name());
         return false;
@@ -1971,6 +2797,7 @@ ObjectInstance::emit_impl(JSContext          *context,
     }
 
     if (!failed) {
+        GjsAutoSignalEmission emission(instance_and_args, argv);
         g_signal_emitv(instance_and_args, signal_id, signal_detail,
                        &rvalue);
     }
@@ -2260,7 +3087,11 @@ JSFunctionSpec ObjectBase::proto_methods[] = {
     JS_FN("_init", &ObjectBase::init_gobject, 0, 0),
     JS_FN("connect", &ObjectBase::connect, 0, 0),
     JS_FN("connect_after", &ObjectBase::connect_after, 0, 0),
+    JS_FN("connect_notify_batched", &ObjectBase::connect_notify_batched, 2, 0),
+    JS_FN("connectObject", &ObjectBase::connect_object, 3, 0),
+    JS_FN("disconnectObject", &ObjectBase::disconnect_object, 1, 0),
     JS_FN("emit", &ObjectBase::emit, 0, 0),
+    JS_FN("set", &ObjectBase::set_properties, 1, 0),
     JS_FS_END
 };
 
@@ -2404,7 +3235,20 @@ ObjectInstance* ObjectInstance::new_for_gobject(JSContext* cx, GObject* gobj) {
 JSObject* ObjectInstance::wrapper_from_gobject(JSContext* cx, GObject* gobj) {
     g_assert(gobj && "Cannot get JSObject for null GObject pointer");
 
-    ObjectInstance* priv = ObjectInstance::for_gobject(gobj);
+    ObjectInstance* priv;
+    RecentWrapper& recent = recent_wrapper_slot(gobj);
+    if (recent.gobj == gobj) {
+        priv = recent.priv;
+        priv->check_js_object_finalized();
+    } else {
+        priv = ObjectInstance::for_gobject(gobj);
+        if (priv)
+            recent = {gobj, priv};
+    }
+
+    // The old wrapper is about to be finalized and can't be handed out again
+    if (priv && priv->disassociate_if_swept())
+        priv = nullptr;
 
     if (!priv) {
         /* We have to create a wrapper */
@@ -2440,11 +3284,13 @@ bool ObjectBase::transfer_to_gi_argument(JSContext* cx, JS::HandleObject obj,
                                          GIDirection transfer_direction,
                                          GITransfer transfer_ownership,
                                          GType expected_gtype,
-                                         GIBaseInfo* expected_info) {
+                                         GIBaseInfo* expected_info,
+                                         GType* last_passed_gtype) {
     g_assert(transfer_direction != GI_DIRECTION_INOUT &&
              "transfer_to_gi_argument() must choose between in or out");
 
-    if (!ObjectBase::typecheck(cx, obj, expected_info, expected_gtype)) {
+    if (!ObjectBase::typecheck(cx, obj, expected_info, expected_gtype,
+                               last_passed_gtype)) {
         gjs_arg_unset<void*>(arg);
         return false;
     }
@@ -2625,10 +3471,10 @@ bool ObjectPrototype::hook_up_vfunc_impl(JSContext* cx,
 
         // This is traced, and will be cleared from the list when the closure is
         // invalidated
-        g_assert(std::find(m_vfuncs.begin(), m_vfuncs.end(),
-                           trampoline->js_function) == m_vfuncs.end() &&
+        [[maybe_unused]] bool inserted =
+            m_vfuncs.insert(trampoline->js_function).second;
+        g_assert(inserted &&
                  "This vfunc was already associated with this class");
-        m_vfuncs.push_front(trampoline->js_function);
         g_closure_add_invalidate_notifier(
             trampoline->js_function, this,
             &ObjectPrototype::vfunc_invalidated_notify);
@@ -2646,7 +3492,7 @@ bool ObjectPrototype::hook_up_vfunc_impl(JSContext* cx,
 
 void ObjectPrototype::vfunc_invalidated_notify(void* data, GClosure* closure) {
     auto* priv = static_cast<ObjectPrototype*>(data);
-    priv->m_vfuncs.remove(closure);
+    priv->m_vfuncs.erase(closure);
 }
 
 bool
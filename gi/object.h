@@ -27,9 +27,11 @@
 #include <config.h>
 
 #include <stddef.h>  // for size_t
+#include <stdint.h>  // for SIZE_MAX
+#include <stdio.h>  // for FILE
 
-#include <forward_list>
 #include <functional>
+#include <unordered_set>
 #include <vector>
 
 #include <girepository.h>
@@ -40,6 +42,7 @@
 #include <js/Id.h>
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
+#include <js/SweepingAPI.h>  // for WeakCache
 #include <js/TypeDecls.h>
 #include <jsfriendapi.h>            // for JSID_IS_ATOM, JSID_TO_ATOM
 #include <mozilla/HashFunctions.h>  // for HashGeneric, HashNumber
@@ -53,6 +56,7 @@
 #include "util/log.h"
 
 class GjsAtoms;
+class GjsContextPrivate;
 class JSTracer;
 namespace JS {
 class CallArgs;
@@ -124,7 +128,8 @@ class ObjectBase
                                         GIDirection transfer_direction,
                                         GITransfer transfer_ownership,
                                         GType expected_gtype,
-                                        GIBaseInfo* expected_info = nullptr);
+                                        GIBaseInfo* expected_info = nullptr,
+                                        GType* last_passed_gtype = nullptr);
 
  private:
     // This is used in debug methods only.
@@ -178,8 +183,17 @@ class ObjectBase
     GJS_JSAPI_RETURN_CONVENTION
     static bool connect_after(JSContext* cx, unsigned argc, JS::Value* vp);
     GJS_JSAPI_RETURN_CONVENTION
+    static bool connect_notify_batched(JSContext* cx, unsigned argc,
+                                       JS::Value* vp);
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool connect_object(JSContext* cx, unsigned argc, JS::Value* vp);
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool disconnect_object(JSContext* cx, unsigned argc, JS::Value* vp);
+    GJS_JSAPI_RETURN_CONVENTION
     static bool emit(JSContext* cx, unsigned argc, JS::Value* vp);
     GJS_JSAPI_RETURN_CONVENTION
+    static bool set_properties(JSContext* cx, unsigned argc, JS::Value* vp);
+    GJS_JSAPI_RETURN_CONVENTION
     static bool signal_find(JSContext* cx, unsigned argc, JS::Value* vp);
     template <SignalMatchFunc(*MATCH_FUNC)>
     GJS_JSAPI_RETURN_CONVENTION static bool signals_action(JSContext* cx,
@@ -212,6 +226,18 @@ struct IdHasher {
     static bool match(jsid id1, jsid id2) { return id1 == id2; }
 };
 
+// Result of parsing a signal name, possibly with a detail, for a given GType
+struct GjsSignalCacheEntry {
+    unsigned signal_id;
+    GQuark detail;
+};
+
+namespace JS {
+template <>
+struct GCPolicy<GjsSignalCacheEntry>
+    : public IgnoreGCPolicy<GjsSignalCacheEntry> {};
+}  // namespace JS
+
 class ObjectPrototype
     : public GIWrapperPrototype<ObjectBase, ObjectPrototype, ObjectInstance> {
     friend class GIWrapperPrototype<ObjectBase, ObjectPrototype,
@@ -226,12 +252,19 @@ class ObjectPrototype
                       js::DefaultHasher<JSString*>, js::SystemAllocPolicy>;
     using NegativeLookupCache =
         JS::GCHashSet<JS::Heap<jsid>, IdHasher, js::SystemAllocPolicy>;
+    using SignalCache = JS::GCHashMap<JS::Heap<jsid>, GjsSignalCacheEntry,
+                                      IdHasher, js::SystemAllocPolicy>;
 
     PropertyCache m_property_cache;
     FieldCache m_field_cache;
     NegativeLookupCache m_unresolvable_cache;
-    // a list of vfunc GClosures installed on this prototype, used when tracing
-    std::forward_list<GClosure*> m_vfuncs;
+    SignalCache m_signal_cache;
+    // the set of vfunc GClosures installed on this prototype, used when
+    // tracing
+    std::unordered_set<GClosure*> m_vfuncs;
+    // whether instances hold memory outside the instance struct that the GC
+    // should know about
+    bool m_has_payload : 1;
 
     ObjectPrototype(GIObjectInfo* info, GType gtype);
     ~ObjectPrototype();
@@ -270,6 +303,10 @@ class ObjectPrototype
     GJS_JSAPI_RETURN_CONVENTION
     GIFieldInfo* lookup_cached_field_info(JSContext* cx, JS::HandleString key);
     GJS_JSAPI_RETURN_CONVENTION
+    bool lookup_signal(JSContext* cx, JS::HandleValue name,
+                       const char* utf8_name, bool force_detail_quark,
+                       unsigned* signal_id_out, GQuark* detail_out);
+    GJS_JSAPI_RETURN_CONVENTION
     bool props_to_g_parameters(JSContext* cx, JS::HandleObject props,
                                std::vector<const char*>* names,
                                AutoGValueVector* values);
@@ -288,6 +325,8 @@ class ObjectPrototype
         for (GClosure* closure : m_vfuncs)
             g_closure_unref(closure);
     }
+    [[nodiscard]] size_t num_vfuncs() const { return m_vfuncs.size(); }
+    [[nodiscard]] bool has_payload() const { return m_has_payload; }
 
     /* JSClass operations */
  private:
@@ -317,10 +356,20 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
     // GIWrapperInstance::m_ptr may be null in ObjectInstance.
 
     GjsMaybeOwned<JSObject*> m_wrapper;
-    // a list of all GClosures installed on this object (from signal connections
-    // and scope-notify callbacks passed to methods), used when tracing
-    std::forward_list<GClosure*> m_closures;
+    // the set of all GClosures installed on this object (from signal
+    // connections and scope-notify callbacks passed to methods), used when
+    // tracing. Contiguous so that tracing doesn't chase pointers; each
+    // closure stores its own index, so that removing it is a swap with the
+    // last element
+    std::vector<GClosure*> m_closures;
     GjsListLink m_instance_link;
+    // the context owning the wrapper, which is also the toggle ref's data
+    GjsContextPrivate* m_gjs;
+    // position in s_weak_wrappers, or WEAK_INDEX_NONE if not in it
+    size_t m_weak_index = WEAK_INDEX_NONE;
+    // size of the buffer owned by the GObject that was reported to the JS
+    // engine as memory associated with the wrapper, such as a pixbuf's pixels
+    size_t m_payload_size = 0;
 
     bool m_wrapper_finalized : 1;
     bool m_gobj_disposed : 1;
@@ -330,7 +379,23 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
      * hard ref on the underlying GObject, and may be finalized at will. */
     bool m_uses_toggle_ref : 1;
 
-    static bool s_weak_pointer_callback;
+    // set by the weak wrapper sweep when the wrapper is about to be finalized.
+    // Not one of the bitfields, since the sweep may run on a GC helper thread
+    bool m_weak_swept = false;
+
+    // Wrappers that only hold a weak pointer to their JS object, swept by the
+    // JS engine as part of each GC. The sweep can't call into GObject, so it
+    // only marks the instances whose wrapper died; those are disassociated
+    // from their GObject when a wrapper for it is next asked for, or when
+    // finalized. for_gobject() still finds them until then.
+    struct WeakWrappers {
+        std::vector<ObjectInstance*> instances;
+
+        void sweep();
+        [[nodiscard]] bool empty() const { return instances.empty(); }
+    };
+    static constexpr size_t WEAK_INDEX_NONE = SIZE_MAX;
+    static JS::WeakCache<WeakWrappers>* s_weak_wrappers;
 
     /* Constructors */
 
@@ -341,6 +406,11 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
     GJS_JSAPI_RETURN_CONVENTION
     static ObjectInstance* new_for_gobject(JSContext* cx, GObject* gobj);
 
+    // Recycle private structs, since wrappers for objects that are only
+    // briefly seen from JS (e.g. signal arguments) come and go by the dozen
+    [[nodiscard]] static void* allocate_instance();
+    static void free_instance(void* mem);
+
     // Extra method to get an existing ObjectInstance from qdata
 
  public:
@@ -348,18 +418,27 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
 
     /* Accessors */
 
- private:
+    // Unbarriered; false once the wrapper was swept, before it is finalized
     [[nodiscard]] bool has_wrapper() const { return !!m_wrapper; }
-
- public:
     [[nodiscard]] JSObject* wrapper() const { return m_wrapper; }
 
     /* Methods to manipulate the JS object wrapper */
 
  private:
-    void discard_wrapper(void) { m_wrapper.reset(); }
-    void switch_to_rooted(JSContext* cx) { m_wrapper.switch_to_rooted(cx); }
-    void switch_to_unrooted(JSContext* cx) { m_wrapper.switch_to_unrooted(cx); }
+    void discard_wrapper(void) {
+        m_wrapper.reset();
+        weak_unlink();
+    }
+    void switch_to_rooted(JSContext* cx) {
+        m_wrapper.switch_to_rooted(cx);
+        weak_unlink();
+    }
+    void switch_to_unrooted(JSContext* cx) {
+        m_wrapper.switch_to_unrooted(cx);
+        weak_link();
+    }
+    void weak_link(void);
+    void weak_unlink(void);
     [[nodiscard]] bool update_after_gc() { return m_wrapper.update_after_gc(); }
     [[nodiscard]] bool wrapper_is_rooted() const { return m_wrapper.rooted(); }
     void release_native_object(void);
@@ -368,10 +447,8 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
     void disassociate_js_gobject(void);
     void handle_context_dispose(void);
     [[nodiscard]] bool weak_pointer_was_finalized();
-    static void ensure_weak_pointer_callback(JSContext* cx);
-    static void update_heap_wrapper_weak_pointers(JSContext* cx,
-                                                  JS::Compartment* compartment,
-                                                  void* data);
+    [[nodiscard]] bool disassociate_if_swept();
+    static void ensure_weak_wrappers(JSContext* cx);
 
  public:
     void toggle_down(void);
@@ -393,6 +470,7 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
  private:
     void set_object_qdata(void);
     void unset_object_qdata(void);
+    void forget_recent_wrapper(void);
     void check_js_object_finalized(void);
     void ensure_uses_toggle_ref(JSContext* cx);
     [[nodiscard]] bool check_gobject_disposed(const char* for_what) const;
@@ -435,7 +513,8 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
 
  public:
     [[nodiscard]] GjsListLink* get_link() { return &m_instance_link; }
-    static void prepare_shutdown(void);
+    static void prepare_shutdown(GjsContextPrivate* gjs);
+    static void dump_wrapper_stats(FILE* fp);
 
     /* JSClass operations */
 
@@ -453,12 +532,18 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
     bool prop_getter_impl(JSContext* cx, JS::HandleString name,
                           JS::MutableHandleValue rval);
     GJS_JSAPI_RETURN_CONVENTION
+    bool prop_getter_impl(JSContext* cx, GParamSpec* param,
+                          JS::MutableHandleValue rval);
+    GJS_JSAPI_RETURN_CONVENTION
     bool field_getter_impl(JSContext* cx, JS::HandleString name,
                            JS::MutableHandleValue rval);
     GJS_JSAPI_RETURN_CONVENTION
     bool prop_setter_impl(JSContext* cx, JS::HandleString name,
                           JS::HandleValue value);
     GJS_JSAPI_RETURN_CONVENTION
+    bool prop_setter_impl(JSContext* cx, GParamSpec* param_spec,
+                          JS::HandleValue value);
+    GJS_JSAPI_RETURN_CONVENTION
     bool field_setter_not_impl(JSContext* cx, JS::HandleString name);
 
     // JS constructor
@@ -473,8 +558,20 @@ class ObjectInstance : public GIWrapperInstance<ObjectBase, ObjectPrototype,
     GJS_JSAPI_RETURN_CONVENTION
     bool connect_impl(JSContext* cx, const JS::CallArgs& args, bool after);
     GJS_JSAPI_RETURN_CONVENTION
+    bool connect_notify_batched_impl(JSContext* cx, const JS::CallArgs& args);
+    GJS_JSAPI_RETURN_CONVENTION
+    bool connect_signal(JSContext* cx, JS::HandleValue name,
+                        const char* utf8_name, JS::HandleObject callback,
+                        bool after, GObject* owner, unsigned long* id_out);
+    GJS_JSAPI_RETURN_CONVENTION
+    bool connect_object_impl(JSContext* cx, const JS::CallArgs& args);
+    GJS_JSAPI_RETURN_CONVENTION
+    bool disconnect_object_impl(JSContext* cx, const JS::CallArgs& args);
+    GJS_JSAPI_RETURN_CONVENTION
     bool emit_impl(JSContext* cx, const JS::CallArgs& args);
     GJS_JSAPI_RETURN_CONVENTION
+    bool set_properties_impl(JSContext* cx, const JS::CallArgs& args);
+    GJS_JSAPI_RETURN_CONVENTION
     bool signal_find_impl(JSContext* cx, const JS::CallArgs& args);
     template <SignalMatchFunc(*MATCH_FUNC)>
     GJS_JSAPI_RETURN_CONVENTION bool signals_action_impl(
@@ -505,7 +602,8 @@ JSObject* gjs_lookup_object_constructor_from_info(JSContext* cx,
                                                   GIObjectInfo* info,
                                                   GType gtype);
 
-void gjs_object_clear_toggles(void);
-void gjs_object_shutdown_toggle_queue(void);
+void gjs_object_clear_toggles(GjsContextPrivate* gjs);
+void gjs_object_dump_wrapper_stats(FILE* fp);
+void gjs_object_shutdown_toggle_queue(GjsContextPrivate* gjs);
 
 #endif  // GI_OBJECT_H_
@@ -211,34 +211,99 @@ gjs_define_param_class(JSContext       *context,
     return true;
 }
 
+[[nodiscard]] static GQuark gjs_param_wrapper_quark() {
+    static GQuark val = 0;
+    if (G_UNLIKELY(!val))
+        val = g_quark_from_static_string("gjs::param-wrapper");
+
+    return val;
+}
+
+// A GParamSpec keeps its wrapper for as long as the wrapper is alive, so that
+// handlers of signals such as notify, which get the same GParamSpec for every
+// emission, don't create a new wrapper each time. As with GType wrappers in
+// gi/gtype.cpp, the wrapper is reachable from the GParamSpec's qdata, which
+// points at its weak slot in the context's ParamTable. The wrapper holds a
+// reference on the GParamSpec, so the slot is always cleared before the
+// GParamSpec can be finalized.
+static GjsContextPrivate* s_qdata_owner = nullptr;
+
 JSObject*
 gjs_param_from_g_param(JSContext    *context,
                        GParamSpec   *gparam)
 {
-    JSObject *obj;
-
     if (!gparam)
         return nullptr;
 
-    gjs_debug(GJS_DEBUG_GPARAM,
-              "Wrapping %s '%s' on %s with JSObject",
-              g_type_name(G_TYPE_FROM_INSTANCE((GTypeInstance*) gparam)),
-              gparam->name,
-              g_type_name(gparam->owner_type));
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
+    if (gjs == s_qdata_owner) {
+        auto* slot = static_cast<JS::Heap<JSObject*>*>(
+            g_param_spec_get_qdata(gparam, gjs_param_wrapper_quark()));
+        if (slot)
+            return *slot;
+    }
 
-    JS::RootedObject proto(context, gjs_lookup_param_prototype(context));
+    ParamTable& table = gjs->param_table();
+    auto it = table.find(gparam);
+    if (it == table.end()) {
+        gjs_debug(GJS_DEBUG_GPARAM, "Wrapping %s '%s' on %s with JSObject",
+                  g_type_name(G_TYPE_FROM_INSTANCE((GTypeInstance*)gparam)),
+                  gparam->name, g_type_name(gparam->owner_type));
 
-    obj = JS_NewObjectWithGivenProto(context, JS_GetClass(proto), proto);
+        JS::RootedObject proto(context, gjs_lookup_param_prototype(context));
+        if (!proto)
+            return nullptr;
 
-    GJS_INC_COUNTER(param);
-    JS_SetPrivate(obj, gparam);
-    g_param_spec_ref (gparam);
+        JS::RootedObject obj(
+            context,
+            JS_NewObjectWithGivenProto(context, JS_GetClass(proto), proto));
+        if (!obj)
+            return nullptr;
+
+        GJS_INC_COUNTER(param);
+        JS_SetPrivate(obj, gparam);
+        g_param_spec_ref(gparam);
 
-    gjs_debug(GJS_DEBUG_GPARAM,
-              "JSObject created with param instance %p type %s", gparam,
-              g_type_name(G_TYPE_FROM_INSTANCE(gparam)));
+        gjs_debug(GJS_DEBUG_GPARAM,
+                  "JSObject created with param instance %p type %s", gparam,
+                  g_type_name(G_TYPE_FROM_INSTANCE(gparam)));
+
+        it = table.emplace(gparam, obj.get()).first;
+    }
 
-    return obj;
+    if (!s_qdata_owner)
+        s_qdata_owner = gjs;
+    if (gjs == s_qdata_owner)
+        g_param_spec_set_qdata(gparam, gjs_param_wrapper_quark(), &it->second);
+
+    return it->second;
+}
+
+void gjs_param_update_wrappers_after_gc(GjsContextPrivate* gjs) {
+    ParamTable& table = gjs->param_table();
+    for (auto it = table.begin(); it != table.end();) {
+        JS_UpdateWeakPointerAfterGC(&it->second);
+        if (it->second.unbarrieredGet()) {
+            ++it;
+            continue;
+        }
+
+        if (gjs == s_qdata_owner)
+            g_param_spec_set_qdata(it->first, gjs_param_wrapper_quark(),
+                                   nullptr);
+        it = table.erase(it);
+    }
+}
+
+void gjs_param_release_wrappers(GjsContextPrivate* gjs) {
+    ParamTable& table = gjs->param_table();
+    if (gjs == s_qdata_owner) {
+        for (auto& entry : table)
+            g_param_spec_set_qdata(entry.first, gjs_param_wrapper_quark(),
+                                   nullptr);
+        s_qdata_owner = nullptr;
+    }
+    table.clear();
 }
 
 GParamSpec*
@@ -32,6 +32,8 @@
 
 #include "cjs/macros.h"
 
+class GjsContextPrivate;
+
 GJS_JSAPI_RETURN_CONVENTION
 bool gjs_define_param_class(JSContext       *context,
                             JS::HandleObject in_object);
@@ -47,4 +49,7 @@ JSObject*   gjs_param_from_g_param     (JSContext  *context,
 [[nodiscard]] bool gjs_typecheck_param(JSContext* cx, JS::HandleObject obj,
                                        GType expected_type, bool throw_error);
 
+void gjs_param_update_wrappers_after_gc(GjsContextPrivate* gjs);
+void gjs_param_release_wrappers(GjsContextPrivate* gjs);
+
 #endif  // GI_PARAM_H_
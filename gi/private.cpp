@@ -25,21 +25,32 @@
 #include <config.h>
 
 #include <stdint.h>
+#include <string.h>  // for strcmp
 
+#include <algorithm>  // for min
+#include <string>
+
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 
-#include <js/Array.h>  // for JS::GetArrayLength,
+#include <js/Array.h>  // for JS::GetArrayLength, NewArrayObject, ...
 #include <js/CallArgs.h>
+#include <js/Conversions.h>  // for ToInt32, ToString
+#include <js/GCVector.h>     // for RootedVector
 #include <js/Id.h>  // for JSID_TO_SYMBOL
 #include <js/PropertySpec.h>
+#include <js/SavedFrameAPI.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
-#include <jsapi.h>       // for JS_GetElement
+#include <jsapi.h>       // for JS_GetElement, JS_Enumerate
+#include <jsfriendapi.h>  // for GetFunctionNativeReserved, NewFun...
 
+#include "gi/function.h"
 #include "gi/gobject.h"
 #include "gi/gtype.h"
+#include "gi/gvariant.h"
 #include "gi/interface.h"
 #include "gi/object.h"
 #include "gi/param.h"
@@ -200,10 +211,10 @@ static bool gjs_register_interface(JSContext* cx, unsigned argc,
     JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
 
     JS::UniqueChars name;
-    JS::RootedObject interfaces(cx), properties(cx);
-    if (!gjs_parse_call_args(cx, "register_interface", args, "soo", "name",
+    JS::RootedObject interfaces(cx), properties(cx), signals(cx);
+    if (!gjs_parse_call_args(cx, "register_interface", args, "soo|?o", "name",
                              &name, "interfaces", &interfaces, "properties",
-                             &properties))
+                             &properties, "signals", &signals))
         return false;
 
     uint32_t n_interfaces, n_properties;
@@ -247,6 +258,9 @@ static bool gjs_register_interface(JSContext* cx, unsigned argc,
                                           &constructor, &ignored_prototype))
         return false;
 
+    if (signals && !create_signals(cx, interface_type, signals))
+        return false;
+
     args.rval().setObject(*constructor);
     return true;
 }
@@ -264,11 +278,11 @@ static bool gjs_register_type(JSContext* cx, unsigned argc, JS::Value* vp) {
 
     JS::UniqueChars name;
     GTypeFlags type_flags;
-    JS::RootedObject parent(cx), interfaces(cx), properties(cx);
-    if (!gjs_parse_call_args(cx, "register_type", argv, "osioo", "parent",
+    JS::RootedObject parent(cx), interfaces(cx), properties(cx), signals(cx);
+    if (!gjs_parse_call_args(cx, "register_type", argv, "osioo|?o", "parent",
                              &parent, "name", &name, "flags", &type_flags,
                              "interfaces", &interfaces,
-                             "properties", &properties))
+                             "properties", &properties, "signals", &signals))
         return false;
 
     if (!parent)
@@ -336,28 +350,19 @@ static bool gjs_register_type(JSContext* cx, unsigned argc, JS::Value* vp) {
     auto* priv = ObjectPrototype::for_js(cx, prototype);
     priv->set_type_qdata();
 
+    if (signals && !create_signals(cx, instance_type, signals))
+        return false;
+
     argv.rval().setObject(*constructor);
 
     return true;
 }
 
 GJS_JSAPI_RETURN_CONVENTION
-static bool gjs_signal_new(JSContext* cx, unsigned argc, JS::Value* vp) {
-    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
-
-    JS::UniqueChars signal_name;
-    int32_t flags, accumulator_enum;
-    JS::RootedObject gtype_obj(cx), return_gtype_obj(cx), params_obj(cx);
-    if (!gjs_parse_call_args(cx, "signal_new", args, "osiioo", "gtype",
-                             &gtype_obj, "signal name", &signal_name, "flags",
-                             &flags, "accumulator", &accumulator_enum,
-                             "return gtype", &return_gtype_obj, "params",
-                             &params_obj))
-        return false;
-
-    if (!gjs_typecheck_gtype(cx, gtype_obj, true))
-        return false;
-
+static bool create_signal(JSContext* cx, GType gtype, const char* signal_name,
+                          int32_t flags, int32_t accumulator_enum,
+                          GType return_type, JS::HandleObject params_obj,
+                          unsigned* signal_id) {
     /* we only support standard accumulators for now */
     GSignalAccumulator accumulator;
     switch (accumulator_enum) {
@@ -372,10 +377,6 @@ static bool gjs_signal_new(JSContext* cx, unsigned argc, JS::Value* vp) {
             accumulator = nullptr;
     }
 
-    GType return_type;
-    if (!gjs_gtype_get_actual_gtype(cx, return_gtype_obj, &return_type))
-        return false;
-
     if (accumulator == g_signal_accumulator_true_handled &&
         return_type != G_TYPE_BOOLEAN) {
         gjs_throw(cx,
@@ -384,8 +385,8 @@ static bool gjs_signal_new(JSContext* cx, unsigned argc, JS::Value* vp) {
         return false;
     }
 
-    uint32_t n_parameters;
-    if (!JS::GetArrayLength(cx, params_obj, &n_parameters))
+    uint32_t n_parameters = 0;
+    if (params_obj && !JS::GetArrayLength(cx, params_obj, &n_parameters))
         return false;
 
     GType* params = g_newa(GType, n_parameters);
@@ -402,20 +403,433 @@ static bool gjs_signal_new(JSContext* cx, unsigned argc, JS::Value* vp) {
             return false;
     }
 
+    *signal_id = g_signal_newv(
+        signal_name, gtype, GSignalFlags(flags),
+        /* class closure */ nullptr, accumulator, /* accu_data */ nullptr,
+        /* c_marshaller */ nullptr, return_type, n_parameters, params);
+    return true;
+}
+
+// Replaces the pending exception with a TypeError mentioning the signal
+GJS_JSAPI_RETURN_CONVENTION
+static bool throw_invalid_signal(JSContext* cx, const char* signal_name) {
+    JS::RootedValue exc(cx);
+    if (!JS_GetPendingException(cx, &exc))
+        return false;  // uncatchable
+    JS_ClearPendingException(cx);
+
+    JS::UniqueChars message;
+    JS::RootedString exc_str(cx, JS::ToString(cx, exc));
+    if (exc.isObject()) {
+        JS::RootedObject exc_obj(cx, &exc.toObject());
+        JS::RootedValue v_message(cx);
+        const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+        if (JS_GetPropertyById(cx, exc_obj, atoms.message(), &v_message) &&
+            v_message.isString())
+            exc_str = v_message.toString();
+    }
+    JS_ClearPendingException(cx);
+    if (exc_str)
+        message = JS_EncodeStringToUTF8(cx, exc_str);
+    JS_ClearPendingException(cx);
+
+    gjs_throw_custom(cx, JSProto_TypeError, nullptr, "Invalid signal %s: %s",
+                     signal_name, message ? message.get() : "");
+    return false;
+}
+
+/* Creates the signals described by @signals, an object of the form
+ * {name: {flags, accumulator, return_type, param_types}} as in the Signals
+ * property of registerClass(), in one pass, and sets each descriptor's
+ * signal_id. */
+GJS_JSAPI_RETURN_CONVENTION
+static bool create_signals(JSContext* cx, GType gtype,
+                           JS::HandleObject signals) {
+    JS::Rooted<JS::IdVector> ids(cx, cx);
+    if (!JS_Enumerate(cx, signals, &ids))
+        return false;
+
+    JS::RootedValue v_descr(cx), value(cx);
+    JS::RootedObject descr(cx), return_gtype_obj(cx), params_obj(cx);
+    for (size_t ix = 0; ix < ids.length(); ix++) {
+        JS::UniqueChars signal_name;
+        if (!gjs_get_string_id(cx, ids[ix], &signal_name))
+            return false;
+        if (!signal_name)
+            continue;  // symbols don't name signals
+
+        if (!JS_GetPropertyById(cx, signals, ids[ix], &v_descr))
+            return false;
+        if (!v_descr.isObject()) {
+            gjs_throw_custom(cx, JSProto_TypeError, nullptr,
+                             "Invalid signal %s: expected an object",
+                             signal_name.get());
+            return false;
+        }
+        descr = &v_descr.toObject();
+
+        int32_t flags = G_SIGNAL_RUN_FIRST, accumulator = 0;
+        GType return_type = G_TYPE_NONE;
+        params_obj = nullptr;
+
+        unsigned signal_id;
+        if (!JS_GetProperty(cx, descr, "flags", &value) ||
+            (!value.isUndefined() && !JS::ToInt32(cx, value, &flags)) ||
+            !JS_GetProperty(cx, descr, "accumulator", &value) ||
+            (!value.isUndefined() && !JS::ToInt32(cx, value, &accumulator)) ||
+            !JS_GetProperty(cx, descr, "return_type", &value))
+            return throw_invalid_signal(cx, signal_name.get());
+
+        if (!value.isUndefined()) {
+            if (!value.isObject()) {
+                gjs_throw(cx, "Invalid return type");
+                return throw_invalid_signal(cx, signal_name.get());
+            }
+            return_gtype_obj = &value.toObject();
+            if (!gjs_gtype_get_actual_gtype(cx, return_gtype_obj,
+                                            &return_type))
+                return throw_invalid_signal(cx, signal_name.get());
+        }
+
+        if (!JS_GetProperty(cx, descr, "param_types", &value))
+            return throw_invalid_signal(cx, signal_name.get());
+        if (!value.isUndefined()) {
+            if (!value.isObject()) {
+                gjs_throw(cx, "Invalid parameter types");
+                return throw_invalid_signal(cx, signal_name.get());
+            }
+            params_obj = &value.toObject();
+        }
+
+        if (!create_signal(cx, gtype, signal_name.get(), flags, accumulator,
+                           return_type, params_obj, &signal_id))
+            return throw_invalid_signal(cx, signal_name.get());
+
+        // FIXME: what if ID is greater than int32 max?
+        value.setInt32(signal_id);
+        if (!JS_SetProperty(cx, descr, "signal_id", value))
+            return false;
+    }
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_signal_new(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+    JS::UniqueChars signal_name;
+    int32_t flags, accumulator_enum;
+    JS::RootedObject gtype_obj(cx), return_gtype_obj(cx), params_obj(cx);
+    if (!gjs_parse_call_args(cx, "signal_new", args, "osiioo", "gtype",
+                             &gtype_obj, "signal name", &signal_name, "flags",
+                             &flags, "accumulator", &accumulator_enum,
+                             "return gtype", &return_gtype_obj, "params",
+                             &params_obj))
+        return false;
+
+    if (!gjs_typecheck_gtype(cx, gtype_obj, true))
+        return false;
+
+    GType return_type;
+    if (!gjs_gtype_get_actual_gtype(cx, return_gtype_obj, &return_type))
+        return false;
+
     GType gtype;
     if (!gjs_gtype_get_actual_gtype(cx, gtype_obj, &gtype))
         return false;
 
-    unsigned signal_id = g_signal_newv(
-        signal_name.get(), gtype, GSignalFlags(flags),
-        /* class closure */ nullptr, accumulator, /* accu_data */ nullptr,
-        /* c_marshaller */ nullptr, return_type, n_parameters, params);
+    unsigned signal_id;
+    if (!create_signal(cx, gtype, signal_name.get(), flags, accumulator_enum,
+                       return_type, params_obj, &signal_id))
+        return false;
 
     // FIXME: what if ID is greater than int32 max?
     args.rval().setInt32(signal_id);
     return true;
 }
 
+// list_model_items(model, start, count): returns an array of the wrappers of
+// up to @count items of a Gio.ListModel starting at @start, fetched in one
+// native loop rather than with two introspected calls per item
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_list_model_items(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject model_obj(cx);
+    uint32_t start, count;
+    if (!gjs_parse_call_args(cx, "list_model_items", args, "ouu", "model",
+                             &model_obj, "start", &start, "count", &count))
+        return false;
+
+    GObject* model;
+    if (!ObjectBase::typecheck(cx, model_obj, nullptr, G_TYPE_LIST_MODEL) ||
+        !ObjectBase::to_c_ptr(cx, model_obj, &model))
+        return false;
+
+    unsigned n_items = g_list_model_get_n_items(G_LIST_MODEL(model));
+    if (start >= n_items)
+        count = 0;
+    else
+        count = std::min(count, n_items - start);
+
+    JS::RootedObject array(cx, JS::NewArrayObject(cx, count));
+    if (!array)
+        return false;
+
+    JS::RootedObject item_obj(cx);
+    for (unsigned ix = 0; ix < count; ix++) {
+        GjsAutoUnref<GObject> item = static_cast<GObject*>(
+            g_list_model_get_item(G_LIST_MODEL(model), start + ix));
+        if (!item) {
+            // The model shrank while its items were being wrapped
+            if (!JS::SetArrayLength(cx, array, ix))
+                return false;
+            break;
+        }
+
+        item_obj = ObjectInstance::wrapper_from_gobject(cx, item);
+        if (!item_obj || !JS_DefineElement(cx, array, ix, item_obj,
+                                           JSPROP_ENUMERATE))
+            return false;
+    }
+
+    args.rval().setObject(*array);
+    return true;
+}
+
+// Gio.Settings methods that take a key or child name are wrapped by the Gio
+// override, so that a name not in the schema throws instead of asserting. The
+// names, with the value types of the keys, are put in a hash table on the
+// Gio.Settings the first time one is checked, so that a checked call costs one
+// lookup on top of the introspected call.
+enum GjsSettingsCheckSlot {
+    SETTINGS_CHECK_REAL_METHOD,
+    SETTINGS_CHECK_KIND,
+};
+
+// The kinds of check; the ones after SETTINGS_CHECK_ANY_KEY also check that
+// the key's value has the type that the method handles
+static const char* const settings_check_kinds[] = {
+    "child", "key", "b", "d", "i", "x", "u", "t", "s", "as",
+};
+enum { SETTINGS_CHECK_CHILD, SETTINGS_CHECK_ANY_KEY };
+
+static GHashTable* settings_name_table(GSettings* settings, bool children) {
+    static GQuark keys_quark = g_quark_from_static_string("gjs::settings-keys");
+    static GQuark children_quark =
+        g_quark_from_static_string("gjs::settings-children");
+    GQuark quark = children ? children_quark : keys_quark;
+
+    auto* table =
+        static_cast<GHashTable*>(g_object_get_qdata(G_OBJECT(settings), quark));
+    if (table)
+        return table;
+
+    GSettingsSchema* schema;
+    g_object_get(settings, "settings-schema", &schema, nullptr);
+    GjsAutoStrv names = children ? g_settings_schema_list_children(schema)
+                                 : g_settings_schema_list_keys(schema);
+
+    table = g_hash_table_new_full(
+        g_str_hash, g_str_equal, g_free,
+        children ? nullptr : GDestroyNotify(g_variant_type_free));
+    for (char** name = names; *name; name++) {
+        GVariantType* type = nullptr;
+        if (!children) {
+            GSettingsSchemaKey* key = g_settings_schema_get_key(schema, *name);
+            type = g_variant_type_copy(
+                g_settings_schema_key_get_value_type(key));
+            g_settings_schema_key_unref(key);
+        }
+        g_hash_table_insert(table, g_strdup(*name), type);
+    }
+    g_settings_schema_unref(schema);
+
+    g_object_set_qdata_full(G_OBJECT(settings), quark, table,
+                            GDestroyNotify(g_hash_table_unref));
+    return table;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool settings_checked_method(JSContext* cx, unsigned argc,
+                                    JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedValue real_method(
+        cx, js::GetFunctionNativeReserved(&args.callee(),
+                                          SETTINGS_CHECK_REAL_METHOD));
+    int32_t kind =
+        js::GetFunctionNativeReserved(&args.callee(), SETTINGS_CHECK_KIND)
+            .toInt32();
+
+    // Anything unexpected is left to the introspected method to complain about
+    GSettings* settings = nullptr;
+    if (args.thisv().isObject() && args.length() > 0 && args[0].isString()) {
+        JS::RootedObject this_obj(cx, &args.thisv().toObject());
+        GObject* gobj;
+        if (ObjectBase::typecheck(cx, this_obj, nullptr, G_TYPE_SETTINGS,
+                                  GjsTypecheckNoThrow())) {
+            if (!ObjectBase::to_c_ptr(cx, this_obj, &gobj))
+                return false;
+            settings = G_SETTINGS(gobj);
+        }
+    }
+
+    if (settings) {
+        JS::RootedString name_str(cx, args[0].toString());
+        JS::UniqueChars name(JS_EncodeStringToUTF8(cx, name_str));
+        if (!name)
+            return false;
+
+        GHashTable* table =
+            settings_name_table(settings, kind == SETTINGS_CHECK_CHILD);
+        void* type;
+        if (!g_hash_table_lookup_extended(table, name.get(), nullptr, &type)) {
+            char* id;
+            g_object_get(settings, "schema-id", &id, nullptr);
+            GjsAutoChar schema_id = id;
+            if (kind == SETTINGS_CHECK_CHILD)
+                gjs_throw(cx, "Child %s not found in GSettings schema %s",
+                          name.get(), schema_id.get());
+            else
+                gjs_throw(cx, "GSettings key %s not found in schema %s",
+                          name.get(), schema_id.get());
+            return false;
+        }
+
+        if (kind > SETTINGS_CHECK_ANY_KEY) {
+            const char* expected = settings_check_kinds[kind];
+            auto* key_type = static_cast<GVariantType*>(type);
+            if (!g_variant_type_equal(key_type, G_VARIANT_TYPE(expected))) {
+                GjsAutoChar type_string = g_variant_type_dup_string(key_type);
+                gjs_throw(cx,
+                          "GSettings key %s holds a value of type %s, not %s",
+                          name.get(), type_string.get(), expected);
+                return false;
+            }
+        }
+    }
+
+    return JS::Call(cx, args.thisv(), real_method, args, args.rval());
+}
+
+// settings_checked_method(method, kind): returns a version of the Gio.Settings
+// method @method that checks its first argument; @kind is "child" for child
+// names, "key" for keys, or the GVariant type string that the value of the key
+// must have
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_settings_checked_method(JSContext* cx, unsigned argc,
+                                        JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject method(cx);
+    JS::UniqueChars kind_name;
+    if (!gjs_parse_call_args(cx, "settings_checked_method", args, "os",
+                             "method", &method, "kind", &kind_name))
+        return false;
+
+    if (!JS_ObjectIsFunction(method) ||
+        !JS_GetFunctionId(JS_GetObjectFunction(method))) {
+        gjs_throw(cx, "settings_checked_method() needs a named function");
+        return false;
+    }
+
+    int32_t kind = -1;
+    for (size_t ix = 0; ix < G_N_ELEMENTS(settings_check_kinds); ix++) {
+        if (strcmp(kind_name.get(), settings_check_kinds[ix]) == 0) {
+            kind = ix;
+            break;
+        }
+    }
+    if (kind < 0) {
+        gjs_throw(cx, "Unknown kind of settings check '%s'", kind_name.get());
+        return false;
+    }
+
+    // Keep the name of the method for stack traces
+    JS::RootedString method_name(
+        cx, JS_GetFunctionId(JS_GetObjectFunction(method)));
+    JS::RootedId name(cx);
+    if (!JS_StringToId(cx, method_name, &name))
+        return false;
+    JSFunction* func = js::NewFunctionByIdWithReserved(
+        cx, settings_checked_method, 1, 0, name);
+    if (!func)
+        return false;
+
+    JSObject* func_obj = JS_GetFunctionObject(func);
+    js::SetFunctionNativeReserved(func_obj, SETTINGS_CHECK_REAL_METHOD,
+                                  JS::ObjectValue(*method));
+    js::SetFunctionNativeReserved(func_obj, SETTINGS_CHECK_KIND,
+                                  JS::Int32Value(kind));
+
+    args.rval().setObject(*func_obj);
+    return true;
+}
+
+// caller_basename(): for GObject.gtypeNameBasedOnJSPath, returns "dir_file"
+// for the innermost .js file on the stack other than the caller's own and
+// GJS's internal modules, or null. Walks the saved frames instead of parsing
+// the string of an Error's stack.
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_caller_basename(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    args.rval().setNull();
+
+    JS::RootedObject frame(cx);
+    if (!JS::CaptureCurrentStack(cx, &frame))
+        return false;
+
+    JS::RootedString source(cx);
+    std::string this_file;
+    bool have_this_file = false;
+    auto ok = JS::SavedFrameResult::Ok;
+    while (frame) {
+        if (JS::GetSavedFrameSource(cx, nullptr, frame, &source) != ok ||
+            !source) {
+            gjs_throw(cx, "Error getting saved frame information");
+            return false;
+        }
+        JS::UniqueChars chars(JS_EncodeStringToUTF8(cx, source));
+        if (!chars)
+            return false;
+
+        // Same as matching "(scheme://)?(dir/)?(basename).js"
+        std::string path(chars.get());
+        size_t scheme_end = path.rfind("://");
+        if (scheme_end != std::string::npos)
+            path.erase(0, scheme_end + strlen("://"));
+        size_t dir_end = path.rfind('/');
+        size_t base_start = dir_end == std::string::npos ? 0 : dir_end + 1;
+
+        if (g_str_has_suffix(path.c_str(), ".js") &&
+            path.size() - base_start > strlen(".js")) {
+            if (!have_this_file) {
+                this_file = path;
+                have_this_file = true;
+            } else if (path != this_file &&
+                       !g_str_has_prefix(path.c_str(), "/org/gnome/gjs/")) {
+                std::string basename =
+                    path.substr(base_start,
+                                path.size() - base_start - strlen(".js"));
+                if (dir_end != std::string::npos) {
+                    // Prefix the name of the innermost directory
+                    std::string dir = path.substr(0, dir_end);
+                    size_t last = dir.rfind('/');
+                    if (last != std::string::npos)
+                        dir.erase(0, last + 1);
+                    basename = dir + "_" + basename;
+                }
+                return gjs_string_from_utf8_n(cx, basename.c_str(),
+                                              basename.size(), args.rval());
+            }
+        }
+
+        if (JS::GetSavedFrameParent(cx, nullptr, frame, &frame) != ok) {
+            gjs_throw(cx, "Error getting saved frame information");
+            return false;
+        }
+    }
+    return true;
+}
+
 template <GjsSymbolAtom GjsAtoms::*member>
 GJS_JSAPI_RETURN_CONVENTION static bool symbol_getter(JSContext* cx,
                                                       unsigned argc,
@@ -428,10 +842,20 @@ GJS_JSAPI_RETURN_CONVENTION static bool symbol_getter(JSContext* cx,
 
 static JSFunctionSpec module_funcs[] = {
     JS_FN("override_property", gjs_override_property, 2, GJS_MODULE_PROP_FLAGS),
-    JS_FN("register_interface", gjs_register_interface, 3,
+    JS_FN("register_interface", gjs_register_interface, 4,
           GJS_MODULE_PROP_FLAGS),
-    JS_FN("register_type", gjs_register_type, 4, GJS_MODULE_PROP_FLAGS),
+    JS_FN("register_type", gjs_register_type, 6, GJS_MODULE_PROP_FLAGS),
     JS_FN("signal_new", gjs_signal_new, 6, GJS_MODULE_PROP_FLAGS),
+    JS_FN("variant_pack", gjs_variant_pack, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FN("variant_unpack", gjs_variant_unpack, 3, GJS_MODULE_PROP_FLAGS),
+    JS_FN("variant_unpack_async", gjs_variant_unpack_async, 3,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("caller_basename", gjs_caller_basename, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("dbus_proxy_call", gjs_dbus_proxy_call, 6, GJS_MODULE_PROP_FLAGS),
+    JS_FN("list_model_items", gjs_list_model_items, 3, GJS_MODULE_PROP_FLAGS),
+    JS_FN("promisify", gjs_function_promisify, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FN("settings_checked_method", gjs_settings_checked_method, 2,
+          GJS_MODULE_PROP_FLAGS),
     JS_FS_END,
 };
 
@@ -24,7 +24,14 @@
 #include <config.h>
 
 #include <stdint.h>
-#include <string.h>  // for strlen
+#include <stdio.h>   // for FILE, fprintf
+#include <string.h>  // for strlen, strcmp
+
+#include <algorithm>  // for sort
+#include <string>
+#include <unordered_map>
+#include <utility>  // for pair, move
+#include <vector>
 
 #include <girepository.h>
 #include <glib-object.h>
@@ -59,6 +66,7 @@
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/mem-private.h"
+#include "cjs/profiler-private.h"
 #include "util/log.h"
 
 typedef struct {
@@ -70,6 +78,32 @@ extern struct JSClass gjs_repo_class;
 
 GJS_DEFINE_PRIV_FROM_JS(Repo, gjs_repo_class)
 
+// Opt-in per-namespace statistics, enabled with the GJS_PROFILE_TYPELIBS
+// environment variable. Like the function statistics, they are kept for the
+// lifetime of the process.
+struct GjsTypelibStats {
+    int64_t require_us;
+    int64_t override_us;
+    unsigned infos_resolved;
+};
+
+static std::unordered_map<std::string, GjsTypelibStats> typelib_stats;
+
+[[nodiscard]] static bool typelib_stats_enabled() {
+    static const bool enabled = g_getenv("GJS_PROFILE_TYPELIBS");
+    return enabled;
+}
+
+// With GJS_LAZY_OVERRIDES set, the override module of a namespace is only
+// evaluated when something other than a plain function is first looked up in
+// it. GLib, GObject and Gio are always overridden right away, since GJS itself
+// relies on their overrides.
+[[nodiscard]] static bool defer_override(const char* ns_name) {
+    static const bool lazy = g_getenv("GJS_LAZY_OVERRIDES");
+    return lazy && strcmp(ns_name, "GLib") != 0 &&
+           strcmp(ns_name, "GObject") != 0 && strcmp(ns_name, "Gio") != 0;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool lookup_override_function(JSContext *, JS::HandleId,
                                      JS::MutableHandleValue);
@@ -111,6 +145,8 @@ static bool resolve_namespace_object(JSContext* context,
         gjs_throw(context, "Requiring invalid namespace on imports.gi");
         return false;
     }
+    GjsAutoProfilerMark mark(context, "Resolve GI namespace", "%s",
+                             ns_name.get());
 
     GList* versions = g_irepository_enumerate_versions(nullptr, ns_name.get());
     unsigned nversions = g_list_length(versions);
@@ -123,9 +159,15 @@ static bool resolve_namespace_object(JSContext* context,
         return false;
     g_list_free_full(versions, g_free);
 
+    int64_t start = typelib_stats_enabled() ? g_get_monotonic_time() : 0;
     error = NULL;
-    g_irepository_require(nullptr, ns_name.get(), version.get(),
-                          GIRepositoryLoadFlags(0), &error);
+    {
+        GjsAutoProfilerMark require_mark(context, "Load typelib", "%s-%s",
+                                         ns_name.get(),
+                                         version ? version.get() : "any");
+        g_irepository_require(nullptr, ns_name.get(), version.get(),
+                              GIRepositoryLoadFlags(0), &error);
+    }
     if (error != NULL) {
         gjs_throw(context, "Requiring %s, version %s: %s", ns_name.get(),
                   version ? version.get() : "none", error->message);
@@ -133,13 +175,17 @@ static bool resolve_namespace_object(JSContext* context,
         g_error_free(error);
         return false;
     }
+    if (typelib_stats_enabled())
+        typelib_stats[ns_name.get()].require_us +=
+            g_get_monotonic_time() - start;
 
     /* Defines a property on "obj" (the javascript repo object)
      * with the given namespace name, pointing to that namespace
      * in the repo.
      */
-    JS::RootedObject gi_namespace(context,
-                                  gjs_create_ns(context, ns_name.get()));
+    bool lazy_override = defer_override(ns_name.get());
+    JS::RootedObject gi_namespace(
+        context, gjs_create_ns(context, ns_name.get(), lazy_override));
 
     /* Define the property early, to avoid reentrancy issues if
        the override module looks for namespaces that import this */
@@ -147,15 +193,8 @@ static bool resolve_namespace_object(JSContext* context,
                                GJS_MODULE_PROP_FLAGS))
         return false;
 
-    JS::RootedValue override(context);
-    if (!lookup_override_function(context, ns_id, &override))
-        return false;
-
-    JS::RootedValue result(context);
-    if (!override.isUndefined() &&
-        !JS_CallFunctionValue (context, gi_namespace, /* thisp */
-                               override, /* callee */
-                               JS::HandleValueArray::empty(), &result))
+    if (!lazy_override &&
+        !gjs_load_namespace_override(context, gi_namespace, ns_name.get()))
         return false;
 
     gjs_debug(GJS_DEBUG_GNAMESPACE,
@@ -304,6 +343,10 @@ repo_new(JSContext *context)
                                JSPROP_PERMANENT))
         return nullptr;
 
+    if (!JS_DefineFunction(context, repo, "batch", gjs_function_batch, 1,
+                           GJS_MODULE_PROP_FLAGS | JSPROP_RESOLVING))
+        return nullptr;
+
     JS::RootedObject private_ns(context, JS_NewPlainObject(context));
     if (!JS_DefinePropertyById(context, repo, atoms.private_ns_marker(),
                                private_ns, JSPROP_PERMANENT | JSPROP_RESOLVING))
@@ -428,6 +471,10 @@ gjs_define_info(JSContext       *context,
     _gjs_log_info_usage(info);
 #endif
 
+    GjsAutoProfilerMark mark(context, "Define GI info", "%s.%s",
+                             g_base_info_get_namespace(info),
+                             g_base_info_get_name(info));
+
     *defined = true;
 
     switch (g_base_info_get_type(info)) {
@@ -642,6 +689,61 @@ lookup_override_function(JSContext             *cx,
     return false;
 }
 
+bool gjs_load_namespace_override(JSContext* cx, JS::HandleObject gi_namespace,
+                                 const char* ns_name) {
+    JS::RootedId ns_id(cx, gjs_intern_string_to_id(cx, ns_name));
+    if (ns_id == JSID_VOID)
+        return false;
+
+    int64_t start = typelib_stats_enabled() ? g_get_monotonic_time() : 0;
+    GjsAutoProfilerMark mark(cx, "Run GI override", "%s", ns_name);
+
+    JS::RootedValue override(cx);
+    if (!lookup_override_function(cx, ns_id, &override))
+        return false;
+
+    JS::RootedValue result(cx);
+    if (!override.isUndefined() &&
+        !JS_CallFunctionValue(cx, gi_namespace, /* thisp */
+                              override,         /* callee */
+                              JS::HandleValueArray::empty(), &result))
+        return false;
+
+    if (typelib_stats_enabled())
+        typelib_stats[ns_name].override_us += g_get_monotonic_time() - start;
+    return true;
+}
+
+void gjs_typelib_stats_info_resolved(const char* ns_name) {
+    if (G_UNLIKELY(typelib_stats_enabled()))
+        typelib_stats[ns_name].infos_resolved++;
+}
+
+bool gjs_typelib_stats_dump(FILE* fp) {
+    if (!typelib_stats_enabled())
+        return false;
+
+    using Entry = std::pair<const std::string, GjsTypelibStats>;
+    std::vector<const Entry*> sorted;
+    sorted.reserve(typelib_stats.size());
+    for (const Entry& it : typelib_stats)
+        sorted.push_back(&it);
+    std::sort(sorted.begin(), sorted.end(), [](const Entry* a, const Entry* b) {
+        return a->second.require_us + a->second.override_us >
+               b->second.require_us + b->second.override_us;
+    });
+
+    fprintf(fp, "%12s %12s %12s  %s\n", "require ms", "override ms", "infos",
+            "namespace");
+    for (const Entry* entry : sorted) {
+        const GjsTypelibStats& stats = entry->second;
+        fprintf(fp, "%12.3f %12.3f %12u  %s\n", stats.require_us / 1e3,
+                stats.override_us / 1e3, stats.infos_resolved,
+                entry->first.c_str());
+    }
+    return true;
+}
+
 JSObject*
 gjs_lookup_namespace_object_by_name(JSContext      *context,
                                     JS::HandleId    ns_name)
@@ -739,6 +841,58 @@ gjs_hyphen_from_camel(const char *camel_name)
     return g_string_free(s, false);
 }
 
+// The resolve hooks convert the same names over and over, so conversions are
+// cached. Resolving also sees names that are not properties, such as computed
+// keys, so the cache stops growing after a while; later names are converted
+// into @storage instead. Entries are never removed, so cached strings stay
+// valid.
+static constexpr unsigned MAX_CACHED_PROPERTY_NAMES = 4096;
+
+const char* gjs_canonical_property_name(const char* js_name,
+                                        GjsAutoChar* storage) {
+    static GHashTable* cache =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    auto* canonical =
+        static_cast<const char*>(g_hash_table_lookup(cache, js_name));
+    if (canonical)
+        return canonical;
+
+    GjsAutoChar converted = gjs_hyphen_from_camel(js_name);
+    /* Taken from GLib */
+    for (char* p = converted; *p; p++) {
+        char c = *p;
+        if (c != '-' && (c < '0' || c > '9') && (c < 'A' || c > 'Z') &&
+            (c < 'a' || c > 'z'))
+            *p = '-';
+    }
+
+    if (g_hash_table_size(cache) >= MAX_CACHED_PROPERTY_NAMES) {
+        *storage = std::move(converted);
+        return *storage;
+    }
+    char* cached = converted.release();
+    g_hash_table_insert(cache, g_strdup(js_name), cached);
+    return cached;
+}
+
+// Only called with the names of GParamSpecs, which are interned by GLib
+// already, so this cache is bounded by the properties that exist.
+const char* gjs_underscore_property_name(const char* gobject_name) {
+    static GHashTable* cache = g_hash_table_new(g_str_hash, g_str_equal);
+
+    auto* underscore =
+        static_cast<const char*>(g_hash_table_lookup(cache, gobject_name));
+    if (underscore)
+        return underscore;
+
+    GjsAutoChar converted = gjs_hyphen_to_underscore(gobject_name);
+    underscore = g_intern_string(converted);
+    g_hash_table_insert(cache, const_cast<char*>(g_intern_string(gobject_name)),
+                        const_cast<char*>(underscore));
+    return underscore;
+}
+
 JSObject *
 gjs_lookup_generic_constructor(JSContext  *context,
                                GIBaseInfo *info)
@@ -26,10 +26,13 @@
 
 #include <config.h>
 
+#include <stdio.h>  // for FILE
+
 #include <girepository.h>
 
 #include <js/TypeDecls.h>
 
+#include "cjs/jsapi-util.h"
 #include "cjs/macros.h"
 #include "util/log.h"
 
@@ -48,6 +51,17 @@ GJS_JSAPI_RETURN_CONVENTION
 JSObject *gjs_lookup_namespace_object_by_name(JSContext   *context,
                                               JS::HandleId name);
 
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_load_namespace_override(JSContext* cx, JS::HandleObject gi_namespace,
+                                 const char* ns_name);
+
+void gjs_typelib_stats_info_resolved(const char* ns_name);
+
+// Prints the time spent loading each namespace's typelib and override module,
+// and how many of its infos were defined. Returns false if the statistics are
+// not being collected.
+bool gjs_typelib_stats_dump(FILE* fp);
+
 GJS_JSAPI_RETURN_CONVENTION
 JSObject *  gjs_lookup_generic_constructor      (JSContext      *context,
                                                  GIBaseInfo     *info);
@@ -66,6 +80,17 @@ bool gjs_define_info(JSContext       *context,
 
 [[nodiscard]] char* gjs_hyphen_from_camel(const char* camel_name);
 
+// Cached conversions between JS and GObject property names. The returned
+// strings must not be freed. gjs_canonical_property_name() turns any of
+// "someProp", "some_prop" and "some-prop" into "some-prop"; once its cache is
+// full, the result may be put in @storage, so it is only valid as long as
+// @storage is. gjs_underscore_property_name() turns the name of a GParamSpec,
+// "some-prop", into "some_prop". They must only be called from the JS thread.
+[[nodiscard]] const char* gjs_canonical_property_name(const char* js_name,
+                                                      GjsAutoChar* storage);
+[[nodiscard]] const char* gjs_underscore_property_name(
+    const char* gobject_name);
+
 #if GJS_VERBOSE_ENABLE_GI_USAGE
 void _gjs_log_info_usage(GIBaseInfo *info);
 #endif
@@ -23,80 +23,193 @@
  * Authored by: Philip Chimento <philip@endlessm.com>, <philip.chimento@gmail.com>
  */
 
-#include <algorithm>  // for find_if
+#include <stdint.h>
+#include <stdlib.h>  // for strtoll
+
+#include <algorithm>  // for max
+#include <atomic>
 #include <deque>
-#include <mutex>
 #include <utility>  // for pair
 
 #include <glib-object.h>
 #include <glib.h>
 
+#include "cjs/context-private.h"
+#include "cjs/mem-private.h"
+#include "cjs/profiler-private.h"
 #include "gi/toggle.h"
 
-std::deque<ToggleQueue::Item>::iterator
-ToggleQueue::find_operation_locked(const GObject               *gobj,
-                                   ToggleQueue::Direction direction) {
-    return std::find_if(q.begin(), q.end(),
-        [gobj, direction](const Item& item)->bool {
-            return item.gobj == gobj && item.direction == direction;
-        });
+/* Default time to spend handling toggles in each main loop iteration; more
+ * than this risks dropping frames after tearing down a big widget tree. */
+static constexpr int64_t DEFAULT_BUDGET_USEC = 1000;
+
+/* Check the clock only every so many toggles, since handling one is cheap */
+static constexpr unsigned BUDGET_CHECK_INTERVAL = 16;
+
+ToggleQueue::ToggleQueue(GjsContextPrivate* owner)
+    : m_owner(owner), m_budget_usec(DEFAULT_BUDGET_USEC) {
+    const char* budget_ms = g_getenv("GJS_TOGGLE_QUEUE_BUDGET");
+    if (budget_ms)
+        m_budget_usec = std::max(strtoll(budget_ms, nullptr, 10), 0LL) * 1000;
 }
 
-std::deque<ToggleQueue::Item>::const_iterator
-ToggleQueue::find_operation_locked(const GObject *gobj,
-                                   ToggleQueue::Direction direction) const {
-    return std::find_if(q.begin(), q.end(),
-        [gobj, direction](const Item& item)->bool {
-            return item.gobj == gobj && item.direction == direction;
-        });
+ToggleQueue::~ToggleQueue() {
+    GSource* source = m_idle_source.exchange(nullptr);
+    if (source) {
+        g_source_destroy(source);
+        g_source_unref(source);
+    }
 }
 
-bool
-ToggleQueue::find_and_erase_operation_locked(const GObject               *gobj,
-                                             ToggleQueue::Direction direction)
-{
-    auto pos = find_operation_locked(gobj, direction);
-    bool had_toggle = (pos != q.end());
-    if (had_toggle)
-        q.erase(pos);
-    return had_toggle;
+GQuark ToggleQueue::state_quark() {
+    static GQuark quark = g_quark_from_static_string("gjs::toggle-state");
+    return quark;
+}
+
+ToggleQueue::State* ToggleQueue::get_state(const GObject* gobj) {
+    return static_cast<State*>(
+        g_object_get_qdata(const_cast<GObject*>(gobj), state_quark()));
+}
+
+void ToggleQueue::unref_state(void* data) {
+    auto* state = static_cast<State*>(data);
+    if (g_atomic_ref_count_dec(&state->refcount))
+        delete state;
+}
+
+/* May be called from any thread; if two threads race to attach the state word,
+ * the loser discards its own and uses the winner's. */
+ToggleQueue::State* ToggleQueue::ensure_state(GObject* gobj) {
+    State* state = get_state(gobj);
+    if (state)
+        return state;
+
+    auto* new_state = new State;
+    new_state->word = 0;
+    g_atomic_ref_count_init(&new_state->refcount);
+    if (g_object_replace_qdata(gobj, state_quark(), nullptr, new_state,
+                               unref_state, nullptr))
+        return new_state;
+
+    delete new_state;
+    return get_state(gobj);
+}
+
+/* Moves everything enqueued since the last call into m_pending, restoring the
+ * order in which it was enqueued. */
+void ToggleQueue::take_incoming() {
+    Item* item = m_incoming.exchange(nullptr, std::memory_order_acquire);
+    Item* reversed = nullptr;
+    while (item) {
+        Item* next = item->next;
+        item->next = reversed;
+        reversed = item;
+        item = next;
+    }
+    for (; reversed; reversed = reversed->next)
+        m_pending.push_back(reversed);
+}
+
+/* Clears the pending bit for @item in its GObject's state word. Returns false
+ * if the item was cancelled after being enqueued, in which case the GObject
+ * may already have been freed. */
+bool ToggleQueue::mark_handled(const Item* item) {
+    uint32_t bit = direction_bit(item->direction);
+    uint32_t word = item->state->word.load(std::memory_order_relaxed);
+    do {
+        if ((word >> STATE_EPOCH_SHIFT) != item->epoch || !(word & bit))
+            return false;
+    } while (!item->state->word.compare_exchange_weak(
+        word, word & ~bit, std::memory_order_acq_rel));
+    return true;
+}
+
+/* Handles toggles until the queue is empty or @deadline (monotonic time) has
+ * passed; a @deadline of 0 means no limit. Returns true if the queue was
+ * emptied. */
+bool ToggleQueue::handle_toggles_until(int64_t deadline) {
+    Handler handler = m_toggle_handler;
+    unsigned count = 0;
+    while (handle_toggle(handler)) {
+        if (deadline && ++count % BUDGET_CHECK_INTERVAL == 0 &&
+            g_get_monotonic_time() >= deadline)
+            return !has_pending();
+    }
+    return true;
+}
+
+void ToggleQueue::report_counters() const {
+    GjsProfiler* profiler = m_owner->profiler();
+    if (!profiler)
+        return;
+    _gjs_profiler_set_counter(profiler, GJS_PROFILER_COUNTER_TOGGLE_QUEUE_LENGTH,
+                              m_length);
+    _gjs_profiler_set_counter(profiler,
+                              GJS_PROFILER_COUNTER_TOGGLE_DRAIN_LATENCY,
+                              m_last_latency_usec);
 }
 
 gboolean
 ToggleQueue::idle_handle_toggle(void *data)
 {
     auto self = static_cast<ToggleQueue *>(data);
-    while (self->handle_toggle(self->m_toggle_handler))
-        ;
+    int64_t deadline = 0;
+    if (self->m_budget_usec)
+        deadline = g_get_monotonic_time() + self->m_budget_usec;
 
-    return G_SOURCE_REMOVE;
-}
+    while (true) {
+        if (!self->handle_toggles_until(deadline)) {
+            /* Out of time; continue in the next main loop iteration, but let
+             * sources of default priority, such as redraws, go first. */
+            g_source_set_priority(g_main_current_source(),
+                                  G_PRIORITY_DEFAULT_IDLE);
+            self->report_counters();
+            return G_SOURCE_CONTINUE;
+        }
 
-void
-ToggleQueue::idle_destroy_notify(void *data)
-{
-    auto self = static_cast<ToggleQueue *>(data);
-    std::lock_guard<std::mutex> hold(self->lock);
-    self->m_idle_id = 0;
-    self->m_toggle_handler = nullptr;
+        /* Clear the flag before checking once more, so that a toggle enqueued
+         * on another thread from now on schedules a new idle instead of
+         * getting lost. If one was enqueued in between, take the flag back,
+         * unless another idle was scheduled already. */
+        self->m_idle_scheduled = false;
+        if (!self->has_pending() || self->m_idle_scheduled.exchange(true))
+            break;
+    }
+
+    self->report_counters();
+    return G_SOURCE_REMOVE;
 }
 
 std::pair<bool, bool>
-ToggleQueue::is_queued(GObject *gobj) const
+ToggleQueue::is_queued(GObject *gobj)
 {
-    std::lock_guard<std::mutex> hold(lock);
-    bool has_toggle_down = find_operation_locked(gobj, DOWN) != q.end();
-    bool has_toggle_up = find_operation_locked(gobj, UP) != q.end();
-    return {has_toggle_down, has_toggle_up};
+    State* state = get_state(gobj);
+    if (!state)
+        return {false, false};
+
+    uint32_t word = state->word.load(std::memory_order_acquire);
+    return {!!(word & STATE_DOWN), !!(word & STATE_UP)};
 }
 
 std::pair<bool, bool>
 ToggleQueue::cancel(GObject *gobj)
 {
     debug("cancel", gobj);
-    std::lock_guard<std::mutex> hold(lock);
-    bool had_toggle_down = find_and_erase_operation_locked(gobj, DOWN);
-    bool had_toggle_up = find_and_erase_operation_locked(gobj, UP);
+
+    bool had_toggle_down = false, had_toggle_up = false;
+    State* state = get_state(gobj);
+    if (state) {
+        uint32_t word = state->word.load(std::memory_order_relaxed);
+        uint32_t new_word;
+        do {
+            uint32_t epoch = (word >> STATE_EPOCH_SHIFT) + 1;
+            new_word = epoch << STATE_EPOCH_SHIFT;
+        } while (!state->word.compare_exchange_weak(
+            word, new_word, std::memory_order_acq_rel));
+        had_toggle_down = word & STATE_DOWN;
+        had_toggle_up = word & STATE_UP;
+    }
+
     gjs_debug_lifecycle(GJS_DEBUG_GOBJECT, "ToggleQueue: %p (%s) was %s", gobj,
                         G_OBJECT_TYPE_NAME(gobj),
                         had_toggle_down && had_toggle_up ? "queued to toggle BOTH"
@@ -109,22 +222,38 @@ ToggleQueue::cancel(GObject *gobj)
 bool
 ToggleQueue::handle_toggle(Handler handler)
 {
-    Item item;
-    {
-        std::lock_guard<std::mutex> hold(lock);
-        if (q.empty())
-            return false;
+    while (true) {
+        if (m_pending.empty()) {
+            take_incoming();
+            if (m_pending.empty())
+                return false;
+        }
 
-        item = q.front();
-        handler(item.gobj, item.direction);
-        q.pop_front();
-    }
+        Item* item = m_pending.front();
+        m_pending.pop_front();
+        m_length--;
+        GJS_SUB_BYTES(toggle_queue, sizeof(Item));
 
-    debug("handle", item.gobj);
-    if (item.needs_unref)
-        g_object_unref(item.gobj);
+        if (!mark_handled(item)) {
+            /* Cancelled; the canceller takes care of the object, as it did
+             * when cancelled items were removed from the queue */
+            debug("skip cancelled", item->gobj);
+            unref_state(item->state);
+            delete item;
+            continue;
+        }
 
-    return true;
+        handler(item->gobj, item->direction);
+        m_last_latency_usec = g_get_monotonic_time() - item->enqueue_time;
+
+        debug("handle", item->gobj);
+        if (item->needs_unref)
+            g_object_unref(item->gobj);
+
+        unref_state(item->state);
+        delete item;
+        return true;
+    }
 }
 
 void
@@ -132,7 +261,7 @@ ToggleQueue::shutdown(void)
 {
     debug("shutdown", nullptr);
     g_assert(((void)"Queue should have been emptied before shutting down",
-              q.empty()));
+              m_pending.empty() && !m_incoming.load()));
     m_shutdown = true;
 }
 
@@ -149,7 +278,9 @@ ToggleQueue::enqueue(GObject               *gobj,
         return;
     }
 
-    Item item{gobj, direction};
+    auto* item = new Item{gobj,      nullptr, nullptr, g_get_monotonic_time(), 0,
+                          direction, false};
+    GJS_ADD_BYTES(toggle_queue, sizeof(Item));
     /* If we're toggling up we take a reference to the object now,
      * so it won't toggle down before we process it. This ensures we
      * only ever have at most two toggle notifications queued.
@@ -158,7 +289,7 @@ ToggleQueue::enqueue(GObject               *gobj,
     if (direction == UP) {
         debug("enqueue UP", gobj);
         g_object_ref(gobj);
-        item.needs_unref = true;
+        item->needs_unref = true;
     } else {
         debug("enqueue DOWN", gobj);
     }
@@ -169,18 +300,38 @@ ToggleQueue::enqueue(GObject               *gobj,
      *
      * Taking a reference now would be bad anyway, since it would force
      * the object to toggle back up again.
-     */   
-
-    std::lock_guard<std::mutex> hold(lock);
-    q.push_back(item);
-    
-    if (m_idle_id) {
-        g_assert(((void) "Should always enqueue with the same handler",
-                  m_toggle_handler == handler));
-        return;
-    }
+     */
+
+    /* Mark the toggle as pending and remember in which epoch it was queued,
+     * in a single atomic step, so that a concurrent cancel() either sees the
+     * bit or makes this item stale. */
+    State* state = ensure_state(gobj);
+    g_atomic_ref_count_inc(&state->refcount);
+    item->state = state;
+    uint32_t word = state->word.load(std::memory_order_relaxed);
+    do {
+        item->epoch = word >> STATE_EPOCH_SHIFT;
+    } while (!state->word.compare_exchange_weak(
+        word, word | direction_bit(direction), std::memory_order_acq_rel));
+
+    m_length++;
+    item->next = m_incoming.load(std::memory_order_relaxed);
+    while (!m_incoming.compare_exchange_weak(item->next, item,
+                                             std::memory_order_release))
+        ;
+
+    Handler old_handler = m_toggle_handler.exchange(handler);
+    g_assert(((void) "Should always enqueue with the same handler",
+              !old_handler || old_handler == handler));
 
-    m_toggle_handler = handler;
-    m_idle_id = g_idle_add_full(G_PRIORITY_HIGH, idle_handle_toggle, this,
-                                idle_destroy_notify);
+    if (!m_idle_scheduled.exchange(true)) {
+        GSource* source = g_idle_source_new();
+        g_source_set_priority(source, G_PRIORITY_HIGH);
+        g_source_set_callback(source, idle_handle_toggle, this, nullptr);
+        g_source_attach(source, m_owner->main_context());
+        // Kept so that it can be destroyed along with the queue
+        GSource* old_source = m_idle_source.exchange(source);
+        if (old_source)
+            g_source_unref(old_source);
+    }
 }
@@ -26,9 +26,10 @@
 #ifndef GI_TOGGLE_H_
 #define GI_TOGGLE_H_
 
+#include <stdint.h>
+
 #include <atomic>
 #include <deque>
-#include <mutex>
 #include <utility>  // for pair
 
 #include <glib-object.h>
@@ -36,9 +37,20 @@
 
 #include "util/log.h"
 
+class GjsContextPrivate;
+
 /* Thread-safe queue for enqueueing toggle-up or toggle-down events on GObjects
  * from any thread. For more information, see object.cpp, comments near
- * wrapped_gobj_toggle_notify(). */
+ * wrapped_gobj_toggle_notify().
+ *
+ * Each context owns a queue for the GObjects it wraps, handled on the main
+ * context of the context's thread, so that contexts don't contend for it.
+ * Any thread may enqueue toggles, but only the owner's thread may handle or
+ * cancel them. Enqueuing pushes onto a lock-free stack, which the main thread
+ * takes over in one go and handles in FIFO order. Which toggles are pending
+ * for a GObject is kept in a state word attached to the GObject as qdata, so
+ * is_queued() and cancel() don't need to search the queue; cancelled items
+ * are skipped when they are reached. */
 class ToggleQueue {
 public:
     enum Direction {
@@ -49,43 +61,79 @@ public:
     typedef void (*Handler)(GObject *, Direction);
 
 private:
+    /* Per-GObject state word: the low two bits are the pending DOWN and UP
+     * toggles, the other bits are an epoch counter that cancel() increments,
+     * so that items queued before the cancellation are recognized as stale.
+     * Queued items hold a reference, so that stale items can still be checked
+     * after the GObject is gone. */
+    struct State {
+        std::atomic_uint32_t word;
+        gatomicrefcount refcount;
+    };
+
     struct Item {
         GObject *gobj;
+        State* state;
+        Item* next;
+        int64_t enqueue_time;  // microseconds, monotonic
+        uint32_t epoch;
         ToggleQueue::Direction direction;
         unsigned needs_unref : 1;
     };
 
-    mutable std::mutex lock;
-    std::deque<Item> q;
-    std::atomic_bool m_shutdown = ATOMIC_VAR_INIT(false);
+    static constexpr uint32_t STATE_DOWN = 1 << DOWN;
+    static constexpr uint32_t STATE_UP = 1 << UP;
+    static constexpr uint32_t STATE_QUEUED_MASK = STATE_DOWN | STATE_UP;
+    static constexpr unsigned STATE_EPOCH_SHIFT = 2;
 
-    unsigned m_idle_id;
-    Handler m_toggle_handler;
+    GjsContextPrivate* m_owner;
+    std::atomic<Item*> m_incoming = ATOMIC_VAR_INIT(nullptr);
+    std::deque<Item*> m_pending;  // main thread only
+    std::atomic_bool m_shutdown = ATOMIC_VAR_INIT(false);
+    std::atomic_bool m_idle_scheduled = ATOMIC_VAR_INIT(false);
+    std::atomic<GSource*> m_idle_source = ATOMIC_VAR_INIT(nullptr);
+    std::atomic<Handler> m_toggle_handler = ATOMIC_VAR_INIT(nullptr);
+    std::atomic_int m_length = ATOMIC_VAR_INIT(0);
+    int64_t m_budget_usec;
+    int64_t m_last_latency_usec = 0;  // main thread only
 
     /* No-op unless GJS_VERBOSE_ENABLE_LIFECYCLE is defined to 1. */
-    inline void debug(const char* did GJS_USED_VERBOSE_LIFECYCLE,
+    static inline void debug(const char* did GJS_USED_VERBOSE_LIFECYCLE,
                       const void* what GJS_USED_VERBOSE_LIFECYCLE) {
         gjs_debug_lifecycle(GJS_DEBUG_GOBJECT, "ToggleQueue %s %p", did, what);
     }
 
-    [[nodiscard]] std::deque<Item>::iterator find_operation_locked(
-        const GObject* gobj, Direction direction);
-
-    [[nodiscard]] std::deque<Item>::const_iterator find_operation_locked(
-        const GObject* gobj, Direction direction) const;
+    [[nodiscard]] static GQuark state_quark();
+    [[nodiscard]] static State* get_state(const GObject* gobj);
+    [[nodiscard]] static State* ensure_state(GObject* gobj);
+    static void unref_state(void* data);
+    [[nodiscard]] static constexpr uint32_t direction_bit(Direction direction) {
+        return direction == UP ? STATE_UP : STATE_DOWN;
+    }
 
-    [[nodiscard]] bool find_and_erase_operation_locked(const GObject* gobj,
-                                                       Direction direction);
+    void take_incoming();
+    [[nodiscard]] bool has_pending() const {
+        return !m_pending.empty() || m_incoming.load() != nullptr;
+    }
+    [[nodiscard]] static bool mark_handled(const Item* item);
+    [[nodiscard]] bool handle_toggles_until(int64_t deadline);
+    void report_counters() const;
 
     static gboolean idle_handle_toggle(void *data);
-    static void idle_destroy_notify(void *data);
 
  public:
+    explicit ToggleQueue(GjsContextPrivate* owner);
+    ~ToggleQueue();
+    ToggleQueue(const ToggleQueue&) = delete;
+    ToggleQueue& operator=(const ToggleQueue&) = delete;
+
     /* These two functions return a pair DOWN, UP signifying whether toggles
-     * are / were queued. is_queued() just checks and does not modify. */
-    [[nodiscard]] std::pair<bool, bool> is_queued(GObject* gobj) const;
+     * are / were queued. is_queued() just checks and does not modify. Which
+     * toggles are queued is kept on the GObject itself, so they don't need to
+     * know which queue it is in. */
+    [[nodiscard]] static std::pair<bool, bool> is_queued(GObject* gobj);
     /* Cancels pending toggles and returns whether any were queued. */
-    std::pair<bool, bool> cancel(GObject *gobj);
+    static std::pair<bool, bool> cancel(GObject* gobj);
 
     /* Pops a toggle from the queue and processes it. Call this if you don't
      * want to wait for it to be processed in idle time. Returns false if queue
@@ -97,15 +145,18 @@ private:
      * associations between C and JS objects. */
     void shutdown(void);
 
+    /* Number of toggles currently queued, including cancelled ones that
+     * haven't been skipped yet. */
+    [[nodiscard]] int length() const { return m_length; }
+
+    /* Microseconds between queueing and handling the toggle that was handled
+     * last, as reported to the profiler. Main thread only. */
+    [[nodiscard]] int64_t last_latency() const { return m_last_latency_usec; }
+
     /* Queues a toggle to be processed in idle time. */
     void enqueue(GObject  *gobj,
                  Direction direction,
                  Handler   handler);
-
-    [[nodiscard]] static ToggleQueue& get_default() {
-        static ToggleQueue the_singleton;
-        return the_singleton;
-    }
 };
 
 #endif  // GI_TOGGLE_H_
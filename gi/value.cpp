@@ -25,7 +25,9 @@
 
 #include <limits.h>  // for SCHAR_MAX, SCHAR_MIN, UCHAR_MAX
 #include <stdint.h>
-#include <string.h>  // for memset
+
+#include <memory>  // for unique_ptr
+#include <utility>  // for move
 
 #include <girepository.h>
 #include <glib-object.h>
@@ -61,6 +63,8 @@
 #include "cjs/jsapi-util.h"
 #include "util/log.h"
 
+const GjsAutoSignalEmission* GjsAutoSignalEmission::s_current = nullptr;
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_value_from_g_value_internal(JSContext             *context,
                                             JS::MutableHandleValue value_p,
@@ -101,34 +105,201 @@ static bool gjs_value_from_g_value_internal(JSContext             *context,
 
 /*
  * Fill in value_p with a JS array, converted from a C array stored as a pointer
- * in array_value, with its length stored in array_length_value.
+ * in array_value, with its length stored in array_length_value. The length is
+ * read straight out of its GValue; it is never converted to a JS value, since
+ * it is not passed on to the signal handler.
  */
 GJS_JSAPI_RETURN_CONVENTION
-static bool
-gjs_value_from_array_and_length_values(JSContext             *context,
-                                       JS::MutableHandleValue value_p,
-                                       GITypeInfo            *array_type_info,
-                                       const GValue          *array_value,
-                                       const GValue          *array_length_value,
-                                       bool                   no_copy,
-                                       GSignalQuery          *signal_query,
-                                       int                    array_length_arg_n)
-{
-    JS::RootedValue array_length(context);
+static bool gjs_value_from_array_and_length_values(
+    JSContext* context, JS::MutableHandleValue value_p,
+    GITypeInfo* array_type_info, const GValue* array_value,
+    const GValue* array_length_value) {
     GArgument array_arg;
 
     g_assert(G_VALUE_HOLDS_POINTER(array_value));
     g_assert(G_VALUE_HOLDS_INT(array_length_value));
 
-    if (!gjs_value_from_g_value_internal(context, &array_length,
-                                         array_length_value, no_copy,
-                                         signal_query, array_length_arg_n))
-        return false;
-
     gjs_arg_set(&array_arg, g_value_get_pointer(array_value));
 
-    return gjs_value_from_explicit_array(context, value_p, array_type_info,
-                                         &array_arg, array_length.toInt32());
+    return gjs_value_from_borrowed_explicit_array(
+        context, value_p, array_type_info, &array_arg,
+        g_value_get_int(array_length_value));
+}
+
+/* Whether @value, which was converted into @gvalue, is exactly what converting
+ * @gvalue back would give, so that it can be passed to a JS signal handler
+ * as-is. Only covers the common simple types. */
+[[nodiscard]] static bool js_value_round_trips(const JS::Value& value,
+                                               const GValue* gvalue) {
+    switch (G_TYPE_FUNDAMENTAL(G_VALUE_TYPE(gvalue))) {
+        case G_TYPE_BOOLEAN:
+            return value.isBoolean();
+        case G_TYPE_INT:
+        case G_TYPE_ENUM:
+            return value.isInt32();
+        case G_TYPE_UINT:
+            return value.isInt32() && value.toInt32() >= 0;
+        case G_TYPE_DOUBLE:
+            return value.isNumber();
+        case G_TYPE_STRING:
+            return value.isString() || value.isNull();
+        case G_TYPE_OBJECT:
+            // There is only ever one wrapper for a GObject
+            return value.isObject() || value.isNull();
+        default:
+            return false;
+    }
+}
+
+namespace {
+
+// How a signal parameter is converted to a JS value. Common simple types are
+// converted directly, everything else goes through
+// gjs_value_from_g_value_internal().
+enum class MarshalKind : uint8_t {
+    GENERIC,
+    BOOLEAN,
+    INT,
+    UINT,
+    DOUBLE,
+    FLOAT,
+    STRING,
+    OBJECT,
+};
+
+struct MarshalParam {
+    GjsAutoTypeInfo array_type_info;  // only set for C array parameters
+    int array_len_index = -1;
+    MarshalKind kind = MarshalKind::GENERIC;
+    bool skip = false;
+    bool no_copy = false;
+};
+
+// Everything about a signal's parameters that closure_marshal() needs, worked
+// out once on the first emission and cached on the closure. A signal closure
+// is only ever connected to one signal, so the plan stays valid for the
+// closure's lifetime.
+struct SignalMarshalPlan {
+    GSignalQuery query;
+    std::unique_ptr<MarshalParam[]> params;
+};
+
+}  // namespace
+
+[[nodiscard]] static MarshalKind marshal_kind_for_gtype(GType gtype) {
+    // Must agree with the converters that classify_gtype() picks for these
+    // types in gjs_value_from_g_value_internal()
+    if (gtype == G_TYPE_BOOLEAN)
+        return MarshalKind::BOOLEAN;
+    if (gtype == G_TYPE_INT)
+        return MarshalKind::INT;
+    if (gtype == G_TYPE_UINT)
+        return MarshalKind::UINT;
+    if (gtype == G_TYPE_DOUBLE)
+        return MarshalKind::DOUBLE;
+    if (gtype == G_TYPE_FLOAT)
+        return MarshalKind::FLOAT;
+    if (gtype == G_TYPE_STRING)
+        return MarshalKind::STRING;
+    if (G_TYPE_FUNDAMENTAL(gtype) == G_TYPE_OBJECT)
+        return MarshalKind::OBJECT;
+    return MarshalKind::GENERIC;
+}
+
+static void signal_marshal_plan_free(void* data) {
+    delete static_cast<SignalMarshalPlan*>(data);
+}
+
+[[nodiscard]] static SignalMarshalPlan* signal_marshal_plan_new(
+    unsigned signal_id) {
+    auto* plan = new SignalMarshalPlan();
+    g_signal_query(signal_id, &plan->query);
+    if (!plan->query.signal_id) {
+        delete plan;
+        return nullptr;
+    }
+
+    unsigned n_param_values = plan->query.n_params + 1;
+    plan->params.reset(new MarshalParam[n_param_values]);
+
+    plan->params[0].kind = marshal_kind_for_gtype(plan->query.itype);
+    for (unsigned i = 1; i < n_param_values; i++) {
+        GType param_type = plan->query.param_types[i - 1];
+        plan->params[i].no_copy = (param_type & G_SIGNAL_TYPE_STATIC_SCOPE);
+        plan->params[i].kind =
+            marshal_kind_for_gtype(param_type & ~G_SIGNAL_TYPE_STATIC_SCOPE);
+    }
+
+    /* Check if any parameters, such as array lengths, need to be eliminated
+     * before we invoke the closure.
+     */
+    GjsAutoCallableInfo signal_info = get_signal_info_if_available(&plan->query);
+    if (signal_info) {
+        /* Start at argument 1, skip the instance parameter */
+        for (unsigned i = 1; i < n_param_values; ++i) {
+            GjsAutoArgInfo arg_info =
+                g_callable_info_get_arg(signal_info, i - 1);
+            GjsAutoTypeInfo type_info = g_arg_info_get_type(arg_info);
+
+            int array_len_pos = g_type_info_get_array_length(type_info);
+            if (array_len_pos != -1 &&
+                unsigned(array_len_pos) + 1 < n_param_values) {
+                plan->params[array_len_pos + 1].skip = true;
+                plan->params[i].array_len_index = array_len_pos + 1;
+                plan->params[i].array_type_info = std::move(type_info);
+            }
+        }
+    }
+
+    return plan;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool marshal_param(JSContext* cx, JS::MutableHandleValue value_p,
+                          const GValue* gval, const MarshalParam& param,
+                          GSignalQuery* signal_query, int arg_n) {
+    switch (param.kind) {
+        case MarshalKind::BOOLEAN:
+            value_p.setBoolean(g_value_get_boolean(gval));
+            return true;
+        case MarshalKind::INT:
+            value_p.setInt32(g_value_get_int(gval));
+            return true;
+        case MarshalKind::UINT:
+            value_p.setNumber(g_value_get_uint(gval));
+            return true;
+        case MarshalKind::DOUBLE:
+            value_p.setNumber(g_value_get_double(gval));
+            return true;
+        case MarshalKind::FLOAT:
+            value_p.setNumber(g_value_get_float(gval));
+            return true;
+        case MarshalKind::STRING: {
+            const char* str = g_value_get_string(gval);
+            if (!str) {
+                value_p.setNull();
+                return true;
+            }
+            return gjs_string_from_utf8(cx, str, value_p);
+        }
+        case MarshalKind::OBJECT: {
+            auto* gobj = static_cast<GObject*>(g_value_get_object(gval));
+            if (!gobj) {
+                value_p.setNull();
+                return true;
+            }
+            JSObject* obj = ObjectInstance::wrapper_from_gobject(cx, gobj);
+            if (!obj)
+                return false;
+            value_p.setObject(*obj);
+            return true;
+        }
+        case MarshalKind::GENERIC:
+        default:
+            return gjs_value_from_g_value_internal(cx, value_p, gval,
+                                                   param.no_copy, signal_query,
+                                                   arg_n);
+    }
 }
 
 static void
@@ -142,10 +313,6 @@ closure_marshal(GClosure        *closure,
     JSContext *context;
     unsigned i;
     GSignalQuery signal_query = { 0, };
-    GISignalInfo *signal_info;
-    bool *skip;
-    int *array_len_indices_for;
-    GITypeInfo **type_info_for;
 
     gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
                       "Marshal closure %p",
@@ -182,59 +349,39 @@ closure_marshal(GClosure        *closure,
     JSFunction* func = gjs_closure_get_callable(closure);
     JSAutoRealm ar(context, JS_GetFunctionObject(func));
 
+    SignalMarshalPlan* plan = nullptr;
     if (marshal_data) {
         /* we are used for a signal handler */
-        guint signal_id;
-
-        signal_id = GPOINTER_TO_UINT(marshal_data);
-
-        g_signal_query(signal_id, &signal_query);
-
-        if (!signal_query.signal_id) {
-            gjs_debug(GJS_DEBUG_GCLOSURE,
-                      "Signal handler being called on invalid signal");
-            return;
+        plan = static_cast<SignalMarshalPlan*>(
+            gjs_closure_get_marshal_plan(closure));
+        if (!plan) {
+            plan = signal_marshal_plan_new(GPOINTER_TO_UINT(marshal_data));
+            if (!plan) {
+                gjs_debug(GJS_DEBUG_GCLOSURE,
+                          "Signal handler being called on invalid signal");
+                return;
+            }
+            gjs_closure_set_marshal_plan(closure, plan,
+                                         signal_marshal_plan_free);
         }
 
-        if (signal_query.n_params + 1 != n_param_values) {
+        if (plan->query.n_params + 1 != n_param_values) {
             gjs_debug(GJS_DEBUG_GCLOSURE,
                       "Signal handler being called with wrong number of parameters");
             return;
         }
     }
 
-    /* Check if any parameters, such as array lengths, need to be eliminated
-     * before we invoke the closure.
-     */
-    skip = g_newa(bool, n_param_values);
-    memset(skip, 0, sizeof (bool) * n_param_values);
-    array_len_indices_for = g_newa(int, n_param_values);
-    for(i = 0; i < n_param_values; i++)
-        array_len_indices_for[i] = -1;
-    type_info_for = g_newa(GITypeInfo *, n_param_values);
-    memset(type_info_for, 0, sizeof (gpointer) * n_param_values);
-
-    signal_info = get_signal_info_if_available(&signal_query);
-    if (signal_info) {
-        /* Start at argument 1, skip the instance parameter */
-        for (i = 1; i < n_param_values; ++i) {
-            GIArgInfo *arg_info;
-            int array_len_pos;
-
-            arg_info = g_callable_info_get_arg(signal_info, i - 1);
-            type_info_for[i] = g_arg_info_get_type(arg_info);
-
-            array_len_pos = g_type_info_get_array_length(type_info_for[i]);
-            if (array_len_pos != -1) {
-                skip[array_len_pos + 1] = true;
-                array_len_indices_for[i] = array_len_pos + 1;
-            }
-
-            g_base_info_unref((GIBaseInfo *)arg_info);
-        }
+    /* Closures not connected to a signal have no plan; every parameter is
+     * converted generically */
+    MarshalParam generic_param;
+    GSignalQuery* query = plan ? &plan->query : &signal_query;
 
-        g_base_info_unref((GIBaseInfo *)signal_info);
-    }
+    /* If the signal was emitted from JS, the original arguments can be
+     * passed on directly where they would come out the same */
+    const JS::CallArgs* js_args = nullptr;
+    if (plan)
+        js_args = GjsAutoSignalEmission::args_for(param_values);
 
     JS::RootedValueVector argv(context);
     /* May end up being less */
@@ -243,33 +390,31 @@ closure_marshal(GClosure        *closure,
     JS::RootedValue argv_to_append(context);
     for (i = 0; i < n_param_values; ++i) {
         const GValue *gval = &param_values[i];
-        bool no_copy;
-        int array_len_index;
+        const MarshalParam& param = plan ? plan->params[i] : generic_param;
         bool res;
 
-        if (skip[i])
+        if (param.skip)
             continue;
 
-        no_copy = false;
-
-        if (i >= 1 && signal_query.signal_id) {
-            no_copy = (signal_query.param_types[i - 1] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0;
+        if (js_args && param.array_len_index == -1) {
+            // Argument 0 of emit() is the signal name, and the instance is
+            // the this object
+            JS::Value js_value = i == 0 ? js_args->thisv() : (*js_args)[i];
+            if (i == 0 ? js_value.isObject()
+                       : js_value_round_trips(js_value, gval)) {
+                argv.infallibleAppend(js_value);
+                continue;
+            }
         }
 
-        array_len_index = array_len_indices_for[i];
-        if (array_len_index != -1) {
-            const GValue *array_len_gval = &param_values[array_len_index];
-            res = gjs_value_from_array_and_length_values(context,
-                                                         &argv_to_append,
-                                                         type_info_for[i],
-                                                         gval, array_len_gval,
-                                                         no_copy, &signal_query,
-                                                         array_len_index);
+        if (param.array_len_index != -1) {
+            const GValue* array_len_gval = &param_values[param.array_len_index];
+            res = gjs_value_from_array_and_length_values(
+                context, &argv_to_append, param.array_type_info, gval,
+                array_len_gval);
         } else {
-            res = gjs_value_from_g_value_internal(context,
-                                                  &argv_to_append,
-                                                  gval, no_copy, &signal_query,
-                                                  i);
+            res = marshal_param(context, &argv_to_append, gval, param, query,
+                                i);
         }
 
         if (!res) {
@@ -283,10 +428,6 @@ closure_marshal(GClosure        *closure,
         argv.infallibleAppend(argv_to_append);
     }
 
-    for (i = 1; i < n_param_values; i++)
-        if (type_info_for[i])
-            g_base_info_unref((GIBaseInfo *)type_info_for[i]);
-
     JS::RootedValue rval(context);
     mozilla::Unused << gjs_closure_invoke(closure, nullptr, argv, &rval, false);
     // Any exception now pending, is handled when returning control to JS
@@ -375,373 +516,572 @@ throw_expect_type(JSContext      *cx,
     return false;  /* for convenience */
 }
 
-GJS_JSAPI_RETURN_CONVENTION
-static bool
-gjs_value_to_g_value_internal(JSContext      *context,
-                              JS::HandleValue value,
-                              GValue         *gvalue,
-                              bool            no_copy)
-{
-    GType gtype;
+namespace {
+
+// Which conversion applies to a GValue of a given GType, in either direction.
+// Working this out takes a string of g_type_is_a() calls, so it is done once
+// per GType and memoized; see gvalue_kind_for_gtype().
+enum class GValueKind : uint8_t {
+    UNKNOWN = 0,  // not classified yet
+    STRING,
+    CHAR,
+    UCHAR,
+    INT,
+    UINT,
+    DOUBLE,
+    FLOAT,
+    BOOLEAN,
+    OBJECT,  // objects and interfaces
+    STRV,
+    CONTAINER,  // boxed GHashTable, GArray, GByteArray, and GPtrArray
+    BOXED,
+    VARIANT,
+    ENUM,
+    FLAGS,
+    PARAM,
+    GTYPE,
+    POINTER,
+    OTHER,  // transformable and custom fundamental types
+    N_KINDS
+};
+
+}  // namespace
+
+// Must agree with the order of the checks that the conversions used to do
+// inline; for example, G_TYPE_STRV is boxed and G_TYPE_GTYPE is a pointer type,
+// but both have their own conversions.
+[[nodiscard]] static GValueKind classify_gtype(GType gtype) {
+    switch (gtype) {
+        case G_TYPE_STRING:
+            return GValueKind::STRING;
+        case G_TYPE_CHAR:
+            return GValueKind::CHAR;
+        case G_TYPE_UCHAR:
+            return GValueKind::UCHAR;
+        case G_TYPE_INT:
+            return GValueKind::INT;
+        case G_TYPE_UINT:
+            return GValueKind::UINT;
+        case G_TYPE_DOUBLE:
+            return GValueKind::DOUBLE;
+        case G_TYPE_FLOAT:
+            return GValueKind::FLOAT;
+        case G_TYPE_BOOLEAN:
+            return GValueKind::BOOLEAN;
+        default:
+            break;
+    }
 
-    gtype = G_VALUE_TYPE(gvalue);
+    if (g_type_is_a(gtype, G_TYPE_OBJECT) ||
+        g_type_is_a(gtype, G_TYPE_INTERFACE))
+        return GValueKind::OBJECT;
+    if (gtype == G_TYPE_STRV)
+        return GValueKind::STRV;
+    if (g_type_is_a(gtype, G_TYPE_HASH_TABLE) ||
+        g_type_is_a(gtype, G_TYPE_ARRAY) ||
+        g_type_is_a(gtype, G_TYPE_BYTE_ARRAY) ||
+        g_type_is_a(gtype, G_TYPE_PTR_ARRAY))
+        return GValueKind::CONTAINER;
+    if (g_type_is_a(gtype, G_TYPE_BOXED))
+        return GValueKind::BOXED;
+    if (g_type_is_a(gtype, G_TYPE_VARIANT))
+        return GValueKind::VARIANT;
+    if (g_type_is_a(gtype, G_TYPE_ENUM))
+        return GValueKind::ENUM;
+    if (g_type_is_a(gtype, G_TYPE_FLAGS))
+        return GValueKind::FLAGS;
+    if (g_type_is_a(gtype, G_TYPE_PARAM))
+        return GValueKind::PARAM;
+    if (g_type_is_a(gtype, G_TYPE_GTYPE))
+        return GValueKind::GTYPE;
+    if (g_type_is_a(gtype, G_TYPE_POINTER))
+        return GValueKind::POINTER;
+    return GValueKind::OTHER;
+}
 
-    if (gtype == 0) {
-        if (!gjs_value_guess_g_type(context, value, &gtype))
+[[nodiscard]] static GQuark gjs_value_kind_quark() {
+    static GQuark val = 0;
+    if (G_UNLIKELY(!val))
+        val = g_quark_from_static_string("gjs::gvalue-kind");
+
+    return val;
+}
+
+// Fundamental types are looked up in a table indexed by fundamental type
+// number, and derived types such as objects and boxed types have their kind
+// memoized in their qdata.
+[[nodiscard]] static GValueKind gvalue_kind_for_gtype(GType gtype) {
+    static GValueKind
+        fundamental_kinds[(G_TYPE_FUNDAMENTAL_MAX >> G_TYPE_FUNDAMENTAL_SHIFT) +
+                          1];
+
+    if (G_TYPE_IS_FUNDAMENTAL(gtype)) {
+        GValueKind& kind =
+            fundamental_kinds[gtype >> G_TYPE_FUNDAMENTAL_SHIFT];
+        if (G_UNLIKELY(kind == GValueKind::UNKNOWN))
+            kind = classify_gtype(gtype);
+        return kind;
+    }
+
+    void* memo = g_type_get_qdata(gtype, gjs_value_kind_quark());
+    if (G_LIKELY(memo))
+        return static_cast<GValueKind>(GPOINTER_TO_UINT(memo));
+
+    GValueKind kind = classify_gtype(gtype);
+    g_type_set_qdata(gtype, gjs_value_kind_quark(),
+                     GUINT_TO_POINTER(unsigned(kind)));
+    return kind;
+}
+
+// Converters from JS values, one per GValueKind. They are called with @gvalue
+// already initialized to @gtype.
+using ToGValueFunc = bool (*)(JSContext*, JS::HandleValue, GValue*, GType,
+                              bool no_copy);
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool string_to_g_value(JSContext* cx, JS::HandleValue value,
+                              GValue* gvalue, GType, bool) {
+    /* Don't use ValueToString since we don't want to just toString()
+     * everything automatically
+     */
+    if (value.isNull()) {
+        g_value_set_string(gvalue, NULL);
+    } else if (value.isString()) {
+        JS::RootedString str(cx, value.toString());
+        JS::UniqueChars utf8_string(JS_EncodeStringToUTF8(cx, str));
+        if (!utf8_string)
             return false;
 
-        if (gtype == G_TYPE_INVALID) {
-            gjs_throw(context, "Could not guess unspecified GValue type");
+        g_value_set_string(gvalue, utf8_string.get());
+    } else {
+        return throw_expect_type(cx, value, "string");
+    }
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool char_to_g_value(JSContext* cx, JS::HandleValue value,
+                            GValue* gvalue, GType, bool) {
+    gint32 i;
+    if (JS::ToInt32(cx, value, &i) && i >= SCHAR_MIN && i <= SCHAR_MAX) {
+        g_value_set_schar(gvalue, (signed char)i);
+        return true;
+    }
+    return throw_expect_type(cx, value, "char");
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool uchar_to_g_value(JSContext* cx, JS::HandleValue value,
+                             GValue* gvalue, GType, bool) {
+    guint16 i;
+    if (JS::ToUint16(cx, value, &i) && i <= UCHAR_MAX) {
+        g_value_set_uchar(gvalue, (unsigned char)i);
+        return true;
+    }
+    return throw_expect_type(cx, value, "unsigned char");
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool int_to_g_value(JSContext* cx, JS::HandleValue value,
+                           GValue* gvalue, GType, bool) {
+    gint32 i;
+    if (JS::ToInt32(cx, value, &i)) {
+        g_value_set_int(gvalue, i);
+        return true;
+    }
+    return throw_expect_type(cx, value, "integer");
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool uint_to_g_value(JSContext* cx, JS::HandleValue value,
+                            GValue* gvalue, GType, bool) {
+    guint32 i;
+    if (JS::ToUint32(cx, value, &i)) {
+        g_value_set_uint(gvalue, i);
+        return true;
+    }
+    return throw_expect_type(cx, value, "unsigned integer");
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool double_to_g_value(JSContext* cx, JS::HandleValue value,
+                              GValue* gvalue, GType, bool) {
+    gdouble d;
+    if (JS::ToNumber(cx, value, &d)) {
+        g_value_set_double(gvalue, d);
+        return true;
+    }
+    return throw_expect_type(cx, value, "double");
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool float_to_g_value(JSContext* cx, JS::HandleValue value,
+                             GValue* gvalue, GType, bool) {
+    gdouble d;
+    if (JS::ToNumber(cx, value, &d)) {
+        g_value_set_float(gvalue, d);
+        return true;
+    }
+    return throw_expect_type(cx, value, "float");
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool boolean_to_g_value(JSContext*, JS::HandleValue value,
+                               GValue* gvalue, GType, bool) {
+    /* JS::ToBoolean() can't fail */
+    g_value_set_boolean(gvalue, JS::ToBoolean(value));
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool object_to_g_value(JSContext* cx, JS::HandleValue value,
+                              GValue* gvalue, GType gtype, bool) {
+    GObject* gobj = nullptr;
+    if (value.isNull()) {
+        /* nothing to do */
+    } else if (value.isObject()) {
+        JS::RootedObject obj(cx, &value.toObject());
+        if (!ObjectBase::typecheck(cx, obj, nullptr, gtype) ||
+            !ObjectBase::to_c_ptr(cx, obj, &gobj))
             return false;
-        }
+        if (!gobj)
+            return true;  // treat disposed object as if value.isNull()
+    } else {
+        return throw_expect_type(cx, value, "object", gtype);
+    }
 
-        gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
-                          "Guessed GValue type %s from JS Value",
-                          g_type_name(gtype));
+    g_value_set_object(gvalue, gobj);
+    return true;
+}
 
-        g_value_init(gvalue, gtype);
+GJS_JSAPI_RETURN_CONVENTION
+static bool strv_to_g_value(JSContext* cx, JS::HandleValue value,
+                            GValue* gvalue, GType, bool) {
+    if (value.isNull())
+        return true;
+    if (!value.isObject())
+        return throw_expect_type(cx, value, "strv");
+
+    bool found_length;
+    const GjsAtoms& atoms = GjsContextPrivate::atoms(cx);
+    JS::RootedObject array_obj(cx, &value.toObject());
+    if (!JS_HasPropertyById(cx, array_obj, atoms.length(), &found_length) ||
+        !found_length)
+        return throw_expect_type(cx, value, "strv");
+
+    guint32 length;
+    if (!gjs_object_require_converted_property(cx, array_obj, nullptr,
+                                               atoms.length(), &length)) {
+        JS_ClearPendingException(cx);
+        return throw_expect_type(cx, value, "strv");
     }
 
-    gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
-                      "Converting JS::Value to gtype %s",
-                      g_type_name(gtype));
+    void* result;
+    if (!gjs_array_to_strv(cx, value, length, &result))
+        return false;
+    /* cast to strv in a separate step to avoid type-punning */
+    char** strv = static_cast<char**>(result);
+    g_value_take_boxed(gvalue, strv);
+    return true;
+}
 
+GJS_JSAPI_RETURN_CONVENTION
+static bool boxed_to_g_value(JSContext* cx, JS::HandleValue value,
+                             GValue* gvalue, GType gtype, bool no_copy) {
+    void* gboxed = nullptr;
+    if (value.isNull())
+        return true;
 
-    if (gtype == G_TYPE_STRING) {
-        /* Don't use ValueToString since we don't want to just toString()
-         * everything automatically
-         */
-        if (value.isNull()) {
-            g_value_set_string(gvalue, NULL);
-        } else if (value.isString()) {
-            JS::RootedString str(context, value.toString());
-            JS::UniqueChars utf8_string(JS_EncodeStringToUTF8(context, str));
-            if (!utf8_string)
-                return false;
+    /* special case GValue */
+    if (g_type_is_a(gtype, G_TYPE_VALUE)) {
+        GValue nested_gvalue = G_VALUE_INIT;
 
-            g_value_set_string(gvalue, utf8_string.get());
-        } else {
-            return throw_expect_type(context, value, "string");
-        }
-    } else if (gtype == G_TYPE_CHAR) {
-        gint32 i;
-        if (JS::ToInt32(context, value, &i) && i >= SCHAR_MIN && i <= SCHAR_MAX) {
-            g_value_set_schar(gvalue, (signed char)i);
-        } else {
-            return throw_expect_type(context, value, "char");
-        }
-    } else if (gtype == G_TYPE_UCHAR) {
-        guint16 i;
-        if (JS::ToUint16(context, value, &i) && i <= UCHAR_MAX) {
-            g_value_set_uchar(gvalue, (unsigned char)i);
-        } else {
-            return throw_expect_type(context, value, "unsigned char");
-        }
-    } else if (gtype == G_TYPE_INT) {
-        gint32 i;
-        if (JS::ToInt32(context, value, &i)) {
-            g_value_set_int(gvalue, i);
-        } else {
-            return throw_expect_type(context, value, "integer");
-        }
-    } else if (gtype == G_TYPE_DOUBLE) {
-        gdouble d;
-        if (JS::ToNumber(context, value, &d)) {
-            g_value_set_double(gvalue, d);
-        } else {
-            return throw_expect_type(context, value, "double");
-        }
-    } else if (gtype == G_TYPE_FLOAT) {
-        gdouble d;
-        if (JS::ToNumber(context, value, &d)) {
-            g_value_set_float(gvalue, d);
-        } else {
-            return throw_expect_type(context, value, "float");
-        }
-    } else if (gtype == G_TYPE_UINT) {
-        guint32 i;
-        if (JS::ToUint32(context, value, &i)) {
-            g_value_set_uint(gvalue, i);
-        } else {
-            return throw_expect_type(context, value, "unsigned integer");
-        }
-    } else if (gtype == G_TYPE_BOOLEAN) {
-        /* JS::ToBoolean() can't fail */
-        g_value_set_boolean(gvalue, JS::ToBoolean(value));
-    } else if (g_type_is_a(gtype, G_TYPE_OBJECT) || g_type_is_a(gtype, G_TYPE_INTERFACE)) {
-        GObject *gobj;
-
-        gobj = NULL;
-        if (value.isNull()) {
-            /* nothing to do */
-        } else if (value.isObject()) {
-            JS::RootedObject obj(context, &value.toObject());
-            if (!ObjectBase::typecheck(context, obj, nullptr, gtype) ||
-                !ObjectBase::to_c_ptr(context, obj, &gobj))
+        /* explicitly handle values that are already GValues
+           to avoid infinite recursion */
+        if (value.isObject()) {
+            JS::RootedObject obj(cx, &value.toObject());
+            GType guessed_gtype;
+
+            if (!gjs_value_guess_g_type(cx, value, &guessed_gtype))
                 return false;
-            if (!gobj)
-                return true;  // treat disposed object as if value.isNull()
-        } else {
-            return throw_expect_type(context, value, "object", gtype);
-        }
 
-        g_value_set_object(gvalue, gobj);
-    } else if (gtype == G_TYPE_STRV) {
-        if (value.isNull()) {
-            /* do nothing */
-        } else if (value.isObject()) {
-            bool found_length;
-
-            const GjsAtoms& atoms = GjsContextPrivate::atoms(context);
-            JS::RootedObject array_obj(context, &value.toObject());
-            if (JS_HasPropertyById(context, array_obj, atoms.length(),
-                                   &found_length) &&
-                found_length) {
-                guint32 length;
-
-                if (!gjs_object_require_converted_property(
-                        context, array_obj, nullptr, atoms.length(), &length)) {
-                    JS_ClearPendingException(context);
-                    return throw_expect_type(context, value, "strv");
-                } else {
-                    void *result;
-                    char **strv;
-
-                    if (!gjs_array_to_strv (context,
-                                            value,
-                                            length, &result))
-                        return false;
-                    /* cast to strv in a separate step to avoid type-punning */
-                    strv = (char**) result;
-                    g_value_take_boxed (gvalue, strv);
-                }
-            } else {
-                return throw_expect_type(context, value, "strv");
+            if (guessed_gtype == G_TYPE_VALUE) {
+                gboxed = BoxedBase::to_c_ptr<GValue>(cx, obj);
+                g_value_set_boxed(gvalue, gboxed);
+                return true;
             }
-        } else {
-            return throw_expect_type(context, value, "strv");
         }
-    } else if (g_type_is_a(gtype, G_TYPE_BOXED)) {
-        void *gboxed;
 
-        gboxed = NULL;
-        if (value.isNull())
-            return true;
+        if (!gjs_value_to_g_value(cx, value, &nested_gvalue))
+            return false;
 
-        /* special case GValue */
-        if (g_type_is_a(gtype, G_TYPE_VALUE)) {
-            GValue nested_gvalue = G_VALUE_INIT;
+        g_value_set_boxed(gvalue, &nested_gvalue);
+        g_value_unset(&nested_gvalue);
+        return true;
+    }
 
-            /* explicitly handle values that are already GValues
-               to avoid infinite recursion */
-            if (value.isObject()) {
-                JS::RootedObject obj(context, &value.toObject());
-                GType guessed_gtype;
+    if (!value.isObject())
+        return throw_expect_type(cx, value, "boxed type", gtype);
 
-                if (!gjs_value_guess_g_type(context, value, &guessed_gtype))
-                    return false;
+    JS::RootedObject obj(cx, &value.toObject());
 
-                if (guessed_gtype == G_TYPE_VALUE) {
-                    gboxed = BoxedBase::to_c_ptr<GValue>(context, obj);
-                    g_value_set_boxed(gvalue, gboxed);
-                    return true;
-                }
-            }
+    if (g_type_is_a(gtype, G_TYPE_ERROR)) {
+        /* special case GError */
+        gboxed = ErrorBase::to_c_ptr(cx, obj);
+        if (!gboxed)
+            return false;
+    } else {
+        GjsAutoBaseInfo registered = g_irepository_find_by_gtype(NULL, gtype);
+
+        /* We don't necessarily have the typelib loaded when
+           we first see the structure... */
+        if (registered && registered.type() == GI_INFO_TYPE_STRUCT &&
+            g_struct_info_is_foreign(registered)) {
+            GArgument arg;
 
-            if (!gjs_value_to_g_value(context, value, &nested_gvalue))
+            if (!gjs_struct_foreign_convert_to_g_argument(
+                    cx, value, registered, NULL, GJS_ARGUMENT_ARGUMENT,
+                    GI_TRANSFER_NOTHING, true, &arg))
                 return false;
 
-            g_value_set_boxed(gvalue, &nested_gvalue);
-            g_value_unset(&nested_gvalue);
-            return true;
+            gboxed = gjs_arg_get<void*>(&arg);
         }
 
-        if (value.isObject()) {
-            JS::RootedObject obj(context, &value.toObject());
-
-            if (g_type_is_a(gtype, G_TYPE_ERROR)) {
-                /* special case GError */
-                gboxed = ErrorBase::to_c_ptr(context, obj);
-                if (!gboxed)
-                    return false;
+        /* First try a union, if that fails,
+           assume a boxed struct. Distinguishing
+           which one is expected would require checking
+           the associated GIBaseInfo, which is not necessary
+           possible, if e.g. we see the GType without
+           loading the typelib.
+        */
+        if (!gboxed) {
+            if (UnionBase::typecheck(cx, obj, nullptr, gtype,
+                                     GjsTypecheckNoThrow())) {
+                gboxed = UnionBase::to_c_ptr(cx, obj);
             } else {
-                GIBaseInfo *registered = g_irepository_find_by_gtype (NULL, gtype);
-
-                /* We don't necessarily have the typelib loaded when
-                   we first see the structure... */
-                if (registered) {
-                    GIInfoType info_type = g_base_info_get_type (registered);
-
-                    if (info_type == GI_INFO_TYPE_STRUCT &&
-                        g_struct_info_is_foreign ((GIStructInfo*)registered)) {
-                        GArgument arg;
-
-                        if (!gjs_struct_foreign_convert_to_g_argument (context, value,
-                                                                       registered,
-                                                                       NULL,
-                                                                       GJS_ARGUMENT_ARGUMENT,
-                                                                       GI_TRANSFER_NOTHING,
-                                                                       true, &arg))
-                            return false;
-
-                        gboxed = gjs_arg_get<void*>(&arg);
-                    }
-                }
-
-                /* First try a union, if that fails,
-                   assume a boxed struct. Distinguishing
-                   which one is expected would require checking
-                   the associated GIBaseInfo, which is not necessary
-                   possible, if e.g. we see the GType without
-                   loading the typelib.
-                */
-                if (!gboxed) {
-                    if (UnionBase::typecheck(context, obj, nullptr, gtype,
-                                             GjsTypecheckNoThrow())) {
-                        gboxed = UnionBase::to_c_ptr(context, obj);
-                    } else {
-                        if (!BoxedBase::typecheck(context, obj, nullptr, gtype))
-                            return false;
-
-                        gboxed = BoxedBase::to_c_ptr(context, obj);
-                    }
-                    if (!gboxed)
-                        return false;
-                }
+                if (!BoxedBase::typecheck(cx, obj, nullptr, gtype))
+                    return false;
+
+                gboxed = BoxedBase::to_c_ptr(cx, obj);
             }
-        } else {
-            return throw_expect_type(context, value, "boxed type", gtype);
+            if (!gboxed)
+                return false;
         }
+    }
 
-        if (no_copy)
-            g_value_set_static_boxed(gvalue, gboxed);
-        else
-            g_value_set_boxed(gvalue, gboxed);
-    } else if (g_type_is_a(gtype, G_TYPE_VARIANT)) {
-        GVariant *variant = NULL;
+    if (no_copy)
+        g_value_set_static_boxed(gvalue, gboxed);
+    else
+        g_value_set_boxed(gvalue, gboxed);
+    return true;
+}
 
-        if (value.isNull()) {
-            /* nothing to do */
-        } else if (value.isObject()) {
-            JS::RootedObject obj(context, &value.toObject());
+GJS_JSAPI_RETURN_CONVENTION
+static bool variant_to_g_value(JSContext* cx, JS::HandleValue value,
+                               GValue* gvalue, GType gtype, bool) {
+    GVariant* variant = nullptr;
 
-            if (!BoxedBase::typecheck(context, obj, nullptr, G_TYPE_VARIANT))
-                return false;
+    if (value.isNull()) {
+        /* nothing to do */
+    } else if (value.isObject()) {
+        JS::RootedObject obj(cx, &value.toObject());
 
-            variant = BoxedBase::to_c_ptr<GVariant>(context, obj);
-            if (!variant)
-                return false;
-        } else {
-            return throw_expect_type(context, value, "boxed type", gtype);
-        }
+        if (!BoxedBase::typecheck(cx, obj, nullptr, G_TYPE_VARIANT))
+            return false;
 
-        g_value_set_variant (gvalue, variant);
-    } else if (g_type_is_a(gtype, G_TYPE_ENUM)) {
-        int64_t value_int64;
+        variant = BoxedBase::to_c_ptr<GVariant>(cx, obj);
+        if (!variant)
+            return false;
+    } else {
+        return throw_expect_type(cx, value, "boxed type", gtype);
+    }
 
-        if (JS::ToInt64(context, value, &value_int64)) {
-            GEnumValue *v;
-            GjsAutoTypeClass<GEnumClass> enum_class(gtype);
+    g_value_set_variant(gvalue, variant);
+    return true;
+}
 
-            /* See arg.c:_gjs_enum_to_int() */
-            v = g_enum_get_value(enum_class, (int)value_int64);
-            if (v == NULL) {
-                gjs_throw(context,
-                          "%d is not a valid value for enumeration %s",
-                          value.toInt32(), g_type_name(gtype));
-                return false;
-            }
+GJS_JSAPI_RETURN_CONVENTION
+static bool enum_to_g_value(JSContext* cx, JS::HandleValue value,
+                            GValue* gvalue, GType gtype, bool) {
+    int64_t value_int64;
+    if (!JS::ToInt64(cx, value, &value_int64))
+        return throw_expect_type(cx, value, "enum", gtype);
+
+    GjsAutoTypeClass<GEnumClass> enum_class(gtype);
+
+    /* See arg.c:_gjs_enum_to_int() */
+    GEnumValue* v = g_enum_get_value(enum_class, (int)value_int64);
+    if (v == NULL) {
+        gjs_throw(cx, "%d is not a valid value for enumeration %s",
+                  value.toInt32(), g_type_name(gtype));
+        return false;
+    }
 
-            g_value_set_enum(gvalue, v->value);
-        } else {
-            return throw_expect_type(context, value, "enum", gtype);
-        }
-    } else if (g_type_is_a(gtype, G_TYPE_FLAGS)) {
-        int64_t value_int64;
+    g_value_set_enum(gvalue, v->value);
+    return true;
+}
 
-        if (JS::ToInt64(context, value, &value_int64)) {
-            if (!_gjs_flags_value_is_valid(context, gtype, value_int64))
-                return false;
+GJS_JSAPI_RETURN_CONVENTION
+static bool flags_to_g_value(JSContext* cx, JS::HandleValue value,
+                             GValue* gvalue, GType gtype, bool) {
+    int64_t value_int64;
+    if (!JS::ToInt64(cx, value, &value_int64))
+        return throw_expect_type(cx, value, "flags", gtype);
 
-            /* See arg.c:_gjs_enum_to_int() */
-            g_value_set_flags(gvalue, (int)value_int64);
-        } else {
-            return throw_expect_type(context, value, "flags", gtype);
-        }
-    } else if (g_type_is_a(gtype, G_TYPE_PARAM)) {
-        void *gparam;
+    if (!_gjs_flags_value_is_valid(cx, gtype, value_int64))
+        return false;
 
-        gparam = NULL;
-        if (value.isNull()) {
-            /* nothing to do */
-        } else if (value.isObject()) {
-            JS::RootedObject obj(context, &value.toObject());
+    /* See arg.c:_gjs_enum_to_int() */
+    g_value_set_flags(gvalue, (int)value_int64);
+    return true;
+}
 
-            if (!gjs_typecheck_param(context, obj, gtype, true))
-                return false;
+GJS_JSAPI_RETURN_CONVENTION
+static bool param_to_g_value(JSContext* cx, JS::HandleValue value,
+                             GValue* gvalue, GType gtype, bool) {
+    GParamSpec* gparam = nullptr;
 
-            gparam = gjs_g_param_from_param(context, obj);
-        } else {
-            return throw_expect_type(context, value, "param type", gtype);
-        }
+    if (value.isNull()) {
+        /* nothing to do */
+    } else if (value.isObject()) {
+        JS::RootedObject obj(cx, &value.toObject());
 
-        g_value_set_param(gvalue, (GParamSpec*) gparam);
-    } else if (g_type_is_a(gtype, G_TYPE_GTYPE)) {
-        GType type;
+        if (!gjs_typecheck_param(cx, obj, gtype, true))
+            return false;
 
-        if (!value.isObject())
-            return throw_expect_type(context, value, "GType object");
+        gparam = gjs_g_param_from_param(cx, obj);
+    } else {
+        return throw_expect_type(cx, value, "param type", gtype);
+    }
 
-        JS::RootedObject obj(context, &value.toObject());
-        if (!gjs_gtype_get_actual_gtype(context, obj, &type))
-            return false;
-        g_value_set_gtype(gvalue, type);
-    } else if (g_type_is_a(gtype, G_TYPE_POINTER)) {
-        if (value.isNull()) {
-            /* Nothing to do */
-        } else {
-            gjs_throw(context,
-                      "Cannot convert non-null JS value to G_POINTER");
-            return false;
-        }
-    } else if (value.isNumber() &&
-               g_value_type_transformable(G_TYPE_INT, gtype)) {
+    g_value_set_param(gvalue, gparam);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gtype_to_g_value(JSContext* cx, JS::HandleValue value,
+                             GValue* gvalue, GType, bool) {
+    if (!value.isObject())
+        return throw_expect_type(cx, value, "GType object");
+
+    GType type;
+    JS::RootedObject obj(cx, &value.toObject());
+    if (!gjs_gtype_get_actual_gtype(cx, obj, &type))
+        return false;
+    g_value_set_gtype(gvalue, type);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool pointer_to_g_value(JSContext* cx, JS::HandleValue value, GValue*,
+                               GType, bool) {
+    if (value.isNull())
+        return true;
+
+    gjs_throw(cx, "Cannot convert non-null JS value to G_POINTER");
+    return false;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool other_to_g_value(JSContext* cx, JS::HandleValue value,
+                             GValue* gvalue, GType gtype, bool) {
+    if (value.isNumber() && g_value_type_transformable(G_TYPE_INT, gtype)) {
         /* Only do this crazy gvalue transform stuff after we've
          * exhausted everything else. Adding this for
          * e.g. ClutterUnit.
          */
         gint32 i;
-        if (JS::ToInt32(context, value, &i)) {
-            GValue int_value = { 0, };
-            g_value_init(&int_value, G_TYPE_INT);
-            g_value_set_int(&int_value, i);
-            g_value_transform(&int_value, gvalue);
-        } else {
-            return throw_expect_type(context, value, "integer");
-        }
-    } else if (G_TYPE_IS_INSTANTIATABLE(gtype)) {
+        if (!JS::ToInt32(cx, value, &i))
+            return throw_expect_type(cx, value, "integer");
+
+        GValue int_value = { 0, };
+        g_value_init(&int_value, G_TYPE_INT);
+        g_value_set_int(&int_value, i);
+        g_value_transform(&int_value, gvalue);
+        return true;
+    }
+
+    if (G_TYPE_IS_INSTANTIATABLE(gtype)) {
         // The gtype is none of the above, it should be derived from a custom
         // fundamental type.
         if (!value.isObject())
-            return throw_expect_type(context, value, "object", gtype);
+            return throw_expect_type(cx, value, "object", gtype);
+
+        JS::RootedObject fundamental_object(cx, &value.toObject());
+        return FundamentalBase::to_gvalue(cx, fundamental_object, gvalue);
+    }
+
+    gjs_debug(GJS_DEBUG_GCLOSURE, "JS::Value is number %d gtype fundamental %d transformable to int %d from int %d",
+              value.isNumber(),
+              G_TYPE_IS_FUNDAMENTAL(gtype),
+              g_value_type_transformable(gtype, G_TYPE_INT),
+              g_value_type_transformable(G_TYPE_INT, gtype));
 
-        JS::RootedObject fundamental_object(context, &value.toObject());
-        if (!FundamentalBase::to_gvalue(context, fundamental_object, gvalue))
+    gjs_throw(cx, "Don't know how to convert JavaScript object to GType %s",
+              g_type_name(gtype));
+    return false;
+}
+
+// Indexed by GValueKind
+static constexpr ToGValueFunc to_g_value_funcs[] = {
+    nullptr,  // UNKNOWN
+    string_to_g_value,
+    char_to_g_value,
+    uchar_to_g_value,
+    int_to_g_value,
+    uint_to_g_value,
+    double_to_g_value,
+    float_to_g_value,
+    boolean_to_g_value,
+    object_to_g_value,
+    strv_to_g_value,
+    boxed_to_g_value,  // CONTAINER
+    boxed_to_g_value,
+    variant_to_g_value,
+    enum_to_g_value,
+    flags_to_g_value,
+    param_to_g_value,
+    gtype_to_g_value,
+    pointer_to_g_value,
+    other_to_g_value,
+};
+static_assert(G_N_ELEMENTS(to_g_value_funcs) == size_t(GValueKind::N_KINDS),
+              "to_g_value_funcs must have an entry for each GValueKind");
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+gjs_value_to_g_value_internal(JSContext      *context,
+                              JS::HandleValue value,
+                              GValue         *gvalue,
+                              bool            no_copy)
+{
+    GType gtype;
+
+    gtype = G_VALUE_TYPE(gvalue);
+
+    if (gtype == 0) {
+        if (!gjs_value_guess_g_type(context, value, &gtype))
             return false;
-    } else {
-        gjs_debug(GJS_DEBUG_GCLOSURE, "JS::Value is number %d gtype fundamental %d transformable to int %d from int %d",
-                  value.isNumber(),
-                  G_TYPE_IS_FUNDAMENTAL(gtype),
-                  g_value_type_transformable(gtype, G_TYPE_INT),
-                  g_value_type_transformable(G_TYPE_INT, gtype));
-
-        gjs_throw(context,
-                  "Don't know how to convert JavaScript object to GType %s",
-                  g_type_name(gtype));
-        return false;
+
+        if (gtype == G_TYPE_INVALID) {
+            gjs_throw(context, "Could not guess unspecified GValue type");
+            return false;
+        }
+
+        gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
+                          "Guessed GValue type %s from JS Value",
+                          g_type_name(gtype));
+
+        g_value_init(gvalue, gtype);
     }
 
-    return true;
+    gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
+                      "Converting JS::Value to gtype %s",
+                      g_type_name(gtype));
+
+    GValueKind kind = gvalue_kind_for_gtype(gtype);
+    return to_g_value_funcs[size_t(kind)](context, value, gvalue, gtype,
+                                          no_copy);
 }
 
 bool
@@ -777,236 +1117,326 @@ gjs_value_to_g_value_no_copy(JSContext      *context,
     return JS::NumberValue(v_double);
 }
 
+// Converters to JS values, one per GValueKind
+using FromGValueFunc = bool (*)(JSContext*, JS::MutableHandleValue,
+                                const GValue*, GType, bool no_copy,
+                                GSignalQuery*, int arg_n);
+
 GJS_JSAPI_RETURN_CONVENTION
-static bool
-gjs_value_from_g_value_internal(JSContext             *context,
-                                JS::MutableHandleValue value_p,
-                                const GValue          *gvalue,
-                                bool                   no_copy,
-                                GSignalQuery          *signal_query,
-                                int                    arg_n)
-{
-    GType gtype;
+static bool string_from_g_value(JSContext* cx, JS::MutableHandleValue value_p,
+                                const GValue* gvalue, GType, bool,
+                                GSignalQuery*, int) {
+    const char* v = g_value_get_string(gvalue);
+    if (v == NULL) {
+        gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
+                          "Converting NULL string to JS::NullValue()");
+        value_p.setNull();
+        return true;
+    }
+    return gjs_string_from_utf8(cx, v, value_p);
+}
 
-    gtype = G_VALUE_TYPE(gvalue);
+GJS_JSAPI_RETURN_CONVENTION
+static bool char_from_g_value(JSContext*, JS::MutableHandleValue value_p,
+                              const GValue* gvalue, GType, bool, GSignalQuery*,
+                              int) {
+    value_p.setInt32(g_value_get_schar(gvalue));
+    return true;
+}
 
-    gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
-                      "Converting gtype %s to JS::Value",
-                      g_type_name(gtype));
+GJS_JSAPI_RETURN_CONVENTION
+static bool uchar_from_g_value(JSContext*, JS::MutableHandleValue value_p,
+                               const GValue* gvalue, GType, bool,
+                               GSignalQuery*, int) {
+    value_p.setInt32(g_value_get_uchar(gvalue));
+    return true;
+}
 
-    if (gtype == G_TYPE_STRING) {
-        const char *v;
-        v = g_value_get_string(gvalue);
-        if (v == NULL) {
-            gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
-                              "Converting NULL string to JS::NullValue()");
-            value_p.setNull();
-        } else {
-            if (!gjs_string_from_utf8(context, v, value_p))
-                return false;
-        }
-    } else if (gtype == G_TYPE_CHAR) {
-        char v;
-        v = g_value_get_schar(gvalue);
-        value_p.setInt32(v);
-    } else if (gtype == G_TYPE_UCHAR) {
-        unsigned char v;
-        v = g_value_get_uchar(gvalue);
-        value_p.setInt32(v);
-    } else if (gtype == G_TYPE_INT) {
-        int v;
-        v = g_value_get_int(gvalue);
-        value_p.set(JS::NumberValue(v));
-    } else if (gtype == G_TYPE_UINT) {
-        guint v;
-        v = g_value_get_uint(gvalue);
-        value_p.setNumber(v);
-    } else if (gtype == G_TYPE_DOUBLE) {
-        double d;
-        d = g_value_get_double(gvalue);
-        value_p.setNumber(d);
-    } else if (gtype == G_TYPE_FLOAT) {
-        double d;
-        d = g_value_get_float(gvalue);
-        value_p.setNumber(d);
-    } else if (gtype == G_TYPE_BOOLEAN) {
-        bool v;
-        v = g_value_get_boolean(gvalue);
-        value_p.setBoolean(!!v);
-    } else if (g_type_is_a(gtype, G_TYPE_OBJECT) || g_type_is_a(gtype, G_TYPE_INTERFACE)) {
-        GObject *gobj;
-
-        gobj = (GObject*) g_value_get_object(gvalue);
-
-        if (gobj) {
-            JSObject* obj = ObjectInstance::wrapper_from_gobject(context, gobj);
-            if (!obj)
-                return false;
-            value_p.setObject(*obj);
-        } else {
-            value_p.setNull();
-        }
-    } else if (gtype == G_TYPE_STRV) {
-        if (!gjs_array_from_strv (context,
-                                  value_p,
-                                  (const char**) g_value_get_boxed (gvalue))) {
-            gjs_throw(context, "Failed to convert strv to array");
-            return false;
-        }
-    } else if (g_type_is_a(gtype, G_TYPE_HASH_TABLE) ||
-               g_type_is_a(gtype, G_TYPE_ARRAY) ||
-               g_type_is_a(gtype, G_TYPE_BYTE_ARRAY) ||
-               g_type_is_a(gtype, G_TYPE_PTR_ARRAY)) {
-        gjs_throw(context,
-                  "Unable to introspect element-type of container in GValue");
-        return false;
-    } else if (g_type_is_a(gtype, G_TYPE_BOXED) ||
-               g_type_is_a(gtype, G_TYPE_VARIANT)) {
-        void *gboxed;
-        JSObject *obj;
+GJS_JSAPI_RETURN_CONVENTION
+static bool int_from_g_value(JSContext*, JS::MutableHandleValue value_p,
+                             const GValue* gvalue, GType, bool, GSignalQuery*,
+                             int) {
+    value_p.set(JS::NumberValue(g_value_get_int(gvalue)));
+    return true;
+}
 
-        if (g_type_is_a(gtype, G_TYPE_BOXED))
-            gboxed = g_value_get_boxed(gvalue);
-        else
-            gboxed = g_value_get_variant(gvalue);
+GJS_JSAPI_RETURN_CONVENTION
+static bool uint_from_g_value(JSContext*, JS::MutableHandleValue value_p,
+                              const GValue* gvalue, GType, bool, GSignalQuery*,
+                              int) {
+    value_p.setNumber(g_value_get_uint(gvalue));
+    return true;
+}
 
-        if (!gboxed) {
-            gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
-                              "Converting null boxed pointer to JS::Value");
-            value_p.setNull();
-            return true;
-        }
+GJS_JSAPI_RETURN_CONVENTION
+static bool double_from_g_value(JSContext*, JS::MutableHandleValue value_p,
+                                const GValue* gvalue, GType, bool,
+                                GSignalQuery*, int) {
+    value_p.setNumber(g_value_get_double(gvalue));
+    return true;
+}
 
-        /* special case GError */
-        if (g_type_is_a(gtype, G_TYPE_ERROR)) {
-            obj = ErrorInstance::object_for_c_ptr(context,
-                                                  static_cast<GError*>(gboxed));
-            if (!obj)
-                return false;
-            value_p.setObject(*obj);
-            return true;
-        }
+GJS_JSAPI_RETURN_CONVENTION
+static bool float_from_g_value(JSContext*, JS::MutableHandleValue value_p,
+                               const GValue* gvalue, GType, bool,
+                               GSignalQuery*, int) {
+    value_p.setNumber(g_value_get_float(gvalue));
+    return true;
+}
 
-        /* special case GValue */
-        if (g_type_is_a(gtype, G_TYPE_VALUE)) {
-            return gjs_value_from_g_value(context, value_p,
-                                          static_cast<GValue *>(gboxed));
-        }
+GJS_JSAPI_RETURN_CONVENTION
+static bool boolean_from_g_value(JSContext*, JS::MutableHandleValue value_p,
+                                 const GValue* gvalue, GType, bool,
+                                 GSignalQuery*, int) {
+    value_p.setBoolean(!!g_value_get_boolean(gvalue));
+    return true;
+}
 
-        /* The only way to differentiate unions and structs is from
-         * their g-i info as both GBoxed */
-        GjsAutoBaseInfo info = g_irepository_find_by_gtype(nullptr, gtype);
-        if (!info) {
-            gjs_throw(context,
-                      "No introspection information found for %s",
-                      g_type_name(gtype));
-            return false;
-        }
+GJS_JSAPI_RETURN_CONVENTION
+static bool object_from_g_value(JSContext* cx, JS::MutableHandleValue value_p,
+                                const GValue* gvalue, GType, bool,
+                                GSignalQuery*, int) {
+    auto* gobj = static_cast<GObject*>(g_value_get_object(gvalue));
+    if (!gobj) {
+        value_p.setNull();
+        return true;
+    }
 
-        if (info.type() == GI_INFO_TYPE_STRUCT &&
-            g_struct_info_is_foreign(info)) {
-            GIArgument arg;
-            gjs_arg_set(&arg, gboxed);
-            return gjs_struct_foreign_convert_from_g_argument(context, value_p,
-                                                              info, &arg);
-        }
+    JSObject* obj = ObjectInstance::wrapper_from_gobject(cx, gobj);
+    if (!obj)
+        return false;
+    value_p.setObject(*obj);
+    return true;
+}
 
-        GIInfoType type = info.type();
-        if (type == GI_INFO_TYPE_BOXED || type == GI_INFO_TYPE_STRUCT) {
-            if (no_copy)
-                obj = BoxedInstance::new_for_c_struct(context, info, gboxed,
-                                                      BoxedInstance::NoCopy());
-            else
-                obj = BoxedInstance::new_for_c_struct(context, info, gboxed);
-        } else if (type == GI_INFO_TYPE_UNION) {
-            obj = gjs_union_from_c_union(context, info, gboxed);
-        } else {
-            gjs_throw(context, "Unexpected introspection type %d for %s",
-                      info.type(), g_type_name(gtype));
+GJS_JSAPI_RETURN_CONVENTION
+static bool strv_from_g_value(JSContext* cx, JS::MutableHandleValue value_p,
+                              const GValue* gvalue, GType, bool, GSignalQuery*,
+                              int) {
+    if (!gjs_array_from_strv(
+            cx, value_p, static_cast<const char**>(g_value_get_boxed(gvalue)))) {
+        gjs_throw(cx, "Failed to convert strv to array");
+        return false;
+    }
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool container_from_g_value(JSContext* cx, JS::MutableHandleValue,
+                                   const GValue*, GType, bool, GSignalQuery*,
+                                   int) {
+    gjs_throw(cx, "Unable to introspect element-type of container in GValue");
+    return false;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool boxed_from_g_value(JSContext* cx, JS::MutableHandleValue value_p,
+                               const GValue* gvalue, GType gtype, bool no_copy,
+                               GSignalQuery*, int) {
+    void* gboxed;
+    JSObject* obj;
+
+    if (g_type_is_a(gtype, G_TYPE_BOXED))
+        gboxed = g_value_get_boxed(gvalue);
+    else
+        gboxed = g_value_get_variant(gvalue);
+
+    if (!gboxed) {
+        gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
+                          "Converting null boxed pointer to JS::Value");
+        value_p.setNull();
+        return true;
+    }
+
+    /* special case GError */
+    if (g_type_is_a(gtype, G_TYPE_ERROR)) {
+        obj = ErrorInstance::object_for_c_ptr(cx, static_cast<GError*>(gboxed));
+        if (!obj)
             return false;
-        }
+        value_p.setObject(*obj);
+        return true;
+    }
 
-        value_p.setObjectOrNull(obj);
-    } else if (g_type_is_a(gtype, G_TYPE_ENUM)) {
-        value_p.set(convert_int_to_enum(gtype, g_value_get_enum(gvalue)));
-    } else if (g_type_is_a(gtype, G_TYPE_PARAM)) {
-        GParamSpec *gparam;
-        JSObject *obj;
+    /* special case GValue */
+    if (g_type_is_a(gtype, G_TYPE_VALUE)) {
+        return gjs_value_from_g_value(cx, value_p,
+                                      static_cast<GValue *>(gboxed));
+    }
 
-        gparam = g_value_get_param(gvalue);
+    /* The only way to differentiate unions and structs is from
+     * their g-i info as both GBoxed */
+    GjsAutoBaseInfo info = g_irepository_find_by_gtype(nullptr, gtype);
+    if (!info) {
+        gjs_throw(cx, "No introspection information found for %s",
+                  g_type_name(gtype));
+        return false;
+    }
 
-        obj = gjs_param_from_g_param(context, gparam);
-        value_p.setObjectOrNull(obj);
-    } else if (signal_query && g_type_is_a(gtype, G_TYPE_POINTER)) {
-        bool res;
-        GArgument arg;
-        GIArgInfo *arg_info;
-        GISignalInfo *signal_info;
+    if (info.type() == GI_INFO_TYPE_STRUCT &&
+        g_struct_info_is_foreign(info)) {
+        GIArgument arg;
+        gjs_arg_set(&arg, gboxed);
+        return gjs_struct_foreign_convert_from_g_argument(cx, value_p, info,
+                                                          &arg);
+    }
+
+    GIInfoType type = info.type();
+    if (type == GI_INFO_TYPE_BOXED || type == GI_INFO_TYPE_STRUCT) {
+        if (no_copy)
+            obj = BoxedInstance::new_for_c_struct(cx, info, gboxed,
+                                                  BoxedInstance::NoCopy());
+        else
+            obj = BoxedInstance::new_for_c_struct(cx, info, gboxed);
+    } else if (type == GI_INFO_TYPE_UNION) {
+        obj = gjs_union_from_c_union(cx, info, gboxed);
+    } else {
+        gjs_throw(cx, "Unexpected introspection type %d for %s", info.type(),
+                  g_type_name(gtype));
+        return false;
+    }
+
+    value_p.setObjectOrNull(obj);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool enum_from_g_value(JSContext*, JS::MutableHandleValue value_p,
+                              const GValue* gvalue, GType gtype, bool,
+                              GSignalQuery*, int) {
+    value_p.set(convert_int_to_enum(gtype, g_value_get_enum(gvalue)));
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool param_from_g_value(JSContext* cx, JS::MutableHandleValue value_p,
+                               const GValue* gvalue, GType, bool,
+                               GSignalQuery*, int) {
+    GParamSpec* gparam = g_value_get_param(gvalue);
+    JSObject* obj = gjs_param_from_g_param(cx, gparam);
+    value_p.setObjectOrNull(obj);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool pointer_from_g_value(JSContext* cx, JS::MutableHandleValue value_p,
+                                 const GValue* gvalue, GType, bool,
+                                 GSignalQuery* signal_query, int arg_n) {
+    if (signal_query) {
         GITypeInfo type_info;
 
-        signal_info = get_signal_info_if_available(signal_query);
+        GjsAutoCallableInfo signal_info =
+            get_signal_info_if_available(signal_query);
         if (!signal_info) {
-            gjs_throw(context, "Unknown signal.");
+            gjs_throw(cx, "Unknown signal.");
             return false;
         }
 
-        arg_info = g_callable_info_get_arg(signal_info, arg_n - 1);
+        GjsAutoArgInfo arg_info = g_callable_info_get_arg(signal_info, arg_n - 1);
         g_arg_info_load_type(arg_info, &type_info);
 
         g_assert(((void) "Check gjs_value_from_array_and_length_values() before"
                   " calling gjs_value_from_g_value_internal()",
                   g_type_info_get_array_length(&type_info) == -1));
 
+        GArgument arg;
         gjs_arg_set(&arg, g_value_get_pointer(gvalue));
 
-        res = gjs_value_from_g_argument(context, value_p, &type_info, &arg, true);
+        return gjs_value_from_g_argument(cx, value_p, &type_info, &arg, true);
+    }
 
-        g_base_info_unref((GIBaseInfo*)arg_info);
-        g_base_info_unref((GIBaseInfo*)signal_info);
-        return res;
-    } else if (g_type_is_a(gtype, G_TYPE_POINTER)) {
-        gpointer pointer;
+    if (g_value_get_pointer(gvalue) == NULL) {
+        value_p.setNull();
+        return true;
+    }
 
-        pointer = g_value_get_pointer(gvalue);
+    gjs_throw(cx, "Can't convert non-null pointer to JS value");
+    return false;
+}
 
-        if (pointer == NULL) {
-            value_p.setNull();
-        } else {
-            gjs_throw(context,
-                      "Can't convert non-null pointer to JS value");
-            return false;
-        }
-    } else if (g_value_type_transformable(gtype, G_TYPE_DOUBLE)) {
+GJS_JSAPI_RETURN_CONVENTION
+static bool other_from_g_value(JSContext* cx, JS::MutableHandleValue value_p,
+                               const GValue* gvalue, GType gtype, bool,
+                               GSignalQuery*, int) {
+    if (g_value_type_transformable(gtype, G_TYPE_DOUBLE)) {
         GValue double_value = { 0, };
-        double v;
         g_value_init(&double_value, G_TYPE_DOUBLE);
         g_value_transform(gvalue, &double_value);
-        v = g_value_get_double(&double_value);
-        value_p.setNumber(v);
-    } else if (g_value_type_transformable(gtype, G_TYPE_INT)) {
+        value_p.setNumber(g_value_get_double(&double_value));
+        return true;
+    }
+
+    if (g_value_type_transformable(gtype, G_TYPE_INT)) {
         GValue int_value = { 0, };
-        int v;
         g_value_init(&int_value, G_TYPE_INT);
         g_value_transform(gvalue, &int_value);
-        v = g_value_get_int(&int_value);
-        value_p.set(JS::NumberValue(v));
-    } else if (G_TYPE_IS_INSTANTIATABLE(gtype)) {
+        value_p.set(JS::NumberValue(g_value_get_int(&int_value)));
+        return true;
+    }
+
+    if (G_TYPE_IS_INSTANTIATABLE(gtype)) {
         /* The gtype is none of the above, it should be a custom
            fundamental type. */
         JSObject* obj =
-            FundamentalInstance::object_for_gvalue(context, gvalue, gtype);
-        if (obj == NULL)
+            FundamentalInstance::object_for_gvalue(cx, gvalue, gtype);
+        if (!obj)
             return false;
-        else
-            value_p.setObject(*obj);
-    } else {
-        gjs_throw(context,
-                  "Don't know how to convert GType %s to JavaScript object",
-                  g_type_name(gtype));
-        return false;
+        value_p.setObject(*obj);
+        return true;
     }
 
-    return true;
+    gjs_throw(cx, "Don't know how to convert GType %s to JavaScript object",
+              g_type_name(gtype));
+    return false;
+}
+
+// Indexed by GValueKind. Flags have no conversion of their own in this
+// direction and are converted as numbers by other_from_g_value(); GType is a
+// pointer type.
+static constexpr FromGValueFunc from_g_value_funcs[] = {
+    nullptr,  // UNKNOWN
+    string_from_g_value,
+    char_from_g_value,
+    uchar_from_g_value,
+    int_from_g_value,
+    uint_from_g_value,
+    double_from_g_value,
+    float_from_g_value,
+    boolean_from_g_value,
+    object_from_g_value,
+    strv_from_g_value,
+    container_from_g_value,
+    boxed_from_g_value,
+    boxed_from_g_value,  // VARIANT
+    enum_from_g_value,
+    other_from_g_value,  // FLAGS
+    param_from_g_value,
+    pointer_from_g_value,  // GTYPE
+    pointer_from_g_value,
+    other_from_g_value,
+};
+static_assert(G_N_ELEMENTS(from_g_value_funcs) == size_t(GValueKind::N_KINDS),
+              "from_g_value_funcs must have an entry for each GValueKind");
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool
+gjs_value_from_g_value_internal(JSContext             *context,
+                                JS::MutableHandleValue value_p,
+                                const GValue          *gvalue,
+                                bool                   no_copy,
+                                GSignalQuery          *signal_query,
+                                int                    arg_n)
+{
+    GType gtype;
+
+    gtype = G_VALUE_TYPE(gvalue);
+
+    gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
+                      "Converting gtype %s to JS::Value",
+                      g_type_name(gtype));
+
+    GValueKind kind = gvalue_kind_for_gtype(gtype);
+    return from_g_value_funcs[size_t(kind)](context, value_p, gvalue, gtype,
+                                            no_copy, signal_query, arg_n);
 }
 
 bool
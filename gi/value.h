@@ -28,6 +28,7 @@
 
 #include <glib-object.h>
 
+#include <js/CallArgs.h>
 #include <js/TypeDecls.h>
 
 #include "cjs/macros.h"
@@ -54,4 +55,35 @@ bool gjs_value_from_g_value(JSContext             *context,
                                                    const char* description,
                                                    unsigned signal_id);
 
+/* Records the JS arguments of a signal being emitted from JS, for as long as
+ * the emission lasts, so that JS signal handlers can reuse them instead of
+ * converting the GValues back. Emissions nest like a stack. */
+class GjsAutoSignalEmission {
+    static const GjsAutoSignalEmission* s_current;
+
+    const GjsAutoSignalEmission* m_prev;
+    const GValue* m_values;
+    const JS::CallArgs& m_args;
+
+ public:
+    GjsAutoSignalEmission(const GValue* instance_and_args,
+                          const JS::CallArgs& args)
+        : m_prev(s_current), m_values(instance_and_args), m_args(args) {
+        s_current = this;
+    }
+    ~GjsAutoSignalEmission() { s_current = m_prev; }
+
+    GjsAutoSignalEmission(const GjsAutoSignalEmission&) = delete;
+    GjsAutoSignalEmission& operator=(const GjsAutoSignalEmission&) = delete;
+
+    /* Returns the JS arguments (emit()'s arguments, the first one being the
+     * signal name) if @param_values is the array being emitted right now. */
+    [[nodiscard]] static const JS::CallArgs* args_for(
+        const GValue* param_values) {
+        if (s_current && s_current->m_values == param_values)
+            return &s_current->m_args;
+        return nullptr;
+    }
+};
+
 #endif  // GI_VALUE_H_
@@ -166,7 +166,7 @@ bool gjs_define_static_methods(JSContext* cx, JS::HandleObject constructor,
         // GI_FUNCTION_IS_CONSTRUCTOR and GI_FUNCTION_IS_STATIC or the like
         // in the future.
         if (!(flags & GI_FUNCTION_IS_METHOD)) {
-            if (!gjs_define_function(cx, constructor, gtype, meth_info))
+            if (!gjs_define_lazy_function(cx, constructor, gtype, meth_info))
                 return false;
         }
     }
@@ -186,7 +186,7 @@ bool gjs_define_static_methods(JSContext* cx, JS::HandleObject constructor,
         GjsAutoFunctionInfo meth_info =
             g_struct_info_get_method(type_struct, ix);
 
-        if (!gjs_define_function(cx, constructor, gtype, meth_info))
+        if (!gjs_define_lazy_function(cx, constructor, gtype, meth_info))
             return false;
     }
 
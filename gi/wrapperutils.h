@@ -44,6 +44,7 @@
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
 #include <jsapi.h>       // for JS_GetPrivate, JS_SetPrivate, JS_Ge...
+#include <jsfriendapi.h>  // for GetObjectClass, GetObjectPrivate
 #include <jspubtd.h>     // for JSProto_TypeError
 
 #include "gi/arg-inl.h"
@@ -80,6 +81,8 @@ enum Tag { Enum, Interface, Object, Struct, Union };
 
 namespace MemoryUse {
 constexpr JS::MemoryUse GObjectInstanceStruct = JS::MemoryUse::Embedding1;
+// Large buffers owned by wrapped native objects, such as pixel data
+constexpr JS::MemoryUse NativePayload = JS::MemoryUse::Embedding2;
 }
 
 struct GjsTypecheckNoThrow {};
@@ -174,10 +177,17 @@ class GIWrapperBase {
      *
      * Gets the Base belonging to a particular JS object wrapper. Checks that
      * the wrapper object has the right JSClass (Base::klass) and returns null
-     * if not. */
-    [[nodiscard]] static Base* for_js(JSContext* cx, JS::HandleObject wrapper) {
-        return static_cast<Base*>(
-            JS_GetInstancePrivate(cx, wrapper, &Base::klass, nullptr));
+     * if not.
+     *
+     * This is on the path of nearly every call, property access, and signal
+     * connection, so it is inlined down to a class pointer comparison and a
+     * load of the private slot, rather than going through
+     * JS_GetInstancePrivate(). */
+    [[nodiscard]] GJS_ALWAYS_INLINE static inline Base* for_js(
+        JSContext*, JS::HandleObject wrapper) {
+        if (js::GetObjectClass(wrapper) != &Base::klass)
+            return nullptr;
+        return static_cast<Base*>(js::GetObjectPrivate(wrapper));
     }
 
     /*
@@ -204,6 +214,9 @@ class GIWrapperBase {
     static Base* for_js_typecheck(
         JSContext* cx, JS::HandleObject wrapper,
         JS::CallArgs& args) {  // NOLINT(runtime/references)
+        if (G_LIKELY(js::GetObjectClass(wrapper) == &Base::klass))
+            return static_cast<Base*>(js::GetObjectPrivate(wrapper));
+        // Slow path, to throw the exception
         return static_cast<Base*>(
             JS_GetInstancePrivate(cx, wrapper, &Base::klass, &args));
     }
@@ -616,7 +629,7 @@ class GIWrapperBase {
      * @transfer_ownership indicate that it should.
      *
      * Includes a typecheck using GIWrapperBase::typecheck(), to which
-     * @expected_gtype and @expected_info are passed.
+     * @expected_gtype, @expected_info and @last_passed_gtype are passed.
      *
      * If returning false, then @arg's pointer field is null.
      */
@@ -626,11 +639,13 @@ class GIWrapperBase {
                                         GIDirection transfer_direction,
                                         GITransfer transfer_ownership,
                                         GType expected_gtype,
-                                        GIBaseInfo* expected_info = nullptr) {
+                                        GIBaseInfo* expected_info = nullptr,
+                                        GType* last_passed_gtype = nullptr) {
         g_assert(transfer_direction != GI_DIRECTION_INOUT &&
                  "transfer_to_gi_argument() must choose between in or out");
 
-        if (!Base::typecheck(cx, obj, expected_info, expected_gtype)) {
+        if (!Base::typecheck(cx, obj, expected_info, expected_gtype,
+                             last_passed_gtype)) {
             gjs_arg_unset<void*>(arg);
             return false;
         }
@@ -666,16 +681,21 @@ class GIWrapperBase {
      *
      * The overload with a GjsTypecheckNoThrow parameter will not throw a JS
      * exception if the prototype is passed in or the typecheck fails.
+     *
+     * @last_passed_gtype, if given, is an inline cache for a call site that
+     * always checks against the same @expected_gtype; see
+     * GIWrapperInstance::typecheck_cached().
      */
     GJS_JSAPI_RETURN_CONVENTION
     static bool typecheck(JSContext* cx, JS::HandleObject object,
-                          GIBaseInfo* expected_info, GType expected_gtype) {
+                          GIBaseInfo* expected_info, GType expected_gtype,
+                          GType* last_passed_gtype = nullptr) {
         Base* priv = Base::for_js_typecheck(cx, object);
         if (!priv || !priv->check_is_instance(cx, "convert to pointer"))
             return false;
 
-        if (priv->to_instance()->typecheck_impl(cx, expected_info,
-                                                expected_gtype))
+        if (priv->to_instance()->typecheck_cached(
+                cx, expected_info, expected_gtype, last_passed_gtype))
             return true;
 
         if (expected_info) {
@@ -696,13 +716,14 @@ class GIWrapperBase {
     [[nodiscard]] static bool typecheck(JSContext* cx, JS::HandleObject object,
                                         GIBaseInfo* expected_info,
                                         GType expected_gtype,
-                                        GjsTypecheckNoThrow) {
+                                        GjsTypecheckNoThrow,
+                                        GType* last_passed_gtype = nullptr) {
         Base* priv = Base::for_js(cx, object);
         if (!priv || priv->is_prototype())
             return false;
 
-        return priv->to_instance()->typecheck_impl(cx, expected_info,
-                                                   expected_gtype);
+        return priv->to_instance()->typecheck_cached(
+            cx, expected_info, expected_gtype, last_passed_gtype);
     }
 
     // Deleting these constructors and assignment operators will also delete
@@ -1046,12 +1067,13 @@ class GIWrapperInstance : public Base {
      * GIWrapperInstance::new_for_js_object:
      *
      * Creates a GIWrapperInstance and associates it with @obj as its private
-     * data. This is called by the JS constructor. Uses the slice allocator.
+     * data. This is called by the JS constructor. Uses the slice allocator,
+     * unless Instance overrides allocate_instance() and free_instance().
      */
     [[nodiscard]] static Instance* new_for_js_object(JSContext* cx,
                                                      JS::HandleObject obj) {
         g_assert(!JS_GetPrivate(obj));
-        auto* priv = g_slice_new0(Instance);
+        auto* priv = static_cast<Instance*>(Instance::allocate_instance());
         new (priv) Instance(cx, obj);
 
         // Init the private variable before we do anything else. If a garbage
@@ -1091,8 +1113,17 @@ class GIWrapperInstance : public Base {
 
  protected:
     void finalize_impl(JSFreeOp*, JSObject*) {
-        static_cast<Instance*>(this)->~Instance();
-        g_slice_free(Instance, this);
+        auto* priv = static_cast<Instance*>(this);
+        priv->~Instance();
+        Instance::free_instance(priv);
+    }
+
+    // Override if necessary; must return zero-filled memory
+    [[nodiscard]] static void* allocate_instance() {
+        return g_slice_alloc0(sizeof(Instance));
+    }
+    static void free_instance(void* mem) {
+        g_slice_free1(sizeof(Instance), mem);
     }
 
     // Override if necessary
@@ -1118,6 +1149,33 @@ class GIWrapperInstance : public Base {
             return g_base_info_equal(Base::info(), expected_info);
         return true;
     }
+
+    /*
+     * GIWrapperInstance::typecheck_cached:
+     * @last_passed_gtype: (nullable): the GType of the last instance that
+     *   passed this check, updated on success
+     *
+     * Like typecheck_impl(), but the common case of a call site seeing the
+     * same GType as last time is one comparison instead of a walk up the type
+     * hierarchy in g_type_is_a().
+     */
+    [[nodiscard]] bool typecheck_cached(JSContext* cx,
+                                        GIBaseInfo* expected_info,
+                                        GType expected_gtype,
+                                        GType* last_passed_gtype) const {
+        if (!last_passed_gtype || expected_gtype == G_TYPE_NONE)
+            return static_cast<const Instance*>(this)->typecheck_impl(
+                cx, expected_info, expected_gtype);
+
+        GType gtype = Base::gtype();
+        if (G_LIKELY(gtype == *last_passed_gtype))
+            return true;
+        if (!static_cast<const Instance*>(this)->typecheck_impl(
+                cx, expected_info, expected_gtype))
+            return false;
+        *last_passed_gtype = gtype;
+        return true;
+    }
 };
 
 #endif  // GI_WRAPPERUTILS_H_
@@ -0,0 +1,120 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <glib-object.h>
+#include <glib.h>
+
+#include "gjs-test-tools.h"
+
+typedef struct {
+    int n_calls;
+    GjsTestToolsNotifyFunc func;
+    void* user_data;
+    GDestroyNotify destroy;
+} CallInThreadData;
+
+static void* call_in_thread_func(void* data) {
+    CallInThreadData* call = data;
+
+    for (int ix = 1; ix <= call->n_calls; ix++) {
+        char* message = g_strdup_printf("call %d", ix);
+        call->func(ix, message, call->user_data);
+        g_free(message);
+    }
+    if (call->destroy)
+        call->destroy(call->user_data);
+
+    return NULL;
+}
+
+/**
+ * gjs_test_tools_call_in_thread:
+ * @n_calls: how many times to call @func
+ * @func: (scope notified) (closure user_data) (destroy destroy): the function
+ *   to call
+ * @user_data: the data to pass to @func
+ * @destroy: called on @user_data after the last call
+ *
+ * Calls @func @n_calls times from a new thread, and then @destroy, also from
+ * that thread. Waits for the thread to finish before returning.
+ */
+void gjs_test_tools_call_in_thread(int n_calls, GjsTestToolsNotifyFunc func,
+                                   void* user_data, GDestroyNotify destroy) {
+    CallInThreadData call = {n_calls, func, user_data, destroy};
+    GThread* thread =
+        g_thread_new("gjs-test-tools-call", call_in_thread_func, &call);
+    g_thread_join(thread);
+}
+
+typedef struct {
+    GThread* thread;
+    GObject** objects;
+    int n_objects;
+    int first;
+    guint64 n_ops;
+} RefUnrefData;
+
+/* Takes and drops a reference from a thread other than the owner's, so that
+ * for objects with a toggle reference, each operation queues a toggle up and
+ * a toggle down */
+static void* ref_unref_func(void* data) {
+    RefUnrefData* worker = data;
+
+    for (guint64 ix = 0; ix < worker->n_ops; ix++) {
+        GObject* gobj =
+            worker->objects[(worker->first + ix) % worker->n_objects];
+        g_object_ref(gobj);
+        g_object_unref(gobj);
+    }
+
+    return NULL;
+}
+
+/**
+ * gjs_test_tools_ref_unref_in_threads:
+ * @objects: (array length=n_objects): the objects to take references to
+ * @n_objects: the number of objects
+ * @n_threads: how many threads to share the work between
+ * @n_ops: the total number of times to take and drop a reference
+ *
+ * Takes and drops references to @objects, one after the other, from
+ * @n_threads new threads. Waits for the threads to finish before returning.
+ */
+void gjs_test_tools_ref_unref_in_threads(GObject** objects, int n_objects,
+                                         int n_threads, guint64 n_ops) {
+    g_return_if_fail(n_objects > 0 && n_threads > 0);
+
+    RefUnrefData* workers = g_new0(RefUnrefData, n_threads);
+    for (int ix = 0; ix < n_threads; ix++) {
+        RefUnrefData* worker = &workers[ix];
+        worker->objects = objects;
+        worker->n_objects = n_objects;
+        worker->first = (guint64)ix * n_objects / n_threads;
+        worker->n_ops = n_ops / n_threads + ((guint64)ix < n_ops % n_threads);
+        worker->thread =
+            g_thread_new("gjs-test-tools-ref", ref_unref_func, worker);
+    }
+    for (int ix = 0; ix < n_threads; ix++)
+        g_thread_join(workers[ix].thread);
+    g_free(workers);
+}
@@ -0,0 +1,49 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef INSTALLED_TESTS_JS_LIBGJSTESTTOOLS_GJS_TEST_TOOLS_H_
+#define INSTALLED_TESTS_JS_LIBGJSTESTTOOLS_GJS_TEST_TOOLS_H_
+
+#include <glib-object.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GjsTestToolsNotifyFunc:
+ * @value: the number of the call, starting from 1
+ * @message: a string that is freed right after the call returns
+ * @user_data: (closure): the data passed along with the function
+ */
+typedef void (*GjsTestToolsNotifyFunc)(int value, const char* message,
+                                       void* user_data);
+
+void gjs_test_tools_call_in_thread(int n_calls, GjsTestToolsNotifyFunc func,
+                                   void* user_data, GDestroyNotify destroy);
+
+void gjs_test_tools_ref_unref_in_threads(GObject** objects, int n_objects,
+                                         int n_threads, guint64 n_ops);
+
+G_END_DECLS
+
+#endif  // INSTALLED_TESTS_JS_LIBGJSTESTTOOLS_GJS_TEST_TOOLS_H_
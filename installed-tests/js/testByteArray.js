@@ -64,6 +64,34 @@ describe('Byte array', function () {
         expect(ByteArray.toGBytes(a).get_size()).toEqual(0);
     });
 
+    it('can transfer its memory to a GBytes', function () {
+        const a = Uint8Array.from([97, 98, 99, 100]);
+        const other = new Uint8Array(a.buffer, 1, 2);
+        const bytes = ByteArray.toGBytes(a, true);
+        expect(a.length).toEqual(0);
+        expect(other.length).toEqual(0);
+        expect(bytes.get_size()).toEqual(4);
+        expect(ByteArray.toString(bytes.toArray())).toEqual('abcd');
+    });
+
+    it('copies a partial view instead of transferring', function () {
+        const a = Uint8Array.from([97, 98, 99, 100]);
+        const view = a.subarray(1, 3);
+        const bytes = ByteArray.toGBytes(view, true);
+        expect(view.length).toEqual(2);
+        expect(ByteArray.toString(bytes.toArray())).toEqual('bc');
+    });
+
+    it('transfers memory back and forth with GBytes', function () {
+        const bytes = new GLib.Bytes(Uint8Array.from([1, 2, 3]));
+        const a = bytes.toArray();
+        expect(Array.from(a)).toEqual([1, 2, 3]);
+        const bytes2 = ByteArray.toGBytes(a, true);
+        expect(a.length).toEqual(0);
+        expect(Array.from(bytes2.toArray())).toEqual([1, 2, 3]);
+        expect(Array.from(bytes.toArray())).toEqual([1, 2, 3]);
+    });
+
     it('deals gracefully with a non Uint8Array', function () {
         const a = [97, 98, 99, 100, 0];
         expect(() => ByteArray.toString(a)).toThrow();
@@ -92,3 +120,53 @@ describe('Byte array', function () {
         });
     });
 });
+
+describe('StringBuilder', function () {
+    it('concatenates appended values', function () {
+        const builder = new ByteArray.StringBuilder();
+        expect(builder.append('a', 1, null).append('b')).toBe(builder);
+        expect(builder.length).toEqual(7);
+        expect(builder.toString()).toEqual('a1nullb');
+    });
+
+    it('switches to two-byte characters when needed', function () {
+        const builder = new ByteArray.StringBuilder(16);
+        builder.append('ä', '⅜', 'b', '😀');
+        expect(builder.toString()).toEqual('ä⅜b😀');
+        expect(builder.length).toEqual(5);
+    });
+
+    it('keeps non-ASCII Latin-1 characters after switching to two-byte', function () {
+        const builder = new ByteArray.StringBuilder();
+        builder.append('⅜', 'äÿ\x80');
+        expect(builder.toString()).toEqual('⅜äÿ\x80');
+        expect(Array.from(builder.toString(), c => c.charCodeAt(0)))
+            .toEqual([0x215c, 0xe4, 0xff, 0x80]);
+        expect(Array.from(builder.toGBytes().toArray())).toEqual(
+            [0xe2, 0x85, 0x9c, 0xc3, 0xa4, 0xc3, 0xbf, 0xc2, 0x80]);
+    });
+
+    it('encodes non-ASCII Latin-1 characters as UTF-8', function () {
+        const builder = new ByteArray.StringBuilder();
+        builder.append('aé');
+        expect(builder.toString()).toEqual('aé');
+        expect(Array.from(builder.toGBytes().toArray()))
+            .toEqual([97, 0xc3, 0xa9]);
+    });
+
+    it('can be cleared and reused', function () {
+        const builder = new ByteArray.StringBuilder();
+        builder.append('⅜');
+        builder.clear();
+        expect(builder.length).toEqual(0);
+        expect(builder.append('x').toString()).toEqual('x');
+    });
+
+    it('produces UTF-8 GBytes', function () {
+        const builder = new ByteArray.StringBuilder();
+        builder.append('a⅜');
+        const bytes = builder.toGBytes();
+        expect(bytes instanceof GLib.Bytes).toBe(true);
+        expect(Array.from(bytes.toArray())).toEqual([97, 0xe2, 0x85, 0x9c]);
+    });
+});
@@ -102,6 +102,17 @@ describe('Cairo', function () {
             expect(cr.deviceToUserDistance(0, 0).length).toEqual(2);
         });
 
+        it('converts and checks the arguments of its methods', function () {
+            cr.setLineWidth('3');
+            expect(cr.getLineWidth()).toEqual(3);
+            cr.setLineCap(Cairo.LineCap.SQUARE + 0.5);
+            expect(cr.getLineCap()).toEqual(Cairo.LineCap.SQUARE);
+            expect(() => cr.moveTo(1)).toThrow();
+            expect(() => cr.moveTo(1, 2, 3)).toThrow();
+            expect(() => cr.rectangle(0, 0, Symbol('width'), 1))
+                .toThrowError(/argument 2 \(width\)/);
+        });
+
         it('can call various, otherwise untested, methods without crashing', function () {
             expect(() => {
                 cr.save();
@@ -233,6 +244,62 @@ describe('Cairo', function () {
             expect(() => cr.appendPath({})).toThrow();
             expect(() => cr.appendPath(surface)).toThrow();
         });
+
+        it('can be built from typed arrays in one call', function () {
+            const {MOVE_TO, LINE_TO, CURVE_TO, CLOSE_PATH} = Cairo.PathDataType;
+            const ops = new Uint8Array([MOVE_TO, LINE_TO, CURVE_TO, CLOSE_PATH]);
+            const coords = new Float64Array([1, 1, 5, 1, 6, 2, 7, 3, 5, 5]);
+            cr.appendPathData(ops, coords);
+            const [outOps, outCoords] = cr.copyPath().toData();
+            expect(Array.from(outOps)).toEqual([MOVE_TO, LINE_TO, CURVE_TO,
+                CLOSE_PATH, MOVE_TO]);
+            expect(Array.from(outCoords.subarray(0, 10))).toEqual(Array.from(coords));
+        });
+
+        it('can be created from and converted to typed arrays', function () {
+            const ops = new Uint8Array([Cairo.PathDataType.MOVE_TO,
+                Cairo.PathDataType.LINE_TO]);
+            const coords = new Float64Array([0, 0, 2, 3]);
+            const path = Cairo.Path.fromData(ops, coords);
+            cr.appendPath(path);
+            expect(cr.getCurrentPoint()).toEqual([2, 3]);
+            const [outOps, outCoords] = path.toData();
+            expect(Array.from(outOps)).toEqual(Array.from(ops));
+            expect(Array.from(outCoords)).toEqual([0, 0, 2, 3]);
+        });
+
+        it('rejects malformed path data', function () {
+            expect(() => cr.appendPathData(new Uint8Array([7]),
+                new Float64Array(0))).toThrowError(RangeError);
+            expect(() => cr.appendPathData(new Uint8Array([0]),
+                new Float64Array(3))).toThrowError(RangeError);
+            expect(() => cr.appendPathData([0], [1, 2])).toThrow();
+        });
+    });
+
+    describe('region', function () {
+        it('can be built from and converted to an Int32Array', function () {
+            const region = Cairo.Region.fromRectangles(new Int32Array([
+                0, 0, 10, 10,
+                20, 0, 10, 10,
+            ]));
+            expect(region.numRectangles()).toEqual(2);
+            expect(Array.from(region.getRectangles()))
+                .toEqual([0, 0, 10, 10, 20, 0, 10, 10]);
+        });
+
+        it('unites many rectangles at once', function () {
+            const region = new Cairo.Region();
+            region.unionRectangle({x: 0, y: 0, width: 5, height: 5});
+            region.unionRectangles(new Int32Array([5, 0, 5, 5, 0, 5, 10, 5]));
+            expect(Array.from(region.getRectangles())).toEqual([0, 0, 10, 10]);
+        });
+
+        it('rejects malformed rectangle arrays', function () {
+            expect(() => Cairo.Region.fromRectangles([0, 0, 1, 1])).toThrow();
+            expect(() => Cairo.Region.fromRectangles(new Int32Array(3)))
+                .toThrow();
+        });
     });
 
     describe('surface', function () {
@@ -241,6 +308,61 @@ describe('Cairo', function () {
             const pattern = new Cairo.SurfacePattern(surface);
             expect(() => new Cairo.Context(pattern)).toThrow();
         });
+
+        it('gives access to its pixels without copying', function () {
+            cr.setSourceRGBA(1, 0, 0, 1);
+            cr.paint();
+            const data = surface.getData();
+            expect(data instanceof Uint8ClampedArray).toBe(true);
+            expect(data.length).toEqual(surface.getStride() * 10);
+            const pixel = new Uint32Array(data.buffer, 0, 1)[0];
+            expect(pixel).toEqual(0xffff0000);
+
+            data.fill(0);
+            surface.markDirty();
+            expect(surface.getData()[0]).toEqual(0);
+        });
+
+        it('can be created over existing pixels', function () {
+            const stride = 4 * 2;
+            const pixels = new Uint8Array(stride * 2).fill(0xff);
+            const imageSurface = Cairo.ImageSurface.createForData(pixels,
+                Cairo.Format.ARGB32, 2, 2, stride);
+            expect(pixels.length).toEqual(0);
+            expect(imageSurface.getWidth()).toEqual(2);
+            expect(Array.from(imageSurface.getData())).toEqual(
+                new Array(stride * 2).fill(0xff));
+        });
+
+        it('rejects pixel buffers that are too small', function () {
+            expect(() => Cairo.ImageSurface.createForData(new ArrayBuffer(4),
+                Cairo.Format.ARGB32, 2, 2, 8)).toThrowError(RangeError);
+        });
+
+        it('can release its memory before being garbage collected', function () {
+            const imageSurface = new Cairo.ImageSurface(Cairo.Format.ARGB32, 4, 4);
+            const data = imageSurface.getData();
+            imageSurface.dispose();
+            expect(() => imageSurface.getWidth()).toThrowError(/disposed/);
+            expect(() => new Cairo.Context(imageSurface)).toThrow();
+            expect(data.length).toEqual(4 * 4 * 4);
+            expect(() => imageSurface.dispose()).not.toThrow();
+        });
+
+        it('checks the type of the object being disposed of', function () {
+            const {dispose} = Object.getPrototypeOf(Cairo.ImageSurface.prototype);
+            const context = new Cairo.Context(
+                new Cairo.ImageSurface(Cairo.Format.ARGB32, 1, 1));
+            expect(() => dispose.call(context)).toThrowError(/Cairo.Surface/);
+            expect(() => dispose.call({})).toThrowError(/Cairo.Surface/);
+            expect(() => context.getTarget()).not.toThrow();
+        });
+
+        it('can be finished', function () {
+            const imageSurface = new Cairo.ImageSurface(Cairo.Format.ARGB32, 4, 4);
+            imageSurface.finish();
+            expect(imageSurface.getWidth()).toEqual(4);
+        });
     });
 
     describe('GI test suite', function () {
@@ -200,4 +200,17 @@ describe('thrown GError', function () {
         expect(err.domain).toEqual(Gio.io_error_quark());
         expect(err.code).toEqual(Gio.IOErrorEnum.NOT_FOUND);
     });
+
+    it('has the location where it was thrown', function () {
+        expect(err.fileName).toMatch(/testExceptions\.js$/);
+        expect(err.lineNumber).toEqual(jasmine.any(Number));
+        expect(err.columnNumber).toEqual(jasmine.any(Number));
+        expect(err.stack).toMatch(/testExceptions\.js:\d+:\d+/);
+    });
+
+    it('keeps assigned location properties', function () {
+        err.stack = 'custom stack';
+        expect(err.fileName).toMatch(/testExceptions\.js$/);
+        expect(err.stack).toEqual('custom stack');
+    });
 });
@@ -54,7 +54,44 @@ describe('imports.format', function () {
         expect(() => '%Ix'.format(42)).toThrow();
     });
 
+    it('throws a RangeError for a width longer than any string', function () {
+        expect(() => '%2000000000s'.format('')).toThrowError(RangeError);
+        expect(() => '%99999999999999999999d'.format(1)).toThrowError(RangeError);
+    });
+
     it('throws an error when incorrectly instructed to swap arguments', function () {
         expect(() => '%2$d %d %1$d'.format(1, 2, 3)).toThrow();
     });
+
+    it('gives the same results when formatting the same string again', function () {
+        const fmt = 'a %s b %03d %%';
+        expect(fmt.format('x', 5)).toEqual('a x b 005 %');
+        expect(fmt.format('y', 42)).toEqual('a y b 042 %');
+        expect(() => '%z'.format(42))
+            .toThrowError('Unsupported conversion character %z');
+        expect(() => '%z'.format(42))
+            .toThrowError('Unsupported conversion character %z');
+    });
+
+    it('converts numbers the same way as parseInt() and parseFloat()', function () {
+        expect('%d %d %d'.format(5.7, -5.7, '12px')).toEqual('5 -5 12');
+        expect('%d %x'.format(1e21, -255)).toEqual('1 -ff');
+        expect('%d %f'.format('abc', Infinity)).toEqual('NaN Infinity');
+        expect('%.1f'.format('2.25')).toEqual((2.25).toFixed(1));
+    });
+
+    it('formats symbols and objects as strings', function () {
+        expect('%s'.format(Symbol('foo'))).toEqual('Symbol(foo)');
+        expect('%s'.format({toString: () => 'obj'})).toEqual('obj');
+    });
+
+    it('leaves a trailing % alone', function () {
+        expect('100%'.format()).toEqual('100%');
+        expect('no conversions'.format()).toEqual('no conversions');
+    });
+
+    it('can be called reentrantly from an argument', function () {
+        const arg = {toString: () => 'inner %s'.format('x')};
+        expect('outer %s'.format(arg)).toEqual('outer inner x');
+    });
 });
@@ -1,8 +1,24 @@
 const {GObject, Regress} = imports.gi;
+const System = imports.system;
 
 describe('Fundamental type support', function () {
     it('can marshal a subtype of a custom fundamental type into a GValue', function () {
         const fund = new Regress.TestFundamentalSubObject('plop');
         expect(() => GObject.strdup_value_contents(fund)).not.toThrow();
     });
+
+    it('shares one prototype between instances of a hidden subtype', function () {
+        const first = Regress.test_create_fundamental_hidden_class_instance();
+        const second = Regress.test_create_fundamental_hidden_class_instance();
+        expect(Object.getPrototypeOf(first)).toBe(Object.getPrototypeOf(second));
+        expect(first instanceof Regress.TestFundamentalObject).toBe(true);
+    });
+
+    it('wraps fundamentals again after their wrappers are collected', function () {
+        Regress.test_create_fundamental_hidden_class_instance();
+        System.gc();
+        const fund = Regress.test_create_fundamental_hidden_class_instance();
+        expect(fund instanceof Regress.TestFundamentalObject).toBe(true);
+        expect(() => GObject.strdup_value_contents(fund)).not.toThrow();
+    });
 });
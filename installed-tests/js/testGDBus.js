@@ -323,6 +323,20 @@ describe('Exported DBus object', function () {
         loop.run();
     });
 
+    it('dispatches method calls without emitting a signal', function () {
+        const handler = jasmine.createSpy('handle-method-call');
+        const id = test._impl.connect('handle-method-call', handler);
+        proxy.noInParameterRemote(([result], excp) => {
+            expect(excp).toBeNull();
+            expect(result).toEqual('Yes!');
+            loop.quit();
+        });
+        loop.run();
+        test._impl.disconnect(id);
+
+        expect(handler).not.toHaveBeenCalled();
+    });
+
     it('can call a remote method when not using makeProxyWrapper', function () {
         let info = Gio.DBusNodeInfo.new_for_xml(TestIface);
         let iface = info.interfaces[0];
@@ -348,6 +362,16 @@ describe('Exported DBus object', function () {
         loop.run();
     });
 
+    it('shares the setup of proxies for the same interface', function () {
+        const otherProxy = new ProxyClass(Gio.DBus.session,
+            'org.gnome.gjs.Test', '/org/gnome/gjs/Test');
+        expect(otherProxy.frobateStuffRemote).toBe(proxy.frobateStuffRemote);
+        expect(otherProxy.hasOwnProperty('PropReadOnly')).toBeTruthy();
+        expect(otherProxy.PropReadOnly).toEqual(PROP_READ_ONLY_INITIAL_VALUE);
+        expect(Gio.DBusInterfaceInfo.new_for_xml(TestIface))
+            .toBe(Gio.DBusInterfaceInfo.new_for_xml(TestIface));
+    });
+
     /* excp must be exactly the exception thrown by the remote method
        (more or less) */
     it('can handle an exception thrown by a remote method', function () {
@@ -380,6 +404,18 @@ describe('Exported DBus object', function () {
         loop.run();
     });
 
+    it('passes the error of a cancelled call to the callback', function () {
+        const cancellable = new Gio.Cancellable();
+        cancellable.cancel();
+        proxy.frobateStuffRemote({}, cancellable, (result, excp) => {
+            expect(result).toEqual([]);
+            expect(excp.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.CANCELLED))
+                .toBe(true);
+            loop.quit();
+        });
+        loop.run();
+    });
+
     it('throws an exception when trying to call a method that does not exist', function () {
         /* First remove the method from the object! */
         delete Test.prototype.thisDoesNotExist;
@@ -658,4 +694,26 @@ describe('Exported DBus object', function () {
 
         expect(proxy.PropReadOnly).toBe(PROP_READ_ONLY_INITIAL_VALUE);
     });
+
+    it('emits several property changes in one signal', function () {
+        const changes = [];
+        const id = proxy.connect('g-properties-changed', (p, changed) => {
+            changes.push(Object.keys(changed.deepUnpack()).sort());
+            loop.quit();
+        });
+
+        test._impl.set_flush_delay(10);
+        test._impl.emit_property_changed('PropReadOnly',
+            new GLib.Variant('d', 1.5));
+        test._impl.emit_properties_changed(new GLib.Variant('a{sv}', {
+            PropReadOnly: new GLib.Variant('d', 2.5),
+            PropReadWrite: new GLib.Variant('v', new GLib.Variant('s', 'x')),
+        }));
+        loop.run();
+        test._impl.set_flush_delay(0);
+        proxy.disconnect(id);
+
+        expect(changes).toEqual([['PropReadOnly', 'PropReadWrite']]);
+        expect(proxy.PropReadOnly).toEqual(2.5);
+    });
 });
@@ -335,6 +335,12 @@ describe('Fixed-size C array', function () {
             jasmine.objectContaining({long_: 6, int8: 7}),
         ]);
     });
+
+    it('copies each element of a struct array into its own wrapper', function () {
+        const array = GIMarshallingTests.array_fixed_out_struct();
+        array[0].long_ = 42;
+        expect(array[1].long_).toEqual(6);
+    });
 });
 
 describe('C array with length', function () {
@@ -409,6 +415,13 @@ describe('C array with length', function () {
             testInParameter('array_struct_value', createStructArray(), {
                 skip: 'https://gitlab.gnome.org/GNOME/gjs/issues/44',
             });
+
+            it('checks the type of every element', function () {
+                const array = createStructArray();
+                array[2] = new GIMarshallingTests.SimpleStruct();
+                expect(() => GIMarshallingTests.array_struct_value_in(array))
+                    .toThrow();
+            });
         });
     });
 
@@ -511,6 +524,17 @@ describe('GArray', function () {
     describe('of ints with transfer none', function () {
         testReturnValue('garray_int_none', [-1, 0, 1, 2]);
         testInParameter('garray_int_none', [-1, 0, 1, 2]);
+
+        // garray_int_none_in() aborts unless it receives [-1, 0, 1, 2]
+        it('can be passed in as a TypedArray', function () {
+            expect(() => GIMarshallingTests.garray_int_none_in(
+                Int32Array.from([-1, 0, 1, 2]))).not.toThrow();
+            expect(() => GIMarshallingTests.garray_int_none_in(
+                Float64Array.from([-1, 0, 1, 2]))).not.toThrow();
+            const padded = Int32Array.from([9, -1, 0, 1, 2, 9]);
+            expect(() => GIMarshallingTests.garray_int_none_in(
+                padded.subarray(1, 5))).not.toThrow();
+        });
     });
 
     it('marshals int64s as a transfer-none return value', function () {
@@ -559,12 +583,17 @@ describe('GPtrArray', function () {
         testContainerMarshalling('garray_utf8', ['0', '1', '2'], ['-2', '-1', '0', '1']);
     });
 
-    // describe('of structs', function () {
-    //     it('can be returned with transfer full', function () {
-    //         expect(GIMarshallingTests.gptrarray_boxed_struct_full_return().map(e => e.long_))
-    //             .toEqual([42, 43, 44]);
-    //     });
-    // });
+    describe('of structs', function () {
+        it('can be returned with transfer full', function () {
+            expect(GIMarshallingTests.gptrarray_boxed_struct_full_return().map(e => e.long_))
+                .toEqual([42, 43, 44]);
+        });
+
+        it('wraps each element as a boxed struct', function () {
+            const array = GIMarshallingTests.gptrarray_boxed_struct_full_return();
+            array.forEach(e => expect(e).toEqual(jasmine.any(GIMarshallingTests.BoxedStruct)));
+        });
+    });
 });
 
 describe('GByteArray', function () {
@@ -578,6 +607,23 @@ describe('GByteArray', function () {
         expect(() => GIMarshallingTests.bytearray_none_in([0, 49, 0xFF, 51]))
             .not.toThrow();
     });
+
+    it('can be passed in as other binary data with transfer none', function () {
+        expect(() => GIMarshallingTests.bytearray_none_in(refByteArray.buffer))
+            .not.toThrow();
+        expect(() => GIMarshallingTests.bytearray_none_in(
+            new DataView(refByteArray.buffer))).not.toThrow();
+    });
+
+    it('copies the bytes of other binary data', function () {
+        const buffer = Uint8Array.from([7, 0, 49, 0xFF, 51, 7]).buffer;
+        expect(GLib.ByteArray.free_to_bytes(buffer.slice(1, 5)).toArray())
+            .toEqual(refByteArray);
+        expect(GLib.ByteArray.free_to_bytes(new DataView(buffer, 1, 4)).toArray())
+            .toEqual(refByteArray);
+        expect(GLib.ByteArray.free_to_bytes(new Int8Array(buffer, 1, 4)).toArray())
+            .toEqual(refByteArray);
+    });
 });
 
 describe('GBytes', function () {
@@ -630,6 +676,15 @@ describe('GBytes', function () {
 
 describe('GStrv', function () {
     testSimpleMarshalling('gstrv', ['0', '1', '2'], ['-1', '0', '1', '2']);
+
+    it('can be passed as an array-like object', function () {
+        const arrayLike = {length: 3, 0: '0', 1: '1', 2: '2'};
+        expect(() => GIMarshallingTests.gstrv_in(arrayLike)).not.toThrow();
+    });
+
+    it('throws when an element is not a string', function () {
+        expect(() => GIMarshallingTests.gstrv_in(['0', 1, '2'])).toThrow();
+    });
 });
 
 ['GList', 'GSList'].forEach(listKind => {
@@ -1512,6 +1567,25 @@ describe('Configurations of return values', function () {
         expect(GIMarshallingTests.int_return_out()).toEqual([6, 7]);
     });
 
+    it('can store several out parameters into a reused array', function () {
+        const out = [];
+        expect(GIMarshallingTests.int_out_out.callInto(out, null)).toBe(out);
+        expect(out).toEqual([6, 7]);
+
+        GIMarshallingTests.int_three_in_three_out.callInto(out, null, 1, 2, 3);
+        expect(out).toEqual([1, 2, 3]);
+
+        GIMarshallingTests.int_return_out.callInto(out, null);
+        expect(out).toEqual([6, 7]);
+    });
+
+    it('can store a single return value into an array', function () {
+        const out = [];
+        GIMarshallingTests.int_three_in_three_out.callInto(out, null, 4, 5, 6);
+        GIMarshallingTests.int_return_max.callInto(out, null);
+        expect(out).toEqual([GLib.MAXINT32]);
+    });
+
     it('can handle four in parameters, two of which are nullable', function () {
         expect(() => GIMarshallingTests.int_two_in_utf8_two_in_with_allow_none(1, 2, '3', '4'))
             .not.toThrow();
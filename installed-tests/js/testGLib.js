@@ -69,6 +69,77 @@ describe('GVariant constructor', function () {
         [112, 105, 122, 122, 97].forEach((val, ix) =>
             expect(a[ix]).toEqual(val));
     });
+
+    it('constructs a dictionary variant with nested containers', function () {
+        const variant = new GLib.Variant('a{sv}', {
+            name: new GLib.Variant('s', 'pizza'),
+            slices: new GLib.Variant('(nqu)', [-8, 8, 4000000000]),
+            toppings: new GLib.Variant('as', ['cheese', 'basil']),
+            price: new GLib.Variant('md', 9.5),
+        });
+        expect(variant.get_type_string()).toEqual('a{sv}');
+        expect(variant.recursiveUnpack()).toEqual({
+            name: 'pizza',
+            slices: [-8, 8, 4000000000],
+            toppings: ['cheese', 'basil'],
+            price: 9.5,
+        });
+    });
+
+    it('coerces values that do not exactly match the signature', function () {
+        expect(new GLib.Variant('i', '42').unpack()).toEqual(42);
+        expect(new GLib.Variant('d', true).unpack()).toEqual(1);
+        expect(new GLib.Variant('a{is}', {1: 'one'}).deepUnpack())
+            .toEqual({1: 'one'});
+    });
+
+    it('throws on values that are out of range for the signature', function () {
+        expect(() => new GLib.Variant('y', 256)).toThrow();
+        expect(() => new GLib.Variant('(yy)', [1, -1])).toThrow();
+    });
+
+    it('throws on an invalid signature', function () {
+        expect(() => new GLib.Variant('(i', [1])).toThrowError(TypeError);
+        expect(() => new GLib.Variant('ii', 1)).toThrowError(TypeError);
+        expect(() => new GLib.Variant('', 1)).toThrowError(TypeError);
+    });
+});
+
+describe('GVariant unpacking on another thread', function () {
+    const value = {
+        name: new GLib.Variant('s', 'pizza'),
+        slices: new GLib.Variant('(nqu)', [-8, 8, 4000000000]),
+        toppings: new GLib.Variant('as', ['cheese', 'basil']),
+        price: new GLib.Variant('md', 9.5),
+        missing: new GLib.Variant('ms', null),
+        bytes: new GLib.Variant('ay', Uint8Array.of(1, 2)),
+    };
+
+    it('gives the same result as recursiveUnpack()', function (done) {
+        const variant = new GLib.Variant('a{sv}', value);
+        variant.recursiveUnpackAsync().then(unpacked => {
+            const {bytes, ...rest} = unpacked;
+            expect(Array.from(bytes)).toEqual([1, 2]);
+            expect(rest).toEqual({
+                name: 'pizza',
+                slices: [-8, 8, 4000000000],
+                toppings: ['cheese', 'basil'],
+                price: 9.5,
+                missing: null,
+            });
+            done();
+        }, done.fail);
+    });
+
+    it('leaves variants packed with deepUnpackAsync()', function (done) {
+        const variant = new GLib.Variant('(sv)', ['a', value.name]);
+        variant.deepUnpackAsync().then(unpacked => {
+            expect(unpacked[0]).toEqual('a');
+            expect(unpacked[1] instanceof GLib.Variant).toBe(true);
+            expect(unpacked[1].unpack()).toEqual('pizza');
+            done();
+        }, done.fail);
+    });
 });
 
 describe('GVariant unpack', function () {
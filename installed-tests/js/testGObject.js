@@ -2,7 +2,7 @@
 // except for the class machinery, interface machinery, and GObject.ParamSpec,
 // which are big enough to get their own files.
 
-const {GLib, GObject} = imports.gi;
+const {Gio, GLib, GObject} = imports.gi;
 
 describe('GObject overrides', function () {
     const TestObj = GObject.registerClass({
@@ -24,6 +24,35 @@ describe('GObject overrides', function () {
         expect(o.int).toBe(42);
     });
 
+    it('GObject.set() notifies after all properties are set', function () {
+        const o = new Gio.SocketClient();
+        const values = [];
+        o.connect('notify', () => values.push([o.timeout, o.enableProxy]));
+        o.set({timeout: 42, enableProxy: false});
+        expect(values).toEqual([[42, false], [42, false]]);
+    });
+
+    it('GObject.set() assigns other keys as JS properties', function () {
+        const o = new TestObj();
+        o.set({int: 5, customKey: 'value'});
+        expect(o.int).toBe(5);
+        expect(o.customKey).toBe('value');
+    });
+
+    it('GObject.set() keeps the order of GObject and JS properties', function () {
+        const o = new Gio.SocketClient();
+        const seen = [], notified = [];
+        Object.defineProperty(o, 'jsOnly', {
+            set(value) {
+                seen.push([value, o.timeout, o.enableProxy]);
+            },
+        });
+        o.connect('notify', () => notified.push([o.timeout, o.enableProxy]));
+        o.set({timeout: 42, jsOnly: 'a', enableProxy: false});
+        expect(seen).toEqual([['a', 42, true]]);
+        expect(notified).toEqual([[42, false], [42, false]]);
+    });
+
     describe('Signal alternative syntax', function () {
         let o, handler;
         beforeEach(function () {
@@ -232,6 +232,98 @@ describe('GObject class with decorator', function () {
         expect(notifySpy).toHaveBeenCalledTimes(2);
     });
 
+    it('passes the same ParamSpec object to each notify handler call', function () {
+        const pspecs = [];
+        myInstance.connect('notify::readonly', (obj, pspec) => pspecs.push(pspec));
+
+        myInstance.notifyProp();
+        myInstance.notifyProp();
+
+        expect(pspecs.length).toEqual(2);
+        expect(pspecs[0]).toBe(pspecs[1]);
+        expect(pspecs[0].name).toEqual('readonly');
+    });
+
+    it('can batch notify emissions for several properties', function (done) {
+        const obj = new MyObject();
+        obj.connect_notify_batched(['readwrite', 'readonly'], (emitter, names) => {
+            expect(emitter).toBe(obj);
+            expect(names.sort()).toEqual(['readonly', 'readwrite']);
+            done();
+        });
+
+        obj.notify('readwrite');
+        obj.notify('readonly');
+        obj.notify('readwrite');
+        obj.notify('construct');
+    });
+
+    it('can disconnect batched notify handlers', function (done) {
+        const obj = new MyObject();
+        const spy = jasmine.createSpy('batchedSpy');
+        const id = obj.connect_notify_batched(['readwrite'], spy);
+
+        obj.notify('readwrite');
+        obj.disconnect(id);
+
+        GLib.idle_add(GLib.PRIORITY_LOW, () => {
+            expect(spy).not.toHaveBeenCalled();
+            done();
+            return GLib.SOURCE_REMOVE;
+        });
+    });
+
+    it('can disconnect all handlers connected for an owner at once', function () {
+        const obj = new MyObject();
+        const owner = new GObject.Object();
+        const emptySpy = jasmine.createSpy('emptySpy');
+        const notifySpy = jasmine.createSpy('notifySpy');
+        obj.connectObject('empty', emptySpy, 'notify::readonly', notifySpy, owner);
+
+        obj.emitEmpty();
+        obj.notifyProp();
+        expect(emptySpy).toHaveBeenCalledTimes(1);
+        expect(notifySpy).toHaveBeenCalledTimes(1);
+
+        expect(obj.disconnectObject(owner)).toEqual(2);
+        obj.emitEmpty();
+        obj.notifyProp();
+        expect(emptySpy).toHaveBeenCalledTimes(1);
+        expect(notifySpy).toHaveBeenCalledTimes(1);
+    });
+
+    it('disconnects handlers when their owner is disposed', function () {
+        const obj = new MyObject();
+        const owner = new GObject.Object();
+        const emptySpy = jasmine.createSpy('emptySpy');
+        obj.connectObject('empty', emptySpy, owner);
+
+        owner.run_dispose();
+        obj.emitEmpty();
+        expect(emptySpy).not.toHaveBeenCalled();
+    });
+
+    it('only disconnects handlers for the given owner', function () {
+        const obj = new MyObject();
+        const emptySpy = jasmine.createSpy('emptySpy');
+        obj.connectObject('empty', emptySpy, new GObject.Object());
+        obj.connect('empty', emptySpy);
+
+        expect(obj.disconnectObject(new GObject.Object())).toEqual(0);
+        obj.emitEmpty();
+        expect(emptySpy).toHaveBeenCalledTimes(2);
+    });
+
+    it('throws when connectObject() is not given an owner', function () {
+        expect(() => myInstance.connectObject('empty', () => {})).toThrow();
+        expect(() => myInstance.connectObject('empty', () => {}, {})).toThrow();
+    });
+
+    it('throws when batching notify emissions for a nonexistent property', function () {
+        expect(() => myInstance.connect_notify_batched(['nonexistent'], () => {}))
+            .toThrowError(/nonexistent/);
+    });
+
     it('can define its own signals', function () {
         let emptySpy = jasmine.createSpy('emptySpy');
         myInstance.connect('empty', emptySpy);
@@ -249,6 +341,14 @@ describe('GObject class with decorator', function () {
         expect(minimalSpy).toHaveBeenCalledWith(myInstance, 7, 5);
     });
 
+    it('converts emitted arguments to the signal parameter types', function () {
+        let minimalSpy = jasmine.createSpy('minimalSpy');
+        myInstance.connect('minimal', minimalSpy);
+        myInstance.emitMinimal(7.5, '5');
+
+        expect(minimalSpy).toHaveBeenCalledWith(myInstance, 7, 5);
+    });
+
     it('can return values from signals', function () {
         let fullSpy = jasmine.createSpy('fullSpy').and.returnValue(42);
         myInstance.connect('full', fullSpy);
@@ -447,6 +547,15 @@ describe('GObject class with decorator', function () {
         expect(new Derived().toString()).toMatch(
             /\[object instance wrapper GType:Gjs_Derived jsobj@0x[a-f0-9]+ native@0x[a-f0-9]+\]/);
     });
+
+    it('inherits the class-wide prototype properties', function () {
+        expect(Object.prototype.toString.call(new Derived()))
+            .toEqual('[object GObject_Object]');
+        expect(Object.getOwnPropertySymbols(GObject.InitiallyUnowned.prototype))
+            .not.toContain(Symbol.toStringTag);
+        expect(Object.getOwnPropertySymbols(GObject.Object.prototype))
+            .toContain(Symbol.toStringTag);
+    });
 });
 
 describe('GObject virtual function', function () {
@@ -518,6 +627,32 @@ describe('GObject virtual function', function () {
             vfunc_init_async() {}
         })).toThrow();
     });
+
+    it('creates all the signals of a class together with the type', function () {
+        const signals = {
+            'first': {},
+            'second': {param_types: [GObject.TYPE_INT]},
+        };
+        const ManySignals = GObject.registerClass({
+            GTypeName: 'ManySignals',
+            Signals: signals,
+        }, class ManySignals extends GObject.Object {});
+
+        expect(GObject.signal_lookup('first', ManySignals.$gtype)).toEqual(signals.first.signal_id);
+        expect(GObject.signal_lookup('second', ManySignals.$gtype)).toEqual(signals.second.signal_id);
+        const obj = new ManySignals();
+        const handler = jasmine.createSpy('second');
+        obj.connect('second', handler);
+        obj.emit('second', 42);
+        expect(handler).toHaveBeenCalledWith(obj, 42);
+    });
+
+    it('reports the name of an invalid signal', function () {
+        expect(() => GObject.registerClass({
+            Signals: {'bad-signal': {param_types: ['not a type']}},
+        }, class BadSignal extends GObject.Object {}))
+            .toThrowError(TypeError, /Invalid signal bad-signal/);
+    });
 });
 
 describe('GObject creation using base classes without registered GType', function () {
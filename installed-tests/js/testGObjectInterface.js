@@ -295,6 +295,24 @@ describe('GObject interface', function () {
         expect(obj.interface_prop).toEqual('foobar');  // override not needed
     });
 
+    it('gives consistent instanceof results when checked repeatedly', function () {
+        const objects = [
+            new GObjectImplementingGObjectInterface(),
+            new GObject.Object(),
+            new MinimalImplementationOfAGObjectInterface(),
+            new Gio.SimpleAction({name: 'foo'}),
+        ];
+        for (let i = 0; i < 3; i++) {
+            expect(objects.map(o => o instanceof AGObjectInterface))
+                .toEqual([true, false, true, false]);
+            expect(objects.map(o => o instanceof Gio.Action))
+                .toEqual([false, false, false, true]);
+        }
+        expect({} instanceof AGObjectInterface).toBeFalsy();
+        expect(GObjectImplementingGObjectInterface.prototype instanceof
+            AGObjectInterface).toBeFalsy();
+    });
+
     it('has a toString() defintion', function () {
         expect(new GObjectImplementingGObjectInterface().toString()).toMatch(
             /\[object instance wrapper GType:Gjs_GObjectImplementingGObjectInterface jsobj@0x[a-f0-9]+ native@0x[a-f0-9]+\]/);
@@ -1,6 +1,7 @@
 // We use Gio to have some objects that we know exist
 const Gio = imports.gi.Gio;
 const GObject = imports.gi.GObject;
+const System = imports.system;
 
 describe('Looking up param specs', function () {
     let p1, p2;
@@ -51,6 +52,14 @@ describe('GType object', function () {
         expect(GObject.TYPE_NONE.toString()).toEqual("[object GType for 'void']");
         expect(GObject.TYPE_STRING.toString()).toEqual("[object GType for 'gchararray']");
     });
+
+    it('is the same object each time it is looked up', function () {
+        const gtype = GObject.type_from_name('GSimpleAction');
+        expect(gtype).toBe(Gio.SimpleAction.$gtype);
+        System.gc();
+        expect(GObject.type_from_name('GSimpleAction')).toBe(gtype);
+        expect(new Gio.SimpleAction({name: 'test'}).constructor.$gtype).toBe(gtype);
+    });
 });
 
 describe('GType marshalling', function () {
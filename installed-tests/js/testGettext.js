@@ -12,3 +12,30 @@ describe('Gettext module', function () {
         expect(locale.length).not.toBeLessThan(1);
     });
 });
+
+describe('Gettext lookups', function () {
+    it('return the message ID when there is no translation', function () {
+        expect(Gettext.gettext('cjs-untranslated-message')).toEqual('cjs-untranslated-message');
+        expect(Gettext.dgettext('cjs-test', 'cjs-untranslated-message')).toEqual('cjs-untranslated-message');
+        expect(Gettext.pgettext('context', 'cjs-untranslated-message')).toEqual('cjs-untranslated-message');
+    });
+
+    it('return the same result when repeated', function () {
+        const first = Gettext.gettext('cjs-repeated-message');
+        expect(Gettext.gettext('cjs-repeated-message')).toEqual(first);
+        Gettext.bindtextdomain('cjs-test', '/nonexistent');
+        expect(Gettext.gettext('cjs-repeated-message')).toEqual(first);
+    });
+
+    it('distinguish domains and contexts of the same message ID', function () {
+        const domain = Gettext.domain('cjs-test');
+        expect(domain.gettext('cjs-shared-message')).toEqual('cjs-shared-message');
+        expect(domain.pgettext('context', 'cjs-shared-message')).toEqual('cjs-shared-message');
+        expect(Gettext.gettext('cjs-shared-message')).toEqual('cjs-shared-message');
+    });
+
+    it('throw on a message ID that is not a string', function () {
+        expect(() => Gettext.gettext(42)).toThrow();
+        expect(() => Gettext.dgettext({}, 'message')).toThrow();
+    });
+});
@@ -25,6 +25,29 @@ describe('ListStore iterator', function () {
         let i = 0;
         for (let f of list)
             expect(f.value).toBe(i++);
+        expect(i).toBe(100);
+    });
+
+    it('iterates over more items than fit in one chunk', function () {
+        for (let i = 100; i < 1000; i++)
+            list.append(new Foo(i));
+        let i = 0;
+        for (let f of list)
+            expect(f.value).toBe(i++);
+        expect(i).toBe(1000);
+    });
+
+    it('returns the same wrappers as get_item()', function () {
+        const [first] = list;
+        expect(first).toBe(list.get_item(0));
+    });
+
+    it('can take a snapshot of the items', function () {
+        const items = list.toArray();
+        list.remove_all();
+        expect(items.length).toBe(100);
+        expect(items[99].value).toBe(99);
+        expect(list.toArray()).toEqual([]);
     });
 });
 
@@ -75,6 +98,12 @@ describe('Gio.Settings overrides', function () {
             });
         });
 
+        it("doesn't crash when using a key of another type", function () {
+            expect(() => settings.get_int('maximized')).toThrowError(/type b/);
+            expect(() => settings.set_string('window-size', 'big'))
+                .toThrowError(/type \(ii\)/);
+        });
+
         it("doesn't crash when checking writable for a nonexistent key", function () {
             expect(() => settings.is_writable('foobar')).toThrowError(/key/);
         });
@@ -147,3 +176,134 @@ describe('Gio.Settings overrides', function () {
         });
     });
 });
+
+describe('Async functions called without a callback', function () {
+    const file = Gio.File.new_for_path('.');
+
+    it('return a promise that resolves with the result', function (done) {
+        const promise = file.query_info_async('standard::name',
+            Gio.FileQueryInfoFlags.NONE, GLib.PRIORITY_DEFAULT, null);
+        expect(promise).toEqual(jasmine.any(Promise));
+        promise.then(info => {
+            expect(info).toEqual(jasmine.any(Gio.FileInfo));
+            done();
+        }, done.fail);
+    });
+
+    it('leave out the success flag of out arguments', function (done) {
+        Gio.File.new_for_path('/dev/null').load_contents_async(null)
+            .then(([contents, etag]) => {
+                expect(contents.length).toEqual(0);
+                expect(etag).toBeDefined();
+                done();
+            }, done.fail);
+    });
+
+    it('reject with the error of the _finish function', function (done) {
+        Gio.File.new_for_path('/nonexistent-gjs-test-file').query_info_async(
+            'standard::name', Gio.FileQueryInfoFlags.NONE,
+            GLib.PRIORITY_DEFAULT, null)
+            .then(() => done.fail('should have rejected'), error => {
+                expect(error).toEqual(jasmine.any(GLib.Error));
+                expect(error.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.NOT_FOUND))
+                    .toBeTruthy();
+                done();
+            });
+    });
+
+    it('still call a callback that is passed', function (done) {
+        const retval = file.query_info_async('standard::name',
+            Gio.FileQueryInfoFlags.NONE, GLib.PRIORITY_DEFAULT, null,
+            (source, res) => {
+                expect(source.query_info_finish(res)).toEqual(jasmine.any(Gio.FileInfo));
+                done();
+            });
+        expect(retval).toBeUndefined();
+    });
+});
+
+describe('Gio._promisify()', function () {
+    beforeAll(function () {
+        Gio._promisify(Gio.File.prototype, 'query_info_async',
+            'query_info_finish');
+    });
+
+    it('keeps the introspected function', function () {
+        expect(Gio.File.prototype.query_info_async)
+            .toBe(Gio.File.prototype._original_query_info_async);
+    });
+
+    it('adds the calling stack to rejections', function (done) {
+        Gio.File.new_for_path('/nonexistent-gjs-test-file').query_info_async(
+            'standard::name', Gio.FileQueryInfoFlags.NONE,
+            GLib.PRIORITY_DEFAULT, null)
+            .then(() => done.fail('should have rejected'), error => {
+                expect(error.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.NOT_FOUND))
+                    .toBeTruthy();
+                expect(error.stack).toMatch(/Promise created here/);
+                expect(error.stack).toMatch(/testGio\.js/);
+                done();
+            });
+    });
+});
+
+describe('Stream overrides for Uint8Arrays', function () {
+    const encoder = new TextEncoder();
+
+    it('read into an existing array', function () {
+        const stream = Gio.MemoryInputStream.new_from_bytes(
+            new GLib.Bytes(encoder.encode('abcdef')));
+        const array = new Uint8Array(8);
+        expect(stream.read_into(array, 2, 3)).toEqual(3);
+        expect(Array.from(array)).toEqual([0, 0, 97, 98, 99, 0, 0, 0]);
+        expect(stream.read_into(array)).toEqual(3);
+        expect(Array.from(array.subarray(0, 3))).toEqual([100, 101, 102]);
+    });
+
+    it('read large amounts directly into an array', function () {
+        const data = new Uint8Array(4096).map((_, ix) => ix % 251);
+        const stream = Gio.MemoryInputStream.new_from_bytes(new GLib.Bytes(data));
+        const array = new Uint8Array(4096);
+        expect(stream.read_into(array)).toEqual(4096);
+        expect(array.every((byte, ix) => byte === data[ix])).toBe(true);
+    });
+
+    it('write all of a part of an array', function () {
+        const stream = Gio.MemoryOutputStream.new_resizable();
+        expect(stream.write_all_from(encoder.encode('abcdef'), 1, 4)).toEqual(4);
+        stream.close(null);
+        expect(Array.from(stream.steal_as_bytes().toArray()))
+            .toEqual([98, 99, 100, 101]);
+    });
+
+    it('rejects out of bounds ranges', function () {
+        const stream = Gio.MemoryOutputStream.new_resizable();
+        expect(() => stream.write_all_from(new Uint8Array(4), 2, 3))
+            .toThrowError(RangeError);
+    });
+
+    it('reads asynchronously, detaching the array meanwhile', function (done) {
+        const stream = Gio.MemoryInputStream.new_from_bytes(
+            new GLib.Bytes(encoder.encode('abc')));
+        const array = new Uint8Array(4);
+        stream.read_into_async(array, 1).then(([nread, newArray]) => {
+            expect(nread).toEqual(3);
+            expect(Array.from(newArray)).toEqual([0, 97, 98, 99]);
+            done();
+        }, done.fail);
+        expect(array.length).toEqual(0);
+    });
+
+    it('writes asynchronously', function (done) {
+        const stream = Gio.MemoryOutputStream.new_resizable();
+        stream.write_all_from_async(encoder.encode('abc'))
+            .then(([written, array]) => {
+                expect(written).toEqual(3);
+                expect(array.length).toEqual(3);
+                stream.close(null);
+                expect(Array.from(stream.steal_as_bytes().toArray()))
+                    .toEqual([97, 98, 99]);
+                done();
+            }, done.fail);
+    });
+});
@@ -234,6 +234,21 @@ describe('Gtk overrides', function () {
         expect(s.get_child_by_name('foo')).toBeNull();
     });
 
+    it('sets several child properties at once', function () {
+        const box = new Gtk.Box();
+        const first = new Gtk.Label();
+        const second = new Gtk.Label();
+        box.add(first);
+        box.add(second);
+
+        box.child_set_properties(first, {expand: true, fill: false, padding: 5});
+        box.child_set_properties(second, {position: 0, 'pack-type': Gtk.PackType.END});
+
+        expect(box.query_child_packing(first).slice(0, 3)).toEqual([true, false, 5]);
+        expect(box.query_child_packing(second)[3]).toEqual(Gtk.PackType.END);
+        expect(box.get_children()).toEqual([second, first]);
+    });
+
     it('can create a Gtk.TreeIter with accessible stamp field', function () {
         const iter = new Gtk.TreeIter();
         iter.stamp = 42;
@@ -4,6 +4,14 @@ describe('GI importer', function () {
         expect(GLib.MAJOR_VERSION).toEqual(2);
     });
 
+    it('resolves and enumerates the names in a namespace', function () {
+        const Regress = imports.gi.Regress;
+        expect(Regress.TestObj).toBeDefined();
+        expect(Regress.nonexistentThing).not.toBeDefined();
+        expect(Object.keys(Regress)).toContain('TestObj', 'TestEnum',
+            'test_boolean');
+    });
+
     describe('on failure', function () {
         // For these tests, we provide special overrides files to sabotage the
         // import, at the path resource:///org/gjs/jsunit/modules/badOverrides.
@@ -222,8 +230,184 @@ describe('Importer', function () {
         });
     });
 
+    describe('importAsync()', function () {
+        it('resolves with a module that was already imported', function (done) {
+            imports.importAsync('foobar').then(module => {
+                expect(module).toBe(foobar);
+                done();
+            }, done.fail);
+        });
+
+        it('resolves with the same module as a regular import', function (done) {
+            imports.mutualImport.importAsync('a').then(module => {
+                expect(module.getCount).toEqual(jasmine.any(Function));
+                expect(module).toBe(imports.mutualImport.a);
+                done();
+            }, done.fail);
+        });
+
+        it('rejects with an import error for a nonexistent module', function (done) {
+            imports.importAsync('nonexistentModuleName')
+                .then(() => done.fail('should have rejected'), error => {
+                    expect(error.name).toEqual('ImportError');
+                    done();
+                });
+        });
+
+        it('rejects when evaluating the module file throws', function (done) {
+            imports.importAsync('alwaysThrows')
+                .then(() => done.fail('should have rejected'), done);
+        });
+    });
+
     it("doesn't crash when resolving a non-string property", function () {
         expect(imports[0]).not.toBeDefined();
         expect(imports.foobar[0]).not.toBeDefined();
     });
 });
+
+describe('Importer with modules in the file system', function () {
+    const GLib = imports.gi.GLib;
+    let oldSearchPath, tmpDir;
+
+    beforeAll(function () {
+        tmpDir = GLib.dir_make_tmp('gjs-importer-XXXXXX');
+        GLib.file_set_contents(GLib.build_filenamev([tmpDir, 'prefetchA.js']),
+            'var B = imports.prefetchB;\n');
+        GLib.file_set_contents(GLib.build_filenamev([tmpDir, 'prefetchB.js']),
+            'var value = 42;\n');
+        // More references that are never imported than prefetch holds on to
+        const unclaimed = [];
+        for (let ix = 0; ix < 70; ix++) {
+            GLib.file_set_contents(
+                GLib.build_filenamev([tmpDir, `unclaimed${ix}.js`]), '');
+            unclaimed.push(`// imports.unclaimed${ix}`);
+        }
+        GLib.file_set_contents(GLib.build_filenamev([tmpDir, 'prefetchC.js']),
+            `${unclaimed.join('\n')}\nvar inner = imports.prefetchDir.inner;\n`);
+        GLib.mkdir_with_parents(GLib.build_filenamev([tmpDir, 'prefetchDir']),
+            0o755);
+        GLib.file_set_contents(
+            GLib.build_filenamev([tmpDir, 'prefetchDir', 'inner.js']),
+            'var value = 7;\n');
+        // Over the size from which importAsync() compiles off the main thread
+        GLib.file_set_contents(GLib.build_filenamev([tmpDir, 'largeModule.js']),
+            `var value = 42;\n${'// padding\n'.repeat(4000)}`);
+
+        oldSearchPath = imports.searchPath.slice();
+        imports.searchPath = [tmpDir];
+    });
+
+    afterAll(function () {
+        imports.searchPath = oldSearchPath;
+        const names = ['prefetchA.js', 'prefetchB.js', 'prefetchC.js',
+            'prefetchDir/inner.js', 'addedLater.js', 'largeModule.js'];
+        for (let ix = 0; ix < 70; ix++)
+            names.push(`unclaimed${ix}.js`);
+        names.forEach(name => GLib.unlink(GLib.build_filenamev([tmpDir, name])));
+        GLib.rmdir(GLib.build_filenamev([tmpDir, 'prefetchDir']));
+        GLib.rmdir(tmpDir);
+    });
+
+    it('imports modules that a module refers to', function () {
+        const A = imports.prefetchA;
+        expect(A.B.value).toEqual(42);
+        expect(A.B).toBe(imports.prefetchB);
+    });
+
+    it('imports modules after many references that were never imported',
+        function () {
+            // Imported already, so prefetchC's reference to it is skipped
+            expect(imports.prefetchDir.inner.value).toEqual(7);
+            const C = imports.prefetchC;
+            expect(C.inner).toBe(imports.prefetchDir.inner);
+            expect(imports.unclaimed69).toBeDefined();
+            expect(imports.prefetchB.value).toEqual(42);
+        });
+
+    it('compiles a large module off the main thread', function (done) {
+        imports.importAsync('largeModule').then(module => {
+            expect(module.value).toEqual(42);
+            expect(module).toBe(imports.largeModule);
+            done();
+        }, done.fail);
+    });
+
+    it('imports a module created after the directory was listed', function () {
+        expect(() => imports.addedLater).toThrowError(/No JS module/);
+        GLib.file_set_contents(GLib.build_filenamev([tmpDir, 'addedLater.js']),
+            'var value = 7;\n');
+        expect(imports.addedLater.value).toEqual(7);
+    });
+});
+
+describe('Importer with an application bundle', function () {
+    const GLib = imports.gi.GLib;
+    const files = {
+        'cjs-bundle.ini': '[Bundle]\nRoot=/org/cinnamon/CjsTest/bundle/js\nRequires=GLib-2.0\n',
+        'js/bundleModule.js': 'var value = 42;\n',
+        'js/bundleDir/inner.js': 'var value = "inner";\n',
+        'nometadata.js': 'var value = 0;\n',
+        'bundle.gresource.xml': `<gresources>
+            <gresource prefix="/"><file>cjs-bundle.ini</file></gresource>
+            <gresource prefix="/org/cinnamon/CjsTest/bundle">
+                <file>js/bundleModule.js</file>
+                <file>js/bundleDir/inner.js</file>
+            </gresource>
+        </gresources>`,
+        'nometadata.gresource.xml': `<gresources>
+            <gresource prefix="/org/cinnamon/CjsTest/nometadata">
+                <file>nometadata.js</file>
+            </gresource>
+        </gresources>`,
+    };
+    let tmpDir, oldSearchPath, compiled;
+
+    function compileBundle(name) {
+        const [, , , status] = GLib.spawn_sync(tmpDir,
+            ['glib-compile-resources', `--target=${name}.gresource`,
+                `${name}.gresource.xml`],
+            null, GLib.SpawnFlags.SEARCH_PATH, null);
+        return status === 0;
+    }
+
+    beforeAll(function () {
+        tmpDir = GLib.dir_make_tmp('cjs-test-bundle-XXXXXX');
+        GLib.mkdir_with_parents(`${tmpDir}/js/bundleDir`, 0o755);
+        Object.entries(files).forEach(([name, contents]) =>
+            GLib.file_set_contents(`${tmpDir}/${name}`, contents));
+        compiled = GLib.find_program_in_path('glib-compile-resources') &&
+            compileBundle('bundle') && compileBundle('nometadata');
+
+        oldSearchPath = imports.searchPath.slice();
+        imports.searchPath = [`${tmpDir}/bundle.gresource`];
+    });
+
+    beforeEach(function () {
+        if (!compiled)
+            pending('glib-compile-resources is needed to build the bundle');
+    });
+
+    afterAll(function () {
+        imports.searchPath = oldSearchPath;
+        Object.keys(files).concat(['bundle.gresource', 'nometadata.gresource'])
+            .forEach(name => GLib.unlink(`${tmpDir}/${name}`));
+        ['js/bundleDir', 'js', ''].forEach(dir => GLib.rmdir(`${tmpDir}/${dir}`));
+    });
+
+    it('imports a module from the bundle', function () {
+        expect(imports.bundleModule.value).toEqual(42);
+        expect(imports.bundleModule.__file__)
+            .toEqual('resource:///org/cinnamon/CjsTest/bundle/js/bundleModule.js');
+    });
+
+    it('imports a module from a directory in the bundle', function () {
+        expect(imports.bundleDir.inner.value).toEqual('inner');
+    });
+
+    it('throws for a bundle without metadata', function () {
+        imports.searchPath = [`${tmpDir}/nometadata.gresource`];
+        expect(() => imports.nometadata).toThrowError(/cjs-bundle\.ini/);
+        imports.searchPath = [`${tmpDir}/bundle.gresource`];
+    });
+});
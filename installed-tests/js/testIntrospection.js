@@ -152,3 +152,34 @@ describe('Complete enumeration of GIRepositoryNamespace (new_enumerate)', functi
         expect(names).toEqual(jasmine.arrayContaining(expectAtLeast));
     });
 });
+
+describe('Batched calls', function () {
+    it('returns the result of each call', function () {
+        const results = imports.gi.batch([
+            [GLib.bit_storage, null, 255],
+            [GLib.bit_storage, null, 256],
+            [GLib.ascii_strup, null, 'foo', -1],
+        ]);
+        expect(results).toEqual([8, 9, 'FOO']);
+    });
+
+    it('runs remaining calls and collects errors', function () {
+        let error;
+        try {
+            imports.gi.batch([
+                [GLib.bit_storage, null],
+                [GLib.bit_storage, null, 1],
+            ]);
+        } catch (e) {
+            error = e;
+        }
+        expect(error.errors[0]).toEqual(jasmine.any(TypeError));
+        expect(error.errors[1]).not.toBeDefined();
+        expect(error.results[1]).toEqual(1);
+    });
+
+    it('throws when not given introspected functions', function () {
+        expect(() => imports.gi.batch([[() => {}, null]])).toThrow();
+        expect(() => imports.gi.batch([42])).toThrow();
+    });
+});
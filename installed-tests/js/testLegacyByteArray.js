@@ -1,5 +1,5 @@
 const ByteArray = imports.byteArray;
-const GIMarshallingTests = imports.gi.GIMarshallingTests;
+const {GIMarshallingTests, Gio, GLib} = imports.gi;
 
 describe('Legacy byte array', function () {
     it('has length 0 for empty array', function () {
@@ -103,6 +103,39 @@ describe('Legacy byte array', function () {
         expect(s).toEqual('abcd');
     });
 
+    it('zeroes bytes again when shrunk and grown', function () {
+        let a = ByteArray.fromArray([1, 2, 3, 4]);
+        a.length = 2;
+        a[3] = 4;
+        expect(a.length).toEqual(4);
+        expect([a[0], a[1], a[2], a[3]]).toEqual([1, 2, 0, 4]);
+        expect(a[4]).toBeUndefined();
+    });
+
+    it('behaves like an array for reflection', function () {
+        let a = ByteArray.fromArray([97, 98]);
+        expect(a instanceof ByteArray.ByteArray).toBe(true);
+        expect(Object.keys(a)).toEqual(['0', '1']);
+        expect(1 in a).toBe(true);
+        expect(2 in a).toBe(false);
+        expect(Array.from(a)).toEqual([97, 98]);
+        a[2] = 99;
+        expect(a.toString()).toEqual('abc');
+    });
+
+    it('throws a TypeError when its buffer is detached', function (done) {
+        const array = new Uint8Array(4);
+        const a = new ByteArray.ByteArray(array);
+        const stream = Gio.MemoryInputStream.new_from_bytes(
+            new GLib.Bytes(Uint8Array.from([97, 98])));
+        stream.read_into_async(array).then(() => done(), done.fail);
+
+        expect(() => a[0]).toThrowError(TypeError);
+        expect(() => (a[0] = 1)).toThrowError(TypeError);
+        expect(() => (a.length = 8)).toThrowError(TypeError);
+        expect(() => a.toString()).toThrowError(TypeError);
+    });
+
     it('can be passed in with transfer none', function () {
         const refByteArray = ByteArray.fromArray([0, 49, 0xFF, 51]);
         expect(() => GIMarshallingTests.bytearray_none_in(refByteArray)).not.toThrow();
@@ -0,0 +1,103 @@
+describe('performance.now()', function () {
+    it('counts milliseconds from the time origin', function () {
+        const now = performance.now();
+        expect(now).toBeGreaterThan(0);
+        expect(performance.timeOrigin + now).toBeCloseTo(Date.now(), -3);
+    });
+
+    it('is monotonic and finer than milliseconds', function () {
+        let previous = performance.now();
+        let sawFraction = false;
+        for (let i = 0; i < 1000; i++) {
+            const now = performance.now();
+            expect(now).not.toBeLessThan(previous);
+            if (now % 1 !== 0)
+                sawFraction = true;
+            previous = now;
+        }
+        expect(sawFraction).toBe(true);
+    });
+});
+
+describe('performance.mark()', function () {
+    afterEach(function () {
+        performance.clearMarks();
+    });
+
+    it('records the current time', function () {
+        const before = performance.now();
+        const mark = performance.mark('a');
+        expect(mark.name).toEqual('a');
+        expect(mark.entryType).toEqual('mark');
+        expect(mark.duration).toEqual(0);
+        expect(mark.startTime).not.toBeLessThan(before);
+        expect(mark.startTime).not.toBeGreaterThan(performance.now());
+        expect(mark.detail).toBeNull();
+    });
+
+    it('takes a start time and a detail', function () {
+        const mark = performance.mark('a', {startTime: 5, detail: {x: 1}});
+        expect(mark.startTime).toEqual(5);
+        expect(mark.detail).toEqual({x: 1});
+    });
+
+    it('rejects a negative start time', function () {
+        expect(() => performance.mark('a', {startTime: -1})).toThrowError(TypeError);
+    });
+
+    it('keeps the marks until they are cleared', function () {
+        performance.mark('a', {startTime: 2});
+        performance.mark('b', {startTime: 1});
+        performance.mark('a', {startTime: 3});
+        expect(performance.getEntriesByType('mark').map(m => m.startTime))
+            .toEqual([1, 2, 3]);
+        expect(performance.getEntriesByName('a').length).toEqual(2);
+
+        performance.clearMarks('a');
+        expect(performance.getEntriesByName('a')).toEqual([]);
+        expect(performance.getEntriesByName('b').length).toEqual(1);
+        performance.clearMarks();
+        expect(performance.getEntries()).toEqual([]);
+    });
+});
+
+describe('performance.measure()', function () {
+    afterEach(function () {
+        performance.clearMarks();
+        performance.clearMeasures();
+    });
+
+    it('measures between two marks', function () {
+        performance.mark('start', {startTime: 10});
+        performance.mark('end', {startTime: 25});
+        const measure = performance.measure('m', 'start', 'end');
+        expect(measure.entryType).toEqual('measure');
+        expect(measure.startTime).toEqual(10);
+        expect(measure.duration).toEqual(15);
+        expect(performance.getEntriesByType('measure')).toEqual([measure]);
+    });
+
+    it('measures from a mark until now', function () {
+        const start = performance.mark('start');
+        const measure = performance.measure('m', 'start');
+        expect(measure.startTime).toEqual(start.startTime);
+        expect(measure.duration).not.toBeLessThan(0);
+    });
+
+    it('measures from the time origin by default', function () {
+        const measure = performance.measure('m');
+        expect(measure.startTime).toEqual(0);
+        expect(measure.duration).toBeGreaterThan(0);
+    });
+
+    it('takes options', function () {
+        const measure = performance.measure('m', {end: 20, duration: 5, detail: 'd'});
+        expect(measure.startTime).toEqual(15);
+        expect(measure.duration).toEqual(5);
+        expect(measure.detail).toEqual('d');
+    });
+
+    it('throws on an unknown mark', function () {
+        expect(() => performance.measure('m', 'nonexistent')).toThrowError(SyntaxError);
+    });
+});
@@ -208,6 +208,17 @@ describe('Life, the Universe and Everything', function () {
         });
     });
 
+    it('typed arrays as int arrays', function () {
+        expect(Regress.test_array_int_in(new Int32Array([1, 2, 3, 4])))
+            .toEqual(10);
+        expect(Regress.test_array_gint16_in(new Int8Array([-1, 2, 3, 4])))
+            .toEqual(8);
+        expect(Regress.test_array_gint8_in(new Float64Array([1.5, 2, 3, 4])))
+            .toEqual(10);
+        expect(Regress.test_array_gint64_in(new BigInt64Array([1n, 2n, 3n, 4n])))
+            .toEqual(10);
+    });
+
     it('implicit conversions from strings to int arrays', function () {
         expect(Regress.test_array_gint8_in('\x01\x02\x03\x04')).toEqual(10);
         expect(Regress.test_array_gint16_in('\x01\x02\x03\x04')).toEqual(10);
@@ -439,6 +450,15 @@ describe('Life, the Universe and Everything', function () {
             expect(struct.some_enum).toEqual(Regress.TestEnum.VALUE3);
         });
 
+        it('converts values assigned to fields', function () {
+            struct.some_int = '7';
+            struct.some_double = 1;
+            expect(struct.some_int).toEqual(7);
+            expect(struct.some_double).toEqual(1);
+            expect(() => (struct.some_int8 = 128)).toThrowError(/out of range/);
+            expect(struct.some_int8).toEqual(43);
+        });
+
         it('can clone', function () {
             const b = struct.clone();
             expect(b.some_int).toEqual(42);
@@ -628,6 +648,15 @@ describe('Life, the Universe and Everything', function () {
             expect(other.some_double).toEqual(7);
         });
 
+        it('copies the struct when it is returned without ownership', function () {
+            const first = Regress.TestSimpleBoxedA.const_return();
+            first.some_int = 42;
+            const second = Regress.TestSimpleBoxedA.const_return();
+            expect(second.some_int).toEqual(5);
+            expect(first.some_int).toEqual(42);
+            expect(second.copy().equals(second)).toBeTruthy();
+        });
+
         describe('constructors', function () {
             beforeEach(function () {
                 struct = new Regress.TestSimpleBoxedA({
@@ -1065,6 +1094,12 @@ describe('Life, the Universe and Everything', function () {
             expect(Regress.TestObj.static_method(5)).toEqual(5);
         });
 
+        it('describes a static method before it is first called', function () {
+            expect(Regress.TestObj.new_from_file.length).toEqual(1);
+            expect(Regress.TestObj.new_from_file.toString())
+                .toMatch(/regress_test_obj_new_from_file/);
+        });
+
         it('can call a method annotated with (method)', function () {
             expect(() => o.forced_method()).not.toThrow();
         });
@@ -1289,6 +1324,11 @@ describe('Life, the Universe and Everything', function () {
         expect(Regress.test_callback(callback)).toEqual(42);
     });
 
+    it('calls the right function when callbacks are passed repeatedly', function () {
+        for (let i = 0; i < 40; i++)
+            expect(Regress.test_callback(() => i)).toEqual(i);
+    });
+
     it('null / undefined callback', function () {
         expect(Regress.test_callback(null)).toEqual(0);
         expect(() => Regress.test_callback(undefined)).toThrow();
@@ -101,6 +101,62 @@ function testSignals(klass) {
         expect(foo.signalHandlerIsConnected(id)).toEqual(false);
     });
 
+    it('does not call handlers connected during emission', function () {
+        foo.connect('bar', () => foo.connect('bar', bar));
+        foo.emit('bar');
+        expect(bar).not.toHaveBeenCalled();
+        foo.emit('bar');
+        expect(bar).toHaveBeenCalledTimes(1);
+    });
+
+    it('stops emission when a handler returns true', function () {
+        foo.connect('bar', () => true);
+        foo.connect('bar', bar);
+        foo.emit('bar');
+        expect(bar).not.toHaveBeenCalled();
+    });
+
+    it('handles emission from within a handler', function () {
+        let depth = 0;
+        foo.connect('bar', () => {
+            if (depth++ === 0)
+                foo.emit('bar');
+        });
+        const id = foo.connect('bar', bar);
+        foo.connect('bar', () => foo.disconnect(id));
+        // the inner emission disconnects bar before the outer one reaches it
+        foo.emit('bar');
+        expect(bar).toHaveBeenCalledTimes(1);
+        expect(foo.signalHandlerIsConnected(id)).toBe(false);
+    });
+
+    it('keeps handlers in order with many connections', function () {
+        const ids = [];
+        const calls = [];
+        for (let i = 0; i < 200; i++)
+            ids.push(foo.connect('bar', () => calls.push(i)));
+        for (let i = 0; i < 200; i += 2)
+            foo.disconnect(ids[i]);
+        foo.connect('bar', () => calls.push('last'));
+        foo.emit('bar');
+        expect(calls.length).toEqual(101);
+        expect(calls[0]).toEqual(1);
+        expect(calls[99]).toEqual(199);
+        expect(calls[100]).toEqual('last');
+        expect(foo._signalConnections.length).toEqual(101);
+    });
+
+    it('throws when disconnecting an unknown handler', function () {
+        expect(() => foo.disconnect(42)).toThrowError(/No signal connection 42/);
+        const id = foo.connect('bar', bar);
+        foo.disconnect(id);
+        expect(() => foo.disconnect(id)).toThrow();
+    });
+
+    it('requires a callback that is a function', function () {
+        expect(() => foo.connect('bar', {})).toThrow();
+    });
+
     describe('with exception in signal handler', function () {
         let bar2;
         beforeEach(function () {
@@ -1,5 +1,6 @@
+const ByteArray = imports.byteArray;
 const System = imports.system;
-const GObject = imports.gi.GObject;
+const {Gio, GjsTestTools, GLib, GObject} = imports.gi;
 
 describe('System.addressOf()', function () {
     it('gives different results for different objects', function () {
@@ -43,8 +44,331 @@ describe('System.gc()', function () {
     });
 });
 
+describe('System.shrinkHeap()', function () {
+    it('does not crash the application', function () {
+        expect(System.shrinkHeap).not.toThrow();
+    });
+
+    it('does not grow the GC heap', function () {
+        System.shrinkHeap();
+        const before = System.memoryUsage().gcHeapBytes;
+        System.shrinkHeap();
+        expect(System.memoryUsage().gcHeapBytes).not.toBeGreaterThan(before);
+    });
+});
+
 describe('System.dumpHeap()', function () {
     it('throws but does not crash when given a nonexistent path', function () {
         expect(() => System.dumpHeap('/does/not/exist')).toThrow();
     });
+
+    it('throws on an unknown format', function () {
+        expect(() => System.dumpHeap(null, 'nonsense')).toThrow();
+    });
+
+    it('writes a binary snapshot', function () {
+        const [file, stream] = Gio.File.new_tmp('gjs-heap-XXXXXX');
+        stream.close(null);
+        System.dumpHeap(file.get_path(), 'snapshot');
+        const [, contents] = file.load_contents(null);
+        file.delete(null);
+        expect(contents.length).toBeGreaterThan(8);
+        expect(ByteArray.toString(contents.subarray(0, 7))).toEqual('GJSHEAP');
+        expect(contents[7]).toEqual(1);
+    });
+});
+
+describe('System.dumpDebugLog()', function () {
+    it('does nothing when not logging into a ring buffer', function () {
+        expect(() => System.dumpDebugLog()).not.toThrow();
+    });
+});
+
+describe('System.dumpFunctionStats()', function () {
+    it('throws but does not crash when given a nonexistent path', function () {
+        expect(() => System.dumpFunctionStats('/does/not/exist')).toThrow();
+    });
+});
+
+describe('System.dumpTypelibStats()', function () {
+    it('throws but does not crash when given a nonexistent path', function () {
+        expect(() => System.dumpTypelibStats('/does/not/exist')).toThrow();
+    });
+});
+
+describe('System.dumpWrapperStats()', function () {
+    it('throws but does not crash when given a nonexistent path', function () {
+        expect(() => System.dumpWrapperStats('/does/not/exist')).toThrow();
+    });
+
+    it('reports rooted wrappers by type', function () {
+        const WrapperStatsObject = GObject.registerClass({
+            GTypeName: 'CjsTestWrapperStatsObject',
+        }, class WrapperStatsObject extends GObject.Object {});
+        const store = new Gio.ListStore({itemType: WrapperStatsObject});
+        for (let i = 0; i < 3; i++) {
+            const obj = new WrapperStatsObject();
+            obj.connect('notify', () => {});
+            store.append(obj);
+        }
+
+        const [file, stream] = Gio.File.new_tmp('wrapper-stats-XXXXXX');
+        stream.close(null);
+        System.dumpWrapperStats(file.get_path());
+        const [, contents] = file.load_contents(null);
+        file.delete(null);
+
+        const report = ByteArray.toString(contents);
+        expect(report).toMatch(/^ +3 +3 +3 +0 +CjsTestWrapperStatsObject$/m);
+        expect(report).toMatch(/e\.g\. 0x[0-9a-f]+: 2 references, 1 held by C code/);
+    });
+});
+
+describe('System.memoryUsage()', function () {
+    it('counts wrappers and native memory', function () {
+        const usage = System.memoryUsage();
+        expect(usage.objects.function).toBeGreaterThan(0);
+        expect(usage.nativeBytes.arg_cache).toBeGreaterThan(0);
+        expect(usage.totalNativeBytes).not.toBeLessThan(
+            usage.nativeBytes.arg_cache);
+        expect(usage.gcHeapBytes).toBeGreaterThan(0);
+    });
+
+    it('counts closures', function () {
+        const before = System.memoryUsage().nativeBytes.closure;
+        const obj = new GObject.Object();
+        obj.connect('notify', () => {});
+        expect(System.memoryUsage().nativeBytes.closure).toBeGreaterThan(before);
+    });
+});
+
+describe('System.profiler', function () {
+    const GLib = imports.gi.GLib;
+    const file = GLib.build_filenamev([GLib.get_tmp_dir(),
+        `gjs-test-profiler-${GLib.random_int()}.syscap`]);
+    const enabled = GLib.getenv('ENABLE_PROFILER') === 'yes';
+
+    beforeEach(function () {
+        if (!enabled)
+            pending('profiler disabled');
+    });
+
+    afterEach(function () {
+        if (!enabled)
+            return;
+        System.profiler.stop();
+        GLib.unlink(file);
+    });
+
+    it('can be started and stopped', function () {
+        System.profiler.start({file, frequencyHz: 100, counters: false});
+        expect(System.profiler.isRunning()).toBe(true);
+        System.profiler.stop();
+        expect(System.profiler.isRunning()).toBe(false);
+    });
+
+    it('throws if it is already running', function () {
+        System.profiler.start({file});
+        expect(() => System.profiler.start({file})).toThrow();
+    });
+
+    it('throws on an invalid frequency', function () {
+        expect(() => System.profiler.start({file, frequencyHz: 0})).toThrow();
+        expect(System.profiler.isRunning()).toBe(false);
+    });
+});
+
+describe('System.setSourcePolicy()', function () {
+    const prefix = 'resource:///org/gjs/jsunit/modules/';
+    let oldSearchPath;
+
+    beforeAll(function () {
+        oldSearchPath = imports.searchPath.slice();
+        imports.searchPath = ['resource:///org/gjs/jsunit/modules'];
+    });
+
+    afterAll(function () {
+        System.setSourcePolicy(prefix, 'default');
+        imports.searchPath = oldSearchPath;
+    });
+
+    it('reads back the source of lazy modules when it is needed', function () {
+        System.setSourcePolicy(`${prefix}foobar.js`, 'lazy');
+        const {testToString} = imports.foobar;
+        expect(testToString('foo')).toEqual('foo');
+        expect(testToString.toString()).toContain('return toString(x);');
+    });
+
+    it('compiles eager modules', function () {
+        System.setSourcePolicy(`${prefix}mutualImport`, 'eager');
+        expect(imports.mutualImport.a.getCount()).toEqual(0);
+    });
+
+    it('throws on an unknown policy', function () {
+        expect(() => System.setSourcePolicy(prefix, 'sometimes')).toThrow();
+    });
+});
+
+describe('System.setQueueThreadCallbacks()', function () {
+    afterEach(function () {
+        System.setQueueThreadCallbacks(false);
+    });
+
+    it('runs callbacks from other threads on the main loop', function (done) {
+        System.setQueueThreadCallbacks(true);
+        let started = false;
+        const thread = GLib.Thread.new('gjs-test-callback', () => {
+            // Only runs once the main loop gets to it. A GThreadFunc returns a
+            // pointer, so the thread waits for it
+            expect(started).toBe(true);
+            done();
+        });
+        expect(thread).not.toBeNull();
+        started = true;
+    });
+
+    it('copies the arguments of callbacks that return nothing', function (done) {
+        System.setQueueThreadCallbacks(true);
+        const calls = [];
+        // The thread has called the callback and its destroy notify, and freed
+        // the strings, before this returns; the queued calls run afterwards,
+        // ahead of the queued destroy notify
+        GjsTestTools.call_in_thread(3, (value, message) => {
+            calls.push([value, message]);
+            if (calls.length < 3)
+                return;
+            expect(calls).toEqual([[1, 'call 1'], [2, 'call 2'], [3, 'call 3']]);
+            done();
+        });
+        expect(calls).toEqual([]);
+    });
+
+    it('queues the destroy notify behind the calls', function (done) {
+        System.setQueueThreadCallbacks(true);
+        // The destroy notify is called on the thread too; the trampoline must
+        // still be there when the queued calls run
+        let count = 0;
+        for (let i = 0; i < 10; i++)
+            GjsTestTools.call_in_thread(1, () => {
+                count++;
+            });
+        GLib.idle_add(GLib.PRIORITY_LOW, () => {
+            expect(count).toEqual(10);
+            System.gc();
+            done();
+            return GLib.SOURCE_REMOVE;
+        });
+    });
+});
+
+describe('System file helpers', function () {
+    let dir;
+    beforeAll(function () {
+        dir = GLib.dir_make_tmp('gjs-test-fs-XXXXXX');
+    });
+
+    afterAll(function () {
+        GLib.rmdir(dir);
+    });
+
+    it('writes a file and reads it back', function (done) {
+        const path = GLib.build_filenamev([dir, 'bytes']);
+        System.writeFile(path, Uint8Array.of(0, 1, 255))
+            .then(() => System.readFile(path))
+            .then(bytes => {
+                expect(bytes instanceof Uint8Array).toBe(true);
+                expect(Array.from(bytes)).toEqual([0, 1, 255]);
+                GLib.unlink(path);
+                done();
+            }, done.fail);
+    });
+
+    it('writes and reads text', function (done) {
+        const path = GLib.build_filenamev([dir, 'text']);
+        System.writeFile(path, 'pizza 🍕')
+            .then(() => System.readTextFile(path))
+            .then(text => {
+                expect(text).toEqual('pizza 🍕');
+                GLib.unlink(path);
+                done();
+            }, done.fail);
+    });
+
+    it('rejects when the file does not exist', function (done) {
+        System.readFile(GLib.build_filenamev([dir, 'missing'])).then(
+            () => done.fail('should have rejected'),
+            e => {
+                expect(e.message).toMatch(/missing/);
+                done();
+            });
+    });
+
+    it('throws on contents that are not a string or buffer', function () {
+        expect(() => System.writeFile(GLib.build_filenamev([dir, 'x']), 5))
+            .toThrow();
+    });
+});
+
+describe('System.spawn()', function () {
+    it('captures the output as bytes', function (done) {
+        System.spawn({argv: ['printf', 'a\\0b']}).then(result => {
+            expect(result.status).toEqual(0);
+            expect(result.signal).toBeNull();
+            expect(Array.from(result.stdout)).toEqual([97, 0, 98]);
+            expect(result.stderr.length).toEqual(0);
+            done();
+        }, done.fail);
+    });
+
+    it('feeds stdin and decodes text output', function (done) {
+        System.spawn({argv: ['cat'], stdin: 'pizza\nslice', text: true})
+            .then(result => {
+                expect(result.stdout).toEqual('pizza\nslice');
+                done();
+            }, done.fail);
+    });
+
+    it('calls onLine for each line of output', function (done) {
+        const lines = [];
+        System.spawn({
+            argv: ['printf', 'one\ntwo\nthree'],
+            onLine: line => lines.push(line),
+        }).then(() => {
+            expect(lines).toEqual(['one', 'two', 'three']);
+            done();
+        }, done.fail);
+    });
+
+    it('reports the exit status', function (done) {
+        System.spawn({argv: ['sh', '-c', 'echo oops >&2; exit 3'], text: true})
+            .then(result => {
+                expect(result.status).toEqual(3);
+                expect(result.stderr).toEqual('oops\n');
+                done();
+            }, done.fail);
+    });
+
+    it('survives a program that exits without reading its input',
+        function (done) {
+            System.spawn({argv: ['true'], stdin: new Uint8Array(1024 * 1024)})
+                .then(result => {
+                    expect(result.status).toEqual(0);
+                    done();
+                }, done.fail);
+        });
+
+    it('leaves SIGPIPE alone for programs spawned afterwards', function (done) {
+        System.spawn({argv: ['true'], stdin: 'input'})
+            .then(() => System.spawn({argv: ['sh', '-c', 'kill -PIPE $$']}))
+            .then(result => {
+                expect(result.status).toBeNull();
+                expect(result.signal).toEqual(13);  // SIGPIPE
+                done();
+            }, done.fail);
+    });
+
+    it('throws if the program cannot be started', function () {
+        expect(() => System.spawn({argv: ['/nonexistent/program']})).toThrow();
+        expect(() => System.spawn({argv: []})).toThrow();
+    });
 });
@@ -0,0 +1,121 @@
+describe('TextEncoder', function () {
+    let encoder;
+
+    beforeEach(function () {
+        encoder = new TextEncoder();
+    });
+
+    it('always encodes UTF-8', function () {
+        expect(encoder.encoding).toEqual('utf-8');
+    });
+
+    it('encodes ASCII and Latin-1 strings', function () {
+        expect(Array.from(encoder.encode('abc'))).toEqual([97, 98, 99]);
+        expect(Array.from(encoder.encode('äb'))).toEqual([0xc3, 0xa4, 98]);
+    });
+
+    it('encodes two-byte strings and surrogate pairs', function () {
+        expect(Array.from(encoder.encode('⅜'))).toEqual([0xe2, 0x85, 0x9c]);
+        expect(Array.from(encoder.encode('😀')))
+            .toEqual([0xf0, 0x9f, 0x98, 0x80]);
+    });
+
+    it('replaces lone surrogates', function () {
+        expect(Array.from(encoder.encode('\ud800a')))
+            .toEqual([0xef, 0xbf, 0xbd, 97]);
+    });
+
+    it('encodes an empty string', function () {
+        const array = encoder.encode();
+        expect(array instanceof Uint8Array).toBe(true);
+        expect(array.length).toEqual(0);
+    });
+
+    it('encodes into an existing array', function () {
+        const array = new Uint8Array(5);
+        expect(encoder.encodeInto('a⅜b', array))
+            .toEqual({read: 3, written: 5});
+        expect(Array.from(array)).toEqual([97, 0xe2, 0x85, 0x9c, 98]);
+    });
+
+    it('only encodes whole characters into an array that is too small', function () {
+        const array = new Uint8Array(4);
+        expect(encoder.encodeInto('ab😀', array))
+            .toEqual({read: 2, written: 2});
+        expect(encoder.encodeInto('a⅜b', array.subarray(1)))
+            .toEqual({read: 2, written: 3});
+    });
+});
+
+describe('TextDecoder', function () {
+    const bytes = a => new Uint8Array(a);
+
+    it('decodes UTF-8 by default', function () {
+        const decoder = new TextDecoder();
+        expect(decoder.encoding).toEqual('utf-8');
+        expect(decoder.decode(bytes([97, 0xe2, 0x85, 0x9c]))).toEqual('a⅜');
+    });
+
+    it('decodes ArrayBuffers and other views', function () {
+        const decoder = new TextDecoder();
+        const array = bytes([97, 98, 99, 100]);
+        expect(decoder.decode(array.buffer)).toEqual('abcd');
+        expect(decoder.decode(new DataView(array.buffer, 1, 2))).toEqual('bc');
+    });
+
+    it('replaces invalid sequences', function () {
+        const decoder = new TextDecoder();
+        expect(decoder.decode(bytes([97, 0xff, 0xe2, 0x85, 98])))
+            .toEqual('a��b');
+    });
+
+    it('throws on invalid sequences when fatal', function () {
+        const decoder = new TextDecoder('utf-8', {fatal: true});
+        expect(decoder.fatal).toBe(true);
+        expect(() => decoder.decode(bytes([0xff]))).toThrowError(TypeError);
+    });
+
+    it('strips a byte order mark unless told not to', function () {
+        const withBOM = bytes([0xef, 0xbb, 0xbf, 97]);
+        expect(new TextDecoder().decode(withBOM)).toEqual('a');
+        expect(new TextDecoder('utf-8', {ignoreBOM: true}).decode(withBOM))
+            .toEqual('﻿a');
+    });
+
+    it('decodes a stream split inside characters', function () {
+        const decoder = new TextDecoder();
+        let result = decoder.decode(bytes([0xef, 0xbb]), {stream: true});
+        result += decoder.decode(bytes([0xbf, 97, 0xf0, 0x9f]), {stream: true});
+        result += decoder.decode(bytes([0x98, 0x80]), {stream: true});
+        result += decoder.decode();
+        expect(result).toEqual('a😀');
+    });
+
+    it('reports an incomplete character at the end of a stream', function () {
+        const decoder = new TextDecoder();
+        expect(decoder.decode(bytes([97, 0xe2]), {stream: true})).toEqual('a');
+        expect(decoder.decode()).toEqual('�');
+    });
+
+    it('decodes UTF-16', function () {
+        expect(new TextDecoder('utf-16le').decode(bytes([0x3d, 0xd8, 0x00, 0xde])))
+            .toEqual('😀');
+        expect(new TextDecoder('utf-16be').decode(bytes([0, 97, 0x21, 0x5c])))
+            .toEqual('a⅜');
+
+        const decoder = new TextDecoder('utf-16');
+        expect(decoder.encoding).toEqual('utf-16le');
+        let result = decoder.decode(bytes([97, 0, 0x3d]), {stream: true});
+        result += decoder.decode(bytes([0xd8, 0x00, 0xde]));
+        expect(result).toEqual('a😀');
+    });
+
+    it('decodes other encodings with iconv', function () {
+        const decoder = new TextDecoder('iso-8859-15');
+        expect(decoder.decode(bytes([0xa4]))).toEqual('€');
+    });
+
+    it('rejects unknown encodings', function () {
+        expect(() => new TextDecoder('bogus-encoding')).toThrowError(RangeError);
+    });
+});
@@ -0,0 +1,148 @@
+const GLib = imports.gi.GLib;
+const System = imports.system;
+
+describe('setTimeout()', function () {
+    it('runs a function after a delay', function (done) {
+        const start = Date.now();
+        setTimeout(() => {
+            expect(Date.now() - start).not.toBeLessThan(10);
+            done();
+        }, 20);
+    });
+
+    it('passes extra arguments to the function', function (done) {
+        setTimeout((a, b) => {
+            expect([a, b]).toEqual(['a', 2]);
+            done();
+        }, 0, 'a', 2);
+    });
+
+    it('does not run a cleared function', function (done) {
+        const neverRun = jasmine.createSpy('neverRun');
+        const id = setTimeout(neverRun, 5);
+        clearTimeout(id);
+        setTimeout(() => {
+            expect(neverRun).not.toHaveBeenCalled();
+            done();
+        }, 20);
+    });
+
+    it('runs functions in order of their deadlines', function (done) {
+        const order = [];
+        setTimeout(() => order.push(3), 30);
+        setTimeout(() => order.push(1), 0);
+        setTimeout(() => order.push(2), 10);
+        setTimeout(() => {
+            expect(order).toEqual([1, 2, 3]);
+            done();
+        }, 50);
+    });
+
+    it('runs a function added by a timer on a later main loop iteration', function (done) {
+        let inner = false;
+        setTimeout(() => {
+            setTimeout(() => {
+                inner = true;
+            }, 0);
+            expect(inner).toBe(false);
+        }, 0);
+        setTimeout(() => {
+            expect(inner).toBe(true);
+            done();
+        }, 20);
+    });
+
+    it('can clear another timer that is due at the same time', function (done) {
+        const neverRun = jasmine.createSpy('neverRun');
+        let id;
+        setTimeout(() => clearTimeout(id), 0);
+        id = setTimeout(neverRun, 0);
+        setTimeout(() => {
+            expect(neverRun).not.toHaveBeenCalled();
+            done();
+        }, 20);
+    });
+
+    it('runs other timers in a nested main loop', function (done) {
+        setTimeout(() => {
+            const loop = new GLib.MainLoop(null, false);
+            let inner = false;
+            setTimeout(() => {
+                inner = true;
+                loop.quit();
+            }, 0);
+            loop.run();
+            expect(inner).toBe(true);
+            done();
+        }, 0);
+    });
+
+    it('runs in the thread-default main context', function () {
+        const context = new GLib.MainContext();
+        context.push_thread_default();
+        const ran = jasmine.createSpy('ran');
+        try {
+            setTimeout(ran, 0);
+        } finally {
+            context.pop_thread_default();
+        }
+        expect(ran).not.toHaveBeenCalled();
+        while (!ran.calls.any())
+            context.iteration(true);
+        expect(ran).toHaveBeenCalledTimes(1);
+    });
+
+    it('ignores unknown IDs', function () {
+        expect(() => clearTimeout(0)).not.toThrow();
+        expect(() => clearTimeout(undefined)).not.toThrow();
+        expect(() => clearTimeout(123456)).not.toThrow();
+    });
+
+    it('requires a function', function () {
+        expect(() => setTimeout('1 + 1', 0)).toThrowError(TypeError);
+    });
+
+    it('coalesces timers with slack', function (done) {
+        System.setTimerSlack(50);
+        const times = [];
+        setTimeout(() => times.push(Date.now()), 1);
+        setTimeout(() => times.push(Date.now()), 20);
+        setTimeout(() => {
+            System.setTimerSlack(0);
+            expect(times.length).toEqual(2);
+            expect(times[1] - times[0]).toBeLessThan(5);
+            done();
+        }, 120);
+    });
+});
+
+describe('setInterval()', function () {
+    it('runs a function repeatedly until cleared', function (done) {
+        let count = 0;
+        const id = setInterval(() => {
+            count++;
+            if (count === 3) {
+                clearInterval(id);
+                setTimeout(() => {
+                    expect(count).toEqual(3);
+                    done();
+                }, 30);
+            }
+        }, 5);
+    });
+
+    it('keeps running after an exception', function (done) {
+        let count = 0;
+        GLib.test_expect_message('Cjs', GLib.LogLevelFlags.LEVEL_CRITICAL,
+            'JS ERROR: Error: thrown on purpose*');
+        const id = setInterval(() => {
+            count++;
+            if (count === 1)
+                throw new Error('thrown on purpose');
+            clearInterval(id);
+            GLib.test_assert_expected_messages_internal('Cjs',
+                'testTimers.js', 0, 'keeps running after an exception');
+            done();
+        }, 5);
+    });
+});
@@ -1,3 +1,5 @@
+const {GObject} = imports.gi;
+const Equations = imports.tweener.equations;
 const Tweener = imports.tweener.tweener;
 
 function installFrameTicker() {
@@ -444,4 +446,67 @@ describe('Tweener', function () {
         expect(objectB.x).toEqual(0);
         expect(objectB.y).toEqual(0);
     });
+
+    it('tweens GObject properties', function () {
+        const Tweenable = GObject.registerClass({
+            Properties: {
+                'opacity': GObject.ParamSpec.double('opacity', 'Opacity',
+                    'Opacity', GObject.ParamFlags.READWRITE, 0, 255, 0),
+            },
+        }, class Tweenable extends GObject.Object {});
+        const object = new Tweenable();
+        const notify = jasmine.createSpy('notify');
+        object.connect('notify::opacity', notify);
+
+        Tweener.addTween(object, {opacity: 200, time: 1, transition: 'linear'});
+
+        jasmine.clock().tick(501);
+        expect(object.opacity).toBeCloseTo(100, 0);
+        jasmine.clock().tick(500);
+        expect(object.opacity).toEqual(200);
+        expect(notify).toHaveBeenCalled();
+    });
+
+    it('rounds values', function () {
+        const object = {x: 0};
+        Tweener.addTween(object, {x: 1, time: 1, rounded: true, transition: 'linear'});
+
+        jasmine.clock().tick(401);
+        expect(object.x).toEqual(0);
+        jasmine.clock().tick(200);
+        expect(object.x).toEqual(1);
+    });
+
+    it('still tweens with custom transitions', function () {
+        const object = {x: 0};
+        const transition = jasmine.createSpy('transition')
+            .and.callFake(Equations.linear);
+        Tweener.addTween(object, {x: 10, time: 1, transition});
+
+        jasmine.clock().tick(501);
+        expect(transition).toHaveBeenCalled();
+        expect(object.x).toEqual(5);
+    });
+});
+
+describe('Tweener native easing', function () {
+    const Native = imports._tweenerNative;
+
+    it('matches the JS equations', function () {
+        const params = [null, {overshoot: 2.5, amplitude: 20, period: 0.2}];
+        Native.EASINGS.forEach((name, ix) => {
+            params.forEach(p => {
+                for (let t = 0; t <= 1; t += 0.05) {
+                    expect(Native.ease(ix, t, 10, 15, 1, p))
+                        .toBeCloseTo(Equations[name](t, 10, 15, 1, p), 10);
+                }
+            });
+        });
+    });
+
+    it('covers all the JS equations', function () {
+        const names = Object.keys(Equations)
+            .filter(name => name.startsWith('ease'));
+        names.forEach(name => expect(Native.EASINGS).toContain(name));
+    });
 });
@@ -0,0 +1,148 @@
+const GLib = imports.gi.GLib;
+
+describe('Worker', function () {
+    let tmpDir;
+
+    function writeScript(name, source) {
+        const path = GLib.build_filenamev([tmpDir, name]);
+        GLib.file_set_contents(path, source);
+        return path;
+    }
+
+    beforeAll(function () {
+        tmpDir = GLib.dir_make_tmp('cjs-test-worker-XXXXXX');
+    });
+
+    afterAll(function () {
+        GLib.spawn_command_line_sync(`rm -rf ${tmpDir}`);
+    });
+
+    it('exchanges messages with its script', function (done) {
+        const worker = new Worker(writeScript('echo.js', `
+            onmessage = ({data}) => postMessage({echo: data});
+        `));
+        worker.onmessage = ({data}) => {
+            expect(data).toEqual({echo: {a: [1, 'two'], b: null}});
+            worker.terminate();
+            done();
+        };
+        worker.postMessage({a: [1, 'two'], b: null});
+    });
+
+    it('transfers ArrayBuffers listed in the transfer array', function (done) {
+        const worker = new Worker(writeScript('sum.js', `
+            onmessage = ({data}) => {
+                postMessage(new Uint8Array(data).reduce((a, b) => a + b));
+            };
+        `));
+        const buffer = new Uint8Array([1, 2, 3]).buffer;
+        worker.onmessage = ({data}) => {
+            expect(data).toEqual(6);
+            worker.terminate();
+            done();
+        };
+        worker.postMessage(buffer, [buffer]);
+        expect(buffer.byteLength).toEqual(0);
+    });
+
+    it('passes GLib.Bytes to the worker as a Uint8Array', function (done) {
+        const worker = new Worker(writeScript('bytes.js', `
+            onmessage = ({data}) => {
+                const received = [data instanceof Uint8Array, data.length,
+                    data[0]];
+                data[0] = 9;
+                postMessage(received);
+            };
+        `));
+        const bytes = new GLib.Bytes([1, 2, 3]);
+        worker.onmessage = ({data}) => {
+            expect(data).toEqual([true, 3, 1]);
+            expect(bytes.toArray()).toEqual(Uint8Array.from([1, 2, 3]));
+            worker.terminate();
+            done();
+        };
+        worker.postMessage(bytes);
+    });
+
+    it('can not receive a GLib.Variant in the worker', function (done) {
+        const worker = new Worker(writeScript('variant.js', `
+            onmessage = () => postMessage('received');
+        `));
+        worker.onmessage = fail;
+        worker.onerror = ({message}) => {
+            expect(message).toMatch(/GLib.Variant/);
+            worker.terminate();
+            done();
+        };
+        worker.postMessage(new GLib.Variant('s', 'hello'));
+    });
+
+    it('refuses to send other native objects', function () {
+        const worker = new Worker(writeScript('noop.js', ''));
+        expect(() => worker.postMessage(new GLib.MainLoop(null, false)))
+            .toThrowError(TypeError);
+        worker.terminate();
+    });
+
+    it('reports uncaught exceptions as error events', function (done) {
+        const worker = new Worker(writeScript('gi.js', `
+            imports.gi.GLib;
+        `));
+        worker.onerror = ({message}) => {
+            expect(message).toMatch(/not available in workers/);
+            done();
+        };
+    });
+
+    it('refuses native modules that use GI', function (done) {
+        const worker = new Worker(writeScript('native.js', `
+            const refused = [];
+            for (const name of ['_gi', 'cairoNative', '_byteArrayNative', 'system']) {
+                try {
+                    void imports[name];
+                } catch (e) {
+                    refused.push(name);
+                }
+            }
+            imports._print;
+            postMessage(refused);
+        `));
+        worker.onmessage = ({data}) => {
+            expect(data).toEqual(['_gi', 'cairoNative', '_byteArrayNative', 'system']);
+            worker.terminate();
+            done();
+        };
+    });
+
+    it('stops running its script when terminated', function (done) {
+        const worker = new Worker(writeScript('loop.js', `
+            postMessage('started');
+            for (;;);
+        `));
+        worker.onmessage = ({data}) => {
+            expect(data).toEqual('started');
+            worker.terminate();
+            // Nothing is delivered after terminate(), and the context's
+            // teardown doesn't hang on the worker's thread
+            worker.onmessage = fail;
+            setTimeout(done, 50);
+        };
+    });
+
+    it('ends by itself when its script calls close()', function (done) {
+        const worker = new Worker(writeScript('close.js', `
+            onmessage = () => {
+                postMessage('closing');
+                close();
+                postMessage('closed');
+            };
+        `));
+        const received = [];
+        worker.onmessage = ({data}) => received.push(data);
+        worker.postMessage(null);
+        setTimeout(() => {
+            expect(received).toEqual(['closing', 'closed']);
+            done();
+        }, 100);
+    });
+});
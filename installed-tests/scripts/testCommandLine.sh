@@ -8,6 +8,11 @@ fi
 
 # Avoid interference in the profiler tests from stray environment variable
 unset GJS_ENABLE_PROFILER
+unset GJS_STARTUP_PROFILE
+unset GJS_PROFILE_ALLOCATIONS
+unset GJS_PROFILE_FUNCTIONS
+unset GJS_TYPED_ARRAY_RETURN_VALUES
+unset GJS_ZYGOTE
 
 # Avoid interference in the warning tests from G_DEBUG=fatal-warnings/criticals
 OLD_G_DEBUG="$G_DEBUG"
@@ -194,6 +199,7 @@ if $gjs --profile -c 1 2>&1 | grep -q 'Cjs-Message.*Profiler is disabled'; then
     skip "--profile should dump profiling data to the default file name" "$reason"
     skip "--profile with argument should dump profiling data to the named file" "$reason"
     skip "GJS_ENABLE_PROFILER=1 should enable the profiler" "$reason"
+    skip "--profile-allocations should dump profiling data" "$reason"
 else
     rm -f gjs-*.syscap
     $gjs --profile -c 'imports.system.exit(0)' && stat gjs-*.syscap > /dev/null 2>&1
@@ -205,7 +211,45 @@ else
     GJS_ENABLE_PROFILER=1 $gjs -c 'imports.system.exit(0)' && stat gjs-*.syscap > /dev/null 2>&1
     report "GJS_ENABLE_PROFILER=1 should enable the profiler"
     rm -f gjs-*.syscap
+    $gjs --profile=foo.syscap --profile-allocations=10 -c '[{}, {}, {}].map(o => ({o}))' && test -f foo.syscap
+    report "--profile-allocations should dump profiling data"
+    rm -f foo.syscap
 fi
+! $gjs --profile-allocations=none -c 1 2>/dev/null
+report "--profile-allocations should reject an interval that isn't a number"
+
+# --startup-profile
+$gjs --startup-profile -c 'imports.system.exit(0)' 2>&1 | grep -q 'total before running the program'
+report "--startup-profile should print the startup breakdown"
+$gjs -c 'imports.system.exit(0)' 2>&1 | grep -q 'Startup profile'
+report_xfail "no startup breakdown should be printed without --startup-profile"
+
+# GJS_PROFILE_FUNCTIONS
+GJS_PROFILE_FUNCTIONS=1 $gjs -c 'const {GLib} = imports.gi; GLib.get_home_dir(); imports.system.dumpFunctionStats()' | grep -q 'get_home_dir'
+report "GJS_PROFILE_FUNCTIONS=1 should let dumpFunctionStats() print the functions called"
+GJS_PROFILE_FUNCTIONS=1 $gjs -c 'imports.system.dumpFunctionStats("/does/not/exist")' 2>&1 | grep -q 'Cannot dump function statistics'
+report "dumpFunctionStats() should throw when given a nonexistent path"
+
+# GJS_TYPED_ARRAY_RETURN_VALUES
+script='const {GLib} = imports.gi;
+    const file = new GLib.KeyFile();
+    const data = "[group]\nkey=1;2;3\n";
+    file.load_from_data(data, data.length, GLib.KeyFileFlags.NONE);
+    const list = file.get_integer_list("group", "key");
+    print(list instanceof Int32Array, Array.from(list))'
+test "$(GJS_TYPED_ARRAY_RETURN_VALUES=1 $gjs -c "$script")" = "true 1,2,3"
+report "GJS_TYPED_ARRAY_RETURN_VALUES=1 should return owned integer arrays as TypedArrays"
+test "$($gjs -c "$script")" = "false 1,2,3"
+report "owned integer arrays should be returned as Arrays without GJS_TYPED_ARRAY_RETURN_VALUES"
+
+# --fast-exit
+$gjs --fast-exit -c 'imports.system.exit(42)'
+test $? -eq 42
+report "--fast-exit should keep the exit code of System.exit()"
+$gjs --fast-exit -c 'print("flushed")' | grep -q flushed
+report "--fast-exit should flush the program's output"
+$gjs --fast-exit -c "Promise.reject(new Error());" 2>&1 | grep -q 'Unhandled promise rejection'
+report "--fast-exit should still warn about unhandled promise rejections"
 
 # interpreter handles queued promise jobs correctly
 output=$($gjs promise.js)
@@ -226,6 +270,24 @@ $gjs -c "(async () => await true)(); void foobar;" 2>&1 | grep -q 'ReferenceErro
 report "main program exceptions are not swallowed by queued promise jobs"
 G_DEBUG="$OLD_G_DEBUG"
 
+test "$($gjs -c 'for (let i = 0; i < 20000; i++) print(i); print("end")' | tail -n 1)" = end
+report "buffered print output should all be written"
+test "$($gjs -c 'print("a"); imports.system.exit(0)')" = a
+report "buffered print output should be written before System.exit()"
+test "$($gjs -c 'print("a"); printerr("b"); print("c")' 2>&1 | tr '\n' ' ')" = "a b c "
+report "print output should be flushed before printerr output"
+
+GJS_DEBUGGER_ATTACH_SIGNAL=1 $gjs -c 'const GLib = imports.gi.GLib;
+    const loop = new GLib.MainLoop(null, false);
+    GLib.timeout_add_seconds(GLib.PRIORITY_DEFAULT, 3, () => loop.quit());
+    loop.run();' </dev/null >attach.out &
+sleep 1
+kill -USR1 $!
+wait $!
+grep -q 'GJS debugger attached' attach.out
+report "debugger should attach to a running program on SIGUSR1"
+rm -f attach.out
+
 # https://gitlab.gnome.org/GNOME/gjs/issues/26
 $gjs -c 'new imports.gi.Gio.Subprocess({argv: ["true"]}).init(null);'
 report "object unref from other thread after shutdown should not race"
@@ -253,6 +315,39 @@ grep -q TN: coverage.lcov
 report "coverage prefix is treated as an absolute path"
 rm -f coverage.lcov
 
+# --zygote-serve
+zygote_socket="$(pwd)/zygote.sock"
+$gjs --zygote-serve="$zygote_socket" </dev/null &
+zygote_pid=$!
+for i in $(seq 50); do
+    test -S "$zygote_socket" && break
+    sleep 0.1
+done
+GJS_ZYGOTE="$zygote_socket" $gjs -c 'imports.system.exit(42)'
+test $? -eq 42
+report "zygote should pass back the exit code of the program"
+test "$(cd / && GJS_ZYGOTE="$zygote_socket" SENTINEL=zygote $gjs -c 'const {GLib} = imports.gi; print(GLib.getenv("SENTINEL"), GLib.get_current_dir(), ARGV)' arg)" = "zygote / arg"
+report "zygote should run the program with the client's environment, directory and arguments"
+if test -r /proc/self/stat; then
+    script='const ppid = pid => imports.byteArray.toString(imports.gi.GLib.file_get_contents(`/proc/${pid}/stat`)[1]).split(") ")[1].split(" ")[1];
+        print(ppid(ppid("self")))'
+    test "$(GJS_ZYGOTE="$zygote_socket" $gjs -c "$script")" = "$zygote_pid"
+    report "zygote should run the program in a process forked from the server"
+else
+    skip "zygote should run the program in a process forked from the server" "no /proc"
+fi
+if test -r /proc/self/stat; then
+    test "$(GJS_ZYGOTE="$zygote_socket" GI_TYPELIB_PATH="$(pwd)/nonexistent${GI_TYPELIB_PATH:+:$GI_TYPELIB_PATH}" $gjs -c "$script")" != "$zygote_pid"
+    report "zygote should not run programs that need a different GI_TYPELIB_PATH"
+else
+    skip "zygote should not run programs that need a different GI_TYPELIB_PATH" "no /proc"
+fi
+kill $zygote_pid
+wait $zygote_pid 2>/dev/null
+test "$(GJS_ZYGOTE="$zygote_socket" $gjs -c 'print("ran")')" = ran
+report "program should run as usual if the zygote server is not running"
+rm -f "$zygote_socket"
+
 rm -f exit.js help.js promise.js awaitcatch.js
 
 echo "1..$total"
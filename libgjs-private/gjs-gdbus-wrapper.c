@@ -28,9 +28,18 @@ struct _GjsDBusImplementationPrivate {
     GDBusInterfaceVTable  vtable;
     GDBusInterfaceInfo   *ifaceinfo;
 
-    // from gchar* to GVariant*
+    // from gchar* to GVariant*, or NULL for invalidated properties
     GHashTable           *outstanding_properties;
     guint                 idle_id;
+    unsigned              flush_delay;  // ms, 0 to flush when idle
+
+    // If set, called for method calls instead of emitting handle-method-call
+    GjsDBusMethodCallFunc method_call_func;
+    void*                 method_call_data;
+    GDestroyNotify        method_call_notify;
+    // Set while method_call_func runs, since it may unexport the object
+    GSList*               method_call_funcs_to_free;
+    unsigned              in_method_call : 1;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE(GjsDBusImplementation, gjs_dbus_implementation,
@@ -76,6 +85,42 @@ static gboolean gjs_dbus_implementation_check_property(
     return TRUE;
 }
 
+typedef struct {
+    void* data;
+    GDestroyNotify notify;
+} MethodCallFuncData;
+
+static void method_call_func_data_free(MethodCallFuncData* func_data) {
+    func_data->notify(func_data->data);
+    g_free(func_data);
+}
+
+static void free_pending_method_call_funcs(GjsDBusImplementation* self) {
+    g_slist_free_full(g_steal_pointer(&self->priv->method_call_funcs_to_free),
+                      (GDestroyNotify)method_call_func_data_free);
+}
+
+static void gjs_dbus_implementation_clear_method_call_func(
+    GjsDBusImplementation* self) {
+    GjsDBusImplementationPrivate* priv = self->priv;
+    MethodCallFuncData* func_data;
+
+    if (priv->method_call_notify) {
+        func_data = g_new(MethodCallFuncData, 1);
+        func_data->data = priv->method_call_data;
+        func_data->notify = priv->method_call_notify;
+        priv->method_call_funcs_to_free =
+            g_slist_prepend(priv->method_call_funcs_to_free, func_data);
+    }
+
+    priv->method_call_func = NULL;
+    priv->method_call_data = NULL;
+    priv->method_call_notify = NULL;
+
+    if (!priv->in_method_call)
+        free_pending_method_call_funcs(self);
+}
+
 static void gjs_dbus_implementation_method_call(
     GDBusConnection* connection, const char* sender G_GNUC_UNUSED,
     const char* object_path, const char* interface_name,
@@ -97,7 +142,17 @@ static void gjs_dbus_implementation_method_call(
         return;
     }
 
-    g_signal_emit(self, signals[SIGNAL_HANDLE_METHOD], 0, method_name, parameters, invocation);
+    if (self->priv->method_call_func) {
+        g_object_ref(self);
+        self->priv->in_method_call = TRUE;
+        self->priv->method_call_func(self, method_name, parameters, invocation,
+                                     self->priv->method_call_data);
+        self->priv->in_method_call = FALSE;
+        free_pending_method_call_funcs(self);
+        g_object_unref(self);
+    } else
+        g_signal_emit(self, signals[SIGNAL_HANDLE_METHOD], 0, method_name,
+                      parameters, invocation);
     g_object_unref (invocation);
 }
 
@@ -142,6 +197,11 @@ static gboolean gjs_dbus_implementation_property_set(
     return TRUE;
 }
 
+static void variant_unref_null(GVariant* variant) {
+    if (variant)
+        g_variant_unref(variant);
+}
+
 static void
 gjs_dbus_implementation_init(GjsDBusImplementation *self) {
     GjsDBusImplementationPrivate* priv =
@@ -153,13 +213,16 @@ gjs_dbus_implementation_init(GjsDBusImplementation *self) {
     priv->vtable.get_property = gjs_dbus_implementation_property_get;
     priv->vtable.set_property = gjs_dbus_implementation_property_set;
 
-    priv->outstanding_properties = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_variant_unref);
+    priv->outstanding_properties = g_hash_table_new_full(
+        g_str_hash, g_str_equal, g_free, (GDestroyNotify)variant_unref_null);
 }
 
+
 static void gjs_dbus_implementation_dispose(GObject* object) {
     GjsDBusImplementation* self = GJS_DBUS_IMPLEMENTATION(object);
 
     g_clear_handle_id(&self->priv->idle_id, g_source_remove);
+    gjs_dbus_implementation_clear_method_call_func(self);
 
     G_OBJECT_CLASS(gjs_dbus_implementation_parent_class)->dispose(object);
 }
@@ -343,6 +406,17 @@ idle_cb (gpointer data) {
     return G_SOURCE_REMOVE;
 }
 
+static void gjs_dbus_implementation_schedule_flush(GjsDBusImplementation* self) {
+    if (self->priv->idle_id)
+        return;
+
+    if (self->priv->flush_delay)
+        self->priv->idle_id =
+            g_timeout_add(self->priv->flush_delay, idle_cb, self);
+    else
+        self->priv->idle_id = g_idle_add(idle_cb, self);
+}
+
 /**
  * gjs_dbus_implementation_emit_property_changed:
  * @self: a #GjsDBusImplementation
@@ -357,10 +431,78 @@ gjs_dbus_implementation_emit_property_changed (GjsDBusImplementation *self,
                                                gchar                 *property,
                                                GVariant              *newvalue)
 {
-    g_hash_table_replace (self->priv->outstanding_properties, g_strdup (property), g_variant_ref (newvalue));
+    g_hash_table_replace(self->priv->outstanding_properties, g_strdup(property),
+                         newvalue ? g_variant_ref_sink(newvalue) : NULL);
 
-    if (!self->priv->idle_id)
-        self->priv->idle_id = g_idle_add(idle_cb, self);
+    gjs_dbus_implementation_schedule_flush(self);
+}
+
+/**
+ * gjs_dbus_implementation_emit_properties_changed:
+ * @self: a #GjsDBusImplementation
+ * @properties: an `a{sv}` dictionary of property names and their new values
+ *
+ * Like gjs_dbus_implementation_emit_property_changed(), but for several
+ * properties at once.
+ */
+void gjs_dbus_implementation_emit_properties_changed(GjsDBusImplementation* self,
+                                                     GVariant* properties) {
+    GVariantIter iter;
+    const char* property;
+    GVariant* value;
+
+    g_return_if_fail(
+        g_variant_is_of_type(properties, G_VARIANT_TYPE_VARDICT));
+
+    g_variant_ref_sink(properties);
+    g_variant_iter_init(&iter, properties);
+    while (g_variant_iter_next(&iter, "{&sv}", &property, &value))
+        g_hash_table_replace(self->priv->outstanding_properties,
+                             g_strdup(property), value);
+    g_variant_unref(properties);
+
+    gjs_dbus_implementation_schedule_flush(self);
+}
+
+/**
+ * gjs_dbus_implementation_set_flush_delay:
+ * @self: a #GjsDBusImplementation
+ * @delay_ms: how long to wait before emitting queued property changes, in
+ *   milliseconds
+ *
+ * By default, property changes queued with
+ * gjs_dbus_implementation_emit_property_changed() are emitted when the main
+ * loop is next idle. With a delay, changes to properties that update very
+ * often are merged into fewer PropertiesChanged signals. A delay of 0 restores
+ * the default.
+ */
+void gjs_dbus_implementation_set_flush_delay(GjsDBusImplementation* self,
+                                             unsigned delay_ms) {
+    self->priv->flush_delay = delay_ms;
+}
+
+/**
+ * gjs_dbus_implementation_set_method_call_func:
+ * @self: a #GjsDBusImplementation
+ * @func: (scope notified) (closure user_data) (destroy notify) (nullable):
+ *   function to dispatch method calls to, or %NULL
+ * @user_data: data for @func
+ * @notify: destroy notifier for @user_data
+ *
+ * Makes incoming method calls go directly to @func, instead of through the
+ * #GjsDBusImplementation::handle-method-call signal. The function is released
+ * when @self is unexported from its last connection, after which method calls
+ * are emitted as signals again.
+ */
+void gjs_dbus_implementation_set_method_call_func(GjsDBusImplementation* self,
+                                                  GjsDBusMethodCallFunc func,
+                                                  void* user_data,
+                                                  GDestroyNotify notify) {
+    gjs_dbus_implementation_clear_method_call_func(self);
+
+    self->priv->method_call_func = func;
+    self->priv->method_call_data = user_data;
+    self->priv->method_call_notify = notify;
 }
 
 /**
@@ -416,6 +558,7 @@ gjs_dbus_implementation_unexport(GjsDBusImplementation *self) {
 
     g_hash_table_remove_all(self->priv->outstanding_properties);
     g_clear_handle_id(&self->priv->idle_id, g_source_remove);
+    gjs_dbus_implementation_clear_method_call_func(self);
 
     g_dbus_interface_skeleton_unexport(skeleton);
 }
@@ -439,6 +582,7 @@ gjs_dbus_implementation_unexport_from_connection(GjsDBusImplementation *self,
     if (g_list_length(connections) <= 1) {
         g_hash_table_remove_all(self->priv->outstanding_properties);
         g_clear_handle_id(&self->priv->idle_id, g_source_remove);
+        gjs_dbus_implementation_clear_method_call_func(self);
     }
 
     g_list_free_full(connections, g_object_unref);
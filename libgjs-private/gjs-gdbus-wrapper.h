@@ -52,12 +52,37 @@ struct _GjsDBusImplementationClass {
 };
 typedef struct _GjsDBusImplementationClass GjsDBusImplementationClass;
 
+/**
+ * GjsDBusMethodCallFunc:
+ * @self: the #GjsDBusImplementation that received the call
+ * @method_name: the name of the method, which is known to exist
+ * @parameters: the parameters of the call
+ * @invocation: the invocation to return a value or an error on
+ * @user_data: data passed to gjs_dbus_implementation_set_method_call_func()
+ */
+typedef void (*GjsDBusMethodCallFunc)(GjsDBusImplementation* self,
+                                      const char* method_name,
+                                      GVariant* parameters,
+                                      GDBusMethodInvocation* invocation,
+                                      void* user_data);
+
 GJS_EXPORT
 GType                  gjs_dbus_implementation_get_type (void);
 
 GJS_EXPORT
 void                   gjs_dbus_implementation_emit_property_changed (GjsDBusImplementation *self, gchar *property, GVariant *newvalue);
 GJS_EXPORT
+void gjs_dbus_implementation_emit_properties_changed(GjsDBusImplementation* self,
+                                                     GVariant* properties);
+GJS_EXPORT
+void gjs_dbus_implementation_set_flush_delay(GjsDBusImplementation* self,
+                                             unsigned delay_ms);
+GJS_EXPORT
+void gjs_dbus_implementation_set_method_call_func(GjsDBusImplementation* self,
+                                                  GjsDBusMethodCallFunc func,
+                                                  void* user_data,
+                                                  GDestroyNotify notify);
+GJS_EXPORT
 void                   gjs_dbus_implementation_emit_signal           (GjsDBusImplementation *self, gchar *signal_name, GVariant *parameters);
 
 G_END_DECLS
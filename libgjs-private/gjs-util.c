@@ -76,6 +76,15 @@ gjs_locale_category_get_type(void)
   return g_define_type_id__volatile;
 }
 
+/* Bumped whenever a call here could change the result of a gettext lookup */
+static int gettext_generation = 0;
+
+unsigned
+gjs_gettext_generation(void)
+{
+    return (unsigned) g_atomic_int_get(&gettext_generation);
+}
+
 /**
  * gjs_setlocale:
  * @category:
@@ -86,6 +95,10 @@ gjs_locale_category_get_type(void)
 const char *
 gjs_setlocale(GjsLocaleCategory category, const char *locale)
 {
+    /* Passing NULL only queries the current locale */
+    if (locale)
+        g_atomic_int_inc(&gettext_generation);
+
     /* According to man setlocale(3), the return value may be allocated in
      * static storage. */
     return (const char *) setlocale(category, locale);
@@ -95,6 +108,7 @@ void
 gjs_textdomain(const char *domain)
 {
     textdomain(domain);
+    g_atomic_int_inc(&gettext_generation);
 }
 
 void
@@ -104,6 +118,7 @@ gjs_bindtextdomain(const char *domain,
     bindtextdomain(domain, location);
     /* Always use UTF-8; we assume it internally here */
     bind_textdomain_codeset(domain, "UTF-8");
+    g_atomic_int_inc(&gettext_generation);
 }
 
 GParamFlags
@@ -224,88 +239,226 @@ static GIBaseInfo* find_method_fallback(GIStructInfo* class_info,
     return NULL;
 }
 
-static GParamSpec* gjs_gtk_container_class_find_child_property(
-    GIObjectInfo* container_info, GObject* container, const char* property) {
-    GIBaseInfo* class_info = NULL;
-    GIBaseInfo* find_child_property_fun = NULL;
-
-    GIArgument ret;
-    GIArgument find_child_property_args[2];
+/* Resolves the C function behind a method of a Gtk class (or, if
+ * @class_method is TRUE, of its class struct) from the Gtk typelib that was
+ * loaded, so that the overrides below can call it directly instead of going
+ * through g_function_info_invoke() every time. Whichever of Gtk 3 or 4 was
+ * loaded is used, and this library doesn't need to link to either. */
+static void* find_gtk_method_symbol(const char* object_name,
+                                    const char* method_name,
+                                    gboolean class_method) {
+    GIBaseInfo* object_info;
+    GIBaseInfo* method_info = NULL;
+    void* symbol = NULL;
+
+    object_info = g_irepository_find_by_name(NULL, "Gtk", object_name);
+    if (object_info == NULL)
+        return NULL;
+
+    if (class_method) {
+        GIStructInfo* class_info =
+            g_object_info_get_class_struct((GIObjectInfo*)object_info);
+        if (class_info != NULL) {
+            method_info = g_struct_info_find_method(class_info, method_name);
+
+            /* Workaround for
+               https://gitlab.gnome.org/GNOME/gobject-introspection/merge_requests/171
+             */
+            if (method_info == NULL)
+                method_info = find_method_fallback(class_info, method_name);
+            g_base_info_unref(class_info);
+        }
+    } else {
+        method_info =
+            g_object_info_find_method((GIObjectInfo*)object_info, method_name);
+    }
 
-    class_info = g_object_info_get_class_struct(container_info);
-    find_child_property_fun =
-        g_struct_info_find_method(class_info, "find_child_property");
+    if (method_info != NULL &&
+        !g_typelib_symbol(g_base_info_get_typelib(method_info),
+                          g_function_info_get_symbol(method_info), &symbol))
+        symbol = NULL;
 
-    /* Workaround for
-       https://gitlab.gnome.org/GNOME/gobject-introspection/merge_requests/171
-     */
-    if (find_child_property_fun == NULL)
-        find_child_property_fun =
-            find_method_fallback(class_info, "find_child_property");
+    g_clear_pointer(&method_info, g_base_info_unref);
+    g_base_info_unref(object_info);
+    return symbol;
+}
 
-    find_child_property_args[0].v_pointer = G_OBJECT_GET_CLASS(container);
-    find_child_property_args[1].v_string = (char*)property;
+typedef struct {
+    GParamSpec* (*find_child_property)(GObjectClass* klass, const char* name);
+    void (*child_set_property)(GObject* container, GObject* child,
+                               const char* name, const GValue* value);
+    void (*freeze_child_notify)(GObject* child);
+    void (*thaw_child_notify)(GObject* child);
+} ChildPropertyFuncs;
+
+static const ChildPropertyFuncs* lookup_child_property_funcs(void) {
+    static ChildPropertyFuncs funcs;
+    static gboolean found = FALSE;
+
+    if (found)
+        return &funcs;
+
+    funcs.find_child_property =
+        find_gtk_method_symbol("Container", "find_child_property", TRUE);
+    funcs.child_set_property =
+        find_gtk_method_symbol("Container", "child_set_property", FALSE);
+    funcs.freeze_child_notify =
+        find_gtk_method_symbol("Widget", "freeze_child_notify", FALSE);
+    funcs.thaw_child_notify =
+        find_gtk_method_symbol("Widget", "thaw_child_notify", FALSE);
+
+    found = funcs.find_child_property && funcs.child_set_property &&
+            funcs.freeze_child_notify && funcs.thaw_child_notify;
+    return found ? &funcs : NULL;
+}
 
-    g_function_info_invoke(find_child_property_fun, find_child_property_args, 2,
-                           NULL, 0, &ret, NULL);
+/* Container GType -> (property name -> GParamSpec). Child properties are
+ * installed in class_init and never removed, so entries don't go stale. */
+static GHashTable* child_property_cache = NULL;
+
+static GParamSpec* find_child_property_cached(const ChildPropertyFuncs* funcs,
+                                              GObject* container,
+                                              const char* name) {
+    GType type = G_OBJECT_TYPE(container);
+    GHashTable* properties;
+    GParamSpec* pspec;
+
+    if (child_property_cache == NULL)
+        child_property_cache = g_hash_table_new_full(
+            NULL, NULL, NULL, (GDestroyNotify)g_hash_table_unref);
+
+    properties = g_hash_table_lookup(child_property_cache, GSIZE_TO_POINTER(type));
+    if (properties == NULL) {
+        properties = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        g_hash_table_insert(child_property_cache, GSIZE_TO_POINTER(type),
+                            properties);
+    }
 
-    g_clear_pointer(&class_info, g_base_info_unref);
-    g_clear_pointer(&find_child_property_fun, g_base_info_unref);
+    pspec = g_hash_table_lookup(properties, name);
+    if (pspec == NULL) {
+        pspec = funcs->find_child_property(G_OBJECT_GET_CLASS(container), name);
+        if (pspec != NULL)
+            g_hash_table_insert(properties, g_strdup(name), pspec);
+    }
 
-    return (GParamSpec*)ret.v_pointer;
+    return pspec;
 }
 
 void gjs_gtk_container_child_set_property(GObject* container, GObject* child,
                                           const char* property,
                                           const GValue* value) {
-    GParamSpec* pspec = NULL;
-    GIBaseInfo* base_info = NULL;
-    GIBaseInfo* child_set_property_fun = NULL;
-    GIObjectInfo* container_info;
-    GValue value_arg = G_VALUE_INIT;
-    GIArgument ret;
+    const char* names[] = {property, NULL};
 
-    GIArgument child_set_property_args[4];
-
-    base_info = g_irepository_find_by_name(NULL, "Gtk", "Container");
-    container_info = (GIObjectInfo*)base_info;
+    gjs_gtk_container_child_set_properties(container, child, names, value, 1);
+}
 
-    pspec = gjs_gtk_container_class_find_child_property(container_info,
-                                                        container, property);
-    if (pspec == NULL) {
-        g_warning("%s does not have a property called %s",
-                  g_type_name(G_OBJECT_TYPE(container)), property);
-        goto out;
+/**
+ * gjs_gtk_container_child_set_properties:
+ * @container: a GtkContainer
+ * @child: a widget which is a child of @container
+ * @names: (array zero-terminated=1) (element-type utf8): names of the child
+ *   properties to set
+ * @values: (array length=n_values): values to set, in the order of @names
+ * @n_values: number of elements of @values
+ *
+ * Sets several child properties of @child at once, with a single
+ * child-notify emission for all of them at the end.
+ */
+void gjs_gtk_container_child_set_properties(GObject* container, GObject* child,
+                                            const char** names,
+                                            const GValue* values,
+                                            int n_values) {
+    const ChildPropertyFuncs* funcs;
+    int ix;
+
+    g_return_if_fail(G_IS_OBJECT(container));
+    g_return_if_fail(G_IS_OBJECT(child));
+    g_return_if_fail(names != NULL);
+    g_return_if_fail(n_values == 0 || values != NULL);
+
+    funcs = lookup_child_property_funcs();
+    if (funcs == NULL) {
+        g_critical("%s: Gtk.Container child property functions not found",
+                   __func__);
+        return;
     }
 
-    if ((G_VALUE_TYPE(value) == G_TYPE_POINTER) &&
-        (g_value_get_pointer(value) == NULL) &&
-        !g_value_type_transformable(G_VALUE_TYPE(value), pspec->value_type)) {
-        /* Set an empty value. This will happen when we set a NULL value from
-         * JS. Since GJS doesn't know the GParamSpec for this property, it will
-         * just put NULL into a G_TYPE_POINTER GValue, which will later fail
-         * when trying to transform it to the GParamSpec's GType.
-         */
-        g_value_init(&value_arg, pspec->value_type);
-    } else {
-        g_value_init(&value_arg, G_VALUE_TYPE(value));
-        g_value_copy(value, &value_arg);
+    funcs->freeze_child_notify(child);
+
+    for (ix = 0; ix < n_values && names[ix] != NULL; ix++) {
+        const GValue* value = &values[ix];
+        GValue value_arg = G_VALUE_INIT;
+        GParamSpec* pspec =
+            find_child_property_cached(funcs, container, names[ix]);
+
+        if (pspec == NULL) {
+            g_warning("%s does not have a property called %s",
+                      g_type_name(G_OBJECT_TYPE(container)), names[ix]);
+            continue;
+        }
+
+        if ((G_VALUE_TYPE(value) == G_TYPE_POINTER) &&
+            (g_value_get_pointer(value) == NULL) &&
+            !g_value_type_transformable(G_VALUE_TYPE(value),
+                                        pspec->value_type)) {
+            /* Set an empty value. This will happen when we set a NULL value
+             * from JS. Since GJS doesn't know the GParamSpec for this
+             * property, it will just put NULL into a G_TYPE_POINTER GValue,
+             * which will later fail when trying to transform it to the
+             * GParamSpec's GType.
+             */
+            g_value_init(&value_arg, pspec->value_type);
+        } else {
+            g_value_init(&value_arg, G_VALUE_TYPE(value));
+            g_value_copy(value, &value_arg);
+        }
+
+        funcs->child_set_property(container, child, names[ix], &value_arg);
+
+        g_value_unset(&value_arg);
     }
 
-    child_set_property_fun =
-        g_object_info_find_method(container_info, "child_set_property");
+    funcs->thaw_child_notify(child);
+}
 
-    child_set_property_args[0].v_pointer = container;
-    child_set_property_args[1].v_pointer = child;
-    child_set_property_args[2].v_string = (char*)property;
-    child_set_property_args[3].v_pointer = &value_arg;
+typedef GObject* (*GetTemplateChildFunc)(GObject* widget, GType widget_type,
+                                        const char* name);
 
-    g_function_info_invoke(child_set_property_fun, child_set_property_args, 4,
-                           NULL, 0, &ret, NULL);
+/**
+ * gjs_gtk_widget_get_template_children:
+ * @widget: a GtkWidget that has been initialized from its template
+ * @widget_type: the type whose template the children belong to
+ * @names: (array zero-terminated=1) (element-type utf8): IDs of the children
+ *
+ * Looks up all of @names with gtk_widget_get_template_child() in one call,
+ * so that the Gtk override doesn't have to make one introspected call for
+ * each template child of each new widget.
+ *
+ * Returns: (element-type GObject) (transfer container): the children in the
+ *   order of @names, with %NULL for any that weren't found
+ */
+GPtrArray* gjs_gtk_widget_get_template_children(GObject* widget,
+                                                GType widget_type,
+                                                const char** names) {
+    static GetTemplateChildFunc get_template_child = NULL;
+    GPtrArray* children;
+    size_t ix;
+
+    g_return_val_if_fail(G_IS_OBJECT(widget), NULL);
+    g_return_val_if_fail(names != NULL, NULL);
+
+    if (get_template_child == NULL)
+        get_template_child = (GetTemplateChildFunc)find_gtk_method_symbol(
+            "Widget", "get_template_child", FALSE);
+    if (get_template_child == NULL) {
+        g_critical("%s: Gtk.Widget.get_template_child() not found", __func__);
+        return NULL;
+    }
 
-    g_value_unset(&value_arg);
+    children = g_ptr_array_new();
+    for (ix = 0; names[ix] != NULL; ix++)
+        g_ptr_array_add(children,
+                        get_template_child(widget, widget_type, names[ix]));
 
-out:
-    g_clear_pointer(&base_info, g_base_info_unref);
-    g_clear_pointer(&child_set_property_fun, g_base_info_unref);
+    return children;
 }
@@ -59,6 +59,12 @@ void        gjs_bindtextdomain           (const char *domain,
 GJS_EXPORT
 GType       gjs_locale_category_get_type (void) G_GNUC_CONST;
 
+#ifndef __GI_SCANNER__
+/* For the translation cache in cjs/gettext.cpp; changes whenever one of the
+ * functions above is called in a way that could change translations */
+unsigned    gjs_gettext_generation       (void);
+#endif
+
 /* For imports.overrides.GObject */
 GJS_EXPORT
 GParamFlags gjs_param_spec_get_flags (GParamSpec *pspec);
@@ -72,6 +78,15 @@ GJS_EXPORT
 void gjs_gtk_container_child_set_property(GObject* container, GObject* child,
                                           const char* property,
                                           const GValue* value);
+GJS_EXPORT
+void gjs_gtk_container_child_set_properties(GObject* container, GObject* child,
+                                            const char** names,
+                                            const GValue* values,
+                                            int n_values);
+GJS_EXPORT
+GPtrArray* gjs_gtk_widget_get_template_children(GObject* widget,
+                                                GType widget_type,
+                                                const char** names);
 
 /* For tests */
 GJS_EXPORT
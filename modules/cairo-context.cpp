@@ -22,6 +22,12 @@
 
 #include <config.h>
 
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <tuple>
+#include <type_traits>  // for enable_if_t, is_enum_v, is_same_v
+#include <utility>  // for index_sequence
 #include <vector>
 
 #include <cairo-gobject.h>
@@ -50,6 +56,92 @@
 #include "cjs/macros.h"
 #include "modules/cairo-private.h"
 
+/* Typed argument extraction for the _GJS_CAIRO_CONTEXT_DEFINE_FUNC* macros */
+
+GJS_JSAPI_RETURN_CONVENTION GJS_ALWAYS_INLINE static inline bool context_arg(
+    JSContext* cx, JS::HandleValue value, double* out) {
+    if (value.isNumber()) {
+        *out = value.toNumber();
+        return true;
+    }
+    return JS::ToNumber(cx, value, out);
+}
+
+template <typename T,
+          typename std::enable_if_t<std::is_enum_v<T> || std::is_same_v<T, int>,
+                                    int> = 0>
+GJS_JSAPI_RETURN_CONVENTION GJS_ALWAYS_INLINE static inline bool context_arg(
+    JSContext* cx, JS::HandleValue value, T* out) {
+    static_assert(sizeof(T) == sizeof(int32_t),
+                  "Enum types must be the same width as int");
+    int32_t i;
+    if (value.isInt32())
+        i = value.toInt32();
+    else if (!JS::ToInt32(cx, value, &i))
+        return false;
+    *out = static_cast<T>(i);
+    return true;
+}
+
+template <typename T>
+[[nodiscard]] static constexpr const char* context_arg_type_name() {
+    return std::is_same_v<T, double> ? "double" : "integer";
+}
+
+template <typename... Args, size_t... Ix>
+GJS_JSAPI_RETURN_CONVENTION static bool parse_context_args_helper(
+    JSContext* cx, const char* method, const JS::CallArgs& args,
+    const char* const* names, std::tuple<Args...>* out,
+    std::index_sequence<Ix...>) {
+    unsigned failed_ix = 0;
+    const char* failed_type = nullptr;
+    bool ok = ((context_arg(cx, args[Ix], &std::get<Ix>(*out)) ||
+                (failed_ix = Ix,
+                 failed_type = context_arg_type_name<Args>(), false)) &&
+               ...);
+    if (ok)
+        return true;
+
+    // Same message as gjs_parse_call_args() would give
+    JS_ClearPendingException(cx);
+    gjs_throw(cx,
+              "Error invoking %s, at argument %u (%s): Couldn't convert to %s",
+              method, failed_ix, names[failed_ix], failed_type);
+    return false;
+}
+
+template <typename... Args>
+GJS_JSAPI_RETURN_CONVENTION static bool parse_context_args(
+    JSContext* cx, const char* method, const JS::CallArgs& args,
+    const char* const (&names)[sizeof...(Args)], std::tuple<Args...>* out) {
+    constexpr unsigned n_args = sizeof...(Args);
+    if (!args.requireAtLeast(cx, method, n_args))
+        return false;
+    if (args.length() > n_args) {
+        gjs_throw(cx, "Error invoking %s: Expected %u arguments, got %u",
+                  method, n_args, args.length());
+        return false;
+    }
+    return parse_context_args_helper(cx, method, args, names, out,
+                                     std::index_sequence_for<Args...>{});
+}
+
+template <typename F>
+struct ContextFunc;
+
+template <typename R, typename... CArgs>
+struct ContextFunc<R (*)(cairo_t*, CArgs...)> {
+    using Args = std::tuple<CArgs...>;
+    static constexpr size_t n_args = sizeof...(CArgs);
+
+    GJS_ALWAYS_INLINE
+    static inline R call(R (*cfunc)(cairo_t*, CArgs...), cairo_t* cr,
+                         const Args& args) {
+        return std::apply(
+            [cfunc, cr](CArgs... cargs) { return cfunc(cr, cargs...); }, args);
+    }
+};
+
 #define _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(mname)              \
     GJS_JSAPI_RETURN_CONVENTION                                  \
     static bool mname##_func(JSContext* context, unsigned argc,  \
@@ -90,27 +182,28 @@ _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                               \
     argv.rval().setBoolean(ret);                                           \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_END
 
-#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC2FFAFF(method, cfunc, n1, n2)         \
-    _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                            \
-    double arg1, arg2;                                                      \
-    if (!gjs_parse_call_args(context, #method, argv, "ff", #n1, &arg1, #n2, \
-                             &arg2))                                        \
-        return false;                                                       \
-    cfunc(cr, &arg1, &arg2);                                                \
-    if (cairo_status(cr) == CAIRO_STATUS_SUCCESS) {                         \
-        JS::RootedObject array(                                             \
-            context,                                                        \
-            JS::NewArrayObject(context, JS::HandleValueArray::empty()));    \
-        if (!array)                                                         \
-            return false;                                                   \
-        JS::RootedValue r(context, JS::NumberValue(arg1));                  \
-        if (!JS_SetElement(context, array, 0, r))                           \
-            return false;                                                   \
-        r.setNumber(arg2);                                                  \
-        if (!JS_SetElement(context, array, 1, r))                           \
-            return false;                                                   \
-        argv.rval().setObject(*array);                                      \
-    }                                                                       \
+#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC2FFAFF(method, cfunc, n1, n2)        \
+    _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                           \
+    static const char* const names[] = {#n1, #n2};                         \
+    std::tuple<double, double> cargs;                                      \
+    if (!parse_context_args(context, #method, argv, names, &cargs))        \
+        return false;                                                      \
+    auto [arg1, arg2] = cargs;                                             \
+    cfunc(cr, &arg1, &arg2);                                               \
+    if (cairo_status(cr) == CAIRO_STATUS_SUCCESS) {                        \
+        JS::RootedObject array(                                            \
+            context,                                                       \
+            JS::NewArrayObject(context, JS::HandleValueArray::empty()));   \
+        if (!array)                                                        \
+            return false;                                                  \
+        JS::RootedValue r(context, JS::NumberValue(arg1));                 \
+        if (!JS_SetElement(context, array, 0, r))                          \
+            return false;                                                  \
+        r.setNumber(arg2);                                                 \
+        if (!JS_SetElement(context, array, 1, r))                          \
+            return false;                                                  \
+        argv.rval().setObject(*array);                                     \
+    }                                                                      \
     _GJS_CAIRO_CONTEXT_DEFINE_FUNC_END
 
 #define _GJS_CAIRO_CONTEXT_DEFINE_FUNC0AFF(method, cfunc)                \
@@ -169,92 +262,64 @@ _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                               \
     argv.rval().setNumber(ret);                                            \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_END
 
-#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC1(method, cfunc, fmt, t1, n1)        \
+/* The methods below take their arguments according to the C signature of the
+ * cairo function that they wrap, which is known at compile time, so they
+ * don't go through gjs_parse_call_args() and its format string. Values that
+ * are already numbers of the right kind skip the conversion. */
+#define _GJS_CAIRO_CONTEXT_CALL(method, cfunc, ...)                      \
+    using Func = ContextFunc<decltype(&cfunc)>;                          \
+    static const char* const names[] = {__VA_ARGS__};                    \
+    static_assert(G_N_ELEMENTS(names) == Func::n_args,                   \
+                  "Wrong number of argument names for " #method "()");   \
+    Func::Args cargs;                                                    \
+    if (!parse_context_args(context, #method, argv, names, &cargs))      \
+        return false;
+
+#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC1(method, cfunc, n1)                 \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                               \
-    t1 arg1;                                                               \
-    if (!gjs_parse_call_args(context, #method, argv, fmt,                  \
-                             #n1, &arg1))                                  \
-        return false;                                                      \
-    cfunc(cr, arg1);                                                       \
+    _GJS_CAIRO_CONTEXT_CALL(method, cfunc, #n1)                            \
+    Func::call(cfunc, cr, cargs);                                          \
     argv.rval().setUndefined();                                            \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_END
 
-#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC2(method, cfunc, fmt, t1, n1, t2, n2) \
+#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC2(method, cfunc, n1, n2)             \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                               \
-    t1 arg1;                                                               \
-    t2 arg2;                                                               \
-    if (!gjs_parse_call_args(context, #method, argv, fmt,                  \
-                             #n1, &arg1, #n2, &arg2))                      \
-        return false;                                                      \
-    cfunc(cr, arg1, arg2);                                                 \
+    _GJS_CAIRO_CONTEXT_CALL(method, cfunc, #n1, #n2)                       \
+    Func::call(cfunc, cr, cargs);                                          \
     argv.rval().setUndefined();                                            \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_END
 
-#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC2B(method, cfunc, fmt, t1, n1, t2, n2) \
+#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC2B(method, cfunc, n1, n2)            \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                               \
-    t1 arg1;                                                               \
-    t2 arg2;                                                               \
-    cairo_bool_t ret;                                                      \
-    if (!gjs_parse_call_args(context, #method, argv, fmt,                  \
-                             #n1, &arg1, #n2, &arg2))                      \
-        return false;                                                      \
-    ret = cfunc(cr, arg1, arg2);                                           \
-    argv.rval().setBoolean(ret);                                           \
+    _GJS_CAIRO_CONTEXT_CALL(method, cfunc, #n1, #n2)                       \
+    argv.rval().setBoolean(Func::call(cfunc, cr, cargs));                  \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_END
 
-#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC3(method, cfunc, fmt, t1, n1, t2, n2, t3, n3) \
+#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC3(method, cfunc, n1, n2, n3)         \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                               \
-    t1 arg1;                                                               \
-    t2 arg2;                                                               \
-    t3 arg3;                                                               \
-    if (!gjs_parse_call_args(context, #method, argv, fmt,                  \
-                             #n1, &arg1, #n2, &arg2, #n3, &arg3))          \
-        return false;                                                      \
-    cfunc(cr, arg1, arg2, arg3);                                           \
+    _GJS_CAIRO_CONTEXT_CALL(method, cfunc, #n1, #n2, #n3)                  \
+    Func::call(cfunc, cr, cargs);                                          \
     argv.rval().setUndefined();                                            \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_END
 
-#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC4(method, cfunc, fmt, t1, n1, t2, n2, t3, n3, t4, n4) \
+#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC4(method, cfunc, n1, n2, n3, n4)     \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                               \
-    t1 arg1;                                                               \
-    t2 arg2;                                                               \
-    t3 arg3;                                                               \
-    t4 arg4;                                                               \
-    if (!gjs_parse_call_args(context, #method, argv, fmt,                  \
-                             #n1, &arg1, #n2, &arg2,                       \
-                             #n3, &arg3, #n4, &arg4))                      \
-        return false;                                                      \
-    cfunc(cr, arg1, arg2, arg3, arg4);                                     \
+    _GJS_CAIRO_CONTEXT_CALL(method, cfunc, #n1, #n2, #n3, #n4)             \
+    Func::call(cfunc, cr, cargs);                                          \
+    argv.rval().setUndefined();                                            \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_END
 
-#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC5(method, cfunc, fmt, t1, n1, t2, n2, t3, n3, t4, n4, t5, n5) \
+#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC5(method, cfunc, n1, n2, n3, n4, n5) \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                               \
-    t1 arg1;                                                               \
-    t2 arg2;                                                               \
-    t3 arg3;                                                               \
-    t4 arg4;                                                               \
-    t5 arg5;                                                               \
-    if (!gjs_parse_call_args(context, #method, argv, fmt,                  \
-                             #n1, &arg1, #n2, &arg2, #n3, &arg3,           \
-                             #n4, &arg4, #n5, &arg5))                      \
-        return false;                                                      \
-    cfunc(cr, arg1, arg2, arg3, arg4, arg5);                               \
+    _GJS_CAIRO_CONTEXT_CALL(method, cfunc, #n1, #n2, #n3, #n4, #n5)        \
+    Func::call(cfunc, cr, cargs);                                          \
     argv.rval().setUndefined();                                            \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_END
 
-#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC6(method, cfunc, fmt, t1, n1, t2, n2, t3, n3, t4, n4, t5, n5, t6, n6) \
+#define _GJS_CAIRO_CONTEXT_DEFINE_FUNC6(method, cfunc, n1, n2, n3, n4, n5, n6) \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_BEGIN(method)                               \
-    t1 arg1;                                                               \
-    t2 arg2;                                                               \
-    t3 arg3;                                                               \
-    t4 arg4;                                                               \
-    t5 arg5;                                                               \
-    t6 arg6;                                                               \
-    if (!gjs_parse_call_args(context, #method, argv, fmt,                  \
-                             #n1, &arg1, #n2, &arg2, #n3, &arg3,           \
-                             #n4, &arg4, #n5, &arg5, #n6, &arg6))          \
-        return false;                                                      \
-    cfunc(cr, arg1, arg2, arg3, arg4, arg5, arg6);                         \
+    _GJS_CAIRO_CONTEXT_CALL(method, cfunc, #n1, #n2, #n3, #n4, #n5, #n6)   \
+    Func::call(cfunc, cr, cargs);                                          \
     argv.rval().setUndefined();                                            \
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC_END
 
@@ -315,22 +380,18 @@ JSPropertySpec gjs_cairo_context_proto_props[] = {
 
 /* Methods */
 
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC5(arc, cairo_arc, "fffff",
-                                double, xc, double, yc, double, radius,
-                                double, angle1, double, angle2)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC5(arcNegative, cairo_arc_negative, "fffff",
-                                double, xc, double, yc, double, radius,
-                                double, angle1, double, angle2)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC6(curveTo, cairo_curve_to, "ffffff",
-                                double, x1, double, y1, double, x2, double, y2,
-                                double, x3, double, y3)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC5(arc, cairo_arc, xc, yc, radius, angle1, angle2)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC5(arcNegative, cairo_arc_negative, xc, yc,
+                                radius, angle1, angle2)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC6(curveTo, cairo_curve_to, x1, y1, x2, y2, x3, y3)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(clip, cairo_clip)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(clipPreserve, cairo_clip_preserve)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0AFFFF(clipExtents, cairo_clip_extents)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(closePath, cairo_close_path)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(copyPage, cairo_copy_page)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2FFAFF(deviceToUser, cairo_device_to_user, "x", "y")
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2FFAFF(deviceToUserDistance, cairo_device_to_user_distance, "x", "y")
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2FFAFF(deviceToUser, cairo_device_to_user, x, y)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2FFAFF(deviceToUserDistance,
+                                     cairo_device_to_user_distance, x, y)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(fill, cairo_fill)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(fillPreserve, cairo_fill_preserve)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0AFFFF(fillExtents, cairo_fill_extents)
@@ -346,51 +407,49 @@ _GJS_CAIRO_CONTEXT_DEFINE_FUNC0I(getOperator, cairo_get_operator)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0F(getTolerance, cairo_get_tolerance)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0B(hasCurrentPoint, cairo_has_current_point)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(identityMatrix, cairo_identity_matrix)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2B(inFill, cairo_in_fill, "ff", double, x, double, y)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2B(inStroke, cairo_in_stroke, "ff", double, x, double, y)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(lineTo, cairo_line_to, "ff", double, x, double, y)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(moveTo, cairo_move_to, "ff", double, x, double, y)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2B(inFill, cairo_in_fill, x, y)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2B(inStroke, cairo_in_stroke, x, y)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(lineTo, cairo_line_to, x, y)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(moveTo, cairo_move_to, x, y)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(newPath, cairo_new_path)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(newSubPath, cairo_new_sub_path)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(paint, cairo_paint)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(paintWithAlpha, cairo_paint_with_alpha, "f", double, alpha)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(paintWithAlpha, cairo_paint_with_alpha, alpha)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0AFFFF(pathExtents, cairo_path_extents)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(pushGroup, cairo_push_group)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(pushGroupWithContent, cairo_push_group_with_content, "i",
-                                cairo_content_t, content)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(pushGroupWithContent,
+                                cairo_push_group_with_content, content)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(popGroupToSource, cairo_pop_group_to_source)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC4(rectangle, cairo_rectangle, "ffff",
-                                double, x, double, y, double, width, double, height)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC6(relCurveTo, cairo_rel_curve_to, "ffffff",
-                                double, dx1, double, dy1, double, dx2, double, dy2,
-                                double, dx3, double, dy3)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(relLineTo, cairo_rel_line_to, "ff", double, dx, double, dy)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(relMoveTo, cairo_rel_move_to, "ff", double, dx, double, dy)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC4(rectangle, cairo_rectangle, x, y, width, height)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC6(relCurveTo, cairo_rel_curve_to, dx1, dy1, dx2,
+                                dy2, dx3, dy3)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(relLineTo, cairo_rel_line_to, dx, dy)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(relMoveTo, cairo_rel_move_to, dx, dy)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(resetClip, cairo_reset_clip)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(restore, cairo_restore)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(rotate, cairo_rotate, "f", double, angle)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(rotate, cairo_rotate, angle)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(save, cairo_save)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(scale, cairo_scale, "ff", double, sx, double, sy)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setAntialias, cairo_set_antialias, "i", cairo_antialias_t, antialias)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setFillRule, cairo_set_fill_rule, "i", cairo_fill_rule_t, fill_rule)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setFontSize, cairo_set_font_size, "f", double, size)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setLineCap, cairo_set_line_cap, "i", cairo_line_cap_t, line_cap)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setLineJoin, cairo_set_line_join, "i", cairo_line_join_t, line_join)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setLineWidth, cairo_set_line_width, "f", double, width)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setMiterLimit, cairo_set_miter_limit, "f", double, limit)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setOperator, cairo_set_operator, "i", cairo_operator_t, op)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setTolerance, cairo_set_tolerance, "f", double, tolerance)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC3(setSourceRGB, cairo_set_source_rgb, "fff",
-                                double, red, double, green, double, blue)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC4(setSourceRGBA, cairo_set_source_rgba, "ffff",
-                                double, red, double, green, double, blue, double, alpha)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(scale, cairo_scale, sx, sy)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setAntialias, cairo_set_antialias, antialias)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setFillRule, cairo_set_fill_rule, fill_rule)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setFontSize, cairo_set_font_size, size)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setLineCap, cairo_set_line_cap, line_cap)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setLineJoin, cairo_set_line_join, line_join)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setLineWidth, cairo_set_line_width, width)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setMiterLimit, cairo_set_miter_limit, limit)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setOperator, cairo_set_operator, op)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC1(setTolerance, cairo_set_tolerance, tolerance)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC3(setSourceRGB, cairo_set_source_rgb, red, green, blue)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC4(setSourceRGBA, cairo_set_source_rgba, red,
+                                green, blue, alpha)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(showPage, cairo_show_page)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(stroke, cairo_stroke)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0(strokePreserve, cairo_stroke_preserve)
 _GJS_CAIRO_CONTEXT_DEFINE_FUNC0AFFFF(strokeExtents, cairo_stroke_extents)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(translate, cairo_translate, "ff", double, tx, double, ty)
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2FFAFF(userToDevice, cairo_user_to_device, "x", "y")
-_GJS_CAIRO_CONTEXT_DEFINE_FUNC2FFAFF(userToDeviceDistance, cairo_user_to_device_distance, "x", "y")
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2(translate, cairo_translate, tx, ty)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2FFAFF(userToDevice, cairo_user_to_device, x, y)
+_GJS_CAIRO_CONTEXT_DEFINE_FUNC2FFAFF(userToDeviceDistance,
+                                     cairo_user_to_device_distance, x, y)
 
 GJS_JSAPI_RETURN_CONVENTION
 static bool
@@ -434,6 +493,32 @@ appendPath_func(JSContext *context,
     return true;
 }
 
+// appendPathData(ops, coords): see gjs_cairo_path_data_from_arrays()
+GJS_JSAPI_RETURN_CONVENTION
+static bool appendPathData_func(JSContext* context, unsigned argc,
+                                JS::Value* vp) {
+    GJS_GET_PRIV(context, argc, vp, argv, obj, cairo_t, cr);
+    if (!cr)
+        return true;
+
+    JS::RootedObject ops(context), coords(context);
+    if (!gjs_parse_call_args(context, "appendPathData", argv, "oo", "ops",
+                             &ops, "coords", &coords))
+        return false;
+
+    std::vector<cairo_path_data_t> data;
+    if (!gjs_cairo_path_data_from_arrays(context, ops, coords, &data))
+        return false;
+
+    cairo_path_t path = {CAIRO_STATUS_SUCCESS, data.data(), int(data.size())};
+    cairo_append_path(cr, &path);
+    if (!gjs_cairo_check_status(context, cairo_status(cr), "context"))
+        return false;
+
+    argv.rval().setUndefined();
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool
 copyPath_func(JSContext *context,
@@ -856,6 +941,7 @@ getGroupTarget_func(JSContext *context,
 JSFunctionSpec gjs_cairo_context_proto_funcs[] = {
     JS_FN("$dispose", dispose_func, 0, 0),
     JS_FN("appendPath", appendPath_func, 0, 0),
+    JS_FN("appendPathData", appendPathData_func, 2, 0),
     JS_FN("arc", arc_func, 0, 0),
     JS_FN("arcNegative", arcNegative_func, 0, 0),
     JS_FN("clip", clip_func, 0, 0),
@@ -22,16 +22,23 @@
 
 #include <config.h>
 
+#include <stddef.h>  // for size_t
+
+#include <algorithm>  // for min
+
 #include <cairo.h>
 #include <glib.h>
 
+#include <js/ArrayBuffer.h>
 #include <js/CallArgs.h>
 #include <js/Class.h>
 #include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
+#include <js/Utility.h>  // for js_free
 #include <jsapi.h>  // for JS_NewObjectWithGivenProto
+#include <jsfriendapi.h>  // for JS_NewUint8ClampedArrayWithBuffer, ...
 
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util-args.h"
@@ -227,9 +234,128 @@ getStride_func(JSContext *context,
     return true;
 }
 
+static void surface_unref_arraybuffer(void*, void* user_data) {
+    cairo_surface_destroy(static_cast<cairo_surface_t*>(user_data));
+}
+
+/* The returned array is a view on the surface's own pixels, and keeps the
+ * surface alive. Cairo may still be drawing into them, so call flush() before
+ * reading and markDirty() after writing, as with cairo_image_surface_get_data()
+ * in C. For convenience getData() flushes the surface itself. */
+GJS_JSAPI_RETURN_CONVENTION
+static bool getData_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_THIS(cx, argc, vp, rec, obj);
+
+    if (!gjs_parse_call_args(cx, "getData", rec, ""))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(cx, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_flush(surface);
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    if (!gjs_cairo_check_status(cx, cairo_surface_status(surface), "surface"))
+        return false;
+    if (!data) {
+        gjs_throw(cx, "Surface has no pixel data; it may have been finished");
+        return false;
+    }
+
+    size_t len = size_t(cairo_image_surface_get_stride(surface)) *
+                 cairo_image_surface_get_height(surface);
+    JS::RootedObject buffer(
+        cx, JS::NewExternalArrayBuffer(cx, len, data, surface_unref_arraybuffer,
+                                       cairo_surface_reference(surface)));
+    if (!buffer)
+        return false;
+
+    JSObject* array = JS_NewUint8ClampedArrayWithBuffer(cx, buffer, 0, -1);
+    if (!array)
+        return false;
+
+    rec.rval().setObject(*array);
+    return true;
+}
+
+static const cairo_user_data_key_t pixel_data_key = {};
+
+/* createForData(buffer, format, width, height, stride)
+ * The pixels are used in place: the memory of the ArrayBuffer (or the buffer
+ * of a typed array) is handed over to the surface without copying, and the
+ * buffer is detached. Use getData() to get at the pixels afterwards. */
+GJS_JSAPI_RETURN_CONVENTION
+static bool createForData_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject buffer(cx);
+    int format, width, height, stride;
+
+    if (!gjs_parse_call_args(cx, "createForData", argv, "oiiii", "buffer",
+                             &buffer, "format", &format, "width", &width,
+                             "height", &height, "stride", &stride))
+        return false;
+
+    size_t offset = 0;
+    if (JS_IsArrayBufferViewObject(buffer)) {
+        bool is_shared_memory;
+        offset = JS_GetArrayBufferViewByteOffset(buffer);
+        buffer = JS_GetArrayBufferViewBuffer(cx, buffer, &is_shared_memory);
+        if (!buffer)
+            return false;
+    }
+    if (!JS::IsArrayBufferObject(buffer)) {
+        gjs_throw(cx, "Argument buffer to createForData() must be an "
+                  "ArrayBuffer or a typed array");
+        return false;
+    }
+
+    int min_stride =
+        cairo_format_stride_for_width(cairo_format_t(format), width);
+    if (min_stride < 0 || height < 0 || stride < min_stride) {
+        gjs_throw_custom(cx, JSProto_RangeError, nullptr,
+                         "Invalid stride %d for format %d and width %d",
+                         stride, format, width);
+        return false;
+    }
+    size_t len = JS::GetArrayBufferByteLength(buffer);
+    if (offset > len || size_t(stride) * height > len - offset) {
+        gjs_throw_custom(cx, JSProto_RangeError, nullptr,
+                         "Buffer of %zu bytes is too small for %d rows of "
+                         "stride %d",
+                         len - std::min(offset, len), height, stride);
+        return false;
+    }
+
+    void* contents = JS::StealArrayBufferContents(cx, buffer);
+    if (!contents)
+        return false;
+
+    cairo_surface_t* surface = cairo_image_surface_create_for_data(
+        static_cast<unsigned char*>(contents) + offset, cairo_format_t(format),
+        width, height, stride);
+    if (cairo_surface_set_user_data(surface, &pixel_data_key, contents,
+                                    js_free) != CAIRO_STATUS_SUCCESS)
+        js_free(contents);
+
+    if (!gjs_cairo_check_status(cx, cairo_surface_status(surface),
+                                "surface")) {
+        cairo_surface_destroy(surface);
+        return false;
+    }
+
+    JSObject* surface_wrapper =
+        gjs_cairo_image_surface_from_surface(cx, surface);
+    cairo_surface_destroy(surface);
+    if (!surface_wrapper)
+        return false;
+
+    argv.rval().setObject(*surface_wrapper);
+    return true;
+}
+
 JSFunctionSpec gjs_cairo_image_surface_proto_funcs[] = {
     JS_FN("createFromPNG", createFromPNG_func, 0, 0),
-    // getData
+    JS_FN("getData", getData_func, 0, 0),
     JS_FN("getFormat", getFormat_func, 0, 0),
     JS_FN("getWidth", getWidth_func, 0, 0),
     JS_FN("getHeight", getHeight_func, 0, 0),
@@ -238,6 +364,7 @@ JSFunctionSpec gjs_cairo_image_surface_proto_funcs[] = {
 
 JSFunctionSpec gjs_cairo_image_surface_static_funcs[] = {
     JS_FN("createFromPNG", createFromPNG_func, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("createForData", createForData_func, 5, GJS_MODULE_PROP_FLAGS),
     JS_FS_END};
 
 JSObject *
@@ -22,18 +22,32 @@
 
 #include <config.h>
 
+#include <stdint.h>
+#include <stdlib.h>  // for malloc
+
+#include <algorithm>  // for copy
+#include <vector>
+
 #include <cairo.h>
 #include <glib.h>
 
+#include <js/Array.h>  // for JS::NewArrayObject
+#include <js/CallArgs.h>
 #include <js/Class.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
+#include <js/ValueArray.h>
 #include <jsapi.h>  // for JS_GetClass, JS_GetInstancePrivate
+#include <jsfriendapi.h>  // for JS_NewUint8Array, GetFloat64ArrayLengt...
 
 #include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "modules/cairo-private.h"
 
 [[nodiscard]] static JSObject* gjs_cairo_path_get_proto(JSContext*);
 
@@ -53,11 +67,201 @@ JSPropertySpec gjs_cairo_path_proto_props[] = {
     JS_PS_END};
 // clang-format on
 
+/* Path data as typed arrays: a Uint8Array of Cairo.PathDataType operations,
+ * and a Float64Array with the x and y coordinates of the points of each
+ * operation in order; one point for MOVE_TO and LINE_TO, three for CURVE_TO,
+ * and none for CLOSE_PATH. */
+
+[[nodiscard]] static int path_data_n_points(uint8_t op) {
+    switch (op) {
+        case CAIRO_PATH_MOVE_TO:
+        case CAIRO_PATH_LINE_TO:
+            return 1;
+        case CAIRO_PATH_CURVE_TO:
+            return 3;
+        case CAIRO_PATH_CLOSE_PATH:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * gjs_cairo_path_data_from_arrays:
+ * @cx: the context
+ * @ops: Uint8Array of path operations
+ * @coords: Float64Array of the coordinates of the operations' points
+ * @data: return location for the path data
+ *
+ * Converts path data in typed arrays to the cairo_path_data_t array of a
+ * cairo_path_t, in one pass over the arrays.
+ */
+bool gjs_cairo_path_data_from_arrays(JSContext* cx, JS::HandleObject ops,
+                                     JS::HandleObject coords,
+                                     std::vector<cairo_path_data_t>* data) {
+    if (!JS_IsUint8Array(ops) || !JS_IsFloat64Array(coords)) {
+        gjs_throw(cx, "Path data must be a Uint8Array of operations and a "
+                  "Float64Array of coordinates");
+        return false;
+    }
+
+    uint32_t n_ops, n_coords;
+    size_t bad_op = SIZE_MAX;
+    bool coords_mismatch = false;
+    {
+        JS::AutoCheckCannotGC nogc;
+        bool is_shared_memory;
+        uint8_t* op_data;
+        double* coord_data;
+        js::GetUint8ArrayLengthAndData(ops, &n_ops, &is_shared_memory,
+                                       &op_data);
+        js::GetFloat64ArrayLengthAndData(coords, &n_coords, &is_shared_memory,
+                                         &coord_data);
+
+        size_t n_points = 0;
+        for (size_t ix = 0; ix < n_ops; ix++) {
+            int n = path_data_n_points(op_data[ix]);
+            if (n < 0) {
+                bad_op = ix;
+                break;
+            }
+            n_points += n;
+        }
+        coords_mismatch = bad_op == SIZE_MAX && n_points * 2 != n_coords;
+
+        if (bad_op == SIZE_MAX && !coords_mismatch) {
+            data->clear();
+            data->reserve(n_ops + n_points);
+            const double* coord = coord_data;
+            for (size_t ix = 0; ix < n_ops; ix++) {
+                int n = path_data_n_points(op_data[ix]);
+                cairo_path_data_t header;
+                header.header.type = cairo_path_data_type_t(op_data[ix]);
+                header.header.length = 1 + n;
+                data->push_back(header);
+                for (int point = 0; point < n; point++, coord += 2) {
+                    cairo_path_data_t p;
+                    p.point.x = coord[0];
+                    p.point.y = coord[1];
+                    data->push_back(p);
+                }
+            }
+        }
+    }
+
+    if (bad_op != SIZE_MAX) {
+        gjs_throw_custom(cx, JSProto_RangeError, nullptr,
+                         "Invalid path operation at index %zu", bad_op);
+        return false;
+    }
+    if (coords_mismatch) {
+        gjs_throw_custom(cx, JSProto_RangeError, nullptr,
+                         "Path operations need a different number of "
+                         "coordinates than the %u given",
+                         n_coords);
+        return false;
+    }
+    return true;
+}
+
+// toData() -> [Uint8Array ops, Float64Array coords]
+GJS_JSAPI_RETURN_CONVENTION
+static bool toData_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_THIS(cx, argc, vp, argv, obj);
+
+    if (!gjs_parse_call_args(cx, "toData", argv, ""))
+        return false;
+
+    cairo_path_t* path = gjs_cairo_path_get_path(cx, obj);
+    if (!path)
+        return false;
+
+    size_t n_ops = 0, n_coords = 0;
+    for (int ix = 0; ix < path->num_data; ix += path->data[ix].header.length) {
+        n_ops++;
+        n_coords += 2 * (path->data[ix].header.length - 1);
+    }
+
+    JS::RootedObject ops(cx, JS_NewUint8Array(cx, n_ops));
+    JS::RootedObject coords(cx, JS_NewFloat64Array(cx, n_coords));
+    if (!ops || !coords)
+        return false;
+
+    {
+        JS::AutoCheckCannotGC nogc;
+        bool is_shared_memory;
+        uint32_t len;
+        uint8_t* op_data;
+        double* coord_data;
+        js::GetUint8ArrayLengthAndData(ops, &len, &is_shared_memory, &op_data);
+        js::GetFloat64ArrayLengthAndData(coords, &len, &is_shared_memory,
+                                         &coord_data);
+        for (int ix = 0; ix < path->num_data;
+             ix += path->data[ix].header.length) {
+            const cairo_path_data_t* item = &path->data[ix];
+            *op_data++ = item->header.type;
+            for (int point = 1; point < item->header.length; point++) {
+                *coord_data++ = item[point].point.x;
+                *coord_data++ = item[point].point.y;
+            }
+        }
+    }
+
+    JS::RootedValueArray<2> elements(cx);
+    elements[0].setObject(*ops);
+    elements[1].setObject(*coords);
+    JSObject* retval = JS::NewArrayObject(cx, elements);
+    if (!retval)
+        return false;
+
+    argv.rval().setObject(*retval);
+    return true;
+}
+
+// Path.fromData(ops, coords) -> Cairo.Path
+GJS_JSAPI_RETURN_CONVENTION
+static bool fromData_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject ops(cx), coords(cx);
+
+    if (!gjs_parse_call_args(cx, "fromData", argv, "oo", "ops", &ops,
+                             "coords", &coords))
+        return false;
+
+    std::vector<cairo_path_data_t> data;
+    if (!gjs_cairo_path_data_from_arrays(cx, ops, coords, &data))
+        return false;
+
+    // Allocated like cairo's own paths, to be freed by cairo_path_destroy()
+    auto* path = static_cast<cairo_path_t*>(malloc(sizeof(cairo_path_t)));
+    path->status = CAIRO_STATUS_SUCCESS;
+    path->num_data = data.size();
+    path->data = static_cast<cairo_path_data_t*>(
+        malloc(sizeof(cairo_path_data_t) * data.size()));
+    if (!path->data && !data.empty()) {
+        free(path);
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    std::copy(data.begin(), data.end(), path->data);
+
+    JSObject* path_wrapper = gjs_cairo_path_from_path(cx, path);
+    if (!path_wrapper) {
+        cairo_path_destroy(path);
+        return false;
+    }
+
+    argv.rval().setObject(*path_wrapper);
+    return true;
+}
+
 JSFunctionSpec gjs_cairo_path_proto_funcs[] = {
-    JS_FS_END
-};
+    JS_FN("toData", toData_func, 0, 0),
+    JS_FS_END};
 
-JSFunctionSpec gjs_cairo_path_static_funcs[] = { JS_FS_END };
+JSFunctionSpec gjs_cairo_path_static_funcs[] = {
+    JS_FN("fromData", fromData_func, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
 
 /**
  * gjs_cairo_path_from_path:
@@ -25,6 +25,8 @@
 
 #include <config.h>
 
+#include <vector>
+
 #include <cairo-features.h>  // for CAIRO_HAS_PDF_SURFACE, CAIRO_HAS_PS_SURFACE
 #include <cairo.h>
 
@@ -69,6 +71,10 @@ JSObject *       gjs_cairo_path_from_path               (JSContext       *contex
 GJS_JSAPI_RETURN_CONVENTION
 cairo_path_t* gjs_cairo_path_get_path(JSContext* cx,
                                       JS::HandleObject path_wrapper);
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_cairo_path_data_from_arrays(JSContext* cx, JS::HandleObject ops,
+                                     JS::HandleObject coords,
+                                     std::vector<cairo_path_data_t>* data);
 
 /* surface */
 [[nodiscard]] JSObject* gjs_cairo_surface_get_proto(JSContext* cx);
@@ -22,6 +22,10 @@
 
 #include <config.h>
 
+#include <stdint.h>
+
+#include <vector>
+
 #include <cairo-gobject.h>
 #include <cairo.h>
 #include <girepository.h>
@@ -30,12 +34,14 @@
 #include <js/CallArgs.h>
 #include <js/Class.h>
 #include <js/Conversions.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Value.h>
 #include <jsapi.h>  // for JS_GetPropertyById, JS_SetPropert...
+#include <jsfriendapi.h>  // for JS_NewInt32Array, GetInt32ArrayLengthAn...
 
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
@@ -49,6 +55,8 @@
 #include "modules/cairo-private.h"
 
 [[nodiscard]] static JSObject* gjs_cairo_region_get_proto(JSContext*);
+GJS_JSAPI_RETURN_CONVENTION
+static JSObject* gjs_cairo_region_from_region(JSContext*, cairo_region_t*);
 
 GJS_DEFINE_PROTO_WITH_GTYPE("Region", cairo_region,
                             CAIRO_GOBJECT_TYPE_REGION,
@@ -223,6 +231,121 @@ get_rectangle_func(JSContext *context,
     RETURN_STATUS;
 }
 
+/* Rectangles in bulk are packed into an Int32Array as x, y, width, height for
+ * each rectangle, so that no JS object is created per rectangle */
+GJS_JSAPI_RETURN_CONVENTION
+static bool rectangles_from_array(JSContext* cx, JS::HandleObject array,
+                                  std::vector<cairo_rectangle_int_t>* rects) {
+    if (!JS_IsInt32Array(array)) {
+        gjs_throw(cx, "Rectangles must be given as an Int32Array");
+        return false;
+    }
+
+    uint32_t len = JS_GetTypedArrayLength(array);
+    if (len % 4 != 0) {
+        gjs_throw(cx,
+                  "Rectangle array length must be a multiple of 4, got %u",
+                  len);
+        return false;
+    }
+
+    rects->resize(len / 4);
+    JS::AutoCheckCannotGC nogc;
+    bool is_shared_memory;
+    int32_t* data;
+    js::GetInt32ArrayLengthAndData(array, &len, &is_shared_memory, &data);
+    for (size_t ix = 0; ix < rects->size(); ix++) {
+        const int32_t* rect = data + 4 * ix;
+        (*rects)[ix] = {rect[0], rect[1], rect[2], rect[3]};
+    }
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool unionRectangles_func(JSContext* context, unsigned argc,
+                                 JS::Value* vp) {
+    PRELUDE;
+    JS::RootedObject array(context);
+    if (!gjs_parse_call_args(context, "unionRectangles", argv, "o", "rects",
+                             &array))
+        return false;
+
+    std::vector<cairo_rectangle_int_t> rects;
+    if (!rectangles_from_array(context, array, &rects))
+        return false;
+
+    using AutoCairoRegion =
+        GjsAutoPointer<cairo_region_t, cairo_region_t, cairo_region_destroy>;
+    AutoCairoRegion other =
+        cairo_region_create_rectangles(rects.data(), rects.size());
+    if (!gjs_cairo_check_status(context, cairo_region_status(other), "region"))
+        return false;
+
+    cairo_region_union(this_region, other);
+    argv.rval().setUndefined();
+    RETURN_STATUS;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool getRectangles_func(JSContext* context, unsigned argc,
+                               JS::Value* vp) {
+    PRELUDE;
+    if (!gjs_parse_call_args(context, "getRectangles", argv, ""))
+        return false;
+
+    int n_rects = cairo_region_num_rectangles(this_region);
+    JS::RootedObject array(context, JS_NewInt32Array(context, 4 * n_rects));
+    if (!array)
+        return false;
+
+    {
+        JS::AutoCheckCannotGC nogc;
+        uint32_t len;
+        bool is_shared_memory;
+        int32_t* data;
+        js::GetInt32ArrayLengthAndData(array, &len, &is_shared_memory, &data);
+        for (int ix = 0; ix < n_rects; ix++) {
+            cairo_rectangle_int_t rect;
+            cairo_region_get_rectangle(this_region, ix, &rect);
+            int32_t* out = data + 4 * ix;
+            out[0] = rect.x;
+            out[1] = rect.y;
+            out[2] = rect.width;
+            out[3] = rect.height;
+        }
+    }
+
+    argv.rval().setObject(*array);
+    RETURN_STATUS;
+}
+
+// Region.fromRectangles(Int32Array) -> Cairo.Region
+GJS_JSAPI_RETURN_CONVENTION
+static bool fromRectangles_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject array(cx);
+    if (!gjs_parse_call_args(cx, "fromRectangles", argv, "o", "rects", &array))
+        return false;
+
+    std::vector<cairo_rectangle_int_t> rects;
+    if (!rectangles_from_array(cx, array, &rects))
+        return false;
+
+    using AutoCairoRegion =
+        GjsAutoPointer<cairo_region_t, cairo_region_t, cairo_region_destroy>;
+    AutoCairoRegion region =
+        cairo_region_create_rectangles(rects.data(), rects.size());
+    if (!gjs_cairo_check_status(cx, cairo_region_status(region), "region"))
+        return false;
+
+    JSObject* region_wrapper = gjs_cairo_region_from_region(cx, region);
+    if (!region_wrapper)
+        return false;
+
+    argv.rval().setObject(*region_wrapper);
+    return true;
+}
+
 // clang-format off
 JSPropertySpec gjs_cairo_region_proto_props[] = {
     JS_STRING_SYM_PS(toStringTag, "Region", JSPROP_READONLY),
@@ -242,9 +365,14 @@ JSFunctionSpec gjs_cairo_region_proto_funcs[] = {
 
     JS_FN("numRectangles", num_rectangles_func, 0, 0),
     JS_FN("getRectangle", get_rectangle_func, 0, 0),
+
+    JS_FN("unionRectangles", unionRectangles_func, 1, 0),
+    JS_FN("getRectangles", getRectangles_func, 0, 0),
     JS_FS_END};
 
-JSFunctionSpec gjs_cairo_region_static_funcs[] = { JS_FS_END };
+JSFunctionSpec gjs_cairo_region_static_funcs[] = {
+    JS_FN("fromRectangles", fromRectangles_func, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
 
 static void _gjs_cairo_region_construct_internal(JSObject* obj,
                                                  cairo_region_t* region) {
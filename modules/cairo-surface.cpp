@@ -29,6 +29,7 @@
 
 #include <js/CallArgs.h>
 #include <js/Class.h>
+#include <js/MemoryFunctions.h>  // for AddAssociatedMemory, RemoveAssoci...
 #include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
@@ -39,6 +40,7 @@
 #include "gi/arg-inl.h"
 #include "gi/arg.h"
 #include "gi/foreign.h"
+#include "gi/wrapperutils.h"  // for MemoryUse
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
@@ -49,10 +51,22 @@ GJS_DEFINE_PROTO_ABSTRACT_WITH_GTYPE("Surface", cairo_surface,
                                      CAIRO_GOBJECT_TYPE_SURFACE,
                                      JSCLASS_BACKGROUND_FINALIZE)
 
+/* Image surfaces own their pixel data, which the JS engine should know about
+ * when deciding whether to collect garbage; other kinds draw elsewhere */
+static size_t surface_payload_size(cairo_surface_t* surface) {
+    if (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE)
+        return 0;
+    return size_t(cairo_image_surface_get_stride(surface)) *
+           cairo_image_surface_get_height(surface);
+}
+
 static void gjs_cairo_surface_finalize(JSFreeOp*, JSObject* obj) {
     using AutoSurface =
         GjsAutoPointer<cairo_surface_t, cairo_surface_t, cairo_surface_destroy>;
     AutoSurface surface = static_cast<cairo_surface_t*>(JS_GetPrivate(obj));
+    if (surface)
+        JS::RemoveAssociatedMemory(obj, surface_payload_size(surface),
+                                   MemoryUse::NativePayload);
     JS_SetPrivate(obj, nullptr);
 }
 
@@ -116,13 +130,129 @@ getType_func(JSContext *context,
     return true;
 }
 
+GJS_JSAPI_RETURN_CONVENTION
+static bool flush_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_THIS(cx, argc, vp, argv, obj);
+
+    if (!gjs_parse_call_args(cx, "flush", argv, ""))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(cx, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_flush(surface);
+    if (!gjs_cairo_check_status(cx, cairo_surface_status(surface), "surface"))
+        return false;
+    argv.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool markDirty_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_THIS(cx, argc, vp, argv, obj);
+
+    if (!gjs_parse_call_args(cx, "markDirty", argv, ""))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(cx, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_mark_dirty(surface);
+    if (!gjs_cairo_check_status(cx, cairo_surface_status(surface), "surface"))
+        return false;
+    argv.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool markDirtyRectangle_func(JSContext* cx, unsigned argc,
+                                    JS::Value* vp) {
+    GJS_GET_THIS(cx, argc, vp, argv, obj);
+    int x, y, width, height;
+
+    if (!gjs_parse_call_args(cx, "markDirtyRectangle", argv, "iiii", "x", &x,
+                             "y", &y, "width", &width, "height", &height))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(cx, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_mark_dirty_rectangle(surface, x, y, width, height);
+    if (!gjs_cairo_check_status(cx, cairo_surface_status(surface), "surface"))
+        return false;
+    argv.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool finish_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_THIS(cx, argc, vp, argv, obj);
+
+    if (!gjs_parse_call_args(cx, "finish", argv, ""))
+        return false;
+
+    cairo_surface_t* surface = gjs_cairo_surface_get_surface(cx, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_finish(surface);
+    if (!gjs_cairo_check_status(cx, cairo_surface_status(surface), "surface"))
+        return false;
+    argv.rval().setUndefined();
+    return true;
+}
+
+// Throws if @obj is not a Cairo.Surface or an instance of one of its subclasses
+GJS_JSAPI_RETURN_CONVENTION
+static bool surface_typecheck(JSContext* cx, JS::HandleObject obj) {
+    JS::RootedObject proto(cx, gjs_cairo_surface_get_proto(cx));
+
+    bool is_surface_subclass = false;
+    if (!gjs_object_in_prototype_chain(cx, proto, obj, &is_surface_subclass))
+        return false;
+    if (!is_surface_subclass) {
+        gjs_throw(cx, "Expected Cairo.Surface but got %s",
+                  JS_GetClass(obj)->name);
+        return false;
+    }
+    return true;
+}
+
+/* Drops the wrapper's reference right away instead of waiting for the garbage
+ * collector, so a large image surface's pixels go back to the system without
+ * the JS engine's help. Arrays from getData() hold their own reference.
+ * Disposing of a surface again does nothing. */
+GJS_JSAPI_RETURN_CONVENTION
+static bool dispose_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_THIS(cx, argc, vp, argv, obj);
+    if (!surface_typecheck(cx, obj))
+        return false;
+
+    auto* surface = static_cast<cairo_surface_t*>(JS_GetPrivate(obj));
+    if (surface) {
+        JS_SetPrivate(obj, nullptr);
+        JS::RemoveAssociatedMemory(obj, surface_payload_size(surface),
+                                   MemoryUse::NativePayload);
+        cairo_surface_destroy(surface);
+    }
+
+    argv.rval().setUndefined();
+    return true;
+}
+
 JSFunctionSpec gjs_cairo_surface_proto_funcs[] = {
-    // flush
+    JS_FN("$dispose", dispose_func, 0, 0),
+    JS_FN("dispose", dispose_func, 0, 0),
+    JS_FN("finish", finish_func, 0, 0),
+    JS_FN("flush", flush_func, 0, 0),
     // getContent
     // getFontOptions
     JS_FN("getType", getType_func, 0, 0),
-    // markDirty
-    // markDirtyRectangle
+    JS_FN("markDirty", markDirty_func, 0, 0),
+    JS_FN("markDirtyRectangle", markDirtyRectangle_func, 4, 0),
     // setDeviceOffset
     // getDeviceOffset
     // setFallbackResolution
@@ -153,6 +283,8 @@ void gjs_cairo_surface_construct(JSObject* object, cairo_surface_t* surface) {
 
     g_assert(!JS_GetPrivate(object));
     JS_SetPrivate(object, cairo_surface_reference(surface));
+    JS::AddAssociatedMemory(object, surface_payload_size(surface),
+                            MemoryUse::NativePayload);
 }
 
 /**
@@ -225,19 +357,14 @@ cairo_surface_t* gjs_cairo_surface_get_surface(
     g_return_val_if_fail(cx, nullptr);
     g_return_val_if_fail(surface_wrapper, nullptr);
 
-    JS::RootedObject proto(cx, gjs_cairo_surface_get_proto(cx));
-
-    bool is_surface_subclass = false;
-    if (!gjs_object_in_prototype_chain(cx, proto, surface_wrapper,
-                                       &is_surface_subclass))
+    if (!surface_typecheck(cx, surface_wrapper))
         return nullptr;
-    if (!is_surface_subclass) {
-        gjs_throw(cx, "Expected Cairo.Surface but got %s",
-                  JS_GetClass(surface_wrapper)->name);
-        return nullptr;
-    }
 
-    return static_cast<cairo_surface_t*>(JS_GetPrivate(surface_wrapper));
+    auto* surface =
+        static_cast<cairo_surface_t*>(JS_GetPrivate(surface_wrapper));
+    if (!surface)
+        gjs_throw(cx, "Cairo.Surface has already been disposed");
+    return surface;
 }
 
 [[nodiscard]] static bool surface_to_g_argument(
@@ -65,6 +65,7 @@
 #include "cjs/context-private.h"
 #include "cjs/jsapi-util.h"
 #include "modules/console.h"
+#include "modules/print.h"
 
 namespace mozilla {
 union Utf8Unit;
@@ -85,6 +86,8 @@ public:
         if (!JS_IsExceptionPending(m_cx))
             return;
 
+        gjs_print_flush();
+
         /* Get exception object before printing and clearing exception. */
         JS::ExceptionStack exnStack(m_cx);
         JS::ErrorReportBuilder report(m_cx);
@@ -115,6 +118,8 @@ public:
 
 [[nodiscard]] static bool gjs_console_readline(char** bufp,
                                                const char* prompt) {
+    gjs_print_flush();
+
 #ifdef HAVE_READLINE_READLINE_H
     char *line;
     line = readline(prompt);
@@ -164,6 +169,7 @@ public:
     char *display_str;
     display_str = gjs_value_debug_string(cx, result);
     if (display_str) {
+        gjs_print_flush();
         g_fprintf(stdout, "%s\n", display_str);
         g_free(display_str);
     }
@@ -19,7 +19,7 @@
 // IN THE SOFTWARE.
 
 /* exported Antialias, Content, Extend, FillRule, Filter, FontSlant, FontWeight,
-Format, LineCap, LineJoin, Operator, PatternType, SurfaceType */
+Format, LineCap, LineJoin, Operator, PathDataType, PatternType, SurfaceType */
 
 var Antialias = {
     DEFAULT: 0,
@@ -119,6 +119,13 @@ var Operator = {
     HSL_LUMINOSITY: 28,
 };
 
+var PathDataType = {
+    MOVE_TO: 0,
+    LINE_TO: 1,
+    CURVE_TO: 2,
+    CLOSE_PATH: 3,
+};
+
 var PatternType = {
     SOLID: 0,
     SURFACE: 1,
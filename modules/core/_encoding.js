@@ -0,0 +1,100 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+/* exported TextDecoder, TextEncoder */
+
+const Native = imports._encodingNative;
+
+// Labels from the WHATWG Encoding Standard for the encodings decoded natively;
+// any other label is handed to iconv as is
+const _labels = {
+    'unicode-1-1-utf-8': 'utf-8',
+    'unicode11utf8': 'utf-8',
+    'unicode20utf8': 'utf-8',
+    'utf-8': 'utf-8',
+    'utf8': 'utf-8',
+    'x-unicode20utf8': 'utf-8',
+    'csunicode': 'utf-16le',
+    'iso-10646-ucs-2': 'utf-16le',
+    'ucs-2': 'utf-16le',
+    'unicode': 'utf-16le',
+    'unicodefeff': 'utf-16le',
+    'utf-16': 'utf-16le',
+    'utf-16le': 'utf-16le',
+    'unicodefffe': 'utf-16be',
+    'utf-16be': 'utf-16be',
+};
+
+var TextEncoder = class TextEncoder {
+    get encoding() {
+        return 'utf-8';
+    }
+
+    encode(input = '') {
+        return Native.encode(`${input}`);
+    }
+
+    encodeInto(input, destination) {
+        const [read, written] = Native.encodeInto(`${input}`, destination);
+        return {read, written};
+    }
+
+    get [Symbol.toStringTag]() {
+        return 'TextEncoder';
+    }
+};
+
+var TextDecoder = class TextDecoder {
+    constructor(label = 'utf-8', options = {}) {
+        const name = `${label}`.trim().toLowerCase();
+        this._encoding = _labels[name] || name;
+        this._fatal = Boolean(options.fatal);
+        this._ignoreBOM = Boolean(options.ignoreBOM);
+        this._pending = null;
+        this._bomSeen = false;
+
+        // Let iconv reject encodings it doesn't know about now, rather than
+        // on the first decode()
+        if (!(name in _labels))
+            Native.decode(new Uint8Array(0), this._encoding, true, false, null);
+    }
+
+    get encoding() {
+        return this._encoding;
+    }
+
+    get fatal() {
+        return this._fatal;
+    }
+
+    get ignoreBOM() {
+        return this._ignoreBOM;
+    }
+
+    decode(input = new Uint8Array(0), options = {}) {
+        const stream = Boolean(options.stream);
+        let str;
+        try {
+            [str, this._pending] = Native.decode(input, this._encoding,
+                this._fatal, stream, this._pending);
+        } catch (e) {
+            this._pending = null;
+            this._bomSeen = false;
+            throw e;
+        }
+
+        if (!this._ignoreBOM && !this._bomSeen && str.length > 0) {
+            this._bomSeen = true;
+            if (str.charCodeAt(0) === 0xfeff)
+                str = str.slice(1);
+        }
+
+        if (!stream)
+            this._bomSeen = false;
+
+        return str;
+    }
+
+    get [Symbol.toStringTag]() {
+        return 'TextDecoder';
+    }
+};
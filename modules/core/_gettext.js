@@ -37,6 +37,8 @@ gettext, LocaleCategory, ngettext, pgettext, setlocale, textdomain */
 
 const GLib = imports.gi.GLib;
 const CjsPrivate = imports.gi.CjsPrivate;
+// Cached lookups; the cache is invalidated by the CjsPrivate functions below
+const Native = imports._gettextNative;
 
 var LocaleCategory = CjsPrivate.LocaleCategory;
 
@@ -52,10 +54,10 @@ function bindtextdomain(dom, location) {
 }
 
 function gettext(msgid) {
-    return GLib.dgettext(null, msgid);
+    return Native.dgettext(null, msgid);
 }
 function dgettext(dom, msgid) {
-    return GLib.dgettext(dom, msgid);
+    return Native.dgettext(dom, msgid);
 }
 function dcgettext(dom, msgid, category) {
     return GLib.dcgettext(dom, msgid, category);
@@ -70,10 +72,10 @@ function dngettext(dom, msgid1, msgid2, n) {
 // FIXME: missing dcngettext ?
 
 function pgettext(context, msgid) {
-    return GLib.dpgettext2(null, context, msgid);
+    return Native.dpgettext(null, context, msgid);
 }
 function dpgettext(dom, context, msgid) {
-    return GLib.dpgettext2(dom, context, msgid);
+    return Native.dpgettext(dom, context, msgid);
 }
 
 /**
@@ -86,7 +88,7 @@ function dpgettext(dom, context, msgid) {
 function domain(domainName) {
     return {
         gettext(msgid) {
-            return GLib.dgettext(domainName, msgid);
+            return Native.dgettext(domainName, msgid);
         },
 
         ngettext(msgid1, msgid2, n) {
@@ -94,7 +96,7 @@ function domain(domainName) {
         },
 
         pgettext(context, msgid) {
-            return GLib.dpgettext2(domainName, context, msgid);
+            return Native.dpgettext(domainName, context, msgid);
         },
     };
 }
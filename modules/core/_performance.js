@@ -0,0 +1,181 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+/* exported performance */
+
+const Native = imports._performanceNative;
+
+// A subset of the User Timing API: marks and measures are kept until cleared,
+// and also end up in the profiler capture if the profiler is running, so that
+// applications can instrument their code and look at it alongside the GC and
+// GI marks.
+
+class PerformanceEntry {
+    constructor(name, entryType, startTime, duration, detail) {
+        Object.defineProperties(this, {
+            name: {value: name, enumerable: true},
+            entryType: {value: entryType, enumerable: true},
+            startTime: {value: startTime, enumerable: true},
+            duration: {value: duration, enumerable: true},
+            detail: {value: detail === undefined ? null : detail, enumerable: true},
+        });
+    }
+
+    toJSON() {
+        const {name, entryType, startTime, duration, detail} = this;
+        return {name, entryType, startTime, duration, detail};
+    }
+}
+
+class PerformanceMark extends PerformanceEntry {
+    get [Symbol.toStringTag]() {
+        return 'PerformanceMark';
+    }
+}
+
+class PerformanceMeasure extends PerformanceEntry {
+    get [Symbol.toStringTag]() {
+        return 'PerformanceMeasure';
+    }
+}
+
+function _profilerMessage(name, detail) {
+    if (detail === undefined || detail === null)
+        return name;
+    return `${name}: ${typeof detail === 'string' ? detail : JSON.stringify(detail)}`;
+}
+
+class Performance {
+    constructor() {
+        this._marks = new Map();
+        this._measures = new Map();
+    }
+
+    get timeOrigin() {
+        return Native.timeOrigin;
+    }
+
+    now() {
+        return Native.now();
+    }
+
+    mark(name, {startTime, detail} = {}) {
+        name = `${name}`;
+        if (startTime === undefined)
+            startTime = Native.now();
+        else if (typeof startTime !== 'number' || startTime < 0)
+            throw new TypeError(`Invalid start time ${startTime} for mark ${name}`);
+
+        const entry = new PerformanceMark(name, 'mark', startTime, 0, detail);
+        _addEntry(this._marks, entry);
+        if (Native.isProfiling()) {
+            Native.addProfilerMark('performance.mark',
+                _profilerMessage(name, detail), startTime, 0);
+        }
+        return entry;
+    }
+
+    measure(name, startOrOptions, endMark) {
+        name = `${name}`;
+        let start, end, duration, detail;
+        if (startOrOptions !== null && typeof startOrOptions === 'object') {
+            ({start, end, duration, detail} = startOrOptions);
+            if (endMark !== undefined)
+                throw new TypeError('Arguments after the measure options are not allowed');
+        } else {
+            start = startOrOptions;
+            end = endMark;
+        }
+
+        if (end !== undefined)
+            end = this._timeOf(end);
+        if (start !== undefined)
+            start = this._timeOf(start);
+        if (start === undefined && end !== undefined && duration !== undefined)
+            start = end - duration;
+        if (start === undefined)
+            start = 0;
+        if (end === undefined)
+            end = duration !== undefined ? start + duration : Native.now();
+
+        const entry = new PerformanceMeasure(name, 'measure', start,
+            end - start, detail);
+        _addEntry(this._measures, entry);
+        if (Native.isProfiling()) {
+            Native.addProfilerMark('performance.measure',
+                _profilerMessage(name, detail), start, end - start);
+        }
+        return entry;
+    }
+
+    clearMarks(name) {
+        _clearEntries(this._marks, name);
+    }
+
+    clearMeasures(name) {
+        _clearEntries(this._measures, name);
+    }
+
+    getEntries() {
+        return _sortedEntries([...this._marks.values(),
+            ...this._measures.values()].flat());
+    }
+
+    getEntriesByName(name, type) {
+        const entries = [];
+        if (type === undefined || type === 'mark')
+            entries.push(...this._marks.get(`${name}`) || []);
+        if (type === undefined || type === 'measure')
+            entries.push(...this._measures.get(`${name}`) || []);
+        return _sortedEntries(entries);
+    }
+
+    getEntriesByType(type) {
+        if (type === 'mark')
+            return _sortedEntries([...this._marks.values()].flat());
+        if (type === 'measure')
+            return _sortedEntries([...this._measures.values()].flat());
+        return [];
+    }
+
+    toJSON() {
+        return {timeOrigin: this.timeOrigin};
+    }
+
+    // A mark name stands for the time of the latest mark with that name
+    _timeOf(markOrTime) {
+        if (typeof markOrTime === 'number') {
+            if (markOrTime < 0)
+                throw new TypeError(`Invalid time ${markOrTime}`);
+            return markOrTime;
+        }
+        const marks = this._marks.get(`${markOrTime}`);
+        if (!marks)
+            throw new SyntaxError(`No mark named ${markOrTime}`);
+        return marks[marks.length - 1].startTime;
+    }
+
+    get [Symbol.toStringTag]() {
+        return 'Performance';
+    }
+}
+
+function _addEntry(map, entry) {
+    const entries = map.get(entry.name);
+    if (entries)
+        entries.push(entry);
+    else
+        map.set(entry.name, [entry]);
+}
+
+function _clearEntries(map, name) {
+    if (name === undefined)
+        map.clear();
+    else
+        map.delete(`${name}`);
+}
+
+function _sortedEntries(entries) {
+    return entries.sort((a, b) => a.startTime - b.startTime);
+}
+
+var performance = new Performance();
@@ -0,0 +1,43 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+/* exported Worker */
+
+const Native = imports._workerNative;
+
+// Runs a script on a thread of its own, in a context that shares nothing with
+// this one. The two sides talk through postMessage(); messages are structured
+// clones, and ArrayBuffers listed in the transfer array are moved rather than
+// copied.
+//
+// Inside the worker, incoming messages are passed to the global onmessage
+// function, and postMessage() and close() are globals. imports.gi is not
+// available there.
+var Worker = class Worker {
+    constructor(filename) {
+        this.onmessage = null;
+        this.onerror = null;
+        this._native = new Native.Worker(`${filename}`,
+            (type, data) => this._onEvent(type, data));
+    }
+
+    postMessage(message, transfer = []) {
+        this._native.postMessage(message, transfer);
+    }
+
+    terminate() {
+        this._native.terminate();
+    }
+
+    _onEvent(type, data) {
+        if (type === 'message') {
+            if (this.onmessage)
+                this.onmessage({data});
+            return;
+        }
+
+        if (this.onerror)
+            this.onerror({message: data});
+        else
+            logError(new Error(data), 'Uncaught exception in worker');
+    }
+};
@@ -19,6 +19,7 @@
 // IN THE SOFTWARE.
 
 const ByteArray = imports.byteArray;
+const Gi = imports._gi;
 
 let GLib;
 
@@ -184,86 +185,18 @@ function _packVariant(signature, value) {
 }
 
 function _unpackVariant(variant, deep, recursive = false) {
-    switch (String.fromCharCode(variant.classify())) {
-    case 'b':
-        return variant.get_boolean();
-    case 'y':
-        return variant.get_byte();
-    case 'n':
-        return variant.get_int16();
-    case 'q':
-        return variant.get_uint16();
-    case 'i':
-        return variant.get_int32();
-    case 'u':
-        return variant.get_uint32();
-    case 'x':
-        return variant.get_int64();
-    case 't':
-        return variant.get_uint64();
-    case 'h':
-        return variant.get_handle();
-    case 'd':
-        return variant.get_double();
-    case 'o':
-    case 'g':
-    case 's':
-        // g_variant_get_string has length as out argument
-        return variant.get_string()[0];
-    case 'v': {
-        const ret = variant.get_variant();
-        if (deep && recursive && ret instanceof GLib.Variant)
-            return _unpackVariant(ret, deep, recursive);
-        return ret;
-    }
-    case 'm': {
-        let val = variant.get_maybe();
-        if (deep && val)
-            return _unpackVariant(val, deep, recursive);
-        else
-            return val;
-    }
-    case 'a':
-        if (variant.is_of_type(new GLib.VariantType('a{?*}'))) {
-            // special case containers
-            let ret = { };
-            let nElements = variant.n_children();
-            for (let i = 0; i < nElements; i++) {
-                // always unpack the dictionary entry, and always unpack
-                // the key (or it cannot be added as a key)
-                let val = _unpackVariant(variant.get_child_value(i), deep,
-                    recursive);
-                let key;
-                if (!deep)
-                    key = _unpackVariant(val[0], true);
-                else
-                    key = val[0];
-                ret[key] = val[1];
-            }
-            return ret;
-        }
-        if (variant.is_of_type(new GLib.VariantType('ay'))) {
-            // special case byte arrays
-            return variant.get_data_as_bytes().toArray();
-        }
+    return Gi.variant_unpack(variant, deep, recursive);
+}
 
-        // fall through
-    case '(':
-    case '{': {
-        let ret = [];
-        let nElements = variant.n_children();
-        for (let i = 0; i < nElements; i++) {
-            let val = variant.get_child_value(i);
-            if (deep)
-                ret.push(_unpackVariant(val, deep, recursive));
+function _unpackVariantAsync(variant, recursive) {
+    return new Promise((resolve, reject) => {
+        Gi.variant_unpack_async(variant, recursive, (error, value) => {
+            if (error)
+                reject(error);
             else
-                ret.push(val);
-        }
-        return ret;
-    }
-    }
-
-    throw new Error('Assertion failure: this code should not be reached');
+                resolve(value);
+        });
+    });
 }
 
 function _notIntrospectableError(funcName, replacement) {
@@ -293,6 +226,14 @@ function _init() {
     };
 
     this.Variant._new_internal = function (sig, value) {
+        // Values that need coercing, or that can't be packed, are left to
+        // _packVariant()
+        if (typeof sig === 'string') {
+            const variant = Gi.variant_pack(sig, value);
+            if (variant !== undefined)
+                return variant;
+        }
+
         let signature = Array.prototype.slice.call(sig);
 
         let variant = _packVariant(signature, value);
@@ -320,6 +261,15 @@ function _init() {
         return _unpackVariant(this, true, true);
     };
 
+    // Same as deepUnpack() and recursiveUnpack(), but the variant is taken
+    // apart on another thread; for big D-Bus replies
+    this.Variant.prototype.deepUnpackAsync = function () {
+        return _unpackVariantAsync(this, false);
+    };
+    this.Variant.prototype.recursiveUnpackAsync = function () {
+        return _unpackVariantAsync(this, true);
+    };
+
     this.Variant.prototype.toString = function () {
         return `[object variant of type "${this.get_type_string()}"]`;
     };
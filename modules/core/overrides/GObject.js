@@ -97,58 +97,6 @@ function registerClass(...args) {
 
 // Some common functions between GObject.Class and GObject.Interface
 
-function _createSignals(gtype, sigs) {
-    for (let signalName in sigs) {
-        let obj = sigs[signalName];
-        let flags = obj.flags !== undefined ? obj.flags : GObject.SignalFlags.RUN_FIRST;
-        let accumulator = obj.accumulator !== undefined ? obj.accumulator : GObject.AccumulatorType.NONE;
-        let rtype = obj.return_type !== undefined ? obj.return_type : GObject.TYPE_NONE;
-        let paramtypes = obj.param_types !== undefined ? obj.param_types : [];
-
-        try {
-            obj.signal_id = Gi.signal_new(gtype, signalName, flags, accumulator, rtype, paramtypes);
-        } catch (e) {
-            throw new TypeError(`Invalid signal ${signalName}: ${e.message}`);
-        }
-    }
-}
-
-function _getCallerBasename() {
-    const stackLines = new Error().stack.trim().split('\n');
-    const lineRegex = new RegExp(/@(.+:\/\/)?(.*\/)?(.+)\.js:\d+(:[\d]+)?$/);
-    let thisFile = null;
-    let thisDir = null;
-
-    for (let line of stackLines) {
-        let match = line.match(lineRegex);
-        if (match) {
-            let scriptDir = match[2];
-            let scriptBasename = match[3];
-
-            if (!thisFile) {
-                thisDir = scriptDir;
-                thisFile = scriptBasename;
-                continue;
-            }
-
-            if (scriptDir === thisDir && scriptBasename === thisFile)
-                continue;
-
-            if (scriptDir && scriptDir.startsWith('/org/gnome/gjs/'))
-                continue;
-
-            let basename = scriptBasename;
-            if (scriptDir) {
-                scriptDir = scriptDir.replace(/^\/|\/$/g, '');
-                basename = `${scriptDir.split('/').reverse()[0]}_${basename}`;
-            }
-            return basename;
-        }
-    }
-
-    return null;
-}
-
 function _createGTypeName(klass) {
     const sanitizeGType = s => s.replace(/[^a-z0-9+_-]/gi, '_');
 
@@ -163,7 +111,7 @@ function _createGTypeName(klass) {
 
     let gtypeClassName = klass.name;
     if (GObject.gtypeNameBasedOnJSPath) {
-        let callerBasename = _getCallerBasename();
+        let callerBasename = Gi.caller_basename();
         if (callerBasename)
             gtypeClassName = `${callerBasename}_${gtypeClassName}`;
     }
@@ -448,12 +396,11 @@ function _init() {
 
         propertiesArray.forEach(pspec => _checkAccessors(klass.prototype, pspec, GObject));
 
+        // Properties and signals are all created in one native call
         let newClass = Gi.register_type(parent.prototype, gtypename, gflags,
-            gobjectInterfaces, propertiesArray);
+            gobjectInterfaces, propertiesArray, gobjectSignals);
         Object.setPrototypeOf(newClass, parent);
 
-        _createSignals(newClass.$gtype, gobjectSignals);
-
         _copyAllDescriptors(newClass, klass);
         gobjectInterfaces.forEach(iface =>
             _copyAllDescriptors(newClass.prototype, iface.prototype,
@@ -504,9 +451,7 @@ function _init() {
         let gobjectSignals = klass.hasOwnProperty(signals) ? klass[signals] : [];
 
         let newInterface = Gi.register_interface(gtypename, gobjectInterfaces,
-            props);
-
-        _createSignals(newInterface.$gtype, gobjectSignals);
+            props, gobjectSignals);
 
         _copyAllDescriptors(newInterface, klass);
 
@@ -558,11 +503,6 @@ function _init() {
     GObject.properties = properties;
     GObject.signals = signals;
 
-    // Replacement for non-introspectable g_object_set()
-    GObject.Object.prototype.set = function (params) {
-        Object.assign(this, params);
-    };
-
     // fake enum for signal accumulators, keep in sync with gi/object.c
     GObject.AccumulatorType = {
         NONE: 0,
@@ -21,6 +21,8 @@
 var GLib = imports.gi.GLib;
 var CjsPrivate = imports.gi.CjsPrivate;
 var Signals = imports.signals;
+var ByteArrayNative = imports._byteArrayNative;
+const Gi = imports._gi;
 var Gio;
 
 // Ensures that a Gio.UnixFDList being passed into or out of a DBus method with
@@ -72,7 +74,7 @@ function _validateFDVariant(variant, fdList) {
     throw new Error('Assertion failure: this code should not be reached');
 }
 
-function _proxyInvoker(methodName, sync, inSignature, argArray) {
+function _proxyInvoker(methodName, sync, inSignature, inTypeString, argArray) {
     var replyFunc;
     var flags = 0;
     var cancellable = null;
@@ -115,7 +117,6 @@ function _proxyInvoker(methodName, sync, inSignature, argArray) {
         }
     }
 
-    const inTypeString = `(${inSignature.join('')})`;
     const inVariant = new GLib.Variant(inTypeString, argArray);
     if (inTypeString.includes('h')) {
         if (!fdList) {
@@ -125,6 +126,13 @@ function _proxyInvoker(methodName, sync, inSignature, argArray) {
         _validateFDVariant(inVariant, fdList);
     }
 
+    // Without file descriptors, the call and the unpacking of the reply are
+    // done natively
+    if (!fdList) {
+        return Gi.dbus_proxy_call(this, methodName, inVariant, flags,
+            cancellable, sync ? null : replyFunc);
+    }
+
     var asyncCallback = (proxy, result) => {
         try {
             const [outVariant, outFdList] =
@@ -138,9 +146,7 @@ function _proxyInvoker(methodName, sync, inSignature, argArray) {
     if (sync) {
         const [outVariant, outFdList] = this.call_with_unix_fd_list_sync(
             methodName, inVariant, flags, -1, fdList, cancellable);
-        if (fdList)
-            return [outVariant.deepUnpack(), outFdList];
-        return outVariant.deepUnpack();
+        return [outVariant.deepUnpack(), outFdList];
     }
 
     return this.call_with_unix_fd_list(methodName, inVariant, flags, -1, fdList,
@@ -159,9 +165,11 @@ function _makeProxyMethod(method, sync) {
     var inSignature = [];
     for (i = 0; i < inArgs.length; i++)
         inSignature.push(inArgs[i].signature);
+    const inTypeString = `(${inSignature.join('')})`;
 
     return function (...args) {
-        return _proxyInvoker.call(this, name, sync, inSignature, args);
+        return _proxyInvoker.call(this, name, sync, inSignature, inTypeString,
+            args);
     };
 }
 
@@ -191,50 +199,95 @@ function _propertySetter(name, signature, value) {
         });
 }
 
-function _addDBusConvenience() {
-    let info = this.g_interface_info;
-    if (!info)
-        return;
-
-    if (info.signals.length > 0)
-        this.connect('g-signal', _convertToNativeSignal);
+// Interfaces parsed from XML strings, shared by all the proxy wrappers and
+// exported objects made from the same XML. Each entry also holds what proxies
+// of the interface share: a prototype with the methods for each proxy class,
+// and the property descriptors, so that setting up a proxy takes no parsing
+// and no new functions.
+const _interfaceCache = new Map();
+const _interfaceEntry = Symbol('D-Bus interface');
+
+function _getInterfaceEntry(xml) {
+    let entry = _interfaceCache.get(xml);
+    if (!entry) {
+        const info = Gio.DBusNodeInfo.new_for_xml(xml).interfaces[0];
+        info.cache_build();
+        entry = {info, prototypes: new Map(), properties: null};
+        _interfaceCache.set(xml, entry);
+    }
+    return entry;
+}
 
-    let i, methods = info.methods;
-    for (i = 0; i < methods.length; i++) {
-        var method = methods[i];
-        this[`${method.name}Remote`] = _makeProxyMethod(methods[i], false);
-        this[`${method.name}Sync`] = _makeProxyMethod(methods[i], true);
+function _addDBusMethods(target, info) {
+    for (const method of info.methods) {
+        target[`${method.name}Remote`] = _makeProxyMethod(method, false);
+        target[`${method.name}Sync`] = _makeProxyMethod(method, true);
     }
+}
 
-    let properties = info.properties;
-    for (i = 0; i < properties.length; i++) {
-        let name = properties[i].name;
-        let signature = properties[i].signature;
-        let flags = properties[i].flags;
-        let getter = () => {
+function _makeDBusPropertyDescriptors(info) {
+    const descriptors = {};
+    for (const {name, signature, flags} of info.properties) {
+        let get = () => {
             throw new Error(`Property ${name} is not readable`);
         };
-        let setter = () => {
+        let set = () => {
             throw new Error(`Property ${name} is not writable`);
         };
 
-        if (flags & Gio.DBusPropertyInfoFlags.READABLE)
-            getter = _propertyGetter.bind(this, name);
+        if (flags & Gio.DBusPropertyInfoFlags.READABLE) {
+            get = function () {
+                return _propertyGetter.call(this, name);
+            };
+        }
+
+        if (flags & Gio.DBusPropertyInfoFlags.WRITABLE) {
+            set = function (value) {
+                _propertySetter.call(this, name, signature, value);
+            };
+        }
 
-        if (flags & Gio.DBusPropertyInfoFlags.WRITABLE)
-            setter = _propertySetter.bind(this, name, signature);
+        descriptors[name] = {get, set, configurable: false, enumerable: true};
+    }
+    return descriptors;
+}
 
-        Object.defineProperty(this, name, {
-            get: getter,
-            set: setter,
-            configurable: false,
-            enumerable: true,
-        });
+function _addDBusConvenience() {
+    const entry = this[_interfaceEntry];
+    let info = entry ? entry.info : this.g_interface_info;
+    if (!info)
+        return;
+
+    if (info.signals.length > 0)
+        this.connect('g-signal', _convertToNativeSignal);
+
+    if (!entry) {
+        _addDBusMethods(this, info);
+        Object.defineProperties(this, _makeDBusPropertyDescriptors(info));
+        return;
     }
+
+    const base = Object.getPrototypeOf(this);
+    if (Object.prototype.hasOwnProperty.call(base, _interfaceEntry))
+        return;  // already set up
+    let proto = entry.prototypes.get(base);
+    if (!proto) {
+        proto = Object.create(base);
+        Object.defineProperty(proto, _interfaceEntry, {value: entry});
+        _addDBusMethods(proto, info);
+        entry.prototypes.set(base, proto);
+    }
+    if (!entry.properties)
+        entry.properties = _makeDBusPropertyDescriptors(info);
+
+    Object.setPrototypeOf(this, proto);
+    Object.defineProperties(this, entry.properties);
 }
 
 function _makeProxyWrapper(interfaceXml) {
-    var info = _newInterfaceInfo(interfaceXml);
+    const entry = typeof interfaceXml === 'string'
+        ? _getInterfaceEntry(interfaceXml) : null;
+    var info = entry ? entry.info : _newInterfaceInfo(interfaceXml);
     var iname = info.name;
     return function (bus, name, object, asyncCallback, cancellable,
         flags = Gio.DBusProxyFlags.NONE) {
@@ -246,6 +299,10 @@ function _makeProxyWrapper(interfaceXml) {
             g_flags: flags,
             g_object_path: object,
         });
+        // Also keeps the wrapper, with its prototype, alive as long as the
+        // proxy is
+        if (entry)
+            Object.defineProperty(obj, _interfaceEntry, {value: entry});
 
         if (!cancellable)
             cancellable = null;
@@ -278,6 +335,8 @@ function _newNodeInfo(constructor, value) {
 }
 
 function _newInterfaceInfo(value) {
+    if (typeof value === 'string')
+        return _getInterfaceEntry(value).info;
     var nodeInfo = Gio.DBusNodeInfo.new_for_xml(value);
     return nodeInfo.interfaces[0];
 }
@@ -318,7 +377,19 @@ function _makeOutSignature(args) {
     return `${ret})`;
 }
 
-function _handleMethodCall(info, impl, methodName, parameters, invocation) {
+// Computes what _handleMethodCall() needs to know about each method once,
+// rather than on every call
+function _makeMethodTable(info) {
+    return new Map(info.methods.map(methodInfo => {
+        const outArgs = methodInfo.out_args;
+        return [methodInfo.name, {
+            nOutArgs: outArgs.length,
+            outSignature: _makeOutSignature(outArgs),
+        }];
+    }));
+}
+
+function _handleMethodCall(methods, impl, methodName, parameters, invocation) {
     // prefer a sync version if available
     if (this[methodName]) {
         let retval;
@@ -347,13 +418,11 @@ function _handleMethodCall(info, impl, methodName, parameters, invocation) {
             let outFdList = null;
             if (!(retval instanceof GLib.Variant)) {
                 // attempt packing according to out signature
-                let methodInfo = info.lookup_method(methodName);
-                let outArgs = methodInfo.out_args;
-                let outSignature = _makeOutSignature(outArgs);
+                const {nOutArgs, outSignature} = methods.get(methodName);
                 if (outSignature.includes('h') &&
                     retval[retval.length - 1] instanceof Gio.UnixFDList) {
                     outFdList = retval.pop();
-                } else if (outArgs.length === 1) {
+                } else if (nOutArgs === 1) {
                     // if one arg, we don't require the handler wrapping it
                     // into an Array
                     retval = [retval];
@@ -399,9 +468,16 @@ function _wrapJSObject(interfaceInfo, jsObj) {
         info = Gio.DBusInterfaceInfo.new_for_xml(interfaceInfo);
     info.cache_build();
 
+    const methods = _makeMethodTable(info);
     var impl = new CjsPrivate.DBusImplementation({g_interface_info: info});
+    // Method calls go straight to the method table, skipping the signal,
+    // until the object is unexported; the signal handler takes over if it is
+    // exported again
+    impl.set_method_call_func((self, methodName, parameters, invocation) =>
+        _handleMethodCall.call(jsObj, methods, self, methodName, parameters,
+            invocation));
     impl.connect('handle-method-call', function (self, methodName, parameters, invocation) {
-        return _handleMethodCall.call(jsObj, info, self, methodName, parameters, invocation);
+        return _handleMethodCall.call(jsObj, methods, self, methodName, parameters, invocation);
     });
     impl.connect('handle-property-get', function (self, propertyName) {
         return _handlePropertyGet.call(jsObj, info, self, propertyName);
@@ -413,17 +489,40 @@ function _wrapJSObject(interfaceInfo, jsObj) {
     return impl;
 }
 
+// Items are fetched natively in chunks, so iterating a large model costs a
+// handful of calls into C rather than two per item
+const LIST_MODEL_CHUNK_SIZE = 256;
+
 function* _listModelIterator() {
     let _index = 0;
     const _len = this.get_n_items();
-    while (_index < _len)
-        yield this.get_item(_index++);
+    while (_index < _len) {
+        const items = Gi.list_model_items(this, _index,
+            Math.min(LIST_MODEL_CHUNK_SIZE, _len - _index));
+        if (items.length === 0)
+            return;
+        yield* items;
+        _index += items.length;
+    }
+}
+
+// Returns a snapshot of all the items in the model, fetched in one call
+function _listModelToArray() {
+    return Gi.list_model_items(this, 0, this.get_n_items());
 }
 
 function _promisify(proto, asyncFunc, finishFunc) {
     if (proto[`_original_${asyncFunc}`] !== undefined)
         return;
     proto[`_original_${asyncFunc}`] = proto[asyncFunc];
+
+    // Introspected functions create and settle the promise natively; the JS
+    // wrapper below is only for functions overridden in JS
+    if (typeof proto[asyncFunc] === 'function' &&
+        typeof proto[finishFunc] === 'function' &&
+        Gi.promisify(proto[asyncFunc], proto[finishFunc]))
+        return;
+
     proto[asyncFunc] = function (...args) {
         if (!args.every(arg => typeof arg !== 'function'))
             return this[`_original_${asyncFunc}`](...args);
@@ -449,6 +548,53 @@ function _promisify(proto, asyncFunc, finishFunc) {
     };
 }
 
+// Reading and writing directly into and out of Uint8Arrays. The async
+// variants detach the array's buffer while the operation is in progress, and
+// resolve with the number of bytes and a new array over the same memory.
+function _defaultStreamCount(array, offset, count) {
+    return count === undefined ? array.length - offset : count;
+}
+
+function _streamTransferAsync(nativeFunc, stream, array, offset, count,
+    priority, cancellable) {
+    return new Promise((resolve, reject) => {
+        nativeFunc(stream, array, offset, count, cancellable, priority,
+            (error, n, newArray) => {
+                if (error)
+                    reject(error);
+                else
+                    resolve([n, newArray]);
+            });
+    });
+}
+
+function _inputStreamReadInto(array, offset = 0, count = undefined,
+    cancellable = null) {
+    count = _defaultStreamCount(array, offset, count);
+    return ByteArrayNative.readInto(this, array, offset, count, cancellable);
+}
+
+function _inputStreamReadIntoAsync(array, offset = 0, count = undefined,
+    priority = GLib.PRIORITY_DEFAULT, cancellable = null) {
+    count = _defaultStreamCount(array, offset, count);
+    return _streamTransferAsync(ByteArrayNative.readIntoAsync, this, array,
+        offset, count, priority, cancellable);
+}
+
+function _outputStreamWriteAllFrom(array, offset = 0, count = undefined,
+    cancellable = null) {
+    count = _defaultStreamCount(array, offset, count);
+    return ByteArrayNative.writeAllFrom(this, array, offset, count,
+        cancellable);
+}
+
+function _outputStreamWriteAllFromAsync(array, offset = 0, count = undefined,
+    priority = GLib.PRIORITY_DEFAULT, cancellable = null) {
+    count = _defaultStreamCount(array, offset, count);
+    return _streamTransferAsync(ByteArrayNative.writeAllFromAsync, this,
+        array, offset, count, priority, cancellable);
+}
+
 function _init() {
     Gio = this;
 
@@ -507,6 +653,14 @@ function _init() {
 
     // ListStore
     Gio.ListStore.prototype[Symbol.iterator] = _listModelIterator;
+    Gio.ListStore.prototype.toArray = _listModelToArray;
+
+    // Streams
+    Gio.InputStream.prototype.read_into = _inputStreamReadInto;
+    Gio.InputStream.prototype.read_into_async = _inputStreamReadIntoAsync;
+    Gio.OutputStream.prototype.write_all_from = _outputStreamWriteAllFrom;
+    Gio.OutputStream.prototype.write_all_from_async =
+        _outputStreamWriteAllFromAsync;
 
     // Promisify
     Gio._promisify = _promisify;
@@ -527,11 +681,11 @@ function _init() {
 
     Gio.Settings.prototype._realMethods = Object.assign({}, Gio.Settings.prototype);
 
-    function createCheckedMethod(method, checkMethod = '_checkKey') {
-        return function (id, ...args) {
-            this[checkMethod](id);
-            return this._realMethods[method].call(this, id, ...args);
-        };
+    // The key or child name is checked natively, against a hash table built
+    // the first time; typed getters and setters also check the key's type
+    function createCheckedMethod(method, kind = 'key') {
+        return Gi.settings_checked_method(Gio.Settings.prototype._realMethods[method],
+            kind);
     }
 
     Object.assign(Gio.Settings.prototype, {
@@ -588,26 +742,26 @@ function _init() {
                 throw new Error(`Child ${name} not found in GSettings schema ${this.schema_id}`);
         },
 
-        get_boolean: createCheckedMethod('get_boolean'),
-        set_boolean: createCheckedMethod('set_boolean'),
-        get_double: createCheckedMethod('get_double'),
-        set_double: createCheckedMethod('set_double'),
+        get_boolean: createCheckedMethod('get_boolean', 'b'),
+        set_boolean: createCheckedMethod('set_boolean', 'b'),
+        get_double: createCheckedMethod('get_double', 'd'),
+        set_double: createCheckedMethod('set_double', 'd'),
         get_enum: createCheckedMethod('get_enum'),
         set_enum: createCheckedMethod('set_enum'),
         get_flags: createCheckedMethod('get_flags'),
         set_flags: createCheckedMethod('set_flags'),
-        get_int: createCheckedMethod('get_int'),
-        set_int: createCheckedMethod('set_int'),
-        get_int64: createCheckedMethod('get_int64'),
-        set_int64: createCheckedMethod('set_int64'),
-        get_string: createCheckedMethod('get_string'),
-        set_string: createCheckedMethod('set_string'),
-        get_strv: createCheckedMethod('get_strv'),
-        set_strv: createCheckedMethod('set_strv'),
-        get_uint: createCheckedMethod('get_uint'),
-        set_uint: createCheckedMethod('set_uint'),
-        get_uint64: createCheckedMethod('get_uint64'),
-        set_uint64: createCheckedMethod('set_uint64'),
+        get_int: createCheckedMethod('get_int', 'i'),
+        set_int: createCheckedMethod('set_int', 'i'),
+        get_int64: createCheckedMethod('get_int64', 'x'),
+        set_int64: createCheckedMethod('set_int64', 'x'),
+        get_string: createCheckedMethod('get_string', 's'),
+        set_string: createCheckedMethod('set_string', 's'),
+        get_strv: createCheckedMethod('get_strv', 'as'),
+        set_strv: createCheckedMethod('set_strv', 'as'),
+        get_uint: createCheckedMethod('get_uint', 'u'),
+        set_uint: createCheckedMethod('set_uint', 'u'),
+        get_uint64: createCheckedMethod('get_uint64', 't'),
+        set_uint64: createCheckedMethod('set_uint64', 't'),
         get_value: createCheckedMethod('get_value'),
         set_value: createCheckedMethod('set_value'),
 
@@ -619,6 +773,6 @@ function _init() {
         is_writable: createCheckedMethod('is_writable'),
         reset: createCheckedMethod('reset'),
 
-        get_child: createCheckedMethod('get_child', '_checkChild'),
+        get_child: createCheckedMethod('get_child', 'child'),
     });
 }
@@ -25,6 +25,10 @@ const {Gio, CjsPrivate, GObject} = imports.gi;
 let Gtk;
 let BuilderScope;
 
+// Per class: the template child IDs, and the instance properties that they
+// are assigned to, worked out once in _classInit()
+const templateChildren = Symbol('template children');
+
 function _init() {
 
     Gtk = this;
@@ -41,6 +45,12 @@ function _init() {
         Gtk.Container.prototype.child_set_property = function (child, property, value) {
             CjsPrivate.gtk_container_child_set_property(this, child, property, value);
         };
+
+        Gtk.Container.prototype.child_set_properties = function (child, properties) {
+            const names = Object.keys(properties);
+            CjsPrivate.gtk_container_child_set_properties(this, child, names,
+                names.map(name => properties[name]));
+        };
     }
 
     Gtk.Widget.prototype._init = function (params) {
@@ -62,18 +72,13 @@ function _init() {
 
         GObject.Object.prototype._init.call(this, params);
 
-        if (this.constructor[Gtk.template]) {
-            let children = this.constructor[Gtk.children] || [];
-            for (let child of children) {
-                this[child.replace(/-/g, '_')] =
-                    this.get_template_child(this.constructor, child);
-            }
-
-            let internalChildren = this.constructor[Gtk.internalChildren] || [];
-            for (let child of internalChildren) {
-                this[`_${child.replace(/-/g, '_')}`] =
-                    this.get_template_child(this.constructor, child);
-            }
+        const bound = this.constructor[templateChildren];
+        if (this.constructor[Gtk.template] && bound && bound.ids.length > 0) {
+            const objects = CjsPrivate.gtk_widget_get_template_children(this,
+                this.constructor.$gtype, bound.ids);
+            bound.properties.forEach((prop, ix) => {
+                this[prop] = objects[ix];
+            });
         }
     };
 
@@ -122,6 +127,16 @@ function _init() {
                 Gtk.Widget.bind_template_child_full.call(klass, child, true, 0));
         }
 
+        const childIds = children || [];
+        const internalChildIds = internalChildren || [];
+        Object.defineProperty(klass, templateChildren, {
+            value: {
+                ids: childIds.concat(internalChildIds),
+                properties: childIds.map(id => id.replace(/-/g, '_')).concat(
+                    internalChildIds.map(id => `_${id.replace(/-/g, '_')}`)),
+            },
+        });
+
         return klass;
     };
 
@@ -0,0 +1,417 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ *
+ * Copyright (c) 2021 The CJS authors
+ */
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <algorithm>  // for min
+#include <cmath>  // for fabs, isfinite, trunc
+#include <memory>  // for make_shared
+#include <string>
+
+#include <glib.h>
+
+#include <js/CallArgs.h>
+#include <js/Conversions.h>  // for ToInt32, ToObject, ToString
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
+#include <js/Id.h>
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Value.h>
+#include <js/ValueArray.h>
+#include <jsapi.h>  // for JS_GetElement, JS_NewUCStringCopyN, ...
+#include <jsfriendapi.h>  // for JS_GetLatin1LinearStringChars, ...
+
+#include "cjs/context-private.h"
+#include "cjs/jsapi-util.h"
+#include "libgjs-private/gjs-util.h"
+#include "modules/format.h"
+
+// Larger padding than this could never fit in a JS string; the same as
+// JSString::MAX_LENGTH
+static constexpr size_t MAX_WIDTH = (1 << 30) - 2;
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool append_string(JSContext* cx, std::u16string* out, JSString* str) {
+    size_t len = JS_GetStringLength(str);
+    if (len == 0)
+        return true;
+
+    JSLinearString* linear = JS_EnsureLinearString(cx, str);
+    if (!linear)
+        return false;
+
+    JS::AutoCheckCannotGC nogc;
+    if (JS_StringHasLatin1Chars(str)) {
+        const JS::Latin1Char* chars = JS_GetLatin1LinearStringChars(nogc, linear);
+        out->append(chars, chars + len);
+    } else {
+        out->append(JS_GetTwoByteLinearStringChars(nogc, linear), len);
+    }
+    return true;
+}
+
+static void append_ascii(std::u16string* out, const char* ascii) {
+    for (; *ascii; ascii++)
+        out->push_back(*ascii);
+}
+
+[[nodiscard]] static bool is_digit(char16_t c) { return c >= '0' && c <= '9'; }
+
+// What '.' does not match in a JS regular expression
+[[nodiscard]] static bool is_line_terminator(char16_t c) {
+    return c == '\n' || c == '\r' || c == 0x2028 || c == 0x2029;
+}
+
+static void push_literal(GjsParsedFormat* parts, const std::u16string& str,
+                         size_t start, size_t length) {
+    if (!parts->empty() && !parts->back().conversion) {
+        parts->back().literal.append(str, start, length);
+        return;
+    }
+    parts->push_back({str.substr(start, length), 0, ' ', false, 0, 0, -1});
+}
+
+// Accepts the same syntax as the regular expression
+// /%(?:([1-9][0-9]*)\$)?(I+)?([0-9]+)?(?:\.([0-9]+))?(.)/g that the format
+// module was originally written with, and throws the same errors
+GJS_JSAPI_RETURN_CONVENTION
+static bool parse_format(JSContext* cx, const std::u16string& str,
+                         GjsParsedFormat* parts) {
+    size_t len = str.length();
+    size_t last_index = 0;
+    unsigned next_arg = 0;
+    bool use_pos = false;
+
+    size_t start = str.find(u'%');
+    while (start != std::u16string::npos) {
+        size_t ix = start + 1;
+        if (ix == len || is_line_terminator(str[ix])) {
+            // Not a match, so the '%' is literal text
+            start = str.find(u'%', ix);
+            continue;
+        }
+
+        unsigned pos = 0;
+        if (str[ix] >= '1' && str[ix] <= '9') {
+            size_t end = ix;
+            uint64_t value = 0;
+            for (; end < len && is_digit(str[end]); end++)
+                value = std::min<uint64_t>(value * 10 + (str[end] - '0'),
+                                           G_MAXUINT);
+            if (end < len && str[end] == '$') {
+                pos = value;
+                ix = end + 1;
+            }
+        }
+
+        bool alternative = false;
+        for (; ix < len && str[ix] == 'I'; ix++)
+            alternative = true;
+
+        char16_t fill_char = ' ';
+        size_t width = 0;
+        if (ix < len && is_digit(str[ix])) {
+            if (str[ix] == '0')
+                fill_char = '0';
+            for (; ix < len && is_digit(str[ix]); ix++)
+                width = std::min(width * 10 + (str[ix] - '0'), MAX_WIDTH + 1);
+            if (width > MAX_WIDTH) {
+                gjs_throw_custom(cx, JSProto_RangeError, nullptr,
+                                 "Invalid string length");
+                return false;
+            }
+        }
+
+        int precision = -1;
+        if (ix + 1 < len && str[ix] == '.' && is_digit(str[ix + 1])) {
+            precision = 0;
+            for (ix++; ix < len && is_digit(str[ix]); ix++)
+                precision = std::min(precision * 10 + (str[ix] - '0'), 1000);
+        }
+
+        if (ix == len || is_line_terminator(str[ix])) {
+            // The regular expression would backtrack until the last character
+            // of the specification is taken as the conversion character
+            gjs_throw(cx, "Unsupported conversion character %%%c",
+                      static_cast<char>(str[ix - 1]));
+            return false;
+        }
+        char16_t conversion = str[ix++];
+
+        if (precision != -1 && conversion != 'f') {
+            gjs_throw(cx, "Precision can only be specified for 'f'");
+            return false;
+        }
+        if (alternative && conversion != 'd') {
+            gjs_throw(cx,
+                      "Alternative output digits can only be specified for "
+                      "'d'");
+            return false;
+        }
+
+        if (!use_pos && next_arg == 0)
+            use_pos = pos > 0;
+        if ((use_pos && pos == 0) || (!use_pos && pos > 0)) {
+            gjs_throw(cx,
+                      "Numbered and unnumbered conversion specifications "
+                      "cannot be mixed");
+            return false;
+        }
+
+        if (start > last_index)
+            push_literal(parts, str, last_index, start - last_index);
+        last_index = ix;
+        start = str.find(u'%', ix);
+
+        if (conversion == '%') {
+            push_literal(parts, u"%", 0, 1);
+            continue;
+        }
+
+        if (conversion != 's' && conversion != 'd' && conversion != 'x' &&
+            conversion != 'f') {
+            GjsAutoChar utf8 = g_utf16_to_utf8(
+                reinterpret_cast<const gunichar2*>(&conversion), 1, nullptr,
+                nullptr, nullptr);
+            gjs_throw(cx, "Unsupported conversion character %%%s",
+                      utf8 ? utf8.get() : "?");
+            return false;
+        }
+
+        parts->push_back({std::u16string(), conversion, fill_char, alternative,
+                          use_pos ? pos - 1 : next_arg++, width, precision});
+    }
+
+    if (last_index < len)
+        push_literal(parts, str, last_index, len - last_index);
+    return true;
+}
+
+GjsParsedFormatPtr GjsFormatCache::get(JSContext* cx,
+                                       JS::HandleString format) {
+    JS::RootedId id(cx);
+    if (!JS_StringToId(cx, format, &id))
+        return nullptr;
+
+    if (Table::Ptr entry = m_table.lookup(id))
+        return entry->value();
+
+    std::u16string chars;
+    auto parsed = std::make_shared<GjsParsedFormat>();
+    if (!append_string(cx, &chars, format) ||
+        !parse_format(cx, chars, parsed.get()))
+        return nullptr;
+
+    if (m_table.count() >= MAX_ENTRIES)
+        clear();
+
+    if (!m_table.put(id, parsed)) {
+        JS_ReportOutOfMemory(cx);
+        return nullptr;
+    }
+    return parsed;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool call_global(JSContext* cx, const char* name, JS::HandleValue arg,
+                        JS::MutableHandleValue rval) {
+    JS::RootedObject global(cx, JS::CurrentGlobalOrNull(cx));
+    return JS_CallFunctionName(cx, global, name, JS::HandleValueArray(arg),
+                               rval);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool call_number_method(JSContext* cx, const char* name,
+                               JS::HandleValue number, int32_t arg,
+                               JS::MutableHandleValue rval) {
+    JS::RootedObject proto(cx);
+    JS::RootedValue method(cx);
+    JS::RootedValue v_arg(cx, JS::Int32Value(arg));
+    return JS_GetClassPrototype(cx, JSProto_Number, &proto) &&
+           JS_GetProperty(cx, proto, name, &method) &&
+           JS::Call(cx, number, method, JS::HandleValueArray(v_arg), rval);
+}
+
+// Same as parseInt(arg), skipping the conversion to a string for numbers
+// whose string form has no exponent
+GJS_JSAPI_RETURN_CONVENTION
+static bool parse_int(JSContext* cx, JS::HandleValue arg,
+                      JS::MutableHandleValue rval) {
+    if (arg.isInt32()) {
+        rval.set(arg);
+        return true;
+    }
+    if (arg.isDouble()) {
+        double value = arg.toDouble();
+        double magnitude = std::fabs(value);
+        if (!std::isfinite(value)) {
+            rval.setNaN();
+            return true;
+        }
+        if (value == 0 || (magnitude >= 1e-6 && magnitude < 1e21)) {
+            rval.setNumber(std::trunc(value));
+            return true;
+        }
+    }
+    return call_global(cx, "parseInt", arg, rval);
+}
+
+// Same as parseFloat(arg)
+GJS_JSAPI_RETURN_CONVENTION
+static bool parse_float(JSContext* cx, JS::HandleValue arg,
+                        JS::MutableHandleValue rval) {
+    if (arg.isNumber()) {
+        rval.set(arg);
+        return true;
+    }
+    return call_global(cx, "parseFloat", arg, rval);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool format_conversion(JSContext* cx, const GjsFormatPart& spec,
+                              JS::HandleValue arg, std::u16string* out) {
+    size_t start = out->length();
+    char buf[32];
+    JS::RootedValue value(cx);
+    JS::RootedString str(cx);
+
+    switch (spec.conversion) {
+    case 's':
+        if (arg.isString()) {
+            str = arg.toString();
+        } else if (arg.isSymbol()) {
+            // String() accepts symbols, but ToString() throws
+            if (!call_global(cx, "String", arg, &value))
+                return false;
+            str = value.toString();
+        } else if (!(str = JS::ToString(cx, arg))) {
+            return false;
+        }
+        break;
+
+    case 'd':
+        if (!parse_int(cx, arg, &value))
+            return false;
+        if (spec.alternative) {
+            int32_t n;
+            if (!JS::ToInt32(cx, value, &n))
+                return false;
+            GjsAutoChar digits = gjs_format_int_alternative_output(n);
+            if (!gjs_string_from_utf8(cx, digits.get(), &value))
+                return false;
+            str = value.toString();
+        } else if (value.isInt32()) {
+            g_snprintf(buf, sizeof(buf), "%d", value.toInt32());
+            append_ascii(out, buf);
+        } else if (!(str = JS::ToString(cx, value))) {
+            return false;
+        }
+        break;
+
+    case 'x':
+        if (!parse_int(cx, arg, &value))
+            return false;
+        if (value.isInt32()) {
+            int64_t n = value.toInt32();
+            g_snprintf(buf, sizeof(buf), "%s%" G_GINT64_MODIFIER "x",
+                       n < 0 ? "-" : "", n < 0 ? -n : n);
+            append_ascii(out, buf);
+        } else {
+            if (!call_number_method(cx, "toString", value, 16, &value))
+                return false;
+            str = value.toString();
+        }
+        break;
+
+    case 'f':
+        if (!parse_float(cx, arg, &value))
+            return false;
+        if (spec.precision != -1) {
+            if (!call_number_method(cx, "toFixed", value, spec.precision,
+                                    &value))
+                return false;
+            str = value.toString();
+        } else if (value.isInt32()) {
+            g_snprintf(buf, sizeof(buf), "%d", value.toInt32());
+            append_ascii(out, buf);
+        } else if (!(str = JS::ToString(cx, value))) {
+            return false;
+        }
+        break;
+
+    default:
+        g_assert_not_reached();
+    }
+
+    if (str && !append_string(cx, out, str))
+        return false;
+
+    size_t length = out->length() - start;
+    if (length < spec.width)
+        out->insert(start, spec.width - length, spec.fill_char);
+    return true;
+}
+
+// vprintf(format, args): formats the elements of @args according to @format,
+// as used by String.prototype.format()
+GJS_JSAPI_RETURN_CONVENTION
+static bool vprintf_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!args.requireAtLeast(cx, "vprintf", 1))
+        return false;
+
+    JS::RootedString format(cx, JS::ToString(cx, args[0]));
+    if (!format)
+        return false;
+
+    GjsParsedFormatPtr parsed =
+        GjsContextPrivate::from_cx(cx)->format_cache().get(cx, format);
+    if (!parsed)
+        return false;
+
+    // Nothing to format, not even a "%%"
+    if (parsed->empty() ||
+        (parsed->size() == 1 && !parsed->front().conversion &&
+         parsed->front().literal.length() == JS_GetStringLength(format))) {
+        args.rval().setString(format);
+        return true;
+    }
+
+    std::u16string result;
+    JS::RootedObject arg_list(cx);
+    JS::RootedValue arg(cx);
+    for (const GjsFormatPart& part : *parsed) {
+        if (!part.conversion) {
+            result.append(part.literal);
+            continue;
+        }
+
+        if (!arg_list && !(arg_list = JS::ToObject(cx, args.get(1))))
+            return false;
+        if (!JS_GetElement(cx, arg_list, part.arg_index, &arg) ||
+            !format_conversion(cx, part, arg, &result))
+            return false;
+    }
+
+    JSString* retval = JS_NewUCStringCopyN(cx, result.data(), result.length());
+    if (!retval)
+        return false;
+    args.rval().setString(retval);
+    return true;
+}
+
+static JSFunctionSpec gjs_format_module_funcs[] = {
+    JS_FN("vprintf", vprintf_func, 2, 0), JS_FS_END};
+
+bool gjs_define_format_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    return module && JS_DefineFunctions(cx, module, gjs_format_module_funcs);
+}
@@ -0,0 +1,87 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * SPDX-License-Identifier: MIT OR LGPL-2.0-or-later
+ *
+ * Copyright (c) 2021 The CJS authors
+ */
+
+#ifndef MODULES_FORMAT_H_
+#define MODULES_FORMAT_H_
+
+#include <config.h>
+
+#include <stddef.h>  // for size_t
+
+#include <memory>  // for shared_ptr
+#include <string>
+#include <vector>
+
+#include <js/GCHashTable.h>  // for GCHashMap
+#include <js/GCPolicyAPI.h>  // for IgnoreGCPolicy
+#include <js/Id.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for SystemAllocPolicy
+#include <mozilla/HashFunctions.h>  // for HashGeneric, HashNumber
+
+#include "cjs/macros.h"
+
+class JSTracer;
+
+// One piece of a parsed format string: either literal text, or a conversion
+// specification such as "%2$05d"
+struct GjsFormatPart {
+    std::u16string literal;
+    char16_t conversion;  // 0 for literal text
+    char16_t fill_char;
+    bool alternative;
+    unsigned arg_index;
+    size_t width;
+    int precision;  // -1 if not given
+};
+
+using GjsParsedFormat = std::vector<GjsFormatPart>;
+// Shared, since formatting an argument can run JS code that calls vprintf()
+// again and evicts the entry being used
+using GjsParsedFormatPtr = std::shared_ptr<const GjsParsedFormat>;
+
+namespace JS {
+template <>
+struct GCPolicy<GjsParsedFormatPtr>
+    : public IgnoreGCPolicy<GjsParsedFormatPtr> {};
+}  // namespace JS
+
+// Format strings passed to vprintf() are almost always literals, and a program
+// uses a small set of them, so their parsed form is cached by atom.
+class GjsFormatCache {
+    static constexpr unsigned MAX_ENTRIES = 500;
+
+    struct IdHasher {
+        using Lookup = jsid;
+        // Atoms are never moved by the GC
+        static mozilla::HashNumber hash(jsid id) {
+            return mozilla::HashGeneric(JSID_BITS(id));
+        }
+        static bool match(jsid id1, jsid id2) { return id1 == id2; }
+    };
+
+    using Table = JS::GCHashMap<JS::Heap<jsid>, GjsParsedFormatPtr, IdHasher,
+                                js::SystemAllocPolicy>;
+
+    Table m_table;
+
+ public:
+    // Returns the parsed form of @format, or null with an exception pending
+    // if it could not be parsed
+    GJS_JSAPI_RETURN_CONVENTION
+    GjsParsedFormatPtr get(JSContext* cx, JS::HandleString format);
+
+    void trace(JSTracer* trc) { m_table.trace(trc); }
+    void clear() { m_table.clearAndCompact(); }
+};
+
+// Defines vprintf() for imports.format and String.prototype.format()
+GJS_JSAPI_RETURN_CONVENTION
+bool gjs_define_format_stuff(JSContext* cx, JS::MutableHandleObject module);
+
+#endif  // MODULES_FORMAT_H_
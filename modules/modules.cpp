@@ -25,9 +25,12 @@
 
 #include "cjs/native.h"
 #include "modules/console.h"
+#include "modules/format.h"
 #include "modules/modules.h"
 #include "modules/print.h"
+#include "modules/signals.h"
 #include "modules/system.h"
+#include "modules/tweener.h"
 
 #ifdef ENABLE_CAIRO
 #    include "modules/cairo-module.h"
@@ -41,5 +44,8 @@ gjs_register_static_modules (void)
 #endif
     gjs_register_native_module("system", gjs_js_define_system_stuff);
     gjs_register_native_module("console", gjs_define_console_stuff);
+    gjs_register_native_module("_formatNative", gjs_define_format_stuff);
     gjs_register_native_module("_print", gjs_define_print_stuff);
+    gjs_register_native_module("_signalsNative", gjs_define_signals_stuff);
+    gjs_register_native_module("_tweenerNative", gjs_define_tweener_stuff);
 }
@@ -8,19 +8,32 @@
 
 #include <config.h>
 
+#include <stdio.h>   // for fwrite, fflush, stdout
+#include <stdlib.h>  // for atexit
+#include <string.h>  // for memcpy
+#include <unistd.h>  // for isatty
+
+#include <mutex>
+#include <string>
+
 #include <glib.h>
 
 #include <js/CallArgs.h>
-#include <js/CharacterEncoding.h>  // for JS_EncodeStringToUTF8
+#include <js/CharacterEncoding.h>  // for GetDeflatedUTF8StringLength, ...
 #include <js/Conversions.h>
+#include <js/GCAPI.h>  // for AutoCheckCannotGC
 #include <js/PropertySpec.h>  // for JS_FN, JSFunctionSpec, JS_FS_END
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
 #include <jsapi.h>
+#include <jsfriendapi.h>  // for LinearStringHasLatin1Chars, ...
+#include <mozilla/Span.h>
 
+#include "cjs/context-private.h"
 #include "cjs/jsapi-util.h"
 #include "modules/print.h"
+#include "util/text.h"
 
 // Avoid static_assert in MSVC builds
 namespace JS {
@@ -30,6 +43,112 @@ template <>
 struct GCPolicy<void*> : public IgnoreGCPolicy<void*> {};
 }
 
+// Output of print() in the primary context is collected here and written to
+// stdout in one go, at the end of the main loop iteration, when the buffer is
+// full, or at exit; or after each line if stdout is a terminal, so that it
+// still shows up right away. Anything written to stderr is preceded by a
+// flush, so that the two don't get out of order when they go to the same
+// place. Workers print directly, but they flush the buffer too, so it is
+// guarded by a lock.
+static constexpr size_t STDOUT_BUFFER_MAX = 65536;
+static std::mutex stdout_buffer_lock;
+static std::string stdout_buffer;
+static GSource* stdout_flush_source = nullptr;
+
+// Must be called with stdout_buffer_lock held
+static void flush_locked(void) {
+    if (stdout_buffer.empty())
+        return;
+    fwrite(stdout_buffer.data(), 1, stdout_buffer.size(), stdout);
+    fflush(stdout);
+    stdout_buffer.clear();
+}
+
+void gjs_print_flush(void) {
+    std::lock_guard<std::mutex> lock(stdout_buffer_lock);
+    flush_locked();
+}
+
+static gboolean on_flush_source_dispatch(GSource* source, GSourceFunc,
+                                         void*) {
+    g_source_set_ready_time(source, -1);
+    gjs_print_flush();
+    return G_SOURCE_CONTINUE;
+}
+
+// Adds @output to the buffer, and flushes it now or at the end of the main loop
+// iteration. Only called on the primary context's thread.
+static void buffer_output(GjsContextPrivate* gjs, const std::string& output) {
+    static bool stdout_is_tty = isatty(fileno(stdout));
+    {
+        std::lock_guard<std::mutex> lock(stdout_buffer_lock);
+        stdout_buffer.append(output);
+        if (stdout_is_tty || stdout_buffer.size() >= STDOUT_BUFFER_MAX) {
+            flush_locked();
+            return;
+        }
+    }
+
+    if (!stdout_flush_source) {
+        static GSourceFuncs source_funcs = {
+            nullptr,  // prepare; the ready time is enough
+            nullptr,  // check
+            &on_flush_source_dispatch,
+            nullptr,  // finalize
+            nullptr,  // closure_callback
+            nullptr,  // closure_marshal
+        };
+        static bool flushes_at_exit = false;
+        if (!flushes_at_exit) {
+            atexit(gjs_print_flush);
+            flushes_at_exit = true;
+        }
+
+        stdout_flush_source = g_source_new(&source_funcs, sizeof(GSource));
+        g_source_set_name(stdout_flush_source, "GJS print() flush");
+        g_source_attach(stdout_flush_source, gjs->main_context());
+    }
+    g_source_set_ready_time(stdout_flush_source, 0);
+}
+
+void gjs_print_shutdown(void) {
+    gjs_print_flush();
+    if (stdout_flush_source) {
+        g_source_destroy(stdout_flush_source);
+        g_clear_pointer(&stdout_flush_source, g_source_unref);
+    }
+}
+
+// Appends @str to @out as UTF-8. ASCII strings, the most common by far, are
+// copied as they are; others are encoded straight into @out, without an
+// intermediate copy.
+GJS_JSAPI_RETURN_CONVENTION
+static bool append_string(JSContext* cx, JSString* str, std::string* out) {
+    JSLinearString* linear = JS_EnsureLinearString(cx, str);
+    if (!linear)
+        return false;
+
+    JS::AutoCheckCannotGC nogc;
+    size_t offset = out->size();
+
+    if (js::LinearStringHasLatin1Chars(linear)) {
+        size_t length = js::GetLinearStringLength(linear);
+        auto* chars = reinterpret_cast<const char*>(
+            js::GetLatin1LinearStringChars(nogc, linear));
+        if (gjs_text_is_ascii(chars, length)) {
+            out->append(chars, length);
+            return true;
+        }
+    }
+
+    size_t length = JS::GetDeflatedUTF8StringLength(linear);
+    out->resize(offset + length);
+    size_t written = JS::DeflateStringToUTF8Buffer(
+        linear, mozilla::Span<char>(&(*out)[offset], length));
+    out->resize(offset + written);
+    return true;
+}
+
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_log(JSContext* cx, unsigned argc, JS::Value* vp) {
     JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
@@ -45,6 +164,8 @@ static bool gjs_log(JSContext* cx, unsigned argc, JS::Value* vp) {
     JS::RootedString jstr(cx, JS::ToString(cx, argv[0]));
     exc_state.restore();
 
+    gjs_print_flush();
+
     if (!jstr) {
         g_message("JS LOG: <cannot convert value to string>");
         return true;
@@ -81,41 +202,46 @@ static bool gjs_log_error(JSContext* cx, unsigned argc, JS::Value* vp) {
         exc_state.restore();
     }
 
+    gjs_print_flush();
     gjs_log_exception_full(cx, argv[0], jstr, G_LOG_LEVEL_WARNING);
 
     argv.rval().setUndefined();
     return true;
 }
 
+// Appends the arguments, separated by spaces, and a newline to @out
 GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_print_parse_args(JSContext* cx, const JS::CallArgs& argv,
-                                 GjsAutoChar* buffer) {
-    GString* str = g_string_new("");
+                                 std::string* out) {
+    // Fast path for the common print(string)
+    if (argv.length() == 1 && argv[0].isString()) {
+        if (!append_string(cx, argv[0].toString(), out))
+            return false;
+        out->push_back('\n');
+        return true;
+    }
+
+    size_t offset = out->size();
+    JS::RootedString jstr(cx);
     for (unsigned n = 0; n < argv.length(); ++n) {
         /* JS::ToString might throw, in which case we will only log that the
          * value could not be converted to string */
         JS::AutoSaveExceptionState exc_state(cx);
-        JS::RootedString jstr(cx, JS::ToString(cx, argv[n]));
+        jstr = JS::ToString(cx, argv[n]);
         exc_state.restore();
 
-        if (jstr) {
-            JS::UniqueChars s(JS_EncodeStringToUTF8(cx, jstr));
-            if (!s) {
-                g_string_free(str, true);
-                return false;
-            }
-
-            g_string_append(str, s.get());
-            if (n < (argv.length() - 1))
-                g_string_append_c(str, ' ');
-        } else {
-            *buffer = g_string_free(str, true);
-            if (!*buffer)
-                *buffer = g_strdup("<invalid string>");
+        if (!jstr) {
+            out->resize(offset);
+            out->append("<invalid string>\n");
             return true;
         }
+
+        if (!append_string(cx, jstr, out))
+            return false;
+        if (n < (argv.length() - 1))
+            out->push_back(' ');
     }
-    *buffer = g_string_free(str, false);
+    out->push_back('\n');
 
     return true;
 }
@@ -124,11 +250,22 @@ GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_print(JSContext* context, unsigned argc, JS::Value* vp) {
     JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
 
-    GjsAutoChar buffer;
+    GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
+    if (!gjs->is_primary()) {
+        std::string buffer;
+        if (!gjs_print_parse_args(context, argv, &buffer))
+            return false;
+        g_print("%s", buffer.c_str());
+        argv.rval().setUndefined();
+        return true;
+    }
+
+    // Not parsed straight into the buffer, because converting the arguments
+    // to strings can run JS code that flushes it
+    std::string buffer;
     if (!gjs_print_parse_args(context, argv, &buffer))
         return false;
-
-    g_print("%s\n", buffer.get());
+    buffer_output(gjs, buffer);
 
     argv.rval().setUndefined();
     return true;
@@ -138,11 +275,12 @@ GJS_JSAPI_RETURN_CONVENTION
 static bool gjs_printerr(JSContext* context, unsigned argc, JS::Value* vp) {
     JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
 
-    GjsAutoChar buffer;
+    std::string buffer;
     if (!gjs_print_parse_args(context, argv, &buffer))
         return false;
 
-    g_printerr("%s\n", buffer.get());
+    gjs_print_flush();
+    g_printerr("%s", buffer.c_str());
 
     argv.rval().setUndefined();
     return true;
@@ -17,4 +17,11 @@
 GJS_JSAPI_RETURN_CONVENTION
 bool gjs_define_print_stuff(JSContext* context, JS::MutableHandleObject module);
 
+// Writes out what print() has buffered, for code that writes to stdout itself
+void gjs_print_flush(void);
+
+// Writes out what print() has buffered, and stops flushing it from the main
+// loop until the next print()
+void gjs_print_shutdown(void);
+
 #endif  // MODULES_PRINT_H_
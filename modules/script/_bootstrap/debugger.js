@@ -1,4 +1,4 @@
-/* global debuggee, quit, loadNative, readline, uneval */
+/* global debuggee, attachedOnDemand, quit, loadNative, readline, uneval */
 /* -*- indent-tabs-mode: nil; js-indent-level: 4 -*-
  *
  * This Source Code Form is subject to the terms of the Mozilla Public
@@ -14,6 +14,11 @@
  * To run it: gjs -d path/to/file.js
  * Execution will stop at debugger statements, and you'll get a prompt before
  * the first frame is executed.
+ *
+ * It can also be attached to a running program, see
+ * gjs_context_attach_debugger_console(). Then you get a prompt right away, and
+ * the debugger only stops at breakpoints and debugger statements, so that the
+ * rest of the program keeps running as fast as before.
  */
 
 const {print, logError} = loadNative('_print');
@@ -287,7 +292,8 @@ detachCommand.helpText = `USAGE
     detach`;
 
 function continueCommand() {
-    if (focusedFrame === null) {
+    // When attached to a running program, this returns to its main loop
+    if (focusedFrame === null && !attachedOnDemand) {
         print('No stack.');
         return;
     }
@@ -548,12 +554,18 @@ untilCommand.helpText = `USAGE
 PARAMETER
     · line_num: line_num to continue until`;
 
-function findBreakpointOffsets(line, currentScript) {
-    const offsets = currentScript.getLineOffsets(line);
-    if (offsets.length !== 0)
-        return [{script: currentScript, offsets}];
+function findBreakpointOffsets(line, currentScript, file) {
+    let scripts;
+    if (file) {
+        scripts = dbg.findScripts({line})
+            .filter(script => script.url && script.url.endsWith(file));
+    } else {
+        const offsets = currentScript.getLineOffsets(line);
+        if (offsets.length !== 0)
+            return [{script: currentScript, offsets}];
 
-    const scripts = dbg.findScripts({line, url: currentScript.url});
+        scripts = dbg.findScripts({line, url: currentScript.url});
+    }
     if (scripts.length === 0)
         return [];
 
@@ -583,10 +595,17 @@ class BreakpointHandler {
 }
 
 function breakpointCommand(where) {
-    // Only handles line numbers of the current file
-    // TODO: make it handle function names and other files
-    const line = Number(where);
-    const possibleOffsets = findBreakpointOffsets(line, focusedFrame.script);
+    // Handles line numbers of the current file, or file:line
+    // TODO: make it handle function names
+    const separator = where.lastIndexOf(':');
+    const file = separator === -1 ? null : where.slice(0, separator);
+    const line = Number(where.slice(separator + 1));
+    if (!file && focusedFrame === null) {
+        print('No stack; use file:line_num to give the file.');
+        return;
+    }
+    const possibleOffsets = findBreakpointOffsets(line,
+        focusedFrame && focusedFrame.script, file);
 
     if (possibleOffsets.length === 0) {
         print(`Unable to break at line ${where}`);
@@ -604,9 +623,11 @@ function breakpointCommand(where) {
 }
 breakpointCommand.summary = 'Set breakpoint at the specified location.';
 breakpointCommand.helpText = `USAGE
-    break <line_num>
+    break [<file>:]<line_num>
 
 PARAMETERS
+    · file: end of the file name or URI to place a breakpoint in, if not the
+      current one.
     · line_num: line number to place a breakpoint at.`;
 
 function deleteCommand(breaknum) {
@@ -813,28 +834,6 @@ function onInitialEnterFrame(frame) {
 }
 
 var dbg = new Debugger();
-dbg.onNewPromise = function ({promiseID, promiseAllocationSite}) {
-    const site = promiseAllocationSite.toString().split('\n')[0];
-    print(`Promise ${promiseID} started from ${site}`);
-    return undefined;
-};
-dbg.onPromiseSettled = function (promise) {
-    let message = `Promise ${promise.promiseID} ${promise.promiseState} `;
-    message += `after ${promise.promiseTimeToResolution.toFixed(3)} ms`;
-    let brief, full;
-    if (promise.promiseState === 'fulfilled' && typeof promise.promiseValue !== 'undefined') {
-        [brief, full] = debuggeeValueToString(promise.promiseValue);
-        message += ` with ${brief}`;
-    } else if (promise.promiseState === 'rejected' &&
-               typeof promise.promiseReason !== 'undefined') {
-        [brief, full] = debuggeeValueToString(promise.promiseReason);
-        message += ` with ${brief}`;
-    }
-    print(message);
-    if (full !== undefined)
-        print(full);
-    return undefined;
-};
 dbg.onDebuggerStatement = function (frame) {
     return saveExcursion(() => {
         topFrame = focusedFrame = frame;
@@ -842,17 +841,49 @@ dbg.onDebuggerStatement = function (frame) {
         return repl();
     });
 };
-dbg.onExceptionUnwind = function (frame, value) {
-    return saveExcursion(() => {
-        topFrame = focusedFrame = frame;
-        print("Unwinding due to exception. (Type 'c' to continue unwinding.)");
-        showFrame();
-        print('Exception value is:');
-        showDebuggeeValue(value);
-        return repl();
-    });
-};
+
+// Hooks that observe all promises and exceptions make the program's code run
+// without optimizations, so they are left out when attached on demand
+if (!attachedOnDemand) {
+    dbg.onNewPromise = function ({promiseID, promiseAllocationSite}) {
+        const site = promiseAllocationSite.toString().split('\n')[0];
+        print(`Promise ${promiseID} started from ${site}`);
+        return undefined;
+    };
+    dbg.onPromiseSettled = function (promise) {
+        let message = `Promise ${promise.promiseID} ${promise.promiseState} `;
+        message += `after ${promise.promiseTimeToResolution.toFixed(3)} ms`;
+        let brief, full;
+        if (promise.promiseState === 'fulfilled' && typeof promise.promiseValue !== 'undefined') {
+            [brief, full] = debuggeeValueToString(promise.promiseValue);
+            message += ` with ${brief}`;
+        } else if (promise.promiseState === 'rejected' &&
+                   typeof promise.promiseReason !== 'undefined') {
+            [brief, full] = debuggeeValueToString(promise.promiseReason);
+            message += ` with ${brief}`;
+        }
+        print(message);
+        if (full !== undefined)
+            print(full);
+        return undefined;
+    };
+    dbg.onExceptionUnwind = function (frame, value) {
+        return saveExcursion(() => {
+            topFrame = focusedFrame = frame;
+            print("Unwinding due to exception. (Type 'c' to continue unwinding.)");
+            showFrame();
+            print('Exception value is:');
+            showDebuggeeValue(value);
+            return repl();
+        });
+    };
+}
 
 var debuggeeGlobalWrapper = dbg.addDebuggee(debuggee);
 
-setUntilRepl(dbg, 'onEnterFrame', onInitialEnterFrame);
+if (attachedOnDemand) {
+    print('GJS debugger attached. Type "help" for help, "cont" to resume');
+    repl();
+} else {
+    setUntilRepl(dbg, 'onEnterFrame', onInitialEnterFrame);
+}
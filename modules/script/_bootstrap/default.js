@@ -3,6 +3,41 @@
 
     const {print, printerr, log, logError} = imports._print;
 
+    // Most scripts never use these, so only load them when first accessed
+    function defineLazyGlobal(name, moduleName) {
+        Object.defineProperty(exports, name, {
+            configurable: true,
+            enumerable: false,
+            get() {
+                const value = imports[moduleName][name];
+                Object.defineProperty(exports, name, {
+                    configurable: true,
+                    enumerable: false,
+                    writable: true,
+                    value,
+                });
+                return value;
+            },
+            set(value) {
+                Object.defineProperty(exports, name, {
+                    configurable: true,
+                    enumerable: false,
+                    writable: true,
+                    value,
+                });
+            },
+        });
+    }
+
+    defineLazyGlobal('TextEncoder', '_encoding');
+    defineLazyGlobal('TextDecoder', '_encoding');
+    defineLazyGlobal('setTimeout', '_timers');
+    defineLazyGlobal('setInterval', '_timers');
+    defineLazyGlobal('clearTimeout', '_timers');
+    defineLazyGlobal('clearInterval', '_timers');
+    defineLazyGlobal('Worker', '_worker');
+    defineLazyGlobal('performance', '_performance');
+
     Object.defineProperties(exports, {
         print: {
             configurable: false,
@@ -531,8 +531,12 @@ function defineGObjectLegacyObjects(GObject) {
 
             propertiesArray.forEach(pspec => _checkAccessors(params, pspec, GObject));
 
+            // Signals are created in the same native call
+            let signals = params.Signals || null;
+            delete params.Signals;
+
             let newClass = Gi.register_type(parent.prototype, gtypename,
-                gflags, gobjectInterfaces, propertiesArray);
+                gflags, gobjectInterfaces, propertiesArray, signals);
 
             // See Class.prototype._construct for the reasoning
             // behind this direct prototype set.
@@ -604,8 +608,11 @@ function defineGObjectLegacyObjects(GObject) {
         let properties = _propertiesAsArray(params);
         delete params.Properties;
 
+        let signals = params.Signals || null;
+        delete params.Signals;
+
         let newInterface = Gi.register_interface(gtypename, gobjectInterfaces,
-            properties);
+            properties, signals);
 
         // See Class.prototype._construct for the reasoning
         // behind this direct prototype set.
@@ -2,7 +2,7 @@
 
 /* exported format, printf, vprintf */
 
-var {vprintf} = imports._format;
+var {vprintf} = imports._formatNative;
 
 function printf(fmt, ...args) {
     print(vprintf(fmt, args));
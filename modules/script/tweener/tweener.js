@@ -42,8 +42,10 @@ setFrameTicker, setTimeScale */
 
 const GLib = imports.gi.GLib;
 
+const Equations = imports.tweener.equations;
 const TweenList = imports.tweener.tweenList;
 const Signals = imports.signals;
+const Native = imports._tweenerNative;
 
 var _inited = false;
 var _engineExists = false;
@@ -55,6 +57,11 @@ var _specialPropertyList = [];
 var _specialPropertyModifierList = [];
 var _specialPropertySplitterList = [];
 
+// Built-in equations that PropertyTween can evaluate natively, by their index
+// in Native.EASINGS
+var _nativeEasings = new Map(Native.EASINGS.map((name, ix) => [Equations[name], ix]));
+_nativeEasings.set(Equations.linear, _nativeEasings.get(Equations.easeNone));
+
 /*
  * Ticker should implement:
  *
@@ -212,6 +219,28 @@ function _callOnFunction(fn, fnname, scope, fallbackScope, params) {
     }
 }
 
+// A tween of plain numeric properties with one of the built-in equations can
+// be updated natively; anything else (custom transitions, special properties,
+// modifiers) is updated property by property below. Returns null if the tween
+// can't be updated natively.
+function _makeNativeTween(tweening) {
+    var easing = _nativeEasings.get(tweening.transition);
+    if (easing === undefined || typeof tweening.scope !== 'object')
+        return null;
+
+    var properties = Object.entries(tweening.properties);
+    if (properties.some(([, property]) => property.isSpecialProperty ||
+        property.hasModifier || typeof property.valueStart !== 'number' ||
+        typeof property.valueComplete !== 'number'))
+        return null;
+
+    var nativeTween = new Native.PropertyTween(tweening.scope, easing,
+        tweening.transitionParams);
+    properties.forEach(([name, property]) =>
+        nativeTween.add(name, property.valueStart, property.valueComplete));
+    return nativeTween;
+}
+
 function _updateTweenByIndex(i) {
     var tweening = _tweenList[i];
 
@@ -286,7 +315,16 @@ function _updateTweenByIndex(i) {
             tweening.hasStarted = true;
         }
 
-        if (mustUpdate) {
+        if (mustUpdate && tweening.nativeTween === undefined)
+            tweening.nativeTween = _makeNativeTween(tweening);
+
+        if (mustUpdate && tweening.nativeTween) {
+            // Set all the properties in one go
+            d = tweening.timeComplete - tweening.timeStart;
+            t = isOver ? d : currentTime - tweening.timeStart;
+            tweening.nativeTween.update(t, d, Boolean(tweening.rounded),
+                tweening.min, tweening.max);
+        } else if (mustUpdate) {
             for (name in tweening.properties) {
                 var property = tweening.properties[name];
 
@@ -324,7 +362,9 @@ function _updateTweenByIndex(i) {
                     scope[name] = nv;
                 }
             }
+        }
 
+        if (mustUpdate) {
             tweening.updatesSkipped = 0;
 
             _callOnFunction(tweening.onUpdate, 'onUpdate', tweening.onUpdateScope,
@@ -652,6 +692,7 @@ function removeTweensByTime(scope, properties, timeStart, timeComplete) {
 
                     _tweenList[i].properties[name] = undefined;
                     delete _tweenList[i].properties[name];
+                    _tweenList[i].nativeTween = undefined;
                     removedLocally = true;
                     removed = true;
                 }
@@ -688,6 +729,7 @@ function _splitTweens(tween, properties) {
         if (originalTween.properties[name]) {
             originalTween.properties[name] = undefined;
             delete originalTween.properties[name];
+            originalTween.nativeTween = undefined;
         }
     }
 
@@ -704,6 +746,7 @@ function _splitTweens(tween, properties) {
         if (!found) {
             newTween.properties[name] = undefined;
             delete newTween.properties[name];
+            newTween.nativeTween = undefined;
         }
     }
 
@@ -0,0 +1,389 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <utility>  // for move
+#include <vector>
+
+#include <glib.h>
+
+#include <js/Array.h>  // for NewArrayObject
+#include <js/CallArgs.h>
+#include <js/Class.h>
+#include <js/GCVector.h>  // for RootedVector
+#include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars
+#include <js/Value.h>
+#include <js/ValueArray.h>
+#include <jsapi.h>  // for JS_GetElement, JS_SetElement, JS::Call, ...
+
+#include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "modules/signals.h"
+
+/* SignalConnections holds the handlers connected with the addSignalMethods()
+ * mixin from imports.signals. Handlers live in slots; each signal name has a
+ * doubly linked list through its slots, and a map from handler ID to slot makes
+ * disconnecting O(1). The callbacks themselves are kept in a JS array in a
+ * reserved slot, at the same index as their slot, so the GC sees them.
+ *
+ * Emission doesn't copy the handler list. Handlers connected during an emission
+ * have IDs newer than the last one at the start of the emission, and are
+ * skipped; slots of handlers disconnected during an emission are not reused
+ * until all emissions are finished, so the list can still be walked from
+ * them. */
+
+enum : unsigned { CALLBACKS_SLOT = 0 };
+
+class GjsSignalConnections {
+    struct HandlerList {
+        int32_t first = -1;
+        int32_t last = -1;
+    };
+
+    struct Handler {
+        uint32_t id;  // 0 if disconnected
+        HandlerList* list;
+        int32_t prev;
+        int32_t next;
+    };
+
+    std::vector<Handler> m_handlers;
+    // Lists are never removed, so that Handler::list stays valid
+    std::unordered_map<std::string, HandlerList> m_lists;
+    std::unordered_map<uint32_t, uint32_t> m_slot_for_id;
+    std::vector<uint32_t> m_free_slots;
+    std::vector<uint32_t> m_disconnected_while_emitting;
+    uint32_t m_next_id = 1;
+    unsigned m_emission_depth = 0;
+
+    class AutoEmission {
+        GjsSignalConnections* m_self;
+
+     public:
+        explicit AutoEmission(GjsSignalConnections* self) : m_self(self) {
+            m_self->m_emission_depth++;
+        }
+        ~AutoEmission() {
+            if (--m_self->m_emission_depth > 0)
+                return;
+            for (uint32_t slot : m_self->m_disconnected_while_emitting)
+                m_self->m_free_slots.push_back(slot);
+            m_self->m_disconnected_while_emitting.clear();
+        }
+    };
+
+ public:
+    [[nodiscard]] size_t size() const { return m_slot_for_id.size(); }
+
+    [[nodiscard]] bool is_connected(uint32_t id) const {
+        return m_slot_for_id.count(id) > 0;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool connect(JSContext* cx, JS::HandleObject callbacks, std::string name,
+                 JS::HandleObject callback, uint32_t* id_out) {
+        uint32_t slot;
+        if (m_free_slots.empty()) {
+            slot = m_handlers.size();
+            m_handlers.emplace_back();
+        } else {
+            slot = m_free_slots.back();
+            m_free_slots.pop_back();
+        }
+        if (!JS_SetElement(cx, callbacks, slot, callback)) {
+            m_free_slots.push_back(slot);
+            return false;
+        }
+
+        HandlerList* list = &m_lists[std::move(name)];
+        m_handlers[slot] = {m_next_id, list, list->last, -1};
+        if (list->last >= 0)
+            m_handlers[list->last].next = slot;
+        else
+            list->first = slot;
+        list->last = slot;
+
+        m_slot_for_id.emplace(m_next_id, slot);
+        *id_out = m_next_id++;
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool disconnect(JSContext* cx, JS::HandleObject callbacks, uint32_t id) {
+        auto found = m_slot_for_id.find(id);
+        if (found == m_slot_for_id.end()) {
+            gjs_throw(cx, "No signal connection %u found", id);
+            return false;
+        }
+        uint32_t slot = found->second;
+        m_slot_for_id.erase(found);
+
+        // Leave the handler's own next pointer alone, in case an emission is
+        // currently at this handler
+        Handler& handler = m_handlers[slot];
+        if (handler.prev >= 0)
+            m_handlers[handler.prev].next = handler.next;
+        else
+            handler.list->first = handler.next;
+        if (handler.next >= 0)
+            m_handlers[handler.next].prev = handler.prev;
+        else
+            handler.list->last = handler.prev;
+        handler.id = 0;
+
+        if (m_emission_depth > 0)
+            m_disconnected_while_emitting.push_back(slot);
+        else
+            m_free_slots.push_back(slot);
+
+        return JS_SetElement(cx, callbacks, slot, JS::UndefinedHandleValue);
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool disconnect_all(JSContext* cx, JS::HandleObject callbacks) {
+        std::vector<uint32_t> ids;
+        ids.reserve(m_slot_for_id.size());
+        for (const auto& id_and_slot : m_slot_for_id)
+            ids.push_back(id_and_slot.first);
+        for (uint32_t id : ids) {
+            if (!disconnect(cx, callbacks, id))
+                return false;
+        }
+        return true;
+    }
+
+    /* Calls the handlers of @name with @args, stopping early if one returns
+     * true. Exceptions from handlers are logged, and don't stop the emission;
+     * only uncatchable errors are propagated. */
+    GJS_JSAPI_RETURN_CONVENTION
+    bool emit(JSContext* cx, JS::HandleObject callbacks, const char* name,
+              const JS::HandleValueArray& args) {
+        auto found = m_lists.find(name);
+        if (found == m_lists.end())
+            return true;
+
+        AutoEmission emission(this);
+        uint32_t last_id = m_next_id - 1;
+        JS::RootedValue callback(cx), retval(cx);
+
+        // m_handlers may be reallocated by the handlers, so index it anew
+        // after each call
+        for (int32_t slot = found->second.first; slot >= 0;
+             slot = m_handlers[slot].next) {
+            uint32_t id = m_handlers[slot].id;
+            if (id == 0 || id > last_id)
+                continue;
+
+            if (!JS_GetElement(cx, callbacks, slot, &callback))
+                return false;
+            if (JS::Call(cx, JS::NullHandleValue, callback, args, &retval)) {
+                if (retval.isTrue())
+                    break;
+                continue;
+            }
+
+            JS::RootedValue exc(cx);
+            if (!JS_GetPendingException(cx, &exc))
+                return false;
+            JS_ClearPendingException(cx);
+
+            GjsAutoChar message =
+                g_strdup_printf("Exception in callback for signal: %s", name);
+            JS::RootedValue message_val(cx);
+            if (!gjs_string_from_utf8(cx, message, &message_val))
+                return false;
+            JS::RootedString message_str(cx, message_val.toString());
+            gjs_log_exception_full(cx, exc, message_str, G_LOG_LEVEL_WARNING);
+        }
+        return true;
+    }
+};
+
+[[nodiscard]] static JSObject* gjs_signal_connections_get_proto(JSContext*);
+
+GJS_DEFINE_PROTO("SignalConnections", signal_connections,
+                 JSCLASS_HAS_RESERVED_SLOTS(1) | JSCLASS_FOREGROUND_FINALIZE)
+GJS_DEFINE_PRIV_FROM_JS(GjsSignalConnections, gjs_signal_connections_class)
+
+GJS_NATIVE_CONSTRUCTOR_DECLARE(signal_connections) {
+    GJS_NATIVE_CONSTRUCTOR_VARIABLES(signal_connections)
+    GJS_NATIVE_CONSTRUCTOR_PRELUDE(signal_connections);
+
+    if (!gjs_parse_call_args(context, "SignalConnections", argv, ""))
+        return false;
+
+    JSObject* callbacks = JS::NewArrayObject(context, 0);
+    if (!callbacks)
+        return false;
+    JS_SetReservedSlot(object, CALLBACKS_SLOT, JS::ObjectValue(*callbacks));
+    JS_SetPrivate(object, new GjsSignalConnections());
+
+    GJS_NATIVE_CONSTRUCTOR_FINISH(signal_connections);
+    return true;
+}
+
+static void gjs_signal_connections_finalize(JSFreeOp*, JSObject* obj) {
+    delete static_cast<GjsSignalConnections*>(JS_GetPrivate(obj));
+    JS_SetPrivate(obj, nullptr);
+}
+
+#define GET_CALLBACKS(obj, callbacks) \
+    JS::RootedObject callbacks(       \
+        cx, &JS_GetReservedSlot(obj, CALLBACKS_SLOT).toObject())
+
+// connect(name, callback) -> handler ID
+GJS_JSAPI_RETURN_CONVENTION
+static bool connect_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsSignalConnections, priv);
+    JS::UniqueChars name;
+    JS::RootedObject callback(cx);
+    if (!gjs_parse_call_args(cx, "connect", args, "so", "name", &name,
+                             "callback", &callback))
+        return false;
+
+    // be paranoid about the callback since we'd start to throw from emit()
+    // if it was messed up
+    if (!JS::IsCallable(callback)) {
+        gjs_throw(cx,
+                  "When connecting signal must give a callback that is a "
+                  "function");
+        return false;
+    }
+
+    GET_CALLBACKS(obj, callbacks);
+    uint32_t id;
+    if (!priv->connect(cx, callbacks, name.get(), callback, &id))
+        return false;
+    args.rval().setNumber(id);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool disconnect_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsSignalConnections, priv);
+    uint32_t id;
+    if (!gjs_parse_call_args(cx, "disconnect", args, "u", "id", &id))
+        return false;
+
+    GET_CALLBACKS(obj, callbacks);
+    args.rval().setUndefined();
+    return priv->disconnect(cx, callbacks, id);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool disconnect_all_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsSignalConnections, priv);
+    GET_CALLBACKS(obj, callbacks);
+    args.rval().setUndefined();
+    return priv->disconnect_all(cx, callbacks);
+}
+
+// emit(emitter, name, ...args)
+GJS_JSAPI_RETURN_CONVENTION
+static bool emit_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsSignalConnections, priv);
+    if (!args.requireAtLeast(cx, "emit", 2))
+        return false;
+
+    args.rval().setUndefined();
+    // Only strings can be connected to
+    if (!args[1].isString())
+        return true;
+    JS::UniqueChars name = gjs_string_to_utf8(cx, args[1]);
+    if (!name)
+        return false;
+
+    /* The handlers are called with the emitter followed by the rest of the
+     * arguments, to be consistent with GObject signals. Passing the emitter
+     * also means that handlers don't need closures over it, which would make
+     * cycles. */
+    JS::RootedValueVector handler_args(cx);
+    if (!handler_args.reserve(args.length() - 1)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    handler_args.infallibleAppend(args[0]);
+    for (unsigned ix = 2; ix < args.length(); ix++)
+        handler_args.infallibleAppend(args[ix]);
+
+    GET_CALLBACKS(obj, callbacks);
+    return priv->emit(cx, callbacks, name.get(), handler_args);
+}
+
+// isConnected(id) -> boolean
+GJS_JSAPI_RETURN_CONVENTION
+static bool is_connected_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsSignalConnections, priv);
+    // Anything that isn't a handler ID is simply not connected
+    double id = args.get(0).isNumber() ? args[0].toNumber() : 0;
+    args.rval().setBoolean(id >= 1 && id <= UINT32_MAX &&
+                           id == uint32_t(id) &&
+                           priv->is_connected(uint32_t(id)));
+    return true;
+}
+
+// length -> number of connected handlers
+GJS_JSAPI_RETURN_CONVENTION
+static bool get_length_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsSignalConnections, priv);
+    args.rval().setNumber(double(priv->size()));
+    return true;
+}
+
+#undef GET_CALLBACKS
+
+// clang-format off
+JSPropertySpec gjs_signal_connections_proto_props[] = {
+    JS_PSG("length", get_length_func, JSPROP_PERMANENT),
+    JS_STRING_SYM_PS(toStringTag, "SignalConnections", JSPROP_READONLY),
+    JS_PS_END};
+// clang-format on
+
+JSFunctionSpec gjs_signal_connections_proto_funcs[] = {
+    JS_FN("connect", connect_func, 2, 0),
+    JS_FN("disconnect", disconnect_func, 1, 0),
+    JS_FN("disconnectAll", disconnect_all_func, 0, 0),
+    JS_FN("emit", emit_func, 2, 0),
+    JS_FN("isConnected", is_connected_func, 1, 0),
+    JS_FS_END};
+
+JSFunctionSpec gjs_signal_connections_static_funcs[] = {JS_FS_END};
+
+bool gjs_define_signals_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    if (!module)
+        return false;
+    JS::RootedObject proto(cx);
+    return gjs_signal_connections_define_proto(cx, module, &proto);
+}
@@ -26,27 +26,52 @@
 
 #include <errno.h>
 #include <stdio.h>   // for FILE, fclose, stdout
-#include <string.h>  // for strerror
-#include <time.h>    // for tzset
+#include <string.h>  // for strcmp, strerror, memchr
+#include <sys/types.h>  // for ssize_t
+#include <time.h>       // for tzset
 
+#ifndef _WIN32
+#    include <fcntl.h>       // for fcntl, FD_CLOEXEC
+#    include <sys/socket.h>  // for socketpair
+#    include <unistd.h>      // for close
+#endif
+
+#include <algorithm>  // for max
+#include <memory>     // for unique_ptr
+#include <utility>    // for exchange
+
+#include <gio/gio.h>  // for GTask, GSubprocess
 #include <glib-object.h>
 #include <glib.h>
 
+#include <js/Array.h>               // for IsArrayObject, GetArrayLength
+#include <js/ArrayBuffer.h>         // for GetArrayBufferLengthAndData
 #include <js/CallArgs.h>
+#include <js/Conversions.h>         // for ToBoolean, ToNumber
 #include <js/Date.h>                // for ResetTimeZone
-#include <js/GCAPI.h>               // for JS_GC
+#include <js/GCAPI.h>               // for JS_GC, JS_GetGCParameter
 #include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
+#include <js/Promise.h>
 #include <js/PropertySpec.h>
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars
+#include <js/ValueArray.h>
 #include <jsapi.h>        // for JS_DefinePropertyById, JS_DefineF...
-#include <jsfriendapi.h>  // for DumpHeap, IgnoreNurseryObjects
+#include <jsfriendapi.h>  // for DumpHeap, GetArrayBufferViewLengthAndData
 
+#include "gi/arg.h"  // for gjs_array_to_strv
+#include "gi/function.h"
 #include "gi/object.h"
+#include "gi/repo.h"
 #include "cjs/atoms.h"
+#include "cjs/byteArray.h"
 #include "cjs/context-private.h"
+#include "cjs/heap-snapshot.h"
 #include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-util.h"
+#include "cjs/mem-private.h"
+#include "cjs/profiler-private.h"
 #include "modules/system.h"
 #include "util/log.h"
 
@@ -134,21 +159,47 @@ gjs_dump_heap(JSContext *cx,
 {
     JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
     GjsAutoChar filename;
+    JS::UniqueChars format;
 
-    if (!gjs_parse_call_args(cx, "dumpHeap", args, "|F", "filename", &filename))
+    if (!gjs_parse_call_args(cx, "dumpHeap", args, "|?Fs", "filename",
+                             &filename, "format", &format))
         return false;
 
+    bool snapshot = false;
+    if (format) {
+        if (strcmp(format.get(), "snapshot") == 0) {
+            snapshot = true;
+        } else if (strcmp(format.get(), "text") != 0) {
+            gjs_throw(cx, "Unknown heap dump format '%s'", format.get());
+            return false;
+        }
+    }
+
+    FILE* fp = stdout;
     if (filename) {
-        FILE *fp = fopen(filename, "a");
+        fp = fopen(filename, snapshot ? "ab" : "a");
         if (!fp) {
             gjs_throw(cx, "Cannot dump heap to %s: %s", filename.get(),
                       strerror(errno));
             return false;
         }
+    }
+
+    bool ok = true;
+    if (snapshot)
+        ok = gjs_heap_snapshot_write(cx, fp);
+    else
         js::DumpHeap(cx, fp, js::IgnoreNurseryObjects);
+
+    if (fp != stdout)
         fclose(fp);
-    } else {
-        js::DumpHeap(cx, stdout, js::IgnoreNurseryObjects);
+    else
+        fflush(fp);
+
+    if (!ok) {
+        gjs_throw(cx, "Cannot dump heap to %s",
+                  filename ? filename.get() : "stdout");
+        return false;
     }
 
     gjs_debug(GJS_DEBUG_CONTEXT, "Heap dumped to %s",
@@ -158,6 +209,154 @@ gjs_dump_heap(JSContext *cx,
     return true;
 }
 
+static bool gjs_dump_function_stats(JSContext* cx, unsigned argc,
+                                    JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsAutoChar filename;
+
+    if (!gjs_parse_call_args(cx, "dumpFunctionStats", args, "|F", "filename",
+                             &filename))
+        return false;
+
+    FILE* fp = stdout;
+    if (filename) {
+        fp = fopen(filename, "a");
+        if (!fp) {
+            gjs_throw(cx, "Cannot dump function statistics to %s: %s",
+                      filename.get(), strerror(errno));
+            return false;
+        }
+    }
+
+    bool enabled = gjs_function_stats_dump(fp);
+    if (filename)
+        fclose(fp);
+
+    if (!enabled) {
+        gjs_throw(cx,
+                  "Function statistics are not being collected; set "
+                  "GJS_PROFILE_FUNCTIONS in the environment to enable them");
+        return false;
+    }
+
+    args.rval().setUndefined();
+    return true;
+}
+
+static bool gjs_dump_typelib_stats(JSContext* cx, unsigned argc,
+                                   JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsAutoChar filename;
+
+    if (!gjs_parse_call_args(cx, "dumpTypelibStats", args, "|F", "filename",
+                             &filename))
+        return false;
+
+    FILE* fp = stdout;
+    if (filename) {
+        fp = fopen(filename, "a");
+        if (!fp) {
+            gjs_throw(cx, "Cannot dump typelib statistics to %s: %s",
+                      filename.get(), strerror(errno));
+            return false;
+        }
+    }
+
+    bool enabled = gjs_typelib_stats_dump(fp);
+    if (filename)
+        fclose(fp);
+
+    if (!enabled) {
+        gjs_throw(cx,
+                  "Typelib statistics are not being collected; set "
+                  "GJS_PROFILE_TYPELIBS in the environment to enable them");
+        return false;
+    }
+
+    args.rval().setUndefined();
+    return true;
+}
+
+static bool gjs_dump_wrapper_stats(JSContext* cx, unsigned argc,
+                                   JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsAutoChar filename;
+
+    if (!gjs_parse_call_args(cx, "dumpWrapperStats", args, "|F", "filename",
+                             &filename))
+        return false;
+
+    FILE* fp = stdout;
+    if (filename) {
+        fp = fopen(filename, "a");
+        if (!fp) {
+            gjs_throw(cx, "Cannot dump wrapper statistics to %s: %s",
+                      filename.get(), strerror(errno));
+            return false;
+        }
+    }
+
+    gjs_object_dump_wrapper_stats(fp);
+    if (filename)
+        fclose(fp);
+
+    args.rval().setUndefined();
+    return true;
+}
+
+static bool gjs_dump_debug_log(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!gjs_parse_call_args(cx, "dumpDebugLog", args, ""))
+        return false;
+
+    gjs_debug_flush_ring();
+
+    args.rval().setUndefined();
+    return true;
+}
+
+static bool gjs_memory_usage(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!gjs_parse_call_args(cx, "memoryUsage", args, ""))
+        return false;
+
+    JS::RootedObject objects(cx, JS_NewPlainObject(cx));
+    JS::RootedObject native_bytes(cx, JS_NewPlainObject(cx));
+    JS::RootedObject retval(cx, JS_NewPlainObject(cx));
+    if (!objects || !native_bytes || !retval)
+        return false;
+
+#define DEFINE_OBJECT_COUNT(name)                                    \
+    if (!JS_DefineProperty(cx, objects, #name, GJS_GET_COUNTER(name), \
+                           JSPROP_ENUMERATE))                        \
+        return false;
+    GJS_FOR_EACH_COUNTER(DEFINE_OBJECT_COUNT)
+    DEFINE_OBJECT_COUNT(callback_trampoline)
+#undef DEFINE_OBJECT_COUNT
+
+    double total_native_bytes = 0;
+#define DEFINE_BYTE_COUNT(name)                                           \
+    total_native_bytes += GJS_GET_BYTES(name);                            \
+    if (!JS_DefineProperty(cx, native_bytes, #name,                       \
+                           double(GJS_GET_BYTES(name)), JSPROP_ENUMERATE)) \
+        return false;
+    GJS_FOR_EACH_BYTE_COUNTER(DEFINE_BYTE_COUNT)
+#undef DEFINE_BYTE_COUNT
+
+    if (!JS_DefineProperty(cx, retval, "objects", objects, JSPROP_ENUMERATE) ||
+        !JS_DefineProperty(cx, retval, "nativeBytes", native_bytes,
+                           JSPROP_ENUMERATE) ||
+        !JS_DefineProperty(cx, retval, "totalNativeBytes", total_native_bytes,
+                           JSPROP_ENUMERATE) ||
+        !JS_DefineProperty(cx, retval, "gcHeapBytes",
+                           double(JS_GetGCParameter(cx, JSGC_BYTES)),
+                           JSPROP_ENUMERATE))
+        return false;
+
+    args.rval().setObject(*retval);
+    return true;
+}
+
 static bool
 gjs_gc(JSContext *context,
        unsigned   argc,
@@ -171,6 +370,15 @@ gjs_gc(JSContext *context,
     return true;
 }
 
+static bool gjs_shrink_heap(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!gjs_parse_call_args(cx, "shrinkHeap", args, ""))
+        return false;
+    GjsContextPrivate::from_cx(cx)->shrink_heap();
+    args.rval().setUndefined();
+    return true;
+}
+
 static bool
 gjs_exit(JSContext *context,
          unsigned   argc,
@@ -183,6 +391,9 @@ gjs_exit(JSContext *context,
         return false;
 
     GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
+    if (gjs->fast_exit_enabled())
+        gjs->fast_exit(ecode);
+
     gjs->exit(ecode);
     return false;  /* without gjs_throw() == "throw uncatchable exception" */
 }
@@ -200,15 +411,734 @@ static bool gjs_clear_date_caches(JSContext*, unsigned argc, JS::Value* vp) {
     return true;
 }
 
+static bool gjs_set_source_policy(JSContext* cx, unsigned argc,
+                                  JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsAutoChar prefix;
+    JS::UniqueChars policy_name;
+    if (!gjs_parse_call_args(cx, "setSourcePolicy", args, "Fs", "pathPrefix",
+                             &prefix, "policy", &policy_name))
+        return false;
+
+    GjsSourcePolicy policy;
+    if (strcmp(policy_name.get(), "default") == 0) {
+        policy = GjsSourcePolicy::DEFAULT;
+    } else if (strcmp(policy_name.get(), "lazy") == 0) {
+        policy = GjsSourcePolicy::LAZY;
+    } else if (strcmp(policy_name.get(), "eager") == 0) {
+        policy = GjsSourcePolicy::EAGER;
+    } else {
+        gjs_throw(cx,
+                  "Unknown source policy '%s', expected 'default', 'lazy', "
+                  "or 'eager'",
+                  policy_name.get());
+        return false;
+    }
+
+    GjsContextPrivate::from_cx(cx)->set_source_policy(prefix, policy);
+    args.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_set_timer_slack(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    uint32_t slack_ms;
+    if (!gjs_parse_call_args(cx, "setTimerSlack", args, "u", "milliseconds",
+                             &slack_ms))
+        return false;
+
+    GjsContextPrivate::from_cx(cx)->timers().set_slack(int64_t(slack_ms) *
+                                                       1000);
+    args.rval().setUndefined();
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_set_queue_thread_callbacks(JSContext* cx, unsigned argc,
+                                           JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    bool enabled;
+    if (!gjs_parse_call_args(cx, "setQueueThreadCallbacks", args, "b",
+                             "enabled", &enabled))
+        return false;
+
+    GjsContextPrivate::from_cx(cx)->thread_callbacks().set_enabled(enabled);
+    args.rval().setUndefined();
+    return true;
+}
+
+// readFile(), readTextFile() and writeFile() do their I/O on a GTask thread
+// and settle their promise directly, without going through Gio.File, its
+// async/finish pair, and a callback trampoline. The contents read come back
+// as a Uint8Array over the GBytes, without copying.
+
+// The file operation itself. This is the GTask's data, which may be freed on
+// the worker thread, so it only holds GLib data.
+struct GjsFileRequest {
+    enum Mode { READ, READ_TEXT, WRITE };
+
+    GjsAutoChar path;
+    Mode mode;
+    GBytes* contents;  // to write, or read
+
+    GjsFileRequest(char* filename, Mode request_mode, GBytes* data = nullptr)
+        : path(filename), mode(request_mode), contents(data) {}
+    ~GjsFileRequest() { g_clear_pointer(&contents, g_bytes_unref); }
+
+    static void run(GTask* task, void*, void* data, GCancellable*) {
+        auto* self = static_cast<GjsFileRequest*>(data);
+        GError* error = nullptr;
+
+        if (self->mode == WRITE) {
+            size_t len;
+            auto* bytes = static_cast<const char*>(
+                g_bytes_get_data(self->contents, &len));
+            if (!g_file_set_contents(self->path, bytes, len, &error)) {
+                g_task_return_error(task, error);
+                return;
+            }
+        } else {
+            char* bytes;
+            size_t len;
+            if (!g_file_get_contents(self->path, &bytes, &len, &error)) {
+                g_task_return_error(task, error);
+                return;
+            }
+            self->contents = g_bytes_new_take(bytes, len);
+        }
+        g_task_return_boolean(task, true);
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool result(JSContext* cx, JS::MutableHandleValue value) {
+        if (mode == WRITE) {
+            value.setUndefined();
+            return true;
+        }
+        if (mode == READ_TEXT) {
+            size_t len;
+            const void* bytes = g_bytes_get_data(contents, &len);
+            return gjs_string_from_utf8_n(cx, static_cast<const char*>(bytes),
+                                          len, value);
+        }
+        JSObject* array = gjs_byte_array_from_gbytes(cx, contents);
+        if (!array)
+            return false;
+        value.setObject(*array);
+        return true;
+    }
+};
+
+// The JS side of a file request. It is passed to on_done() as the GTask's
+// callback data, and torn down there, on the context's thread.
+struct GjsFilePromise {
+    JSContext* cx;
+    GjsAutoUnref<GjsContext> gjs;  // keeps the context alive until done
+    JS::PersistentRootedObject promise;
+
+    GjsFilePromise(JSContext* context, JSObject* promise_obj)
+        : cx(context),
+          gjs(GjsContextPrivate::from_cx(context)->public_context(),
+              GjsAutoTakeOwnership()),
+          promise(context, promise_obj) {}
+
+    static void on_done(GObject*, GAsyncResult* res, void* data) {
+        std::unique_ptr<GjsFilePromise> self(
+            static_cast<GjsFilePromise*>(data));
+        GTask* task = G_TASK(res);
+        auto* request =
+            static_cast<GjsFileRequest*>(g_task_get_task_data(task));
+        JSContext* cx = self->cx;
+        if (G_UNLIKELY(GjsContextPrivate::from_cx(cx)->destroying()))
+            return;
+
+        JSAutoRealm ar(cx, self->promise);
+
+        GError* error = nullptr;
+        JS::RootedValue value(cx);
+        if (g_task_propagate_boolean(task, &error) &&
+            request->result(cx, &value)) {
+            if (!JS::ResolvePromise(cx, self->promise, value))
+                gjs_log_exception(cx);
+            return;
+        }
+        if (error)
+            gjs_throw_gerror_message(cx, error);
+
+        JS::RootedValue exc(cx);
+        if (!JS_GetPendingException(cx, &exc))
+            return;  // uncatchable
+        JS_ClearPendingException(cx);
+        if (!JS::RejectPromise(cx, self->promise, exc))
+            gjs_log_exception(cx);
+    }
+};
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool start_file_request(JSContext* cx, const JS::CallArgs& args,
+                               GjsAutoChar* path, GjsFileRequest::Mode mode,
+                               GBytes* contents = nullptr) {
+    JS::RootedObject promise(cx, JS::NewPromiseObject(cx, nullptr));
+    if (!promise) {
+        g_clear_pointer(&contents, g_bytes_unref);
+        return false;
+    }
+
+    auto* request = new GjsFileRequest(path->release(), mode, contents);
+    GjsAutoUnref<GTask> task =
+        g_task_new(nullptr, nullptr, &GjsFilePromise::on_done,
+                   new GjsFilePromise(cx, promise));
+    g_task_set_task_data(task, request, [](void* data) {
+        delete static_cast<GjsFileRequest*>(data);
+    });
+    g_task_run_in_thread(task, &GjsFileRequest::run);
+
+    args.rval().setObject(*promise);
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_read_file(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsAutoChar path;
+    if (!gjs_parse_call_args(cx, "readFile", args, "F", "path", &path))
+        return false;
+    return start_file_request(cx, args, &path, GjsFileRequest::READ);
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_read_text_file(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsAutoChar path;
+    if (!gjs_parse_call_args(cx, "readTextFile", args, "F", "path", &path))
+        return false;
+    return start_file_request(cx, args, &path, GjsFileRequest::READ_TEXT);
+}
+
+// Copies a string, as UTF-8, or the contents of an ArrayBuffer or typed array
+GJS_JSAPI_RETURN_CONVENTION
+static bool bytes_from_value(JSContext* cx, JS::HandleValue value,
+                             const char* func_name, GBytes** bytes_out) {
+    if (value.isString()) {
+        JS::UniqueChars utf8 = gjs_string_to_utf8(cx, value);
+        if (!utf8)
+            return false;
+        *bytes_out = g_bytes_new(utf8.get(), strlen(utf8.get()));
+        return true;
+    }
+
+    if (value.isObject()) {
+        JSObject* obj = &value.toObject();
+        uint32_t len;
+        bool is_shared;
+        uint8_t* data;
+        if (JS_IsArrayBufferViewObject(obj)) {
+            js::GetArrayBufferViewLengthAndData(obj, &len, &is_shared, &data);
+            *bytes_out = g_bytes_new(data, len);
+            return true;
+        }
+        if (JS::IsArrayBufferObject(obj)) {
+            JS::GetArrayBufferLengthAndData(obj, &len, &is_shared, &data);
+            *bytes_out = g_bytes_new(data, len);
+            return true;
+        }
+    }
+
+    gjs_throw(cx, "%s() contents must be a string or buffer", func_name);
+    return false;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_write_file(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    GjsAutoChar path;
+    JS::RootedValue data(cx);
+    if (!gjs_parse_call_args(cx, "writeFile", args, "Fv", "path", &path,
+                             "contents", &data))
+        return false;
+
+    // The contents are copied, since the caller may change them before the
+    // thread gets to them
+    GBytes* contents;
+    if (!bytes_from_value(cx, data, "writeFile", &contents))
+        return false;
+
+    return start_file_request(cx, args, &path, GjsFileRequest::WRITE,
+                              contents);
+}
+
+#ifndef _WIN32
+/* Writing to the standard input of a program that has already exited raises
+ * SIGPIPE, which kills the whole process by default. So standard input is a
+ * socket rather than a pipe: GSocket writes with MSG_NOSIGNAL (or
+ * SO_NOSIGPIPE), and the write fails with EPIPE instead. Ignoring SIGPIPE
+ * instead would be inherited by every program spawned afterwards.
+ *
+ * Returns the end to write to, and gives the other end to @launcher. */
+static GIOStream* stdin_socket_new(GSubprocessLauncher* launcher,
+                                   GError** error) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        int errsv = errno;
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errsv),
+                    "Can't create a socket for standard input: %s",
+                    g_strerror(errsv));
+        return nullptr;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+    GjsAutoUnref<GSocket> socket = g_socket_new_from_fd(fds[0], error);
+    if (!socket) {
+        close(fds[0]);
+        close(fds[1]);
+        return nullptr;
+    }
+    g_subprocess_launcher_take_stdin_fd(launcher, fds[1]);
+    return G_IO_STREAM(g_socket_connection_factory_create_connection(socket));
+}
+#endif
+
+// spawn() runs a process with GSubprocess and reads its output asynchronously
+// straight into one growing buffer per pipe, which is handed to JS as a
+// Uint8Array without another copy when the process is done. Lines for the
+// onLine callback are cut out of the same buffer, all the complete lines of
+// one read being delivered in the same main loop dispatch.
+class GjsSpawn {
+    static constexpr size_t READ_SIZE = 16384;
+
+    struct Pipe {
+        GjsSpawn* owner;
+        GInputStream* stream;
+        GByteArray* data;
+        size_t line_start;
+    };
+
+    JSContext* m_cx;
+    GjsAutoUnref<GjsContext> m_gjs;  // keeps the context alive until done
+    JS::PersistentRootedObject m_promise;
+    JS::PersistentRootedObject m_on_line;
+    GjsAutoUnref<GSubprocess> m_proc;
+    GjsAutoPointer<GBytes, GBytes, g_bytes_unref> m_stdin;
+    GjsAutoUnref<GIOStream> m_stdin_stream;  // null with a pipe
+    Pipe m_stdout, m_stderr;
+    GError* m_error;
+    unsigned m_pending;
+    bool m_text : 1;
+
+ public:
+    GjsSpawn(JSContext* cx, JSObject* promise, JSObject* on_line, bool text)
+        : m_cx(cx),
+          m_gjs(GjsContextPrivate::from_cx(cx)->public_context(),
+                GjsAutoTakeOwnership()),
+          m_promise(cx, promise),
+          m_on_line(cx, on_line),
+          m_stdout({this, nullptr, g_byte_array_new(), 0}),
+          m_stderr({this, nullptr, g_byte_array_new(), 0}),
+          m_error(nullptr),
+          m_pending(0),
+          m_text(text) {}
+
+    ~GjsSpawn() {
+        g_clear_pointer(&m_stdout.data, g_byte_array_unref);
+        g_clear_pointer(&m_stderr.data, g_byte_array_unref);
+        g_clear_error(&m_error);
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    static bool start(JSContext* cx, GjsSpawn* self, const char* const* argv,
+                      GBytes* stdin_bytes) {
+        std::unique_ptr<GjsSpawn> spawn(self);
+        auto flags = static_cast<GSubprocessFlags>(
+            G_SUBPROCESS_FLAGS_STDOUT_PIPE | G_SUBPROCESS_FLAGS_STDERR_PIPE);
+#ifdef _WIN32
+        if (stdin_bytes)
+            flags = static_cast<GSubprocessFlags>(
+                flags | G_SUBPROCESS_FLAGS_STDIN_PIPE);
+#endif
+        GjsAutoUnref<GSubprocessLauncher> launcher =
+            g_subprocess_launcher_new(flags);
+
+        GError* error = nullptr;
+#ifndef _WIN32
+        if (stdin_bytes) {
+            spawn->m_stdin_stream = stdin_socket_new(launcher, &error);
+            if (!spawn->m_stdin_stream) {
+                g_bytes_unref(stdin_bytes);
+                return gjs_throw_gerror_message(cx, error);
+            }
+        }
+#endif
+
+        spawn->m_proc = g_subprocess_launcher_spawnv(launcher, argv, &error);
+        if (!spawn->m_proc) {
+            g_clear_pointer(&stdin_bytes, g_bytes_unref);
+            return gjs_throw_gerror_message(cx, error);
+        }
+
+        if (stdin_bytes) {
+            GOutputStream* stdin_pipe =
+                spawn->m_stdin_stream
+                    ? g_io_stream_get_output_stream(spawn->m_stdin_stream)
+                    : g_subprocess_get_stdin_pipe(spawn->m_proc);
+            spawn->m_stdin = stdin_bytes;
+            size_t len;
+            const void* data = g_bytes_get_data(stdin_bytes, &len);
+            spawn->m_pending++;
+            g_output_stream_write_all_async(stdin_pipe, data, len,
+                                            G_PRIORITY_DEFAULT, nullptr,
+                                            &GjsSpawn::on_written, spawn.get());
+        }
+
+        spawn->m_stdout.stream = g_subprocess_get_stdout_pipe(spawn->m_proc);
+        spawn->m_stderr.stream = g_subprocess_get_stderr_pipe(spawn->m_proc);
+        spawn->m_pending += 3;
+        spawn->read_more(&spawn->m_stdout);
+        spawn->read_more(&spawn->m_stderr);
+        g_subprocess_wait_async(spawn->m_proc, nullptr, &GjsSpawn::on_exited,
+                                spawn.get());
+        spawn.release();
+        return true;
+    }
+
+ private:
+    void read_more(Pipe* pipe) {
+        size_t len = pipe->data->len;
+        g_byte_array_set_size(pipe->data, len + READ_SIZE);
+        g_input_stream_read_async(pipe->stream, pipe->data->data + len,
+                                  READ_SIZE, G_PRIORITY_DEFAULT, nullptr,
+                                  &GjsSpawn::on_read, pipe);
+    }
+
+    void set_error(GError* error) {
+        if (m_error)
+            g_error_free(error);
+        else
+            m_error = error;
+    }
+
+    void complete_one() {
+        if (--m_pending == 0) {
+            finish();
+            delete this;
+        }
+    }
+
+    static void on_written(GObject* stream, GAsyncResult* res, void* data) {
+        auto* self = static_cast<GjsSpawn*>(data);
+        // A process that exits without reading all of its input is not an
+        // error; only its exit status counts
+        g_output_stream_write_all_finish(G_OUTPUT_STREAM(stream), res, nullptr,
+                                         nullptr);
+        g_output_stream_close(G_OUTPUT_STREAM(stream), nullptr, nullptr);
+        // Closing a socket's output stream leaves the socket open, and the
+        // program would never see the end of its input
+        if (self->m_stdin_stream)
+            g_io_stream_close(self->m_stdin_stream, nullptr, nullptr);
+        self->m_stdin_stream.reset();
+        self->m_stdin.reset();
+        self->complete_one();
+    }
+
+    static void on_read(GObject* stream, GAsyncResult* res, void* data) {
+        auto* pipe = static_cast<Pipe*>(data);
+        GjsSpawn* self = pipe->owner;
+        GError* error = nullptr;
+        ssize_t count =
+            g_input_stream_read_finish(G_INPUT_STREAM(stream), res, &error);
+        size_t got = std::max<ssize_t>(count, 0);
+        g_byte_array_set_size(pipe->data, pipe->data->len - READ_SIZE + got);
+
+        if (count > 0) {
+            if (pipe == &self->m_stdout)
+                self->deliver_lines(false);
+            self->read_more(pipe);
+            return;
+        }
+
+        if (error)
+            self->set_error(error);
+        else if (pipe == &self->m_stdout)
+            self->deliver_lines(true);
+        self->complete_one();
+    }
+
+    static void on_exited(GObject* proc, GAsyncResult* res, void* data) {
+        auto* self = static_cast<GjsSpawn*>(data);
+        GError* error = nullptr;
+        if (!g_subprocess_wait_finish(G_SUBPROCESS(proc), res, &error))
+            self->set_error(error);
+        self->complete_one();
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool make_string(const uint8_t* data, size_t len,
+                     JS::MutableHandleValue value) {
+        return gjs_string_from_utf8_n(m_cx, reinterpret_cast<const char*>(data),
+                                      len, value);
+    }
+
+    void deliver_lines(bool at_end) {
+        if (!m_on_line ||
+            G_UNLIKELY(GjsContextPrivate::from_cx(m_cx)->destroying()))
+            return;
+
+        JSAutoRealm ar(m_cx, m_promise);
+        JS::RootedValue line(m_cx), ignored(m_cx);
+        JS::RootedValue callback(m_cx, JS::ObjectValue(*m_on_line));
+        GByteArray* buf = m_stdout.data;
+
+        while (m_stdout.line_start < buf->len) {
+            const uint8_t* start = buf->data + m_stdout.line_start;
+            size_t remaining = buf->len - m_stdout.line_start;
+            auto* newline =
+                static_cast<const uint8_t*>(memchr(start, '\n', remaining));
+            if (!newline && !at_end)
+                break;
+
+            size_t len = newline ? newline - start : remaining;
+            m_stdout.line_start += newline ? len + 1 : len;
+            if (!make_string(start, len, &line) ||
+                !JS_CallFunctionValue(m_cx, nullptr, callback,
+                                      JS::HandleValueArray(line), &ignored))
+                gjs_log_exception(m_cx);
+        }
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool output_value(Pipe* pipe, JS::MutableHandleValue value) {
+        if (m_text)
+            return make_string(pipe->data->data, pipe->data->len, value);
+
+        GjsAutoPointer<GBytes, GBytes, g_bytes_unref> bytes =
+            g_byte_array_free_to_bytes(pipe->data);
+        pipe->data = nullptr;
+        JSObject* array = gjs_byte_array_from_gbytes(m_cx, bytes);
+        if (!array)
+            return false;
+        value.setObject(*array);
+        return true;
+    }
+
+    GJS_JSAPI_RETURN_CONVENTION
+    bool make_result(JS::MutableHandleValue result) {
+        if (m_error)
+            return gjs_throw_gerror_message(m_cx,
+                                            std::exchange(m_error, nullptr));
+
+        JS::RootedObject obj(m_cx, JS_NewPlainObject(m_cx));
+        if (!obj)
+            return false;
+
+        JS::RootedValue status(m_cx, JS::NullValue()),
+            signal(m_cx, JS::NullValue()), out(m_cx), err(m_cx);
+        if (g_subprocess_get_if_exited(m_proc))
+            status.setInt32(g_subprocess_get_exit_status(m_proc));
+        else if (g_subprocess_get_if_signaled(m_proc))
+            signal.setInt32(g_subprocess_get_term_sig(m_proc));
+
+        // stderr first, as it is usually the shorter of the two, so that if
+        // it can't be converted, converting stdout was not done for nothing
+        if (!output_value(&m_stderr, &err) || !output_value(&m_stdout, &out) ||
+            !JS_DefineProperty(m_cx, obj, "status", status, JSPROP_ENUMERATE) ||
+            !JS_DefineProperty(m_cx, obj, "signal", signal, JSPROP_ENUMERATE) ||
+            !JS_DefineProperty(m_cx, obj, "stdout", out, JSPROP_ENUMERATE) ||
+            !JS_DefineProperty(m_cx, obj, "stderr", err, JSPROP_ENUMERATE))
+            return false;
+
+        result.setObject(*obj);
+        return true;
+    }
+
+    void finish() {
+        if (G_UNLIKELY(GjsContextPrivate::from_cx(m_cx)->destroying()))
+            return;
+
+        JSAutoRealm ar(m_cx, m_promise);
+
+        JS::RootedValue result(m_cx);
+        if (make_result(&result)) {
+            if (!JS::ResolvePromise(m_cx, m_promise, result))
+                gjs_log_exception(m_cx);
+            return;
+        }
+
+        JS::RootedValue exc(m_cx);
+        if (!JS_GetPendingException(m_cx, &exc))
+            return;  // uncatchable
+        JS_ClearPendingException(m_cx);
+        if (!JS::RejectPromise(m_cx, m_promise, exc))
+            gjs_log_exception(m_cx);
+    }
+};
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool gjs_spawn(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject options(cx);
+    if (!gjs_parse_call_args(cx, "spawn", args, "o", "options", &options))
+        return false;
+
+    JS::RootedValue v_argv(cx), v_stdin(cx), v_text(cx), v_on_line(cx);
+    if (!JS_GetProperty(cx, options, "argv", &v_argv) ||
+        !JS_GetProperty(cx, options, "stdin", &v_stdin) ||
+        !JS_GetProperty(cx, options, "text", &v_text) ||
+        !JS_GetProperty(cx, options, "onLine", &v_on_line))
+        return false;
+
+    bool is_array;
+    uint32_t argv_len;
+    if (!v_argv.isObject() ||
+        !JS::IsArrayObject(cx, v_argv, &is_array) || !is_array) {
+        gjs_throw(cx, "spawn() argv must be an array of strings");
+        return false;
+    }
+    JS::RootedObject argv_obj(cx, &v_argv.toObject());
+    if (!JS::GetArrayLength(cx, argv_obj, &argv_len))
+        return false;
+    if (argv_len == 0) {
+        gjs_throw(cx, "spawn() argv must not be empty");
+        return false;
+    }
+
+    JS::RootedObject on_line(cx);
+    if (!v_on_line.isUndefined()) {
+        if (!v_on_line.isObject() || !JS::IsCallable(&v_on_line.toObject())) {
+            gjs_throw(cx, "spawn() onLine must be a function");
+            return false;
+        }
+        on_line = &v_on_line.toObject();
+    }
+
+    void* strv;
+    if (!gjs_array_to_strv(cx, v_argv, argv_len, &strv))
+        return false;
+    GjsAutoStrv argv = static_cast<char**>(strv);
+
+    GBytes* stdin_bytes = nullptr;
+    if (!v_stdin.isUndefined() &&
+        !bytes_from_value(cx, v_stdin, "spawn", &stdin_bytes))
+        return false;
+
+    JS::RootedObject promise(cx, JS::NewPromiseObject(cx, nullptr));
+    if (!promise) {
+        g_clear_pointer(&stdin_bytes, g_bytes_unref);
+        return false;
+    }
+
+    auto* spawn = new GjsSpawn(cx, promise, on_line, JS::ToBoolean(v_text));
+    if (!GjsSpawn::start(cx, spawn, argv, stdin_bytes))
+        return false;
+
+    args.rval().setObject(*promise);
+    return true;
+}
+
 static JSFunctionSpec module_funcs[] = {
     JS_FN("addressOf", gjs_address_of, 1, GJS_MODULE_PROP_FLAGS),
     JS_FN("addressOfGObject", gjs_address_of_gobject, 1, GJS_MODULE_PROP_FLAGS),
     JS_FN("refcount", gjs_refcount, 1, GJS_MODULE_PROP_FLAGS),
     JS_FN("breakpoint", gjs_breakpoint, 0, GJS_MODULE_PROP_FLAGS),
     JS_FN("dumpHeap", gjs_dump_heap, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("dumpFunctionStats", gjs_dump_function_stats, 0,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("dumpTypelibStats", gjs_dump_typelib_stats, 0,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("dumpWrapperStats", gjs_dump_wrapper_stats, 0,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("dumpDebugLog", gjs_dump_debug_log, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("memoryUsage", gjs_memory_usage, 0, GJS_MODULE_PROP_FLAGS),
     JS_FN("gc", gjs_gc, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("shrinkHeap", gjs_shrink_heap, 0, GJS_MODULE_PROP_FLAGS),
     JS_FN("exit", gjs_exit, 0, GJS_MODULE_PROP_FLAGS),
     JS_FN("clearDateCaches", gjs_clear_date_caches, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("setSourcePolicy", gjs_set_source_policy, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FN("setTimerSlack", gjs_set_timer_slack, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("setQueueThreadCallbacks", gjs_set_queue_thread_callbacks, 1,
+          GJS_MODULE_PROP_FLAGS),
+    JS_FN("readFile", gjs_read_file, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("readTextFile", gjs_read_text_file, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("writeFile", gjs_write_file, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FN("spawn", gjs_spawn, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
+
+static bool gjs_profiler_start_func(JSContext* cx, unsigned argc,
+                                    JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject options(cx);
+    if (!gjs_parse_call_args(cx, "start", args, "|o", "options", &options))
+        return false;
+
+    GjsAutoChar filename;
+    double hz = 0;
+    bool counters = true;
+    if (options) {
+        JS::RootedValue v_file(cx), v_hz(cx), v_counters(cx);
+        if (!JS_GetProperty(cx, options, "file", &v_file) ||
+            !JS_GetProperty(cx, options, "frequencyHz", &v_hz) ||
+            !JS_GetProperty(cx, options, "counters", &v_counters))
+            return false;
+
+        if (!v_file.isUndefined() &&
+            !gjs_string_to_filename(cx, v_file, &filename))
+            return false;
+        if (!v_hz.isUndefined()) {
+            if (!JS::ToNumber(cx, v_hz, &hz))
+                return false;
+            if (!(hz >= 1 && hz <= GJS_PROFILER_MAX_SAMPLE_RATE)) {
+                gjs_throw(cx, "frequencyHz must be between 1 and %u",
+                          GJS_PROFILER_MAX_SAMPLE_RATE);
+                return false;
+            }
+        }
+        if (!v_counters.isUndefined())
+            counters = JS::ToBoolean(v_counters);
+    }
+
+    GjsProfiler* profiler = GjsContextPrivate::from_cx(cx)->ensure_profiler();
+    if (!profiler) {
+        gjs_throw(cx, "Another context is already being profiled");
+        return false;
+    }
+
+    GError* error = nullptr;
+    if (!_gjs_profiler_start_with_options(profiler, filename, unsigned(hz),
+                                          counters, &error))
+        return gjs_throw_gerror_message(cx, error);
+
+    args.rval().setUndefined();
+    return true;
+}
+
+static bool gjs_profiler_stop_func(JSContext* cx, unsigned argc,
+                                   JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!gjs_parse_call_args(cx, "stop", args, ""))
+        return false;
+
+    GjsProfiler* profiler = GjsContextPrivate::from_cx(cx)->profiler();
+    if (profiler)
+        gjs_profiler_stop(profiler);
+
+    args.rval().setUndefined();
+    return true;
+}
+
+static bool gjs_profiler_is_running_func(JSContext* cx, unsigned argc,
+                                         JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    if (!gjs_parse_call_args(cx, "isRunning", args, ""))
+        return false;
+
+    GjsProfiler* profiler = GjsContextPrivate::from_cx(cx)->profiler();
+    args.rval().setBoolean(profiler && _gjs_profiler_is_running(profiler));
+    return true;
+}
+
+static JSFunctionSpec profiler_funcs[] = {
+    JS_FN("start", gjs_profiler_start_func, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FN("stop", gjs_profiler_stop_func, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FN("isRunning", gjs_profiler_is_running_func, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS_END};
 
 bool
@@ -220,6 +1150,13 @@ gjs_js_define_system_stuff(JSContext              *context,
     if (!JS_DefineFunctions(context, module, &module_funcs[0]))
         return false;
 
+    JS::RootedObject profiler(context, JS_NewPlainObject(context));
+    if (!profiler ||
+        !JS_DefineFunctions(context, profiler, &profiler_funcs[0]) ||
+        !JS_DefineProperty(context, module, "profiler", profiler,
+                           GJS_MODULE_PROP_FLAGS | JSPROP_READONLY))
+        return false;
+
     GjsContextPrivate* gjs = GjsContextPrivate::from_cx(context);
     const char* program_name = gjs->program_name();
 
@@ -0,0 +1,596 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <math.h>  // for pow, sin, asin, sqrt, floor, fabs, isnan
+#include <stdint.h>
+
+#include <vector>
+
+#include <glib-object.h>
+#include <glib.h>
+
+#include <js/Array.h>  // for NewArrayObject
+#include <js/CallArgs.h>
+#include <js/Class.h>
+#include <js/GCVector.h>  // for RootedVector
+#include <js/Id.h>
+#include <js/PropertyDescriptor.h>  // for JSPROP_READONLY
+#include <js/PropertySpec.h>
+#include <js/RootingAPI.h>
+#include <js/TypeDecls.h>
+#include <js/Utility.h>  // for UniqueChars
+#include <js/Value.h>
+#include <js/ValueArray.h>
+#include <jsapi.h>  // for JS_SetPropertyById, JS_GetProperty, ...
+
+#include "gi/object.h"
+#include "cjs/jsapi-class.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util.h"
+#include "cjs/macros.h"
+#include "modules/tweener.h"
+
+/* Robert Penner's easing equations, as in modules/script/tweener/equations.js,
+ * in the same order as the names in easing_names. Evaluating them natively
+ * lets a tween update all of its properties in one call from JS. */
+
+enum GjsEasing : uint8_t {
+    EASE_NONE,
+    EASE_IN_QUAD,
+    EASE_OUT_QUAD,
+    EASE_IN_OUT_QUAD,
+    EASE_OUT_IN_QUAD,
+    EASE_IN_CUBIC,
+    EASE_OUT_CUBIC,
+    EASE_IN_OUT_CUBIC,
+    EASE_OUT_IN_CUBIC,
+    EASE_IN_QUART,
+    EASE_OUT_QUART,
+    EASE_IN_OUT_QUART,
+    EASE_OUT_IN_QUART,
+    EASE_IN_QUINT,
+    EASE_OUT_QUINT,
+    EASE_IN_OUT_QUINT,
+    EASE_OUT_IN_QUINT,
+    EASE_IN_SINE,
+    EASE_OUT_SINE,
+    EASE_IN_OUT_SINE,
+    EASE_OUT_IN_SINE,
+    EASE_IN_EXPO,
+    EASE_OUT_EXPO,
+    EASE_IN_OUT_EXPO,
+    EASE_OUT_IN_EXPO,
+    EASE_IN_CIRC,
+    EASE_OUT_CIRC,
+    EASE_IN_OUT_CIRC,
+    EASE_OUT_IN_CIRC,
+    EASE_IN_ELASTIC,
+    EASE_OUT_ELASTIC,
+    EASE_IN_OUT_ELASTIC,
+    EASE_OUT_IN_ELASTIC,
+    EASE_IN_BACK,
+    EASE_OUT_BACK,
+    EASE_IN_OUT_BACK,
+    EASE_OUT_IN_BACK,
+    EASE_IN_BOUNCE,
+    EASE_OUT_BOUNCE,
+    EASE_IN_OUT_BOUNCE,
+    EASE_OUT_IN_BOUNCE,
+    N_EASINGS,
+};
+
+static const char* const easing_names[N_EASINGS] = {
+    "easeNone",         "easeInQuad",      "easeOutQuad",
+    "easeInOutQuad",    "easeOutInQuad",   "easeInCubic",
+    "easeOutCubic",     "easeInOutCubic",  "easeOutInCubic",
+    "easeInQuart",      "easeOutQuart",    "easeInOutQuart",
+    "easeOutInQuart",   "easeInQuint",     "easeOutQuint",
+    "easeInOutQuint",   "easeOutInQuint",  "easeInSine",
+    "easeOutSine",      "easeInOutSine",   "easeOutInSine",
+    "easeInExpo",       "easeOutExpo",     "easeInOutExpo",
+    "easeOutInExpo",    "easeInCirc",      "easeOutCirc",
+    "easeInOutCirc",    "easeOutInCirc",   "easeInElastic",
+    "easeOutElastic",   "easeInOutElastic", "easeOutInElastic",
+    "easeInBack",       "easeOutBack",     "easeInOutBack",
+    "easeOutInBack",    "easeInBounce",    "easeOutBounce",
+    "easeInOutBounce",  "easeOutInBounce",
+};
+
+// From transitionParams; NaN if not given
+struct GjsEasingParams {
+    double overshoot;
+    double amplitude;
+    double period;
+};
+
+static double ease(GjsEasing easing, double t, double b, double c, double d,
+                   const GjsEasingParams& params);
+
+// The "out-in" variants are the "out" easing for the first half and the "in"
+// easing for the second half
+static double ease_out_in(GjsEasing out, GjsEasing in, double t, double b,
+                          double c, double d, const GjsEasingParams& params) {
+    if (t < d / 2)
+        return ease(out, t * 2, b, c / 2, d, params);
+    return ease(in, t * 2 - d, b + c / 2, c / 2, d, params);
+}
+
+static double ease_elastic(GjsEasing easing, double t, double b, double c,
+                           double d, const GjsEasingParams& params) {
+    bool in_out = easing == EASE_IN_OUT_ELASTIC;
+    if (t <= 0)
+        return b;
+    t /= in_out ? d / 2 : d;
+    if (t >= (in_out ? 2 : 1))
+        return b + c;
+
+    double p = isnan(params.period) ? d * (in_out ? .3 * 1.5 : .3)
+                                    : params.period;
+    double a = isnan(params.amplitude) ? 0 : params.amplitude;
+    double s;
+    if (!a || a < fabs(c)) {
+        a = c;
+        s = p / 4;
+    } else {
+        s = p / (2 * G_PI) * asin(c / a);
+    }
+
+    if (easing == EASE_IN_ELASTIC || (in_out && t < 1)) {
+        t -= 1;
+        double v = a * pow(2, 10 * t) * sin((t * d - s) * (2 * G_PI) / p);
+        return in_out ? -.5 * v + b : -v + b;
+    }
+    if (in_out) {
+        t -= 1;
+        return a * pow(2, -10 * t) * sin((t * d - s) * (2 * G_PI) / p) * .5 +
+               c + b;
+    }
+    return a * pow(2, -10 * t) * sin((t * d - s) * (2 * G_PI) / p) + c + b;
+}
+
+static double ease_out_bounce(double t, double b, double c, double d) {
+    t /= d;
+    if (t < 1 / 2.75)
+        return c * (7.5625 * t * t) + b;
+    if (t < 2 / 2.75) {
+        t -= 1.5 / 2.75;
+        return c * (7.5625 * t * t + .75) + b;
+    }
+    if (t < 2.5 / 2.75) {
+        t -= 2.25 / 2.75;
+        return c * (7.5625 * t * t + .9375) + b;
+    }
+    t -= 2.625 / 2.75;
+    return c * (7.5625 * t * t + .984375) + b;
+}
+
+static double ease_in_bounce(double t, double b, double c, double d) {
+    return c - ease_out_bounce(d - t, 0, c, d) + b;
+}
+
+static double ease(GjsEasing easing, double t, double b, double c, double d,
+                   const GjsEasingParams& params) {
+    double s = isnan(params.overshoot) ? 1.70158 : params.overshoot;
+
+    switch (easing) {
+        case EASE_NONE:
+            return c * t / d + b;
+
+        case EASE_IN_QUAD:
+            t /= d;
+            return c * t * t + b;
+        case EASE_OUT_QUAD:
+            t /= d;
+            return -c * t * (t - 2) + b;
+        case EASE_IN_OUT_QUAD:
+            t /= d / 2;
+            if (t < 1)
+                return c / 2 * t * t + b;
+            t -= 1;
+            return -c / 2 * (t * (t - 2) - 1) + b;
+
+        case EASE_IN_CUBIC:
+            t /= d;
+            return c * t * t * t + b;
+        case EASE_OUT_CUBIC:
+            t = t / d - 1;
+            return c * (t * t * t + 1) + b;
+        case EASE_IN_OUT_CUBIC:
+            t /= d / 2;
+            if (t < 1)
+                return c / 2 * t * t * t + b;
+            t -= 2;
+            return c / 2 * (t * t * t + 2) + b;
+
+        case EASE_IN_QUART:
+            t /= d;
+            return c * t * t * t * t + b;
+        case EASE_OUT_QUART:
+            t = t / d - 1;
+            return -c * (t * t * t * t - 1) + b;
+        case EASE_IN_OUT_QUART:
+            t /= d / 2;
+            if (t < 1)
+                return c / 2 * t * t * t * t + b;
+            t -= 2;
+            return -c / 2 * (t * t * t * t - 2) + b;
+
+        case EASE_IN_QUINT:
+            t /= d;
+            return c * t * t * t * t * t + b;
+        case EASE_OUT_QUINT:
+            t = t / d - 1;
+            return c * (t * t * t * t * t + 1) + b;
+        case EASE_IN_OUT_QUINT:
+            t /= d / 2;
+            if (t < 1)
+                return c / 2 * t * t * t * t * t + b;
+            t -= 2;
+            return c / 2 * (t * t * t * t * t + 2) + b;
+
+        case EASE_IN_SINE:
+            return -c * cos(t / d * (G_PI / 2)) + c + b;
+        case EASE_OUT_SINE:
+            return c * sin(t / d * (G_PI / 2)) + b;
+        case EASE_IN_OUT_SINE:
+            return -c / 2 * (cos(G_PI * t / d) - 1) + b;
+
+        case EASE_IN_EXPO:
+            return t <= 0 ? b : c * pow(2, 10 * (t / d - 1)) + b;
+        case EASE_OUT_EXPO:
+            return t >= d ? b + c : c * (-pow(2, -10 * t / d) + 1) + b;
+        case EASE_IN_OUT_EXPO:
+            if (t <= 0)
+                return b;
+            if (t >= d)
+                return b + c;
+            t /= d / 2;
+            if (t < 1)
+                return c / 2 * pow(2, 10 * (t - 1)) + b;
+            t -= 1;
+            return c / 2 * (-pow(2, -10 * t) + 2) + b;
+
+        case EASE_IN_CIRC:
+            t /= d;
+            return -c * (sqrt(1 - t * t) - 1) + b;
+        case EASE_OUT_CIRC:
+            t = t / d - 1;
+            return c * sqrt(1 - t * t) + b;
+        case EASE_IN_OUT_CIRC:
+            t /= d / 2;
+            if (t < 1)
+                return -c / 2 * (sqrt(1 - t * t) - 1) + b;
+            t -= 2;
+            return c / 2 * (sqrt(1 - t * t) + 1) + b;
+
+        case EASE_IN_ELASTIC:
+        case EASE_OUT_ELASTIC:
+        case EASE_IN_OUT_ELASTIC:
+            return ease_elastic(easing, t, b, c, d, params);
+
+        case EASE_IN_BACK:
+            t /= d;
+            return c * t * t * ((s + 1) * t - s) + b;
+        case EASE_OUT_BACK:
+            t = t / d - 1;
+            return c * (t * t * ((s + 1) * t + s) + 1) + b;
+        case EASE_IN_OUT_BACK:
+            t /= d / 2;
+            s *= 1.525;
+            if (t < 1)
+                return c / 2 * (t * t * ((s + 1) * t - s)) + b;
+            t -= 2;
+            return c / 2 * (t * t * ((s + 1) * t + s) + 2) + b;
+
+        case EASE_IN_BOUNCE:
+            return ease_in_bounce(t, b, c, d);
+        case EASE_OUT_BOUNCE:
+            return ease_out_bounce(t, b, c, d);
+        case EASE_IN_OUT_BOUNCE:
+            if (t < d / 2)
+                return ease_in_bounce(t * 2, 0, c, d) * .5 + b;
+            return ease_out_bounce(t * 2 - d, 0, c, d) * .5 + c * .5 + b;
+
+        case EASE_OUT_IN_QUAD:
+            return ease_out_in(EASE_OUT_QUAD, EASE_IN_QUAD, t, b, c, d, params);
+        case EASE_OUT_IN_CUBIC:
+            return ease_out_in(EASE_OUT_CUBIC, EASE_IN_CUBIC, t, b, c, d,
+                               params);
+        case EASE_OUT_IN_QUART:
+            return ease_out_in(EASE_OUT_QUART, EASE_IN_QUART, t, b, c, d,
+                               params);
+        case EASE_OUT_IN_QUINT:
+            return ease_out_in(EASE_OUT_QUINT, EASE_IN_QUINT, t, b, c, d,
+                               params);
+        case EASE_OUT_IN_SINE:
+            return ease_out_in(EASE_OUT_SINE, EASE_IN_SINE, t, b, c, d, params);
+        case EASE_OUT_IN_EXPO:
+            return ease_out_in(EASE_OUT_EXPO, EASE_IN_EXPO, t, b, c, d, params);
+        case EASE_OUT_IN_CIRC:
+            return ease_out_in(EASE_OUT_CIRC, EASE_IN_CIRC, t, b, c, d, params);
+        case EASE_OUT_IN_ELASTIC:
+            return ease_out_in(EASE_OUT_ELASTIC, EASE_IN_ELASTIC, t, b, c, d,
+                               params);
+        case EASE_OUT_IN_BACK:
+            return ease_out_in(EASE_OUT_BACK, EASE_IN_BACK, t, b, c, d, params);
+        case EASE_OUT_IN_BOUNCE:
+            return ease_out_in(EASE_OUT_BOUNCE, EASE_IN_BOUNCE, t, b, c, d,
+                               params);
+
+        case N_EASINGS:
+        default:
+            g_assert_not_reached();
+    }
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool easing_params_from_js(JSContext* cx, JS::HandleValue value,
+                                  GjsEasingParams* params) {
+    *params = {NAN, NAN, NAN};
+    if (!value.isObject())
+        return true;
+
+    JS::RootedObject obj(cx, &value.toObject());
+    JS::RootedValue v(cx);
+    // Like isNaN() in equations.js, anything that isn't a number is ignored
+    if (!JS_GetProperty(cx, obj, "overshoot", &v) ||
+        !JS::ToNumber(cx, v, &params->overshoot) ||
+        !JS_GetProperty(cx, obj, "amplitude", &v) ||
+        !JS::ToNumber(cx, v, &params->amplitude) ||
+        !JS_GetProperty(cx, obj, "period", &v) ||
+        !JS::ToNumber(cx, v, &params->period))
+        return false;
+    return true;
+}
+
+GJS_JSAPI_RETURN_CONVENTION
+static bool easing_from_js(JSContext* cx, uint32_t id, GjsEasing* easing) {
+    if (id >= N_EASINGS) {
+        gjs_throw(cx, "Unknown easing %u", id);
+        return false;
+    }
+    *easing = GjsEasing(id);
+    return true;
+}
+
+// ease(easing, t, b, c, d, transitionParams) -> value, like the function of the
+// same name in equations.js
+GJS_JSAPI_RETURN_CONVENTION
+static bool ease_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+    uint32_t id;
+    double t, b, c, d;
+    JS::RootedObject params_obj(cx);
+    if (!gjs_parse_call_args(cx, "ease", args, "uffff|?o", "easing", &id, "t",
+                             &t, "b", &b, "c", &c, "d", &d, "params",
+                             &params_obj))
+        return false;
+
+    GjsEasing easing;
+    GjsEasingParams params;
+    JS::RootedValue params_val(cx, JS::ObjectOrNullValue(params_obj));
+    if (!easing_from_js(cx, id, &easing) ||
+        !easing_params_from_js(cx, params_val, &params))
+        return false;
+
+    args.rval().setNumber(ease(easing, t, b, c, d, params));
+    return true;
+}
+
+/* PropertyTween holds the numeric properties of one tween of one object, and
+ * sets all of them for a point in time in one call. */
+
+class GjsPropertyTween {
+    struct Property {
+        jsid id;  // pinned, so it needs no tracing
+        double start;
+        double end;
+    };
+
+    std::vector<Property> m_properties;
+    GjsEasing m_easing;
+    GjsEasingParams m_params;
+
+ public:
+    GjsPropertyTween(GjsEasing easing, const GjsEasingParams& params)
+        : m_easing(easing), m_params(params) {}
+
+    void add(jsid id, double start, double end) {
+        m_properties.push_back({id, start, end});
+    }
+
+    /* Sets each property to its value at @t out of @d, or to its end value if
+     * @t is past @d; optionally rounded, and clamped between @min and @max,
+     * which are NaN if not given. Changes to GObject properties are notified
+     * together at the end. */
+    GJS_JSAPI_RETURN_CONVENTION
+    bool update(JSContext* cx, JS::HandleObject scope, double t, double d,
+                bool rounded, double min, double max) {
+        GObject* gobj = nullptr;
+        ObjectBase* priv = ObjectBase::for_js(cx, scope);
+        if (priv && !priv->is_prototype())
+            gobj = priv->to_instance()->ptr();
+        if (gobj) {
+            g_object_ref(gobj);
+            g_object_freeze_notify(gobj);
+        }
+
+        bool ok = true;
+        JS::RootedId id(cx);
+        JS::RootedValue value(cx);
+        for (const Property& property : m_properties) {
+            double v = t >= d ? property.end
+                              : ease(m_easing, t, property.start,
+                                     property.end - property.start, d,
+                                     m_params);
+            if (rounded) {
+                // Math.round(), without the precision loss of floor(v + 0.5)
+                double r = floor(v);
+                v = v - r >= 0.5 ? r + 1 : r;
+            }
+            if (v < min)
+                v = min;
+            if (v > max)
+                v = max;
+
+            id = property.id;
+            value.setNumber(v);
+            if (!JS_SetPropertyById(cx, scope, id, value)) {
+                ok = false;
+                break;
+            }
+        }
+
+        if (gobj) {
+            g_object_thaw_notify(gobj);
+            g_object_unref(gobj);
+        }
+        return ok;
+    }
+};
+
+enum : unsigned { SCOPE_SLOT = 0 };
+
+[[nodiscard]] static JSObject* gjs_property_tween_get_proto(JSContext*);
+
+GJS_DEFINE_PROTO("PropertyTween", property_tween,
+                 JSCLASS_HAS_RESERVED_SLOTS(1) | JSCLASS_BACKGROUND_FINALIZE)
+GJS_DEFINE_PRIV_FROM_JS(GjsPropertyTween, gjs_property_tween_class)
+
+// new PropertyTween(scope, easing, transitionParams)
+GJS_NATIVE_CONSTRUCTOR_DECLARE(property_tween) {
+    GJS_NATIVE_CONSTRUCTOR_VARIABLES(property_tween)
+    GJS_NATIVE_CONSTRUCTOR_PRELUDE(property_tween);
+
+    JS::RootedObject scope(context), params_obj(context);
+    uint32_t id;
+    if (!gjs_parse_call_args(context, "PropertyTween", argv, "ou|?o", "scope",
+                             &scope, "easing", &id, "params", &params_obj))
+        return false;
+
+    GjsEasing easing;
+    GjsEasingParams params;
+    JS::RootedValue params_val(context, JS::ObjectOrNullValue(params_obj));
+    if (!easing_from_js(context, id, &easing) ||
+        !easing_params_from_js(context, params_val, &params))
+        return false;
+
+    JS_SetReservedSlot(object, SCOPE_SLOT, JS::ObjectValue(*scope));
+    JS_SetPrivate(object, new GjsPropertyTween(easing, params));
+
+    GJS_NATIVE_CONSTRUCTOR_FINISH(property_tween);
+    return true;
+}
+
+static void gjs_property_tween_finalize(JSFreeOp*, JSObject* obj) {
+    delete static_cast<GjsPropertyTween*>(JS_GetPrivate(obj));
+    JS_SetPrivate(obj, nullptr);
+}
+
+// add(name, start, end)
+GJS_JSAPI_RETURN_CONVENTION
+static bool add_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsPropertyTween, priv);
+    JS::UniqueChars name;
+    double start, end;
+    if (!gjs_parse_call_args(cx, "add", args, "sff", "name", &name, "start",
+                             &start, "end", &end))
+        return false;
+
+    jsid id = gjs_intern_string_to_id(cx, name.get());
+    if (id == JSID_VOID)
+        return false;
+
+    priv->add(id, start, end);
+    args.rval().setUndefined();
+    return true;
+}
+
+// update(t, d, rounded, min, max); min and max may be undefined
+GJS_JSAPI_RETURN_CONVENTION
+static bool update_func(JSContext* cx, unsigned argc, JS::Value* vp) {
+    GJS_GET_PRIV(cx, argc, vp, args, obj, GjsPropertyTween, priv);
+    double t, d;
+    bool rounded;
+    if (!gjs_parse_call_args(cx, "update", args, "ffb", "t", &t, "d", &d,
+                             "rounded", &rounded))
+        return false;
+
+    double min = NAN, max = NAN;
+    if (!args.get(3).isUndefined() && !JS::ToNumber(cx, args[3], &min))
+        return false;
+    if (!args.get(4).isUndefined() && !JS::ToNumber(cx, args[4], &max))
+        return false;
+
+    JS::RootedObject scope(
+        cx, &JS_GetReservedSlot(obj, SCOPE_SLOT).toObject());
+    args.rval().setUndefined();
+    return priv->update(cx, scope, t, d, rounded, min, max);
+}
+
+// clang-format off
+JSPropertySpec gjs_property_tween_proto_props[] = {
+    JS_STRING_SYM_PS(toStringTag, "PropertyTween", JSPROP_READONLY),
+    JS_PS_END};
+// clang-format on
+
+JSFunctionSpec gjs_property_tween_proto_funcs[] = {
+    JS_FN("add", add_func, 3, 0),
+    JS_FN("update", update_func, 5, 0),
+    JS_FS_END};
+
+JSFunctionSpec gjs_property_tween_static_funcs[] = {JS_FS_END};
+
+// clang-format off
+static JSFunctionSpec module_funcs[] = {
+    JS_FN("ease", ease_func, 5, GJS_MODULE_PROP_FLAGS),
+    JS_FS_END};
+// clang-format on
+
+bool gjs_define_tweener_stuff(JSContext* cx, JS::MutableHandleObject module) {
+    module.set(JS_NewPlainObject(cx));
+    if (!module || !JS_DefineFunctions(cx, module, module_funcs))
+        return false;
+
+    JS::RootedValueVector names(cx);
+    if (!names.reserve(N_EASINGS)) {
+        JS_ReportOutOfMemory(cx);
+        return false;
+    }
+    for (const char* name : easing_names) {
+        JSString* str = JS_NewStringCopyZ(cx, name);
+        if (!str)
+            return false;
+        names.infallibleAppend(JS::StringValue(str));
+    }
+    JS::RootedObject names_array(cx, JS::NewArrayObject(cx, names));
+    if (!names_array ||
+        !JS_DefineProperty(cx, module, "EASINGS", names_array,
+                           GJS_MODULE_PROP_FLAGS | JSPROP_READONLY))
+        return false;
+
+    JS::RootedObject proto(cx);
+    return gjs_property_tween_define_proto(cx, module, &proto);
+}
@@ -1296,6 +1296,14 @@ test_correct_line_coverage_data_written_for_both_source_file_sections(
     g_free(coverage_data_contents);
 }
 
+// GJS_COVERAGE_NATIVE is only read when the GjsCoverage is created
+static void gjs_coverage_native_fixture_set_up(void* fixture_data,
+                                               const void* user_data) {
+    g_setenv("GJS_COVERAGE_NATIVE", "1", /* overwrite = */ true);
+    gjs_coverage_fixture_set_up(fixture_data, user_data);
+    g_unsetenv("GJS_COVERAGE_NATIVE");
+}
+
 typedef struct _FixturedTest {
     gsize            fixture_size;
     GTestFixtureFunc set_up;
@@ -1409,6 +1417,25 @@ void gjs_test_add_tests_for_coverage()
                          test_end_of_record_section_written_to_coverage_data,
                          NULL);
 
+    FixturedTest native_coverage_fixture = {
+        sizeof(GjsCoverageFixture),
+        gjs_coverage_native_fixture_set_up,
+        gjs_coverage_fixture_tear_down
+    };
+
+    add_test_for_fixture("/gjs/coverage/native/function_hit_counts_written_to_coverage_data",
+                         &native_coverage_fixture,
+                         test_function_hit_counts_written_to_coverage_data,
+                         NULL);
+    add_test_for_fixture("/gjs/coverage/native/single_line_hit_written_to_coverage_data",
+                         &native_coverage_fixture,
+                         test_single_line_hit_written_to_coverage_data,
+                         NULL);
+    add_test_for_fixture("/gjs/coverage/native/end_of_record_section_written_to_coverage_data",
+                         &native_coverage_fixture,
+                         test_end_of_record_section_written_to_coverage_data,
+                         NULL);
+
     FixturedTest coverage_for_multiple_files_to_single_output_fixture = {
         sizeof(GjsCoverageMultpleSourcesFixutre),
         gjs_coverage_multiple_source_files_to_single_output_fixture_set_up,
@@ -204,6 +204,34 @@ static void test_maybe_owned_switch_to_rooted_prevents_collection(
     delete obj;
 }
 
+static void test_maybe_owned_switching_repeatedly_keeps_rooting(
+    GjsRootingFixture* fx, const void*) {
+    auto obj = new GjsMaybeOwned<JSObject *>();
+    auto other = new GjsMaybeOwned<JSObject *>();
+    *obj = test_obj_new(fx);
+    other->root(PARENT(fx)->cx, JS_NewPlainObject(PARENT(fx)->cx));
+
+    // The slots of the two roots get reused in turn
+    for (int ix = 0; ix < 1000; ix++) {
+        obj->switch_to_rooted(PARENT(fx)->cx);
+        if (ix % 2) {
+            other->switch_to_unrooted(PARENT(fx)->cx);
+            other->switch_to_rooted(PARENT(fx)->cx);
+        }
+        obj->switch_to_unrooted(PARENT(fx)->cx);
+    }
+    obj->switch_to_rooted(PARENT(fx)->cx);
+
+    wait_for_gc(fx);
+    g_assert_false(fx->finalized);
+    g_assert_true(other->rooted());
+
+    delete other;
+    delete obj;
+    wait_for_gc(fx);
+    g_assert_true(fx->finalized);
+}
+
 static void test_maybe_owned_switch_to_unrooted_allows_collection(
     GjsRootingFixture* fx, const void*) {
     auto obj = new GjsMaybeOwned<JSObject *>();
@@ -271,6 +299,8 @@ gjs_test_add_tests_for_rooting(void)
                      test_maybe_owned_switching_mode_keeps_same_value);
     ADD_ROOTING_TEST("maybe-owned/switch-to-rooted-prevents-collection",
                      test_maybe_owned_switch_to_rooted_prevents_collection);
+    ADD_ROOTING_TEST("maybe-owned/switching-repeatedly-keeps-rooting",
+                     test_maybe_owned_switching_repeatedly_keeps_rooting);
     ADD_ROOTING_TEST("maybe-owned/switch-to-unrooted-allows-collection",
                      test_maybe_owned_switch_to_unrooted_allows_collection);
 
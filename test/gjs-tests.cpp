@@ -27,13 +27,17 @@
 #include <string.h>  // for size_t, strlen
 
 #include <string>  // for u16string, u32string
+#include <utility>  // for move
 
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 #include <glib/gstdio.h>  // for g_unlink
 
 #include <js/Array.h>
 #include <js/CharacterEncoding.h>
+#include <js/GCAPI.h>     // for JS_GC
+#include <js/GCVector.h>  // for RootedObjectVector
 #include <js/RootingAPI.h>
 #include <js/TypeDecls.h>
 #include <js/Utility.h>  // for UniqueChars
@@ -45,11 +49,13 @@
 #include "gi/arg-inl.h"
 #include "cjs/context.h"
 #include "cjs/error-types.h"
+#include "cjs/job-queue.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/profiler.h"
 #include "test/gjs-test-no-introspection-object.h"
 #include "test/gjs-test-utils.h"
 #include "util/misc.h"
+#include "util/text.h"
 
 // COMPAT: https://gitlab.gnome.org/GNOME/glib/-/merge_requests/1553
 #ifdef __clang_analyzer__
@@ -125,6 +131,236 @@ gjstest_test_func_gjs_context_exit(void)
     g_object_unref(context);
 }
 
+// Points @weak_ptr to an object that only its wrapper refers to, after toggling
+// it so that a full GC is scheduled
+static void make_toggled_object(GjsContext* gjs, GObject** weak_ptr) {
+    GError* error = nullptr;
+    int status;
+
+    g_type_class_ref(GJSTEST_TYPE_NO_INTROSPECTION_OBJECT);
+
+    // Setting a JS property switches the wrapper to a toggle ref
+    bool ok = gjs_context_eval(gjs,
+                               "imports.gi.GObject.Object.newv("
+                               "    imports.gi.GObject.type_from_name("
+                               "        'GjsTestNoIntrospectionObject'), []"
+                               ").jsProperty = 1;",
+                               -1, "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+
+    *weak_ptr = G_OBJECT(gjstest_no_introspection_object_peek());
+    g_object_add_weak_pointer(*weak_ptr, reinterpret_cast<void**>(weak_ptr));
+    g_object_ref(*weak_ptr);
+    g_object_unref(*weak_ptr);
+}
+
+static void gjstest_test_func_gjs_context_notify_idle_budget(void) {
+    GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+    auto* cx = static_cast<JSContext*>(gjs_context_get_native_context(gjs));
+
+    GObject* obj;
+    make_toggled_object(gjs, &obj);
+
+    gjs_context_notify_idle_budget(gjs, 500);  // ignored, too short
+    g_assert_false(JS::IsIncrementalGCInProgress(cx));
+    g_assert_nonnull(obj);
+
+    // The pending GC runs from here, without the main loop
+    for (unsigned ix = 0; ix < 10000 && obj; ix++)
+        gjs_context_notify_idle_budget(gjs, 2000);
+    g_assert_false(JS::IsIncrementalGCInProgress(cx));
+    g_assert_null(obj);
+}
+
+static void gjstest_test_func_gjs_context_frame_deadline(void) {
+    GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+    auto* cx = static_cast<JSContext*>(gjs_context_get_native_context(gjs));
+    GError* error = nullptr;
+    int status;
+
+    // Garbage, so that the GC takes more than one slice
+    bool ok = gjs_context_eval(gjs, "Array.from({length: 100000}, i => ({i}));",
+                               -1, "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+
+    GObject* obj;
+    make_toggled_object(gjs, &obj);
+
+    // Start the GC; the rest of its slices are left to the main loop
+    gjs_context_notify_idle_budget(gjs, 1000);
+    g_assert_true(JS::IsIncrementalGCInProgress(cx));
+
+    // Too close to the deadline to fit a slice in, so the slices are put off
+    // until it has passed
+    int64_t deadline = g_get_monotonic_time() + 500;
+    gjs_context_set_frame_deadline(gjs, deadline);
+    while (JS::IsIncrementalGCInProgress(cx))
+        g_main_context_iteration(nullptr, /* may_block = */ true);
+    g_assert_cmpint(g_get_monotonic_time(), >=, deadline);
+    g_assert_null(obj);
+
+    gjs_context_set_frame_deadline(gjs, 0);
+}
+
+#if GLIB_CHECK_VERSION(2, 64, 0)
+static void gjstest_test_func_gjs_context_low_memory_warning(void) {
+    GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+    GError* error = nullptr;
+    int status;
+
+    g_type_class_ref(GJSTEST_TYPE_NO_INTROSPECTION_OBJECT);
+
+    // Only the wrapper refers to the object, so it is freed once collected
+    bool ok = gjs_context_eval(gjs,
+                               "imports.gi.GObject.Object.newv("
+                               "    imports.gi.GObject.type_from_name("
+                               "        'GjsTestNoIntrospectionObject'), []);",
+                               -1, "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+    GObject* obj = G_OBJECT(gjstest_no_introspection_object_peek());
+    g_object_add_weak_pointer(obj, reinterpret_cast<void**>(&obj));
+    g_assert_nonnull(obj);
+
+    GjsAutoUnref<GMemoryMonitor> monitor = g_memory_monitor_dup_default();
+    g_signal_emit_by_name(monitor, "low-memory-warning",
+                          G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL);
+
+    // Collected right away, without the main loop running
+    g_assert_null(obj);
+
+    ok = gjs_context_eval(gjs, "new imports.gi.GObject.Object();", -1,
+                          "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+}
+#endif
+
+static void gjstest_test_func_gjs_context_job_queue_budget(void) {
+    g_setenv("GJS_JOB_QUEUE_BUDGET", "1", /* overwrite = */ true);
+    GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+    g_unsetenv("GJS_JOB_QUEUE_BUDGET");
+    GError* error = nullptr;
+    int status;
+
+    // Enough jobs to run over the budget, so that the drain is split up
+    bool ok = gjs_context_eval(gjs,
+                               "const {GLib} = imports.gi;"
+                               "const loop = new GLib.MainLoop(null, false);"
+                               "let count = 0;"
+                               "(async function () {"
+                               "    for (let i = 0; i < 100000; i++) {"
+                               "        await null;"
+                               "        count++;"
+                               "    }"
+                               "    loop.quit();"
+                               "})();"
+                               "loop.run();"
+                               "if (count !== 100000)"
+                               "    throw new Error(`${count} jobs run`);",
+                               -1, "<input>", &status, &error);
+    g_assert_no_error(error);
+    g_assert_true(ok);
+}
+
+static void gjstest_test_func_gjs_context_bytecode_cache(void) {
+    // The second context decodes the internal modules that the first one
+    // compiled and cached
+    for (unsigned ix = 0; ix < 2; ix++) {
+        GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+        GError* error = nullptr;
+        int status;
+
+        bool ok = gjs_context_eval(gjs,
+                                   "const {GObject} = imports.gi;"
+                                   "const Signals = imports.signals;"
+                                   "const Foo = GObject.registerClass("
+                                   "    class Foo extends GObject.Object {});"
+                                   "Signals.addSignalMethods(Foo.prototype);"
+                                   "new Foo().emit('bar');",
+                                   -1, "<input>", &status, &error);
+        g_assert_no_error(error);
+        g_assert_true(ok);
+    }
+}
+
+static void gjstest_test_func_gjs_context_bytecode_cache_file(void) {
+    char* path;
+    GError* error = nullptr;
+    int fd = g_file_open_tmp("gjs-bytecode-cache-XXXXXX.js", &path, &error);
+    g_assert_no_error(error);
+    g_close(fd, nullptr);
+    GjsAutoChar script_path = path;
+
+    // Edited within the same second, so only the hash tells them apart. The
+    // last ones check UTF-8 decoding and an empty file, which can't be mapped.
+    const char* sources[] = {"40 + 2;", "40 + 2;", "7;",
+                             "'\xc3\xa9'.length + 1;", ""};
+    const int expected[] = {42, 42, 7, 2, 0};
+    for (unsigned ix = 0; ix < G_N_ELEMENTS(sources); ix++) {
+        g_assert_true(g_file_set_contents(script_path, sources[ix], -1, &error));
+        g_assert_no_error(error);
+
+        GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+        int status;
+        bool ok = gjs_context_eval_file(gjs, script_path, &status, &error);
+        g_assert_no_error(error);
+        g_assert_true(ok);
+        g_assert_cmpint(status, ==, expected[ix]);
+    }
+
+    g_unlink(script_path);
+}
+
+static void gjstest_test_func_gjs_context_bytecode_cache_shared(void) {
+    char* path;
+    GError* error = nullptr;
+    int fd = g_file_open_tmp("gjs-bytecode-cache-XXXXXX.js", &path, &error);
+    g_assert_no_error(error);
+    g_close(fd, nullptr);
+    GjsAutoChar script_path = path;
+    g_assert_true(g_file_set_contents(
+        script_path, "function answer() { return 42; } answer();", -1, &error));
+    g_assert_no_error(error);
+
+    // The second context decodes what the first one compiled from the
+    // process's in-memory copy, rather than from the disk
+    for (unsigned ix = 0; ix < 2; ix++) {
+        GjsAutoUnref<GjsContext> gjs = gjs_context_new();
+        int status;
+        bool ok = gjs_context_eval_file(gjs, script_path, &status, &error);
+        g_assert_no_error(error);
+        g_assert_true(ok);
+        g_assert_cmpint(status, ==, 42);
+    }
+
+    g_unlink(script_path);
+}
+
+static void gjstest_test_func_gjs_context_tuning_profile(void) {
+    GjsAutoUnref<GjsContext> gjs = GJS_CONTEXT(
+        g_object_new(GJS_TYPE_CONTEXT, "tuning-profile", "throughput", nullptr));
+    char* name;
+    g_object_get(gjs, "tuning-profile", &name, nullptr);
+    g_assert_cmpstr(name, ==, "throughput");
+    g_free(name);
+
+    auto* cx = static_cast<JSContext*>(gjs_context_get_native_context(gjs));
+    g_assert_cmpuint(JS_GetGCParameter(cx, JSGC_COMPACTING_ENABLED), ==, 0);
+    g_assert_cmpuint(JS_GetGCParameter(cx, JSGC_SLICE_TIME_BUDGET_MS), ==, 50);
+
+    g_test_expect_message("Cjs", G_LOG_LEVEL_WARNING,
+                          "*Unknown tuning profile 'bogus'*");
+    GjsAutoUnref<GjsContext> fallback = GJS_CONTEXT(
+        g_object_new(GJS_TYPE_CONTEXT, "tuning-profile", "bogus", nullptr));
+    g_test_assert_expected_messages();
+    g_object_get(fallback, "tuning-profile", &name, nullptr);
+    g_assert_cmpstr(name, ==, "default");
+    g_free(name);
+}
+
 #define JS_CLASS "\
 const GObject = imports.gi.GObject; \
 const FooBar = GObject.registerClass(class FooBar extends GObject.Object {}); \
@@ -178,6 +414,98 @@ static void gjstest_test_func_gjs_gobject_without_introspection(void) {
 #undef TESTJS
 }
 
+// Toggles GObjects in between the slices of an incremental GC, including the
+// ones where their wrappers have been swept but not finalized yet. Each round
+// toggles at a later gap between slices, until the GC doesn't reach it.
+static void gjstest_test_func_gjs_gobject_toggle_between_gc_slices(void) {
+    GjsAutoUnref<GjsContext> context = gjs_context_new();
+    auto* cx = static_cast<JSContext*>(gjs_context_get_native_context(context));
+    GError* error = nullptr;
+    int status;
+
+    g_type_class_ref(GJSTEST_TYPE_NO_INTROSPECTION_OBJECT);
+
+    static constexpr unsigned N_OBJECTS = 20;
+    static constexpr unsigned MAX_ROUNDS = 50;
+    for (unsigned gap = 0; gap < MAX_ROUNDS; gap++) {
+        // Setting a JS property switches the wrapper to a toggle ref
+        GObject* objects[N_OBJECTS];
+        for (unsigned ix = 0; ix < N_OBJECTS; ix++) {
+            bool ok = gjs_context_eval(
+                context,
+                "imports.gi.GObject.Object.newv("
+                "    imports.gi.GObject.type_from_name("
+                "        'GjsTestNoIntrospectionObject'), []).jsProperty = 1;",
+                -1, "<input>", &status, &error);
+            g_assert_no_error(error);
+            g_assert_true(ok);
+            objects[ix] = G_OBJECT(gjstest_no_introspection_object_peek());
+            g_object_add_weak_pointer(objects[ix],
+                                      reinterpret_cast<void**>(&objects[ix]));
+        }
+
+        // Garbage, so that the GC takes more than one slice
+        bool ok = gjs_context_eval(context,
+                                   "Array.from({length: 100000}, i => ({i}));",
+                                   -1, "<input>", &status, &error);
+        g_assert_no_error(error);
+        g_assert_true(ok);
+
+        unsigned n_gaps = 0;
+        JS::PrepareForFullGC(cx);
+        JS::StartIncrementalGC(cx, GC_NORMAL, JS::GCReason::API, 1);
+        while (JS::IsIncrementalGCInProgress(cx)) {
+            if (n_gaps++ == gap) {
+                for (GObject* obj : objects) {
+                    if (!obj)
+                        continue;
+                    g_object_ref(obj);
+                    g_object_unref(obj);
+                }
+            }
+            JS::IncrementalGCSlice(cx, JS::GCReason::API, 1);
+        }
+
+        // The ones toggled before they were swept survived that GC
+        JS_GC(cx);
+        for (GObject* obj : objects)
+            g_assert_null(obj);
+
+        if (n_gaps <= gap)
+            break;
+    }
+}
+
+// Run with -m perf. Every method call unwraps the instance parameter, so this
+// mostly measures GIWrapperBase::for_js() and the typecheck
+static void gjstest_test_func_gjs_gobject_unwrap_perf() {
+    if (!g_test_perf()) {
+        g_test_skip("Performance test; run with -m perf");
+        return;
+    }
+
+    GjsAutoUnref<GjsContext> context = gjs_context_new();
+    GError* error = nullptr;
+    int status;
+    static constexpr unsigned N_CALLS = 1000000;
+
+    GjsAutoChar script = g_strdup_printf(
+        "const {GObject} = imports.gi;"
+        "const obj = new GObject.Object();"
+        "for (let i = 0; i < %u; i++)"
+        "    obj.is_floating();",
+        N_CALLS);
+
+    g_test_timer_start();
+    bool ok = gjs_context_eval(context, script, -1, "<input>", &status, &error);
+    double elapsed = g_test_timer_elapsed();
+    g_assert_no_error(error);
+    g_assert_true(ok);
+
+    g_test_maximized_result(N_CALLS / elapsed,
+                            "GObject method calls per second");
+}
+
 static void gjstest_test_func_gjs_jsapi_util_string_js_string_utf8(
     GjsUnitTestFixture* fx, const void*) {
     JS::RootedValue js_string(fx->cx);
@@ -189,6 +517,19 @@ static void gjstest_test_func_gjs_jsapi_util_string_js_string_utf8(
     g_assert_cmpstr(VALID_UTF8_STRING, ==, utf8_result.get());
 }
 
+static void test_jsapi_util_string_intern(GjsUnitTestFixture* fx,
+                                          const void*) {
+    // One of the atoms, and a string that isn't
+    for (const char* name : {"prototype", "notAnAtomName"}) {
+        JS::RootedId id(fx->cx, gjs_intern_string_to_id(fx->cx, name));
+        g_assert_true(JSID_IS_STRING(id));
+
+        JS::RootedString atom(fx->cx, JS_AtomizeString(fx->cx, name));
+        g_assert_nonnull(atom);
+        g_assert_true(JSID_TO_STRING(id) == atom);
+    }
+}
+
 static void gjstest_test_func_gjs_jsapi_util_error_throw(GjsUnitTestFixture* fx,
                                                          const void*) {
     JS::RootedValue exc(fx->cx), value(fx->cx);
@@ -263,6 +604,40 @@ static void test_jsapi_util_string_char16_data(GjsUnitTestFixture* fx,
     g_free(chars);
 }
 
+static void test_job_queue_fifo(GjsUnitTestFixture* fx, const void*) {
+    JS::PersistentRooted<GjsJobQueue> queue(fx->cx, GjsJobQueue());
+    JS::RootedObjectVector jobs(fx->cx);
+    for (size_t ix = 0; ix < 50; ix++)
+        g_assert_true(jobs.append(JS_NewPlainObject(fx->cx)));
+
+    // Wrap around the initial buffer before making it grow
+    for (size_t ix = 0; ix < 10; ix++)
+        g_assert_true(queue.get().push(jobs[ix]));
+    for (size_t ix = 0; ix < 5; ix++) {
+        JSObject* expected = jobs[ix];
+        g_assert_true(queue.get().pop() == expected);
+    }
+    for (size_t ix = 10; ix < 50; ix++)
+        g_assert_true(queue.get().push(jobs[ix]));
+
+    JS_GC(fx->cx);
+
+    g_assert_cmpuint(queue.get().length(), ==, 45);
+    for (size_t ix = 5; ix < 50; ix++) {
+        JSObject* expected = jobs[ix];
+        g_assert_true(queue.get().pop() == expected);
+    }
+    g_assert_true(queue.get().empty());
+
+    // Moving a queue takes its jobs along
+    g_assert_true(queue.get().push(jobs[0]));
+    GjsJobQueue moved(std::move(queue.get()));
+    g_assert_true(queue.get().empty());
+    g_assert_cmpuint(moved.length(), ==, 1);
+    moved.clear();
+    g_assert_true(moved.empty());
+}
+
 static void test_jsapi_util_string_to_ucs4(GjsUnitTestFixture* fx,
                                            const void*) {
     gunichar *chars;
@@ -345,6 +720,40 @@ gjstest_test_func_util_misc_strv_concat_null(void)
     g_strfreev(ret);
 }
 
+static void gjstest_test_func_util_text_ascii(void) {
+    std::string ascii(110, 'a');
+    g_assert_true(gjs_text_is_ascii(ascii.c_str(), ascii.size()));
+    g_assert_true(gjs_text_is_ascii("", 0));
+
+    // non-ASCII byte in each of the vector, word, and byte loops
+    for (size_t pos : {3, 100, 107}) {
+        std::string str(ascii);
+        str[pos] = '\xc3';
+        g_assert_false(gjs_text_is_ascii(str.c_str(), str.size()));
+    }
+}
+
+static void gjstest_test_func_util_text_utf8_to_utf16(void) {
+    const char utf8[] = "a long enough run of ASCII text " VALID_UTF8_STRING
+                        " \360\237\230\200 end";
+    std::u16string expected(u"a long enough run of ASCII text \u00c9\u00d6 "
+                            u"foobar \u30df \U0001f600 end");
+
+    char16_t out[sizeof(utf8)];
+    size_t len = gjs_text_utf8_to_utf16(utf8, strlen(utf8), out);
+    g_assert_cmpuint(len, ==, expected.size());
+    g_assert_true(std::u16string(out, len) == expected);
+    g_assert_false(gjs_text_utf16_has_no_surrogates(out, len));
+    g_assert_true(gjs_text_utf16_has_no_surrogates(out, len - 6));
+
+    // overlong, surrogate, out of range, and truncated sequences
+    for (const char* invalid :
+         {"\300\200", "\355\240\200", "\364\220\200\200", "\342\202"}) {
+        g_assert_cmpuint(gjs_text_utf8_to_utf16(invalid, strlen(invalid), out),
+                         ==, GJS_TEXT_INVALID);
+    }
+}
+
 static void
 gjstest_test_func_util_misc_strv_concat_pointers(void)
 {
@@ -440,14 +849,39 @@ main(int    argc,
     g_test_add_func("/gjs/context/eval/non-zero-terminated",
                     gjstest_test_func_gjs_context_eval_non_zero_terminated);
     g_test_add_func("/gjs/context/exit", gjstest_test_func_gjs_context_exit);
+    g_test_add_func("/gjs/context/notify-idle-budget",
+                    gjstest_test_func_gjs_context_notify_idle_budget);
+    g_test_add_func("/gjs/context/frame-deadline",
+                    gjstest_test_func_gjs_context_frame_deadline);
+    g_test_add_func("/gjs/context/job-queue-budget",
+                    gjstest_test_func_gjs_context_job_queue_budget);
+    g_test_add_func("/gjs/context/bytecode-cache",
+                    gjstest_test_func_gjs_context_bytecode_cache);
+    g_test_add_func("/gjs/context/bytecode-cache/file",
+                    gjstest_test_func_gjs_context_bytecode_cache_file);
+    g_test_add_func("/gjs/context/bytecode-cache/shared",
+                    gjstest_test_func_gjs_context_bytecode_cache_shared);
+    g_test_add_func("/gjs/context/tuning-profile",
+                    gjstest_test_func_gjs_context_tuning_profile);
+#if GLIB_CHECK_VERSION(2, 64, 0)
+    g_test_add_func("/gjs/context/low-memory-warning",
+                    gjstest_test_func_gjs_context_low_memory_warning);
+#endif
     g_test_add_func("/gjs/gobject/js_defined_type", gjstest_test_func_gjs_gobject_js_defined_type);
     g_test_add_func("/gjs/gobject/without_introspection",
                     gjstest_test_func_gjs_gobject_without_introspection);
+    g_test_add_func("/gjs/gobject/toggle-between-gc-slices",
+                    gjstest_test_func_gjs_gobject_toggle_between_gc_slices);
+    g_test_add_func("/gjs/gobject/unwrap/perf",
+                    gjstest_test_func_gjs_gobject_unwrap_perf);
     g_test_add_func("/gjs/profiler/start_stop", gjstest_test_profiler_start_stop);
     g_test_add_func("/util/misc/strv/concat/null",
                     gjstest_test_func_util_misc_strv_concat_null);
     g_test_add_func("/util/misc/strv/concat/pointers",
                     gjstest_test_func_util_misc_strv_concat_pointers);
+    g_test_add_func("/util/text/ascii", gjstest_test_func_util_text_ascii);
+    g_test_add_func("/util/text/utf8-to-utf16",
+                    gjstest_test_func_util_text_utf8_to_utf16);
 
 #define ADD_JSAPI_UTIL_TEST(path, func)                            \
     g_test_add("/gjs/jsapi/util/" path, GjsUnitTestFixture, NULL,  \
@@ -460,6 +894,7 @@ main(int    argc,
                         gjstest_test_func_gjs_jsapi_util_string_js_string_utf8);
     ADD_JSAPI_UTIL_TEST("string/utf8-nchars-to-js",
                         test_jsapi_util_string_utf8_nchars_to_js);
+    ADD_JSAPI_UTIL_TEST("string/intern", test_jsapi_util_string_intern);
     ADD_JSAPI_UTIL_TEST("string/char16_data",
                         test_jsapi_util_string_char16_data);
     ADD_JSAPI_UTIL_TEST("string/to_ucs4",
@@ -478,6 +913,10 @@ main(int    argc,
 
 #undef ADD_JSAPI_UTIL_TEST
 
+    g_test_add("/gjs/job-queue/fifo", GjsUnitTestFixture, nullptr,
+               gjs_unit_test_fixture_setup, test_job_queue_fifo,
+               gjs_unit_test_fixture_teardown);
+
     gjs_test_add_tests_for_coverage ();
     gjs_test_add_tests_for_parse_call_args();
     gjs_test_add_tests_for_rooting();
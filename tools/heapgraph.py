@@ -29,7 +29,7 @@ NAME_ANNOTATION = '__heapgraph_name'
 parser = argparse.ArgumentParser(description='Find what is rooting or preventing an object from being collected in a GJS heap using a shortest-path breadth-first algorithm.')
 
 parser.add_argument('heap_file', metavar='FILE',
-                    help='Garbage collector heap from System.dumpHeap()')
+                    help='Garbage collector heap or snapshot from System.dumpHeap()')
 
 parser.add_argument('targets', metavar='TARGET', nargs='*',
                     help='Heap address (eg. 0x7fa814054d00) or type prefix (eg. Array, Object, GObject, Function...)')
@@ -232,12 +232,115 @@ def parse_graph(fobj):
     return [edges, edge_labels, node_labels, annotations]
 
 
+SNAPSHOT_MAGIC = b'GJSHEAP\x01'
+
+
+def is_snapshot(fname):
+    """Check for the binary format of System.dumpHeap(file, 'snapshot')."""
+
+    with open(fname, 'rb') as fobj:
+        return fobj.read(len(SNAPSHOT_MAGIC)) == SNAPSHOT_MAGIC
+
+
+def parse_snapshot(fname):
+    """Parse a binary heap snapshot; see cjs/heap-snapshot.h for the format."""
+
+    with open(fname, 'rb') as fobj:
+        data = fobj.read()
+
+    roots = {}
+    root_labels = {}
+    edges = {}
+    edge_labels = {}
+    node_labels = {}
+    annotations = {}
+    pos = 0
+
+    def read_uint():
+        nonlocal pos
+        value = 0
+        shift = 0
+        while True:
+            byte = data[pos]
+            pos += 1
+            value |= (byte & 0x7f) << shift
+            if byte < 0x80:
+                return value
+            shift += 7
+
+    def read_string():
+        nonlocal pos
+        length = read_uint()
+        pos += length
+        return data[pos - length:pos].decode('utf-8', 'replace')
+
+    while pos < len(data):
+        if data[pos:pos + len(SNAPSHOT_MAGIC)] != SNAPSHOT_MAGIC:
+            sys.stderr.write('Error: bad heap snapshot at offset {}\n'.format(pos))
+            exit(-1)
+        pos += len(SNAPSHOT_MAGIC)
+        strings = ['']
+        source = None
+
+        while True:
+            tag = data[pos]
+            pos += 1
+            if tag == 0:
+                break
+            elif tag == 1:
+                strings.append(read_string())
+            elif tag == 2:
+                addr = hex(read_uint())
+                type_name = strings[read_uint()]
+                class_name = strings[read_uint()]
+                read_uint()  # size
+                detail = read_string()
+                label = class_name or type_name
+                if detail:
+                    label += ' ' + detail
+                for hide_node in args.hide_nodes:
+                    if hide_node in label:
+                        args.hide_addrs.append(addr)
+                        break
+                else:
+                    node_labels[addr] = label
+                edges.setdefault(addr, {})
+                edge_labels.setdefault(addr, {})
+            elif tag == 3:
+                source = read_uint()
+                source = hex(source) if source else None
+            elif tag == 4:
+                target = hex(read_uint())
+                edge_label = strings[read_uint()]
+                if source is None:
+                    roots[target] = True
+                    root_labels[target] = edge_label
+                elif (source not in args.hide_addrs and
+                        edge_label not in args.hide_edges):
+                    targets = edges.setdefault(source, {})
+                    targets[target] = targets.get(target, 0) + 1
+                    if edge_label != '':
+                        labels = edge_labels.setdefault(source, {})
+                        labels.setdefault(target, []).append(edge_label)
+            else:
+                sys.stderr.write('Error: unknown record {} in heap snapshot\n'.format(tag))
+                exit(-1)
+
+    graph = GraphAttribs(edge_labels=edge_labels, node_labels=node_labels,
+                         roots=roots, root_labels=root_labels,
+                         weakMapEntries=[], annotations=annotations)
+
+    return (edges, graph)
+
+
 def parse_heap(fname):
     """Parse a garbage collector heap."""
 
     try:
+        if is_snapshot(fname):
+            return parse_snapshot(fname)
         fobj = open(fname, 'r')
-    except:
+    except OSError:
         sys.stderr.write('Error opening file {}\n'.format(fname))
         exit(-1)
 
@@ -258,6 +361,11 @@ def find_nodes(fname):
     addrs = [];
 
     try:
+        if is_snapshot(fname):
+            sys.stderr.write('Parsing {0}...'.format(fname))
+            (edges, graph) = parse_snapshot(fname)
+            sys.stderr.write('done\n')
+            return list(edges.keys())
         fobj = open(fname, 'r')
         sys.stderr.write('Parsing {0}...'.format(fname))
     except:
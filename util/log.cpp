@@ -21,10 +21,14 @@
  * IN THE SOFTWARE.
  */
 
+#include <config.h>
+
 #include <errno.h>
 #include <stdarg.h>
+#include <stddef.h>  // for size_t
 #include <stdio.h>   // for FILE, fprintf, fflush, fopen, fputs, fseek
-#include <string.h>  // for strchr, strcmp
+#include <stdlib.h>  // for atexit
+#include <string.h>  // for strchr, strcmp, memcpy
 
 #ifdef _WIN32
 # include <io.h>
@@ -33,212 +37,416 @@
 #  define F_OK 0
 # endif
 #else
-#    include <unistd.h>  // for getpid
+#    include <signal.h>  // for sigaction, raise, SIGSEGV, ...
+#    include <unistd.h>  // for getpid, write
 #endif
 
+#include <atomic>
+
 #include "util/log.h"
 #include "util/misc.h"
 
+#define PREFIX_LENGTH 12
+#define N_TOPICS (GJS_DEBUG_GINTERFACE + 1)
+
+/* Messages longer than this are truncated, to keep formatting on the stack */
+#define MESSAGE_MAX 4096
+
+#define ASYNC_BUFFER_SIZE (256 * 1024)
+#define DEFAULT_RING_BUFFER_SIZE (1024 * 1024)
+#define FLUSH_INTERVAL_US (50 * 1000)
+
+enum LogMode {
+    /* Each message is written and flushed by the thread logging it */
+    LOG_SYNC,
+    /* Messages are queued per thread and written by a background thread */
+    LOG_ASYNC,
+    /* Messages are only kept in memory, overwriting the oldest, and written
+     * out on a crash or when gjs_debug_flush_ring() is called */
+    LOG_RING,
+};
+
+/* A byte queue of formatted, newline-terminated log lines. Only its owning
+ * thread writes to it, and either the flush thread (async mode) or a dump
+ * (ring mode) reads it, so head and tail are the only synchronization. The
+ * indices grow without bound and are reduced modulo the size on access. */
+struct LogBuffer {
+    explicit LogBuffer(size_t size_)
+        : size(size_), data(static_cast<char*>(g_malloc(size_))) {}
+
+    LogBuffer* next = nullptr;
+    size_t size;
+    std::atomic_size_t head{0};
+    std::atomic_size_t tail{0};
+    std::atomic_size_t dropped{0};
+    char* data;
+};
+
+static const char* topic_prefixes[N_TOPICS];
+static bool topic_enabled[N_TOPICS];
+static FILE* logfp = nullptr;
+static int log_fd = -1;
+static LogMode log_mode = LOG_SYNC;
+static size_t ring_size = DEFAULT_RING_BUFFER_SIZE;
+static bool print_timestamp = false;
+static bool print_thread = false;
+static GTimer* timer = nullptr;
+static std::atomic<LogBuffer*> all_buffers{nullptr};
+static std::atomic_bool flush_thread_quit{false};
+static GThread* flush_thread = nullptr;
+
+static const char* topic_prefix(GjsDebugTopic topic) {
+    switch (topic) {
+    case GJS_DEBUG_GI_USAGE:
+        return "JS GI USE";
+    case GJS_DEBUG_MEMORY:
+        return "JS MEMORY";
+    case GJS_DEBUG_CONTEXT:
+        return "JS CTX";
+    case GJS_DEBUG_IMPORTER:
+        return "JS IMPORT";
+    case GJS_DEBUG_NATIVE:
+        return "JS NATIVE";
+    case GJS_DEBUG_KEEP_ALIVE:
+        return "JS KP ALV";
+    case GJS_DEBUG_GREPO:
+        return "JS G REPO";
+    case GJS_DEBUG_GNAMESPACE:
+        return "JS G NS";
+    case GJS_DEBUG_GOBJECT:
+        return "JS G OBJ";
+    case GJS_DEBUG_GFUNCTION:
+        return "JS G FUNC";
+    case GJS_DEBUG_GFUNDAMENTAL:
+        return "JS G FNDMTL";
+    case GJS_DEBUG_GCLOSURE:
+        return "JS G CLSR";
+    case GJS_DEBUG_GBOXED:
+        return "JS G BXD";
+    case GJS_DEBUG_GENUM:
+        return "JS G ENUM";
+    case GJS_DEBUG_GPARAM:
+        return "JS G PRM";
+    case GJS_DEBUG_GERROR:
+        return "JS G ERR";
+    case GJS_DEBUG_GINTERFACE:
+        return "JS G IFACE";
+    default:
+        return "???";
+    }
+}
+
 /* prefix is allowed if it's in the ;-delimited environment variable
  * GJS_DEBUG_TOPICS or if that variable is not set.
  */
-static bool
-is_allowed_prefix (const char *prefix)
-{
-    static const char *topics = NULL;
-    static char **prefixes = NULL;
-    bool found = false;
-    int i;
-
-    if (topics == NULL) {
-        topics = g_getenv("GJS_DEBUG_TOPICS");
+static bool is_allowed_prefix(char** prefixes, const char* prefix) {
+    if (!prefixes)
+        return true;
 
-        if (!topics)
+    for (size_t i = 0; prefixes[i] != NULL; i++) {
+        if (!strcmp(prefixes[i], prefix))
             return true;
-
-        /* We never really free this, should be gone when the process exits */
-        prefixes = g_strsplit(topics, ";", -1);
     }
 
-    if (!prefixes)
-        return true;
+    return false;
+}
 
-    for (i = 0; prefixes[i] != NULL; i++) {
-        if (!strcmp(prefixes[i], prefix)) {
-            found = true;
-            break;
-        }
+static FILE* open_log_file(const char* debug_output) {
+    const char *log_file;
+    char *free_me;
+    char *c;
+
+    /* Allow debug-%u.log for per-pid logfiles as otherwise log
+     * messages from multiple processes can overwrite each other.
+     *
+     * (printf below should be safe as we check '%u' is the only format
+     * string)
+     */
+    c = strchr((char *) debug_output, '%');
+    if (c && c[1] == 'u' && !strchr(c+1, '%')) {
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)
+_Pragma("GCC diagnostic push")
+_Pragma("GCC diagnostic ignored \"-Wformat-nonliteral\"")
+#endif
+        free_me = g_strdup_printf(debug_output, (guint)getpid());
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)
+_Pragma("GCC diagnostic pop")
+#endif
+        log_file = free_me;
+    } else {
+        log_file = debug_output;
+        free_me = NULL;
     }
 
-    return found;
-}
+    /* avoid truncating in case we're using shared logfile */
+    FILE* fp = fopen(log_file, "a");
+    if (!fp)
+        fprintf(stderr, "Failed to open log file `%s': %s\n", log_file,
+                g_strerror(errno));
 
-#define PREFIX_LENGTH 12
+    g_free(free_me);
+    return fp ? fp : stderr;
+}
 
-static void
-write_to_stream(FILE       *logfp,
-                const char *prefix,
-                const char *s)
-{
+static void write_to_stream(const char* s, size_t len) {
     /* seek to end to avoid truncating in case we're using shared logfile */
     (void)fseek(logfp, 0, SEEK_END);
 
-    fprintf(logfp, "%*s: %s", PREFIX_LENGTH, prefix, s);
-    if (!g_str_has_suffix(s, "\n"))
-        fputs("\n", logfp);
+    fwrite(s, 1, len, logfp);
     fflush(logfp);
 }
 
-void
-gjs_debug(GjsDebugTopic topic,
-          const char   *format,
-          ...)
-{
-    static FILE *logfp = NULL;
-    static bool debug_log_enabled = false;
-    static bool checked_for_timestamp = false;
-    static bool print_timestamp = false;
-    static bool checked_for_thread = false;
-    static bool print_thread = false;
-    static GTimer *timer = NULL;
-    const char *prefix;
-    va_list args;
-    char *s;
+static LogBuffer* log_buffer_new(size_t size) {
+    auto* buffer = new LogBuffer(size);
 
-    if (!checked_for_timestamp) {
-        print_timestamp = gjs_environment_variable_is_set("GJS_DEBUG_TIMESTAMP");
-        checked_for_timestamp = true;
+    /* Buffers are never freed, as the flush thread or a crash handler may be
+     * reading them at any time; there is one per thread that ever logged. */
+    buffer->next = all_buffers.load(std::memory_order_relaxed);
+    while (!all_buffers.compare_exchange_weak(buffer->next, buffer,
+                                              std::memory_order_release))
+        ;
+    return buffer;
+}
+
+static void log_buffer_push(LogBuffer* buffer, const char* s, size_t len) {
+    size_t head = buffer->head.load(std::memory_order_relaxed);
+
+    if (log_mode == LOG_RING) {
+        /* The oldest lines are overwritten; a dump skips the partial one */
+        len = MIN(len, buffer->size);
+    } else if (head + len -
+                   buffer->tail.load(std::memory_order_acquire) >
+               buffer->size) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
 
-    if (!checked_for_thread) {
-        print_thread = gjs_environment_variable_is_set("GJS_DEBUG_THREAD");
-        checked_for_thread = true;
+    size_t offset = head % buffer->size;
+    size_t first = MIN(len, buffer->size - offset);
+    memcpy(buffer->data + offset, s, first);
+    memcpy(buffer->data, s + first, len - first);
+    buffer->head.store(head + len, std::memory_order_release);
+}
+
+static void log_buffer_write(LogBuffer* buffer, size_t from, size_t to) {
+    size_t offset = from % buffer->size;
+    size_t first = MIN(to - from, buffer->size - offset);
+    fwrite(buffer->data + offset, 1, first, logfp);
+    fwrite(buffer->data, 1, to - from - first, logfp);
+}
+
+static void log_buffers_flush_async(void) {
+    bool wrote = false;
+    for (LogBuffer* buffer = all_buffers.load(std::memory_order_acquire);
+         buffer; buffer = buffer->next) {
+        size_t head = buffer->head.load(std::memory_order_acquire);
+        size_t tail = buffer->tail.load(std::memory_order_relaxed);
+        if (head != tail) {
+            log_buffer_write(buffer, tail, head);
+            buffer->tail.store(head, std::memory_order_release);
+            wrote = true;
+        }
+
+        size_t dropped = buffer->dropped.exchange(0);
+        if (dropped) {
+            fprintf(logfp, "%*s: %zu messages dropped\n", PREFIX_LENGTH,
+                    "JS LOG", dropped);
+            wrote = true;
+        }
     }
+    if (wrote)
+        fflush(logfp);
+}
 
-    if (print_timestamp && !timer) {
-        timer = g_timer_new();
+static void* flush_thread_func(void*) {
+    while (!flush_thread_quit.load(std::memory_order_relaxed)) {
+        g_usleep(FLUSH_INTERVAL_US);
+        log_buffers_flush_async();
     }
+    log_buffers_flush_async();
+    return nullptr;
+}
 
-    if (logfp == NULL) {
-        const char *debug_output = g_getenv("GJS_DEBUG_OUTPUT");
-        if (debug_output != NULL &&
-            strcmp(debug_output, "stderr") == 0) {
-            debug_log_enabled = true;
-        } else if (debug_output != NULL) {
-            const char *log_file;
-            char *free_me;
-            char *c;
-
-            /* Allow debug-%u.log for per-pid logfiles as otherwise log
-             * messages from multiple processes can overwrite each other.
-             *
-             * (printf below should be safe as we check '%u' is the only format
-             * string)
-             */
-            c = strchr((char *) debug_output, '%');
-            if (c && c[1] == 'u' && !strchr(c+1, '%')) {
-#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)
-_Pragma("GCC diagnostic push")
-_Pragma("GCC diagnostic ignored \"-Wformat-nonliteral\"")
-#endif
-                free_me = g_strdup_printf(debug_output, (guint)getpid());
-#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)
-_Pragma("GCC diagnostic pop")
-#endif
-                log_file = free_me;
-            } else {
-                log_file = debug_output;
-                free_me = NULL;
-            }
+static void stop_flush_thread(void) {
+    if (!flush_thread)
+        return;
+    flush_thread_quit.store(true);
+    g_thread_join(flush_thread);
+    flush_thread = nullptr;
+}
 
-            /* avoid truncating in case we're using shared logfile */
-            logfp = fopen(log_file, "a");
-            if (!logfp)
-                fprintf(stderr, "Failed to open log file `%s': %s\n",
-                        log_file, g_strerror(errno));
+#ifndef _WIN32
+/* Only async-signal-safe calls from here on */
+static void write_fd(int fd, const char* s, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, s, len);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        s += written;
+        len -= written;
+    }
+}
+
+static void write_ring_to_fd(int fd) {
+    for (LogBuffer* buffer = all_buffers.load(std::memory_order_acquire);
+         buffer; buffer = buffer->next) {
+        size_t head = buffer->head.load(std::memory_order_acquire);
+        size_t from = head > buffer->size ? head - buffer->size : 0;
+
+        /* Skip the line that was partly overwritten */
+        if (from > 0) {
+            while (from < head && buffer->data[from % buffer->size] != '\n')
+                from++;
+            from++;
+        }
+        while (from < head) {
+            size_t offset = from % buffer->size;
+            size_t len = MIN(head - from, buffer->size - offset);
+            write_fd(fd, buffer->data + offset, len);
+            from += len;
+        }
+    }
+}
 
-            g_free(free_me);
+static constexpr int crash_signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE,
+                                        SIGABRT};
+static struct sigaction old_crash_actions[G_N_ELEMENTS(crash_signals)];
 
-            debug_log_enabled = true;
+static void crash_signal_handler(int signum) {
+    static const char header[] = "==== GJS debug log before crash ====\n";
+    write_fd(log_fd, header, sizeof(header) - 1);
+    write_ring_to_fd(log_fd);
+
+    /* Hand the signal on to whatever handled it before, such as a crash
+     * reporter, or the default action that crashes for real */
+    for (size_t ix = 0; ix < G_N_ELEMENTS(crash_signals); ix++) {
+        if (crash_signals[ix] == signum) {
+            sigaction(signum, &old_crash_actions[ix], nullptr);
+            break;
         }
+    }
+    raise(signum);
+}
+
+static void install_crash_handlers(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = crash_signal_handler;
+    sigemptyset(&sa.sa_mask);
+    for (size_t ix = 0; ix < G_N_ELEMENTS(crash_signals); ix++)
+        sigaction(crash_signals[ix], &sa, &old_crash_actions[ix]);
+}
+#endif
+
+static void parse_log_mode(const char* mode) {
+    if (!mode || strcmp(mode, "sync") == 0)
+        return;
+
+    if (strcmp(mode, "async") == 0) {
+        log_mode = LOG_ASYNC;
+        return;
+    }
 
-        if (logfp == NULL)
-            logfp = stderr;
+    if (g_str_has_prefix(mode, "ring")) {
+        guint64 kib;
+        if (mode[4] == '\0') {
+            log_mode = LOG_RING;
+            return;
+        }
+        if (mode[4] == ':' &&
+            g_ascii_string_to_unsigned(mode + 5, 10, 1, G_MAXSIZE / 1024, &kib,
+                                       nullptr)) {
+            log_mode = LOG_RING;
+            ring_size = kib * 1024;
+            return;
+        }
     }
 
-    if (!debug_log_enabled)
+    fprintf(stderr, "Unknown GJS_DEBUG_BUFFER mode `%s', logging directly\n",
+            mode);
+}
+
+static void log_init(void) {
+    const char* debug_output = g_getenv("GJS_DEBUG_OUTPUT");
+    if (!debug_output)
         return;
 
-    switch (topic) {
-    case GJS_DEBUG_GI_USAGE:
-        prefix = "JS GI USE";
-        break;
-    case GJS_DEBUG_MEMORY:
-        prefix = "JS MEMORY";
-        break;
-    case GJS_DEBUG_CONTEXT:
-        prefix = "JS CTX";
-        break;
-    case GJS_DEBUG_IMPORTER:
-        prefix = "JS IMPORT";
-        break;
-    case GJS_DEBUG_NATIVE:
-        prefix = "JS NATIVE";
-        break;
-    case GJS_DEBUG_KEEP_ALIVE:
-        prefix = "JS KP ALV";
-        break;
-    case GJS_DEBUG_GREPO:
-        prefix = "JS G REPO";
-        break;
-    case GJS_DEBUG_GNAMESPACE:
-        prefix = "JS G NS";
-        break;
-    case GJS_DEBUG_GOBJECT:
-        prefix = "JS G OBJ";
-        break;
-    case GJS_DEBUG_GFUNCTION:
-        prefix = "JS G FUNC";
-        break;
-    case GJS_DEBUG_GFUNDAMENTAL:
-        prefix = "JS G FNDMTL";
-        break;
-    case GJS_DEBUG_GCLOSURE:
-        prefix = "JS G CLSR";
-        break;
-    case GJS_DEBUG_GBOXED:
-        prefix = "JS G BXD";
-        break;
-    case GJS_DEBUG_GENUM:
-        prefix = "JS G ENUM";
-        break;
-    case GJS_DEBUG_GPARAM:
-        prefix = "JS G PRM";
-        break;
-    case GJS_DEBUG_GERROR:
-        prefix = "JS G ERR";
-        break;
-    case GJS_DEBUG_GINTERFACE:
-        prefix = "JS G IFACE";
-        break;
-    default:
-        prefix = "???";
-        break;
+    if (strcmp(debug_output, "stderr") == 0)
+        logfp = stderr;
+    else
+        logfp = open_log_file(debug_output);
+    log_fd = fileno(logfp);
+
+    print_timestamp = gjs_environment_variable_is_set("GJS_DEBUG_TIMESTAMP");
+    print_thread = gjs_environment_variable_is_set("GJS_DEBUG_THREAD");
+    if (print_timestamp)
+        timer = g_timer_new();
+
+    /* We never really free this, should be gone when the process exits */
+    const char* topics = g_getenv("GJS_DEBUG_TOPICS");
+    char** prefixes = topics ? g_strsplit(topics, ";", -1) : nullptr;
+    for (size_t ix = 0; ix < N_TOPICS; ix++) {
+        topic_prefixes[ix] = topic_prefix(GjsDebugTopic(ix));
+        topic_enabled[ix] = is_allowed_prefix(prefixes, topic_prefixes[ix]);
     }
+    g_strfreev(prefixes);
 
-    if (!is_allowed_prefix(prefix))
+    parse_log_mode(g_getenv("GJS_DEBUG_BUFFER"));
+#ifdef _WIN32
+    if (log_mode == LOG_RING) {
+        fprintf(stderr, "Ring buffer logging needs UNIX signals\n");
+        log_mode = LOG_SYNC;
+    }
+#else
+    if (log_mode == LOG_RING)
+        install_crash_handlers();
+#endif
+    if (log_mode == LOG_ASYNC) {
+        flush_thread =
+            g_thread_new("gjs-log", flush_thread_func, nullptr);
+        atexit(stop_flush_thread);
+    }
+}
+
+static LogBuffer* thread_log_buffer(void) {
+    static thread_local LogBuffer* buffer = nullptr;
+    if (G_UNLIKELY(!buffer))
+        buffer = log_buffer_new(log_mode == LOG_RING ? ring_size
+                                                     : ASYNC_BUFFER_SIZE);
+    return buffer;
+}
+
+void
+gjs_debug(GjsDebugTopic topic,
+          const char   *format,
+          ...)
+{
+    static gsize initialized = 0;
+    if (g_once_init_enter(&initialized)) {
+        log_init();
+        g_once_init_leave(&initialized, 1);
+    }
+
+    if (!logfp || topic >= N_TOPICS || !topic_enabled[topic])
         return;
 
-    va_start (args, format);
-    s = g_strdup_vprintf (format, args);
-    va_end (args);
+    /* g_snprintf() returns the untruncated length, so clamp it each time */
+    char message[MESSAGE_MAX];
+    size_t len = 0;
+    auto append = [&message, &len](size_t written) {
+        len = MIN(len + written, sizeof(message) - 1);
+    };
+    append(g_snprintf(message, sizeof(message), "%*s: ", PREFIX_LENGTH,
+                      topic_prefixes[topic]));
 
     if (print_timestamp) {
         static gdouble previous = 0.0;
         gdouble total = g_timer_elapsed(timer, NULL) * 1000.0;
         gdouble since = total - previous;
         const char *ts_suffix;
-        char *s2;
 
         if (since > 50.0) {
             ts_suffix = "!!  ";
@@ -250,21 +458,56 @@ _Pragma("GCC diagnostic pop")
             ts_suffix = "    ";
         }
 
-        s2 = g_strdup_printf("%g %s%s",
-                             total, ts_suffix, s);
-        g_free(s);
-        s = s2;
+        append(g_snprintf(message + len, sizeof(message) - len, "%g %s",
+                          total, ts_suffix));
 
         previous = total;
     }
 
-    if (print_thread) {
-        char *s2 = g_strdup_printf("(thread %p) %s", g_thread_self(), s);
-        g_free(s);
-        s = s2;
-    }
+    if (print_thread)
+        append(g_snprintf(message + len, sizeof(message) - len,
+                          "(thread %p) ", g_thread_self()));
+
+    va_list args;
+    va_start(args, format);
+    append(g_vsnprintf(message + len, sizeof(message) - len, format, args));
+    va_end(args);
+
+    /* Leave room for the newline; truncated messages lose their tail */
+    len = MIN(len, sizeof(message) - 2);
+    if (message[len - 1] != '\n')
+        message[len++] = '\n';
+    message[len] = '\0';
+
+    if (log_mode == LOG_SYNC)
+        write_to_stream(message, len);
+    else
+        log_buffer_push(thread_log_buffer(), message, len);
+}
 
-    write_to_stream(logfp, prefix, s);
+/**
+ * gjs_debug_flush_ring:
+ *
+ * When logging into a ring buffer (GJS_DEBUG_BUFFER=ring), writes the
+ * messages currently kept in it to the log output. Does nothing otherwise.
+ */
+void gjs_debug_flush_ring(void) {
+#ifndef _WIN32
+    if (log_mode != LOG_RING || !logfp)
+        return;
 
-    g_free(s);
+    fflush(logfp);
+    write_ring_to_fd(log_fd);
+#endif
+}
+
+/**
+ * gjs_debug_flush:
+ *
+ * When logging asynchronously, writes the messages still waiting in the
+ * buffers to the log output, for a process that is about to exit without
+ * running its atexit() handlers. Messages logged afterwards are lost.
+ */
+void gjs_debug_flush(void) {
+    stop_flush_thread();
 }
@@ -170,4 +170,7 @@ void gjs_debug(GjsDebugTopic topic,
                const char   *format,
                ...) G_GNUC_PRINTF (2, 3);
 
+void gjs_debug_flush_ring(void);
+void gjs_debug_flush(void);
+
 #endif  // UTIL_LOG_H_
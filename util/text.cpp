@@ -0,0 +1,215 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <config.h>
+
+#include <stdint.h>
+#include <string.h>  // for memcpy
+
+#if defined(__SSE2__)
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#endif
+
+#include "util/text.h"
+
+bool gjs_text_is_ascii(const char* str, size_t len) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        if (_mm_movemask_epi8(chunk))
+            return false;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(str + i));
+        if (vmaxvq_u8(chunk) >= 0x80)
+            return false;
+    }
+#endif
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, str + i, sizeof(word));
+        if (word & UINT64_C(0x8080808080808080))
+            return false;
+    }
+
+    for (; i < len; i++) {
+        if (static_cast<unsigned char>(str[i]) >= 0x80)
+            return false;
+    }
+
+    return true;
+}
+
+[[nodiscard]] static constexpr bool is_surrogate(char16_t c) {
+    return (c & 0xf800) == 0xd800;
+}
+
+bool gjs_text_utf16_has_no_surrogates(const char16_t* str, size_t len) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi16(static_cast<int16_t>(0xf800));
+    const __m128i surrogate = _mm_set1_epi16(static_cast<int16_t>(0xd800));
+    for (; i + 8 <= len; i += 8) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        __m128i found =
+            _mm_cmpeq_epi16(_mm_and_si128(chunk, mask), surrogate);
+        if (_mm_movemask_epi8(found))
+            return false;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint16x8_t mask = vdupq_n_u16(0xf800);
+    const uint16x8_t surrogate = vdupq_n_u16(0xd800);
+    for (; i + 8 <= len; i += 8) {
+        uint16x8_t chunk = vld1q_u16(reinterpret_cast<const uint16_t*>(str + i));
+        uint16x8_t found = vceqq_u16(vandq_u16(chunk, mask), surrogate);
+        if (vmaxvq_u16(found))
+            return false;
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (is_surrogate(str[i]))
+            return false;
+    }
+
+    return true;
+}
+
+// Copies the ASCII run starting at @str, as long as whole blocks of 16 bytes
+// are ASCII, widening each byte to a UTF-16 code unit. Returns the number of
+// bytes consumed.
+[[nodiscard]] static size_t widen_ascii_blocks(const char* str, size_t len,
+                                               char16_t* out) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        if (_mm_movemask_epi8(chunk))
+            break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_unpacklo_epi8(chunk, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8),
+                         _mm_unpackhi_epi8(chunk, zero));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(str + i));
+        if (vmaxvq_u8(chunk) >= 0x80)
+            break;
+        vst1q_u16(reinterpret_cast<uint16_t*>(out + i),
+                  vmovl_u8(vget_low_u8(chunk)));
+        vst1q_u16(reinterpret_cast<uint16_t*>(out + i + 8),
+                  vmovl_high_u8(chunk));
+    }
+#else
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, str + i, sizeof(word));
+        if (word & UINT64_C(0x8080808080808080))
+            break;
+        for (size_t j = 0; j < 8; j++)
+            out[i + j] = static_cast<unsigned char>(str[i + j]);
+    }
+#endif
+
+    return i;
+}
+
+[[nodiscard]] static constexpr bool is_continuation(unsigned char c) {
+    return (c & 0xc0) == 0x80;
+}
+
+size_t gjs_text_utf8_to_utf16(const char* str, size_t len, char16_t* out) {
+    auto* bytes = reinterpret_cast<const unsigned char*>(str);
+    size_t i = 0, n_out = 0;
+
+    while (i < len) {
+        // Text is mostly ASCII, so skip through it a block at a time; the
+        // input and output positions only differ after non-ASCII characters
+        size_t n_ascii = widen_ascii_blocks(str + i, len - i, out + n_out);
+        i += n_ascii;
+        n_out += n_ascii;
+        if (i >= len)
+            break;
+
+        unsigned char c = bytes[i];
+        if (c < 0x80) {
+            out[n_out++] = c;
+            i++;
+            continue;
+        }
+
+        // Stricter than a plain bit pattern match, following the table of
+        // well-formed byte sequences in the Unicode standard: overlong forms,
+        // surrogates, and code points above U+10FFFF are all invalid
+        if (c >= 0xc2 && c <= 0xdf) {
+            if (i + 1 >= len || !is_continuation(bytes[i + 1]))
+                return GJS_TEXT_INVALID;
+            out[n_out++] = ((c & 0x1f) << 6) | (bytes[i + 1] & 0x3f);
+            i += 2;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            if (i + 2 >= len || !is_continuation(bytes[i + 1]) ||
+                !is_continuation(bytes[i + 2]))
+                return GJS_TEXT_INVALID;
+            if ((c == 0xe0 && bytes[i + 1] < 0xa0) ||
+                (c == 0xed && bytes[i + 1] >= 0xa0))
+                return GJS_TEXT_INVALID;
+            out[n_out++] = ((c & 0x0f) << 12) | ((bytes[i + 1] & 0x3f) << 6) |
+                           (bytes[i + 2] & 0x3f);
+            i += 3;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            if (i + 3 >= len || !is_continuation(bytes[i + 1]) ||
+                !is_continuation(bytes[i + 2]) ||
+                !is_continuation(bytes[i + 3]))
+                return GJS_TEXT_INVALID;
+            if ((c == 0xf0 && bytes[i + 1] < 0x90) ||
+                (c == 0xf4 && bytes[i + 1] >= 0x90))
+                return GJS_TEXT_INVALID;
+            uint32_t code_point = ((c & 0x07) << 18) |
+                                  ((bytes[i + 1] & 0x3f) << 12) |
+                                  ((bytes[i + 2] & 0x3f) << 6) |
+                                  (bytes[i + 3] & 0x3f);
+            code_point -= 0x10000;
+            out[n_out++] = 0xd800 | (code_point >> 10);
+            out[n_out++] = 0xdc00 | (code_point & 0x3ff);
+            i += 4;
+        } else {
+            return GJS_TEXT_INVALID;
+        }
+    }
+
+    return n_out;
+}
@@ -0,0 +1,49 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2021 The CJS authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef UTIL_TEXT_H_
+#define UTIL_TEXT_H_
+
+#include <stddef.h>  // for size_t
+
+// Vectorized helpers for the string conversions done when marshalling
+// between C and JS. They use SSE2 on x86-64 and NEON on AArch64, which every
+// CPU on those architectures has, and a word-at-a-time fallback elsewhere.
+
+// Whether the @len bytes at @str are all 7-bit ASCII
+[[nodiscard]] bool gjs_text_is_ascii(const char* str, size_t len);
+
+// Whether none of the @len UTF-16 code units at @str is a surrogate, so that
+// each one is a whole code point
+[[nodiscard]] bool gjs_text_utf16_has_no_surrogates(const char16_t* str,
+                                                    size_t len);
+
+// Decodes and validates @len bytes of UTF-8 at @str into UTF-16 at @out,
+// which must have room for at least @len code units. Returns the number of
+// code units written, or GJS_TEXT_INVALID if @str is not valid UTF-8.
+constexpr size_t GJS_TEXT_INVALID = static_cast<size_t>(-1);
+[[nodiscard]] size_t gjs_text_utf8_to_utf16(const char* str, size_t len,
+                                            char16_t* out);
+
+#endif  // UTIL_TEXT_H_